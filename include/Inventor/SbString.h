@@ -180,7 +180,7 @@ public:
     // Determine required size
     va_list args_copy;
     va_copy(args_copy, args);
-    int size = std::vsnprintf(nullptr, 0, formatstr, args);
+    int size = std::vsnprintf(nullptr, 0, formatstr, args_copy);
     va_end(args_copy);
     
     if (size > 0) {
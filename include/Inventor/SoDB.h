@@ -104,6 +104,19 @@ public:
   static SbBool isNotifying(void);
   static void endNotify(void);
 
+  static void startNotifyBatch(void);
+  static SbBool isNotifyBatching(void);
+  static void endNotifyBatch(void);
+
+  // Scope object for startNotifyBatch() / endNotifyBatch().
+  class NotifyBatch {
+  public:
+    NotifyBatch(void) { SoDB::startNotifyBatch(); }
+    ~NotifyBatch() { SoDB::endNotifyBatch(); }
+    NotifyBatch(const NotifyBatch &) = delete;
+    NotifyBatch & operator=(const NotifyBatch &) = delete;
+  };
+
   typedef SbBool ProgressCallbackType(const SbName & itemid, float fraction,
                                       SbBool interruptible, void * userdata);
   static void addProgressCallback(ProgressCallbackType * func, void * userdata);
@@ -0,0 +1,82 @@
+#ifndef COIN_SOPARALLELRENDERER_H
+#define COIN_SOPARALLELRENDERER_H
+
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+#include <Inventor/SbColor4f.h>
+#include <Inventor/SbViewportRegion.h>
+
+class SoCamera;
+class SoGLRenderAction;
+class SoNode;
+class SoParallelRendererP;
+
+class COIN_DLL_API SoParallelRenderer {
+public:
+  typedef void JobCB(void * userdata, const int job, SoGLRenderAction * action);
+
+  SoParallelRenderer(void);
+  ~SoParallelRenderer();
+
+  void setSceneGraph(SoNode * scene);
+  SoNode * getSceneGraph(void) const;
+
+  int addJob(SoCamera * camera,
+             const SbViewportRegion & viewport,
+             void * context);
+  void setJob(const int job,
+              SoCamera * camera,
+              const SbViewportRegion & viewport,
+              void * context);
+  void removeAllJobs(void);
+  int getNumJobs(void) const;
+  SoGLRenderAction * getGLRenderAction(const int job) const;
+
+  void setNumThreads(const int num);
+  int getNumThreads(void) const;
+
+  void setBackgroundColor(const SbColor4f & color);
+  const SbColor4f & getBackgroundColor(void) const;
+
+  void setPostRenderCallback(JobCB * func, void * userdata = NULL);
+
+  SbBool render(void);
+
+private:
+  SoParallelRenderer(const SoParallelRenderer & rhs);
+  SoParallelRenderer & operator=(const SoParallelRenderer & rhs);
+
+  SoParallelRendererP * pimpl;
+};
+
+#endif // !COIN_SOPARALLELRENDERER_H
@@ -139,6 +139,8 @@ public:
   SbBool isTexturesEnabled(void) const;
   void setDoubleBuffer(const SbBool enable);
   SbBool isDoubleBuffer(void) const;
+  void setBackBufferPreserved(const SbBool onoff);
+  SbBool isBackBufferPreserved(void) const;
   void setRenderMode(const RenderMode mode);
   RenderMode getRenderMode(void) const;
   void setStereoMode(const StereoMode mode);
@@ -112,6 +112,9 @@ public:
   const SoPath * getCurPath(void);
   SoState * getState(void) const;
 
+  void setNeedsCurPath(const SbBool flag);
+  SbBool needsCurPath(void) const;
+
   PathCode getCurPathCode(void) const;
   virtual SoNode * getCurPathTail(void);
   void usePathCode(int & numindices, const int * & indices);
@@ -37,6 +37,7 @@
 #include <Inventor/actions/SoSubAction.h>
 #include <Inventor/SbBasic.h>
 #include <Inventor/SbViewportRegion.h>
+#include <Inventor/SbTime.h>
 #include <cstdint>
 #include <Inventor/lists/SoPathList.h>
 #include <Inventor/lists/SbList.h>
@@ -46,6 +47,7 @@ typedef void SoGLPreRenderCB(void * userdata, class SoGLRenderAction * action);
 typedef float SoGLSortedObjectOrderCB(void * userdata, SoGLRenderAction * action);
 
 class SoGLRenderActionP;
+class SoRenderStatistics;
 
 class COIN_DLL_API SoGLRenderAction : public SoAction {
   typedef SoAction inherited;
@@ -84,6 +86,11 @@ public:
     CUSTOM_CALLBACK
   };
 
+  enum LODManagement {
+    PER_NODE_LOD,
+    SCREEN_SPACE_ERROR_LOD
+  };
+
   typedef AbortCode SoGLRenderAbortCB(void * userdata);
 
   void setViewportRegion(const SbViewportRegion & newregion);
@@ -135,6 +142,27 @@ public:
   SbBool isRenderingTranspPaths(void) const;
   SbBool isRenderingTranspBackfaces(void) const;
 
+  void setLODManagement(const LODManagement mode);
+  LODManagement getLODManagement(void) const;
+  void setLODTriangleBudget(const int numtriangles);
+  int getLODTriangleBudget(void) const;
+  void setLODFrameTimeBudget(const SbTime & frametime);
+  SbTime getLODFrameTimeBudget(void) const;
+  void setLODHysteresis(const float fraction);
+  float getLODHysteresis(void) const;
+  int getLODTriangleCount(void) const;
+
+  int selectLODChild(SoNode * lod, const int defaultchild);
+
+  void setProgressiveRendering(const SbBool onoff);
+  SbBool isProgressiveRendering(void) const;
+  void setProgressiveTimeBudget(const SbTime & budget);
+  SbTime getProgressiveTimeBudget(void) const;
+  void restartProgressiveRendering(void);
+  SbBool isProgressiveRenderingPending(void) const;
+
+  const SoRenderStatistics & getRenderStatistics(void) const;
+
 protected:
   friend class SoGLRenderActionP; // calls beginTraversal
   virtual void beginTraversal(SoNode * node);
@@ -66,6 +66,9 @@ public:
   void setInCameraSpace(const SbBool flag);
   SbBool isInCameraSpace(void) const;
 
+  void setSubgraphCaching(const SbBool onoff);
+  SbBool isSubgraphCaching(void) const;
+
   void setResetPath(const SoPath * path, const SbBool resetbefore = TRUE,
                     const ResetType what = ALL);
   const SoPath * getResetPath(void) const;
@@ -88,7 +91,8 @@ protected:
   virtual void beginTraversal(SoNode * node);
 
 private:
-  enum { CENTER_SET = 0x1, CAMERA_SPACE = 0x2, RESET_BEFORE= 0x4 };
+  enum { CENTER_SET = 0x1, CAMERA_SPACE = 0x2, RESET_BEFORE= 0x4,
+         SUBGRAPH_CACHING = 0x8 };
 
   SbXfBox3f bbox;
   SbVec3f center;
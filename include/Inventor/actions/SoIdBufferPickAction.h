@@ -0,0 +1,86 @@
+#ifndef COIN_SOIDBUFFERPICKACTION_H
+#define COIN_SOIDBUFFERPICKACTION_H
+
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+
+#include <Inventor/actions/SoAction.h>
+#include <Inventor/actions/SoSubAction.h>
+#include <Inventor/tools/SbPimplPtr.h>
+#include <Inventor/SbViewportRegion.h>
+#include <Inventor/SbVec2s.h>
+#include <Inventor/lists/SbList.h>
+
+class SoPath;
+class SoIdBufferPickActionP;
+
+class COIN_DLL_API SoIdBufferPickAction : public SoAction {
+  typedef SoAction inherited;
+
+  SO_ACTION_HEADER(SoIdBufferPickAction);
+
+public:
+  static void initClass(void);
+
+  SoIdBufferPickAction(const SbViewportRegion & viewportregion);
+  virtual ~SoIdBufferPickAction(void);
+
+  void setViewportRegion(const SbViewportRegion & newregion);
+  const SbViewportRegion & getViewportRegion(void) const;
+
+  void invalidate(void);
+  SbBool isBufferValid(void) const;
+
+  int32_t pickPoint(const SbVec2s & pos) const;
+  void pickRectangle(const SbVec2s & corner0, const SbVec2s & corner1,
+                     SbList<int32_t> & ids) const;
+  void pickLasso(const SbVec2s * coords, const int numcoords,
+                 SbList<int32_t> & ids) const;
+
+  int32_t getNumIds(void) const;
+  const SoPath * getPath(const int32_t id) const;
+  int getPrimitiveIndex(const int32_t id) const;
+  int32_t getFirstId(const SoPath * path) const;
+
+protected:
+  virtual void beginTraversal(SoNode * node);
+
+private:
+  SbPimplPtr<SoIdBufferPickActionP> pimpl;
+
+  // NOT IMPLEMENTED:
+  SoIdBufferPickAction(const SoIdBufferPickAction & rhs);
+  SoIdBufferPickAction & operator = (const SoIdBufferPickAction & rhs);
+}; // SoIdBufferPickAction
+
+#endif // !COIN_SOIDBUFFERPICKACTION_H
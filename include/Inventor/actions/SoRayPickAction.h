@@ -69,6 +69,14 @@ public:
   const SoPickedPointList & getPickedPointList(void) const;
   SoPickedPoint * getPickedPoint(const int index = 0) const;
 
+  void setRays(const int numrays, const SbVec3f * starts,
+               const SbVec3f * directions,
+               float neardistance = -1.0,
+               float fardistance = -1.0);
+  void setNormalizedPoints(const int numpoints, const SbVec2f * normpoints);
+  int getNumRays(void) const;
+  const SoPickedPointList & getRayPickedPointList(const int ray) const;
+  SoPickedPoint * getRayPickedPoint(const int ray, const int index = 0) const;
 
   void computeWorldSpaceRay(void);
   SbBool hasWorldSpaceRay(void) const;
@@ -87,6 +95,9 @@ public:
   const SbLine & getLine(void);
   SbBool isBetweenPlanes(const SbVec3f & intersection) const;
   SoPickedPoint * addIntersection(const SbVec3f & objectspacepoint, SbBool frontpick = TRUE);
+  SbBool pushRays(const SbBox3f & box);
+  void popRays(void);
+  void traverseRays(SoNode * node);
 
   void reset(void);
 
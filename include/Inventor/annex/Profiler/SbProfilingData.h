@@ -37,6 +37,7 @@
 #include <Inventor/SbTime.h>
 #include <Inventor/SoType.h>
 #include <Inventor/SbName.h>
+#include <Inventor/SbString.h>
 #include <Inventor/lists/SbList.h>
 #include <Inventor/tools/SbPimplPtr.h>
 
@@ -99,7 +100,24 @@ public:
   SbBool getNodeFlag(int idx, NodeFlag flag) const;
 
   int getIndex(const SoPath * path, SbBool create = FALSE);
+  int getIndex(int parentidx, int childidx, SoNode * node,
+               SbBool create = FALSE);
   int getParentIndex(int idx) const;
+  int getChildIndex(int idx) const;
+
+  // entry for the node currently being traversed
+  void setTraversalEntry(int idx, int pathlen);
+  int getTraversalEntry(void) const;
+  int getTraversalEntryPathLength(void) const;
+
+  // traversal event trace
+  void setEventTraceCapacity(int numevents);
+  int getEventTraceCapacity(void) const;
+  void addTraversalEvent(int idx, SbTime starttime, SbTime duration);
+  int getNumTraversalEvents(void) const;
+  void getTraversalEvent(int eventidx, int & idx,
+                         SbTime & starttime, SbTime & duration) const;
+  SbString getChromeTrace(void) const;
 
   SoType getNodeType(int idx) const;
   SbName getNodeName(int idx) const;
@@ -63,6 +63,12 @@ public:
   SoMFTime profiledActionTime;
   SoMFNode separatorsCullRoots;
 
+  // OpenGL objects per SoGLResourceManager::ResourceType in the
+  // rendering context
+  SoMFName glResourceType;
+  SoMFUInt32 glResourceCount;
+  SoMFUInt32 glResourceKilobytes;
+
   SoSFTrigger profilingUpdate;
 
   // FIXME: below are suggestions for fields exposing future profiling
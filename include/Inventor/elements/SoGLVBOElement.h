@@ -49,6 +49,17 @@ class COIN_DLL_API SoGLVBOElement : public SoElement {
   virtual ~SoGLVBOElement();
 
  public:
+  enum AttributeCompression {
+    COMPRESS_NONE = 0x0,
+    COMPRESS_POSITIONS = 0x1,
+    COMPRESS_NORMALS = 0x2,
+    COMPRESS_TEXCOORDS = 0x4,
+    COMPRESS_ALL = 0x7
+  };
+
+  static void setAttributeCompression(const uint32_t flags);
+  static uint32_t getAttributeCompression(void);
+  static void getMemoryStatistics(size_t & numbytes, size_t & numuncompressedbytes);
 
   static SbBool shouldCreateVBO(SoState * state, const int numdata);
   static void setVertexVBO(SoState * state, SoVBO * vbo);
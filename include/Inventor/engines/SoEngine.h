@@ -64,6 +64,11 @@ public:
   virtual SoFieldContainer * copyThroughConnection(void) const;
   SbBool shouldCopy(void) const;
 
+  static void setScheduledEvaluation(SbBool enable, int numthreads = 0);
+  static SbBool isScheduledEvaluation(void);
+  static int getScheduledEvaluationThreads(void);
+  static void evaluateScheduled(void);
+
   virtual void writeInstance(SoOutput * out);
 
 
@@ -87,7 +92,8 @@ private:
 
   enum InternalEngineFlags {
     FLAG_ISNOTIFYING = (1 << 0),
-    FLAG_ISDIRTY = (1 << 1)
+    FLAG_ISDIRTY = (1 << 1),
+    FLAG_ISSCHEDULED = (1 << 2)
   };
 
   unsigned int flags;
@@ -95,6 +101,8 @@ private:
   // needed for handling connections from SoEngineOutput
   friend class SoEngineOutput;
   void setDirty(void);
+
+  friend class SoEngineScheduler;
 };
 
 #if !defined(COIN_INTERNAL)
@@ -36,6 +36,7 @@
 #include <Inventor/SbBasic.h>
 #include <Inventor/SbVec2s.h>
 #include <Inventor/SbVec2f.h>
+#include <Inventor/SbVec2i32.h>
 #include <Inventor/misc/SoGLImage.h>
 
 class COIN_DLL_API SoGLBigImage : public SoGLImage {
@@ -72,6 +73,26 @@ public:
   SbBool exceededChangeLimit(void);
   static int setChangeLimit(const int limit);
 
+  SbBool setTilePyramid(const char * filename,
+                        const Wrap wraps = REPEAT,
+                        const Wrap wrapt = REPEAT,
+                        const float quality = 0.5f);
+  typedef SbBool SoGLBigImageReadRowCB(void * closure, const int row,
+                                       unsigned char * dst);
+
+  static SbBool writeTilePyramid(const char * filename,
+                                 const SbImage * image,
+                                 const int tilesize = 256);
+  static SbBool writeTilePyramid(const char * filename,
+                                 const SbVec2i32 & size,
+                                 const int numcomponents,
+                                 SoGLBigImageReadRowCB * readrow,
+                                 void * closure,
+                                 const int tilesize = 256);
+  static SbBool isTilePyramid(const char * filename);
+  static void setTileCacheSize(const size_t numbytes);
+  static void setTextureCacheSize(const size_t numbytes);
+
   // will return NULL to avoid that SoGLTextureImageElement will
   // update the texture state.
   virtual SoGLDisplayList * getGLDisplayList(SoState * state);
@@ -0,0 +1,63 @@
+#ifndef COIN_SOGLRESOURCEMANAGER_H
+#define COIN_SOGLRESOURCEMANAGER_H
+
+#include <Inventor/SbBasic.h>
+
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+#include <stddef.h>
+
+class COIN_DLL_API SoGLResourceManager {
+public:
+  enum ResourceType {
+    BUFFER_OBJECT,
+    TEXTURE_OBJECT,
+    DISPLAY_LIST,
+    NUM_RESOURCE_TYPES
+  };
+
+  static void setDefaultBudget(const size_t numbytes);
+  static size_t getDefaultBudget(void);
+  static void setBudget(const uint32_t contextid, const size_t numbytes);
+  static size_t getBudget(const uint32_t contextid);
+
+  static size_t getNumBytes(const uint32_t contextid, const ResourceType type);
+  static size_t getTotalNumBytes(const uint32_t contextid);
+  static int getNumResources(const uint32_t contextid, const ResourceType type);
+  static uint32_t getNumEvictions(const uint32_t contextid);
+
+private:
+  SoGLResourceManager(void);
+};
+
+#endif // !COIN_SOGLRESOURCEMANAGER_H
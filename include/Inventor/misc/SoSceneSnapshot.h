@@ -0,0 +1,65 @@
+#ifndef COIN_SOSCENESNAPSHOT_H
+#define COIN_SOSCENESNAPSHOT_H
+
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+#include <Inventor/SbBasic.h>
+
+class SoNode;
+class SoSceneSnapshotP;
+
+class COIN_DLL_API SoSceneSnapshot {
+public:
+  SoSceneSnapshot(SoNode * scene = NULL);
+  ~SoSceneSnapshot();
+
+  void setSceneGraph(SoNode * scene);
+  SoNode * getSceneGraph(void) const;
+
+  SbBool publish(void);
+  uint32_t getVersion(void) const;
+
+  SoNode * beginRead(void);
+  void endRead(void);
+
+  void reclaim(void);
+  int getNumRetiredVersions(void) const;
+
+private:
+  SoSceneSnapshot(const SoSceneSnapshot & rhs);
+  SoSceneSnapshot & operator=(const SoSceneSnapshot & rhs);
+
+  SoSceneSnapshotP * pimpl;
+};
+
+#endif // !COIN_SOSCENESNAPSHOT_H
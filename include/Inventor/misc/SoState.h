@@ -67,6 +67,9 @@ public:
   SoElement * getElementNoPush(const int stackindex) const;
 
 private:
+  friend class SoAction;
+  void reinit(SoAction * action);
+
   SoElement ** stack;
   int numstacks;
   SbBool cacheopen;
@@ -0,0 +1,69 @@
+#ifndef COIN_SOBVHSEPARATOR_H
+#define COIN_SOBVHSEPARATOR_H
+
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+#include <Inventor/nodes/SoSubNode.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/tools/SbPimplPtr.h>
+
+class SoBVHSeparatorP;
+
+class COIN_DLL_API SoBVHSeparator : public SoSeparator {
+  typedef SoSeparator inherited;
+
+  SO_NODE_HEADER(SoBVHSeparator);
+
+public:
+  static void initClass(void);
+  SoBVHSeparator(void);
+  SoBVHSeparator(const int nchildren);
+
+  virtual void GLRenderBelowPath(SoGLRenderAction * action);
+  virtual void getBoundingBox(SoGetBoundingBoxAction * action);
+  virtual void rayPick(SoRayPickAction * action);
+
+  virtual void notify(SoNotList * nl);
+
+protected:
+  virtual ~SoBVHSeparator();
+
+private:
+  SbPimplPtr<SoBVHSeparatorP> pimpl;
+
+  // NOT IMPLEMENTED
+  SoBVHSeparator(const SoBVHSeparator & rhs);
+  SoBVHSeparator & operator = (const SoBVHSeparator & rhs);
+};
+
+#endif // !COIN_SOBVHSEPARATOR_H
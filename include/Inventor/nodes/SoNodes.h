@@ -65,6 +65,7 @@
 #include <Inventor/nodes/SoGroup.h>
 #include <Inventor/nodes/SoSeparator.h>
 #include <Inventor/nodes/SoAnnotation.h>
+#include <Inventor/nodes/SoBVHSeparator.h>
 #include <Inventor/nodes/SoSelection.h>
 #include <Inventor/nodes/SoExtSelection.h>
 #include <Inventor/nodes/SoLocateHighlight.h>
@@ -155,6 +155,7 @@ private:
   void getBBox(SoAction * action, SbBox3f & box, SbVec3f & center);
   void rayPickBoundingBox(SoRayPickAction * action);
   friend class soshape_primdata;           // internal class
+  friend class soshape_pvcache;            // internal class
   friend class so_generate_prim_private;   // a very private class
 };
 
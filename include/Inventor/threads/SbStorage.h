@@ -77,9 +77,10 @@ public:
 private:
   cc_storage * storage;
 
-  // NOTE: For now, keeping original C implementation to avoid complex thread_local
-  // registry issues. For a future C++20+ migration, consider implementing with
-  // std::jthread and proper thread_local storage with enumeration support.
+  // NOTE: get() resolves the calling thread's block through a
+  // thread_local slot table inside cc_storage_get(), without locking.
+  // The per-storage dictionary is kept for applyToAll() and for
+  // cleanup when threads exit.
 };
 
 #endif // !COIN_SBSTORAGE_H
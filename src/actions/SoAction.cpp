@@ -228,6 +228,11 @@
 #include "actions/SoActionP.h"
 #include "misc/SoDBP.h" // for global envvar COIN_PROFILER
 #include "misc/SoCompactPathList.h"
+#include "misc/SoEnvironment.h"
+
+#ifdef COIN_THREADSAFE
+#include <Inventor/threads/SbMutex.h>
+#endif // COIN_THREADSAFE
 
 
 
@@ -331,6 +336,91 @@ SoType SoAction::classTypeId STATIC_SOTYPE_INIT;
 
 #define PRIVATE(obj) ((obj)->pimpl)
 
+// *************************************************************************
+
+// States left behind by destructed actions, kept for reuse by the
+// next action of the same type. Actions are often constructed on the
+// stack and applied only once (e.g. SoGetMatrixAction and
+// SoGetBoundingBoxAction in draggers and manipulators), and setting
+// up a new state with all its element instances is then a large part
+// of the cost of apply().
+
+struct soaction_pooledstate {
+  SoType type;
+  int counter;
+  SoState * state;
+};
+
+static SbList <soaction_pooledstate> * soaction_statepool = NULL;
+static const int SOACTION_STATEPOOL_MAX = 16;
+
+#ifdef COIN_THREADSAFE
+static SbMutex * soaction_statepool_mutex = NULL;
+#define SOACTION_STATEPOOL_LOCK soaction_statepool_mutex->lock()
+#define SOACTION_STATEPOOL_UNLOCK soaction_statepool_mutex->unlock()
+#else // !COIN_THREADSAFE
+#define SOACTION_STATEPOOL_LOCK
+#define SOACTION_STATEPOOL_UNLOCK
+#endif // !COIN_THREADSAFE
+
+// the states of render actions are tied to GL contexts, and are
+// never reused
+static SbBool
+soaction_statepool_enabled(const SoType & type)
+{
+  static int disabled = -1;
+  if (disabled == -1) {
+    auto env = CoinInternal::getEnvironmentVariable("COIN_NO_STATE_REUSE");
+    disabled = (env.has_value() && std::atoi(env->c_str()) > 0) ? 1 : 0;
+  }
+  return !disabled && soaction_statepool &&
+    !type.isDerivedFrom(SoGLRenderAction::getClassTypeId());
+}
+
+// Takes a pooled state for an action of the given type, or returns
+// NULL if there is none.
+static SoState *
+soaction_statepool_get(const SoType & type, const int counter)
+{
+  if (!soaction_statepool_enabled(type)) return NULL;
+  SoState * state = NULL;
+  SOACTION_STATEPOOL_LOCK;
+  for (int i = soaction_statepool->getLength() - 1; i >= 0; i--) {
+    const soaction_pooledstate & entry = (*soaction_statepool)[i];
+    if (entry.type == type && entry.counter == counter) {
+      state = entry.state;
+      soaction_statepool->remove(i);
+      break;
+    }
+  }
+  SOACTION_STATEPOOL_UNLOCK;
+  return state;
+}
+
+// Hands a state over to the pool, or deletes it if it can't be
+// reused.
+static void
+soaction_statepool_put(const SoType & type, const int counter, SoState * state)
+{
+  if (state == NULL) return;
+  if (soaction_statepool_enabled(type) && state->getDepth() == 0 &&
+      counter == SoEnabledElementsList::getCounter()) {
+    soaction_pooledstate entry;
+    entry.type = type;
+    entry.counter = counter;
+    entry.state = state;
+    SOACTION_STATEPOOL_LOCK;
+    if (soaction_statepool->getLength() < SOACTION_STATEPOOL_MAX) {
+      soaction_statepool->append(entry);
+      state = NULL;
+    }
+    SOACTION_STATEPOOL_UNLOCK;
+  }
+  delete state;
+}
+
+// *************************************************************************
+
 /*!
   Default constructor, does all necessary top level initialization.
 */
@@ -344,6 +434,9 @@ SoAction::SoAction(void)
   PRIVATE(this)->applieddata.node = NULL;
   PRIVATE(this)->terminated = FALSE;
   PRIVATE(this)->prevenabledelementscounter = 0;
+  PRIVATE(this)->methodtable = NULL;
+  PRIVATE(this)->nummethods = 0;
+  PRIVATE(this)->needscurpath = TRUE;
 
   this->currentpath.ref(); // to avoid having a zero refcount instance
 }
@@ -355,7 +448,8 @@ SoAction::~SoAction(void)
 {
   int n = PRIVATE(this)->pathcodearray.getLength();
   for (int i = 0; i < n; i++) delete PRIVATE(this)->pathcodearray[i];
-  delete this->state;
+  soaction_statepool_put(PRIVATE(this)->statetype,
+                         PRIVATE(this)->prevenabledelementscounter, this->state);
 
   this->currentpath.unrefNoDelete(); // to match the ref() in the constructor
 }
@@ -382,6 +476,12 @@ SoAction::initClass(void)
   // Profiler functionality removed - nodekit elimination
 
   SoAction::initClasses();
+
+  soaction_statepool = new SbList <soaction_pooledstate>;
+#ifdef COIN_THREADSAFE
+  soaction_statepool_mutex = new SbMutex;
+#endif // COIN_THREADSAFE
+
   coin_atexit(reinterpret_cast<coin_atexit_f *>(SoAction::atexit_cleanup), CC_ATEXIT_NORMAL);
 }
 
@@ -389,6 +489,16 @@ SoAction::initClass(void)
 void
 SoAction::atexit_cleanup(void)
 {
+  for (int i = 0; i < soaction_statepool->getLength(); i++) {
+    delete (*soaction_statepool)[i].state;
+  }
+  delete soaction_statepool;
+  soaction_statepool = NULL;
+#ifdef COIN_THREADSAFE
+  delete soaction_statepool_mutex;
+  soaction_statepool_mutex = NULL;
+#endif // COIN_THREADSAFE
+
   delete SoAction::enabledElements;
   SoAction::enabledElements = NULL;
   delete SoAction::methods;
@@ -413,6 +523,7 @@ SoAction::initClasses(void)
   SoHandleEventAction::initClass();
   SoPickAction::initClass();
   SoRayPickAction::initClass();
+  SoIdBufferPickAction::initClass();
   SoSearchAction::initClass();
   SoWriteAction::initClass();
   SoIntersectionDetectionAction::initClass();
@@ -462,7 +573,8 @@ SoAction::apply(SoNode * root)
   // to use the SO_ACTION_CONSTRUCTOR() macro in the constructor of
   // the SoAction subclass.
   assert(this->traversalMethods);
-  this->traversalMethods->setUp();
+  PRIVATE(this)->methodtable =
+    this->traversalMethods->getMethodTable(PRIVATE(this)->nummethods);
 
   PRIVATE(this)->terminated = FALSE;
 
@@ -556,7 +668,8 @@ SoAction::apply(SoPath * path)
   // to use the SO_ACTION_CONSTRUCTOR() macro in the constructor of
   // the SoAction subclass.
   assert(this->traversalMethods);
-  this->traversalMethods->setUp();
+  PRIVATE(this)->methodtable =
+    this->traversalMethods->getMethodTable(PRIVATE(this)->nummethods);
 
   PRIVATE(this)->terminated = FALSE;
 
@@ -613,7 +726,8 @@ SoAction::apply(const SoPathList & pathlist, SbBool obeysrules)
   // to use the SO_ACTION_CONSTRUCTOR() macro in the constructor of
   // the SoAction subclass.
   assert(this->traversalMethods);
-  this->traversalMethods->setUp();
+  PRIVATE(this)->methodtable =
+    this->traversalMethods->getMethodTable(PRIVATE(this)->nummethods);
   if (pathlist.getLength() == 0) {
     SoDB::readunlock();
     return;
@@ -869,14 +983,16 @@ SoAction::getPathCode(int & numindices, const int * & indices)
 void
 SoAction::traverse(SoNode * const node)
 {
-  SoType t = node->getTypeId();
-
-  int idx = SoNode::getActionMethodIndex(t);
-  SoActionMethod func = (*this->traversalMethods)[idx];
-
-  // Profiler functionality removed - nodekit elimination
-  func(this, node);
-  // Profiler functionality removed - nodekit elimination
+  const int idx = SoNode::getActionMethodIndex(node->getTypeId());
+
+  if (idx >= PRIVATE(this)->nummethods) {
+    // not applied yet, or the node type was registered after the
+    // table was fetched
+    PRIVATE(this)->methodtable =
+      this->traversalMethods->getMethodTable(PRIVATE(this)->nummethods);
+    assert(idx < PRIVATE(this)->nummethods);
+  }
+  PRIVATE(this)->methodtable[idx](this, node);
 }
 
 /*!
@@ -1008,6 +1124,13 @@ SoAction::hasTerminated(void) const
 /*!
   Returns a pointer to the state of the action instance. The state
   contains the current set of elements used during traversal.
+
+  The state is kept between apply() invocations. When the action is
+  destructed its state is also kept, and handed over to the next
+  action of the same type, with the bottom element of each stack
+  initialized again. Render actions are excluded from this, and it
+  can be turned off by setting the environment variable
+  COIN_NO_STATE_REUSE to "1".
 */
 SoState *
 SoAction::getState(void) const
@@ -1020,11 +1143,20 @@ SoAction::getState(void) const
     thisp->state = NULL;
   }
   if (this->state == NULL) {
-    // cast away constness to set state
-    const_cast<SoAction*>(this)->state =
-      new SoState(const_cast<SoAction*>(this), this->getEnabledElements().getElements());
+    SoAction * action = const_cast<SoAction*>(this);
     SoActionP * thisp = const_cast<SoActionP *>(&PRIVATE(this).get());
-    thisp->prevenabledelementscounter = this->getEnabledElements().getCounter();
+    const int counter = this->getEnabledElements().getCounter();
+    // the type is stored since it can't be looked up in the destructor
+    thisp->statetype = this->getTypeId();
+    // cast away constness to set state
+    action->state = soaction_statepool_get(thisp->statetype, counter);
+    if (action->state) {
+      action->state->reinit(action);
+    }
+    else {
+      action->state = new SoState(action, this->getEnabledElements().getElements());
+    }
+    thisp->prevenabledelementscounter = counter;
   }
   return this->state;
 }
@@ -1039,6 +1171,43 @@ SoAction::getCurPath(void)
   return &this->currentpath;
 }
 
+/*!
+  Sets whether the current path must be kept up to date while the
+  action traverses all children of a group, i.e. when it is applied
+  to a node and not to a path or a path list. Default is \c TRUE.
+
+  When set to \c FALSE, SoChildList::traverse() dispatches directly
+  to the children without pushing them onto the current path, which
+  saves a fair amount of bookkeeping per node for large graphs. Only
+  do this if no node, callback or element used during traversal calls
+  getCurPath() or getCurPathTail(), as these will then only return
+  the part of the path down to the closest path split.
+
+  SoWriteAction does not need the current path, and disables it by
+  default.
+
+  \sa needsCurPath()
+  \since Coin 4.1
+*/
+void
+SoAction::setNeedsCurPath(const SbBool flag)
+{
+  PRIVATE(this)->needscurpath = flag;
+}
+
+/*!
+  Returns whether the current path is kept up to date during
+  traversal of unsplit graphs.
+
+  \sa setNeedsCurPath()
+  \since Coin 4.1
+*/
+SbBool
+SoAction::needsCurPath(void) const
+{
+  return PRIVATE(this)->needscurpath;
+}
+
 /*!
   \COININTERNAL
 */
@@ -63,6 +63,11 @@ public:
   SbBool terminated;
   SbList <SbList<int> *> pathcodearray;
   int prevenabledelementscounter;
+  SoType statetype;
+  // dense action method table, refreshed on apply()
+  const SoActionMethod * methodtable;
+  int nummethods;
+  SbBool needscurpath;
 
   // Profiler functionality removed - nodekit elimination
 }; // SoActionP
@@ -64,6 +64,9 @@
 #include "config.h"
 #endif // HAVE_CONFIG_H
 
+#include <algorithm>
+#include <climits>
+#include <cmath>
 #include <cstdlib>
 #include <cstring>
 #include <memory>
@@ -73,10 +76,14 @@
 #include <Inventor/SbColor.h>
 #include <Inventor/SbPlane.h>
 #include <Inventor/SoFullPath.h>
+#include <Inventor/actions/SoCallbackAction.h>
 #include <Inventor/actions/SoGetBoundingBoxAction.h>
+#include <Inventor/actions/SoGetMatrixAction.h>
+#include <Inventor/actions/SoGetPrimitiveCountAction.h>
 #include <Inventor/actions/SoSearchAction.h>
 #include <Inventor/caches/SoBoundingBoxCache.h>
 #include <Inventor/elements/SoCacheElement.h>
+#include <Inventor/elements/SoCullElement.h>
 #include <Inventor/elements/SoDecimationPercentageElement.h>
 #include <Inventor/elements/SoDecimationTypeElement.h>
 #include <Inventor/elements/SoGLCacheContextElement.h>
@@ -91,6 +98,7 @@
 #include <Inventor/elements/SoProjectionMatrixElement.h>
 #include <Inventor/elements/SoShapeHintsElement.h>
 #include <Inventor/elements/SoShapeStyleElement.h>
+#include <Inventor/elements/SoViewportRegionElement.h>
 #include <Inventor/elements/SoMultiTextureEnabledElement.h>
 #include <Inventor/elements/SoTextureOverrideElement.h>
 #include <Inventor/elements/SoViewVolumeElement.h>
@@ -101,9 +109,14 @@
 #include <Inventor/lists/SoCallbackList.h>
 #include <Inventor/lists/SoEnabledElementsList.h>
 #include <Inventor/lists/SoPathList.h>
+#include <Inventor/misc/SoChildList.h>
 #include <Inventor/misc/SoState.h>
 #include <Inventor/misc/SoGLDriverDatabase.h>
+#include <Inventor/misc/SoRenderStatistics.h>
+#include <Inventor/nodes/SoCamera.h>
 #include <Inventor/nodes/SoGroup.h>
+#include <Inventor/nodes/SoLOD.h>
+#include <Inventor/nodes/SoLevelOfDetail.h>
 #include <Inventor/nodes/SoNode.h>
 #include <Inventor/nodes/SoSeparator.h>
 #include <Inventor/nodes/SoShape.h>
@@ -121,6 +134,9 @@
 #include "glue/glp.h"
 
 #include "rendering/SoGL.h"
+#include "rendering/SoGLResourceManagerP.h"
+#include "rendering/SoLODSelector.h"
+#include "misc/SbHash.h"
 #include "misc/SoEnvironment.h"
 
 // Profiler functionality removed - nodekit elimination
@@ -526,6 +542,34 @@
   second pass.
 */
 
+/*!
+  \enum SoGLRenderAction::LODManagement
+
+  Enumerates the strategies for selecting which child to render
+  under SoLOD and SoLevelOfDetail nodes.
+
+  \sa setLODManagement()
+  \since Coin 4.1
+*/
+
+/*!
+  \var SoGLRenderAction::LODManagement SoGLRenderAction::PER_NODE_LOD
+
+  Each level-of-detail node picks its child on its own, from its
+  SoLOD::range or SoLevelOfDetail::screenArea values. This is the
+  default.
+*/
+
+/*!
+  \var SoGLRenderAction::LODManagement SoGLRenderAction::SCREEN_SPACE_ERROR_LOD
+
+  The level-of-detail nodes in view are managed together, and levels
+  are chosen to keep the total number of primitives within the budget
+  set with setLODTriangleBudget() and setLODFrameTimeBudget(), while
+  keeping the largest projected error in the scene as small as
+  possible.
+*/
+
 // *************************************************************************
 
 class SoGLRenderActionP {
@@ -584,6 +628,78 @@ public:
   SoGLSortedObjectOrderCB * sortedobjectcb;
   void * sortedobjectclosure;
 
+  // The level-of-detail nodes seen during rendering, with the
+  // primitive count and the projected error for each of their
+  // children. A node used more than once in the scene graph has one
+  // record for each path to it, chained from the first. The levels
+  // used in a frame are chosen at the end of the previous frame, from
+  // the nodes which were in view then.
+  class LODRecord : public SoLODSelector::Record {
+  public:
+    uint32_t pathkey;
+    SbUniqueId nodeid;
+    SbBox3f box;
+    uint32_t frame;
+    LODRecord * next;
+  };
+  SoGLRenderAction::LODManagement lodmanagement;
+  SoLODSelector lodselector;
+  int lodtrianglecount;
+  uint32_t lodframe;
+  SbHash<const SoNode *, LODRecord *> lodrecorddict;
+  SbList<const SoNode *> lodnodes;
+  SbList<SoLODSelector::Record *> lodvisible;
+  std::unique_ptr<SoGetBoundingBoxAction> lodbboxaction;
+  std::unique_ptr<SoGetPrimitiveCountAction> lodcountaction;
+
+  LODRecord * getLODRecord(SoNode * lod, const int defaultchild);
+  void updateLODErrors(LODRecord * rec);
+  void selectLODLevels(const SbTime & frametime);
+  void clearLODRecords(SbBool all);
+
+  // For progressive rendering, the scene is split into units, each
+  // holding the paths to the shapes directly below one separator
+  // (level-of-detail nodes are kept whole, since their choice depends
+  // on the camera). Units are rendered as path lists, the largest
+  // projected units first, until the time budget is spent. The next
+  // frame continues with the remaining units, unless the view or the
+  // scene has changed.
+  class ProgressiveUnit {
+  public:
+    SoPathList paths;
+    SbBox3f box;
+    float priority;
+  };
+  SbBool progressive;
+  SbTime progressivebudget;
+  SbBool progressiveframe;
+  SbBool progressivescenechanged;
+  SbBool progressiverestart;
+  int progressivenext;
+  SoNode * progressiveroot;
+  SoPath * progressivecamera;
+  SbViewportRegion progressiveviewport;
+  SbMatrix progressiveview;
+  SbList<ProgressiveUnit *> progressiveunits;
+  SbList<int> progressiveorder;
+  SbList<int> progressivestack;
+  std::unique_ptr<SoNodeSensor> progressivesensor;
+
+  // counted for the last frame
+  SoRenderStatistics framestatistics;
+
+  SbBool getProgressiveView(SbViewVolume & vv, SbMatrix & view) const;
+  SbBool isProgressivePending(void) const;
+  void collectProgressiveUnits(SoNode * root);
+  void sortProgressiveUnits(const SbViewVolume & vv);
+  void renderProgressive(SoNode * node);
+  void clearProgressiveUnits(void);
+  static void progressiveSensorCB(void * closure, SoSensor * sensor);
+  static SoCallbackAction::Response progressiveSeparatorPreCB(void * closure, SoCallbackAction * action, const SoNode * node);
+  static SoCallbackAction::Response progressiveSeparatorPostCB(void * closure, SoCallbackAction * action, const SoNode * node);
+  static SoCallbackAction::Response progressiveShapeCB(void * closure, SoCallbackAction * action, const SoNode * node);
+  static SoCallbackAction::Response progressiveCameraCB(void * closure, SoCallbackAction * action, const SoNode * node);
+
   void setupSortedLayersBlendTextures(const SoState * state);
   void doSortedLayersBlendRendering(const SoState * state, SoNode * node);
   void initSortedLayersBlendRendering(const SoState * state);
@@ -729,6 +845,19 @@ SoGLRenderAction::SoGLRenderAction(const SbViewportRegion & viewportregion)
   PRIVATE(this)->sortedobjectstrategy = BBOX_CENTER;
   PRIVATE(this)->sortedobjectcb = NULL;
   PRIVATE(this)->sortedobjectclosure = NULL;
+
+  PRIVATE(this)->lodmanagement = PER_NODE_LOD;
+  PRIVATE(this)->lodtrianglecount = 0;
+  PRIVATE(this)->lodframe = 0;
+
+  PRIVATE(this)->progressive = FALSE;
+  PRIVATE(this)->progressivebudget = SbTime(1.0 / 30.0);
+  PRIVATE(this)->progressiveframe = FALSE;
+  PRIVATE(this)->progressivescenechanged = TRUE;
+  PRIVATE(this)->progressiverestart = TRUE;
+  PRIVATE(this)->progressivenext = 0;
+  PRIVATE(this)->progressiveroot = NULL;
+  PRIVATE(this)->progressivecamera = NULL;
 }
 
 /*!
@@ -736,6 +865,8 @@ SoGLRenderAction::SoGLRenderAction(const SbViewportRegion & viewportregion)
 */
 SoGLRenderAction::~SoGLRenderAction()
 {
+  PRIVATE(this)->clearLODRecords(TRUE);
+  PRIVATE(this)->clearProgressiveUnits();
 }
 
 /*!
@@ -1087,7 +1218,11 @@ SoGLRenderAction::beginTraversal(SoNode * node)
                               coin_glerror_string(err));
   }
 
+  // evict GL objects not used this frame if the context is over budget
+  const uint32_t contextid = this->getCacheContext();
+  SoGLResourceManagerP::beginFrame(contextid);
   PRIVATE(this)->render(node);
+  SoGLResourceManagerP::endFrame(contextid);
   // GL errors after rendering will be caught in SoNode::GLRenderS().
 }
 
@@ -1637,6 +1772,23 @@ SoGLRenderActionP::isDirectRendering(const SoState * state) const
 void
 SoGLRenderActionP::render(SoNode * node)
 {
+  // render() calls itself when falling back from SORTED_LAYERS_BLEND,
+  // which is still the same frame as far as LOD management goes
+  const SbBool newframe = !this->isrendering;
+  SbTime starttime;
+  SoRenderStatistics framestart;
+  if (newframe) SoRenderStatistics::getThreadTotals(framestart);
+  if (newframe && this->lodmanagement != SoGLRenderAction::PER_NODE_LOD) {
+    this->lodframe++;
+    this->lodvisible.truncate(0);
+    starttime = SbTime::getTimeOfDay();
+  }
+  if (newframe) {
+    this->progressiveframe = this->progressive &&
+      this->action->getWhatAppliedTo() == SoAction::NODE &&
+      !(this->numpasses > 1 && this->internal_multipass) &&
+      this->transparencytype != SoGLRenderAction::SORTED_LAYERS_BLEND;
+  }
   this->isrendering = TRUE;
 
   SoState * state = this->action->getState();
@@ -1696,6 +1848,14 @@ SoGLRenderActionP::render(SoNode * node)
 
   state->pop();
   this->isrendering = FALSE;
+
+  if (newframe && this->lodmanagement != SoGLRenderAction::PER_NODE_LOD) {
+    this->selectLODLevels(SbTime::getTimeOfDay() - starttime);
+  }
+  if (newframe) {
+    SoRenderStatistics::getThreadTotals(this->framestatistics);
+    this->framestatistics -= framestart;
+  }
 }
 
 //
@@ -1786,7 +1946,12 @@ SoGLRenderActionP::renderSingle(SoNode * node)
     return;
   }
 
-  this->action->beginTraversal(node);
+  if (this->progressiveframe) {
+    this->renderProgressive(node);
+  }
+  else {
+    this->action->beginTraversal(node);
+  }
 
   if ((this->transpobjpaths.getLength() || this->sorttranspobjpaths.getLength()) &&
       !this->action->hasTerminated()) {
@@ -1967,6 +2132,665 @@ SoGLRenderAction::getTransparentDelayedObjectRenderType(void) const
   return PRIVATE(this)->transpdelayedrendertype;
 }
 
+/*!
+  Sets how the children of SoLOD and SoLevelOfDetail nodes are
+  chosen. Default is PER_NODE_LOD, where each node makes the choice
+  from its own fields.
+
+  With SCREEN_SPACE_ERROR_LOD, every level-of-detail node traversed
+  by this action registers itself, and the levels are chosen globally
+  to fit within the triangle and frame time budgets. The primitive
+  count of each level is found with SoGetPrimitiveCountAction, and its
+  error is estimated as the projected size of the node's bounding box
+  divided by the square root of the primitive count, i.e. the edge
+  length of an average primitive in pixels. The levels are then chosen
+  so that the largest error in view is as small as the budget
+  permits. A node used more than once in the scene graph is counted
+  and chosen separately for each path to it.
+
+  The levels for a frame are chosen at the end of the previous frame,
+  so the budget applies to the nodes which were in view then. Nodes
+  seen for the first time use the child they would have chosen in
+  PER_NODE_LOD mode. Since the choice depends on the rest of the
+  scene, render caches above level-of-detail nodes are invalidated in
+  this mode.
+
+  \sa setLODTriangleBudget(), setLODFrameTimeBudget(), setLODHysteresis()
+  \since Coin 4.1
+*/
+void
+SoGLRenderAction::setLODManagement(const LODManagement mode)
+{
+  if (mode != PRIVATE(this)->lodmanagement) {
+    PRIVATE(this)->lodmanagement = mode;
+    PRIVATE(this)->lodselector.resetAdaptiveBudget();
+    PRIVATE(this)->clearLODRecords(TRUE);
+  }
+}
+
+/*!
+  Returns the current LOD management mode.
+
+  \sa setLODManagement()
+  \since Coin 4.1
+*/
+SoGLRenderAction::LODManagement
+SoGLRenderAction::getLODManagement(void) const
+{
+  return PRIVATE(this)->lodmanagement;
+}
+
+/*!
+  Sets the maximum number of primitives to render from the
+  level-of-detail nodes in view in SCREEN_SPACE_ERROR_LOD mode. Lines
+  and points count as one triangle each. A value of 0 (the default)
+  means no limit.
+
+  If the coarsest levels of all nodes together exceed the budget, the
+  coarsest levels are used.
+
+  \sa setLODManagement(), getLODTriangleCount()
+  \since Coin 4.1
+*/
+void
+SoGLRenderAction::setLODTriangleBudget(const int numtriangles)
+{
+  PRIVATE(this)->lodselector.setTriangleBudget(numtriangles);
+}
+
+/*!
+  Returns the triangle budget for SCREEN_SPACE_ERROR_LOD mode.
+
+  \sa setLODTriangleBudget()
+  \since Coin 4.1
+*/
+int
+SoGLRenderAction::getLODTriangleBudget(void) const
+{
+  return PRIVATE(this)->lodselector.getTriangleBudget();
+}
+
+/*!
+  Sets a target time for rendering a frame in SCREEN_SPACE_ERROR_LOD
+  mode. After each frame, the number of primitives allowed from the
+  level-of-detail nodes is scaled by the ratio between the target and
+  the time the frame took, so detail is added when rendering is faster
+  than the target and removed when it is slower. The adjustment is
+  damped to avoid oscillation. If a triangle budget is also set, the
+  smaller of the two is used.
+
+  The time measured is the time spent in this action. Since OpenGL
+  rendering is asynchronous, applications which want the time spent
+  by the GPU included should call glFinish() from a pass callback or
+  at the end of a post-render callback.
+
+  A zero time (the default) disables the frame time budget.
+
+  \sa setLODTriangleBudget()
+  \since Coin 4.1
+*/
+void
+SoGLRenderAction::setLODFrameTimeBudget(const SbTime & frametime)
+{
+  PRIVATE(this)->lodselector.setFrameTimeBudget(frametime);
+}
+
+/*!
+  Returns the frame time budget for SCREEN_SPACE_ERROR_LOD mode.
+
+  \sa setLODFrameTimeBudget()
+  \since Coin 4.1
+*/
+SbTime
+SoGLRenderAction::getLODFrameTimeBudget(void) const
+{
+  return PRIVATE(this)->lodselector.getFrameTimeBudget();
+}
+
+/*!
+  Sets the hysteresis used in SCREEN_SPACE_ERROR_LOD mode, as a
+  fraction of the error threshold. A node keeps its current level
+  until the threshold has moved by more than this fraction past the
+  point where another level would have been chosen, which avoids
+  nodes popping back and forth between two levels when the camera or
+  the budget changes slightly. Default value is 0.15. The value is
+  clamped to [0, 0.9].
+
+  \since Coin 4.1
+*/
+void
+SoGLRenderAction::setLODHysteresis(const float fraction)
+{
+  PRIVATE(this)->lodselector.setHysteresis(fraction);
+}
+
+/*!
+  Returns the hysteresis used in SCREEN_SPACE_ERROR_LOD mode.
+
+  \sa setLODHysteresis()
+  \since Coin 4.1
+*/
+float
+SoGLRenderAction::getLODHysteresis(void) const
+{
+  return PRIVATE(this)->lodselector.getHysteresis();
+}
+
+/*!
+  Returns the total number of primitives in the levels chosen at the
+  end of the last frame in SCREEN_SPACE_ERROR_LOD mode, i.e. what the
+  level-of-detail nodes in view will render in the next frame.
+
+  \since Coin 4.1
+*/
+int
+SoGLRenderAction::getLODTriangleCount(void) const
+{
+  return PRIVATE(this)->lodtrianglecount;
+}
+
+/*!
+  \COININTERNAL
+
+  Called by level-of-detail nodes during rendering, with the child
+  they would have picked themselves. Returns the child to render.
+*/
+int
+SoGLRenderAction::selectLODChild(SoNode * lod, const int defaultchild)
+{
+  if (PRIVATE(this)->lodmanagement == PER_NODE_LOD ||
+      !PRIVATE(this)->isrendering) return defaultchild;
+
+  const SoChildList * children = lod->getChildren();
+  const int numchildren = children ? children->getLength() : 0;
+  if (numchildren < 2) return defaultchild;
+
+  // the choice depends on every other level-of-detail node in view
+  SoCacheElement::invalidate(this->state);
+
+  SoGLRenderActionP::LODRecord * rec = PRIVATE(this)->getLODRecord(lod, defaultchild);
+  if (rec->frame != PRIVATE(this)->lodframe) {
+    rec->frame = PRIVATE(this)->lodframe;
+    PRIVATE(this)->updateLODErrors(rec);
+    PRIVATE(this)->lodvisible.append(rec);
+  }
+  return SbMin(rec->level, numchildren - 1);
+}
+
+// Returns the record for a level-of-detail node on the current path,
+// (re)computing its bounding box and the primitive count of each child
+// if the node is new or has changed.
+SoGLRenderActionP::LODRecord *
+SoGLRenderActionP::getLODRecord(SoNode * lod, const int defaultchild)
+{
+  // instances are told apart by the child indices on the path to
+  // them, which are the same in every pass and for delayed paths
+  const SoPath * curpath = this->action->getCurPath();
+  uint32_t pathkey = 2166136261u;
+  for (int i = 1; i < curpath->getLength(); i++) {
+    pathkey = (pathkey ^ uint32_t(curpath->getIndex(i))) * 16777619u;
+  }
+
+  LODRecord * first = NULL;
+  this->lodrecorddict.get(lod, first);
+  LODRecord * rec = first;
+  while (rec && rec->pathkey != pathkey) rec = rec->next;
+  if (rec == NULL) {
+    rec = new LODRecord;
+    rec->pathkey = pathkey;
+    rec->nodeid = 0;
+    rec->level = defaultchild;
+    rec->frame = 0;
+    rec->next = NULL;
+    if (first) {
+      LODRecord * last = first;
+      while (last->next) last = last->next;
+      last->next = rec;
+    }
+    else {
+      this->lodrecorddict.put(lod, rec);
+      this->lodnodes.append(lod);
+    }
+  }
+  if (rec->nodeid == lod->getNodeId()) return rec;
+
+  SoState * state = this->action->getState();
+  const SbViewportRegion & vp = SoViewportRegionElement::get(state);
+  if (!this->lodbboxaction) {
+    this->lodbboxaction.reset(new SoGetBoundingBoxAction(vp));
+    this->lodcountaction.reset(new SoGetPrimitiveCountAction(vp));
+  }
+
+  // apply on the current path, so that coordinates and other state
+  // from above the node are used, resetting the transformation to
+  // get the box in the local coordinate system
+  SoPath * path = this->action->getCurPath()->copy();
+  path->ref();
+  this->lodbboxaction->setViewportRegion(vp);
+  this->lodbboxaction->setResetPath(path);
+  this->lodbboxaction->apply(path);
+  rec->box = this->lodbboxaction->getBoundingBox();
+
+  const int numchildren = lod->getChildren()->getLength();
+  rec->counts.truncate(0);
+  for (int i = 0; i < numchildren; i++) {
+    path->append(i);
+    this->lodcountaction->apply(path);
+    path->truncate(path->getLength() - 1);
+    rec->counts.append(this->lodcountaction->getTriangleCount() +
+                       this->lodcountaction->getLineCount() +
+                       this->lodcountaction->getPointCount());
+  }
+  path->unref();
+
+  rec->nodeid = lod->getNodeId();
+  rec->level = SbMin(rec->level, numchildren - 1);
+  return rec;
+}
+
+// Estimates the projected error of each level as the screen size of
+// an average primitive, and makes the errors nondecreasing from the
+// finest to the coarsest level.
+void
+SoGLRenderActionP::updateLODErrors(LODRecord * rec)
+{
+  SoState * state = this->action->getState();
+  float diameter = 0.0f;
+  if (!rec->box.isEmpty() && !SoCullElement::cullBox(state, rec->box)) {
+    SbVec2s size;
+    SoShape::getScreenSize(state, rec->box, size);
+    diameter = SbVec2f(float(size[0]), float(size[1])).length();
+  }
+  SoLODSelector::setErrors(rec, diameter);
+}
+
+// Chooses the levels for the next frame.
+void
+SoGLRenderActionP::selectLODLevels(const SbTime & frametime)
+{
+  this->lodtrianglecount = this->lodselector.selectLevels(this->lodvisible, frametime);
+  this->clearLODRecords(FALSE);
+}
+
+// Deletes the records of nodes which have not been in view for a
+// while, or all records.
+void
+SoGLRenderActionP::clearLODRecords(SbBool all)
+{
+  int i = 0;
+  while (i < this->lodnodes.getLength()) {
+    const SoNode * node = this->lodnodes[i];
+    LODRecord * first = NULL;
+    this->lodrecorddict.get(node, first);
+    LODRecord * keep = NULL;
+    LODRecord * last = NULL;
+    LODRecord * rec = first;
+    while (rec) {
+      LODRecord * next = rec->next;
+      if (all || this->lodframe - rec->frame > 100) {
+        delete rec;
+      }
+      else {
+        rec->next = NULL;
+        if (last) last->next = rec;
+        else keep = rec;
+        last = rec;
+      }
+      rec = next;
+    }
+    if (keep) {
+      if (keep != first) this->lodrecorddict.put(node, keep);
+      i++;
+    }
+    else {
+      this->lodrecorddict.erase(node);
+      this->lodnodes.removeFast(i);
+    }
+  }
+  if (all) this->lodvisible.truncate(0);
+}
+
+/*!
+  Enables or disables progressive rendering. Default is \c FALSE.
+
+  In progressive mode, the scene graph is split into units, one for
+  the shapes directly below each separator, and the units are rendered
+  in order of decreasing projected bounding box size, i.e. the nearest
+  and largest parts of the scene first. Rendering stops when the time
+  budget set with setProgressiveTimeBudget() is spent. If neither the
+  view nor the scene graph has changed when the action is applied
+  again, rendering continues with the remaining units on top of what
+  is already in the color and depth buffers, until the image is
+  complete. While the camera moves, each frame thus shows as much of
+  the scene as fits in the budget, and the image is completed over the
+  following frames once the camera stops.
+
+  Since continued frames draw on top of the previous ones, the buffers
+  must not be cleared between them. Use isProgressiveRenderingPending()
+  to decide whether to clear and whether to schedule another
+  redraw. SoRenderManager does this automatically when it is single
+  buffered, or when the application has told it that the back buffer
+  is preserved between frames with
+  SoRenderManager::setBackBufferPreserved(). Otherwise it renders each
+  frame completely.
+
+  Progressive rendering only applies when the action is applied to a
+  node, and not with multipass or SORTED_LAYERS_BLEND rendering. Units
+  are rendered as path lists, so render caches are not used, and
+  transparent objects are only sorted within each frame. The action
+  keeps references to the scene graph while progressive rendering is
+  enabled.
+
+  \sa setAbortCallback()
+  \since Coin 4.1
+*/
+void
+SoGLRenderAction::setProgressiveRendering(const SbBool onoff)
+{
+  PRIVATE(this)->progressive = onoff;
+  if (!onoff) PRIVATE(this)->clearProgressiveUnits();
+}
+
+/*!
+  Returns whether progressive rendering is enabled.
+
+  \sa setProgressiveRendering()
+  \since Coin 4.1
+*/
+SbBool
+SoGLRenderAction::isProgressiveRendering(void) const
+{
+  return PRIVATE(this)->progressive;
+}
+
+/*!
+  Sets the time to spend rendering each frame in progressive
+  mode. Default is 1/30 second. At least one unit is rendered every
+  frame, so the image is always completed eventually.
+
+  \sa setProgressiveRendering()
+  \since Coin 4.1
+*/
+void
+SoGLRenderAction::setProgressiveTimeBudget(const SbTime & budget)
+{
+  PRIVATE(this)->progressivebudget = budget;
+}
+
+/*!
+  Returns the time budget for progressive rendering.
+
+  \sa setProgressiveTimeBudget()
+  \since Coin 4.1
+*/
+SbTime
+SoGLRenderAction::getProgressiveTimeBudget(void) const
+{
+  return PRIVATE(this)->progressivebudget;
+}
+
+/*!
+  Makes the next progressive frame start on a new image. Changes to
+  the scene graph and to the camera in it are detected automatically,
+  so this is only needed when something else has invalidated the
+  contents of the buffers.
+
+  \sa setProgressiveRendering()
+  \since Coin 4.1
+*/
+void
+SoGLRenderAction::restartProgressiveRendering(void)
+{
+  PRIVATE(this)->progressiverestart = TRUE;
+}
+
+/*!
+  Returns \c TRUE if progressive rendering has been stopped by the
+  time budget before the image was complete, and the next application
+  of the action will continue it. The buffers should then be left as
+  they are, and a new redraw scheduled.
+
+  \sa setProgressiveRendering()
+  \since Coin 4.1
+*/
+SbBool
+SoGLRenderAction::isProgressiveRenderingPending(void) const
+{
+  return PRIVATE(this)->isProgressivePending();
+}
+
+/*!
+  Returns the draw calls, triangles, state changes and cache use
+  counted while rendering the last frame, i.e. during the last
+  application of this action. The counters are always enabled. See
+  SoRenderStatistics for what is counted.
+
+  \since Coin 4.1
+*/
+const SoRenderStatistics &
+SoGLRenderAction::getRenderStatistics(void) const
+{
+  return PRIVATE(this)->framestatistics;
+}
+
+// Finds the view volume of the first camera in the scene, and
+// returns the matrix used to detect view changes.
+SbBool
+SoGLRenderActionP::getProgressiveView(SbViewVolume & vv, SbMatrix & view) const
+{
+  if (this->progressivecamera == NULL) return FALSE;
+  SoGetMatrixAction ma(this->viewport);
+  ma.apply(this->progressivecamera);
+  SoCamera * camera = coin_assert_cast<SoCamera *>(this->progressivecamera->getTail());
+  SbViewportRegion resultvp;
+  vv = camera->getViewVolume(this->viewport, resultvp, ma.getMatrix());
+  view = vv.getMatrix();
+  return TRUE;
+}
+
+SbBool
+SoGLRenderActionP::isProgressivePending(void) const
+{
+  if (!this->progressive || this->progressiverestart ||
+      this->progressivescenechanged ||
+      this->progressivenext >= this->progressiveorder.getLength() ||
+      !(this->progressiveviewport == this->viewport)) return FALSE;
+  SbViewVolume vv;
+  SbMatrix view;
+  return !this->getProgressiveView(vv, view) || view == this->progressiveview;
+}
+
+// Renders units until the time budget is spent, starting over if the
+// previous image can't be continued.
+void
+SoGLRenderActionP::renderProgressive(SoNode * node)
+{
+  const SbTime starttime = SbTime::getTimeOfDay();
+
+  if (node != this->progressiveroot || this->progressivescenechanged) {
+    this->collectProgressiveUnits(node);
+  }
+  if (!this->isProgressivePending()) {
+    SbViewVolume vv;
+    if (!this->getProgressiveView(vv, this->progressiveview)) {
+      this->progressiveview.makeIdentity();
+    }
+    this->sortProgressiveUnits(vv);
+    this->progressiveviewport = this->viewport;
+    this->progressivenext = 0;
+    this->progressiverestart = FALSE;
+  }
+
+  // render in exponentially growing batches, to check the time often
+  // without a path list traversal for every unit
+  const int numunits = this->progressiveorder.getLength();
+  int batchsize = 1;
+  while (this->progressivenext < numunits) {
+    SoPathList paths;
+    for (int i = 0; i < batchsize && this->progressivenext < numunits; i++) {
+      const ProgressiveUnit * unit =
+        this->progressiveunits[this->progressiveorder[this->progressivenext++]];
+      for (int j = 0; j < unit->paths.getLength(); j++) {
+        paths.append(unit->paths[j]);
+      }
+    }
+    this->action->apply(paths, FALSE);
+    if (this->action->hasTerminated()) {
+      // aborted in the middle of a batch, start over next time
+      this->progressiverestart = TRUE;
+      break;
+    }
+    if (SbTime::getTimeOfDay() - starttime >= this->progressivebudget) break;
+    batchsize = SbMin(batchsize * 2, 256);
+  }
+}
+
+// Splits the scene graph into units, and finds their bounding boxes.
+void
+SoGLRenderActionP::collectProgressiveUnits(SoNode * root)
+{
+  this->clearProgressiveUnits();
+
+  // the stack holds the unit index of each separator above the
+  // current node, or -1 if no shapes have been found below it yet
+  this->progressivestack.truncate(0);
+  this->progressivestack.append(-1);
+
+  SoCallbackAction cba(this->viewport);
+  cba.addPreCallback(SoSeparator::getClassTypeId(), progressiveSeparatorPreCB, this);
+  cba.addPostCallback(SoSeparator::getClassTypeId(), progressiveSeparatorPostCB, this);
+  cba.addPreCallback(SoShape::getClassTypeId(), progressiveShapeCB, this);
+  cba.addPreCallback(SoLOD::getClassTypeId(), progressiveShapeCB, this);
+  cba.addPreCallback(SoLevelOfDetail::getClassTypeId(), progressiveShapeCB, this);
+  cba.addPreCallback(SoCamera::getClassTypeId(), progressiveCameraCB, this);
+  cba.apply(root);
+
+  SoGetBoundingBoxAction bba(this->viewport);
+  for (int i = 0; i < this->progressiveunits.getLength(); i++) {
+    ProgressiveUnit * unit = this->progressiveunits[i];
+    bba.apply(unit->paths, TRUE);
+    unit->box = bba.getBoundingBox();
+  }
+
+  if (!this->progressivesensor) {
+    this->progressivesensor.reset(new SoNodeSensor(progressiveSensorCB, this));
+    this->progressivesensor->setPriority(0);
+  }
+  this->progressivesensor->attach(root);
+  this->progressiveroot = root;
+  this->progressivescenechanged = FALSE;
+  this->progressiverestart = TRUE;
+}
+
+// Orders the units by decreasing projected size. Units outside the
+// view volume go last, and units of equal size stay in traversal
+// order.
+void
+SoGLRenderActionP::sortProgressiveUnits(const SbViewVolume & vv)
+{
+  const SbBool hasview = this->progressivecamera != NULL;
+  this->progressiveorder.truncate(0);
+  for (int i = 0; i < this->progressiveunits.getLength(); i++) {
+    ProgressiveUnit * unit = this->progressiveunits[i];
+    unit->priority = 0.0f;
+    if (hasview && !unit->box.isEmpty()) {
+      if (vv.intersect(unit->box)) {
+        const SbVec2f size = vv.projectBox(unit->box);
+        unit->priority = size[0] * size[1];
+      }
+      else {
+        unit->priority = -1.0f;
+      }
+    }
+    this->progressiveorder.append(i);
+  }
+  int * order = const_cast<int *>(this->progressiveorder.getArrayPtr());
+  std::stable_sort(order, order + this->progressiveorder.getLength(),
+                   [this](const int a, const int b) {
+                     return this->progressiveunits[a]->priority >
+                       this->progressiveunits[b]->priority;
+                   });
+}
+
+void
+SoGLRenderActionP::clearProgressiveUnits(void)
+{
+  for (int i = 0; i < this->progressiveunits.getLength(); i++) {
+    delete this->progressiveunits[i];
+  }
+  this->progressiveunits.truncate(0);
+  this->progressiveorder.truncate(0);
+  this->progressivenext = 0;
+  if (this->progressivecamera) {
+    this->progressivecamera->unref();
+    this->progressivecamera = NULL;
+  }
+  if (this->progressivesensor) this->progressivesensor->detach();
+  this->progressiveroot = NULL;
+  this->progressivescenechanged = TRUE;
+}
+
+// Immediate sensor on the scene graph. Camera changes are detected
+// from the view volume instead, since SoRenderManager updates the
+// clipping planes on every redraw.
+void
+SoGLRenderActionP::progressiveSensorCB(void * closure, SoSensor * sensor)
+{
+  SoGLRenderActionP * thisp = static_cast<SoGLRenderActionP *>(closure);
+  SoNode * trigger = static_cast<SoNodeSensor *>(sensor)->getTriggerNode();
+  if (trigger == NULL || !trigger->isOfType(SoCamera::getClassTypeId())) {
+    thisp->progressivescenechanged = TRUE;
+  }
+}
+
+SoCallbackAction::Response
+SoGLRenderActionP::progressiveSeparatorPreCB(void * closure, SoCallbackAction * COIN_UNUSED_ARG(action),
+                                             const SoNode * COIN_UNUSED_ARG(node))
+{
+  SoGLRenderActionP * thisp = static_cast<SoGLRenderActionP *>(closure);
+  thisp->progressivestack.push(-1);
+  return SoCallbackAction::CONTINUE;
+}
+
+SoCallbackAction::Response
+SoGLRenderActionP::progressiveSeparatorPostCB(void * closure, SoCallbackAction * COIN_UNUSED_ARG(action),
+                                              const SoNode * COIN_UNUSED_ARG(node))
+{
+  SoGLRenderActionP * thisp = static_cast<SoGLRenderActionP *>(closure);
+  (void) thisp->progressivestack.pop();
+  return SoCallbackAction::CONTINUE;
+}
+
+SoCallbackAction::Response
+SoGLRenderActionP::progressiveShapeCB(void * closure, SoCallbackAction * action,
+                                      const SoNode * node)
+{
+  SoGLRenderActionP * thisp = static_cast<SoGLRenderActionP *>(closure);
+  SbList<int> & stack = thisp->progressivestack;
+  const int top = stack.getLength() - 1;
+  if (stack[top] < 0) {
+    stack[top] = thisp->progressiveunits.getLength();
+    thisp->progressiveunits.append(new ProgressiveUnit);
+  }
+  thisp->progressiveunits[stack[top]]->paths.append(action->getCurPath()->copy());
+
+  // the child of a level-of-detail node is chosen when rendering
+  if (!node->isOfType(SoShape::getClassTypeId())) return SoCallbackAction::PRUNE;
+  return SoCallbackAction::CONTINUE;
+}
+
+SoCallbackAction::Response
+SoGLRenderActionP::progressiveCameraCB(void * closure, SoCallbackAction * action,
+                                       const SoNode * COIN_UNUSED_ARG(node))
+{
+  SoGLRenderActionP * thisp = static_cast<SoGLRenderActionP *>(closure);
+  if (thisp->progressivecamera == NULL) {
+    thisp->progressivecamera = action->getCurPath()->copy();
+    thisp->progressivecamera->ref();
+  }
+  return SoCallbackAction::CONTINUE;
+}
+
 void
 SoGLRenderActionP::doSortedLayersBlendRendering(const SoState * state, SoNode * node)
 {
@@ -61,6 +61,17 @@
   parts of scene graphs, should be very quick on successive runs for
   "static" parts of the scene.
 
+  An action instance which is applied to the same scene over and over
+  again can enable setSubgraphCaching(). SoSeparator nodes with
+  SoSeparator::boundingBoxCaching set to \c AUTO will then always cache
+  their bounding boxes, and the action keeps the result for the root
+  it was applied to. Since caches are invalidated along the notification path
+  when a node changes, a new application only traverses the modified
+  subgraphs. This pays off for scenes which are mostly unchanged
+  between applications. When some node changes every time, the extra
+  caches along the modified path can make it slower than a plain
+  traversal.
+
   Note that the algorithm used is not guaranteed to always give an
   exact bounding box: it combines bounding boxes in pairs and extends
   one of them to contain the other. Since the boxes need not be
@@ -81,7 +92,9 @@
 
 #include <Inventor/actions/SoGetBoundingBoxAction.h>
 
+#include <Inventor/caches/SoBoundingBoxCache.h>
 #include <Inventor/elements/SoBBoxModelMatrixElement.h>
+#include <Inventor/elements/SoCacheElement.h>
 #include <Inventor/elements/SoLocalBBoxMatrixElement.h>
 #include <Inventor/elements/SoViewingMatrixElement.h>
 #include <Inventor/elements/SoViewportRegionElement.h>
@@ -220,8 +233,32 @@
 
 class SoGetBoundingBoxActionP {
 public:
+  SoGetBoundingBoxActionP(void)
+    : rootcache(NULL),
+      rootnode(NULL),
+      rootid(0)
+  {
+  }
+  ~SoGetBoundingBoxActionP() {
+    this->clearRootCache();
+  }
+
+  void clearRootCache(void) {
+    if (this->rootcache) this->rootcache->unref();
+    this->rootcache = NULL;
+    this->rootnode = NULL;
+  }
+  void traverseCached(SoGetBoundingBoxAction * action, SoNode * root);
+
+  // The result for the last root the action was applied to. Only
+  // used when subgraph caching is enabled.
+  SoBoundingBoxCache * rootcache;
+  const SoNode * rootnode;
+  SbUniqueId rootid;
 };
 
+#define PRIVATE(obj) ((obj)->pimpl)
+
 SO_ACTION_SOURCE(SoGetBoundingBoxAction);
 
 
@@ -377,6 +414,44 @@ SoGetBoundingBoxAction::isInCameraSpace(void) const
   return (this->flags & SoGetBoundingBoxAction::CAMERA_SPACE) != 0;
 }
 
+/*!
+  Sets whether subgraph results should be kept between applications
+  of this action. When enabled, SoSeparator nodes with
+  SoSeparator::boundingBoxCaching set to \c AUTO cache their bounding
+  boxes without falling back to traversal when the cache is often
+  invalidated, and the result for the root node is kept until a node
+  below it changes. Separators with caching \c OFF are still
+  traversed whenever the root result is invalid.
+
+  This is useful for action instances which are repeatedly applied to
+  the same, mostly static, scene graph. The caches are not used when
+  calculating in camera space or with a reset path.
+
+  Default value is \c FALSE.
+
+  \sa isSubgraphCaching()
+*/
+void
+SoGetBoundingBoxAction::setSubgraphCaching(const SbBool onoff)
+{
+  if (onoff) this->flags |= SoGetBoundingBoxAction::SUBGRAPH_CACHING;
+  else {
+    this->flags &= ~SoGetBoundingBoxAction::SUBGRAPH_CACHING;
+    PRIVATE(this)->clearRootCache();
+  }
+}
+
+/*!
+  Returns whether subgraph results are kept between applications.
+
+  \sa setSubgraphCaching()
+*/
+SbBool
+SoGetBoundingBoxAction::isSubgraphCaching(void) const
+{
+  return (this->flags & SoGetBoundingBoxAction::SUBGRAPH_CACHING) != 0;
+}
+
 /*!
   Forces the computed bounding box to be reset and the transformation
   to be identity before or after the tail node of \a path, depending
@@ -599,5 +674,56 @@ SoGetBoundingBoxAction::beginTraversal(SoNode * node)
   this->bbox.makeEmpty();
 
   SoViewportRegionElement::set(this->getState(), this->vpregion);
-  inherited::beginTraversal(node);
+  if (this->isSubgraphCaching() &&
+      this->getWhatAppliedTo() == SoAction::NODE &&
+      !this->isInCameraSpace() && !this->isResetPath()) {
+    PRIVATE(this)->traverseCached(this, node);
+  }
+  else {
+    inherited::beginTraversal(node);
+  }
 }
+
+// Reuses the result from the previous traversal if nothing below
+// root has changed since then. Any notification below the root gives
+// it a new node id, and the cache tracks the elements the result
+// depends on (like the viewport region).
+void
+SoGetBoundingBoxActionP::traverseCached(SoGetBoundingBoxAction * action,
+                                        SoNode * root)
+{
+  SoState * state = action->getState();
+  if (this->rootcache && this->rootnode == root &&
+      this->rootid == root->getNodeId() &&
+      this->rootcache->isValid(state)) {
+    action->getXfBoundingBox() = this->rootcache->getBox();
+    if (this->rootcache->isCenterSet()) {
+      action->setCenter(this->rootcache->getCenter(), FALSE);
+    }
+    return;
+  }
+
+  this->clearRootCache();
+  // read the id before traversing, in case a node is modified during
+  // the traversal
+  const SbUniqueId id = root->getNodeId();
+
+  SbBool storedinvalid = SoCacheElement::setInvalid(FALSE);
+  state->push();
+  SoBoundingBoxCache * cache = new SoBoundingBoxCache(state);
+  cache->ref();
+  SoCacheElement::set(state, cache);
+
+  action->traverse(root);
+
+  cache->set(action->getXfBoundingBox(), action->isCenterSet(),
+             action->getCenter());
+  state->pop();
+  SoCacheElement::setInvalid(storedinvalid);
+
+  this->rootcache = cache;
+  this->rootnode = root;
+  this->rootid = id;
+}
+
+#undef PRIVATE
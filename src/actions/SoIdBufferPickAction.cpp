@@ -0,0 +1,783 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+
+/*!
+  \class SoIdBufferPickAction SoIdBufferPickAction.h Inventor/actions/SoIdBufferPickAction.h
+  \brief The SoIdBufferPickAction class picks by looking up primitive identifiers in an offscreen buffer.
+
+  \ingroup coin_actions
+
+  When applied to a scene graph, the action renders every pickable
+  primitive of the scene into an offscreen buffer, using a unique
+  24-bit identifier as its color. Subsequent point, rectangle and
+  lasso queries are then answered by reading the identifiers back
+  from the buffer, which makes them independent of scene
+  complexity. Only primitives that are actually visible at a pixel
+  are reported, which is what one usually wants for hover
+  highlighting and for selecting visible geometry within an area.
+
+  The buffer is only rendered again when the scene graph, the
+  viewport region or the root node of the traversal has changed
+  since the last application, so it is cheap to apply the action for
+  every mouse move event. Changes that are not notified through the
+  scene graph (e.g. modified vertex data accessed through a pointer)
+  can be forced through with invalidate().
+
+  Identifiers are assigned in traversal order, with consecutive
+  values for the primitives (triangles, line segments and points) of
+  each shape. The value 0 is used for the background. Shapes with
+  the SoPickStyle::UNPICKABLE pick style are neither drawn nor
+  assigned identifiers.
+
+  \code
+  SoIdBufferPickAction * idaction = new SoIdBufferPickAction(viewportregion);
+  idaction->apply(root);
+
+  const int32_t id = idaction->pickPoint(mouseposition);
+  if (id != 0) {
+    const SoPath * path = idaction->getPath(id);
+    const int primitive = idaction->getPrimitiveIndex(id);
+    // ...
+  }
+  \endcode
+
+  Only OpenGL 1.1 functionality is used when rendering the buffer, so
+  the action also works with software renderers such as OSMesa. If
+  the viewport region is larger than what the offscreen renderer can
+  handle in one piece, the buffer is rendered at a lower resolution
+  and query coordinates are scaled accordingly.
+
+  The action requires a color buffer with at least 8 bits per
+  channel. Scenes with more than 16777215 primitives get the excess
+  primitives drawn as occluders without identifiers.
+
+  \sa SoRayPickAction, SoExtSelection, SoLocateHighlight
+  \since Coin 4.1
+*/
+
+#include <Inventor/actions/SoIdBufferPickAction.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "glue/glp.h"
+#include <Inventor/SbMatrix.h>
+#include <Inventor/SbVec2f.h>
+#include <Inventor/SbViewVolume.h>
+#include <Inventor/SoOffscreenRenderer.h>
+#include <Inventor/SoPath.h>
+#include <Inventor/SoPrimitiveVertex.h>
+#include <Inventor/actions/SoCallbackAction.h>
+#include <Inventor/actions/SoGLRenderAction.h>
+#include <Inventor/elements/SoModelMatrixElement.h>
+#include <Inventor/elements/SoPickStyleElement.h>
+#include <Inventor/elements/SoShapeHintsElement.h>
+#include <Inventor/elements/SoViewVolumeElement.h>
+#include <Inventor/elements/SoViewportRegionElement.h>
+#include <Inventor/errors/SoDebugError.h>
+#include <Inventor/misc/SoState.h>
+#include <Inventor/nodes/SoCallback.h>
+#include <Inventor/nodes/SoShape.h>
+#include <Inventor/system/gl.h>
+
+#include "actions/SoSubActionP.h"
+#include "coindefs.h" // COIN_UNUSED_ARG
+
+// *************************************************************************
+
+// Largest identifier which fits in a 24-bit RGB color.
+static const int32_t SOIDBUFFER_MAXID = 0xffffff;
+
+class SoIdBufferPickActionP {
+public:
+  SoIdBufferPickActionP(void)
+    : renderer(NULL), cbaction(NULL), cbnode(NULL),
+      root(NULL), rootid(0), valid(FALSE), numids(1),
+      overflow(FALSE), openprimitive(GL_NONE), lastfound(0)
+  {
+    this->scale[0] = this->scale[1] = 1.0f;
+  }
+
+  struct Object {
+    SoPath * path;
+    int32_t firstid;
+  };
+
+  SbViewportRegion viewport;
+  SbViewportRegion renderedviewport;
+  SoOffscreenRenderer * renderer;
+  SoCallbackAction * cbaction;
+  SoCallback * cbnode;
+
+  // The root is only used for comparison, together with its node id,
+  // and is therefore not referenced.
+  SoNode * root;
+  SbUniqueId rootid;
+  SbBool valid;
+
+  SbVec2s buffersize;
+  float scale[2];
+  std::vector<uint32_t> ids;
+  SbList<Object> objects;
+  int32_t numids;
+  SbBool overflow;
+  GLenum openprimitive;
+  mutable int lastfound;
+
+  void render(SoNode * node);
+  void clearObjects(void);
+  int findObject(const int32_t id) const;
+
+  SbBool toBuffer(const SbVec2s & pos, int & x, int & y) const;
+  void mark(const int x, const int y, unsigned char * bits) const;
+  void collect(const unsigned char * bits, SbList<int32_t> & ids) const;
+
+  uint32_t nextId(void);
+  void beginPrimitive(const GLenum mode);
+  void endPrimitive(void);
+
+  static void renderCB(void * closure, SoAction * action);
+  static SoCallbackAction::Response preShapeCB(void * closure,
+                                               SoCallbackAction * action,
+                                               const SoNode * node);
+  static SoCallbackAction::Response postShapeCB(void * closure,
+                                                SoCallbackAction * action,
+                                                const SoNode * node);
+  static void triangleCB(void * closure, SoCallbackAction * action,
+                         const SoPrimitiveVertex * v1,
+                         const SoPrimitiveVertex * v2,
+                         const SoPrimitiveVertex * v3);
+  static void lineSegmentCB(void * closure, SoCallbackAction * action,
+                            const SoPrimitiveVertex * v1,
+                            const SoPrimitiveVertex * v2);
+  static void pointCB(void * closure, SoCallbackAction * action,
+                      const SoPrimitiveVertex * v);
+};
+
+#define PRIVATE(obj) ((obj)->pimpl)
+
+// *************************************************************************
+
+SO_ACTION_SOURCE(SoIdBufferPickAction);
+
+/*!
+  \copybrief SoAction::initClass(void)
+*/
+void
+SoIdBufferPickAction::initClass(void)
+{
+  SO_ACTION_INTERNAL_INIT_CLASS(SoIdBufferPickAction, SoAction);
+
+  SO_ENABLE(SoIdBufferPickAction, SoViewportRegionElement);
+}
+
+/*!
+  Constructor. Queries will be made in the pixel coordinate system of
+  \a viewportregion.
+*/
+SoIdBufferPickAction::SoIdBufferPickAction(const SbViewportRegion & viewportregion)
+{
+  SO_ACTION_CONSTRUCTOR(SoIdBufferPickAction);
+
+  PRIVATE(this)->viewport = viewportregion;
+}
+
+/*!
+  Destructor.
+*/
+SoIdBufferPickAction::~SoIdBufferPickAction(void)
+{
+  PRIVATE(this)->clearObjects();
+  if (PRIVATE(this)->cbnode) PRIVATE(this)->cbnode->unref();
+  delete PRIVATE(this)->cbaction;
+  delete PRIVATE(this)->renderer;
+}
+
+/*!
+  Sets the viewport region. The buffer will be rendered again on the
+  next application of the action if the region differs from the one
+  used for the current buffer.
+*/
+void
+SoIdBufferPickAction::setViewportRegion(const SbViewportRegion & newregion)
+{
+  PRIVATE(this)->viewport = newregion;
+}
+
+/*!
+  Returns the viewport region.
+*/
+const SbViewportRegion &
+SoIdBufferPickAction::getViewportRegion(void) const
+{
+  return PRIVATE(this)->viewport;
+}
+
+/*!
+  Forces the buffer to be rendered again on the next application of
+  the action.
+*/
+void
+SoIdBufferPickAction::invalidate(void)
+{
+  PRIVATE(this)->valid = FALSE;
+}
+
+/*!
+  Returns \c TRUE if the last application of the action managed to
+  render the buffer. Queries on an invalid buffer return no hits.
+*/
+SbBool
+SoIdBufferPickAction::isBufferValid(void) const
+{
+  return PRIVATE(this)->valid;
+}
+
+/*!
+  Returns the identifier of the primitive visible at \a pos, or 0 if
+  there is no pickable geometry at that pixel.
+*/
+int32_t
+SoIdBufferPickAction::pickPoint(const SbVec2s & pos) const
+{
+  int x, y;
+  if (!PRIVATE(this)->toBuffer(pos, x, y)) return 0;
+  return (int32_t) PRIVATE(this)->ids[y * PRIVATE(this)->buffersize[0] + x];
+}
+
+/*!
+  Fills in \a ids with the identifiers of all primitives visible
+  within the rectangle spanned by \a corner0 and \a corner1, both
+  corners included. The identifiers are sorted and unique. Any
+  previous contents of \a ids are removed.
+*/
+void
+SoIdBufferPickAction::pickRectangle(const SbVec2s & corner0,
+                                    const SbVec2s & corner1,
+                                    SbList<int32_t> & ids) const
+{
+  ids.truncate(0);
+  if (!PRIVATE(this)->valid) return;
+
+  const SbVec2s mincorner(SbMin(corner0[0], corner1[0]), SbMin(corner0[1], corner1[1]));
+  const SbVec2s maxcorner(SbMax(corner0[0], corner1[0]), SbMax(corner0[1], corner1[1]));
+  int x0, y0, x1, y1;
+  // corners outside the viewport are clamped, so map them unchecked
+  PRIVATE(this)->toBuffer(mincorner, x0, y0);
+  PRIVATE(this)->toBuffer(maxcorner, x1, y1);
+  x0 = SbMax(x0, 0);
+  y0 = SbMax(y0, 0);
+  x1 = SbMin(x1, PRIVATE(this)->buffersize[0] - 1);
+  y1 = SbMin(y1, PRIVATE(this)->buffersize[1] - 1);
+
+  std::vector<unsigned char> bits((PRIVATE(this)->numids + 7) / 8, 0);
+  for (int y = y0; y <= y1; y++) {
+    for (int x = x0; x <= x1; x++) {
+      PRIVATE(this)->mark(x, y, &bits[0]);
+    }
+  }
+  PRIVATE(this)->collect(&bits[0], ids);
+}
+
+/*!
+  Fills in \a ids with the identifiers of all primitives visible
+  within the closed polygon given by the \a numcoords points in \a
+  coords. Pixels are inside if their center is inside the polygon
+  (using the even-odd rule), or if a polygon vertex falls within
+  them. The identifiers are sorted and unique. Any previous contents
+  of \a ids are removed.
+*/
+void
+SoIdBufferPickAction::pickLasso(const SbVec2s * coords, const int numcoords,
+                                SbList<int32_t> & ids) const
+{
+  ids.truncate(0);
+  if (!PRIVATE(this)->valid || numcoords <= 0) return;
+
+  const SbVec2s org = PRIVATE(this)->viewport.getViewportOriginPixels();
+  const int w = PRIVATE(this)->buffersize[0];
+  const int h = PRIVATE(this)->buffersize[1];
+
+  std::vector<unsigned char> bits((PRIVATE(this)->numids + 7) / 8, 0);
+  std::vector<SbVec2f> poly(numcoords);
+  for (int i = 0; i < numcoords; i++) {
+    poly[i].setValue((float(coords[i][0] - org[0]) + 0.5f) * PRIVATE(this)->scale[0],
+                     (float(coords[i][1] - org[1]) + 0.5f) * PRIVATE(this)->scale[1]);
+    PRIVATE(this)->mark(int(std::floor(poly[i][0])), int(std::floor(poly[i][1])), &bits[0]);
+  }
+  float ymin = poly[0][1], ymax = poly[0][1];
+  for (int i = 1; i < numcoords; i++) {
+    ymin = SbMin(ymin, poly[i][1]);
+    ymax = SbMax(ymax, poly[i][1]);
+  }
+
+  // scanline fill, sampling at pixel centers
+  std::vector<float> crossings;
+  const int starty = SbMax(int(std::floor(ymin)), 0);
+  const int endy = SbMin(int(std::floor(ymax)), h - 1);
+  for (int y = starty; y <= endy; y++) {
+    const float yc = float(y) + 0.5f;
+    crossings.clear();
+    for (int i = 0; i < numcoords; i++) {
+      const SbVec2f & a = poly[i];
+      const SbVec2f & b = poly[(i + 1) % numcoords];
+      if ((a[1] <= yc) != (b[1] <= yc)) {
+        crossings.push_back(a[0] + (yc - a[1]) * (b[0] - a[0]) / (b[1] - a[1]));
+      }
+    }
+    std::sort(crossings.begin(), crossings.end());
+    for (size_t i = 0; i + 1 < crossings.size(); i += 2) {
+      const int startx = SbMax(int(std::ceil(crossings[i] - 0.5f)), 0);
+      const int endx = SbMin(int(std::floor(crossings[i + 1] - 0.5f)), w - 1);
+      for (int x = startx; x <= endx; x++) {
+        PRIVATE(this)->mark(x, y, &bits[0]);
+      }
+    }
+  }
+  PRIVATE(this)->collect(&bits[0], ids);
+}
+
+/*!
+  Returns one more than the largest identifier in the current
+  buffer. Identifiers are in the range [1, getNumIds()>.
+*/
+int32_t
+SoIdBufferPickAction::getNumIds(void) const
+{
+  return PRIVATE(this)->numids;
+}
+
+/*!
+  Returns the path to the shape which generated the primitive with
+  identifier \a id, or \c NULL if \a id is not a valid identifier.
+*/
+const SoPath *
+SoIdBufferPickAction::getPath(const int32_t id) const
+{
+  const int idx = PRIVATE(this)->findObject(id);
+  return (idx >= 0) ? PRIVATE(this)->objects[idx].path : NULL;
+}
+
+/*!
+  Returns the index of primitive \a id within its shape, counted in
+  the order the primitives are generated by the shape. Returns -1 if
+  \a id is not a valid identifier.
+*/
+int
+SoIdBufferPickAction::getPrimitiveIndex(const int32_t id) const
+{
+  const int idx = PRIVATE(this)->findObject(id);
+  return (idx >= 0) ? int(id - PRIVATE(this)->objects[idx].firstid) : -1;
+}
+
+/*!
+  Returns the identifier of the first primitive of the shape at the
+  tail of \a path, or -1 if the shape is not part of the buffer. This
+  is the inverse of getPath(). The search starts after the previously
+  found shape, so it is cheap when shapes are looked up in traversal
+  order.
+*/
+int32_t
+SoIdBufferPickAction::getFirstId(const SoPath * path) const
+{
+  const int n = PRIVATE(this)->objects.getLength();
+  for (int i = 0; i < n; i++) {
+    const int idx = (PRIVATE(this)->lastfound + i) % n;
+    if (*PRIVATE(this)->objects[idx].path == *path) {
+      PRIVATE(this)->lastfound = (idx + 1) % n;
+      return PRIVATE(this)->objects[idx].firstid;
+    }
+  }
+  return -1;
+}
+
+/*!
+  Renders the buffer for the scene graph rooted at \a node, unless
+  the current buffer is still up-to-date. The action does not
+  traverse the scene graph itself.
+*/
+void
+SoIdBufferPickAction::beginTraversal(SoNode * node)
+{
+  PRIVATE(this)->render(node);
+}
+
+// *************************************************************************
+
+#undef PRIVATE
+
+void
+SoIdBufferPickActionP::render(SoNode * node)
+{
+  if (this->valid && (node == this->root) &&
+      (node->getNodeId() == this->rootid) &&
+      (this->viewport == this->renderedviewport)) {
+    return;
+  }
+
+  // Reduce the size of the buffer to fit within the maximum offscreen
+  // limitations, in the same manner as SoExtSelection does, so the
+  // renderer never has to do tiled rendering.
+  unsigned int maxsize[2];
+  cc_glglue_context_max_dimensions(&maxsize[0], &maxsize[1]);
+
+  const SbVec2s requestedsize = this->viewport.getViewportSizePixels();
+  SbVec2s size = requestedsize;
+  if ((unsigned int) requestedsize[0] > maxsize[0] ||
+      (unsigned int) requestedsize[1] > maxsize[1]) {
+    const double maxv = (double) SbMax(requestedsize[0], requestedsize[1]);
+    const double minv = (double) SbMin(maxsize[0], maxsize[1]);
+    const double s = minv / maxv;
+    size.setValue((short) (requestedsize[0] * s), (short) (requestedsize[1] * s));
+  }
+  size.setValue(SbMax(size[0], (short) 1), SbMax(size[1], (short) 1));
+
+  const SbViewportRegion buffervp(size);
+  if (this->renderer == NULL || this->renderer->getViewportRegion() != buffervp) {
+    delete this->renderer;
+    this->renderer = new SoOffscreenRenderer(buffervp);
+    this->renderer->setComponents(SoOffscreenRenderer::RGB);
+    this->renderer->setBackgroundColor(SbColor(0.0f, 0.0f, 0.0f));
+  }
+  if (this->cbaction == NULL) {
+    this->cbaction = new SoCallbackAction;
+    const SoType shapetype = SoShape::getClassTypeId();
+    this->cbaction->addPreCallback(shapetype, preShapeCB, this);
+    this->cbaction->addPostCallback(shapetype, postShapeCB, this);
+    this->cbaction->addTriangleCallback(shapetype, triangleCB, this);
+    this->cbaction->addLineSegmentCallback(shapetype, lineSegmentCB, this);
+    this->cbaction->addPointCallback(shapetype, pointCB, this);
+
+    this->cbnode = new SoCallback;
+    this->cbnode->ref();
+    this->cbnode->setCallback(renderCB, this);
+  }
+
+  this->buffersize = size;
+  this->scale[0] = float(size[0]) / float(SbMax(requestedsize[0], (short) 1));
+  this->scale[1] = float(size[1]) / float(SbMax(requestedsize[1], (short) 1));
+  this->clearObjects();
+  this->numids = 1;
+  this->overflow = FALSE;
+  this->lastfound = 0;
+  this->root = node;
+  this->rootid = node->getNodeId();
+  this->renderedviewport = this->viewport;
+
+  // The scene is traversed with the viewport the queries are made in,
+  // so cameras and screen space complexity behave as they do for the
+  // on-screen rendering.
+  this->cbaction->setViewportRegion(this->viewport);
+  this->valid = this->renderer->render(this->cbnode);
+
+  if (!this->valid) {
+    this->clearObjects();
+    this->numids = 1;
+    this->ids.clear();
+    return;
+  }
+
+  const int numpixels = int(size[0]) * int(size[1]);
+  const unsigned char * rgb = this->renderer->getBuffer();
+  this->ids.resize(numpixels);
+  for (int i = 0; i < numpixels; i++, rgb += 3) {
+    this->ids[i] = (uint32_t(rgb[0]) << 16) | (uint32_t(rgb[1]) << 8) | uint32_t(rgb[2]);
+  }
+}
+
+void
+SoIdBufferPickActionP::clearObjects(void)
+{
+  for (int i = 0; i < this->objects.getLength(); i++) {
+    this->objects[i].path->unref();
+  }
+  this->objects.truncate(0);
+}
+
+// Returns the index of the object owning identifier \a id, or -1.
+int
+SoIdBufferPickActionP::findObject(const int32_t id) const
+{
+  if (id <= 0 || id >= this->numids) return -1;
+
+  // objects are sorted on their first id, so do a binary search for
+  // the last object starting at or before id
+  int lo = 0, hi = this->objects.getLength();
+  while (lo < hi) {
+    const int mid = (lo + hi) / 2;
+    if (this->objects[mid].firstid <= id) lo = mid + 1;
+    else hi = mid;
+  }
+  return lo - 1;
+}
+
+// Maps a pixel position in the viewport to the buffer. Returns FALSE
+// if the position is outside the buffer, but always sets x and y.
+SbBool
+SoIdBufferPickActionP::toBuffer(const SbVec2s & pos, int & x, int & y) const
+{
+  const SbVec2s org = this->viewport.getViewportOriginPixels();
+  x = int((float(pos[0] - org[0]) + 0.5f) * this->scale[0]);
+  y = int((float(pos[1] - org[1]) + 0.5f) * this->scale[1]);
+  if (pos[0] < org[0]) x = -1;
+  if (pos[1] < org[1]) y = -1;
+  return this->valid &&
+    (x >= 0) && (y >= 0) &&
+    (x < this->buffersize[0]) && (y < this->buffersize[1]);
+}
+
+void
+SoIdBufferPickActionP::mark(const int x, const int y, unsigned char * bits) const
+{
+  if (x < 0 || y < 0 || x >= this->buffersize[0] || y >= this->buffersize[1]) return;
+  const uint32_t id = this->ids[y * this->buffersize[0] + x];
+  if (id != 0) bits[id >> 3] |= (unsigned char) (1 << (id & 0x07));
+}
+
+void
+SoIdBufferPickActionP::collect(const unsigned char * bits, SbList<int32_t> & ids) const
+{
+  const int numbytes = (this->numids + 7) / 8;
+  for (int i = 0; i < numbytes; i++) {
+    if (bits[i] == 0) continue;
+    for (int b = 0; b < 8; b++) {
+      if (bits[i] & (1 << b)) ids.append((i << 3) | b);
+    }
+  }
+}
+
+uint32_t
+SoIdBufferPickActionP::nextId(void)
+{
+  if (this->numids > SOIDBUFFER_MAXID) {
+    if (!this->overflow) {
+      SoDebugError::postWarning("SoIdBufferPickActionP::nextId",
+                                "More than %d primitives in the scene -- "
+                                "the remaining primitives will not be "
+                                "pickable.", SOIDBUFFER_MAXID);
+      this->overflow = TRUE;
+    }
+    return 0;
+  }
+  return (uint32_t) this->numids++;
+}
+
+// Batches consecutive primitives of the same type within a shape into
+// a single glBegin()/glEnd() pair.
+void
+SoIdBufferPickActionP::beginPrimitive(const GLenum mode)
+{
+  if (this->openprimitive == mode) return;
+  this->endPrimitive();
+  glBegin(mode);
+  this->openprimitive = mode;
+}
+
+void
+SoIdBufferPickActionP::endPrimitive(void)
+{
+  if (this->openprimitive != GL_NONE) {
+    glEnd();
+    this->openprimitive = GL_NONE;
+  }
+}
+
+static inline void
+soidbuffer_set_color(const uint32_t id)
+{
+  glColor3ub((GLubyte) ((id >> 16) & 0xff),
+             (GLubyte) ((id >> 8) & 0xff),
+             (GLubyte) (id & 0xff));
+}
+
+void
+SoIdBufferPickActionP::renderCB(void * closure, SoAction * action)
+{
+  if (!action->isOfType(SoGLRenderAction::getClassTypeId())) return;
+  SoIdBufferPickActionP * thisp = (SoIdBufferPickActionP *) closure;
+
+  GLint red, green, blue;
+  glGetIntegerv(GL_RED_BITS, &red);
+  glGetIntegerv(GL_GREEN_BITS, &green);
+  glGetIntegerv(GL_BLUE_BITS, &blue);
+  if (red < 8 || green < 8 || blue < 8) {
+    SoDebugError::post("SoIdBufferPickActionP::renderCB",
+                       "The offscreen context has GL_{color}_BITS==[%d, %d, %d], "
+                       "at least 8 bits per channel are needed to store "
+                       "primitive identifiers.", red, green, blue);
+    return;
+  }
+
+  glPushAttrib(GL_ENABLE_BIT |
+               GL_LIGHTING_BIT |
+               GL_DEPTH_BUFFER_BIT |
+               GL_COLOR_BUFFER_BIT |
+               GL_POLYGON_BIT |
+               GL_LINE_BIT |
+               GL_POINT_BIT |
+               GL_CURRENT_BIT);
+
+  glDisable(GL_LIGHTING);
+  glDisable(GL_TEXTURE_2D);
+  glDisable(GL_FOG);
+  glDisable(GL_BLEND);
+  glDisable(GL_ALPHA_TEST);
+  glDisable(GL_DITHER);
+  glDisable(GL_POLYGON_SMOOTH);
+  glDisable(GL_LINE_SMOOTH);
+  glDisable(GL_POINT_SMOOTH);
+  glShadeModel(GL_FLAT);
+  glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+  glEnable(GL_DEPTH_TEST);
+  glDepthFunc(GL_LEQUAL);
+  glDepthMask(GL_TRUE);
+
+  glMatrixMode(GL_PROJECTION);
+  glPushMatrix();
+  glMatrixMode(GL_MODELVIEW);
+  glPushMatrix();
+
+  thisp->cbaction->apply(thisp->root);
+  thisp->endPrimitive();
+
+  glMatrixMode(GL_PROJECTION);
+  glPopMatrix();
+  glMatrixMode(GL_MODELVIEW);
+  glPopMatrix();
+
+  glPopAttrib();
+}
+
+SoCallbackAction::Response
+SoIdBufferPickActionP::preShapeCB(void * closure, SoCallbackAction * action,
+                                  const SoNode * COIN_UNUSED_ARG(node))
+{
+  SoIdBufferPickActionP * thisp = (SoIdBufferPickActionP *) closure;
+  SoState * state = action->getState();
+
+  if (SoPickStyleElement::get(state) == SoPickStyleElement::UNPICKABLE) {
+    return SoCallbackAction::PRUNE;
+  }
+
+  SoIdBufferPickActionP::Object obj;
+  obj.path = action->getCurPath()->copy();
+  obj.path->ref();
+  obj.firstid = thisp->numids;
+  thisp->objects.append(obj);
+
+  SbMatrix affine, proj;
+  SoViewVolumeElement::get(state).getMatrices(affine, proj);
+  affine.multLeft(SoModelMatrixElement::get(state));
+
+  glMatrixMode(GL_PROJECTION);
+  glLoadMatrixf((float *) proj);
+  glMatrixMode(GL_MODELVIEW);
+  glLoadMatrixf((float *) affine);
+
+  SoShapeHintsElement::VertexOrdering vertexorder;
+  SoShapeHintsElement::ShapeType shapetype;
+  SoShapeHintsElement::FaceType facetype;
+  SoShapeHintsElement::get(state, vertexorder, shapetype, facetype);
+  if (shapetype == SoShapeHintsElement::SOLID &&
+      vertexorder != SoShapeHintsElement::UNKNOWN_ORDERING) {
+    glFrontFace(vertexorder == SoShapeHintsElement::CLOCKWISE ? GL_CW : GL_CCW);
+    glEnable(GL_CULL_FACE);
+  }
+  else {
+    glDisable(GL_CULL_FACE);
+  }
+
+  const float linewidth = action->getLineWidth();
+  glLineWidth(linewidth > 0.0f ? linewidth : 1.0f);
+  const float pointsize = action->getPointSize();
+  glPointSize(pointsize > 0.0f ? pointsize : 1.0f);
+
+  return SoCallbackAction::CONTINUE;
+}
+
+SoCallbackAction::Response
+SoIdBufferPickActionP::postShapeCB(void * closure,
+                                   SoCallbackAction * COIN_UNUSED_ARG(action),
+                                   const SoNode * COIN_UNUSED_ARG(node))
+{
+  SoIdBufferPickActionP * thisp = (SoIdBufferPickActionP *) closure;
+  thisp->endPrimitive();
+
+  // don't keep shapes without any primitives
+  const int last = thisp->objects.getLength() - 1;
+  if (last >= 0 && thisp->objects[last].firstid == thisp->numids) {
+    thisp->objects[last].path->unref();
+    thisp->objects.remove(last);
+  }
+  return SoCallbackAction::CONTINUE;
+}
+
+void
+SoIdBufferPickActionP::triangleCB(void * closure,
+                                  SoCallbackAction * COIN_UNUSED_ARG(action),
+                                  const SoPrimitiveVertex * v1,
+                                  const SoPrimitiveVertex * v2,
+                                  const SoPrimitiveVertex * v3)
+{
+  SoIdBufferPickActionP * thisp = (SoIdBufferPickActionP *) closure;
+  thisp->beginPrimitive(GL_TRIANGLES);
+  soidbuffer_set_color(thisp->nextId());
+  glVertex3fv(v1->getPoint().getValue());
+  glVertex3fv(v2->getPoint().getValue());
+  glVertex3fv(v3->getPoint().getValue());
+}
+
+void
+SoIdBufferPickActionP::lineSegmentCB(void * closure,
+                                     SoCallbackAction * COIN_UNUSED_ARG(action),
+                                     const SoPrimitiveVertex * v1,
+                                     const SoPrimitiveVertex * v2)
+{
+  SoIdBufferPickActionP * thisp = (SoIdBufferPickActionP *) closure;
+  thisp->beginPrimitive(GL_LINES);
+  soidbuffer_set_color(thisp->nextId());
+  glVertex3fv(v1->getPoint().getValue());
+  glVertex3fv(v2->getPoint().getValue());
+}
+
+void
+SoIdBufferPickActionP::pointCB(void * closure,
+                               SoCallbackAction * COIN_UNUSED_ARG(action),
+                               const SoPrimitiveVertex * v)
+{
+  SoIdBufferPickActionP * thisp = (SoIdBufferPickActionP *) closure;
+  thisp->beginPrimitive(GL_POINTS);
+  soidbuffer_set_color(thisp->nextId());
+  glVertex3fv(v->getPoint().getValue());
+}
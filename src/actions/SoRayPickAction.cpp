@@ -121,6 +121,12 @@
   \code
   SoNode * realroot = viewer->getSceneManager()->getSceneGraph();
   \endcode
+
+  Applications sending many rays through the same scene can set them
+  all up with setRays() or setNormalizedPoints(), and pick them in a
+  single traversal. The rays are then culled as a group against the
+  bounding boxes in the scene graph, which is much faster than
+  applying the action once per ray.
 */
 // FIXME: in the class doc, also mention how one can use
 // SoRayPickAction from within an SoHandleEventAction callback with
@@ -130,9 +136,12 @@
 #include <Inventor/actions/SoRayPickAction.h>
 
 #include <cfloat>
+#include <cmath>
+#include <cstring>
 
 #include <Inventor/SbLine.h>
 #include <Inventor/SoPickedPoint.h>
+#include <Inventor/caches/SoBoundingBoxCache.h>
 #include <Inventor/elements/SoClipPlaneElement.h>
 #include <Inventor/elements/SoModelMatrixElement.h>
 #include <Inventor/elements/SoOverrideElement.h>
@@ -171,6 +180,54 @@ class SoRayPickActionP {
 public:
   SoRayPickActionP(void) : owner(NULL) { }
 
+  // Per-ray data for batched picking, swapped in and out of the
+  // members below with loadRay() and storeRay().
+  class BatchRay {
+  public:
+    SbVec2f normvppoint;
+    SbVec3d raystart;
+    SbVec3d raydirection;
+    double rayradiusstart;
+    double rayradiusdelta;
+    double raynear;
+    double rayfar;
+    SbDPLine wsline;
+    SbDPPlane nearplane;
+    unsigned int flags;
+    SoPickedPointList pickedpointlist;
+    SbList <double> ppdistance;
+  };
+
+  // The rays still active at one level of separator nesting, stored
+  // in world space as separate component arrays so the box test in
+  // cullPacket() can be vectorized by the compiler.
+  class RayPacket {
+  public:
+    RayPacket(const int size) : num(0) {
+      this->data = new float[PACKET_COMPONENTS * size];
+      this->index = new int[size];
+      this->hit = new unsigned char[size];
+      this->size = size;
+    }
+    ~RayPacket() {
+      delete[] this->data;
+      delete[] this->index;
+      delete[] this->hit;
+    }
+    float * component(const int c) { return this->data + c * this->size; }
+    const float * component(const int c) const { return this->data + c * this->size; }
+
+    float * data;
+    int * index;
+    unsigned char * hit;
+    int size;
+    int num;
+  };
+  enum {
+    ORIGIN_X, ORIGIN_Y, ORIGIN_Z, INVDIR_X, INVDIR_Y, INVDIR_Z,
+    TMIN, TMAX, PACKET_COMPONENTS
+  };
+
   // Hidden private methods.
 
   SbBool isBetweenPlanesWS(const SbVec3d & intersection,
@@ -182,6 +239,19 @@ public:
   void calcObjectSpaceData(SoState * ownerstate);
   void calcMatrices(SoState * ownerstate);
   void setPickStyleFlags(SoState * ownerstate);
+  void setWorldSpaceRay(const SbVec3f & start, const SbVec3f & direction,
+                        float neardistance, float fardistance);
+  void computeWorldSpaceRay(SoState * ownerstate);
+  static void sortPickedPoints(SoPickedPointList & list, SbList <double> & distances);
+
+  void clearRays(void);
+  void loadRay(const int ray);
+  void storeRay(const int ray);
+  RayPacket * getPacket(const int level);
+  void fillPacket(RayPacket * packet);
+  void buildPackets(void);
+  void cullPacket(const RayPacket * in, RayPacket * out,
+                  const SbVec3f & boxmin, const SbVec3f & boxmax) const;
 
   // Hidden private variables.
 
@@ -213,6 +283,14 @@ public:
   unsigned int flags;
   SbBool objectspacevalid; // FIXME: why not a flag?
 
+  SbList <BatchRay *> batchrays;
+  SbList <RayPacket *> packets;
+  int packetlevel;
+  SbBool packetsvalid;
+  float packetmargin; // negative if the rays can't be culled
+  SbDPMatrix batchobj2world;
+  SbDPMatrix batchworld2obj;
+
   enum {
     WS_RAY_SET =         0x0001, // ray set by setRay()
     WS_RAY_COMPUTED =    0x0002, // ray computed in computeWorldSpaceRay()
@@ -224,7 +302,12 @@ public:
     PPLIST_IS_SORTED =   0x0080, // did we sort pickedpointslist ?
     OSVOLUME_DIRTY =     0x0100, // did we calculate osvolume?
     PUSH_PICK_TO_FRONT = 0x0200, // should pick go in front?
-    CULL_BACKFACES =     0x0400  // should backface picks be ignored?
+    CULL_BACKFACES =     0x0400, // should backface picks be ignored?
+    BATCH_MATRICES =     0x0800, // use batchobj2world in calcMatrices()
+
+    // flags stored per ray in batched picking
+    RAY_FLAGS = WS_RAY_SET | WS_RAY_COMPUTED | NORM_POINT |
+                CLIP_NEAR | CLIP_FAR | PPLIST_IS_SORTED
   };
 
   SoRayPickAction * owner;
@@ -267,6 +350,9 @@ SoRayPickAction::SoRayPickAction(const SbViewportRegion & viewportregion)
   PRIVATE(this)->radiusinpixels = 5.0f;
   PRIVATE(this)->flags = 0;
   PRIVATE(this)->objectspacevalid = TRUE;
+  PRIVATE(this)->packetlevel = 0;
+  PRIVATE(this)->packetsvalid = FALSE;
+  PRIVATE(this)->packetmargin = -1.0f;
 
   SO_ACTION_CONSTRUCTOR(SoRayPickAction);
 }
@@ -277,6 +363,10 @@ SoRayPickAction::SoRayPickAction(const SbViewportRegion & viewportregion)
 SoRayPickAction::~SoRayPickAction(void)
 {
   PRIVATE(this)->cleanupPickedPoints();
+  PRIVATE(this)->clearRays();
+  for (int i = 0; i < PRIVATE(this)->packets.getLength(); i++) {
+    delete PRIVATE(this)->packets[i];
+  }
 }
 
 /*!
@@ -290,6 +380,7 @@ SoRayPickAction::~SoRayPickAction(void)
 void
 SoRayPickAction::setPoint(const SbVec2s & viewportpoint)
 {
+  PRIVATE(this)->clearRays();
   PRIVATE(this)->vppoint = viewportpoint;
   PRIVATE(this)->clearFlag(SoRayPickActionP::NORM_POINT |
                            SoRayPickActionP::WS_RAY_SET |
@@ -307,6 +398,7 @@ SoRayPickAction::setPoint(const SbVec2s & viewportpoint)
 void
 SoRayPickAction::setNormalizedPoint(const SbVec2f & normpoint)
 {
+  PRIVATE(this)->clearRays();
   PRIVATE(this)->normvppoint = normpoint;
   PRIVATE(this)->clearFlag(SoRayPickActionP::WS_RAY_SET |
                            SoRayPickActionP::WS_RAY_COMPUTED);
@@ -350,55 +442,8 @@ void
 SoRayPickAction::setRay(const SbVec3f & start, const SbVec3f & direction,
                         float neardistance, float fardistance)
 {
-#if COIN_DEBUG
-  if (direction == SbVec3f(0.0f, 0.0f, 0.0f)) {
-    SoDebugError::postWarning("SoRayPickAction::setRay",
-                              "Ray has no direction");
-
-  }
-#endif // COIN_DEBUG
-  if (neardistance >= 0.0f) PRIVATE(this)->setFlag(SoRayPickActionP::CLIP_NEAR);
-  else {
-    PRIVATE(this)->clearFlag(SoRayPickActionP::CLIP_NEAR);
-    neardistance = 1.0f;
-    // make sure neardistance is smaller than fardistance
-    if (fardistance > 0.0f && neardistance >= fardistance) {
-      neardistance = fardistance * 0.01f;
-    }
-  }
-
-  if (fardistance >= 0.0f) PRIVATE(this)->setFlag(SoRayPickActionP::CLIP_FAR);
-  else {
-    PRIVATE(this)->clearFlag(SoRayPickActionP::CLIP_FAR);
-    // just set to some value bigger than neardistance.
-    fardistance = neardistance + 10.0f;
-  }
-
-  // set these to some values. They will be set to better values
-  // in computeWorldSpaceRay() (when we know the view volume).
-  PRIVATE(this)->rayradiusstart = 0.01;
-  PRIVATE(this)->rayradiusdelta = 0.0;
-
-  PRIVATE(this)->raystart.setValue(start);
-  PRIVATE(this)->raydirection.setValue(direction);
-  (void) PRIVATE(this)->raydirection.normalize();
-  PRIVATE(this)->raynear = neardistance;
-  PRIVATE(this)->rayfar = fardistance;
-  PRIVATE(this)->wsline = SbDPLine(PRIVATE(this)->raystart,
-                                   PRIVATE(this)->raystart + PRIVATE(this)->raydirection);
-
-  // D = shortest distance from origin to plane
-  const double D = PRIVATE(this)->raydirection.dot(PRIVATE(this)->raystart);
-  PRIVATE(this)->nearplane = SbDPPlane(PRIVATE(this)->raydirection, D + PRIVATE(this)->raynear);
-
-  PRIVATE(this)->setFlag(SoRayPickActionP::WS_RAY_SET);
-
-  // We use a real cone for picking, but keep pick view volume in sync to be
-  // compatible with OIV
-  PRIVATE(this)->wsvolume.perspective(0.0, 1.0, neardistance, fardistance);
-  PRIVATE(this)->wsvolume.translateCamera(start);
-  PRIVATE(this)->wsvolume.rotateCamera(SbRotation(SbVec3f(0.0f, 0.0f, -1.0f), direction));
-  PRIVATE(this)->setFlag(SoRayPickActionP::OSVOLUME_DIRTY);
+  PRIVATE(this)->clearRays();
+  PRIVATE(this)->setWorldSpaceRay(start, direction, neardistance, fardistance);
 }
 
 /*!
@@ -433,36 +478,12 @@ SoRayPickAction::isPickAll(void) const
 const SoPickedPointList &
 SoRayPickAction::getPickedPointList(void) const
 {
-  int n = PRIVATE(this)->pickedpointlist.getLength();
-  if (!PRIVATE(this)->isFlagSet(SoRayPickActionP::PPLIST_IS_SORTED) && n > 1) {
-    SoPickedPoint ** pparray = reinterpret_cast<SoPickedPoint **>(PRIVATE(this)->pickedpointlist.getArrayPtr());
-    double * darray = const_cast<double*>(PRIVATE(this)->ppdistance.getArrayPtr());
-
-    int i, j, distance;
-    SoPickedPoint * pptmp;
-    double dtmp;
-
-    // shell sort algorithm (O(nlog(n))
-    for (distance = 1; distance <= n/9; distance = 3*distance + 1) ;
-    for (; distance > 0; distance /= 3) {
-      for (i = distance; i < n; i++) {
-        dtmp = darray[i];
-        pptmp = pparray[i];
-        j = i;
-        while (j >= distance && darray[j-distance] > dtmp) {
-          darray[j] = darray[j-distance];
-          pparray[j] = pparray[j-distance];
-          j -= distance;
-        }
-        darray[j] = dtmp;
-        pparray[j] = pptmp;
-      }
-    }
-    SoRayPickActionP * thisp =
-      const_cast<SoRayPickActionP *>(&PRIVATE(this).get());
+  SoRayPickActionP * thisp =
+    const_cast<SoRayPickActionP *>(&PRIVATE(this).get());
+  if (!thisp->isFlagSet(SoRayPickActionP::PPLIST_IS_SORTED)) {
+    SoRayPickActionP::sortPickedPoints(thisp->pickedpointlist, thisp->ppdistance);
     thisp->setFlag(SoRayPickActionP::PPLIST_IS_SORTED);
   }
-
   return PRIVATE(this)->pickedpointlist;
 }
 
@@ -483,85 +504,129 @@ SoRayPickAction::getPickedPoint(const int index) const
 }
 
 /*!
-  \COININTERNAL
- */
+  Sets up the action to pick \a numrays rays in one traversal. Ray \a
+  i starts at \a starts[i] and follows \a directions[i], with \a
+  neardistance and \a fardistance working as for setRay().
+
+  This is meant for applications sending many rays through the same
+  scene, like sensor simulations. The rays are culled as a group
+  against the bounding boxes of separators and shapes, so subgraphs
+  are traversed once for all the rays that may hit them instead of
+  once per ray. The results are fetched per ray with
+  getRayPickedPointList() and getRayPickedPoint().
+
+  Calling setPoint(), setNormalizedPoint() or setRay() switches the
+  action back to picking a single ray.
+
+  Note that only shapes are picked in batched mode. Picked points are
+  not extended with nodekit details, and the pick view volume (see
+  getViewVolume()) is not updated per ray, so shapes picking on their
+  screen-space extent (like SoText2 and SoImage) may miss.
+
+  \since Coin 4.1
+*/
 void
-SoRayPickAction::computeWorldSpaceRay(void)
+SoRayPickAction::setRays(const int numrays, const SbVec3f * starts,
+                         const SbVec3f * directions,
+                         float neardistance, float fardistance)
 {
-  if (PRIVATE(this)->isFlagSet(SoRayPickActionP::WS_RAY_SET)) {
-    // set the ray radius to some very small value, since
-    // the user set the ray manually using setRay().
-    //
-    // FIXME: Wouldn't it be a nice new feature to be able to
-    // set the radius of the ray in setRay()? pederb, 2001-01-05
-    const SbViewVolume & vv = SoViewVolumeElement::get(this->state);
-    PRIVATE(this)->rayradiusstart = SbMin(vv.getWidth(), vv.getHeight()) * FLT_EPSILON;
-    PRIVATE(this)->rayradiusdelta = 0.0f;
+  PRIVATE(this)->cleanupPickedPoints();
+  PRIVATE(this)->clearRays();
+  for (int i = 0; i < numrays; i++) {
+    PRIVATE(this)->setWorldSpaceRay(starts[i], directions[i], neardistance, fardistance);
+    PRIVATE(this)->batchrays.append(new SoRayPickActionP::BatchRay);
+    PRIVATE(this)->storeRay(i);
   }
-  else {
-    const SbViewVolume & vv = SoViewVolumeElement::get(this->state);
-    const SbViewportRegion & vp = SoViewportRegionElement::get(this->state);
+}
 
-    if (!PRIVATE(this)->isFlagSet(SoRayPickActionP::NORM_POINT)) {
-      SbVec2s pt = PRIVATE(this)->vppoint - vp.getViewportOriginPixels();
-      SbVec2s size = vp.getViewportSizePixels();
-      PRIVATE(this)->normvppoint.setValue(float(pt[0]) / float(size[0]),
-                                 float(pt[1]) / float(size[1]));
-    }
+/*!
+  Sets up the action to pick through \a numpoints normalized viewport
+  points in one traversal. This is the batched counterpart of
+  setNormalizedPoint(), see setRays() for details.
 
-#if COIN_DEBUG
-    if (vv.getDepth() == 0.0f || vv.getWidth() == 0.0f || vv.getHeight() == 0.0f) {
-      SoDebugError::postWarning("SoRayPickAction::computeWorldSpaceRay",
-                                "invalid frustum: <%f, %f, %f>",
-                                vv.getWidth(), vv.getHeight(), vv.getDepth());
-      return;
-    }
-#endif // COIN_DEBUG
+  \since Coin 4.1
+*/
+void
+SoRayPickAction::setNormalizedPoints(const int numpoints, const SbVec2f * normpoints)
+{
+  PRIVATE(this)->cleanupPickedPoints();
+  PRIVATE(this)->clearRays();
+  PRIVATE(this)->clearFlag(SoRayPickActionP::WS_RAY_SET |
+                           SoRayPickActionP::WS_RAY_COMPUTED);
+  PRIVATE(this)->setFlag(SoRayPickActionP::NORM_POINT |
+                         SoRayPickActionP::CLIP_NEAR |
+                         SoRayPickActionP::CLIP_FAR);
+  for (int i = 0; i < numpoints; i++) {
+    PRIVATE(this)->normvppoint = normpoints[i];
+    PRIVATE(this)->batchrays.append(new SoRayPickActionP::BatchRay);
+    PRIVATE(this)->storeRay(i);
+  }
+}
 
-    SbDPLine templine;
-    SbVec2d tmppt;
-    tmppt.setValue(PRIVATE(this)->normvppoint);
-    vv.getDPViewVolume().projectPointToLine(tmppt, templine);
-    PRIVATE(this)->raystart = templine.getPosition();
-    PRIVATE(this)->raydirection = templine.getDirection();
+/*!
+  Returns the number of rays set up with setRays() or
+  setNormalizedPoints(), or 0 if the action picks a single ray.
 
-    PRIVATE(this)->raynear = 0.0;
-    PRIVATE(this)->rayfar = vv.getDPViewVolume().getDepth();
+  \since Coin 4.1
+*/
+int
+SoRayPickAction::getNumRays(void) const
+{
+  return PRIVATE(this)->batchrays.getLength();
+}
 
-    SbVec2s vpsize = vp.getViewportSizePixels();
-    PRIVATE(this)->rayradiusstart = (double(vv.getHeight()) / double(vpsize[1]))*
-      double(PRIVATE(this)->radiusinpixels);
-    PRIVATE(this)->rayradiusdelta = 0.0;
-    if (vv.getProjectionType() == SbViewVolume::PERSPECTIVE) {
-      SbVec3d dir(0.0f, vv.getHeight()*0.5f, vv.getNearDist());
-      // no need to test here, we know vv isn't empty
-      (void) dir.normalize();
-      SbVec3d upperfar = dir * (vv.getNearDist()+vv.getDepth()) /
-        dir.dot(SbVec3d(0.0f, 0.0f, 1.0f));
+/*!
+  Returns the list of points picked by \a ray in batched mode, sorted
+  on distance as for getPickedPointList().
 
-      double farheight = double(upperfar[1])*2.0;
-      double farsize = (farheight / double(vpsize[1])) * double(PRIVATE(this)->radiusinpixels);
-      PRIVATE(this)->rayradiusdelta = (farsize - PRIVATE(this)->rayradiusstart) / double(vv.getDepth());
-    }
-    PRIVATE(this)->wsline = SbDPLine(PRIVATE(this)->raystart,
-                                     PRIVATE(this)->raystart + PRIVATE(this)->raydirection);
+  \since Coin 4.1
+*/
+const SoPickedPointList &
+SoRayPickAction::getRayPickedPointList(const int ray) const
+{
+  assert(ray >= 0 && ray < PRIVATE(this)->batchrays.getLength());
+  SoRayPickActionP::BatchRay * r = PRIVATE(this)->batchrays[ray];
+  if (!(r->flags & SoRayPickActionP::PPLIST_IS_SORTED)) {
+    SoRayPickActionP::sortPickedPoints(r->pickedpointlist, r->ppdistance);
+    r->flags |= SoRayPickActionP::PPLIST_IS_SORTED;
+  }
+  return r->pickedpointlist;
+}
 
-    PRIVATE(this)->nearplane = SbDPPlane(vv.getDPViewVolume().getProjectionDirection(),
-					 PRIVATE(this)->raystart);
-    PRIVATE(this)->setFlag(SoRayPickActionP::WS_RAY_COMPUTED);
+/*!
+  Returns the picked point with \a index in the list of points picked
+  by \a ray in batched mode, or \c NULL if less than \a index + 1
+  points were picked.
 
-    // we pick on a real cone, but keep pick view volume in sync to be
-    // compatible with OIV.
-    double normradius = double(PRIVATE(this)->radiusinpixels) /
-      double(SbMin(vp.getViewportSizePixels()[0], vp.getViewportSizePixels()[1]));
+  \since Coin 4.1
+*/
+SoPickedPoint *
+SoRayPickAction::getRayPickedPoint(const int ray, const int index) const
+{
+  assert(index >= 0);
+  const SoPickedPointList & list = this->getRayPickedPointList(ray);
+  if (index < list.getLength()) return list[index];
+  return NULL;
+}
 
-    PRIVATE(this)->wsvolume = vv.narrow(float(PRIVATE(this)->normvppoint[0] - normradius),
-                                        float(PRIVATE(this)->normvppoint[1] - normradius),
-                                        float(PRIVATE(this)->normvppoint[0] + normradius),
-                                        float(PRIVATE(this)->normvppoint[1] + normradius));
-    SoPickRayElement::set(state, PRIVATE(this)->wsvolume);
-    PRIVATE(this)->setFlag(SoRayPickActionP::OSVOLUME_DIRTY);
+/*!
+  \COININTERNAL
+ */
+void
+SoRayPickAction::computeWorldSpaceRay(void)
+{
+  const int numrays = PRIVATE(this)->batchrays.getLength();
+  if (numrays == 0) {
+    PRIVATE(this)->computeWorldSpaceRay(this->state);
+    return;
+  }
+  // batched picking, compute every ray from the current view volume
+  for (int i = 0; i < numrays; i++) {
+    PRIVATE(this)->loadRay(i);
+    PRIVATE(this)->computeWorldSpaceRay(this->state);
+    PRIVATE(this)->storeRay(i);
   }
+  PRIVATE(this)->buildPackets();
 }
 
 /*!
@@ -1036,6 +1101,100 @@ SoRayPickAction::addIntersection(const SbVec3f & objectspacepoint_in, SbBool fro
   return pp;
 }
 
+/*!
+  \COININTERNAL
+
+  Narrows the rays of a batched pick to the ones which may intersect
+  \a box, given in the current object space. Returns \c FALSE if no
+  rays are left. Every call must be matched by a call to popRays().
+*/
+SbBool
+SoRayPickAction::pushRays(const SbBox3f & box)
+{
+  SoRayPickActionP::RayPacket * parent =
+    PRIVATE(this)->getPacket(PRIVATE(this)->packetlevel);
+  SoRayPickActionP::RayPacket * packet =
+    PRIVATE(this)->getPacket(++PRIVATE(this)->packetlevel);
+
+  if (box.isEmpty()) {
+    packet->num = 0;
+  }
+  else if (!PRIVATE(this)->packetsvalid || PRIVATE(this)->packetmargin < 0.0f) {
+    // rays not computed yet, or with an unbounded radius
+    packet->num = parent->num;
+    for (int i = 0; i < parent->num; i++) packet->index[i] = parent->index[i];
+  }
+  else {
+    SbBox3f wsbox(box);
+    wsbox.transform(SoModelMatrixElement::get(this->state));
+    SbVec3f boxmin = wsbox.getMin();
+    SbVec3f boxmax = wsbox.getMax();
+    // grow the box by the ray radius, and a bit to make up for the
+    // single precision ray data
+    float dx, dy, dz;
+    wsbox.getSize(dx, dy, dz);
+    const float margin = PRIVATE(this)->packetmargin + SbMax(dx, SbMax(dy, dz)) * 1.0e-4f;
+    const SbVec3f grow(margin, margin, margin);
+    PRIVATE(this)->cullPacket(parent, packet, boxmin - grow, boxmax + grow);
+  }
+  return packet->num > 0;
+}
+
+/*!
+  \COININTERNAL
+
+  Restores the rays narrowed by the last call to pushRays().
+*/
+void
+SoRayPickAction::popRays(void)
+{
+  assert(PRIVATE(this)->packetlevel > 0);
+  PRIVATE(this)->packetlevel--;
+}
+
+/*!
+  \COININTERNAL
+
+  Picks \a node, which should be a shape, with every ray of a
+  batched pick which may intersect its bounding box.
+*/
+void
+SoRayPickAction::traverseRays(SoNode * node)
+{
+  if (!this->hasWorldSpaceRay()) return;
+  assert(node->isOfType(SoShape::getClassTypeId()));
+  SoShape * shape = static_cast<SoShape *>(node);
+
+  SbBox3f box;
+  const SoBoundingBoxCache * bboxcache = shape->getBoundingBoxCache();
+  if (bboxcache && bboxcache->isValid(this->state)) {
+    box = bboxcache->getProjectedBox();
+  }
+  else {
+    SbVec3f center;
+    shape->computeBBox(this, box, center);
+  }
+  if (this->pushRays(box)) {
+    // the object space matrices are the same for all the rays
+    PRIVATE(this)->clearFlag(SoRayPickActionP::EXTRA_MATRIX);
+    PRIVATE(this)->calcMatrices(this->state);
+    PRIVATE(this)->batchobj2world = PRIVATE(this)->obj2world;
+    PRIVATE(this)->batchworld2obj = PRIVATE(this)->world2obj;
+    PRIVATE(this)->setFlag(SoRayPickActionP::BATCH_MATRICES);
+
+    const SoRayPickActionP::RayPacket * packet =
+      PRIVATE(this)->getPacket(PRIVATE(this)->packetlevel);
+    for (int i = 0; i < packet->num; i++) {
+      const int ray = packet->index[i];
+      PRIVATE(this)->loadRay(ray);
+      shape->rayPick(this);
+      PRIVATE(this)->storeRay(ray);
+    }
+    PRIVATE(this)->clearFlag(SoRayPickActionP::BATCH_MATRICES);
+  }
+  this->popRays();
+}
+
 /*!
   Truncates the internal picked points list.
 
@@ -1058,6 +1217,18 @@ SoRayPickAction::beginTraversal(SoNode * node)
   if (PRIVATE(this)->isFlagSet(SoRayPickActionP::WS_RAY_SET)) {
     SoPickRayElement::set(state, PRIVATE(this)->wsvolume);
   }
+  if (PRIVATE(this)->batchrays.getLength()) {
+    // world space rays can be culled right away, the others when a
+    // camera has computed them
+    PRIVATE(this)->packetsvalid = FALSE;
+    PRIVATE(this)->packetlevel = 0;
+    if (PRIVATE(this)->isFlagSet(SoRayPickActionP::WS_RAY_SET)) {
+      PRIVATE(this)->buildPackets();
+    }
+    else {
+      PRIVATE(this)->fillPacket(PRIVATE(this)->getPacket(0));
+    }
+  }
   inherited::beginTraversal(node);
   this->getState()->pop();
 }
@@ -1092,6 +1263,12 @@ SoRayPickActionP::cleanupPickedPoints(void)
   this->pickedpointlist.truncate(0); // this will delete all SoPickedPoint instances in the list
   this->ppdistance.truncate(0);
   this->clearFlag(PPLIST_IS_SORTED);
+  for (int i = 0; i < this->batchrays.getLength(); i++) {
+    BatchRay * ray = this->batchrays[i];
+    ray->pickedpointlist.truncate(0);
+    ray->ppdistance.truncate(0);
+    ray->flags &= ~PPLIST_IS_SORTED;
+  }
 }
 
 void
@@ -1139,6 +1316,12 @@ SoRayPickActionP::calcObjectSpaceData(SoState * ownerstate)
 void
 SoRayPickActionP::calcMatrices(SoState * state)
 {
+  if (this->isFlagSet(BATCH_MATRICES) && !this->isFlagSet(EXTRA_MATRIX)) {
+    this->obj2world = this->batchobj2world;
+    this->world2obj = this->batchworld2obj;
+    this->objectspacevalid = TRUE;
+    return;
+  }
   const SbMatrix & tmp = SoModelMatrixElement::get(state);
   this->obj2world = SbDPMatrix(tmp);
   if (this->isFlagSet(EXTRA_MATRIX)) {
@@ -1149,6 +1332,386 @@ SoRayPickActionP::calcMatrices(SoState * state)
   this->objectspacevalid = TRUE;
 }
 
+void
+SoRayPickActionP::setWorldSpaceRay(const SbVec3f & start, const SbVec3f & direction,
+                                   float neardistance, float fardistance)
+{
+#if COIN_DEBUG
+  if (direction == SbVec3f(0.0f, 0.0f, 0.0f)) {
+    SoDebugError::postWarning("SoRayPickAction::setRay",
+                              "Ray has no direction");
+
+  }
+#endif // COIN_DEBUG
+  if (neardistance >= 0.0f) this->setFlag(SoRayPickActionP::CLIP_NEAR);
+  else {
+    this->clearFlag(SoRayPickActionP::CLIP_NEAR);
+    neardistance = 1.0f;
+    // make sure neardistance is smaller than fardistance
+    if (fardistance > 0.0f && neardistance >= fardistance) {
+      neardistance = fardistance * 0.01f;
+    }
+  }
+
+  if (fardistance >= 0.0f) this->setFlag(SoRayPickActionP::CLIP_FAR);
+  else {
+    this->clearFlag(SoRayPickActionP::CLIP_FAR);
+    // just set to some value bigger than neardistance.
+    fardistance = neardistance + 10.0f;
+  }
+
+  // set these to some values. They will be set to better values
+  // in computeWorldSpaceRay() (when we know the view volume).
+  this->rayradiusstart = 0.01;
+  this->rayradiusdelta = 0.0;
+
+  this->raystart.setValue(start);
+  this->raydirection.setValue(direction);
+  (void) this->raydirection.normalize();
+  this->raynear = neardistance;
+  this->rayfar = fardistance;
+  this->wsline = SbDPLine(this->raystart,
+                          this->raystart + this->raydirection);
+
+  // D = shortest distance from origin to plane
+  const double D = this->raydirection.dot(this->raystart);
+  this->nearplane = SbDPPlane(this->raydirection, D + this->raynear);
+
+  this->setFlag(SoRayPickActionP::WS_RAY_SET);
+
+  // We use a real cone for picking, but keep pick view volume in sync to be
+  // compatible with OIV
+  this->wsvolume.perspective(0.0, 1.0, neardistance, fardistance);
+  this->wsvolume.translateCamera(start);
+  this->wsvolume.rotateCamera(SbRotation(SbVec3f(0.0f, 0.0f, -1.0f), direction));
+  this->setFlag(SoRayPickActionP::OSVOLUME_DIRTY);
+}
+
+void
+SoRayPickActionP::computeWorldSpaceRay(SoState * state)
+{
+  if (this->isFlagSet(SoRayPickActionP::WS_RAY_SET)) {
+    // set the ray radius to some very small value, since
+    // the user set the ray manually using setRay().
+    //
+    // FIXME: Wouldn't it be a nice new feature to be able to
+    // set the radius of the ray in setRay()? pederb, 2001-01-05
+    const SbViewVolume & vv = SoViewVolumeElement::get(state);
+    this->rayradiusstart = SbMin(vv.getWidth(), vv.getHeight()) * FLT_EPSILON;
+    this->rayradiusdelta = 0.0f;
+  }
+  else {
+    const SbViewVolume & vv = SoViewVolumeElement::get(state);
+    const SbViewportRegion & vp = SoViewportRegionElement::get(state);
+
+    if (!this->isFlagSet(SoRayPickActionP::NORM_POINT)) {
+      SbVec2s pt = this->vppoint - vp.getViewportOriginPixels();
+      SbVec2s size = vp.getViewportSizePixels();
+      this->normvppoint.setValue(float(pt[0]) / float(size[0]),
+                                 float(pt[1]) / float(size[1]));
+    }
+
+#if COIN_DEBUG
+    if (vv.getDepth() == 0.0f || vv.getWidth() == 0.0f || vv.getHeight() == 0.0f) {
+      SoDebugError::postWarning("SoRayPickAction::computeWorldSpaceRay",
+                                "invalid frustum: <%f, %f, %f>",
+                                vv.getWidth(), vv.getHeight(), vv.getDepth());
+      return;
+    }
+#endif // COIN_DEBUG
+
+    SbDPLine templine;
+    SbVec2d tmppt;
+    tmppt.setValue(this->normvppoint);
+    vv.getDPViewVolume().projectPointToLine(tmppt, templine);
+    this->raystart = templine.getPosition();
+    this->raydirection = templine.getDirection();
+
+    this->raynear = 0.0;
+    this->rayfar = vv.getDPViewVolume().getDepth();
+
+    SbVec2s vpsize = vp.getViewportSizePixels();
+    this->rayradiusstart = (double(vv.getHeight()) / double(vpsize[1]))*
+      double(this->radiusinpixels);
+    this->rayradiusdelta = 0.0;
+    if (vv.getProjectionType() == SbViewVolume::PERSPECTIVE) {
+      SbVec3d dir(0.0f, vv.getHeight()*0.5f, vv.getNearDist());
+      // no need to test here, we know vv isn't empty
+      (void) dir.normalize();
+      SbVec3d upperfar = dir * (vv.getNearDist()+vv.getDepth()) /
+        dir.dot(SbVec3d(0.0f, 0.0f, 1.0f));
+
+      double farheight = double(upperfar[1])*2.0;
+      double farsize = (farheight / double(vpsize[1])) * double(this->radiusinpixels);
+      this->rayradiusdelta = (farsize - this->rayradiusstart) / double(vv.getDepth());
+    }
+    this->wsline = SbDPLine(this->raystart,
+                            this->raystart + this->raydirection);
+
+    this->nearplane = SbDPPlane(vv.getDPViewVolume().getProjectionDirection(),
+					 this->raystart);
+    this->setFlag(SoRayPickActionP::WS_RAY_COMPUTED);
+
+    // we pick on a real cone, but keep pick view volume in sync to be
+    // compatible with OIV.
+    double normradius = double(this->radiusinpixels) /
+      double(SbMin(vp.getViewportSizePixels()[0], vp.getViewportSizePixels()[1]));
+
+    this->wsvolume = vv.narrow(float(this->normvppoint[0] - normradius),
+                               float(this->normvppoint[1] - normradius),
+                               float(this->normvppoint[0] + normradius),
+                               float(this->normvppoint[1] + normradius));
+    SoPickRayElement::set(state, this->wsvolume);
+    this->setFlag(SoRayPickActionP::OSVOLUME_DIRTY);
+  }
+}
+
+// sorts the picked points on their distance from the near plane
+void
+SoRayPickActionP::sortPickedPoints(SoPickedPointList & list, SbList <double> & distances)
+{
+  int n = list.getLength();
+  if (n < 2) return;
+  SoPickedPoint ** pparray = reinterpret_cast<SoPickedPoint **>(list.getArrayPtr());
+  double * darray = const_cast<double*>(distances.getArrayPtr());
+
+  int i, j, distance;
+  SoPickedPoint * pptmp;
+  double dtmp;
+
+  // shell sort algorithm (O(nlog(n))
+  for (distance = 1; distance <= n/9; distance = 3*distance + 1) ;
+  for (; distance > 0; distance /= 3) {
+    for (i = distance; i < n; i++) {
+      dtmp = darray[i];
+      pptmp = pparray[i];
+      j = i;
+      while (j >= distance && darray[j-distance] > dtmp) {
+        darray[j] = darray[j-distance];
+        pparray[j] = pparray[j-distance];
+        j -= distance;
+      }
+      darray[j] = dtmp;
+      pparray[j] = pptmp;
+    }
+  }
+}
+
+void
+SoRayPickActionP::clearRays(void)
+{
+  for (int i = 0; i < this->batchrays.getLength(); i++) {
+    delete this->batchrays[i]; // deletes the picked points
+  }
+  this->batchrays.truncate(0);
+  this->packetsvalid = FALSE;
+  this->packetlevel = 0;
+}
+
+// makes ray the one picked by the action. The picked points are moved
+// without copying, using SbPList::truncate() which leaves them alive.
+void
+SoRayPickActionP::loadRay(const int idx)
+{
+  BatchRay * ray = this->batchrays[idx];
+  this->normvppoint = ray->normvppoint;
+  this->raystart = ray->raystart;
+  this->raydirection = ray->raydirection;
+  this->rayradiusstart = ray->rayradiusstart;
+  this->rayradiusdelta = ray->rayradiusdelta;
+  this->raynear = ray->raynear;
+  this->rayfar = ray->rayfar;
+  this->wsline = ray->wsline;
+  this->nearplane = ray->nearplane;
+  this->flags = (this->flags & ~RAY_FLAGS) | (ray->flags & RAY_FLAGS);
+  this->setFlag(OSVOLUME_DIRTY);
+
+  assert(this->pickedpointlist.getLength() == 0);
+  const int n = ray->pickedpointlist.getLength();
+  for (int i = 0; i < n; i++) {
+    this->pickedpointlist.append(ray->pickedpointlist[i]);
+    this->ppdistance.append(ray->ppdistance[i]);
+  }
+  ray->pickedpointlist.SbPList::truncate(0);
+  ray->ppdistance.truncate(0);
+}
+
+void
+SoRayPickActionP::storeRay(const int idx)
+{
+  BatchRay * ray = this->batchrays[idx];
+  ray->normvppoint = this->normvppoint;
+  ray->raystart = this->raystart;
+  ray->raydirection = this->raydirection;
+  ray->rayradiusstart = this->rayradiusstart;
+  ray->rayradiusdelta = this->rayradiusdelta;
+  ray->raynear = this->raynear;
+  ray->rayfar = this->rayfar;
+  ray->wsline = this->wsline;
+  ray->nearplane = this->nearplane;
+  ray->flags = this->flags & RAY_FLAGS;
+
+  const int n = this->pickedpointlist.getLength();
+  for (int i = 0; i < n; i++) {
+    ray->pickedpointlist.append(this->pickedpointlist[i]);
+    ray->ppdistance.append(this->ppdistance[i]);
+  }
+  this->pickedpointlist.SbPList::truncate(0);
+  this->ppdistance.truncate(0);
+}
+
+SoRayPickActionP::RayPacket *
+SoRayPickActionP::getPacket(const int level)
+{
+  const int size = this->batchrays.getLength();
+  while (this->packets.getLength() <= level) {
+    this->packets.append(new RayPacket(size));
+  }
+  RayPacket * packet = this->packets[level];
+  if (packet->size < size) {
+    delete packet;
+    packet = new RayPacket(size);
+    this->packets[level] = packet;
+  }
+  return packet;
+}
+
+// sets up packet to hold all the rays
+void
+SoRayPickActionP::fillPacket(RayPacket * packet)
+{
+  const int numrays = this->batchrays.getLength();
+  if (!this->packetsvalid) {
+    for (int i = 0; i < numrays; i++) packet->index[i] = i;
+    packet->num = numrays;
+    return;
+  }
+  RayPacket * all = this->packets[0];
+  if (packet != all) {
+    for (int c = 0; c < PACKET_COMPONENTS; c++) {
+      memcpy(packet->component(c), all->component(c), sizeof(float) * numrays);
+    }
+    for (int i = 0; i < numrays; i++) packet->index[i] = all->index[i];
+  }
+  packet->num = numrays;
+}
+
+// inverse of a ray direction component, huge instead of infinite for
+// axis aligned rays
+static inline float
+soraypick_inverse(const double d)
+{
+  if (fabs(d) > 1.0e-20) return float(1.0 / d);
+  return d < 0.0 ? -1.0e30f : 1.0e30f;
+}
+
+// converts the rays to the single precision world space form used
+// for culling, and resets all packets in use to hold all the rays.
+void
+SoRayPickActionP::buildPackets(void)
+{
+  const int numrays = this->batchrays.getLength();
+  RayPacket * all = this->getPacket(0);
+  float * ox = all->component(ORIGIN_X);
+  float * oy = all->component(ORIGIN_Y);
+  float * oz = all->component(ORIGIN_Z);
+  float * ix = all->component(INVDIR_X);
+  float * iy = all->component(INVDIR_Y);
+  float * iz = all->component(INVDIR_Z);
+  float * tmin = all->component(TMIN);
+  float * tmax = all->component(TMAX);
+
+  this->packetmargin = 0.0f;
+  for (int i = 0; i < numrays; i++) {
+    const BatchRay * ray = this->batchrays[i];
+    if (!(ray->flags & (WS_RAY_SET|WS_RAY_COMPUTED))) {
+      this->packetmargin = -1.0f;
+      break;
+    }
+    ox[i] = float(ray->raystart[0]);
+    oy[i] = float(ray->raystart[1]);
+    oz[i] = float(ray->raystart[2]);
+    ix[i] = soraypick_inverse(ray->raydirection[0]);
+    iy[i] = soraypick_inverse(ray->raydirection[1]);
+    iz[i] = soraypick_inverse(ray->raydirection[2]);
+
+    // the near and far planes as distances along the ray
+    const double cosangle = ray->nearplane.getNormal().dot(ray->raydirection);
+    const double startdist = ray->nearplane.getDistance(ray->raystart);
+    double tnear = -DBL_MAX;
+    double tfar = DBL_MAX;
+    if (cosangle > 1.0e-6) {
+      if (ray->flags & CLIP_NEAR) tnear = -startdist / cosangle;
+      if (ray->flags & CLIP_FAR) tfar = (ray->rayfar - ray->raynear - startdist) / cosangle;
+    }
+    tmin[i] = tnear == -DBL_MAX ? -FLT_MAX : float(tnear - (fabs(tnear) + 1.0) * 1.0e-4);
+    tmax[i] = tfar == DBL_MAX ? FLT_MAX : float(tfar + (fabs(tfar) + 1.0) * 1.0e-4);
+
+    // the widest the ray gets, for lines and points
+    double radius = ray->rayradiusstart;
+    if (ray->rayradiusdelta > 0.0) {
+      if (!(ray->flags & CLIP_FAR)) {
+        this->packetmargin = -1.0f;
+        break;
+      }
+      radius += ray->rayradiusdelta * (ray->rayfar - ray->raynear);
+    }
+    this->packetmargin = SbMax(this->packetmargin, float(radius));
+  }
+  for (int i = 0; i < numrays; i++) all->index[i] = i;
+  all->num = numrays;
+
+  this->packetsvalid = this->packetmargin >= 0.0f;
+  for (int level = 1; level <= this->packetlevel; level++) {
+    this->fillPacket(this->getPacket(level));
+  }
+}
+
+// moves the rays of in which intersect the box to out
+void
+SoRayPickActionP::cullPacket(const RayPacket * in, RayPacket * out,
+                             const SbVec3f & boxmin, const SbVec3f & boxmax) const
+{
+  const int n = in->num;
+  const float minx = boxmin[0], miny = boxmin[1], minz = boxmin[2];
+  const float maxx = boxmax[0], maxy = boxmax[1], maxz = boxmax[2];
+  const float * ox = in->component(ORIGIN_X);
+  const float * oy = in->component(ORIGIN_Y);
+  const float * oz = in->component(ORIGIN_Z);
+  const float * ix = in->component(INVDIR_X);
+  const float * iy = in->component(INVDIR_Y);
+  const float * iz = in->component(INVDIR_Z);
+  const float * tmin = in->component(TMIN);
+  const float * tmax = in->component(TMAX);
+  unsigned char * hit = in->hit;
+
+  // slab test, without branches so it vectorizes
+  for (int i = 0; i < n; i++) {
+    const float tx0 = (minx - ox[i]) * ix[i];
+    const float tx1 = (maxx - ox[i]) * ix[i];
+    const float ty0 = (miny - oy[i]) * iy[i];
+    const float ty1 = (maxy - oy[i]) * iy[i];
+    const float tz0 = (minz - oz[i]) * iz[i];
+    const float tz1 = (maxz - oz[i]) * iz[i];
+    const float tnear = SbMax(SbMax(SbMin(tx0, tx1), SbMin(ty0, ty1)),
+                              SbMax(SbMin(tz0, tz1), tmin[i]));
+    const float tfar = SbMin(SbMin(SbMax(tx0, tx1), SbMax(ty0, ty1)),
+                             SbMin(SbMax(tz0, tz1), tmax[i]));
+    hit[i] = tnear <= tfar;
+  }
+
+  int num = 0;
+  for (int i = 0; i < n; i++) {
+    if (hit[i]) {
+      for (int c = 0; c < PACKET_COMPONENTS; c++) {
+        out->component(c)[num] = in->component(c)[i];
+      }
+      out->index[num++] = in->index[i];
+    }
+  }
+  out->num = num;
+}
+
 void
 SoRayPickActionP::setPickStyleFlags(SoState * state)
 {
@@ -160,6 +160,8 @@ SoWriteAction::commonConstructor(SoOutput * out)
 
   this->outobj = out;
   this->continuing = FALSE;
+  // writing never looks at the current path
+  this->setNeedsCurPath(FALSE);
 }
 
 /*!
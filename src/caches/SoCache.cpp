@@ -115,6 +115,7 @@
 
 #include <Inventor/caches/SoCache.h>
 
+#include <atomic>
 #include <cstring>
 #include <cassert>
 
@@ -138,7 +139,8 @@ class SoCacheP {
 public:
   SbList <SoElement *> elements;
   unsigned char * elementflags;
-  int refcount;
+  // caches are shared between threads rendering the same scene graph
+  std::atomic<int> refcount;
   SbBool invalidated;
   int statedepth;
 };
@@ -58,6 +58,7 @@
 #include "C/CoinTidbits.h"
 #include "glue/glp.h"
 #include "rendering/SoGL.h"
+#include "rendering/SoRenderStatisticsP.h"
 
 // *************************************************************************
 
@@ -204,6 +205,7 @@ SoGLCacheList::call(SoGLRenderAction * action)
         SoGLLazyElement::postCacheCall(state, cache->getPostLazyState());
         cache->unref(state);
         PRIVATE(this)->numused++;
+        SoRenderStatisticsP::count(SoRenderStatistics::RENDER_CACHE_HITS);
 
 #if COIN_DEBUG
         // The GL error test is default disabled for this optimized
@@ -447,6 +449,7 @@ SoGLCacheList::call(SoGLRenderAction * action)
     }
   }
 #endif // debug
+  SoRenderStatisticsP::count(SoRenderStatistics::RENDER_CACHE_MISSES);
   return FALSE;
 }
 
@@ -538,6 +541,7 @@ SoGLCacheList::open(SoGLRenderAction * action, SbBool autocache)
       PRIVATE(this)->numdiscarded++;
     }
     PRIVATE(this)->opencache = new SoGLRenderCache(state);
+    SoRenderStatisticsP::count(SoRenderStatistics::RENDER_CACHES_CREATED);
     PRIVATE(this)->opencache->ref();
     SoCacheElement::set(state, PRIVATE(this)->opencache);
     SoGLLazyElement::beginCaching(state, PRIVATE(this)->opencache->getPreLazyState(),
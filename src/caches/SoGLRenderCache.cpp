@@ -47,6 +47,8 @@
 #include <Inventor/elements/SoCacheElement.h>
 #include <Inventor/lists/SbList.h>
 #include "misc/SoEnvironment.h"
+#include "rendering/SoGLResourceManagerP.h"
+#include "rendering/SoRenderStatisticsP.h"
 
 // *************************************************************************
 
@@ -57,6 +59,8 @@ public:
   SbList <SoGLDisplayList*> nestedcachelist;
   SoGLLazyElement::GLState prestate;
   SoGLLazyElement::GLState poststate;
+  // what was counted while the display list was recorded
+  SoRenderStatistics recorded;
 };
 
 #define PRIVATE(obj) ((obj)->pimpl)
@@ -102,6 +106,7 @@ SoGLRenderCache::open(SoState * state)
     new SoGLDisplayList(state, SoGLDisplayList::DISPLAY_LIST);
   PRIVATE(this)->displaylist->ref();
   PRIVATE(this)->displaylist->open(state);
+  SoRenderStatisticsP::beginRecording(PRIVATE(this)->recorded);
 }
 
 /*!
@@ -114,6 +119,7 @@ SoGLRenderCache::close(void)
 {
   assert(PRIVATE(this)->openstate != NULL);
   assert(PRIVATE(this)->displaylist != NULL);
+  SoRenderStatisticsP::endRecording(PRIVATE(this)->recorded);
   PRIVATE(this)->displaylist->close(PRIVATE(this)->openstate);
   PRIVATE(this)->openstate = NULL;
 }
@@ -157,6 +163,7 @@ SoGLRenderCache::call(SoState * state)
     SoCacheElement::invalidate(state); // destroy any parent caches
     PRIVATE(this)->displaylist->call(state);
   }
+  SoRenderStatisticsP::replay(PRIVATE(this)->recorded);
 }
 
 /*!
@@ -190,6 +197,11 @@ SoGLRenderCache::addNestedCache(SoGLDisplayList * child)
 {
   child->ref();
   PRIVATE(this)->nestedcachelist.append(child);
+  // this cache's display list refers to the texture object by name,
+  // so it can't be evicted and recreated with a new name
+  if (child->getType() == SoGLDisplayList::TEXTURE_OBJECT) {
+    SoGLResourceManagerP::pin(child->getContext(), child);
+  }
 }
 
 // Documented in superclass. Overridden to unref display lists.
@@ -198,7 +210,11 @@ SoGLRenderCache::destroy(SoState * state)
 {
   int n = PRIVATE(this)->nestedcachelist.getLength();
   for (int i = 0; i < n; i++) {
-    PRIVATE(this)->nestedcachelist[i]->unref(state);
+    SoGLDisplayList * child = PRIVATE(this)->nestedcachelist[i];
+    if (child->getType() == SoGLDisplayList::TEXTURE_OBJECT) {
+      SoGLResourceManagerP::unpin(child->getContext(), child);
+    }
+    child->unref(state);
   }
   PRIVATE(this)->nestedcachelist.truncate(0);
   if (PRIVATE(this)->displaylist) {
@@ -48,6 +48,10 @@
 
 #include <Inventor/caches/SoPrimitiveVertexCache.h>
 
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
 #include <cstddef>
 #include <cstdlib>
 #include <cstring>
@@ -75,10 +79,11 @@
 #include <Inventor/SbPlane.h>
 #include <Inventor/errors/SoDebugError.h>
 #include <Inventor/misc/SoGLDriverDatabase.h>
+#include <Inventor/threads/SbMutex.h>
 
 
-#include "misc/SbHash.h"
 #include "rendering/SoGL.h"
+#include "rendering/SoRenderStatisticsP.h"
 #include "rendering/SoVBO.h"
 #include "rendering/SoVertexArrayIndexer.h"
 #include "SbBasicP.h"
@@ -94,7 +99,6 @@ public:
       bumpcoordlist(256),
       rgbalist(256),
       tangentlist(256),
-      vhash(1024),
       deptharray(NULL),
       triangleindexer(NULL),
       lineindexer(NULL),
@@ -125,32 +129,34 @@ public:
     delete[] deptharray;
   }
 
-  class Vertex {
-  public:
-    SbVec3f vertex;
-    SbVec3f normal;
-    SbVec4f texcoord0;
-    SbVec2f bumpcoord;
-    uint8_t rgba[4];
-    int texcoordidx;
-
-    // needed for SbHash
-    operator unsigned long(void) const;
-
-    // needed, since if we don't add this the unsigned long operator
-    // will be used when comparing two vertices.
-    int operator==(const Vertex & v);
-  };
-
-  SbList <Vertex> vertices;
-
+  // The VBOs are created by the first thread to render the cache, and
+  // the cache can be shared by threads rendering into different
+  // contexts.
+#ifdef COIN_THREADSAFE
+  mutable SbMutex rendermutex;
+  void lockRender(void) const { this->rendermutex.lock(); }
+  void unlockRender(void) const { this->rendermutex.unlock(); }
+#else // ! COIN_THREADSAFE
+  void lockRender(void) const { }
+  void unlockRender(void) const { }
+#endif // ! COIN_THREADSAFE
+
+  // one tightly packed list per vertex attribute. Colors are packed
+  // as four bytes in RGBA order.
   SbList <SbVec3f> vertexlist;
   SbList <SbVec3f> normallist;
   SbList <SbVec4f> texcoordlist;
   SbList <SbVec2f> bumpcoordlist;
-  SbList <uint8_t> rgbalist;
+  SbList <uint32_t> rgbalist;
   SbList <SbVec3f> tangentlist;
-  SbHash<Vertex, int32_t> vhash;
+
+  // Used to weld identical vertices while the cache is built, and
+  // freed by fit(). The weld table is an open addressing hash table
+  // of vertex indices (-1 for empty slots), so vertices are compared
+  // directly in the attribute lists instead of being copied into the
+  // table.
+  SbList <int32_t> texcoordidxlist;
+  SbList <int32_t> weldtable;
 
   const SbVec2f * bumpcoords;
   int numbumpcoords;
@@ -187,7 +193,14 @@ public:
   SoGLLazyElement::GLState prestate;
   SoGLLazyElement::GLState poststate;
 
-  void addVertex(const Vertex & v);
+  int32_t addVertex(const SoPrimitiveVertex * pv, const SoPointDetail * pd);
+  uint32_t hashVertex(const int32_t idx) const;
+  SbBool equalVertex(const int32_t idx,
+                     const SbVec3f & v, const SbVec3f & n,
+                     const SbVec4f & tc, const SbVec2f & bc,
+                     const uint32_t rgba, const int32_t tcidx) const;
+  void growWeldTable(void);
+  void reorderVertices(void);
 
   void renderImmediate(const cc_glglue * glue,
                        const GLint * indices,
@@ -377,9 +390,11 @@ SoPrimitiveVertexCache::renderTriangles(SoState * state, const int arrays) const
 
     SoPrimitiveVertexCacheP * thisp = const_cast<SoPrimitiveVertexCacheP *>(&PRIVATE(this).get());
 
+    thisp->lockRender();
     thisp->enableVBOs(glue, contextid, color, normal, texture, enabled, lastenabled);
     PRIVATE(this)->triangleindexer->render(glue, TRUE, contextid);
     thisp->disableVBOs(glue, color, normal, texture, enabled, lastenabled);
+    thisp->unlockRender();
   }
   else if (SoGLDriverDatabase::isSupported(glue, SO_GL_VERTEX_ARRAY)) {
     SoPrimitiveVertexCacheP * thisp = const_cast<SoPrimitiveVertexCacheP *>(&PRIVATE(this).get());
@@ -396,6 +411,7 @@ SoPrimitiveVertexCache::renderTriangles(SoState * state, const int arrays) const
                            this->getNumTriangleIndices(),
                            color, normal, texture, enabled, lastenabled);
     glEnd();
+    SoRenderStatisticsP::countDraw(GL_TRIANGLES, this->getNumTriangleIndices());
   }
 
   // inform SoGLLazyElement that we might have changed the current color
@@ -501,70 +517,18 @@ SoPrimitiveVertexCache::addTriangle(const SoPrimitiveVertex * v0,
   int32_t triangleindices[3];
 
   for (int i = 0; i < 3; i++) {
-    SoPrimitiveVertexCacheP::Vertex v;
-    v.vertex = vp[i]->getPoint();
-    v.normal = vp[i]->getNormal();
-    const SbVec4f & tmp = vp[i]->getTextureCoords();
-    v.bumpcoord = SbVec2f(tmp[0], tmp[1]);
-    v.texcoord0 = tmp;
-    v.texcoordidx = -1;
-
-    int midx = vp[i]->getMaterialIndex();
-    uint32_t col;
-    if (PRIVATE(this)->packedptr) {
-      col = PRIVATE(this)->packedptr[SbClamp(midx, 0, PRIVATE(this)->numdiffuse-1)];
-    }
-    else {
-      SbColor tmpc = PRIVATE(this)->diffuseptr[SbClamp(midx,0,PRIVATE(this)->numdiffuse-1)];
-      float tmpt = PRIVATE(this)->transpptr[SbClamp(midx,0,PRIVATE(this)->numtransp-1)];
-      col = tmpc.getPackedValue(tmpt);
-    }
-    if (col != PRIVATE(this)->firstcolor) PRIVATE(this)->colorpervertex = TRUE;
-
-    v.rgba[0] = col>>24;
-    v.rgba[1] = (col>>16)&0xff;
-    v.rgba[2] = (col>>8)&0xff;
-    v.rgba[3] = col&0xff;
-
+    const SoPointDetail * pd = NULL;
     const SoDetail * d = coin_safe_cast<const SoDetail *>(vp[i]->getDetail());
 
     if (d && d->isOfType(SoFaceDetail::getClassTypeId()) && pointdetailidx) {
       const SoFaceDetail * fd = coin_assert_cast<const SoFaceDetail *>(d);
       assert(pointdetailidx[i] < fd->getNumPoints());
 
-      const SoPointDetail * pd = coin_assert_cast<const SoPointDetail *>(
+      pd = coin_assert_cast<const SoPointDetail *>(
         fd->getPoint(pointdetailidx[i])
        );
-
-      int tidx  = v.texcoordidx = pd->getTextureCoordIndex();
-      if (PRIVATE(this)->numbumpcoords) {
-        v.bumpcoord = PRIVATE(this)->bumpcoords[SbClamp(tidx, 0, PRIVATE(this)->numbumpcoords-1)];
-      }
-    }
-    int32_t idx;
-    if (!PRIVATE(this)->vhash.get(v, idx)) {
-      idx = PRIVATE(this)->vertexlist.getLength();
-      PRIVATE(this)->vhash.put(v, idx);
-      PRIVATE(this)->addVertex(v);
-      triangleindices[i] = idx;
-
-      // update texture coordinates for unit 1-n
-      for (int j = 1; j <= PRIVATE(this)->lastenabled; j++) {
-        if (v.texcoordidx >= 0 &&
-            (PRIVATE(this)->multielem->getType(j) == SoMultiTextureCoordinateElement::EXPLICIT)) {
-          PRIVATE(this)->multitexcoords[j].append(PRIVATE(this)->multielem->get4(j, v.texcoordidx));
-        }
-        else if (PRIVATE(this)->multielem->getType(j) == SoMultiTextureCoordinateElement::FUNCTION) {
-          PRIVATE(this)->multitexcoords[j].append(PRIVATE(this)->multielem->get(j, v.vertex, v.normal));
-        }
-        else {
-          PRIVATE(this)->multitexcoords[j].append(v.texcoord0);
-        }
-      }
-    }
-    else {
-      triangleindices[i] = idx;
     }
+    triangleindices[i] = PRIVATE(this)->addVertex(vp[i], pd);
   }
   if (PRIVATE(this)->triangleindexer == NULL) {
     PRIVATE(this)->triangleindexer = new SoVertexArrayIndexer;
@@ -587,68 +551,15 @@ SoPrimitiveVertexCache::addLine(const SoPrimitiveVertex * v0,
   int32_t lineindices[2];
 
   for (int i = 0; i < 2; i++) {
-    SoPrimitiveVertexCacheP::Vertex v;
-    v.vertex = vp[i]->getPoint();
-    v.normal = vp[i]->getNormal();
-    const SbVec4f & tmp = vp[i]->getTextureCoords();
-    v.bumpcoord = SbVec2f(tmp[0], tmp[1]);
-    v.texcoord0 = tmp;
-    v.texcoordidx = -1;
-
-    int midx = vp[i]->getMaterialIndex();
-    uint32_t col;
-    if (PRIVATE(this)->packedptr) {
-      col = PRIVATE(this)->packedptr[SbClamp(midx, 0, PRIVATE(this)->numdiffuse-1)];
-    }
-    else {
-      SbColor tmpc = PRIVATE(this)->diffuseptr[SbClamp(midx,0,PRIVATE(this)->numdiffuse-1)];
-      float tmpt = PRIVATE(this)->transpptr[SbClamp(midx,0,PRIVATE(this)->numtransp-1)];
-      col = tmpc.getPackedValue(tmpt);
-    }
-    if (col != PRIVATE(this)->firstcolor) PRIVATE(this)->colorpervertex = TRUE;
-
-    v.rgba[0] = col>>24;
-    v.rgba[1] = (col>>16)&0xff;
-    v.rgba[2] = (col>>8)&0xff;
-    v.rgba[3] = col&0xff;
-
+    const SoPointDetail * pd = NULL;
     const SoDetail * d = coin_assert_cast<const SoDetail *>(vp[i]->getDetail());
 
     if (d && d->isOfType(SoLineDetail::getClassTypeId())) {
       const SoLineDetail * ld = coin_assert_cast<const SoLineDetail *>(d);
-      const SoPointDetail * pd;
       if (i == 0) pd = ld->getPoint0();
       else pd = ld->getPoint1();
-
-      int tidx  = v.texcoordidx = coin_assert_cast<const SoPointDetail *>(pd)->getTextureCoordIndex();
-      if (PRIVATE(this)->numbumpcoords) {
-        v.bumpcoord = PRIVATE(this)->bumpcoords[SbClamp(tidx, 0, PRIVATE(this)->numbumpcoords-1)];
-      }
-    }
-    int32_t idx;
-    if (!PRIVATE(this)->vhash.get(v, idx)) {
-      idx = PRIVATE(this)->vertexlist.getLength();
-      PRIVATE(this)->vhash.put(v, idx);
-      PRIVATE(this)->addVertex(v);
-      lineindices[i] = idx;
-
-      // update texture coordinates for unit 1-n
-      for (int j = 1; j <= PRIVATE(this)->lastenabled; j++) {
-        if (v.texcoordidx >= 0 &&
-            (PRIVATE(this)->multielem->getType(j) == SoMultiTextureCoordinateElement::EXPLICIT)) {
-          PRIVATE(this)->multitexcoords[j].append(PRIVATE(this)->multielem->get4(j, v.texcoordidx));
-        }
-        else if (PRIVATE(this)->multielem->getType(j) == SoMultiTextureCoordinateElement::FUNCTION) {
-          PRIVATE(this)->multitexcoords[j].append(PRIVATE(this)->multielem->get(j, v.vertex, v.normal));
-        }
-        else {
-          PRIVATE(this)->multitexcoords[j].append(v.texcoord0);
-        }
-      }
-    }
-    else {
-      lineindices[i] = idx;
     }
+    lineindices[i] = PRIVATE(this)->addVertex(vp[i], pd);
   }
   if (PRIVATE(this)->lineindexer == NULL) {
     PRIVATE(this)->lineindexer = new SoVertexArrayIndexer;
@@ -663,69 +574,17 @@ SoPrimitiveVertexCache::addPoint(const SoPrimitiveVertex * v0)
     // fetch SoMultiTextureCoordinateElement the first time we get here
     PRIVATE(this)->multielem = SoMultiTextureCoordinateElement::getInstance(PRIVATE(this)->state);
   }
-  SoPrimitiveVertexCacheP::Vertex v;
-  v.vertex = v0->getPoint();
-  v.normal = v0->getNormal();
-  const SbVec4f & tmp = v0->getTextureCoords();
-  v.bumpcoord = SbVec2f(tmp[0], tmp[1]);
-  v.texcoord0 = tmp;
-  v.texcoordidx = -1;
-
-  int midx = v0->getMaterialIndex();
-  uint32_t col;
-  if (PRIVATE(this)->packedptr) {
-    col = PRIVATE(this)->packedptr[SbClamp(midx, 0, PRIVATE(this)->numdiffuse-1)];
-  }
-  else {
-    SbColor tmpc = PRIVATE(this)->diffuseptr[SbClamp(midx,0,PRIVATE(this)->numdiffuse-1)];
-    float tmpt = PRIVATE(this)->transpptr[SbClamp(midx,0,PRIVATE(this)->numtransp-1)];
-    col = tmpc.getPackedValue(tmpt);
-  }
-  if (col != PRIVATE(this)->firstcolor) PRIVATE(this)->colorpervertex = TRUE;
-
-  v.rgba[0] = col>>24;
-  v.rgba[1] = (col>>16)&0xff;
-  v.rgba[2] = (col>>8)&0xff;
-  v.rgba[3] = col&0xff;
-
+  const SoPointDetail * pd = NULL;
   const SoDetail * d = coin_assert_cast<const SoDetail *>(v0->getDetail());
 
   if (d && d->isOfType(SoPointDetail::getClassTypeId())) {
-    const SoPointDetail * pd = coin_assert_cast<const SoPointDetail *>(d);
-    int tidx  = v.texcoordidx = pd->getTextureCoordIndex();
-    if (PRIVATE(this)->numbumpcoords) {
-      v.bumpcoord = PRIVATE(this)->bumpcoords[SbClamp(tidx, 0, PRIVATE(this)->numbumpcoords-1)];
-    }
+    pd = coin_assert_cast<const SoPointDetail *>(d);
   }
 
   if (PRIVATE(this)->pointindexer == NULL) {
     PRIVATE(this)->pointindexer = new SoVertexArrayIndexer;
   }
-
-  int32_t idx;
-  if (!PRIVATE(this)->vhash.get(v, idx)) {
-    idx = PRIVATE(this)->vertexlist.getLength();
-    PRIVATE(this)->vhash.put(v, idx);
-    PRIVATE(this)->addVertex(v);
-    PRIVATE(this)->pointindexer->addPoint(idx);
-
-    // update texture coordinates for unit 1-n
-    for (int j = 1; j <= PRIVATE(this)->lastenabled; j++) {
-      if (v.texcoordidx >= 0 &&
-          (PRIVATE(this)->multielem->getType(j) == SoMultiTextureCoordinateElement::EXPLICIT)) {
-        PRIVATE(this)->multitexcoords[j].append(PRIVATE(this)->multielem->get4(j, v.texcoordidx));
-      }
-      else if (PRIVATE(this)->multielem->getType(j) == SoMultiTextureCoordinateElement::FUNCTION) {
-        PRIVATE(this)->multitexcoords[j].append(PRIVATE(this)->multielem->get(j, v.vertex, v.normal));
-      }
-      else {
-        PRIVATE(this)->multitexcoords[j].append(v.texcoord0);
-      }
-    }
-  }
-  else {
-    PRIVATE(this)->pointindexer->addPoint(idx);
-  }
+  PRIVATE(this)->pointindexer->addPoint(PRIVATE(this)->addVertex(v0, pd));
 }
 
 int
@@ -761,7 +620,7 @@ SoPrimitiveVertexCache::getBumpCoordArray(void) const
 const uint8_t *
 SoPrimitiveVertexCache::getColorArray(void) const
 {
-  return PRIVATE(this)->rgbalist.getArrayPtr();
+  return reinterpret_cast<const uint8_t *>(PRIVATE(this)->rgbalist.getArrayPtr());
 }
 
 int
@@ -832,11 +691,14 @@ SoPrimitiveVertexCache::fit(void)
   PRIVATE(this)->texcoordlist.fit();
   PRIVATE(this)->bumpcoordlist.fit();
   PRIVATE(this)->rgbalist.fit();
-  PRIVATE(this)->vhash.clear();
+  PRIVATE(this)->texcoordidxlist.truncate(0, TRUE);
+  PRIVATE(this)->weldtable.truncate(0, TRUE);
 
   if (PRIVATE(this)->triangleindexer) PRIVATE(this)->triangleindexer->close();
   if (PRIVATE(this)->lineindexer) PRIVATE(this)->lineindexer->close();
   if (PRIVATE(this)->pointindexer) PRIVATE(this)->pointindexer->close();
+
+  if (SoVertexArrayIndexer::optimizeVertexCache()) PRIVATE(this)->reorderVertices();
 }
 
 void
@@ -896,48 +758,198 @@ SoPrimitiveVertexCache::depthSortTriangles(SoState * state)
   }
 }
 
-SoPrimitiveVertexCacheP::Vertex::operator unsigned long(void) const
+// FNV-1a over the 32 bit words of the attributes
+static inline uint32_t
+pvcache_hash(uint32_t h, const float * values, const int num)
 {
-  unsigned long key = 0;
-  // create an xor key based on coordinates, normal and texcoords
-  const unsigned char * ptr = reinterpret_cast<const unsigned char *>(this);
+  for (int i = 0; i < num; i++) {
+    uint32_t bits;
+    (void)memcpy(&bits, &values[i], sizeof(uint32_t));
+    h = (h ^ bits) * 16777619u;
+  }
+  return h;
+}
 
-  // a bit hackish. Stop xor'ing at bumpcoord
-  const unsigned char * stop = reinterpret_cast<const unsigned char *>(&this->bumpcoord);
-  const ptrdiff_t size = stop-ptr;
+static inline uint32_t
+pvcache_hash_vertex(const SbVec3f & v, const SbVec3f & n, const SbVec4f & tc,
+                    const uint32_t rgba, const int32_t tcidx)
+{
+  uint32_t h = 2166136261u;
+  h = pvcache_hash(h, v.getValue(), 3);
+  h = pvcache_hash(h, n.getValue(), 3);
+  h = pvcache_hash(h, tc.getValue(), 4);
+  h = (h ^ rgba) * 16777619u;
+  h = (h ^ static_cast<uint32_t>(tcidx)) * 16777619u;
+  // the low bits are used as the table index, so mix in the high bits
+  return h ^ (h >> 15);
+}
 
-  for (int i = 0; i < size; i++) {
-    int shift = (i%4) * 8;
-    key ^= (ptr[i]<<shift);
-  }
-  return key;
+uint32_t
+SoPrimitiveVertexCacheP::hashVertex(const int32_t idx) const
+{
+  return pvcache_hash_vertex(this->vertexlist[idx], this->normallist[idx],
+                             this->texcoordlist[idx], this->rgbalist[idx],
+                             this->texcoordidxlist[idx]);
 }
 
-int
-SoPrimitiveVertexCacheP::Vertex::operator==(const Vertex & v)
+SbBool
+SoPrimitiveVertexCacheP::equalVertex(const int32_t idx,
+                                     const SbVec3f & v, const SbVec3f & n,
+                                     const SbVec4f & tc, const SbVec2f & bc,
+                                     const uint32_t rgba, const int32_t tcidx) const
 {
   return
-    (this->vertex == v.vertex) &&
-    (this->normal == v.normal) &&
-    (this->texcoord0 == v.texcoord0) &&
-    (this->bumpcoord == v.bumpcoord) &&
-    (this->texcoordidx == v.texcoordidx) &&
-    (this->rgba[0] == v.rgba[0]) &&
-    (this->rgba[1] == v.rgba[1]) &&
-    (this->rgba[2] == v.rgba[2]) &&
-    (this->rgba[3] == v.rgba[3]);
+    (this->vertexlist[idx] == v) &&
+    (this->normallist[idx] == n) &&
+    (this->texcoordlist[idx] == tc) &&
+    (this->bumpcoordlist[idx] == bc) &&
+    (this->rgbalist[idx] == rgba) &&
+    (this->texcoordidxlist[idx] == tcidx);
 }
 
+// doubles the size of the weld table, keeping it at most half full
 void
-SoPrimitiveVertexCacheP::addVertex(const Vertex & v)
+SoPrimitiveVertexCacheP::growWeldTable(void)
+{
+  int size = this->weldtable.getLength() ? this->weldtable.getLength() * 2 : 1024;
+  this->weldtable.truncate(0);
+  for (int i = 0; i < size; i++) this->weldtable.append(-1);
+
+  int32_t * table = &this->weldtable[0];
+  const uint32_t mask = static_cast<uint32_t>(size - 1);
+  const int num = this->vertexlist.getLength();
+  for (int32_t idx = 0; idx < num; idx++) {
+    uint32_t slot = this->hashVertex(idx) & mask;
+    while (table[slot] >= 0) slot = (slot + 1) & mask;
+    table[slot] = idx;
+  }
+}
+
+// moves list[i] to list[remap[i]]
+template <class Type>
+static void
+pvcache_permute(SbList <Type> & list, const int32_t * remap)
 {
-  this->vertexlist.append(v.vertex);
-  this->normallist.append(v.normal);
-  this->texcoordlist.append(v.texcoord0);
-  this->bumpcoordlist.append(v.bumpcoord);
-  for (int c = 0; c < 4; c++) {
-    this->rgbalist.append(v.rgba[c]);
+  const int num = list.getLength();
+  if (num == 0) return;
+  Type * tmp = new Type[num];
+  for (int i = 0; i < num; i++) tmp[remap[i]] = list[i];
+  for (int i = 0; i < num; i++) list[i] = tmp[i];
+  delete[] tmp;
+}
+
+// Renumbers the vertices in the order they are first used by the
+// (reordered) triangles, lines and points, so that the vertex arrays
+// are read sequentially when rendering.
+void
+SoPrimitiveVertexCacheP::reorderVertices(void)
+{
+  const int32_t num = this->vertexlist.getLength();
+  if (num == 0) return;
+
+  int32_t * remap = new int32_t[num];
+  int32_t i;
+  for (i = 0; i < num; i++) remap[i] = -1;
+  int32_t numassigned = 0;
+  if (this->triangleindexer) this->triangleindexer->getFetchOrder(remap, numassigned);
+  if (this->lineindexer) this->lineindexer->getFetchOrder(remap, numassigned);
+  if (this->pointindexer) this->pointindexer->getFetchOrder(remap, numassigned);
+
+  SbBool identity = TRUE;
+  for (i = 0; i < num; i++) {
+    if (remap[i] < 0) remap[i] = numassigned++;
+    if (remap[i] != i) identity = FALSE;
+  }
+
+  if (!identity) {
+    if (this->triangleindexer) this->triangleindexer->remapIndices(remap);
+    if (this->lineindexer) this->lineindexer->remapIndices(remap);
+    if (this->pointindexer) this->pointindexer->remapIndices(remap);
+
+    pvcache_permute(this->vertexlist, remap);
+    pvcache_permute(this->normallist, remap);
+    pvcache_permute(this->texcoordlist, remap);
+    pvcache_permute(this->bumpcoordlist, remap);
+    pvcache_permute(this->rgbalist, remap);
+    for (int j = 1; j <= this->lastenabled; j++) {
+      pvcache_permute(this->multitexcoords[j], remap);
+    }
+  }
+  delete[] remap;
+}
+
+// Returns the index of the vertex for pv, adding it to the attribute
+// lists unless an identical vertex has been added before. pd is the
+// point detail of pv, if any.
+int32_t
+SoPrimitiveVertexCacheP::addVertex(const SoPrimitiveVertex * pv, const SoPointDetail * pd)
+{
+  const SbVec3f & v = pv->getPoint();
+  const SbVec3f & n = pv->getNormal();
+  const SbVec4f & tc = pv->getTextureCoords();
+  SbVec2f bc(tc[0], tc[1]);
+  int32_t tcidx = -1;
+  if (pd) {
+    tcidx = pd->getTextureCoordIndex();
+    if (this->numbumpcoords) {
+      bc = this->bumpcoords[SbClamp(tcidx, 0, this->numbumpcoords-1)];
+    }
+  }
+
+  const int midx = pv->getMaterialIndex();
+  uint32_t col;
+  if (this->packedptr) {
+    col = this->packedptr[SbClamp(midx, 0, this->numdiffuse-1)];
+  }
+  else {
+    SbColor tmpc = this->diffuseptr[SbClamp(midx,0,this->numdiffuse-1)];
+    float tmpt = this->transpptr[SbClamp(midx,0,this->numtransp-1)];
+    col = tmpc.getPackedValue(tmpt);
+  }
+  if (col != this->firstcolor) this->colorpervertex = TRUE;
+
+  const uint8_t bytes[4] = {
+    static_cast<uint8_t>(col>>24),
+    static_cast<uint8_t>((col>>16)&0xff),
+    static_cast<uint8_t>((col>>8)&0xff),
+    static_cast<uint8_t>(col&0xff)
+  };
+  uint32_t rgba;
+  (void)memcpy(&rgba, bytes, sizeof(uint32_t));
+
+  const int32_t num = this->vertexlist.getLength();
+  if (2 * (num + 1) > this->weldtable.getLength()) this->growWeldTable();
+
+  int32_t * table = &this->weldtable[0];
+  const uint32_t mask = static_cast<uint32_t>(this->weldtable.getLength() - 1);
+  uint32_t slot = pvcache_hash_vertex(v, n, tc, rgba, tcidx) & mask;
+  while (table[slot] >= 0) {
+    if (this->equalVertex(table[slot], v, n, tc, bc, rgba, tcidx)) return table[slot];
+    slot = (slot + 1) & mask;
+  }
+  table[slot] = num;
+
+  this->vertexlist.append(v);
+  this->normallist.append(n);
+  this->texcoordlist.append(tc);
+  this->bumpcoordlist.append(bc);
+  this->rgbalist.append(rgba);
+  this->texcoordidxlist.append(tcidx);
+
+  // update texture coordinates for unit 1-n
+  for (int j = 1; j <= this->lastenabled; j++) {
+    if (tcidx >= 0 &&
+        (this->multielem->getType(j) == SoMultiTextureCoordinateElement::EXPLICIT)) {
+      this->multitexcoords[j].append(this->multielem->get4(j, tcidx));
+    }
+    else if (this->multielem->getType(j) == SoMultiTextureCoordinateElement::FUNCTION) {
+      this->multitexcoords[j].append(this->multielem->get(j, v, n));
+    }
+    else {
+      this->multitexcoords[j].append(tc);
+    }
   }
+  return num;
 }
 
 void
@@ -1020,7 +1032,7 @@ SoPrimitiveVertexCacheP::enableVBOs(const cc_glglue * glue,
     if (this->rgbavbo == NULL) {
       this->rgbavbo = new SoVBO;
       this->rgbavbo->setBufferData(this->rgbalist.getArrayPtr(),
-                                   this->rgbalist.getLength() * sizeof(uint8_t));
+                                   this->rgbalist.getLength() * sizeof(uint32_t));
     }
     this->rgbavbo->bindBuffer(contextid);
     cc_glglue_glColorPointer(glue, 4, GL_UNSIGNED_BYTE, 0, NULL);
@@ -1093,7 +1105,7 @@ SoPrimitiveVertexCacheP::renderImmediate(const cc_glglue * glue,
                                          const SbBool texture, const SbBool * enabled,
                                          const int lastenabled)
 {
-  const unsigned char * colorptr = NULL;
+  const uint32_t * colorptr = NULL;
   const SbVec3f * normalptr = NULL;
   const SbVec3f * vertexptr = NULL;
   const SbVec4f * texcoordptr = NULL;
@@ -1115,7 +1127,7 @@ SoPrimitiveVertexCacheP::renderImmediate(const cc_glglue * glue,
       glNormal3fv(reinterpret_cast<const GLfloat *>(&normalptr[idx]));
     }
     if (color) {
-      glColor3ubv(reinterpret_cast<const GLubyte *>(&colorptr[idx*4]));
+      glColor3ubv(reinterpret_cast<const GLubyte *>(&colorptr[idx]));
     }
     if (texture) {
       glTexCoord4fv(reinterpret_cast<const GLfloat *>(&texcoordptr[idx]));
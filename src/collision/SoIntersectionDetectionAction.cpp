@@ -424,14 +424,18 @@ SoIntersectionDetectionAction::isTypeEnabled(SoType type, SbBool checkgroups) co
 {
   if ( PRIVATE(this)->prunetypes->find(type) != -1 ) return FALSE;
   if ( checkgroups ) {
-    // is type a dragger?
+    // is type a dragger? (with COIN_LAZY_INIT, the dragger and
+    // manipulator classes may not be registered yet, in which case
+    // there are none in the scene)
 #ifdef HAVE_DRAGGERS
     if ( !PRIVATE(this)->draggersenabled &&
+         SoDragger::getClassTypeId() != SoType::badType() &&
          type.isDerivedFrom(SoDragger::getClassTypeId()) ) return FALSE;
 #endif // HAVE_DRAGGERS
 #ifdef HAVE_MANIPULATORS
     // is type a manip?
-    if ( !PRIVATE(this)->manipsenabled ) {
+    if ( !PRIVATE(this)->manipsenabled &&
+         SoTransformManip::getClassTypeId() != SoType::badType() ) {
       if ( type.isDerivedFrom(SoTransformManip::getClassTypeId()) ||
            type.isDerivedFrom(SoClipPlaneManip::getClassTypeId()) ||
            type.isDerivedFrom(SoDirectionalLightManip::getClassTypeId()) ||
@@ -1015,8 +1019,10 @@ SoIntersectionDetectionAction::PImpl::reset(void)
   delete this->traverser;
   this->traverser = new SoCallbackAction;
 #ifdef HAVE_DRAGGERS
-  this->traverser->addPreCallback(SoDragger::getClassTypeId(),
-                                  draggerCB, this);
+  if (SoDragger::getClassTypeId() != SoType::badType()) {
+    this->traverser->addPreCallback(SoDragger::getClassTypeId(),
+                                    draggerCB, this);
+  }
 #endif // HAVE_DRAGGERS
   this->traverser->addPreCallback(SoNode::getClassTypeId(),
                                   traverseCB, this);
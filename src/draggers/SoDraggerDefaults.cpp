@@ -0,0 +1,370 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+
+// The default geometry of the built-in draggers is stored as .iv
+// files in defaults/. Reading these through SoDB::readAll() used to
+// be the major part of the time spent constructing the first dragger
+// of each type. At configure time, ivcompile.cmake compiles the files
+// into a compact instruction list per file, which is executed here to
+// build the same scene graph directly.
+//
+// Instructions, with their operands:
+//
+//   NODE typeidx                create a node, add to current group
+//   DEF nameidx slot            name the last created node
+//   USE slot                    add a named node to current group
+//   FIELD nameidx textidx floatoffset floatcount
+//                               set a field of the current node
+//   POP                         end the current node
+//   END                         end of file
+//
+// Numeric field values are also stored as floats, and are set
+// directly for the common field types. A floatcount of -1 means the
+// value is not numeric, and it is then set from its text, as if it
+// was read from the file.
+//
+// Set the environment variable COIN_DRAGGER_DEFAULTS_PARSE=1 to
+// always read the default geometry through the parser.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
+#ifdef HAVE_DRAGGERS
+
+#include "draggers/SoDraggerDefaults.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#include <Inventor/SbName.h>
+#include <Inventor/SoType.h>
+#include <Inventor/errors/SoDebugError.h>
+#include <Inventor/fields/SoMFColor.h>
+#include <Inventor/fields/SoMFFloat.h>
+#include <Inventor/fields/SoMFInt32.h>
+#include <Inventor/fields/SoMFRotation.h>
+#include <Inventor/fields/SoMFVec2f.h>
+#include <Inventor/fields/SoMFVec3f.h>
+#include <Inventor/fields/SoSFBool.h>
+#include <Inventor/fields/SoSFColor.h>
+#include <Inventor/fields/SoSFEnum.h>
+#include <Inventor/fields/SoSFFloat.h>
+#include <Inventor/fields/SoSFInt32.h>
+#include <Inventor/fields/SoSFRotation.h>
+#include <Inventor/fields/SoSFVec2f.h>
+#include <Inventor/fields/SoSFVec3f.h>
+#include <Inventor/lists/SbList.h>
+#include <Inventor/nodes/SoGroup.h>
+#include <Inventor/nodes/SoSeparator.h>
+
+#include "misc/SoEnvironment.h"
+
+// must match the values in ivcompile.cmake
+enum {
+  OP_END = 0,
+  OP_NODE = 1,
+  OP_DEF = 2,
+  OP_USE = 3,
+  OP_FIELD = 4,
+  OP_POP = 5
+};
+
+#include <defaults/compiledgeometry.h>
+
+// *************************************************************************
+
+namespace {
+
+// Same as sosfrotation_read_value() in fields/shared.cpp.
+SbRotation
+dd_rotation(const float * v)
+{
+  SbVec3f axis(v[0], v[1], v[2]);
+  if (axis == SbVec3f(0.0f, 0.0f, 0.0f) && v[3] == 0.0f) {
+    axis = SbVec3f(0.0f, 0.0f, 1.0f);
+  }
+  return SbRotation(axis, v[3]);
+}
+
+SbBool
+dd_integral(const float * v, const int num)
+{
+  for (int i = 0; i < num; i++) {
+    if (v[i] != static_cast<float>(static_cast<int32_t>(v[i]))) return FALSE;
+  }
+  return TRUE;
+}
+
+// Sets the value of field types with only numeric components directly
+// from the float table. Returns FALSE if the field type isn't handled
+// here, or the number of values doesn't fit it.
+SbBool
+dd_set_numeric(SoField * field, const float * v, const int num)
+{
+  const SoType type = field->getTypeId();
+
+  if (type == SoSFFloat::getClassTypeId()) {
+    if (num != 1) return FALSE;
+    static_cast<SoSFFloat *>(field)->setValue(v[0]);
+  }
+  else if (type == SoMFFloat::getClassTypeId()) {
+    SoMFFloat * mf = static_cast<SoMFFloat *>(field);
+    mf->setNum(num);
+    mf->setValues(0, num, v);
+  }
+  else if (type == SoSFVec2f::getClassTypeId()) {
+    if (num != 2) return FALSE;
+    static_cast<SoSFVec2f *>(field)->setValue(v[0], v[1]);
+  }
+  else if (type == SoMFVec2f::getClassTypeId()) {
+    if (num % 2) return FALSE;
+    SoMFVec2f * mf = static_cast<SoMFVec2f *>(field);
+    mf->setNum(num / 2);
+    SbVec2f * dst = mf->startEditing();
+    for (int i = 0; i < num / 2; i++) { dst[i].setValue(v + i * 2); }
+    mf->finishEditing();
+  }
+  else if (type == SoSFVec3f::getClassTypeId()) {
+    if (num != 3) return FALSE;
+    static_cast<SoSFVec3f *>(field)->setValue(v[0], v[1], v[2]);
+  }
+  else if (type == SoMFVec3f::getClassTypeId()) {
+    if (num % 3) return FALSE;
+    SoMFVec3f * mf = static_cast<SoMFVec3f *>(field);
+    mf->setNum(num / 3);
+    SbVec3f * dst = mf->startEditing();
+    for (int i = 0; i < num / 3; i++) { dst[i].setValue(v + i * 3); }
+    mf->finishEditing();
+  }
+  else if (type == SoSFColor::getClassTypeId()) {
+    if (num != 3) return FALSE;
+    static_cast<SoSFColor *>(field)->setValue(v[0], v[1], v[2]);
+  }
+  else if (type == SoMFColor::getClassTypeId()) {
+    if (num % 3) return FALSE;
+    SoMFColor * mf = static_cast<SoMFColor *>(field);
+    mf->setNum(num / 3);
+    SbColor * dst = mf->startEditing();
+    for (int i = 0; i < num / 3; i++) { dst[i].setValue(v + i * 3); }
+    mf->finishEditing();
+  }
+  else if (type == SoSFRotation::getClassTypeId()) {
+    if (num != 4) return FALSE;
+    static_cast<SoSFRotation *>(field)->setValue(dd_rotation(v));
+  }
+  else if (type == SoMFRotation::getClassTypeId()) {
+    if (num % 4) return FALSE;
+    SoMFRotation * mf = static_cast<SoMFRotation *>(field);
+    mf->setNum(num / 4);
+    SbRotation * dst = mf->startEditing();
+    for (int i = 0; i < num / 4; i++) { dst[i] = dd_rotation(v + i * 4); }
+    mf->finishEditing();
+  }
+  else if (type == SoSFInt32::getClassTypeId()) {
+    if (num != 1 || !dd_integral(v, num)) return FALSE;
+    static_cast<SoSFInt32 *>(field)->setValue(static_cast<int32_t>(v[0]));
+  }
+  else if (type == SoMFInt32::getClassTypeId()) {
+    if (!dd_integral(v, num)) return FALSE;
+    SoMFInt32 * mf = static_cast<SoMFInt32 *>(field);
+    mf->setNum(num);
+    int32_t * dst = mf->startEditing();
+    for (int i = 0; i < num; i++) { dst[i] = static_cast<int32_t>(v[i]); }
+    mf->finishEditing();
+  }
+  else {
+    return FALSE;
+  }
+  return TRUE;
+}
+
+// Handles single keyword values of enum (and bitmask) and boolean
+// fields without invoking the parser.
+SbBool
+dd_set_keyword(SoField * field, const char * text)
+{
+  if (field->isOfType(SoSFEnum::getClassTypeId())) {
+    SoSFEnum * f = static_cast<SoSFEnum *>(field);
+    const SbName name(text);
+    SbName enumname;
+    for (int i = 0; i < f->getNumEnums(); i++) {
+      const int val = f->getEnum(i, enumname);
+      if (enumname == name) {
+        f->setValue(val);
+        return TRUE;
+      }
+    }
+  }
+  else if (field->getTypeId() == SoSFBool::getClassTypeId()) {
+    if (strcmp(text, "TRUE") == 0) {
+      static_cast<SoSFBool *>(field)->setValue(TRUE);
+      return TRUE;
+    }
+    if (strcmp(text, "FALSE") == 0) {
+      static_cast<SoSFBool *>(field)->setValue(FALSE);
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+SoNode *
+dd_execute(const SoDraggerDefaultsGeometry & geometry)
+{
+  const int * ops = geometry.ops;
+  const char * const * strings = geometry.strings;
+
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+
+  SbList<SoNode *> stack;
+  SbList<SoNode *> defs;
+  stack.append(root);
+
+  SbBool ok = TRUE;
+  for (int pc = 0; ok && ops[pc] != OP_END; ) {
+    SoNode * current = stack[stack.getLength() - 1];
+    switch (ops[pc]) {
+    case OP_NODE:
+    case OP_USE:
+      {
+        if (!current->isOfType(SoGroup::getClassTypeId())) {
+          ok = FALSE;
+          break;
+        }
+        SoNode * node;
+        if (ops[pc] == OP_NODE) {
+          const SoType type = SoType::fromName(SbName(strings[ops[pc + 1]]));
+          if (!type.isDerivedFrom(SoNode::getClassTypeId()) || !type.canCreateInstance()) {
+            ok = FALSE;
+            break;
+          }
+          node = static_cast<SoNode *>(type.createInstance());
+          stack.append(node);
+        }
+        else {
+          if (ops[pc + 1] >= defs.getLength()) {
+            ok = FALSE;
+            break;
+          }
+          node = defs[ops[pc + 1]];
+        }
+        static_cast<SoGroup *>(current)->addChild(node);
+        pc += 2;
+      }
+      break;
+
+    case OP_DEF:
+      current->setName(SbName(strings[ops[pc + 1]]));
+      defs.append(current);
+      pc += 3;
+      break;
+
+    case OP_FIELD:
+      {
+        SoField * field = current->getField(SbName(strings[ops[pc + 1]]));
+        const char * text = strings[ops[pc + 2]];
+        const int floatcount = ops[pc + 4];
+        if (!field) {
+          ok = FALSE;
+        }
+        else if (!(floatcount >= 0 &&
+                   dd_set_numeric(field, geometry.floats + ops[pc + 3], floatcount)) &&
+                 !dd_set_keyword(field, text)) {
+          ok = field->set(text);
+        }
+        pc += 5;
+      }
+      break;
+
+    case OP_POP:
+      if (stack.getLength() < 2) {
+        ok = FALSE;
+        break;
+      }
+      stack.pop();
+      pc += 1;
+      break;
+
+    default:
+      ok = FALSE;
+      break;
+    }
+  }
+
+  if (!ok || stack.getLength() != 1) {
+#if COIN_DEBUG
+    SoDebugError::postWarning("SoDraggerDefaults::instantiate",
+                              "Compiled geometry for '%s' is invalid, "
+                              "reading it through the parser.",
+                              geometry.filename);
+#endif // COIN_DEBUG
+    root->unref();
+    return NULL;
+  }
+  root->unrefNoDelete();
+  return root;
+}
+
+} // anonymous namespace
+
+// *************************************************************************
+
+// Returns the default geometry for the dragger resource file
+// filename, or NULL if it is not available in compiled form. The
+// buffer it would otherwise be read from must be the built-in one the
+// geometry was compiled from, so a dragger extension passing its own
+// geometry under the name of a built-in file still gets it parsed. As
+// with SoDB::readAll(), the returned root node has a reference count
+// of zero.
+SoNode *
+SoDraggerDefaults::instantiate(const char * filename, const char * buffer)
+{
+  static int parseonly = -1;
+  if (parseonly == -1) {
+    auto env = CoinInternal::getEnvironmentVariable("COIN_DRAGGER_DEFAULTS_PARSE");
+    parseonly = (env.has_value() && std::atoi(env->c_str()) > 0) ? 1 : 0;
+  }
+  if (parseonly) return NULL;
+
+  for (int i = 0; compiledgeometry[i].filename; i++) {
+    if (compiledgeometry[i].text == buffer &&
+        strcmp(compiledgeometry[i].filename, filename) == 0) {
+      return dd_execute(compiledgeometry[i]);
+    }
+  }
+  return NULL;
+}
+
+#endif // HAVE_DRAGGERS
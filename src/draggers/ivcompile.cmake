@@ -0,0 +1,208 @@
+# Compiles the dragger default geometry .iv files into construction
+# tables, so the default parts can be instantiated at run time without
+# going through the Inventor text parser. See SoDraggerDefaults.cpp for
+# the instruction set, which must be kept in sync with the values
+# below.
+#
+# The compiler only understands the subset of the file format used in
+# the default geometry files: nodes with DEF/USE, and field values
+# which are written out as text. Field names are recognized by starting
+# with a lower case letter, node types by being followed by a '{'.
+# Files it can't handle are left out of the tables, and are then read
+# through the parser as before.
+
+set(IVCOMPILE_OP_NODE 1)
+set(IVCOMPILE_OP_DEF 2)
+set(IVCOMPILE_OP_USE 3)
+set(IVCOMPILE_OP_FIELD 4)
+set(IVCOMPILE_OP_POP 5)
+set(IVCOMPILE_OP_END 0)
+
+set(_ivcompile_number_regex "^[-+]?([0-9]+[.]?[0-9]*|[.][0-9]+)([eE][-+]?[0-9]+)?$")
+
+# Appends a string to the string table, setting _idx to its index.
+macro(_ivcompile_string _str _idx)
+  list(LENGTH _strings ${_idx})
+  list(APPEND _strings "${_str}")
+endmacro()
+
+# Emits the FIELD instruction for the field currently being read.
+macro(_ivcompile_flush_field)
+  if(NOT _pending STREQUAL "")
+    if(_field STREQUAL "")
+      set(_error "value '${_pending}' outside of a field")
+    endif()
+    list(APPEND _values "${_pending}")
+    set(_pending "")
+  endif()
+  if(NOT _field STREQUAL "")
+    set(_numeric TRUE)
+    set(_numbers "")
+    foreach(_v IN LISTS _values)
+      if(_v MATCHES "${_ivcompile_number_regex}")
+        if(NOT _v MATCHES "[.eE]")
+          set(_v "${_v}.0")
+        endif()
+        list(APPEND _numbers "${_v}f")
+      elseif(NOT _v STREQUAL "," AND NOT _v STREQUAL "_IVLB_" AND NOT _v STREQUAL "_IVRB_")
+        set(_numeric FALSE)
+      endif()
+    endforeach()
+    string(REPLACE ";" " " _text "${_values}")
+    string(REPLACE "_IVLB_" "[" _text "${_text}")
+    string(REPLACE "_IVRB_" "]" _text "${_text}")
+    _ivcompile_string("${_field}" _nameidx)
+    _ivcompile_string("${_text}" _textidx)
+    if(_numeric AND NOT _numbers STREQUAL "")
+      list(LENGTH _floats _floatoffset)
+      list(LENGTH _numbers _floatcount)
+      list(APPEND _floats ${_numbers})
+    else()
+      set(_floatoffset 0)
+      set(_floatcount -1)
+    endif()
+    list(APPEND _ops ${IVCOMPILE_OP_FIELD} ${_nameidx} ${_textidx} ${_floatoffset} ${_floatcount})
+    set(_field "")
+    set(_values "")
+  endif()
+endmacro()
+
+# Compiles the .iv file _input, and appends the resulting tables to
+# the variable named by _code. _prefix is used for the table names.
+# Sets _ok to FALSE if the file uses constructs the compiler doesn't
+# support.
+function(ivcompile _input _prefix _code _ok)
+  file(READ ${_input} _content)
+  set(${_ok} FALSE PARENT_SCOPE)
+
+  string(REGEX REPLACE "#[^\n]*" "" _content "${_content}")
+  if(_content MATCHES "[\"\\\\;]")
+    return()
+  endif()
+  string(REPLACE "[" " _IVLB_ " _content "${_content}")
+  string(REPLACE "]" " _IVRB_ " _content "${_content}")
+  string(REGEX REPLACE "([{}|(),])" " \\1 " _content "${_content}")
+  string(STRIP "${_content}" _content)
+  string(REGEX REPLACE "[ \t\r\n]+" ";" _tokens "${_content}")
+
+  set(_ops "")
+  set(_strings "")
+  set(_floats "")
+  set(_field "")
+  set(_values "")
+  set(_pending "")
+  set(_defname "")
+  set(_expect "")
+  set(_inlist FALSE)
+  set(_depth 0)
+  set(_numdefs 0)
+  set(_error "")
+
+  foreach(_t IN LISTS _tokens)
+    if(NOT _error STREQUAL "")
+      break()
+    endif()
+    if(_expect STREQUAL "defname")
+      set(_defname "${_t}")
+      set(_expect "type")
+    elseif(_expect STREQUAL "usename")
+      if(NOT DEFINED _def_${_t})
+        set(_error "USE of undefined name ${_t}")
+      endif()
+      list(APPEND _ops ${IVCOMPILE_OP_USE} ${_def_${_t}})
+      set(_expect "")
+    elseif(_expect STREQUAL "type")
+      set(_pending "${_t}")
+      set(_expect "")
+    elseif(_inlist)
+      list(APPEND _values "${_t}")
+      if(_t STREQUAL "_IVRB_")
+        set(_inlist FALSE)
+      endif()
+    elseif(_t STREQUAL "{")
+      if(_pending STREQUAL "")
+        set(_error "'{' without a node type")
+      endif()
+      set(_type "${_pending}")
+      set(_pending "")
+      _ivcompile_flush_field()
+      _ivcompile_string("${_type}" _typeidx)
+      list(APPEND _ops ${IVCOMPILE_OP_NODE} ${_typeidx})
+      if(NOT _defname STREQUAL "")
+        _ivcompile_string("${_defname}" _nameidx)
+        list(APPEND _ops ${IVCOMPILE_OP_DEF} ${_nameidx} ${_numdefs})
+        set(_def_${_defname} ${_numdefs})
+        math(EXPR _numdefs "${_numdefs} + 1")
+        set(_defname "")
+      endif()
+      math(EXPR _depth "${_depth} + 1")
+    elseif(_t STREQUAL "}")
+      _ivcompile_flush_field()
+      list(APPEND _ops ${IVCOMPILE_OP_POP})
+      math(EXPR _depth "${_depth} - 1")
+      if(_depth LESS 0)
+        set(_error "unbalanced '}'")
+      endif()
+    elseif(_t STREQUAL "DEF" OR _t STREQUAL "USE")
+      _ivcompile_flush_field()
+      if(_t STREQUAL "DEF")
+        set(_expect "defname")
+      else()
+        set(_expect "usename")
+      endif()
+    elseif(_t MATCHES "^[A-Z]")
+      if(NOT _pending STREQUAL "")
+        list(APPEND _values "${_pending}")
+      endif()
+      set(_pending "${_t}")
+    elseif(_t MATCHES "^[a-z]")
+      _ivcompile_flush_field()
+      if(_depth EQUAL 0)
+        set(_error "field ${_t} outside of a node")
+      endif()
+      set(_field "${_t}")
+    else()
+      if(NOT _pending STREQUAL "")
+        list(APPEND _values "${_pending}")
+        set(_pending "")
+      endif()
+      if(_field STREQUAL "")
+        set(_error "value '${_t}' outside of a field")
+      endif()
+      list(APPEND _values "${_t}")
+      if(_t STREQUAL "_IVLB_")
+        set(_inlist TRUE)
+      endif()
+    endif()
+  endforeach()
+
+  # "fields [ ... ]" declarations of unknown node types are not supported
+  if(_error STREQUAL "" AND (NOT _pending STREQUAL "" OR NOT _expect STREQUAL "" OR
+                             _inlist OR NOT _depth EQUAL 0))
+    set(_error "unexpected end of file")
+  endif()
+  if(NOT _error STREQUAL "")
+    message(STATUS "Dragger geometry ${_input} is read through the parser: ${_error}")
+    return()
+  endif()
+  list(APPEND _ops ${IVCOMPILE_OP_END})
+
+  string(REPLACE ";" ", " _opstext "${_ops}")
+  string(REPLACE ";" "\",\n  \"" _stringstext "${_strings}")
+  if(_floats STREQUAL "")
+    set(_floats "0.0f")
+  endif()
+  string(REPLACE ";" ", " _floatstext "${_floats}")
+  set(${_code} "${${_code}}
+static const int ${_prefix}_draggerops[] = {
+  ${_opstext}
+};
+static const char * const ${_prefix}_draggerstrings[] = {
+  \"${_stringstext}\"
+};
+static const float ${_prefix}_draggerfloats[] = {
+  ${_floatstext}
+};
+" PARENT_SCOPE)
+  set(${_ok} TRUE PARENT_SCOPE)
+endfunction()
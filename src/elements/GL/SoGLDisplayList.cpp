@@ -61,6 +61,8 @@
 
 #include "glue/glp.h"
 #include "rendering/SoGL.h"
+#include "rendering/SoGLResourceManagerP.h"
+#include "rendering/SoRenderStatisticsP.h"
 #include "coindefs.h"
 
 #ifndef COIN_WORKAROUND_NO_USING_STD_FUNCS
@@ -186,6 +188,9 @@ SoGLDisplayList::SoGLDisplayList(SoState * state, Type type, int allocnum,
     SoDebugError::postInfo("SoGLDisplayList::SoGLDisplayList",
                            "firstindex==%d", PRIVATE(this)->firstindex);
 #endif // debug
+    // display lists are counted, but never evicted
+    SoGLResourceManagerP::add(PRIVATE(this)->context,
+                              SoGLResourceManager::DISPLAY_LIST, this, 0);
   }
 }
 
@@ -196,10 +201,12 @@ SoGLDisplayList::~SoGLDisplayList()
   SoDebugError::postInfo("SoGLDisplayList::~SoGLDisplayList", "%p", this);
 #endif // debug
 
+  // FALSE if SoGLResourceManager already deleted the texture object
+  const SbBool alive = SoGLResourceManagerP::remove(PRIVATE(this)->context, this);
   if (PRIVATE(this)->type == DISPLAY_LIST) {
     glDeleteLists((GLuint) PRIVATE(this)->firstindex, PRIVATE(this)->numalloc);
   }
-  else {
+  else if (alive) {
     assert(PRIVATE(this)->type == TEXTURE_OBJECT);
 
     const cc_glglue * glw = cc_glglue_instance(PRIVATE(this)->context);
@@ -273,6 +280,7 @@ SoGLDisplayList::close(SoState * COIN_UNUSED_ARG(state))
                          "rendering.");
     }
     glCallList((GLuint) (PRIVATE(this)->firstindex + PRIVATE(this)->openindex));
+    SoRenderStatisticsP::count(SoRenderStatistics::DISPLAY_LIST_CALLS);
   }
   else {
     const cc_glglue * glw = cc_glglue_instance(PRIVATE(this)->context);
@@ -295,6 +303,7 @@ SoGLDisplayList::call(SoState * state, int index)
 {
   if (PRIVATE(this)->type == DISPLAY_LIST) {
     glCallList((GLuint) (PRIVATE(this)->firstindex + index));
+    SoRenderStatisticsP::count(SoRenderStatistics::DISPLAY_LIST_CALLS);
   }
   else {
     assert(PRIVATE(this)->type == TEXTURE_OBJECT);
@@ -405,6 +414,7 @@ SoGLDisplayList::bindTexture(SoState * COIN_UNUSED_ARG(state))
     target = GL_TEXTURE_2D;
   }
   cc_glglue_glBindTexture(glw, target, (GLuint)PRIVATE(this)->firstindex);
+  SoRenderStatisticsP::count(SoRenderStatistics::TEXTURE_BINDS);
 }
 
 #undef PRIVATE
@@ -68,6 +68,7 @@
 #include <Inventor/nodes/SoNode.h>
 #include "C/CoinTidbits.h"
 #include "misc/CoinUtilities.h"
+#include "rendering/SoRenderStatisticsP.h"
 #include "rendering/SoVBO.h"
 #include <coindefs.h> // COIN_OBSOLETED
 
@@ -545,6 +546,8 @@ SoGLLazyElement::isColorIndex(SoState * state)
 void
 SoGLLazyElement::send(const SoState * stateptr, uint32_t mask) const
 {
+  SoRenderStatisticsP::count(SoRenderStatistics::LAZY_ELEMENT_SENDS);
+
   if (this->colorpacker) {
     if (!this->colorpacker->diffuseMatch(this->coinstate.diffusenodeid) ||
         !this->colorpacker->transpMatch(this->coinstate.transpnodeid)) {
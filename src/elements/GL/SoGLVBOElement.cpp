@@ -263,4 +263,59 @@ SoGLVBOElement::shouldCreateVBO(SoState * state, const int numdata)
     SoVBO::shouldCreateVBO(state, glue->contextid, numdata);
 }
 
+/*!
+  Sets which vertex attributes are compressed when coordinate, normal
+  and texture coordinate nodes create their VBOs. \a flags is a mask
+  of AttributeCompression values.
+
+  Positions are quantized to 16 bit integers in the bounding cube of
+  the shape, normals are stored as signed normalized bytes and texture
+  coordinates as half floats. This uses 8, 4 and 4 (for 2D
+  coordinates) bytes per vertex instead of 12, 12 and 8, at the cost
+  of precision.
+
+  Quantized positions are decoded on the modelview matrix. Shapes
+  rendered with texture coordinate generation or an active shader
+  program would see the stored positions, so they are sent
+  uncompressed from the client side instead of from the VBO.
+
+  The default is COMPRESS_NONE, or the value of the
+  COIN_VBO_COMPRESSION environment variable. The setting only affects
+  VBOs created after the call.
+
+  \sa getMemoryStatistics()
+  \since Coin 4.1
+*/
+void
+SoGLVBOElement::setAttributeCompression(const uint32_t flags)
+{
+  SoVBO::setAttributeCompression(flags);
+}
+
+/*!
+  Returns the vertex attribute compression flags.
+
+  \sa setAttributeCompression()
+  \since Coin 4.1
+*/
+uint32_t
+SoGLVBOElement::getAttributeCompression(void)
+{
+  return SoVBO::getAttributeCompression();
+}
+
+/*!
+  Returns the number of bytes of vertex data held by all VBOs in \a
+  numbytes, and the number of bytes the same data would have needed
+  without attribute compression in \a numuncompressedbytes.
+
+  \sa setAttributeCompression()
+  \since Coin 4.1
+*/
+void
+SoGLVBOElement::getMemoryStatistics(size_t & numbytes, size_t & numuncompressedbytes)
+{
+  SoVBO::getMemoryStatistics(numbytes, numuncompressedbytes);
+}
+
 #undef PRIVATE
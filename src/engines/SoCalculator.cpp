@@ -78,6 +78,14 @@
   values. When the index get out of bounds for some other input field,
   the last field value will be used.
 
+  The expressions are parsed and compiled into a flat instruction list
+  the first time the engine is evaluated after \e expression has
+  changed. Evaluation then runs each instruction over blocks of input
+  values at a time, so large multi-value inputs are processed without
+  per-value overhead. Expressions that read a temporary variable before
+  it has been set (so the value is carried over from the previous
+  input value) are still evaluated one value at a time.
+
   Vector expressions are similar to scalar expression. An example:
 
   \code
@@ -320,18 +328,41 @@
   (SoMFVec3f) Output value with result from the calculations.
 */
 
+// number of values evaluated in one pass through the compiled program
+static const int SO_CALC_BLOCKSIZE = 256;
+
 class SoCalculatorP {
 public:
+  SoCalculatorP(void) : program(NULL) { }
+
   float ta_th[8];
   SbVec3f tA_tH[8];
-
+  // registers for the tree walking evaluateExpression()
   float a_h[8];
   SbVec3f A_H[8];
   float oa_od[4];
   SbVec3f oA_oD[4];
+
   SbList <struct so_eval_node*> evaluatorList;
+  struct so_eval_program * program;
+  // slot buffer for the compiled program, numslots * SO_CALC_BLOCKSIZE
+  SbList <float> slots;
+  SbList <SbVec3f> vecbuffer;
+
+  void clearExpressions(void);
 };
 
+void
+SoCalculatorP::clearExpressions(void)
+{
+  for (int i = 0; i < this->evaluatorList.getLength(); i++) {
+    so_eval_delete(this->evaluatorList[i]);
+  }
+  this->evaluatorList.truncate(0);
+  so_eval_program_delete(this->program);
+  this->program = NULL;
+}
+
 #define PRIVATE(thisp) (thisp->pimpl)
 #define THISP(POINTER) static_cast<SoCalculator *>(POINTER)
 
@@ -386,9 +417,7 @@ SoCalculator::SoCalculator(void)
 */
 SoCalculator::~SoCalculator(void)
 {
-  for (int i = 0; i < PRIVATE(this)->evaluatorList.getLength(); i++) {
-    so_eval_delete(PRIVATE(this)->evaluatorList[i]);
-  }
+  PRIVATE(this)->clearExpressions();
   delete PRIVATE(this);
 }
 
@@ -410,51 +439,39 @@ SoCalculator::evaluate(void)
   if (this->expression.getNum() == 0 ||
       this->expression[0].getLength() == 0) return;
 
-  if (PRIVATE(this)->evaluatorList.getLength() == 0) {
+  if (PRIVATE(this)->program == NULL) {
     for (i = 0; i < this->expression.getNum(); i++) {
       const SbString &s = this->expression[i];
       if (s.getLength()) {
         PRIVATE(this)->evaluatorList.append(so_eval_parse(s.getString()));
 #if COIN_DEBUG
         if (so_eval_error()) {
-          SoDebugError::postWarning("SoCalculator::evaluateExpression",
+          SoDebugError::postWarning("SoCalculator::evaluate",
                                     "%s", so_eval_error());
         }
 #endif // COIN_DEBUG
       }
       else PRIVATE(this)->evaluatorList.append(NULL);
     }
+    PRIVATE(this)->program =
+      so_eval_compile(PRIVATE(this)->evaluatorList.getArrayPtr(),
+                      PRIVATE(this)->evaluatorList.getLength());
   }
-
-
-  // find all fields used in all expressions
-  int maxnum = 0;
-  char inused[16]; /* a-h and A-H */
-  char outused[8]; /* a-d and A-D */
-  for (i = 0; i < 16; i++) inused[i] = 0;
-  for (i = 0; i < 8; i++) outused[i] = 0;
-
-  for (i = 0; i < PRIVATE(this)->evaluatorList.getLength(); i++) {
-    this->findUsed(PRIVATE(this)->evaluatorList[i], inused, outused);
-  }
+  const so_eval_program * program = PRIVATE(this)->program;
 
   // find max number of values in used input fields
-  char fieldname[2];
-  fieldname[1] = 0;
-  for (i = 0; i < 16; i++) {
-    if (inused[i]) {
-      if (i < 8) {
-        fieldname[0] = 'a' + i;
-      }
-      else {
-        fieldname[0] = 'A' + (i-8);
-      }
-      SoMField * field = coin_assert_cast<SoMField*>(this->getField(fieldname));
-      maxnum = SbMax(maxnum, field->getNum());
-    }
+  SoMFFloat * fltin[8] = { &this->a, &this->b, &this->c, &this->d,
+                           &this->e, &this->f, &this->g, &this->h };
+  SoMFVec3f * vecin[8] = { &this->A, &this->B, &this->C, &this->D,
+                           &this->E, &this->F, &this->G, &this->H };
+  int maxnum = 0;
+  for (i = 0; i < 8; i++) {
+    if (program->inused[i]) maxnum = SbMax(maxnum, fltin[i]->getNum());
+    if (program->inused[i+8]) maxnum = SbMax(maxnum, vecin[i]->getNum());
   }
   if (maxnum == 0) maxnum = 1; // in case only temporary registers were used
 
+  const char * outused = program->outused;
   if (outused[0]) { SO_ENGINE_OUTPUT(oa, SoMFFloat, setNum(maxnum)); }
   if (outused[1]) { SO_ENGINE_OUTPUT(ob, SoMFFloat, setNum(maxnum)); }
   if (outused[2]) { SO_ENGINE_OUTPUT(oc, SoMFFloat, setNum(maxnum)); }
@@ -465,28 +482,110 @@ SoCalculator::evaluate(void)
   if (outused[6]) { SO_ENGINE_OUTPUT(oC, SoMFVec3f, setNum(maxnum)); }
   if (outused[7]) { SO_ENGINE_OUTPUT(oD, SoMFVec3f, setNum(maxnum)); }
 
-  // loop through all fieldindices and evaluate
-  for (i = 0; i < maxnum; i++) {
-    // just initialize output registers to default values
-    // (in case an expression reads from an output before setting its value)
-    PRIVATE(this)->oA_oD[0] = SbVec3f(0.0f, 0.0f, 0.0f);
-    PRIVATE(this)->oA_oD[1] = SbVec3f(0.0f, 0.0f, 0.0f);
-    PRIVATE(this)->oA_oD[2] = SbVec3f(0.0f, 0.0f, 0.0f);
-    PRIVATE(this)->oA_oD[3] = SbVec3f(0.0f, 0.0f, 0.0f);
-    PRIVATE(this)->oa_od[0] = 0.0f;
-    PRIVATE(this)->oa_od[1] = 0.0f;
-    PRIVATE(this)->oa_od[2] = 0.0f;
-    PRIVATE(this)->oa_od[3] = 0.0f;
-
-    // evaluate all expressions for this fieldidx
-    for (j = 0; j < PRIVATE(this)->evaluatorList.getLength(); j++) {
-      if (PRIVATE(this)->evaluatorList[j]) {
-        this->evaluateExpression(PRIVATE(this)->evaluatorList[j], i);
+  // if temporary registers carry values from one field index to the
+  // next, the program must be run for one index at a time
+  const int blocksize = program->lanedependent ? 1 : SO_CALC_BLOCKSIZE;
+  const int stride = SO_CALC_BLOCKSIZE;
+  SbList <float> & slotlist = PRIVATE(this)->slots;
+  if (slotlist.getLength() < program->numslots * stride) {
+    slotlist.truncate(0);
+    for (i = 0; i < program->numslots * stride; i++) slotlist.append(0.0f);
+  }
+  float * slots = &slotlist[0];
+  if (PRIVATE(this)->vecbuffer.getLength() < stride) {
+    for (i = PRIVATE(this)->vecbuffer.getLength(); i < stride; i++) {
+      PRIVATE(this)->vecbuffer.append(SbVec3f(0.0f, 0.0f, 0.0f));
+    }
+  }
+  SbVec3f * vecbuffer = &PRIVATE(this)->vecbuffer[0];
+
+  for (int start = 0; start < maxnum; start += blocksize) {
+    const int num = SbMin(blocksize, maxnum - start);
+
+    // copy values from fields to the input "registers"
+    for (i = 0; i < 8; i++) {
+      if (program->inused[i]) {
+        const int fieldnum = fltin[i]->getNum();
+        const float * src = fltin[i]->getValues(0);
+        float * dst = slots + (SO_EVAL_SLOT_IN_FLT + i) * stride;
+        for (j = 0; j < num; j++) {
+          dst[j] = fieldnum ? src[SbMin(start + j, fieldnum - 1)] : 0.0f;
+        }
+      }
+      if (program->inused[i+8]) {
+        const int fieldnum = vecin[i]->getNum();
+        const SbVec3f * src = vecin[i]->getValues(0);
+        float * dst = slots + (SO_EVAL_SLOT_IN_VEC + i * 3) * stride;
+        for (j = 0; j < num; j++) {
+          const float * v = fieldnum ? src[SbMin(start + j, fieldnum - 1)].getValue() : NULL;
+          dst[j] = v ? v[0] : 0.0f;
+          dst[stride + j] = v ? v[1] : 0.0f;
+          dst[2 * stride + j] = v ? v[2] : 0.0f;
+        }
+      }
+    }
+    // temporary registers keep their value from the last evaluation,
+    // output registers are cleared (in case an expression reads from
+    // an output before setting its value)
+    for (i = 0; i < 8; i++) {
+      float * dst = slots + (SO_EVAL_SLOT_TMP_FLT + i) * stride;
+      for (j = 0; j < num; j++) dst[j] = PRIVATE(this)->ta_th[i];
+      for (int k = 0; k < 3; k++) {
+        dst = slots + (SO_EVAL_SLOT_TMP_VEC + i * 3 + k) * stride;
+        for (j = 0; j < num; j++) dst[j] = PRIVATE(this)->tA_tH[i][k];
+      }
+    }
+    for (i = SO_EVAL_SLOT_OUT_FLT * stride; i < SO_EVAL_SLOT_FIXED * stride; i++) {
+      slots[i] = 0.0f;
+    }
+
+    so_eval_program_run(program, slots, stride, num);
+
+    // copy the output values from "registers" to engine output
+    const float * out = slots + SO_EVAL_SLOT_OUT_FLT * stride;
+    if (outused[0]) { SO_ENGINE_OUTPUT(oa, SoMFFloat, setValues(start, num, out)); }
+    if (outused[1]) { SO_ENGINE_OUTPUT(ob, SoMFFloat, setValues(start, num, out + stride)); }
+    if (outused[2]) { SO_ENGINE_OUTPUT(oc, SoMFFloat, setValues(start, num, out + 2 * stride)); }
+    if (outused[3]) { SO_ENGINE_OUTPUT(od, SoMFFloat, setValues(start, num, out + 3 * stride)); }
+
+    SoEngineOutput * vecout[4] = { &this->oA, &this->oB, &this->oC, &this->oD };
+    for (i = 0; i < 4; i++) {
+      if (!outused[i+4]) continue;
+      out = slots + (SO_EVAL_SLOT_OUT_VEC + i * 3) * stride;
+      for (j = 0; j < num; j++) {
+        vecbuffer[j].setValue(out[j], out[stride + j], out[2 * stride + j]);
       }
+      SoEngineOutput & output = *vecout[i];
+      SO_ENGINE_OUTPUT(output, SoMFVec3f, setValues(start, num, vecbuffer));
+    }
+
+    // store the temporary registers for the next field index
+    for (i = 0; i < 8; i++) {
+      const float * src = slots + (SO_EVAL_SLOT_TMP_FLT + i) * stride;
+      PRIVATE(this)->ta_th[i] = src[num - 1];
+      src = slots + (SO_EVAL_SLOT_TMP_VEC + i * 3) * stride;
+      PRIVATE(this)->tA_tH[i].setValue(src[num - 1], src[stride + num - 1],
+                                       src[2 * stride + num - 1]);
     }
   }
 }
 
+// Documented in superclass.
+void
+SoCalculator::inputChanged(SoField *which)
+{
+  // if expression changes we have to rebuild the eval tree structure
+  // and the compiled program
+  if (which == &this->expression) {
+    PRIVATE(this)->clearExpressions();
+  }
+}
+
+// The functions below evaluate one parsed expression for one field
+// index by walking the expression tree, which is how evaluate() worked
+// before expressions were compiled. They are no longer called from
+// evaluate(), but are kept since they are part of the exported class.
+
 // "extern C" wrapper and C-function typedefs are needed with the
 // OSF1/cxx compiler (probably a bug in the compiler, but it doesn't
 // seem to hurt to do this anyway).
@@ -601,19 +700,6 @@ SoCalculator::findUsed(struct so_eval_node *node, char *inused, char *outused)
   }
 }
 
-// Documented in superclass.
-void
-SoCalculator::inputChanged(SoField *which)
-{
-  // if expression changes we have to rebuild the eval tree structure
-  if (which == &this->expression) {
-    for (int i = 0; i < PRIVATE(this)->evaluatorList.getLength(); i++) {
-      so_eval_delete(PRIVATE(this)->evaluatorList[i]);
-    }
-    PRIVATE(this)->evaluatorList.truncate(0);
-  }
-}
-
 // callback from evaluator. Reads values from temporary registers
 void
 SoCalculator::readfieldcb(const char *fieldname, float *data, void *userdata)
@@ -54,6 +54,12 @@
   If you want complete control over when an engine gets destructed,
   use SoBase::ref() and SoBase::unref() for explicit
   referencing/dereferencing.
+
+  Engines are normally evaluated lazily, when a field connected to one
+  of their outputs is read. With setScheduledEvaluation(), dirty
+  engines are instead evaluated together in dependency order when the
+  delay queue is processed, each one exactly once, optionally spread
+  over worker threads.
 */
 
 // *************************************************************************
@@ -73,6 +79,7 @@
 #include "config.h"
 #endif // HAVE_CONFIG_H
 #include "coindefs.h" // COIN_STUB()
+#include "engines/SoEngineScheduler.h"
 #ifdef COIN_THREADSAFE
 #include "threads/recmutexp.h"
 #endif // COIN_THREADSAFE
@@ -135,6 +142,8 @@ SoEngine::destroy(void)
   // by setting SoEngineOutput::isEnabled() to FALSE before
   // decoupling.
 
+  SoEngineScheduler::unschedule(this);
+
   // need to lock to avoid that evaluateWrapper() is called
   // simultaneously from more than one thread
 #ifdef COIN_THREADSAFE
@@ -323,6 +332,7 @@ SoEngine::notify(SoNotList * nl)
   // whatever this engine is connected to, so we need to be evaluated
   // on the next attempted read on our output(s).
   this->flags |= FLAG_ISDIRTY;
+  if (SoEngineScheduler::isEnabled()) SoEngineScheduler::schedule(this);
 
   // Call inputChanged() only if we're being notified through one of
   // the engine's fields (lastrec == CONTAINER, set in
@@ -537,6 +547,73 @@ SoEngine::shouldCopy(void) const
   return result;
 }
 
+/*!
+  Enable or disable scheduled evaluation of engines.
+
+  When enabled, engines marked dirty by notification are collected
+  and evaluated once each when the delay queue is processed (see
+  SoSensorManager::processDelayQueue()), before any of the delay
+  queue sensors are triggered. Engines are evaluated in batches
+  where every engine only reads from engines in earlier batches, so
+  shared upstream engines are evaluated before the engines reading
+  them instead of through recursive field evaluation.
+
+  If \a numthreads is larger than 1, the engines of each batch are
+  evaluated by that many threads, including the calling thread. The
+  evaluate() implementations of all engines in the network must then
+  be safe to run concurrently with other engines, which holds for the
+  built-in engines. Other threads should not read fields connected to
+  the engines while the delay queue is processed.
+
+  Scheduled evaluation does not change the computed values. Reading a
+  field before the delay queue is processed still evaluates its
+  engine on demand.
+
+  This method is an extension versus the Open Inventor API.
+
+  \sa evaluateScheduled()
+*/
+void
+SoEngine::setScheduledEvaluation(SbBool enable, int numthreads)
+{
+  SoEngineScheduler::setNumThreads(enable ? numthreads : 0);
+  SoEngineScheduler::setEnabled(enable);
+}
+
+/*!
+  Returns whether scheduled evaluation of engines is enabled.
+
+  \sa setScheduledEvaluation()
+*/
+SbBool
+SoEngine::isScheduledEvaluation(void)
+{
+  return SoEngineScheduler::isEnabled();
+}
+
+/*!
+  Returns the number of threads used for scheduled evaluation.
+
+  \sa setScheduledEvaluation()
+*/
+int
+SoEngine::getScheduledEvaluationThreads(void)
+{
+  return SoEngineScheduler::getNumThreads();
+}
+
+/*!
+  Evaluate the engines collected for scheduled evaluation right away,
+  instead of waiting for the delay queue to be processed.
+
+  \sa setScheduledEvaluation()
+*/
+void
+SoEngine::evaluateScheduled(void)
+{
+  SoEngineScheduler::evaluate();
+}
+
 /*!
   Returns whether we're in a notification process. This is needed to
   avoid double notification when an engine enables outputs during
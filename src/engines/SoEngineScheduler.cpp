@@ -0,0 +1,435 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+/*
+  SoEngineScheduler collects engines as they are marked dirty by
+  notification, and evaluates them all in one go when the delay queue
+  is processed, before any delay queue sensor (like a redraw) gets to
+  read from them.
+
+  The collected engines are sorted into batches such that an engine
+  only depends on engines in earlier batches, so each engine is
+  evaluated exactly once and reads only inputs that are up to date,
+  without recursing upstream through SoField::evaluate(). An engine
+  depends on the engines connected to its inputs, also through
+  chains of field connections (like an engine feeding a node field
+  which feeds another engine). Engines within a batch are independent
+  of each other, and are spread over worker threads if any have been
+  requested.
+
+  The scheduler does not change what values engines compute. Fields
+  are still marked for re-evaluation by notification, and reading a
+  field before the flush evaluates its engine the lazy way, after
+  which the scheduler finds the engine clean and skips it.
+*/
+
+#include "engines/SoEngineScheduler.h"
+
+#include <atomic>
+#include <cassert>
+
+#include <Inventor/engines/SoEngine.h>
+#include <Inventor/engines/SoEngineOutput.h>
+#include <Inventor/fields/SoField.h>
+#include <Inventor/fields/SoFieldData.h>
+#include <Inventor/lists/SoFieldList.h>
+#include <Inventor/lists/SbList.h>
+#include <Inventor/threads/SbCondVar.h>
+#include <Inventor/threads/SbMutex.h>
+#include <Inventor/threads/SbThread.h>
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+#include "C/CoinTidbits.h"
+#include "misc/SbHash.h"
+#ifdef COIN_THREADSAFE
+#include "threads/recmutexp.h"
+#endif // COIN_THREADSAFE
+
+// *************************************************************************
+
+class SoEngineSchedulerP {
+public:
+  SoEngineSchedulerP(void)
+    : numthreads(0), generation(0), numactive(0), quit(FALSE),
+      batch(NULL), batchsize(0), next(0)
+  {
+  }
+
+  // engines notified since the last evaluation
+  SbList<SoEngine *> pending;
+#ifdef COIN_THREADSAFE
+  SbMutex pendingmutex;
+#endif // COIN_THREADSAFE
+
+  // worker threads, started on demand
+  int numthreads;
+  SbList<SbThread *> workers;
+  SbMutex workmutex;
+  SbCondVar workcond;
+  SbCondVar donecond;
+  unsigned int generation;
+  int numactive;
+  SbBool quit;
+
+  // the batch being evaluated
+  SoEngine * const * batch;
+  int batchsize;
+  std::atomic<int> next;
+
+  void startWorkers(void);
+  void stopWorkers(void);
+  void evaluateBatch(SoEngine * const * engines, int numengines);
+  void runBatch(void);
+
+  static void * workerLoop(void * closure);
+};
+
+static SoEngineSchedulerP * scheduler_private = NULL;
+
+SbBool SoEngineScheduler::enabled = FALSE;
+
+extern "C" {
+
+static void
+engine_scheduler_cleanup(void)
+{
+  if (scheduler_private) scheduler_private->stopWorkers();
+  // clears FLAG_ISSCHEDULED on pending engines, so must run while the
+  // pending list still exists
+  SoEngineScheduler::setEnabled(FALSE);
+  delete scheduler_private;
+  scheduler_private = NULL;
+}
+
+} // extern "C"
+
+static SoEngineSchedulerP *
+engine_scheduler_get(void)
+{
+  if (scheduler_private == NULL) {
+    scheduler_private = new SoEngineSchedulerP;
+    coin_atexit(engine_scheduler_cleanup, CC_ATEXIT_NORMAL);
+  }
+  return scheduler_private;
+}
+
+// *************************************************************************
+
+// appends the indices of the engines in indices that field reads
+// from, directly or through connected fields
+static void
+engine_scheduler_find_upstream(const SoField * field,
+                               const SbHash<SoEngine *, int> & indices,
+                               SbList<const SoField *> & visited,
+                               SbList<int> & upstream)
+{
+  // field connections may form cycles
+  if (visited.find(field) != -1) return;
+  visited.append(field);
+
+  SoEngineOutput * master;
+  int idx;
+  if (field->isConnectedFromEngine() &&
+      field->getConnectedEngine(master) &&
+      !master->isNodeEngineOutput() &&
+      indices.get(master->getContainer(), idx)) {
+    upstream.append(idx);
+  }
+  if (field->isConnectedFromField()) {
+    SoFieldList masters;
+    const int num = field->getConnections(masters);
+    for (int i = 0; i < num; i++) {
+      engine_scheduler_find_upstream(masters[i], indices, visited, upstream);
+    }
+  }
+}
+
+void
+SoEngineSchedulerP::runBatch(void)
+{
+  int idx;
+  while ((idx = this->next.fetch_add(1)) < this->batchsize) {
+    this->batch[idx]->evaluateWrapper();
+  }
+}
+
+void *
+SoEngineSchedulerP::workerLoop(void * closure)
+{
+  SoEngineSchedulerP * thisp = static_cast<SoEngineSchedulerP *>(closure);
+  unsigned int seen = 0;
+  thisp->workmutex.lock();
+  for (;;) {
+    while (!thisp->quit && thisp->generation == seen) {
+      thisp->workcond.wait(thisp->workmutex);
+    }
+    if (thisp->quit) break;
+    seen = thisp->generation;
+    thisp->workmutex.unlock();
+
+    thisp->runBatch();
+
+    thisp->workmutex.lock();
+    if (--thisp->numactive == 0) thisp->donecond.wakeAll();
+  }
+  thisp->workmutex.unlock();
+  return NULL;
+}
+
+void
+SoEngineSchedulerP::startWorkers(void)
+{
+  // the calling thread takes part in evaluating each batch
+  for (int i = this->workers.getLength(); i < this->numthreads - 1; i++) {
+    this->workers.append(SbThread::create(SoEngineSchedulerP::workerLoop, this));
+  }
+}
+
+void
+SoEngineSchedulerP::stopWorkers(void)
+{
+  this->workmutex.lock();
+  this->quit = TRUE;
+  this->workcond.wakeAll();
+  this->workmutex.unlock();
+  for (int i = 0; i < this->workers.getLength(); i++) {
+    SbThread::join(this->workers[i]);
+    SbThread::destroy(this->workers[i]);
+  }
+  this->workers.truncate(0);
+  this->quit = FALSE;
+}
+
+void
+SoEngineSchedulerP::evaluateBatch(SoEngine * const * engines, int numengines)
+{
+  const int numworkers = this->workers.getLength();
+  if (numworkers == 0 || numengines < 2) {
+    // lock like SoField::evaluate() does around engine evaluation
+#ifdef COIN_THREADSAFE
+    cc_recmutex_internal_field_lock();
+#endif // COIN_THREADSAFE
+    for (int i = 0; i < numengines; i++) engines[i]->evaluateWrapper();
+#ifdef COIN_THREADSAFE
+    cc_recmutex_internal_field_unlock();
+#endif // COIN_THREADSAFE
+    return;
+  }
+
+  // The field lock can not be held here, as the workers take it when
+  // reading input fields. Engines in a batch do not read from each
+  // other, not even through connected fields, so each is evaluated by
+  // one thread only.
+
+  this->workmutex.lock();
+  this->batch = engines;
+  this->batchsize = numengines;
+  this->next = 0;
+  this->numactive = numworkers;
+  this->generation++;
+  this->workcond.wakeAll();
+  this->workmutex.unlock();
+
+  this->runBatch();
+
+  this->workmutex.lock();
+  while (this->numactive > 0) this->donecond.wait(this->workmutex);
+  this->batch = NULL;
+  this->batchsize = 0;
+  this->workmutex.unlock();
+}
+
+// *************************************************************************
+
+void
+SoEngineScheduler::setEnabled(SbBool enable)
+{
+  if (!enable && scheduler_private) {
+    // engines left pending are still dirty, and will be evaluated
+    // when read
+    SoEngineSchedulerP * pimpl = scheduler_private;
+    for (int i = 0; i < pimpl->pending.getLength(); i++) {
+      pimpl->pending[i]->flags &= ~SoEngine::FLAG_ISSCHEDULED;
+    }
+    pimpl->pending.truncate(0);
+  }
+  SoEngineScheduler::enabled = enable;
+}
+
+void
+SoEngineScheduler::setNumThreads(int numthreads)
+{
+  SoEngineSchedulerP * pimpl = engine_scheduler_get();
+  if (numthreads == pimpl->numthreads) return;
+  pimpl->stopWorkers();
+  pimpl->numthreads = numthreads;
+}
+
+int
+SoEngineScheduler::getNumThreads(void)
+{
+  return scheduler_private ? scheduler_private->numthreads : 0;
+}
+
+void
+SoEngineScheduler::schedule(SoEngine * engine)
+{
+  if (engine->flags & SoEngine::FLAG_ISSCHEDULED) return;
+  SoEngineSchedulerP * pimpl = engine_scheduler_get();
+#ifdef COIN_THREADSAFE
+  pimpl->pendingmutex.lock();
+#endif // COIN_THREADSAFE
+  engine->flags |= SoEngine::FLAG_ISSCHEDULED;
+  pimpl->pending.append(engine);
+#ifdef COIN_THREADSAFE
+  pimpl->pendingmutex.unlock();
+#endif // COIN_THREADSAFE
+}
+
+void
+SoEngineScheduler::unschedule(SoEngine * engine)
+{
+  if (!(engine->flags & SoEngine::FLAG_ISSCHEDULED)) return;
+  SoEngineSchedulerP * pimpl = scheduler_private;
+  if (pimpl == NULL) {
+    // scheduler already cleaned up, nothing is queued any more
+    engine->flags &= ~SoEngine::FLAG_ISSCHEDULED;
+    return;
+  }
+#ifdef COIN_THREADSAFE
+  pimpl->pendingmutex.lock();
+#endif // COIN_THREADSAFE
+  engine->flags &= ~SoEngine::FLAG_ISSCHEDULED;
+  const int idx = pimpl->pending.find(engine);
+  if (idx != -1) pimpl->pending.remove(idx);
+#ifdef COIN_THREADSAFE
+  pimpl->pendingmutex.unlock();
+#endif // COIN_THREADSAFE
+}
+
+void
+SoEngineScheduler::evaluate(void)
+{
+  SoEngineSchedulerP * pimpl = scheduler_private;
+  if (pimpl == NULL || pimpl->pending.getLength() == 0) return;
+
+  // take the pending engines, so engines notified while evaluating
+  // are left for the next round
+  SbList<SoEngine *> engines;
+#ifdef COIN_THREADSAFE
+  pimpl->pendingmutex.lock();
+#endif // COIN_THREADSAFE
+  for (int i = 0; i < pimpl->pending.getLength(); i++) {
+    SoEngine * engine = pimpl->pending[i];
+    engine->flags &= ~SoEngine::FLAG_ISSCHEDULED;
+    // skip engines already evaluated by a read since notification
+    if (engine->flags & SoEngine::FLAG_ISDIRTY) {
+      engine->ref();
+      engines.append(engine);
+    }
+  }
+  pimpl->pending.truncate(0);
+#ifdef COIN_THREADSAFE
+  pimpl->pendingmutex.unlock();
+#endif // COIN_THREADSAFE
+
+  const int numengines = engines.getLength();
+  if (numengines == 0) return;
+
+  // find the engines each engine reads from among the collected ones,
+  // and count them
+  SbHash<SoEngine *, int> indices;
+  for (int i = 0; i < numengines; i++) (void) indices.put(engines[i], i);
+
+  SbList<int> numinputs(numengines);
+  SbList<int> dependents;      // dependents of engine i start at depstart[i]
+  SbList<int> depstart(numengines + 1);
+  SbList<int> edgefrom, edgeto;
+  SbList<const SoField *> visited;
+  SbList<int> upstream;
+  for (int i = 0; i < numengines; i++) {
+    numinputs.append(0);
+    const SoFieldData * fielddata = engines[i]->getFieldData();
+    const int numfields = fielddata ? fielddata->getNumFields() : 0;
+    for (int f = 0; f < numfields; f++) {
+      visited.truncate(0);
+      upstream.truncate(0);
+      engine_scheduler_find_upstream(fielddata->getField(engines[i], f),
+                                     indices, visited, upstream);
+      for (int u = 0; u < upstream.getLength(); u++) {
+        if (upstream[u] == i) continue;
+        edgefrom.append(upstream[u]);
+        edgeto.append(i);
+        numinputs[i]++;
+      }
+    }
+  }
+
+  // store the dependents of each engine contiguously
+  for (int i = 0; i <= numengines; i++) depstart.append(0);
+  for (int e = 0; e < edgefrom.getLength(); e++) depstart[edgefrom[e] + 1]++;
+  for (int i = 0; i < numengines; i++) depstart[i + 1] += depstart[i];
+  SbList<int> fill(numengines);
+  for (int i = 0; i < numengines; i++) fill.append(depstart[i]);
+  for (int e = 0; e < edgefrom.getLength(); e++) dependents.append(0);
+  for (int e = 0; e < edgefrom.getLength(); e++) {
+    dependents[fill[edgefrom[e]]++] = edgeto[e];
+  }
+
+  // evaluate in batches of engines whose inputs are all up to date
+  SbList<SoEngine *> batch;
+  SbList<int> ready, nextready;
+  for (int i = 0; i < numengines; i++) {
+    if (numinputs[i] == 0) ready.append(i);
+  }
+  if (pimpl->numthreads > 1) pimpl->startWorkers();
+
+  // engines in a connection cycle never become ready, and are left
+  // for lazy evaluation
+  while (ready.getLength() > 0) {
+    batch.truncate(0);
+    nextready.truncate(0);
+    for (int r = 0; r < ready.getLength(); r++) {
+      const int i = ready[r];
+      batch.append(engines[i]);
+      for (int d = depstart[i]; d < depstart[i + 1]; d++) {
+        if (--numinputs[dependents[d]] == 0) nextready.append(dependents[d]);
+      }
+    }
+    pimpl->evaluateBatch(batch.getArrayPtr(), batch.getLength());
+    ready = nextready;
+  }
+
+  for (int i = 0; i < numengines; i++) engines[i]->unref();
+}
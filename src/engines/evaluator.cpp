@@ -476,3 +476,459 @@ so_eval_delete(so_eval_node *node)
     delete node;
   }
 }
+
+/* ********************************************************************** */
+
+/*
+ * Bytecode compiler. The tree structure is flattened into a list of
+ * scalar instructions so that each instruction can be executed as a
+ * simple loop over all elements in the input fields, instead of
+ * walking the tree (and calling the register callbacks) once per
+ * element.
+ */
+
+/* instruction opcodes */
+enum {
+  OP_CONST,
+  OP_COPY,
+  OP_ADD,
+  OP_SUB,
+  OP_MUL,
+  OP_DIV,
+  OP_FMOD,
+  OP_NEG,
+  OP_AND,
+  OP_OR,
+  OP_NOT,
+  OP_LEQ,
+  OP_GEQ,
+  OP_LT,
+  OP_GT,
+  OP_EQ,
+  OP_NEQ,
+  OP_TEST,
+  OP_SELECT,
+  OP_COS,
+  OP_SIN,
+  OP_TAN,
+  OP_ACOS,
+  OP_ASIN,
+  OP_ATAN,
+  OP_ATAN2,
+  OP_COSH,
+  OP_SINH,
+  OP_TANH,
+  OP_SQRT,
+  OP_EXP,
+  OP_LOG,
+  OP_LOG10,
+  OP_CEIL,
+  OP_FLOOR,
+  OP_FABS,
+  OP_RAND,
+  OP_POW,
+  OP_NORMDIV
+};
+
+typedef struct {
+  so_eval_program *program;
+  int maxinstr;
+  char tmpdefined[32]; /* ta-th, then tA-tH components */
+} so_eval_compiler;
+
+static int
+emit(so_eval_compiler *c, int op, int dst, int src1, int src2, int src3)
+{
+  so_eval_program *p = c->program;
+  so_eval_instr *instr;
+  if (p->numinstr == c->maxinstr) {
+    int i;
+    so_eval_instr *newinstr;
+    c->maxinstr = c->maxinstr ? c->maxinstr * 2 : 32;
+    newinstr = new so_eval_instr[c->maxinstr];
+    for (i = 0; i < p->numinstr; i++) newinstr[i] = p->instr[i];
+    delete[] p->instr;
+    p->instr = newinstr;
+  }
+  instr = &p->instr[p->numinstr++];
+  instr->op = op;
+  instr->dst = dst;
+  instr->src1 = src1;
+  instr->src2 = src2;
+  instr->src3 = src3;
+  instr->value = 0.0f;
+  return dst;
+}
+
+static int
+alloc_slots(so_eval_compiler *c, int num)
+{
+  int slot = c->program->numslots;
+  c->program->numslots += num;
+  return slot;
+}
+
+/*
+ * returns the first slot for a register name, as used in
+ * so_eval_node::regname.
+ */
+static int
+register_slot(const char *regname)
+{
+  if (regname[0] == 't' || regname[0] == 'o') {
+    int tmp = regname[0] == 't';
+    if (regname[1] >= 'A' && regname[1] <= 'H') {
+      return (tmp ? SO_EVAL_SLOT_TMP_VEC : SO_EVAL_SLOT_OUT_VEC) + (regname[1] - 'A') * 3;
+    }
+    assert(regname[1] >= 'a' && regname[1] <= 'h');
+    return (tmp ? SO_EVAL_SLOT_TMP_FLT : SO_EVAL_SLOT_OUT_FLT) + (regname[1] - 'a');
+  }
+  if (regname[0] >= 'A' && regname[0] <= 'H') {
+    return SO_EVAL_SLOT_IN_VEC + (regname[0] - 'A') * 3;
+  }
+  assert(regname[0] >= 'a' && regname[0] <= 'h');
+  return SO_EVAL_SLOT_IN_FLT + (regname[0] - 'a');
+}
+
+/*
+ * bookkeeping for a register read: marks used inputs, and detects
+ * temporaries that are read before being written.
+ */
+static void
+read_register(so_eval_compiler *c, const char *regname, int comp, int numcomp)
+{
+  int i;
+  if (regname[0] == 't') {
+    int base = (regname[1] >= 'A' && regname[1] <= 'H') ?
+      8 + (regname[1] - 'A') * 3 : (regname[1] - 'a');
+    for (i = 0; i < numcomp; i++) {
+      if (!c->tmpdefined[base + comp + i]) c->program->lanedependent = 1;
+    }
+  }
+  else if (regname[0] >= 'a' && regname[0] <= 'h') {
+    c->program->inused[regname[0] - 'a'] = 1;
+  }
+  else if (regname[0] >= 'A' && regname[0] <= 'H') {
+    c->program->inused[regname[0] - 'A' + 8] = 1;
+  }
+}
+
+static void
+write_register(so_eval_compiler *c, const char *regname, int comp, int numcomp)
+{
+  int i;
+  if (regname[0] == 't') {
+    int base = (regname[1] >= 'A' && regname[1] <= 'H') ?
+      8 + (regname[1] - 'A') * 3 : (regname[1] - 'a');
+    for (i = 0; i < numcomp; i++) c->tmpdefined[base + comp + i] = 1;
+  }
+  else {
+    assert(regname[0] == 'o');
+    if (regname[1] >= 'A' && regname[1] <= 'D') {
+      c->program->outused[regname[1] - 'A' + 4] = 1;
+    }
+    else {
+      assert(regname[1] >= 'a' && regname[1] <= 'd');
+      c->program->outused[regname[1] - 'a'] = 1;
+    }
+  }
+}
+
+/*
+ * compiles the node, and returns the slot holding the result. For
+ * vector results, the result is found in three consecutive slots.
+ */
+static int
+compile_node(so_eval_compiler *c, so_eval_node *node)
+{
+  int s1, s2, s3, dst, i;
+  switch (node->id) {
+  case ID_VALUE:
+    dst = emit(c, OP_CONST, alloc_slots(c, 1), -1, -1, -1);
+    c->program->instr[c->program->numinstr-1].value = node->value;
+    return dst;
+  case ID_FLT_REG:
+    read_register(c, node->regname, 0, 1);
+    return register_slot(node->regname);
+  case ID_VEC_REG:
+    read_register(c, node->regname, 0, 3);
+    return register_slot(node->regname);
+  case ID_VEC_REG_COMP:
+    assert(node->regidx >= 0 && node->regidx <= 2);
+    read_register(c, node->regname, node->regidx, 1);
+    return register_slot(node->regname) + node->regidx;
+  case ID_ASSIGN_FLT:
+    /* regidx is -1 for other than vector components */
+    s1 = compile_node(c, node->child2);
+    dst = register_slot(node->child1->regname);
+    if (node->child1->regidx >= 0) dst += node->child1->regidx;
+    emit(c, OP_COPY, dst, s1, -1, -1);
+    write_register(c, node->child1->regname,
+                   node->child1->regidx >= 0 ? node->child1->regidx : 0, 1);
+    return dst;
+  case ID_ASSIGN_VEC:
+    s1 = compile_node(c, node->child2);
+    dst = register_slot(node->child1->regname);
+    for (i = 0; i < 3; i++) emit(c, OP_COPY, dst + i, s1 + i, -1, -1);
+    write_register(c, node->child1->regname, 0, 3);
+    return dst;
+  case ID_SEPARATOR:
+    if (node->child1) compile_node(c, node->child1);
+    if (node->child2) compile_node(c, node->child2);
+    return -1;
+  case ID_FLT_COND:
+    /* both branches are evaluated, and the result selected per lane */
+    s1 = compile_node(c, node->child1);
+    s2 = compile_node(c, node->child2);
+    s3 = compile_node(c, node->child3);
+    return emit(c, OP_SELECT, alloc_slots(c, 1), s1, s2, s3);
+  case ID_VEC_COND:
+    s1 = compile_node(c, node->child1);
+    s2 = compile_node(c, node->child2);
+    s3 = compile_node(c, node->child3);
+    dst = alloc_slots(c, 3);
+    for (i = 0; i < 3; i++) emit(c, OP_SELECT, dst + i, s1, s2 + i, s3 + i);
+    return dst;
+  case ID_VEC3F:
+    s1 = compile_node(c, node->child1);
+    s2 = compile_node(c, node->child2);
+    s3 = compile_node(c, node->child3);
+    dst = alloc_slots(c, 3);
+    emit(c, OP_COPY, dst, s1, -1, -1);
+    emit(c, OP_COPY, dst + 1, s2, -1, -1);
+    emit(c, OP_COPY, dst + 2, s3, -1, -1);
+    return dst;
+  case ID_ADD_VEC:
+  case ID_SUB_VEC:
+    s1 = compile_node(c, node->child1);
+    s2 = compile_node(c, node->child2);
+    dst = alloc_slots(c, 3);
+    for (i = 0; i < 3; i++) {
+      emit(c, node->id == ID_ADD_VEC ? OP_ADD : OP_SUB, dst + i, s1 + i, s2 + i, -1);
+    }
+    return dst;
+  case ID_NEG_VEC:
+    s1 = compile_node(c, node->child1);
+    dst = alloc_slots(c, 3);
+    for (i = 0; i < 3; i++) emit(c, OP_NEG, dst + i, s1 + i, -1, -1);
+    return dst;
+  case ID_MUL_VEC_FLT:
+  case ID_DIV_VEC_FLT:
+    s1 = compile_node(c, node->child1);
+    s2 = compile_node(c, node->child2);
+    dst = alloc_slots(c, 3);
+    for (i = 0; i < 3; i++) {
+      emit(c, node->id == ID_MUL_VEC_FLT ? OP_MUL : OP_DIV, dst + i, s1 + i, s2, -1);
+    }
+    return dst;
+  case ID_CROSS:
+    {
+      int t1, t2;
+      s1 = compile_node(c, node->child1);
+      s2 = compile_node(c, node->child2);
+      dst = alloc_slots(c, 3);
+      t1 = alloc_slots(c, 1);
+      t2 = alloc_slots(c, 1);
+      for (i = 0; i < 3; i++) {
+        int j = (i + 1) % 3, k = (i + 2) % 3;
+        emit(c, OP_MUL, t1, s1 + j, s2 + k, -1);
+        emit(c, OP_MUL, t2, s1 + k, s2 + j, -1);
+        emit(c, OP_SUB, dst + i, t1, t2, -1);
+      }
+      return dst;
+    }
+  case ID_DOT:
+  case ID_LEN:
+  case ID_NORMALIZE:
+    {
+      int t;
+      s1 = compile_node(c, node->child1);
+      s2 = node->id == ID_DOT ? compile_node(c, node->child2) : s1;
+      dst = alloc_slots(c, 1);
+      t = alloc_slots(c, 1);
+      emit(c, OP_MUL, dst, s1, s2, -1);
+      emit(c, OP_MUL, t, s1 + 1, s2 + 1, -1);
+      emit(c, OP_ADD, dst, dst, t, -1);
+      emit(c, OP_MUL, t, s1 + 2, s2 + 2, -1);
+      emit(c, OP_ADD, dst, dst, t, -1);
+      if (node->id == ID_DOT) return dst;
+      emit(c, OP_SQRT, dst, dst, -1, -1);
+      if (node->id == ID_LEN) return dst;
+      s2 = dst;
+      dst = alloc_slots(c, 3);
+      for (i = 0; i < 3; i++) emit(c, OP_NORMDIV, dst + i, s1 + i, s2, -1);
+      return dst;
+    }
+  case ID_TEST_VEC:
+    s1 = compile_node(c, node->child1);
+    dst = alloc_slots(c, 1);
+    emit(c, OP_TEST, dst, s1, -1, -1);
+    for (i = 1; i < 3; i++) {
+      int t = emit(c, OP_TEST, alloc_slots(c, 1), s1 + i, -1, -1);
+      emit(c, OP_OR, dst, dst, t, -1);
+    }
+    return dst;
+  default:
+    break;
+  }
+
+  /* the remaining nodes are all scalar operations. Vector arguments
+     (only possible for ID_EQ/ID_NEQ) are compared on the first
+     component, as in so_eval_traverse(). */
+  s1 = node->child1 ? compile_node(c, node->child1) : -1;
+  s2 = node->child2 ? compile_node(c, node->child2) : -1;
+  dst = alloc_slots(c, 1);
+  switch (node->id) {
+  case ID_ADD: return emit(c, OP_ADD, dst, s1, s2, -1);
+  case ID_SUB: return emit(c, OP_SUB, dst, s1, s2, -1);
+  case ID_MUL: return emit(c, OP_MUL, dst, s1, s2, -1);
+  case ID_DIV: return emit(c, OP_DIV, dst, s1, s2, -1);
+  case ID_FMOD: return emit(c, OP_FMOD, dst, s1, s2, -1);
+  case ID_NEG: return emit(c, OP_NEG, dst, s1, -1, -1);
+  case ID_AND: return emit(c, OP_AND, dst, s1, s2, -1);
+  case ID_OR: return emit(c, OP_OR, dst, s1, s2, -1);
+  case ID_NOT: return emit(c, OP_NOT, dst, s1, -1, -1);
+  case ID_LEQ: return emit(c, OP_LEQ, dst, s1, s2, -1);
+  case ID_GEQ: return emit(c, OP_GEQ, dst, s1, s2, -1);
+  case ID_LT: return emit(c, OP_LT, dst, s1, s2, -1);
+  case ID_GT: return emit(c, OP_GT, dst, s1, s2, -1);
+  case ID_EQ: return emit(c, OP_EQ, dst, s1, s2, -1);
+  case ID_NEQ: return emit(c, OP_NEQ, dst, s1, s2, -1);
+  case ID_TEST_FLT: return emit(c, OP_TEST, dst, s1, -1, -1);
+  case ID_COS: return emit(c, OP_COS, dst, s1, -1, -1);
+  case ID_SIN: return emit(c, OP_SIN, dst, s1, -1, -1);
+  case ID_TAN: return emit(c, OP_TAN, dst, s1, -1, -1);
+  case ID_ACOS: return emit(c, OP_ACOS, dst, s1, -1, -1);
+  case ID_ASIN: return emit(c, OP_ASIN, dst, s1, -1, -1);
+  case ID_ATAN: return emit(c, OP_ATAN, dst, s1, -1, -1);
+  case ID_ATAN2: return emit(c, OP_ATAN2, dst, s1, s2, -1);
+  case ID_COSH: return emit(c, OP_COSH, dst, s1, -1, -1);
+  case ID_SINH: return emit(c, OP_SINH, dst, s1, -1, -1);
+  case ID_TANH: return emit(c, OP_TANH, dst, s1, -1, -1);
+  case ID_SQRT: return emit(c, OP_SQRT, dst, s1, -1, -1);
+  case ID_EXP: return emit(c, OP_EXP, dst, s1, -1, -1);
+  case ID_LOG: return emit(c, OP_LOG, dst, s1, -1, -1);
+  case ID_LOG10: return emit(c, OP_LOG10, dst, s1, -1, -1);
+  case ID_CEIL: return emit(c, OP_CEIL, dst, s1, -1, -1);
+  case ID_FLOOR: return emit(c, OP_FLOOR, dst, s1, -1, -1);
+  case ID_FABS: return emit(c, OP_FABS, dst, s1, -1, -1);
+  case ID_RAND: return emit(c, OP_RAND, dst, s1, -1, -1);
+  case ID_POW: return emit(c, OP_POW, dst, s1, s2, -1);
+  default:
+    assert(0 && "Whoops. Unknown node id!\n");
+    break;
+  }
+  return dst;
+}
+
+so_eval_program *
+so_eval_compile(so_eval_node * const *roots, int numroots)
+{
+  int i;
+  so_eval_compiler compiler;
+  so_eval_program *program = new so_eval_program();
+  program->instr = nullptr;
+  program->numinstr = 0;
+  program->numslots = SO_EVAL_SLOT_FIXED;
+  program->lanedependent = 0;
+  for (i = 0; i < 16; i++) program->inused[i] = 0;
+  for (i = 0; i < 8; i++) program->outused[i] = 0;
+
+  compiler.program = program;
+  compiler.maxinstr = 0;
+  for (i = 0; i < 32; i++) compiler.tmpdefined[i] = 0;
+
+  for (i = 0; i < numroots; i++) {
+    if (roots[i]) compile_node(&compiler, roots[i]);
+  }
+  return program;
+}
+
+void
+so_eval_program_delete(so_eval_program *program)
+{
+  if (program != nullptr) {
+    delete[] program->instr;
+    delete program;
+  }
+}
+
+/* helper macros for the instruction loops below */
+#define SO_EVAL_LOOP1(expr) \
+  for (l = 0; l < numlanes; l++) { const float x = a[l]; d[l] = (expr); }
+#define SO_EVAL_LOOP2(expr) \
+  for (l = 0; l < numlanes; l++) { const float x = a[l], y = b[l]; d[l] = (expr); }
+
+void
+so_eval_program_run(const so_eval_program *program, float *slots,
+                    int stride, int numlanes)
+{
+  int i, l;
+  for (i = 0; i < program->numinstr; i++) {
+    const so_eval_instr *instr = &program->instr[i];
+    float *d = slots + instr->dst * stride;
+    const float *a = instr->src1 >= 0 ? slots + instr->src1 * stride : nullptr;
+    const float *b = instr->src2 >= 0 ? slots + instr->src2 * stride : nullptr;
+    const float *e = instr->src3 >= 0 ? slots + instr->src3 * stride : nullptr;
+
+    switch (instr->op) {
+    case OP_CONST:
+      for (l = 0; l < numlanes; l++) d[l] = instr->value;
+      break;
+    case OP_COPY: SO_EVAL_LOOP1(x); break;
+    case OP_ADD: SO_EVAL_LOOP2(x + y); break;
+    case OP_SUB: SO_EVAL_LOOP2(x - y); break;
+    case OP_MUL: SO_EVAL_LOOP2(x * y); break;
+    case OP_DIV: SO_EVAL_LOOP2(x / (y == 0.0f ? FLT_EPSILON : y)); break;
+    case OP_FMOD: SO_EVAL_LOOP2(y != 0.0f ? (float) fmod(x, y) : 0.0f); break;
+    case OP_NEG: SO_EVAL_LOOP1(-x); break;
+    case OP_AND: SO_EVAL_LOOP2((x != 0.0f && y != 0.0f) ? 1.0f : 0.0f); break;
+    case OP_OR: SO_EVAL_LOOP2((x != 0.0f || y != 0.0f) ? 1.0f : 0.0f); break;
+    case OP_NOT: SO_EVAL_LOOP1(x == 0.0f ? 1.0f : 0.0f); break;
+    case OP_LEQ: SO_EVAL_LOOP2(x <= y ? 1.0f : 0.0f); break;
+    case OP_GEQ: SO_EVAL_LOOP2(x >= y ? 1.0f : 0.0f); break;
+    case OP_LT: SO_EVAL_LOOP2(x < y ? 1.0f : 0.0f); break;
+    case OP_GT: SO_EVAL_LOOP2(x > y ? 1.0f : 0.0f); break;
+    case OP_EQ: SO_EVAL_LOOP2(x == y ? 1.0f : 0.0f); break;
+    case OP_NEQ: SO_EVAL_LOOP2(x != y ? 1.0f : 0.0f); break;
+    case OP_TEST: SO_EVAL_LOOP1(x != 0.0f ? 1.0f : 0.0f); break;
+    case OP_SELECT:
+      for (l = 0; l < numlanes; l++) d[l] = a[l] != 0.0f ? b[l] : e[l];
+      break;
+    case OP_COS: SO_EVAL_LOOP1((float) cos(x)); break;
+    case OP_SIN: SO_EVAL_LOOP1((float) sin(x)); break;
+    case OP_TAN: SO_EVAL_LOOP1((float) tan(x)); break;
+    case OP_ACOS: SO_EVAL_LOOP1((float) acos(clamp(x, -1.0f, 1.0f))); break;
+    case OP_ASIN: SO_EVAL_LOOP1((float) asin(clamp(x, -1.0f, 1.0f))); break;
+    case OP_ATAN: SO_EVAL_LOOP1((float) atan(x)); break;
+    case OP_ATAN2:
+      SO_EVAL_LOOP2(y == 0.0f ?
+                    (float) (x >= 0.0f ? M_PI * 0.5 : - M_PI * 0.5) :
+                    (float) atan2(x, y));
+      break;
+    case OP_COSH: SO_EVAL_LOOP1((float) cosh(x)); break;
+    case OP_SINH: SO_EVAL_LOOP1((float) sinh(x)); break;
+    case OP_TANH: SO_EVAL_LOOP1((float) tanh(x)); break;
+    case OP_SQRT: SO_EVAL_LOOP1(x > 0.0f ? (float) sqrt(x) : 0.0f); break;
+    case OP_EXP: SO_EVAL_LOOP1((float) exp(x)); break;
+    case OP_LOG: SO_EVAL_LOOP1(x <= 0.0f ? -128.0f : (float) log(x)); break;
+    case OP_LOG10: SO_EVAL_LOOP1(x <= 0.0f ? -38.0f : (float) log10(x)); break;
+    case OP_CEIL: SO_EVAL_LOOP1((float) ceil(x)); break;
+    case OP_FLOOR: SO_EVAL_LOOP1((float) floor(x)); break;
+    case OP_FABS: SO_EVAL_LOOP1((float) fabs(x)); break;
+    case OP_RAND: SO_EVAL_LOOP1(x * (((float)rand()) / ((float)RAND_MAX))); break;
+    case OP_POW:
+      SO_EVAL_LOOP2(x == 0.0f ? 0.0f :
+                    (x > 0.0f ? (float) pow(x, y) :
+                     (float) pow(x, floor(y + 0.5))));
+      break;
+    case OP_NORMDIV: SO_EVAL_LOOP2(y > 0.0f ? x / y : 0.0f); break;
+    default:
+      assert(0 && "Whoops. Unknown opcode!\n");
+      break;
+    }
+  }
+}
+
+#undef SO_EVAL_LOOP1
+#undef SO_EVAL_LOOP2
@@ -109,6 +109,58 @@ extern "C" {
   so_eval_node *so_eval_create_flt_val(float val);
 
 
+  /*
+   * Compiled form of one or more expression trees. so_eval_compile()
+   * flattens the trees into a linear list of scalar instructions
+   * operating on "slots". A slot is a row of floats, one per element
+   * (lane) being evaluated, so each instruction is a tight loop over
+   * all lanes. Vector values occupy three consecutive slots.
+   *
+   * The SoCalculator registers have fixed slot indices (see the
+   * SO_EVAL_SLOT_* enum below). Intermediate results are allocated
+   * after SO_EVAL_SLOT_FIXED. Slot data is laid out as
+   * slots[slotidx * stride + lane].
+   */
+  typedef struct so_eval_instr {
+    int op;
+    int dst;
+    int src1, src2, src3;
+    float value;
+  } so_eval_instr;
+
+  typedef struct so_eval_program {
+    so_eval_instr *instr;
+    int numinstr;
+    int numslots;
+    char inused[16];  /* a-h and A-H read by the program */
+    char outused[8];  /* oa-od and oA-oD written by the program */
+    /* non-zero if a temporary register can be read before it is
+       written, i.e. values carry over from the previous element and
+       the program must be run one lane at a time */
+    int lanedependent;
+  } so_eval_program;
+
+  /* compile expression trees (NULL entries are skipped) */
+  so_eval_program *so_eval_compile(so_eval_node * const *roots, int numroots);
+
+  /* free memory used by compiled program */
+  void so_eval_program_delete(so_eval_program *program);
+
+  /* run the program over numlanes lanes of the slot buffer */
+  void so_eval_program_run(const so_eval_program *program, float *slots,
+                           int stride, int numlanes);
+
+/* fixed slot indices for registers in compiled programs */
+enum {
+  SO_EVAL_SLOT_IN_FLT = 0,    /* a-h */
+  SO_EVAL_SLOT_IN_VEC = 8,    /* A-H, three slots each */
+  SO_EVAL_SLOT_TMP_FLT = 32,  /* ta-th */
+  SO_EVAL_SLOT_TMP_VEC = 40,  /* tA-tH, three slots each */
+  SO_EVAL_SLOT_OUT_FLT = 64,  /* oa-od */
+  SO_EVAL_SLOT_OUT_VEC = 68,  /* oA-oD, three slots each */
+  SO_EVAL_SLOT_FIXED = 80
+};
+
 /* node ids */
 enum {
   ID_ADD,
@@ -143,6 +143,7 @@ inline unsigned int SbHashFunc(const void * key)
 {
   return SbHashFunc(reinterpret_cast<size_t>(key));
 }
+#include "misc/SoDBP.h"
 #include "coindefs.h" // COIN_STUB(), COIN_CHECK_THREAD()
 
 #ifdef COIN_THREADSAFE
@@ -559,6 +560,8 @@ SoField::~SoField()
   // disconnecting connections.
   this->setStatusBits(FLAG_ISDESTRUCTING);
 
+  SoDBP::forgetDeferredNotify(this);
+
 #if COIN_DEBUG_EXTRA
   int wLevel =
     SoConfigSettings::getInstance()->settingAsInt("COIN_WARNING_LEVEL");
@@ -1453,6 +1456,13 @@ SoField::startNotify(void)
 #endif //COIN_DEBUG_EXTRA
 
   SoDB::startNotify();
+  if (SoDBP::deferNotify(this, NULL)) {
+    // inside a notification batch, sent from SoDB::endNotifyBatch()
+    SoDB::endNotify();
+    return;
+  }
+  // share the time stamp when sending the notifications of a batch
+  if (SoDBP::flushnotlist) l = *SoDBP::flushnotlist;
   this->notify(&l);
   SoDB::endNotify();
 
@@ -253,6 +253,7 @@
 /* Platform-specific glue headers are no longer needed with callback-based contexts */
 #include "threads/threadsutilp.h"
 #include "misc/SoEnvironment.h"
+#include "rendering/SoRenderStatisticsP.h"
 
 // Include for SoDB context manager - minimal include to avoid circular dependencies
 class SoDB { 
@@ -3522,6 +3523,7 @@ cc_glglue_glDrawArrays(const cc_glglue * glue,
                        GLenum mode, GLint first, GLsizei count)
 {
   assert(glue->glDrawArrays);
+  SoRenderStatisticsP::countDraw(mode, count);
   glue->glDrawArrays(mode, first, count);
 }
 
@@ -3531,6 +3533,7 @@ cc_glglue_glDrawElements(const cc_glglue * glue,
                          const GLvoid * indices)
 {
   assert(glue->glDrawElements);
+  SoRenderStatisticsP::countDraw(mode, count);
   glue->glDrawElements(mode, count, type, indices);
 }
 
@@ -3540,6 +3543,7 @@ cc_glglue_glDrawRangeElements(const cc_glglue * glue,
                               const GLvoid * indices)
 {
   assert(glue->glDrawRangeElements);
+  SoRenderStatisticsP::countDraw(mode, count);
   glue->glDrawRangeElements(mode, start, end, count, type, indices);
 }
 
@@ -3562,6 +3566,7 @@ cc_glglue_glMultiDrawArrays(const cc_glglue * glue, GLenum mode, const GLint * f
                             const GLsizei * count, GLsizei primcount)
 {
   assert(glue->glMultiDrawArrays);
+  for (GLsizei i = 0; i < primcount; i++) SoRenderStatisticsP::countDraw(mode, count[i]);
   glue->glMultiDrawArrays(mode, first, count, primcount);
 }
 
@@ -3570,6 +3575,7 @@ cc_glglue_glMultiDrawElements(const cc_glglue * glue, GLenum mode, const GLsizei
                               GLenum type, const GLvoid ** indices, GLsizei primcount)
 {
   assert(glue->glMultiDrawElements);
+  for (GLsizei i = 0; i < primcount; i++) SoRenderStatisticsP::countDraw(mode, count[i]);
   glue->glMultiDrawElements(mode, count, type, indices, primcount);
 }
 
@@ -183,6 +183,7 @@
 
 #include "hardcopy/VectorizeActionP.h"
 #include "actions/SoSubActionP.h"
+#include "misc/SoDBP.h"
 
 // *************************************************************************
 
@@ -209,6 +210,10 @@ SoVectorizeAction::initClass(void)
 */
 SoVectorizeAction::SoVectorizeAction(void)
 {
+  // the hardcopy classes may be registered on first use
+  if (SoVectorizeAction::classTypeId == SoType::badType()) {
+    SoDBP::loadSubsystemsFor("SoVectorizeAction");
+  }
   PRIVATE(this) = new SoVectorizeActionP(this);
   SO_ACTION_CONSTRUCTOR(SoVectorizeAction);
 }
@@ -64,6 +64,12 @@ public:
   int setupnumtypes;
   SbList <SoType> addedtypes;
   SbList <SoActionMethod> addedmethods;
+  // dense copy of the list made by setUp(), see getMethodTable()
+  SoActionMethod * methodtable;
+  int nummethods;
+  // tables replaced by a later setUp(), kept alive until destruction
+  // since actions may still hold on to them during traversal
+  SbList <SoActionMethod *> retiredtables;
 
 #ifdef COIN_THREADSAFE
   SbMutex mutex;
@@ -100,6 +106,8 @@ SoActionMethodList::SoActionMethodList(SoActionMethodList * const parentlist)
   PRIVATE(this) = new SoActionMethodListP;
   PRIVATE(this)->parent = parentlist;
   PRIVATE(this)->setupnumtypes = 0;
+  PRIVATE(this)->methodtable = NULL;
+  PRIVATE(this)->nummethods = 0;
 }
 
 /*!
@@ -107,6 +115,10 @@ SoActionMethodList::SoActionMethodList(SoActionMethodList * const parentlist)
 */
 SoActionMethodList::~SoActionMethodList()
 {
+  for (int i = 0; i < PRIVATE(this)->retiredtables.getLength(); i++) {
+    delete[] PRIVATE(this)->retiredtables[i];
+  }
+  delete[] PRIVATE(this)->methodtable;
   delete PRIVATE(this);
 }
 
@@ -202,10 +214,48 @@ SoActionMethodList::setUp(void)
         }
       }
     }
+
+    // flatten into a plain array indexed by action method index, so
+    // SoAction::traverse() can dispatch without going through the
+    // list interface
+    n = this->getLength();
+    SoActionMethod * table = new SoActionMethod[n > 0 ? n : 1];
+    for (i = 0; i < n; i++) {
+      SoActionMethod m = (*this)[i];
+      table[i] = m ? m : SoAction::nullAction;
+    }
+    if (PRIVATE(this)->methodtable) {
+      PRIVATE(this)->retiredtables.append(PRIVATE(this)->methodtable);
+    }
+    PRIVATE(this)->methodtable = table;
+    PRIVATE(this)->nummethods = n;
+
     // used to detect when a new node has been added
     PRIVATE(this)->setupnumtypes = SoType::getNumTypes();
   }
   PRIVATE(this)->unlock();
 }
 
+/*!
+  Returns the action methods as a dense array indexed by
+  SoNode::getActionMethodIndex(), with \a numentries set to the
+  number of entries. The list is set up first if needed.
+
+  The returned array stays valid for the lifetime of the list, but
+  does not cover node types registered after the call. Call this
+  method again when an index falls outside the returned range.
+
+  \since Coin 4.1
+*/
+const SoActionMethod *
+SoActionMethodList::getMethodTable(int & numentries)
+{
+  this->setUp();
+  PRIVATE(this)->lock();
+  const SoActionMethod * table = PRIVATE(this)->methodtable;
+  numentries = PRIVATE(this)->nummethods;
+  PRIVATE(this)->unlock();
+  return table;
+}
+
 #undef PRIVATE
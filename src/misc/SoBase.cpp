@@ -85,6 +85,7 @@
 #include <Inventor/sensors/SoDataSensor.h>
 
 #include "misc/SoBaseP.h"
+#include "misc/SoDBP.h"
 #include "nodes/SoUnknownNode.h"
 #include "fields/SoGlobalField.h"
 #include "misc/SbHash.h"
@@ -314,6 +315,8 @@ SoBase::destroy(void)
   }
 #endif // COIN_DEBUG
 
+  SoDBP::forgetDeferredNotify(this);
+
   // Find all auditors that they need to cut off their link to this
   // object. I believe this is necessary only for sensors.
   SbList<SoDataSensor *> auditingsensors;
@@ -796,12 +799,20 @@ SoBase::removeName(SoBase * const base, const char * const name)
 void
 SoBase::startNotify(void)
 {
+  SoDB::startNotify();
+  if (SoDBP::deferNotify(NULL, this)) {
+    // inside a notification batch, sent from SoDB::endNotifyBatch()
+    SoDB::endNotify();
+    return;
+  }
+
   SoNotList l;
+  // share the time stamp when sending the notifications of a batch
+  if (SoDBP::flushnotlist) l = *SoDBP::flushnotlist;
   SoNotRec rec(createNotRec());
   l.append(&rec);
   l.setLastType(SoNotRec::CONTAINER);
 
-  SoDB::startNotify();
   this->notify(&l);
   SoDB::endNotify();
 }
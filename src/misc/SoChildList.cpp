@@ -365,6 +365,20 @@ SoChildList::traverse(SoAction * const action, const int first, const int last)
 
   switch (pathcode) {
   case SoAction::NO_PATH:
+    if (!action->needsCurPath()) {
+      // nobody looks at the current path, so skip maintaining it
+      for (i = first; (i <= last) && !action->hasTerminated(); i++) {
+#if COIN_DEBUG
+        if (i >= this->getLength()) {
+          changedetected = TRUE;
+          break;
+        }
+#endif // COIN_DEBUG
+        action->traverse((*this)[i]);
+      }
+      break;
+    }
+    // fall through
   case SoAction::BELOW_PATH:
     // always traverse all nodes.
     action->pushCurPath();
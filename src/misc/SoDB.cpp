@@ -115,6 +115,7 @@
 #include "misc/SbHash.h"
 #include "misc/SoConfigSettings.h"
 #include "rendering/SoVBO.h"
+#include "rendering/SoUnitShapeCache.h"
 
 // Threading support
 #include "threads/threadp.h"
@@ -189,6 +190,23 @@ static uint32_t a_static_variable = 0xdeadbeef;
 
 // *************************************************************************
 
+// Classes of the subsystems which are registered on first use with
+// COIN_LAZY_INIT, see SoDBP::addLazySubsystem().
+static const char * const sodb_hardcopyclasses[] = {
+  "VectorizeAction", "VectorizePSAction", NULL
+};
+static const char * const sodb_shadowclasses[] = {
+  "ShadowGroup", "ShadowStyleElement", "GLShadowCullingElement",
+  "ShadowStyle", "ShadowSpotLight", "ShadowDirectionalLight",
+  "ShadowCulling", NULL
+};
+static const char * const sodb_geoclasses[] = {
+  "GeoElement", "GeoOrigin", "GeoLocation", "GeoSeparator",
+  "GeoCoordinate", NULL
+};
+
+// *************************************************************************
+
 /*!
   Initialize the Coin library with the provided OpenGL context manager.
 
@@ -204,6 +222,19 @@ static uint32_t a_static_variable = 0xdeadbeef;
 
   It's safe to call this function multiple times with the same context manager.
 
+  If the environment variable \c COIN_LAZY_INIT is set to 1, the
+  classes of subsystems which many applications never use (hardcopy,
+  shadows and geo here, and nodekits, draggers and manipulators in
+  SoNodeKit::init() and SoInteraction::init()) are not registered
+  until first use: when one of them is constructed, or its type is
+  looked up with SoType::fromName(), as when reading a file. Until
+  then, their getClassTypeId() returns SoType::badType(), and they are
+  not included in SoType::getAllDerivedFrom(). The profiler is only
+  initialized when enabled with \c COIN_PROFILER in either mode.
+
+  Set \c COIN_DEBUG_INIT_TIMING to 1 to get a report of the time spent
+  on each group of classes during initialization.
+
   Make sure you call SoDB::cleanup() before application termination, for
   the Coin library to be able to clean up internal static data structures.
 
@@ -244,6 +275,14 @@ SoDB::init(ContextManager * context_manager)
     return; // Context manager updated, no need to re-initialize everything else
   }
 
+  // Subsystems which are not needed by all applications can be
+  // registered on first use instead of here, see SoDBP.
+  {
+    auto env = CoinInternal::getEnvironmentVariable("COIN_LAZY_INIT");
+    SoDBP::lazyinit = env.has_value() && (std::atoi(env->c_str()) > 0);
+  }
+  SoDBP::InitTimer timer("SoDB::init");
+
   // This is to catch the (unlikely) event that the C++ compiler adds
   // padding or rtti information to the SbVec3f (or similar) base classes.
   // We assume this isn't done several places in Coin, so the best thing to
@@ -303,7 +342,7 @@ SoDB::init(ContextManager * context_manager)
   // checking below, as we spit out warning messages if
   // inconsistencies are found.
   SoError::initClasses();
-
+  timer.lap("types and errors");
 
   SoConfigSettings::getInstance();
 
@@ -358,6 +397,7 @@ SoDB::init(ContextManager * context_manager)
   SoFieldContainer::initClass();
   SoGlobalField::initClass(); // depends on SoFieldContainer init
   SoField::initClass();
+  timer.lap("base, paths and fields");
 
   // Elements must be initialized before actions.
   SoElement::initClass();
@@ -367,31 +407,53 @@ SoDB::init(ContextManager * context_manager)
   // even if COIN_PROFILER is not set, as we use its classStackIndex
   // when checking if its present on the state stack.)
   SoProfilerElement::initClass();
+  timer.lap("elements");
 
   // ScXML classes removed - navigation now uses direct C++ APIs
 
   // Actions must be initialized before nodes (because of SO_ENABLE)
   SoAction::initClass();
+  timer.lap("actions");
   SoNode::initClass();
+  timer.lap("nodes");
   SoEngine::initClass();
+  timer.lap("engines");
   SoEvent::initClass();
   SoSensor::initClass();
 
   SoProto::initClass();
   SoProtoInstance::initClass();
+  timer.lap("events, sensors and protos");
 
   SoGLDriverDatabase::init();
   SoGLImage::initClass();
   SoGLBigImage::initClass();
+  timer.lap("GL driver database and images");
 
-  SoHardCopy::init();
+  if (SoDBP::lazyinit) {
+    SoDBP::addLazySubsystem("hardcopy", SoHardCopy::init, sodb_hardcopyclasses);
+  }
+  else {
+    SoHardCopy::init();
+  }
+  timer.lap("hardcopy");
 
   SoShader::init();
   SoVBO::init();
+  SoUnitShapeCache::init();
+  timer.lap("shaders and vertex buffers");
 
   // FIXME: probably temporary. Add FXViz::init() or something? pederb, 2007-03-09
-  SoShadowGroup::init();
-  SoGeo::init();
+  if (SoDBP::lazyinit) {
+    SoDBP::addLazySubsystem("shadows", SoShadowGroup::init, sodb_shadowclasses);
+    SoDBP::addLazySubsystem("geo", SoGeo::init, sodb_geoclasses);
+  }
+  else {
+    SoShadowGroup::init();
+    timer.lap("shadows");
+    SoGeo::init();
+  }
+  timer.lap(SoDBP::lazyinit ? "shadows and geo" : "geo");
 
 
 
@@ -461,6 +523,7 @@ SoDB::init(ContextManager * context_manager)
 
   // Force correct time on first getValue() from "realTime" field.
   SoDBP::updateRealTimeFieldCB(NULL, NULL);
+  timer.lap("file headers and realTime field");
 
   // This should prove helpful for debugging the pervasive problem
   // under Win32 with loading multiple instances of the same library.
@@ -482,6 +545,8 @@ SoDB::init(ContextManager * context_manager)
   if (SoProfiler::isEnabled()) {
     SoProfiler::init();
   }
+  timer.lap("profiler");
+  timer.report();
 
   // Note: OSMesa context initialization has been moved to test applications
   // Applications must provide context creation callbacks via cc_glglue_context_set_offscreen_cb_functions()
@@ -1165,6 +1230,78 @@ SoDB::endNotify(void)
 
 }
 
+/*!
+  Start a notification batch. Until the matching endNotifyBatch(),
+  field changes and other notifications are only recorded, and are
+  sent when the outermost batch ends. Each field or object is then
+  notified once, no matter how many times it changed, and each node
+  in the scene graph passes on notification to its parents only once,
+  like within a single notification.
+
+  This makes bulk updates of many fields in the same part of the
+  scene graph much cheaper, as every change otherwise walks all the
+  way up to the root. Caches are invalidated and sensors are triggered
+  as for ordinary notification, but only once per batch, and immediate
+  (zero priority) sensors are triggered once at the end of the batch.
+  Data sensors report the first change of their object in the batch
+  as the trigger, and a path sensor will not see a change on its path
+  if its head node was already notified from outside the path in the
+  same batch.
+
+  Since notification is deferred, fields connected from changed fields
+  or engines are not marked for re-evaluation before the batch ends.
+
+  The batch holds the notification lock, so notifications from other
+  threads wait until it has ended.
+
+  The SoDB::NotifyBatch class starts and ends a batch for the scope
+  of an object:
+
+  \code
+  {
+    SoDB::NotifyBatch batch;
+    for (int i = 0; i < numtransforms; i++) {
+      transforms[i]->translation.setValue(positions[i]);
+    }
+  } // notifications are sent here
+  \endcode
+
+  This method is an extension versus the Open Inventor API.
+
+  \sa endNotifyBatch(), isNotifyBatching()
+*/
+void
+SoDB::startNotifyBatch(void)
+{
+  SoDB::startNotify();
+  SoDBP::notifybatchdepth++;
+}
+
+/*!
+  Returns \c TRUE if a notification batch is active.
+
+  \sa startNotifyBatch()
+*/
+SbBool
+SoDB::isNotifyBatching(void)
+{
+  return SoDBP::notifybatchdepth > 0;
+}
+
+/*!
+  End a notification batch. When the outermost batch ends, the
+  recorded notifications are sent.
+
+  \sa startNotifyBatch()
+*/
+void
+SoDB::endNotifyBatch(void)
+{
+  assert(SoDBP::notifybatchdepth > 0);
+  if (--SoDBP::notifybatchdepth == 0) SoDBP::flushDeferredNotify();
+  SoDB::endNotify();
+}
+
 /*!
   Turn on or off the real time sensor.
 
@@ -1415,6 +1552,9 @@ SoDB::isMultiThread(void)
   All Coin actions have a read-lock on the global SoDB mutex while
   traversing the scene graph.
 
+  To change a scene graph without waiting for the threads traversing
+  it, see SoSceneSnapshot.
+
   \sa SoDB::readunlock(), SoDB::writelock()
 
   \since Coin 2.3
@@ -3,6 +3,7 @@
 #include <Inventor/SbName.h>
 #include <Inventor/SoInput.h>
 #include <Inventor/fields/SoField.h>
+#include <Inventor/misc/SoNotification.h>
 #include <Inventor/fields/SoSFTime.h>
 #include <Inventor/errors/SoDebugError.h>
 #include <Inventor/sensors/SoTimerSensor.h>
@@ -16,8 +17,12 @@
 #endif // HAVE_3DS_IMPORT_CAPABILITIES
 
 #include "fields/SoGlobalField.h"
+#include "misc/SoEnvironment.h"
 #include "coindefs.h"
 
+#include <cstdlib>
+#include <cstring>
+
 #ifdef COIN_THREADSAFE
 // need to include SbRWMutex.h to make C++ call the actual destructor,
 // and not just default destructor
@@ -31,6 +36,20 @@ UInt32ToInt16Map * SoDBP::converters = NULL;
 SbBool SoDBP::isinitialized = FALSE;
 int SoDBP::notificationcounter = 0;
 SbList<SoDBP::ProgressCallbackInfo> * SoDBP::progresscblist = NULL;
+int SoDBP::notifybatchdepth = 0;
+SbList<SoDBP::DeferredNotify> * SoDBP::deferrednotify = NULL;
+std::unordered_map<const void *, int> * SoDBP::deferredindex = NULL;
+const SoNotList * SoDBP::flushnotlist = NULL;
+SbBool SoDBP::lazyinit = FALSE;
+SbList<SoDBP::LazySubsystem> * SoDBP::lazysubsystems = NULL;
+
+#ifdef COIN_THREADSAFE
+#include <Inventor/threads/SbThreadMutex.h>
+// Guards lazysubsystems. Recursive, since loading a subsystem can
+// look up types which trigger loading of others. Not allocated in
+// SoDB::init(), so that late lookups during exit are safe.
+static SbThreadMutex sodbp_lazymutex;
+#endif // COIN_THREADSAFE
 
 // *************************************************************************
 
@@ -44,6 +63,18 @@ SoDBP::clean(void)
 {
   delete SoDBP::progresscblist;
   SoDBP::progresscblist = NULL;
+  delete SoDBP::deferrednotify;
+  SoDBP::deferrednotify = NULL;
+  delete SoDBP::deferredindex;
+  SoDBP::deferredindex = NULL;
+#ifdef COIN_THREADSAFE
+  sodbp_lazymutex.lock();
+#endif // COIN_THREADSAFE
+  delete SoDBP::lazysubsystems;
+  SoDBP::lazysubsystems = NULL;
+#ifdef COIN_THREADSAFE
+  sodbp_lazymutex.unlock();
+#endif // COIN_THREADSAFE
 
   // Avoid having the SoSensorManager instance trigging the callback
   // into the So@Gui@ class -- not only have it possible "died", but
@@ -74,6 +105,215 @@ SoDBP::clean(void)
 #endif // COIN_THREADSAFE
 }
 
+// Called from SoField::startNotify() and SoBase::startNotify() with
+// the notification lock held. Returns TRUE if the notification was
+// deferred to the end of the outermost notification batch.
+SbBool
+SoDBP::deferNotify(SoField * field, SoBase * base)
+{
+  if (SoDBP::notifybatchdepth == 0) return FALSE;
+
+  if (SoDBP::deferrednotify == NULL) {
+    SoDBP::deferrednotify = new SbList<DeferredNotify>;
+    SoDBP::deferredindex = new std::unordered_map<const void *, int>;
+  }
+  const void * key = field ? static_cast<const void *>(field) : base;
+  if (SoDBP::deferredindex->insert(std::make_pair(key, SoDBP::deferrednotify->getLength())).second) {
+    DeferredNotify entry;
+    entry.field = field;
+    entry.base = base;
+    SoDBP::deferrednotify->append(entry);
+  }
+  return TRUE;
+}
+
+// Drop a deferred notification for a field or base which is being
+// destructed.
+void
+SoDBP::forgetDeferredNotify(const void * object)
+{
+  if (SoDBP::deferredindex == NULL || SoDBP::deferredindex->empty()) return;
+  std::unordered_map<const void *, int>::iterator it =
+    SoDBP::deferredindex->find(object);
+  if (it != SoDBP::deferredindex->end()) {
+    (*SoDBP::deferrednotify)[it->second].field = NULL;
+    (*SoDBP::deferrednotify)[it->second].base = NULL;
+    SoDBP::deferredindex->erase(it);
+  }
+}
+
+// Send the notifications deferred during a notification batch. They
+// all share the time stamp of one notification list, so SoNode::notify()
+// lets each node pass on notification only once, like it does within a
+// single notification. The rest of the notification (field dirty
+// marking, field and node sensors, engines, cache invalidation) runs
+// as for ordinary notifications.
+void
+SoDBP::flushDeferredNotify(void)
+{
+  if (SoDBP::deferrednotify == NULL) return;
+  const int num = SoDBP::deferrednotify->getLength();
+  if (num == 0) return;
+
+  SoNotList stamp;
+  SoDBP::flushnotlist = &stamp;
+  for (int i = 0; i < num; i++) {
+    const DeferredNotify entry = (*SoDBP::deferrednotify)[i];
+    if (entry.field) entry.field->startNotify();
+    else if (entry.base) entry.base->startNotify();
+  }
+  SoDBP::flushnotlist = NULL;
+
+  SoDBP::deferrednotify->truncate(0);
+  SoDBP::deferredindex->clear();
+}
+
+// *************************************************************************
+
+SoDBP::InitTimer::InitTimer(const char * whereArg)
+  : where(whereArg)
+{
+  this->start = this->last = SbTime::getTimeOfDay();
+}
+
+void
+SoDBP::InitTimer::lap(const char * group)
+{
+  const SbTime now = SbTime::getTimeOfDay();
+  this->groups.append(group);
+  this->times.append((now - this->last).getValue());
+  this->last = now;
+}
+
+void
+SoDBP::InitTimer::report(void) const
+{
+  static int enabled = -1;
+  if (enabled == -1) {
+    auto env = CoinInternal::getEnvironmentVariable("COIN_DEBUG_INIT_TIMING");
+    enabled = (env.has_value() && std::atoi(env->c_str()) > 0) ? 1 : 0;
+  }
+  if (!enabled) return;
+
+  SbString text("startup timing:");
+  SbString line;
+  for (int i = 0; i < this->groups.getLength(); i++) {
+    line.sprintf("\n  %-40s %9.3f ms", this->groups[i], this->times[i] * 1000.0);
+    text += line;
+  }
+  line.sprintf("\n  %-40s %9.3f ms", "total",
+               (this->last - this->start).getValue() * 1000.0);
+  text += line;
+  SoDebugError::postInfo(this->where, "%s", text.getString());
+}
+
+// *************************************************************************
+
+void
+SoDBP::addLazySubsystem(const char * name, LazyInitFunc * func,
+                        const char * const * patterns)
+{
+#ifdef COIN_THREADSAFE
+  sodbp_lazymutex.lock();
+#endif // COIN_THREADSAFE
+  if (SoDBP::lazysubsystems == NULL) {
+    SoDBP::lazysubsystems = new SbList<LazySubsystem>;
+  }
+  LazySubsystem subsystem;
+  subsystem.name = name;
+  subsystem.func = func;
+  subsystem.patterns = patterns;
+  SoDBP::lazysubsystems->append(subsystem);
+#ifdef COIN_THREADSAFE
+  sodbp_lazymutex.unlock();
+#endif // COIN_THREADSAFE
+}
+
+static SbBool
+sodbp_matches(const char * pattern, const char * classname)
+{
+  const size_t plen = strlen(pattern);
+  const size_t clen = strlen(classname);
+  if (pattern[0] == '*') {
+    return clen >= plen - 1 &&
+      strcmp(classname + clen - (plen - 1), pattern + 1) == 0;
+  }
+  if (pattern[plen - 1] == '*') {
+    return strncmp(classname, pattern, plen - 1) == 0;
+  }
+  return strcmp(classname, pattern) == 0;
+}
+
+static void
+sodbp_load(const SoDBP::LazySubsystem & subsystem, const char * trigger)
+{
+  SoDBP::InitTimer timer("SoDB::init");
+  subsystem.func();
+  SbString group;
+  if (trigger) group.sprintf("%s, on first use of %s", subsystem.name, trigger);
+  else group.sprintf("%s, on demand", subsystem.name);
+  timer.lap(group.getString());
+  timer.report();
+}
+
+// Initializes the pending subsystems which register classname, and
+// returns TRUE if there were any. Subsystems are loaded with the lock
+// held, so other threads looking up their classes wait until they
+// are registered.
+SbBool
+SoDBP::loadSubsystemsFor(const char * classname)
+{
+  if (strncmp(classname, "So", 2) == 0) classname += 2;
+
+  SbBool loaded = FALSE;
+#ifdef COIN_THREADSAFE
+  sodbp_lazymutex.lock();
+#endif // COIN_THREADSAFE
+  int i = 0;
+  while (SoDBP::lazysubsystems && i < SoDBP::lazysubsystems->getLength()) {
+    const LazySubsystem subsystem = (*SoDBP::lazysubsystems)[i];
+    SbBool match = FALSE;
+    for (int p = 0; !match && subsystem.patterns[p]; p++) {
+      match = sodbp_matches(subsystem.patterns[p], classname);
+    }
+    if (!match) { i++; continue; }
+
+    // remove it first, as the classes may look up their own types
+    SoDBP::lazysubsystems->remove(i);
+    sodbp_load(subsystem, classname);
+    loaded = TRUE;
+    i = 0;
+  }
+#ifdef COIN_THREADSAFE
+  sodbp_lazymutex.unlock();
+#endif // COIN_THREADSAFE
+  return loaded;
+}
+
+// Initializes the named subsystem now if it is still pending, for
+// code which needs its classes to be registered, like built-in
+// subclasses of them.
+void
+SoDBP::loadSubsystem(const char * name)
+{
+#ifdef COIN_THREADSAFE
+  sodbp_lazymutex.lock();
+#endif // COIN_THREADSAFE
+  for (int i = 0; SoDBP::lazysubsystems && i < SoDBP::lazysubsystems->getLength(); i++) {
+    const LazySubsystem subsystem = (*SoDBP::lazysubsystems)[i];
+    if (strcmp(subsystem.name, name) == 0) {
+      SoDBP::lazysubsystems->remove(i);
+      sodbp_load(subsystem, NULL);
+      break;
+    }
+  }
+#ifdef COIN_THREADSAFE
+  sodbp_lazymutex.unlock();
+#endif // COIN_THREADSAFE
+}
+
+// *************************************************************************
+
 void
 SoDBP::removeRealTimeFieldCB(void)
 {
@@ -43,10 +43,14 @@
 
 #include <Inventor/SoDB.h>
 #include <Inventor/SbString.h>
+#include <Inventor/SbTime.h>
 
 #include "misc/SbHash.h"
 
+#include <unordered_map>
+
 class SoSensor;
+class SoNotList;
 class SbRWMutex;
 
 // *************************************************************************
@@ -92,6 +96,20 @@ public:
   static int notificationcounter;
   static SbBool isinitialized;
 
+  // notifications deferred by SoDB::startNotifyBatch()
+  struct DeferredNotify {
+    SoField * field;
+    SoBase * base;
+  };
+  static int notifybatchdepth;
+  static SbList<DeferredNotify> * deferrednotify;
+  static std::unordered_map<const void *, int> * deferredindex;
+  static const SoNotList * flushnotlist;
+
+  static SbBool deferNotify(SoField * field, SoBase * base);
+  static void forgetDeferredNotify(const void * object);
+  static void flushDeferredNotify(void);
+
   static SbBool is3dsFile(SoInput * in);
   static SoSeparator * read3DSFile(SoInput * in);
 
@@ -108,6 +126,40 @@ public:
     }
   };
   static SbList<struct ProgressCallbackInfo> * progresscblist;
+
+  // Startup timing, reported when COIN_DEBUG_INIT_TIMING is set. Each
+  // lap() records the time since the previous one for a group of
+  // initClass() calls, and report() posts the list.
+  class InitTimer {
+  public:
+    InitTimer(const char * where);
+    void lap(const char * group);
+    void report(void) const;
+  private:
+    const char * where;
+    SbTime start, last;
+    SbList<const char *> groups;
+    SbList<double> times;
+  };
+
+  // Subsystems which are registered on first use when COIN_LAZY_INIT
+  // is set. The class name patterns (without the "So" prefix, with an
+  // optional leading or trailing '*') are matched against the names
+  // of unknown types looked up with SoType::fromName() and against
+  // built-in classes constructed before their initClass() was called.
+  typedef void LazyInitFunc(void);
+  struct LazySubsystem {
+    const char * name;
+    LazyInitFunc * func;
+    const char * const * patterns;
+  };
+  static SbBool lazyinit;
+  static SbList<LazySubsystem> * lazysubsystems;
+
+  static void addLazySubsystem(const char * name, LazyInitFunc * func,
+                               const char * const * patterns);
+  static SbBool loadSubsystemsFor(const char * classname);
+  static void loadSubsystem(const char * name);
 };
 
 #endif // !COIN_SODBP_H
@@ -58,6 +58,11 @@
 #include <Inventor/nodes/SoExtSelection.h>
 #include <Inventor/nodes/SoSurroundScale.h>
 
+#include <Inventor/nodekits/SoNodeKit.h>
+#ifdef HAVE_NODEKITS
+#include <Inventor/nodekits/SoInteractionKit.h>
+#endif // HAVE_NODEKITS
+
 #ifdef HAVE_DRAGGERS
 #include <Inventor/draggers/SoDragger.h>
 #endif // HAVE_DRAGGERS
@@ -77,9 +82,43 @@
 #endif // HAVE_MANIPULATORS
 
 #include "C/CoinTidbits.h"
+#include "misc/SoDBP.h"
 
 static SbBool interaction_isinitialized = FALSE;
 
+static const char * const interaction_classes[] = {
+  "InteractionKit", "*Dragger", "*Manip", NULL
+};
+
+static void interaction_initclasses(void)
+{
+  // the interaction classes derive from the nodekit classes
+  SoDBP::loadSubsystem("nodekits");
+
+#ifdef HAVE_NODEKITS
+  SoInteractionKit::initClass();
+#endif // HAVE_NODEKITS
+
+#ifdef HAVE_DRAGGERS
+  SoDragger::initClass();
+#endif // HAVE_DRAGGERS
+
+#ifdef HAVE_MANIPULATORS
+  SoClipPlaneManip::initClass();
+  SoDirectionalLightManip::initClass();
+  SoPointLightManip::initClass();
+  SoSpotLightManip::initClass();
+  SoTransformManip::initClass();
+  SoCenterballManip::initClass();
+  SoHandleBoxManip::initClass();
+  SoJackManip::initClass();
+  SoTabBoxManip::initClass();
+  SoTrackballManip::initClass();
+  SoTransformBoxManip::initClass();
+  SoTransformerManip::initClass();
+#endif // HAVE_MANIPULATORS
+}
+
 static void interaction_cleanup(void)
 {
   interaction_isinitialized = FALSE;
@@ -97,6 +136,10 @@ static void interaction_cleanup(void)
   make sure all classes that the interaction functionality depends on
   have been initialized.
 
+  If the environment variable \c COIN_LAZY_INIT is set, the dragger
+  and manipulator classes are not registered until one of them is
+  constructed or their types are looked up by name, see SoDB::init().
+
 
   Application programmers should usually not have to invoke this method
   directly from application code, as it is indirectly called from the
@@ -136,24 +179,18 @@ SoInteraction::init(void)
   SoExtSelection::initClass();
   SoSurroundScale::initClass();
 
-#ifdef HAVE_DRAGGERS
-  SoDragger::initClass();
-#endif // HAVE_DRAGGERS
+  SoNodeKit::init();
 
-#ifdef HAVE_MANIPULATORS
-  SoClipPlaneManip::initClass();
-  SoDirectionalLightManip::initClass();
-  SoPointLightManip::initClass();
-  SoSpotLightManip::initClass();
-  SoTransformManip::initClass();
-  SoCenterballManip::initClass();
-  SoHandleBoxManip::initClass();
-  SoJackManip::initClass();
-  SoTabBoxManip::initClass();
-  SoTrackballManip::initClass();
-  SoTransformBoxManip::initClass();
-  SoTransformerManip::initClass();
-#endif // HAVE_MANIPULATORS
+  if (SoDBP::lazyinit) {
+    SoDBP::addLazySubsystem("interaction", interaction_initclasses,
+                            interaction_classes);
+  }
+  else {
+    SoDBP::InitTimer timer("SoInteraction::init");
+    interaction_initclasses();
+    timer.lap("draggers and manipulators");
+    timer.report();
+  }
 
   interaction_isinitialized = TRUE;
   coin_atexit((coin_atexit_f*)interaction_cleanup, CC_ATEXIT_NORMAL);
@@ -0,0 +1,407 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+/*!
+  \class SoSceneSnapshot SoSceneSnapshot.h Inventor/misc/SoSceneSnapshot.h
+  \brief The SoSceneSnapshot class lets threads traverse a scene graph while another thread changes it.
+
+  SoDB::readlock() and SoDB::writelock() protect the scene graph with
+  a single lock, so a thread changing the scene graph has to wait for
+  every traversal to finish, and every traversal has to wait for the
+  change. SoSceneSnapshot instead keeps immutable copies, or
+  versions, of a scene graph for reading threads.
+
+  The scene graph given to setSceneGraph() is only changed and read
+  by the writing thread, as usual. When the writer has completed a set
+  of changes, publish() makes a new version. Only the nodes that have
+  changed since the last version, and the groups above them, are
+  copied. Everything else, including the caches of unchanged
+  separators and shapes, is shared with the previous version.
+
+  A reading thread gets the current version with beginRead(), and it
+  stays valid until the thread calls endRead(). Versions replaced by
+  publish() are kept until no reading thread can still be using them
+  (epoch based reclamation), and are released by the next publish()
+  or reclaim() call.
+
+  \code
+  // writer
+  translation->translation.setValue(x, y, z);
+  coords->point.setValues(0, n, points);
+  snapshot.publish();
+
+  // readers
+  SoNode * root = snapshot.beginRead();
+  if (root) renderaction->apply(root);
+  snapshot.endRead();
+  \endcode
+
+  publish(), reclaim() and setSceneGraph() must be called from the
+  writing thread. The writer should not take SoDB::writelock(), since
+  that would stall the actions applied by the readers. If several
+  threads change the scene graph, they must be serialised in some
+  other way, for instance with an SbMutex.
+
+  Groups are copied one level at a time, sharing the copies of their
+  children. Other nodes are copied with SoNode::copy(), so nodes with
+  hidden children (like node kits) are copied as a whole. Node names
+  are not copied, since the copies would show up in SoNode::getByName().
+  Since a version is never changed, field connections in the scene
+  graph are evaluated when the version is made, and the readers see
+  the values from that time.
+
+  \sa SoDB::readlock(), SoParallelRenderer
+*/
+
+#include <Inventor/misc/SoSceneSnapshot.h>
+
+#include <atomic>
+#include <cassert>
+#include <new>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <Inventor/lists/SbList.h>
+#include <Inventor/nodes/SoGroup.h>
+#include <Inventor/threads/SbStorage.h>
+
+// *************************************************************************
+
+class SoSceneSnapshotP {
+public:
+  // per reading thread. epoch is zero when the thread is not reading
+  class Reader {
+  public:
+    std::atomic<uint64_t> epoch;
+    int depth;
+  };
+
+  class Copy {
+  public:
+    Copy(void) : node(NULL), nodeid(0) { }
+    SoNode * node;
+    SbUniqueId nodeid;
+  };
+
+  class Retired {
+  public:
+    SoNode * root;
+    uint64_t epoch;
+  };
+
+  SoSceneSnapshotP(void)
+    : scene(NULL), current(NULL), epoch(1), version(0),
+      numlive(0), readers(sizeof(Reader), reader_construct, reader_destruct)
+  {
+  }
+
+  SoNode * scene;
+  std::atomic<SoNode *> current;
+  std::atomic<uint64_t> epoch;
+  uint32_t version;
+
+  // the newest copy of each node in the scene graph. Only used by
+  // the writing thread
+  std::unordered_map<const SoNode *, Copy> copies;
+  size_t numlive;
+  SbList<Retired> retired;
+  SbStorage readers;
+
+  SoNode * copyNode(SoNode * node);
+  void clearCopies(void);
+  void sweepCopies(void);
+  uint64_t getMinReaderEpoch(void);
+
+  static void reader_construct(void * closure) {
+    Reader * reader = new (closure) Reader;
+    reader->epoch.store(0);
+    reader->depth = 0;
+  }
+  static void reader_destruct(void * closure) {
+    static_cast<Reader *>(closure)->~Reader();
+  }
+  static void min_epoch_cb(void * tls, void * closure) {
+    const uint64_t epoch = static_cast<Reader *>(tls)->epoch.load();
+    uint64_t * minepoch = static_cast<uint64_t *>(closure);
+    if (epoch != 0 && epoch < *minepoch) *minepoch = epoch;
+  }
+  static void mark_live(const SoNode * node, std::unordered_set<const SoNode *> & live);
+};
+
+#define PRIVATE(obj) ((obj)->pimpl)
+
+// Returns a copy of node which is up to date, reusing the copy from
+// the previous version if the node hasn't changed since. Changes to
+// children are notified to their parents, so the node id of a group
+// tells whether anything below it has changed.
+SoNode *
+SoSceneSnapshotP::copyNode(SoNode * node)
+{
+  auto it = this->copies.find(node);
+  if (it != this->copies.end() && it->second.nodeid == node->getNodeId()) {
+    return it->second.node;
+  }
+
+  SoNode * copy;
+  if (node->isOfType(SoGroup::getClassTypeId())) {
+    SoGroup * group = static_cast<SoGroup *>(node);
+    SoGroup * groupcopy = static_cast<SoGroup *>(node->getTypeId().createInstance());
+    groupcopy->ref();
+    groupcopy->copyFieldValues(group, FALSE);
+    const int num = group->getNumChildren();
+    for (int i = 0; i < num; i++) {
+      groupcopy->addChild(this->copyNode(group->getChild(i)));
+    }
+    copy = groupcopy;
+  }
+  else {
+    copy = node->copy(FALSE);
+    copy->ref();
+  }
+
+  // the recursion above might have added entries, so look up again
+  Copy & entry = this->copies[node];
+  if (entry.node) entry.node->unref();
+  entry.node = copy;
+  entry.nodeid = node->getNodeId();
+  return copy;
+}
+
+void
+SoSceneSnapshotP::clearCopies(void)
+{
+  for (auto & it : this->copies) it.second.node->unref();
+  this->copies.clear();
+  this->numlive = 0;
+}
+
+void
+SoSceneSnapshotP::mark_live(const SoNode * node,
+                            std::unordered_set<const SoNode *> & live)
+{
+  if (!live.insert(node).second) return;
+  if (node->isOfType(SoGroup::getClassTypeId())) {
+    const SoGroup * group = static_cast<const SoGroup *>(node);
+    const int num = group->getNumChildren();
+    for (int i = 0; i < num; i++) mark_live(group->getChild(i), live);
+  }
+}
+
+// Releases the copies of nodes that are no longer in the scene
+// graph. This needs a full traversal, so it's only done when the
+// number of copies has doubled since the last time.
+void
+SoSceneSnapshotP::sweepCopies(void)
+{
+  if (this->copies.size() <= 2 * this->numlive + 64) return;
+
+  std::unordered_set<const SoNode *> live;
+  if (this->scene) mark_live(this->scene, live);
+  for (auto it = this->copies.begin(); it != this->copies.end(); ) {
+    if (live.find(it->first) == live.end()) {
+      it->second.node->unref();
+      it = this->copies.erase(it);
+    }
+    else {
+      ++it;
+    }
+  }
+  this->numlive = this->copies.size();
+}
+
+uint64_t
+SoSceneSnapshotP::getMinReaderEpoch(void)
+{
+  uint64_t minepoch = UINT64_MAX;
+  this->readers.applyToAll(min_epoch_cb, &minepoch);
+  return minepoch;
+}
+
+// *************************************************************************
+
+/*!
+  Constructor. If \a scene is not \c NULL, the first version is
+  published right away.
+*/
+SoSceneSnapshot::SoSceneSnapshot(SoNode * scene)
+{
+  PRIVATE(this) = new SoSceneSnapshotP;
+  if (scene) this->setSceneGraph(scene);
+}
+
+/*!
+  Destructor. No thread can be reading from the snapshot when it is
+  destructed.
+*/
+SoSceneSnapshot::~SoSceneSnapshot()
+{
+  this->setSceneGraph(NULL);
+  SbList<SoSceneSnapshotP::Retired> & retired = PRIVATE(this)->retired;
+  for (int i = 0; i < retired.getLength(); i++) retired[i].root->unref();
+  delete PRIVATE(this);
+}
+
+/*!
+  Sets the scene graph to make versions of, and publishes the first
+  version. The scene graph is referenced by the snapshot.
+*/
+void
+SoSceneSnapshot::setSceneGraph(SoNode * scene)
+{
+  if (scene) scene->ref();
+  if (PRIVATE(this)->scene) PRIVATE(this)->scene->unref();
+  PRIVATE(this)->scene = scene;
+  PRIVATE(this)->clearCopies();
+  this->publish();
+}
+
+/*!
+  Returns the scene graph set with setSceneGraph().
+*/
+SoNode *
+SoSceneSnapshot::getSceneGraph(void) const
+{
+  return PRIVATE(this)->scene;
+}
+
+/*!
+  Makes the current state of the scene graph the version returned by
+  beginRead(). Returns \c FALSE if nothing has changed since the last
+  version, in which case no new version is made.
+
+  Versions that are no longer used by any reading thread are released.
+*/
+SbBool
+SoSceneSnapshot::publish(void)
+{
+  SoNode * old = PRIVATE(this)->current.load();
+  SoNode * root = PRIVATE(this)->scene ? PRIVATE(this)->copyNode(PRIVATE(this)->scene) : NULL;
+  if (root == old) {
+    this->reclaim();
+    return FALSE;
+  }
+  if (root) root->ref();
+
+  // readers which got hold of the old version have entered an epoch
+  // no later than the one it is tagged with
+  PRIVATE(this)->current.store(root);
+  const uint64_t epoch = PRIVATE(this)->epoch.fetch_add(1);
+  if (old) {
+    SoSceneSnapshotP::Retired retired;
+    retired.root = old;
+    retired.epoch = epoch;
+    PRIVATE(this)->retired.append(retired);
+  }
+  PRIVATE(this)->version++;
+
+  PRIVATE(this)->sweepCopies();
+  this->reclaim();
+  return TRUE;
+}
+
+/*!
+  Returns the number of versions published so far.
+*/
+uint32_t
+SoSceneSnapshot::getVersion(void) const
+{
+  return PRIVATE(this)->version;
+}
+
+/*!
+  Returns the current version of the scene graph, or \c NULL if there
+  is no scene graph. The version must not be changed, and can be used
+  until endRead() is called. Calls can be nested.
+
+  It is safe to call this from any thread, while the writing thread
+  is changing the scene graph or publishing a new version.
+*/
+SoNode *
+SoSceneSnapshot::beginRead(void)
+{
+  SoSceneSnapshotP::Reader * reader =
+    static_cast<SoSceneSnapshotP::Reader *>(PRIVATE(this)->readers.get());
+  if (reader->depth++ == 0) {
+    reader->epoch.store(PRIVATE(this)->epoch.load());
+  }
+  return PRIVATE(this)->current.load();
+}
+
+/*!
+  Ends reading the version returned by beginRead().
+*/
+void
+SoSceneSnapshot::endRead(void)
+{
+  SoSceneSnapshotP::Reader * reader =
+    static_cast<SoSceneSnapshotP::Reader *>(PRIVATE(this)->readers.get());
+  assert(reader->depth > 0 && "endRead() without beginRead()");
+  if (--reader->depth == 0) {
+    reader->epoch.store(0);
+  }
+}
+
+/*!
+  Releases the replaced versions which no reading thread can be
+  using anymore. This is done by publish() as well, so it only needs
+  to be called to free memory when nothing is published for a while.
+*/
+void
+SoSceneSnapshot::reclaim(void)
+{
+  SbList<SoSceneSnapshotP::Retired> & retired = PRIVATE(this)->retired;
+  if (retired.getLength() == 0) return;
+
+  const uint64_t minepoch = PRIVATE(this)->getMinReaderEpoch();
+  int i = 0;
+  while (i < retired.getLength()) {
+    if (retired[i].epoch < minepoch) {
+      retired[i].root->unref();
+      retired.removeFast(i);
+    }
+    else {
+      i++;
+    }
+  }
+}
+
+/*!
+  Returns the number of replaced versions which have not been
+  released yet, since reading threads might still be using them.
+*/
+int
+SoSceneSnapshot::getNumRetiredVersions(void) const
+{
+  return PRIVATE(this)->retired.getLength();
+}
+
+#undef PRIVATE
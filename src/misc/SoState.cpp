@@ -111,6 +111,10 @@ public:
   sostate_pushstore * prev;
 };
 
+// Number of pushstores allocated at a time. Deep graphs will need a
+// few blocks, but most states never grow beyond the first one.
+#define SOSTATE_PUSHSTORE_BLOCKSIZE 32
+
 // class to store private data members
 class SoStateP {
 public:
@@ -119,6 +123,19 @@ public:
   int depth;
   SbBool ispopping;
   class sostate_pushstore * pushstore;
+  SbList <sostate_pushstore *> pushstoreblocks;
+
+  // allocates a block of linked pushstores, and returns the first
+  sostate_pushstore * allocPushstores(sostate_pushstore * prev) {
+    sostate_pushstore * block = new sostate_pushstore[SOSTATE_PUSHSTORE_BLOCKSIZE];
+    this->pushstoreblocks.append(block);
+    for (int i = 0; i < SOSTATE_PUSHSTORE_BLOCKSIZE; i++) {
+      block[i].prev = (i == 0) ? prev : &block[i-1];
+      block[i].next = (i == SOSTATE_PUSHSTORE_BLOCKSIZE-1) ? NULL : &block[i+1];
+    }
+    if (prev) prev->next = block;
+    return block;
+  }
 };
 
 #define PRIVATE(obj) ((obj)->pimpl)
@@ -171,7 +188,7 @@ SoState::SoState(SoAction * theAction, const SoTypeList & enabledelements)
       element->init(this); // called for first element in state stack
     }
   }
-  PRIVATE(this)->pushstore = new sostate_pushstore;
+  PRIVATE(this)->pushstore = PRIVATE(this)->allocPushstores(NULL);
 }
 
 /*!
@@ -196,12 +213,8 @@ SoState::~SoState(void)
   delete[] PRIVATE(this)->initial;
   delete[] this->stack;
 
-  sostate_pushstore * item = PRIVATE(this)->pushstore;
-  while (item->prev) item = item->prev; // go to first item
-  while (item) {
-    sostate_pushstore * next = item->next;
-    delete item;
-    item = next;
+  for (int j = 0; j < PRIVATE(this)->pushstoreblocks.getLength(); j++) {
+    delete[] PRIVATE(this)->pushstoreblocks[j];
   }
   delete PRIVATE(this);
 }
@@ -275,9 +288,7 @@ void
 SoState::push(void)
 {
   if (PRIVATE(this)->pushstore->next == NULL) {
-    sostate_pushstore * store = new sostate_pushstore;
-    store->prev = PRIVATE(this)->pushstore;
-    PRIVATE(this)->pushstore->next = store;
+    (void) PRIVATE(this)->allocPushstores(PRIVATE(this)->pushstore);
   }
   PRIVATE(this)->pushstore = PRIVATE(this)->pushstore->next;
   PRIVATE(this)->pushstore->elements.truncate(0);
@@ -312,6 +323,47 @@ SoState::pop(void)
   PRIVATE(this)->ispopping = FALSE;
 }
 
+/*!
+  \COININTERNAL
+
+  Prepares a state left behind by a destructed action for reuse by
+  \a action, so the element instances allocated for the stacks can be
+  reused instead of constructing a new state. The state must be
+  popped back to depth 0.
+
+  The bottom element of each stack is replaced by a new instance,
+  initialized with SoElement::init() like in a new state. Running
+  init() again on the old instance is not enough, since elements
+  don't necessarily reset everything there, and actions applied to a
+  path or a root node which isn't a separator leave their changes in
+  the bottom elements. The elements above it are kept for later
+  pushes, which set them up from the element below, as when an
+  action is applied again.
+*/
+void
+SoState::reinit(SoAction * action)
+{
+  assert(PRIVATE(this)->depth == 0);
+  PRIVATE(this)->action = action;
+  this->cacheopen = FALSE;
+  for (int i = 0; i < this->numstacks; i++) {
+    SoElement * old = PRIVATE(this)->initial[i];
+    if (old) {
+      assert(this->stack[i] == old);
+      SoElement * const element = (SoElement *) old->getTypeId().createInstance();
+      element->setDepth(0);
+      element->nextup = old->nextup;
+      if (element->nextup) element->nextup->nextdown = element;
+      old->nextup = NULL;
+      delete old;
+      this->stack[i] = element;
+      PRIVATE(this)->initial[i] = element;
+      element->init(this);
+    }
+  }
+  PRIVATE(this)->pushstore->elements.truncate(0);
+}
+
 /*!
   This method is just for debugging purposes.
 */
@@ -148,6 +148,7 @@
 
 
 #include "misc/SbHash.h"
+#include "misc/SoDBP.h"
 #include "SoEnvironment.h"
 
 #include "coindefs.h"
@@ -539,7 +540,14 @@ SoType::fromName(const SbName name)
       return SoType::badType();
     }
 
-    if (enable_dynload) {
+    // The type may belong to a subsystem which is registered on first
+    // use, see SoDBP::addLazySubsystem().
+    if (SoDBP::loadSubsystemsFor(noprefixname.getString()) &&
+        (type_dict->get(name.getString(), index) ||
+         type_dict->get(noprefixname.getString(), index))) {
+      // found it
+    }
+    else if (enable_dynload) {
 
       // Ensure dynload_tries is initialized
       if (dynload_tries == NULL) {
@@ -99,6 +99,9 @@
 #include "../C/CoinTidbits.h"
 #include "coindefs.h" // COIN_OBSOLETED()
 #include "nodekits/SoSubKitP.h"
+#ifdef HAVE_DRAGGERS
+#include "draggers/SoDraggerDefaults.h"
+#endif // HAVE_DRAGGERS
 
 /*!
   \enum SoInteractionKit::CacheEnabled
@@ -457,6 +460,13 @@ SoInteractionKit::readInstance(SoInput * in, unsigned short flags)
   If both a \a fileName and a \a defaultBuffer are provided, the file
   will be attempted found and loaded first, if that fails, the
   geometry will be attempted read from the buffer.
+
+  The default geometry of the built-in draggers is also compiled into
+  the library in a form which can be instantiated without going
+  through the file parser. When no resource file was loaded, and \a
+  fileName names one of these and \a defaultBuffer is the built-in
+  buffer it was compiled from, it is used instead of parsing \a
+  defaultBuffer.
 */
 void
 SoInteractionKit::readDefaultParts(const char * fileName,
@@ -493,6 +503,12 @@ SoInteractionKit::readDefaultParts(const char * fileName,
     }
   }
 
+#ifdef HAVE_DRAGGERS
+  if (!root && fileName && defaultBuffer) {
+    root = SoDraggerDefaults::instantiate(fileName, defaultBuffer);
+  }
+#endif // HAVE_DRAGGERS
+
   if (!root && defaultBuffer) {
     input.setBuffer(defaultBuffer, defBufSize);
     root = (SoNode *)SoDB::readAll(&input);
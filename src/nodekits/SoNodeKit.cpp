@@ -62,9 +62,31 @@
 #endif // HAVE_NODEKITS
 
 #include "../C/CoinTidbits.h"
+#include "misc/SoDBP.h"
 
 static SbBool nodekit_isinitialized = FALSE;
 
+static const char * const nodekit_classes[] = {
+  "NodeKitListPart", "BaseKit", "AppearanceKit", "CameraKit", "LightKit",
+  "SceneKit", "SeparatorKit", "ShapeKit", "WrapperKit", NULL
+};
+
+static void nodekit_initclasses(void)
+{
+#ifdef HAVE_NODEKITS
+  SoNodeKitListPart::initClass();
+
+  SoBaseKit::initClass();
+  SoAppearanceKit::initClass();
+  SoCameraKit::initClass();
+  SoLightKit::initClass();
+  SoSceneKit::initClass();
+  SoSeparatorKit::initClass();
+  SoShapeKit::initClass();
+  SoWrapperKit::initClass();
+#endif // HAVE_NODEKITS
+}
+
 static void nodekit_cleanup(void)
 {
   nodekit_isinitialized = FALSE;
@@ -80,6 +102,10 @@ static void nodekit_cleanup(void)
 
   This method is also called from within SoInteraction::init(), as the
   interaction functionality in Coin depends on the nodekit classes.
+
+  If the environment variable \c COIN_LAZY_INIT is set, the nodekit
+  classes are not registered until a nodekit is constructed or one of
+  their types is looked up by name, see SoDB::init().
  */
 void
 SoNodeKit::init(void)
@@ -94,18 +120,15 @@ SoNodeKit::init(void)
     return;
   }
 
-#ifdef HAVE_NODEKITS
-  SoNodeKitListPart::initClass();
-
-  SoBaseKit::initClass();
-  SoAppearanceKit::initClass();
-  SoCameraKit::initClass();
-  SoLightKit::initClass();
-  SoSceneKit::initClass();
-  SoSeparatorKit::initClass();
-  SoShapeKit::initClass();
-  SoWrapperKit::initClass();
-#endif // HAVE_NODEKITS
+  if (SoDBP::lazyinit) {
+    SoDBP::addLazySubsystem("nodekits", nodekit_initclasses, nodekit_classes);
+  }
+  else {
+    SoDBP::InitTimer timer("SoNodeKit::init");
+    nodekit_initclasses();
+    timer.lap("nodekits");
+    timer.report();
+  }
 
   nodekit_isinitialized = TRUE;
   cc_coin_atexit_static_internal((coin_atexit_f*) nodekit_cleanup);
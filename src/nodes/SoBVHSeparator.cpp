@@ -0,0 +1,669 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+/*!
+  \class SoBVHSeparator SoBVHSeparator.h Inventor/nodes/SoBVHSeparator.h
+  \brief The SoBVHSeparator class is a separator with a spatial index over its children.
+
+  \ingroup coin_nodes
+
+  Scene graphs imported from other formats often end up with a single
+  separator holding a very large number of child separators. An
+  SoSeparator culls each of its children in turn, so rendering and
+  picking such a group takes time proportional to the number of
+  children, even when only a few of them are in view or hit by the
+  pick ray.
+
+  SoBVHSeparator keeps a bounding volume hierarchy over the bounding
+  boxes of its children, and uses it to find the children in the view
+  volume when rendering, and the children which may be hit when ray
+  picking, without visiting the others. The visible children are
+  still traversed in the order they are in the scene graph.
+
+  The hierarchy is built when an SoGetBoundingBoxAction is applied to
+  the node, which viewers do to set up the clipping planes. When a
+  child changes, only its bounding box is recalculated on the next
+  bounding box traversal, and the hierarchy is refitted. Until then
+  the changed child is always traversed.
+
+  The hierarchy is only used when none of the children affects the
+  state of the following children, i.e. when the children are
+  separators or shapes. Otherwise, and until the first bounding box
+  traversal, the node works like an SoSeparator. Render caching is
+  not done for the node itself while the hierarchy is used, but the
+  children still cache as usual.
+
+  <b>FILE FORMAT/DEFAULTS:</b>
+  \code
+    BVHSeparator {
+        renderCaching AUTO
+        boundingBoxCaching AUTO
+        renderCulling AUTO
+        pickCulling AUTO
+    }
+  \endcode
+
+  \since Coin 4.1
+*/
+
+#include <Inventor/nodes/SoBVHSeparator.h>
+
+#include <algorithm>
+
+#include <Inventor/actions/SoGLRenderAction.h>
+#include <Inventor/actions/SoGetBoundingBoxAction.h>
+#include <Inventor/actions/SoRayPickAction.h>
+#include <Inventor/caches/SoBoundingBoxCache.h>
+#include <Inventor/elements/SoCacheElement.h>
+#include <Inventor/elements/SoCullElement.h>
+#include <Inventor/elements/SoLocalBBoxMatrixElement.h>
+#include <Inventor/lists/SbList.h>
+#include <Inventor/misc/SoChildList.h>
+#include <Inventor/misc/SoNotification.h>
+#include <Inventor/misc/SoState.h>
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
+#ifdef COIN_THREADSAFE
+#include <Inventor/threads/SbMutex.h>
+#endif // COIN_THREADSAFE
+
+#include "nodes/SoSubNodeP.h"
+#include "misc/SbHash.h"
+
+// *************************************************************************
+
+// maximum number of children in a leaf of the hierarchy
+#define SOBVH_LEAFSIZE 4
+
+class SoBVHSeparatorP {
+public:
+  SoBVHSeparatorP(void)
+    : cache(NULL), built(FALSE), duplicates(FALSE) { }
+  ~SoBVHSeparatorP() {
+    if (this->cache) this->cache->unref();
+  }
+
+  // A node in the hierarchy. The nodes are stored depth first, so
+  // the left child of an inner node follows it, and the right child
+  // is at index right. Leaves refer to count entries in order,
+  // starting at first.
+  class BVHNode {
+  public:
+    SbBox3f box;
+    int first;
+    int count;
+    int right;
+  };
+
+  SbBool canIndex(const SoChildList * children) const;
+  void build(const SoChildList * children);
+  int buildNode(const int first, const int count);
+  void refit(const SoChildList * children, const SbList <int> & updated);
+  void markDirty(const int child);
+  SbBool isUsable(SoState * state) const;
+  SbBool cull(SoState * state, SbList <int> & visible);
+  void cullNode(SoState * state, const int node, SbList <int> & visible);
+  SbBool pick(SoRayPickAction * action, SbList <int> & hits);
+  void pickRays(SoRayPickAction * action, const int node, SbList <int> & hits);
+  void addUnindexed(SbList <int> & list) const;
+
+  // per child bounding boxes, in the space of the node
+  SbList <SbBox3f> childboxes;
+  SbList <SbVec3f> centroids;
+  // children changed since the hierarchy was built or refitted
+  SbList <unsigned char> dirtyflags;
+  SbList <int> dirty;
+  // children with empty bounding boxes, which are always traversed
+  SbList <int> unbounded;
+  SbList <int> order;
+  SbList <BVHNode> nodes;
+  SbHash<const SoBase *, int> childindex;
+
+  // records the elements the child boxes depend on
+  SoBoundingBoxCache * cache;
+  SbBox3f bbox;
+  SbBool built;
+  SbBool duplicates;
+
+#ifdef COIN_THREADSAFE
+  SbMutex mutex;
+#endif // COIN_THREADSAFE
+  void lock(void) {
+#ifdef COIN_THREADSAFE
+    this->mutex.lock();
+#endif // COIN_THREADSAFE
+  }
+  void unlock(void) {
+#ifdef COIN_THREADSAFE
+    this->mutex.unlock();
+#endif // COIN_THREADSAFE
+  }
+};
+
+#define PRIVATE(obj) ((obj)->pimpl)
+
+// *************************************************************************
+
+SO_NODE_SOURCE(SoBVHSeparator);
+
+/*!
+  Default constructor.
+*/
+SoBVHSeparator::SoBVHSeparator(void)
+{
+  SO_NODE_INTERNAL_CONSTRUCTOR(SoBVHSeparator);
+}
+
+/*!
+  Constructor.
+
+  The argument should be the approximate number of children which is
+  expected to be inserted below this node. The number need not be
+  exact, as it is only used as a hint for better memory resource
+  allocation.
+*/
+SoBVHSeparator::SoBVHSeparator(const int nchildren)
+  : inherited(nchildren)
+{
+  SO_NODE_INTERNAL_CONSTRUCTOR(SoBVHSeparator);
+}
+
+/*!
+  Destructor.
+*/
+SoBVHSeparator::~SoBVHSeparator()
+{
+}
+
+// Doc in superclass.
+/*!
+  \copybrief SoBase::initClass(void)
+*/
+void
+SoBVHSeparator::initClass(void)
+{
+  SO_NODE_INTERNAL_INIT_CLASS(SoBVHSeparator, SO_FROM_COIN_4_0);
+}
+
+/*!
+  Renders the children in the view volume, using the hierarchy to
+  skip the others.
+*/
+void
+SoBVHSeparator::GLRenderBelowPath(SoGLRenderAction * action)
+{
+  SoState * state = action->getState();
+  // render caches must hold all the children, so don't cull while
+  // one is being built
+  if (this->renderCulling.getValue() == OFF || state->isCacheOpen()) {
+    inherited::GLRenderBelowPath(action);
+    return;
+  }
+
+  state->push();
+  SbList <int> visible;
+  if (!PRIVATE(this)->cull(state, visible)) {
+    state->pop();
+    inherited::GLRenderBelowPath(action);
+    return;
+  }
+
+  SoNode ** childarray = reinterpret_cast<SoNode **>(this->children->getArrayPtr());
+  action->pushCurPath();
+  for (int i = 0; i < visible.getLength() && !action->hasTerminated(); i++) {
+    const int idx = visible[i];
+    action->popPushCurPath(idx, childarray[idx]);
+    if (action->abortNow()) break;
+    childarray[idx]->GLRenderBelowPath(action);
+  }
+  action->popCurPath();
+  state->pop();
+}
+
+/*!
+  Calculates the bounding box of each child, and builds or refits the
+  hierarchy.
+*/
+void
+SoBVHSeparator::getBoundingBox(SoGetBoundingBoxAction * action)
+{
+  SoState * state = action->getState();
+  const SoAction::PathCode pathcode = action->getCurPathCode();
+  SbBool index =
+    (pathcode == SoAction::NO_PATH || pathcode == SoAction::BELOW_PATH) &&
+    !action->isInCameraSpace() && !action->isResetPath() &&
+    this->boundingBoxCaching.getValue() != OFF;
+
+  PRIVATE(this)->lock();
+  SoBoundingBoxCache * oldcache = PRIVATE(this)->cache;
+  if (oldcache) oldcache->ref();
+  const SbBool rebuild = !PRIVATE(this)->built || !oldcache || !oldcache->isValid(state);
+  PRIVATE(this)->unlock();
+
+  if (index && rebuild) index = PRIVATE(this)->canIndex(this->children);
+  if (!index) {
+    if (oldcache) oldcache->unref();
+    inherited::getBoundingBox(action);
+    return;
+  }
+
+  SbBox3f bbox;
+  if (!rebuild && PRIVATE(this)->dirty.getLength() == 0) {
+    SoCacheElement::addCacheDependency(state, oldcache);
+    if (oldcache->hasLinesOrPoints()) SoBoundingBoxCache::setHasLinesOrPoints(state);
+    bbox = PRIVATE(this)->bbox;
+  }
+  else {
+    const SbXfBox3f abox = action->getXfBoundingBox();
+    const SbBool storedinvalid = SoCacheElement::setInvalid(FALSE);
+    state->push();
+
+    SoBoundingBoxCache * cache = new SoBoundingBoxCache(state);
+    cache->ref();
+    SoCacheElement::set(state, cache);
+    SoLocalBBoxMatrixElement::makeIdentity(state);
+
+    PRIVATE(this)->lock();
+    const int numchildren = this->children->getLength();
+    SbList <int> update;
+    if (rebuild) {
+      PRIVATE(this)->childboxes.truncate(0);
+      for (int i = 0; i < numchildren; i++) {
+        PRIVATE(this)->childboxes.append(SbBox3f());
+        update.append(i);
+      }
+    }
+    else {
+      // the unchanged children keep their boxes, and the elements
+      // they depend on
+      SoCacheElement::addCacheDependency(state, oldcache);
+      if (oldcache->hasLinesOrPoints()) SoBoundingBoxCache::setHasLinesOrPoints(state);
+      update = PRIVATE(this)->dirty;
+    }
+    PRIVATE(this)->unlock();
+
+    SbList <SbBox3f> boxes;
+    for (int i = 0; i < update.getLength(); i++) {
+      action->getXfBoundingBox().makeEmpty();
+      this->children->traverse(action, update[i]);
+      boxes.append(action->getXfBoundingBox().project());
+    }
+    action->getXfBoundingBox() = abox;
+
+    PRIVATE(this)->lock();
+    for (int i = 0; i < update.getLength(); i++) {
+      PRIVATE(this)->childboxes[update[i]] = boxes[i];
+    }
+    if (rebuild) PRIVATE(this)->build(this->children);
+    else PRIVATE(this)->refit(this->children, update);
+    bbox = PRIVATE(this)->bbox;
+    cache->set(SbXfBox3f(bbox), !bbox.isEmpty(), bbox.isEmpty() ? SbVec3f(0.0f, 0.0f, 0.0f) : bbox.getCenter());
+    if (PRIVATE(this)->cache) PRIVATE(this)->cache->unref();
+    PRIVATE(this)->cache = cache;
+    PRIVATE(this)->unlock();
+
+    state->pop();
+    SoCacheElement::setInvalid(storedinvalid);
+  }
+  if (oldcache) oldcache->unref();
+
+  if (!bbox.isEmpty()) {
+    action->extendBy(bbox);
+    action->resetCenter();
+    action->setCenter(bbox.getCenter(), TRUE);
+  }
+}
+
+/*!
+  Picks the children whose bounding boxes are hit by the pick ray,
+  using the hierarchy to skip the others.
+*/
+void
+SoBVHSeparator::rayPick(SoRayPickAction * action)
+{
+  const SoAction::PathCode pathcode = action->getCurPathCode();
+  if (this->pickCulling.getValue() == OFF ||
+      (pathcode != SoAction::NO_PATH && pathcode != SoAction::BELOW_PATH)) {
+    inherited::rayPick(action);
+    return;
+  }
+
+  SoState * state = action->getState();
+  state->push();
+  SbList <int> hits;
+  if (!PRIVATE(this)->pick(action, hits)) {
+    state->pop();
+    inherited::rayPick(action);
+    return;
+  }
+  for (int i = 0; i < hits.getLength() && !action->hasTerminated(); i++) {
+    this->children->traverse(action, hits[i]);
+  }
+  state->pop();
+}
+
+/*!
+  Marks the bounding box of a changed child for recalculation. Other
+  changes make the hierarchy be rebuilt.
+*/
+void
+SoBVHSeparator::notify(SoNotList * nl)
+{
+  SoNotRec * rec = nl->getLastRec();
+  PRIVATE(this)->lock();
+  if (PRIVATE(this)->built) {
+    int idx;
+    // notifications from fields of this node, or from the child list,
+    // have this node as the base
+    if (rec && rec->getBase() != static_cast<SoBase *>(this) &&
+        !PRIVATE(this)->duplicates &&
+        PRIVATE(this)->childindex.get(rec->getBase(), idx)) {
+      PRIVATE(this)->markDirty(idx);
+    }
+    else {
+      PRIVATE(this)->built = FALSE;
+    }
+  }
+  PRIVATE(this)->unlock();
+  inherited::notify(nl);
+}
+
+#undef PRIVATE
+
+// *************************************************************************
+
+// the hierarchy can only be used if the children can be traversed in
+// any subset without changing what they do
+SbBool
+SoBVHSeparatorP::canIndex(const SoChildList * children) const
+{
+  const int n = children->getLength();
+  for (int i = 0; i < n; i++) {
+    if ((*children)[i]->affectsState()) return FALSE;
+  }
+  return TRUE;
+}
+
+void
+SoBVHSeparatorP::build(const SoChildList * children)
+{
+  const int n = this->childboxes.getLength();
+  this->nodes.truncate(0);
+  this->order.truncate(0);
+  this->unbounded.truncate(0);
+  this->centroids.truncate(0);
+  this->dirty.truncate(0);
+  this->dirtyflags.truncate(0);
+  this->childindex.clear();
+  this->duplicates = FALSE;
+  this->bbox.makeEmpty();
+
+  for (int i = 0; i < n; i++) {
+    const SbBox3f & box = this->childboxes[i];
+    // a child used more than once can't be mapped back to its index
+    // when it changes
+    int previous;
+    if (this->childindex.get((*children)[i], previous)) this->duplicates = TRUE;
+    else this->childindex.put((*children)[i], i);
+    this->dirtyflags.append(0);
+    this->centroids.append(box.isEmpty() ? SbVec3f(0.0f, 0.0f, 0.0f) : box.getCenter());
+    if (box.isEmpty()) this->unbounded.append(i);
+    else {
+      this->order.append(i);
+      this->bbox.extendBy(box);
+    }
+  }
+  this->built = TRUE;
+  if (this->order.getLength()) this->buildNode(0, this->order.getLength());
+}
+
+// builds the subtree over count entries in order, starting at first,
+// splitting at the median centroid along the longest axis
+int
+SoBVHSeparatorP::buildNode(const int first, const int count)
+{
+  const int idx = this->nodes.getLength();
+  this->nodes.append(BVHNode());
+
+  int * entries = const_cast<int *>(this->order.getArrayPtr()) + first;
+  SbBox3f box, centerbox;
+  for (int i = 0; i < count; i++) {
+    box.extendBy(this->childboxes[entries[i]]);
+    centerbox.extendBy(this->centroids[entries[i]]);
+  }
+
+  BVHNode node;
+  node.box = box;
+  node.first = first;
+  node.count = count;
+  node.right = -1;
+  if (count > SOBVH_LEAFSIZE) {
+    float dx, dy, dz;
+    centerbox.getSize(dx, dy, dz);
+    const int axis = (dx >= dy && dx >= dz) ? 0 : (dy >= dz ? 1 : 2);
+    const int half = count / 2;
+    const SbVec3f * centroids = this->centroids.getArrayPtr();
+    std::nth_element(entries, entries + half, entries + count,
+                     [centroids, axis](const int a, const int b) {
+                       return centroids[a][axis] < centroids[b][axis];
+                     });
+    node.count = 0;
+    (void) this->buildNode(first, half);
+    node.right = this->buildNode(first + half, count - half);
+  }
+  this->nodes[idx] = node;
+  return idx;
+}
+
+// updates the nodes above the children with recalculated boxes
+void
+SoBVHSeparatorP::refit(const SoChildList * children, const SbList <int> & updated)
+{
+  for (int i = 0; i < updated.getLength(); i++) {
+    const int child = updated[i];
+    // children gaining or losing their bounding box move between the
+    // hierarchy and the unbounded list, which needs a rebuild
+    const SbBool wasempty = this->unbounded.find(child) >= 0;
+    if (wasempty != this->childboxes[child].isEmpty()) {
+      this->build(children);
+      return;
+    }
+    this->dirtyflags[child] = 0;
+  }
+  // keep children which changed again while their boxes were calculated
+  SbList <int> stilldirty;
+  for (int i = 0; i < this->dirty.getLength(); i++) {
+    if (this->dirtyflags[this->dirty[i]]) stilldirty.append(this->dirty[i]);
+  }
+  this->dirty = stilldirty;
+
+  // children are after their parents, so a reverse sweep sees them first
+  this->bbox.makeEmpty();
+  for (int i = this->nodes.getLength() - 1; i >= 0; i--) {
+    BVHNode & node = this->nodes[i];
+    node.box.makeEmpty();
+    if (node.count) {
+      for (int j = 0; j < node.count; j++) {
+        node.box.extendBy(this->childboxes[this->order[node.first + j]]);
+      }
+    }
+    else {
+      node.box.extendBy(this->nodes[i + 1].box);
+      node.box.extendBy(this->nodes[node.right].box);
+    }
+  }
+  if (this->nodes.getLength()) this->bbox = this->nodes[0].box;
+}
+
+void
+SoBVHSeparatorP::markDirty(const int child)
+{
+  if (child < this->dirtyflags.getLength() && !this->dirtyflags[child]) {
+    this->dirtyflags[child] = 1;
+    this->dirty.append(child);
+  }
+}
+
+// the hierarchy is not used when it is out of date, or when too many
+// children have changed since it was built
+SbBool
+SoBVHSeparatorP::isUsable(SoState * state) const
+{
+  if (!this->built || !this->cache || !this->cache->isValid(state)) return FALSE;
+  return this->dirty.getLength() * 4 <= this->childboxes.getLength();
+}
+
+// appends the children traversed regardless of the hierarchy
+void
+SoBVHSeparatorP::addUnindexed(SbList <int> & list) const
+{
+  for (int i = 0; i < this->unbounded.getLength(); i++) list.append(this->unbounded[i]);
+  for (int i = 0; i < this->dirty.getLength(); i++) list.append(this->dirty[i]);
+}
+
+// collects the children in the view volume, in scene graph order
+SbBool
+SoBVHSeparatorP::cull(SoState * state, SbList <int> & visible)
+{
+  this->lock();
+  if (!this->isUsable(state)) {
+    this->unlock();
+    return FALSE;
+  }
+  if (this->nodes.getLength()) this->cullNode(state, 0, visible);
+  this->addUnindexed(visible);
+  this->unlock();
+
+  int * entries = const_cast<int *>(visible.getArrayPtr());
+  std::sort(entries, entries + visible.getLength());
+  return TRUE;
+}
+
+void
+SoBVHSeparatorP::cullNode(SoState * state, const int idx, SbList <int> & visible)
+{
+  const BVHNode & node = this->nodes[idx];
+  const SbBool inside = SoCullElement::completelyInside(state);
+  if (!inside) {
+    state->push();
+    if (SoCullElement::cullBox(state, node.box)) {
+      state->pop();
+      return;
+    }
+  }
+  if (node.count) {
+    const SbBool allinside = SoCullElement::completelyInside(state);
+    for (int i = 0; i < node.count; i++) {
+      const int child = this->order[node.first + i];
+      if (this->dirtyflags[child]) continue;
+      if (allinside || !SoCullElement::cullTest(state, this->childboxes[child])) {
+        visible.append(child);
+      }
+    }
+  }
+  else {
+    this->cullNode(state, idx + 1, visible);
+    this->cullNode(state, node.right, visible);
+  }
+  if (!inside) state->pop();
+}
+
+// collects the children which may be hit by the pick ray, in scene
+// graph order
+SbBool
+SoBVHSeparatorP::pick(SoRayPickAction * action, SbList <int> & hits)
+{
+  const SbBool batched = action->getNumRays() > 0;
+  if (!batched && !action->hasWorldSpaceRay()) return FALSE;
+
+  this->lock();
+  if (!this->isUsable(action->getState())) {
+    this->unlock();
+    return FALSE;
+  }
+  if (this->nodes.getLength()) {
+    if (batched) {
+      this->pickRays(action, 0, hits);
+    }
+    else {
+      action->setObjectSpace();
+      SbList <int> stack;
+      stack.push(0);
+      while (stack.getLength()) {
+        const int idx = stack.pop();
+        const BVHNode & node = this->nodes[idx];
+        if (!action->intersect(node.box, TRUE)) continue;
+        if (node.count) {
+          for (int i = 0; i < node.count; i++) {
+            const int child = this->order[node.first + i];
+            if (!this->dirtyflags[child]) hits.append(child);
+          }
+        }
+        else {
+          stack.push(node.right);
+          stack.push(idx + 1);
+        }
+      }
+    }
+  }
+  this->addUnindexed(hits);
+  this->unlock();
+
+  int * entries = const_cast<int *>(hits.getArrayPtr());
+  std::sort(entries, entries + hits.getLength());
+  return TRUE;
+}
+
+// batched picking, narrows the rays down the hierarchy
+void
+SoBVHSeparatorP::pickRays(SoRayPickAction * action, const int idx, SbList <int> & hits)
+{
+  const BVHNode & node = this->nodes[idx];
+  if (action->pushRays(node.box)) {
+    if (node.count) {
+      for (int i = 0; i < node.count; i++) {
+        const int child = this->order[node.first + i];
+        if (!this->dirtyflags[child]) hits.append(child);
+      }
+    }
+    else {
+      this->pickRays(action, idx + 1, hits);
+      this->pickRays(action, node.right, hits);
+    }
+  }
+  action->popRays();
+}
+
+#undef SOBVH_LEAFSIZE
@@ -149,9 +149,8 @@ SoCoordinate3::GLRender(SoGLRenderAction * action)
       dirty = TRUE;
     }
     if (dirty) {
-      PRIVATE(this)->vbo->setBufferData(this->point.getValues(0),
-                                        num*sizeof(SbVec3f),
-                                        this->getNodeId());
+      PRIVATE(this)->vbo->setVertexData(this->point.getValues(0),
+                                        num, this->getNodeId());
     }
   }
   else if (PRIVATE(this)->vbo && PRIVATE(this)->vbo->getBufferDataId()) {
@@ -55,6 +55,12 @@
   you find discrepancies between Coin's SoExtSelection and VSG's
   SoExtSelection node.
 
+  If the environment variable COIN_USE_IDBUFFER_PICKING is set to a
+  positive value, SoExtSelection::VISIBLE_SHAPES selection looks up
+  the visible primitives with an SoIdBufferPickAction, instead of
+  rendering and scanning the scene with color coded primitives in
+  several passes.
+
   <b>FILE FORMAT/DEFAULTS:</b>
   \code
     ExtSelection {
@@ -102,6 +108,7 @@
 #include <Inventor/actions/SoCallbackAction.h>
 #include <Inventor/actions/SoGLRenderAction.h>
 #include <Inventor/actions/SoHandleEventAction.h>
+#include <Inventor/actions/SoIdBufferPickAction.h>
 #include <Inventor/caches/SoBoundingBoxCache.h>
 #include <Inventor/details/SoFaceDetail.h>
 #include <Inventor/elements/SoCullElement.h>
@@ -276,6 +283,7 @@ public:
   SbViewportRegion curvp;
 
   static SbBool debug(void);
+  static SbBool useIdBuffer(void);
 
   void handleEventRectangle(SoHandleEventAction * action);
   void handleEventLasso(SoHandleEventAction * action);
@@ -298,6 +306,15 @@ public:
   SbBool scanOffscreenBuffer(SoNode * root);
   void addVisitedPath(const SoPath *path);
 
+  void performIdBufferSelection(SoHandleEventAction * action);
+  int32_t nextIdBufferPrimitive(void) {
+    if (!this->idbuffermode || this->idshapebase < 0) return -1;
+    return this->idshapebase + this->idshapeprimitive++;
+  }
+  SbBool isIdBufferPrimitiveVisible(const int32_t id) const {
+    return (id >= 0) && (this->visibletrianglesbitarray[id >> 3] & (0x1 << (id & 0x07)));
+  }
+
   SbBool checkOffscreenRendererCapabilities();
 
   static void offscreenRenderCallback(void * userdata, SoAction * action);
@@ -447,6 +464,13 @@ public:
 
   unsigned char *visibletrianglesbitarray;
 
+  // Used instead of the offscreen renderers for VISIBLE_SHAPES when
+  // COIN_USE_IDBUFFER_PICKING is set.
+  SoIdBufferPickAction * idpickaction;
+  SbBool idbuffermode;
+  int32_t idshapebase;
+  int32_t idshapeprimitive;
+
   SoNode *offscreenheadnode;
   unsigned int drawcallbackcounter;
   unsigned int drawcounter;
@@ -471,6 +495,17 @@ SoExtSelectionP::debug(void)
   return dbg ? TRUE : FALSE;
 }
 
+SbBool
+SoExtSelectionP::useIdBuffer(void)
+{
+  static int useidbuffer = -1;
+  if (useidbuffer == -1) {
+    auto env = CoinInternal::getEnvironmentVariable("COIN_USE_IDBUFFER_PICKING");
+    useidbuffer = env.has_value() && (std::atoi(env->c_str()) > 0);
+  }
+  return useidbuffer ? TRUE : FALSE;
+}
+
 // *************************************************************************
 
 //
@@ -804,6 +839,11 @@ SoExtSelection::SoExtSelection(void)
   PRIVATE(this)->renderer = NULL;
   PRIVATE(this)->lassorenderer = NULL;
 
+  PRIVATE(this)->idpickaction = NULL;
+  PRIVATE(this)->idbuffermode = FALSE;
+  PRIVATE(this)->idshapebase = -1;
+  PRIVATE(this)->idshapeprimitive = 0;
+
 }
 
 /*!
@@ -813,6 +853,7 @@ SoExtSelection::~SoExtSelection()
 {
   delete PRIVATE(this)->renderer;
   delete PRIVATE(this)->lassorenderer;
+  delete PRIVATE(this)->idpickaction;
   delete PRIVATE(this)->cbaction;
   delete PRIVATE(this)->visitedshapepaths;
   delete PRIVATE(this);
@@ -1434,6 +1475,14 @@ SoExtSelectionP::preShapeCallback(void *data, SoCallbackAction *action, const So
     return SoCallbackAction::PRUNE;
   }
 
+  if (PRIVATE(ext)->idbuffermode) {
+    // primitives are numbered per shape in the identifier buffer, so
+    // shapes culled by testShape() don't offset the numbering
+    PRIVATE(ext)->idshapebase =
+      PRIVATE(ext)->idpickaction->getFirstId(action->getCurPath());
+    PRIVATE(ext)->idshapeprimitive = 0;
+  }
+
   return PRIVATE(ext)->testShape(action, (const SoShape*) node);
 }
 
@@ -1723,6 +1772,7 @@ SoExtSelectionP::triangleCB(void * userData,
 
   thisp->primcbdata.hasgeometry = TRUE;
   thisp->drawcallbackcounter++;
+  const int32_t primid = thisp->nextIdBufferPrimitive();
 
   if (!thisp->applyonlyonselectedtriangles) {
     thisp->addTriangleToOffscreenBuffer(action, v1, v2, v3, TRUE);
@@ -1833,15 +1883,23 @@ SoExtSelectionP::triangleCB(void * userData,
   } else {  // --- Second pass. Feeding visible tris to client.
 
 
-    if(thisp->drawcounter > thisp->maximumcolorcounter){
-      thisp->offscreencolorcounteroverflow = TRUE;
-      return;
+    SbBool visible;
+    if (thisp->idbuffermode) {
+      visible = thisp->isIdBufferPrimitiveVisible(primid);
     }
+    else {
+      if(thisp->drawcounter > thisp->maximumcolorcounter){
+        thisp->offscreencolorcounteroverflow = TRUE;
+        return;
+      }
 
-    int flag = 0x1 << (thisp->offscreencolorcounter & 0x07);
-    int index = thisp->offscreencolorcounter >> 3;
+      int flag = 0x1 << (thisp->offscreencolorcounter & 0x07);
+      int index = thisp->offscreencolorcounter >> 3;
+      visible = (thisp->visibletrianglesbitarray[index] & flag) != 0;
+      ++thisp->offscreencolorcounter;
+    }
 
-    if (thisp->visibletrianglesbitarray[index] & flag){
+    if (visible){
       thisp->somefacesvisible = TRUE;
       if (thisp->triangleFilterCB &&
           thisp->triangleFilterCB(thisp->triangleFilterCBData, action, v1, v2, v3)){
@@ -1849,7 +1907,6 @@ SoExtSelectionP::triangleCB(void * userData,
         thisp->primcbdata.allhit = TRUE;
       }
     }
-    ++thisp->offscreencolorcounter;
   }
 }
 
@@ -1940,6 +1997,7 @@ SoExtSelectionP::lineSegmentCB(void *userData,
 
   thisp->primcbdata.hasgeometry = TRUE;
   thisp->drawcallbackcounter++;
+  const int32_t primid = thisp->nextIdBufferPrimitive();
 
   if (!thisp->applyonlyonselectedtriangles) {
     thisp->addLineToOffscreenBuffer(action, v1, v2, TRUE);
@@ -2030,22 +2088,29 @@ SoExtSelectionP::lineSegmentCB(void *userData,
 
   } else { // ---- Second pass
 
-    if(thisp->drawcounter > thisp->maximumcolorcounter){
-      thisp->offscreencolorcounteroverflow = TRUE;
-      return;
+    SbBool visible;
+    if (thisp->idbuffermode) {
+      visible = thisp->isIdBufferPrimitiveVisible(primid);
     }
+    else {
+      if(thisp->drawcounter > thisp->maximumcolorcounter){
+        thisp->offscreencolorcounteroverflow = TRUE;
+        return;
+      }
 
-    int flag = 0x1 << (thisp->offscreencolorcounter & 0x07);
-    int index = thisp->offscreencolorcounter >> 3;
+      int flag = 0x1 << (thisp->offscreencolorcounter & 0x07);
+      int index = thisp->offscreencolorcounter >> 3;
+      visible = (thisp->visibletrianglesbitarray[index] & flag) != 0;
+      ++thisp->offscreencolorcounter;
+    }
 
-    if (thisp->visibletrianglesbitarray[index] & flag) {
+    if (visible) {
       if (thisp->lineFilterCB &&
           thisp->lineFilterCB(thisp->lineFilterCBData, action, v1, v2)) {
         thisp->primcbdata.hit = TRUE;
         thisp->primcbdata.allhit = TRUE;
       }
     }
-    ++thisp->offscreencolorcounter;
   }
 }
 
@@ -2106,6 +2171,7 @@ SoExtSelectionP::pointCB(void *userData,
  
   thisp->primcbdata.hasgeometry = TRUE;
   thisp->drawcallbackcounter++;
+  const int32_t primid = thisp->nextIdBufferPrimitive();
 
   if (!thisp->applyonlyonselectedtriangles) {
     thisp->addPointToOffscreenBuffer(action, v, TRUE);
@@ -2181,22 +2247,29 @@ SoExtSelectionP::pointCB(void *userData,
 
   } else { // ---- Second pass
 
-    if(thisp->drawcounter > thisp->maximumcolorcounter){
-      thisp->offscreencolorcounteroverflow = TRUE;
-      return;
+    SbBool visible;
+    if (thisp->idbuffermode) {
+      visible = thisp->isIdBufferPrimitiveVisible(primid);
     }
+    else {
+      if(thisp->drawcounter > thisp->maximumcolorcounter){
+        thisp->offscreencolorcounteroverflow = TRUE;
+        return;
+      }
 
-    int flag = 0x1 << (thisp->offscreencolorcounter & 0x07);
-    int index = thisp->offscreencolorcounter >> 3;
+      int flag = 0x1 << (thisp->offscreencolorcounter & 0x07);
+      int index = thisp->offscreencolorcounter >> 3;
+      visible = (thisp->visibletrianglesbitarray[index] & flag) != 0;
+      ++thisp->offscreencolorcounter;
+    }
 
-    if (thisp->visibletrianglesbitarray[index] & flag) {
+    if (visible) {
       if (thisp->pointFilterCB &&
           thisp->pointFilterCB(thisp->pointFilterCBData, action, v)) {
         thisp->primcbdata.hit = TRUE;
         thisp->primcbdata.allhit = TRUE;
       }
     }
-    ++thisp->offscreencolorcounter;
   }
 }
 
@@ -2606,6 +2679,10 @@ SoExtSelectionP::performSelection(SoHandleEventAction * action)
     this->cbaction->apply(action->getCurPath()->getHead());
 
   }
+  else if (SoExtSelectionP::useIdBuffer()) {
+    primcbdata.allshapes = FALSE;
+    this->performIdBufferSelection(action);
+  }
   else {
 
     //
@@ -2754,6 +2831,52 @@ SoExtSelectionP::performSelection(SoHandleEventAction * action)
   PUBLIC(this)->touch();
 }
 
+// VISIBLE_SHAPES selection through an SoIdBufferPickAction. The
+// visible primitives within the lasso are looked up in the identifier
+// buffer, and the callback action is then applied once, feeding only
+// those primitives to the filter callbacks. This replaces the
+// offscreen render, stencil render and buffer scan of the default
+// implementation, and has no limit on the number of primitives per
+// pass.
+void
+SoExtSelectionP::performIdBufferSelection(SoHandleEventAction * action)
+{
+  SoNode * root = action->getCurPath()->getHead();
+
+  if (this->idpickaction == NULL) {
+    this->idpickaction = new SoIdBufferPickAction(action->getViewportRegion());
+  }
+  this->idpickaction->setViewportRegion(action->getViewportRegion());
+  this->idpickaction->apply(root);
+
+  SbList<int32_t> ids;
+  this->idpickaction->pickLasso(this->runningselection.coords.getArrayPtr(),
+                                this->runningselection.coords.getLength(),
+                                ids);
+  if (ids.getLength() == 0) return;
+
+  const int numbytes = (this->idpickaction->getNumIds() + 7) / 8;
+  this->visibletrianglesbitarray = new unsigned char[numbytes];
+  memset(this->visibletrianglesbitarray, 0, numbytes);
+  for (int i = 0; i < ids.getLength(); i++) {
+    this->visibletrianglesbitarray[ids[i] >> 3] |= (unsigned char) (0x1 << (ids[i] & 0x07));
+  }
+
+  this->offscreencolorcounterpasses = 0;
+  this->offscreencolorcounteroverflow = FALSE;
+  this->offscreenskipcounter = 0;
+  this->drawcallbackcounter = 0;
+  this->drawcounter = 0;
+  this->applyonlyonselectedtriangles = TRUE;
+
+  this->idbuffermode = TRUE;
+  this->cbaction->apply(root);
+  this->idbuffermode = FALSE;
+
+  delete [] this->visibletrianglesbitarray;
+  this->visibletrianglesbitarray = NULL;
+}
+
 //
 // avoid an empty viewport bounding box (support for a single click and 
 // a 1-pixel-size rectangles/lassos).
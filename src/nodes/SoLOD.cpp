@@ -260,7 +260,7 @@ SoLOD::GLRender(SoGLRenderAction * action)
 void
 SoLOD::GLRenderBelowPath(SoGLRenderAction * action)
 {
-  int idx = this->whichToTraverse(action);
+  int idx = action->selectLODChild(this, this->whichToTraverse(action));
   if (idx >= 0) {
     SoNode * child = (SoNode*) this->children->get(idx);
     action->pushCurPath(idx, child);
@@ -317,7 +317,7 @@ SoLOD::GLRenderInPath(SoGLRenderAction * action)
 void
 SoLOD::GLRenderOffPath(SoGLRenderAction * action)
 {
-  int idx = this->whichToTraverse(action);;
+  int idx = action->selectLODChild(this, this->whichToTraverse(action));
   if (idx >= 0) {
     SoNode * node = this->getChild(idx);
     if (node->affectsState()) {
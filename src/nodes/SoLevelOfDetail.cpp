@@ -409,6 +409,9 @@ SoLevelOfDetail::doAction(SoAction *action)
   // (fall through to traverse:)
 
  traverse:
+  if (action->isOfType(SoGLRenderAction::getClassTypeId())) {
+    idx = static_cast<SoGLRenderAction *>(action)->selectLODChild(this, idx);
+  }
   this->getChildren()->traverse(action, idx);
   return;
 }
@@ -40,6 +40,13 @@
   Coin we always draw to the back buffer, forcing a scene redraw
   whenever a highlight state changes.
 
+  If the environment variable COIN_USE_IDBUFFER_PICKING is set to a
+  positive value, the geometry under the cursor is found with an
+  SoIdBufferPickAction instead of through the ray pick of the
+  SoHandleEventAction. The identifier buffer is only rendered again
+  when the scene graph or the viewport changes, so mouse moves over
+  a static scene become buffer lookups.
+
   <b>FILE FORMAT/DEFAULTS:</b>
   \code
     LocateHighlight {
@@ -58,6 +65,8 @@
 
 #include <Inventor/nodes/SoLocateHighlight.h>
 
+#include <cstdlib>
+
 #ifdef HAVE_CONFIG_H
 #include <config.h>
 #endif // HAVE_CONFIG_H
@@ -67,6 +76,7 @@
 #include <Inventor/SoFullPath.h>
 #include <Inventor/actions/SoGLRenderAction.h>
 #include <Inventor/actions/SoHandleEventAction.h>
+#include <Inventor/actions/SoIdBufferPickAction.h>
 #include <Inventor/misc/SoState.h>
 #include <Inventor/misc/SoChildList.h>
 #include <Inventor/events/SoLocation2Event.h>
@@ -78,6 +88,7 @@
 
 #include "C/CoinTidbits.h"
 #include "nodes/SoSubNodeP.h"
+#include "misc/SoEnvironment.h"
 
 // *************************************************************************
 
@@ -154,12 +165,26 @@ public:
   }
   SbBool highlighted;
   static SoFullPath * currenthighlight;
+  static SoIdBufferPickAction * idpickaction;
+
+  static SbBool useIdBuffer(void) {
+    static int useidbuffer = -1;
+    if (useidbuffer == -1) {
+      const char * env = CoinInternal::getEnvironmentVariableRaw("COIN_USE_IDBUFFER_PICKING");
+      useidbuffer = env && (atoi(env) > 0);
+    }
+    return useidbuffer;
+  }
+
+  static SbBool isUnderCursor(SoHandleEventAction * action);
 
   static void atexit_cleanup(void) {
     if (SoLocateHighlightP::currenthighlight) {
       SoLocateHighlightP::currenthighlight->unref();
       SoLocateHighlightP::currenthighlight = NULL;
     }
+    delete SoLocateHighlightP::idpickaction;
+    SoLocateHighlightP::idpickaction = NULL;
   }
 #ifdef COIN_THREADSAFE
 private:
@@ -176,6 +201,32 @@ private:
 };
 
 SoFullPath * SoLocateHighlightP::currenthighlight = NULL;
+SoIdBufferPickAction * SoLocateHighlightP::idpickaction = NULL;
+
+// Returns TRUE if the geometry under the cursor is below the node at
+// the tail of the action's current path.
+SbBool
+SoLocateHighlightP::isUnderCursor(SoHandleEventAction * action)
+{
+  if (!SoLocateHighlightP::useIdBuffer()) {
+    const SoPickedPoint * pp = action->getPickedPoint();
+    return pp && pp->getPath()->containsPath(action->getCurPath());
+  }
+
+  // One action is shared by all SoLocateHighlight nodes, as they will
+  // usually be in the same scene graph and can then share the buffer.
+  if (SoLocateHighlightP::idpickaction == NULL) {
+    SoLocateHighlightP::idpickaction =
+      new SoIdBufferPickAction(action->getViewportRegion());
+  }
+  SoIdBufferPickAction * ida = SoLocateHighlightP::idpickaction;
+  ida->setViewportRegion(action->getViewportRegion());
+  ida->apply(action->getCurPath()->getHead());
+
+  const SoPath * path =
+    ida->getPath(ida->pickPoint(action->getEvent()->getPosition()));
+  return path && path->containsPath(action->getCurPath());
+}
 
 // *************************************************************************
 
@@ -247,8 +298,7 @@ SoLocateHighlight::handleEvent(SoHandleEventAction * action)
   if (mymode == AUTO) {
     const SoEvent * event = action->getEvent();
     if (event->isOfType(SoLocation2Event::getClassTypeId())) {
-      const SoPickedPoint * pp = action->getPickedPoint();
-      if (pp && pp->getPath()->containsPath(action->getCurPath())) {
+      if (SoLocateHighlightP::isUnderCursor(action)) {
         if (!PRIVATE(this)->highlighted) {
           SoLocateHighlight::turnoffcurrent(action);
           SoLocateHighlightP::currenthighlight = (SoFullPath*)
@@ -636,6 +636,7 @@ SoNode::initClasses(void)
   SoGroup::initClass();
   SoSeparator::initClass();
   SoAnnotation::initClass();
+  SoBVHSeparator::initClass();
   SoLocateHighlight::initClass();
   SoWWWAnchor::initClass();
   SoArray::initClass();
@@ -1165,7 +1166,14 @@ SoNode::rayPickS(SoAction * action, SoNode * node)
   assert(action && node);
   assert(action->getTypeId().isDerivedFrom(SoRayPickAction::getClassTypeId()));
   SoRayPickAction * const rayPickAction = (SoRayPickAction *)(action);
-  node->rayPick(rayPickAction);
+  if (rayPickAction->getNumRays() > 0 &&
+      node->isOfType(SoShape::getClassTypeId())) {
+    // batched picking, see SoRayPickAction::setRays()
+    rayPickAction->traverseRays(node);
+  }
+  else {
+    node->rayPick(rayPickAction);
+  }
 }
 
 // Note that this documentation will also be used for all subclasses
@@ -148,9 +148,8 @@ SoNormal::GLRender(SoGLRenderAction * action)
       dirty = TRUE;
     }
     if (dirty) {
-      PRIVATE(this)->vbo->setBufferData(this->vector.getValues(0),
-                                        num*sizeof(SbVec3f),
-                                        this->getNodeId());
+      PRIVATE(this)->vbo->setNormalData(this->vector.getValues(0),
+                                        num, this->getNodeId());
     }
   }
   else if (PRIVATE(this)->vbo && PRIVATE(this)->vbo->getBufferDataId()) {
@@ -251,6 +251,11 @@ int SoSeparator::numrendercaches = 2;
   Policy for caching bounding box calculations. Default value is
   SoSeparator::AUTO.
 
+  With \c AUTO, the bounding box is always cached for an
+  SoGetBoundingBoxAction with
+  SoGetBoundingBoxAction::setSubgraphCaching() enabled. \c OFF
+  disables caching for those actions too.
+
   See also documentation for SoSeparator::renderCaching.
 */
 /*!
@@ -318,6 +323,9 @@ public:
   SoBoundingBoxCache * bboxcache;
   uint32_t bboxcache_usecount;
   uint32_t bboxcache_destroycount;
+  // bumped by notify(), so that a bbox cache built while the node
+  // changed is not published as valid
+  uint32_t notifycount;
 
 #ifdef COIN_THREADSAFE
   // FIXME: a mutex for every SoSeparator instance seems a bit
@@ -354,6 +362,16 @@ public:
 #endif // COIN_THREADSAFE
   }
 
+  // returns the bounding box cache with an extra reference, so that
+  // it stays alive if another thread replaces it
+  SoBoundingBoxCache * refBBoxCache(void) {
+    this->lock();
+    SoBoundingBoxCache * cache = this->bboxcache;
+    if (cache) cache->ref();
+    this->unlock();
+    return cache;
+  }
+
   static SbBool doCull(SoSeparatorP * thisp, SoState * state,
                        SbBool (* cullfunc)(SoState *, const SbBox3f &, const SbBool));
 };
@@ -442,6 +460,7 @@ SoSeparator::commonConstructor(void)
   PRIVATE(this)->bboxcache = NULL;
   PRIVATE(this)->bboxcache_usecount = 0;
   PRIVATE(this)->bboxcache_destroycount = 0;
+  PRIVATE(this)->notifycount = 0;
 
   // This environment variable is used for local stability / robustness /
   // correctness testing of the render caching. If set >= 1,
@@ -505,6 +524,10 @@ SoSeparator::getBoundingBox(SoGetBoundingBoxAction * action)
   // field, but we should trigger some heuristics based on scene graph
   // "behavior" in the children subgraphs if the value is set to
   // AUTO. 19990513 mortene.
+  // Actions with subgraph caching enabled are applied repeatedly to
+  // the same scene, so don't let the AUTO heuristics below turn
+  // caching off for those. An explicit OFF is still honored.
+  const SbBool subgraphcaching = action->isSubgraphCaching();
   SbBool iscaching = this->boundingBoxCaching.getValue() != OFF;
 
   switch (action->getCurPathCode()) {
@@ -525,25 +548,31 @@ SoSeparator::getBoundingBox(SoGetBoundingBoxAction * action)
     break;
   }
 
-  SbBool validcache = iscaching && PRIVATE(this)->bboxcache && PRIVATE(this)->bboxcache->isValid(state);
+  // ref the cache while using it, since another thread traversing
+  // the same separator might replace it
+  SoBoundingBoxCache * bboxcache = iscaching ? PRIVATE(this)->refBBoxCache() : NULL;
+  SbBool validcache = bboxcache && bboxcache->isValid(state);
 
   if (iscaching && validcache) {
-    SoCacheElement::addCacheDependency(state, PRIVATE(this)->bboxcache);
+    SoCacheElement::addCacheDependency(state, bboxcache);
     PRIVATE(this)->bboxcache_usecount++;
-    childrenbbox = PRIVATE(this)->bboxcache->getBox();
-    childrencenterset = PRIVATE(this)->bboxcache->isCenterSet();
-    childrencenter = PRIVATE(this)->bboxcache->getCenter();
-    if (PRIVATE(this)->bboxcache->hasLinesOrPoints()) {
+    childrenbbox = bboxcache->getBox();
+    childrencenterset = bboxcache->isCenterSet();
+    childrencenter = bboxcache->getCenter();
+    if (bboxcache->hasLinesOrPoints()) {
       SoBoundingBoxCache::setHasLinesOrPoints(state);
     }
+    bboxcache->unref();
   }
   else {
+    if (bboxcache) bboxcache->unref();
     SbXfBox3f abox = action->getXfBoundingBox();
 
     SbBool storedinvalid = FALSE;
 
     // check if we should disable auto caching
-    if (PRIVATE(this)->bboxcache_destroycount > 10 && this->boundingBoxCaching.getValue() == AUTO) {
+    if (PRIVATE(this)->bboxcache_destroycount > 10 && this->boundingBoxCaching.getValue() == AUTO &&
+        !subgraphcaching) {
       if (float(PRIVATE(this)->bboxcache_usecount) / float(PRIVATE(this)->bboxcache_destroycount) < 5.0f) {
         iscaching = FALSE;
       }
@@ -554,20 +583,17 @@ SoSeparator::getBoundingBox(SoGetBoundingBoxAction * action)
     }
     state->push();
 
+    uint32_t notifycount = 0;
     if (iscaching) {
-      // lock before changing the bboxcache pointer so that the notify()
-      // function can be used by another thread.
+      // the new cache is kept private until it's complete, so that
+      // other threads don't pick up an empty bounding box
       PRIVATE(this)->lock();
-      // if we get here, we know bbox cache is not created or is invalid
-      if (PRIVATE(this)->bboxcache) {
-        PRIVATE(this)->bboxcache_destroycount++;
-        PRIVATE(this)->bboxcache->unref();
-      }
-      PRIVATE(this)->bboxcache = new SoBoundingBoxCache(state);
-      PRIVATE(this)->bboxcache->ref();
+      notifycount = PRIVATE(this)->notifycount;
       PRIVATE(this)->unlock();
+      bboxcache = new SoBoundingBoxCache(state);
+      bboxcache->ref();
       // set active cache to record cache dependencies
-      SoCacheElement::set(state, PRIVATE(this)->bboxcache);
+      SoCacheElement::set(state, bboxcache);
     }
 
     SoLocalBBoxMatrixElement::makeIdentity(state);
@@ -581,7 +607,17 @@ SoSeparator::getBoundingBox(SoGetBoundingBoxAction * action)
     action->getXfBoundingBox() = abox; // reset action bbox
 
     if (iscaching) {
-      PRIVATE(this)->bboxcache->set(childrenbbox, childrencenterset, childrencenter);
+      bboxcache->set(childrenbbox, childrencenterset, childrencenter);
+      // lock before changing the bboxcache pointer so that the notify()
+      // function can be used by another thread.
+      PRIVATE(this)->lock();
+      if (PRIVATE(this)->notifycount != notifycount) bboxcache->invalidate();
+      if (PRIVATE(this)->bboxcache) {
+        PRIVATE(this)->bboxcache_destroycount++;
+        PRIVATE(this)->bboxcache->unref();
+      }
+      PRIVATE(this)->bboxcache = bboxcache;
+      PRIVATE(this)->unlock();
     }
     state->pop();
     if (iscaching) SoCacheElement::setInvalid(storedinvalid);
@@ -845,10 +881,27 @@ ray_intersect(SoRayPickAction * action, const SbBox3f &box)
 void
 SoSeparator::rayPick(SoRayPickAction * action)
 {
-  if (this->pickCulling.getValue() == OFF ||
-      !PRIVATE(this)->bboxcache || !PRIVATE(this)->bboxcache->isValid(action->getState()) ||
-      !action->hasWorldSpaceRay() ||
-      ray_intersect(action, PRIVATE(this)->bboxcache->getProjectedBox())) {
+  SoBoundingBoxCache * bboxcache =
+    this->pickCulling.getValue() == OFF ? NULL : PRIVATE(this)->refBBoxCache();
+  if (action->getNumRays() > 0) {
+    // batched picking, only traverse with the rays hitting the bbox
+    if (bboxcache && bboxcache->isValid(action->getState())) {
+      const SbBox3f box = bboxcache->getProjectedBox();
+      bboxcache->unref();
+      if (action->pushRays(box)) SoSeparator::doAction(action);
+      action->popRays();
+    }
+    else {
+      if (bboxcache) bboxcache->unref();
+      SoSeparator::doAction(action);
+    }
+    return;
+  }
+  const SbBool traverse = !bboxcache || !bboxcache->isValid(action->getState()) ||
+    !action->hasWorldSpaceRay() ||
+    ray_intersect(action, bboxcache->getProjectedBox());
+  if (bboxcache) bboxcache->unref();
+  if (traverse) {
     SoSeparator::doAction(action);
   }
 }
@@ -942,6 +995,7 @@ SoSeparator::notify(SoNotList * nl)
   // are valid while reading them
   PRIVATE(this)->lock();
   if (PRIVATE(this)->bboxcache) PRIVATE(this)->bboxcache->invalidate();
+  PRIVATE(this)->notifycount++;
   PRIVATE(this)->invalidateGLCaches();
   PRIVATE(this)->hassoundchild = SoSeparatorP::MAYBE;
   PRIVATE(this)->unlock();
@@ -976,13 +1030,15 @@ SoSeparatorP::doCull(SoSeparatorP * thisp, SoState * state,
   if (SoCullElement::completelyInside(state)) return FALSE;
 
   SbBool outside = FALSE;
-  if (thisp->bboxcache &&
-      thisp->bboxcache->isValid(state)) {
-    const SbBox3f & bbox = thisp->bboxcache->getProjectedBox();
+  SoBoundingBoxCache * bboxcache = thisp->refBBoxCache();
+  if (bboxcache &&
+      bboxcache->isValid(state)) {
+    const SbBox3f & bbox = bboxcache->getProjectedBox();
     if (!bbox.isEmpty()) {
       outside = (*cullfunc)(state, bbox, TRUE);
     }
   }
+  if (bboxcache) bboxcache->unref();
 
 #if 0
 // temporarily disabled. setNodeFlag() needs current path, which is
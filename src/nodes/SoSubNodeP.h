@@ -34,6 +34,7 @@
 \**************************************************************************/
 
 #include "C/CoinTidbits.h"
+#include "misc/SoDBP.h"
 
 // The macro definitions in this file are used internally by Coin
 // classes, and mirrors some of the public macros available in
@@ -70,6 +71,10 @@
 
 #define SO_NODE_INTERNAL_CONSTRUCTOR(_class_) \
   do { \
+    /* The class may belong to a subsystem registered on first use. */ \
+    if (_class_::classTypeId == SoType::badType()) { \
+      SoDBP::loadSubsystemsFor(SO__QUOTE(_class_)); \
+    } \
     SoBase::staticDataLock(); \
     SO_NODE_CONSTRUCTOR_NOLOCK(_class_); \
     /* Restore value of isBuiltIn flag (which is set to FALSE */ \
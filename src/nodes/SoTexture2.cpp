@@ -297,6 +297,11 @@
   fetched from SoTexture2::image and not from disk. (Specify either
   this field or use SoTexture2::image, not both.)
 
+  The file can also be a tile pyramid written with
+  SoGLBigImage::writeTilePyramid(). The image is then rendered with
+  SoGLBigImage, reading only the tiles needed for the current view,
+  and SoTexture2::image is left empty.
+
   FIXME: Section about simage is outdated.
 
   For reading texture image files from disk, Coin uses the "simage"
@@ -381,6 +386,7 @@ public:
   static SbMutex * mutex;
   int readstatus;
   SbBool glimagevalid;
+  SbString pyramidfile; // set when filename is a tile pyramid
 
   static void cleanup(void) {
     delete SoTexture2P::mutex;
@@ -525,7 +531,9 @@ SoTexture2::GLRender(SoGLRenderAction * action)
   const cc_glglue * glue = cc_glglue_instance(SoGLCacheContextElement::get(state));
   SoTextureScalePolicyElement::Policy scalepolicy =
     SoTextureScalePolicyElement::get(state);
-  SbBool needbig = (scalepolicy == SoTextureScalePolicyElement::FRACTURE);
+  const SbBool tiled = PRIVATE(this)->pyramidfile.getLength() > 0;
+  SbBool needbig = tiled ||
+    (scalepolicy == SoTextureScalePolicyElement::FRACTURE);
   SoType glimagetype = PRIVATE(this)->glimage ? PRIVATE(this)->glimage->getTypeId() : SoType::badType();
     
   LOCK_GLIMAGE(this);
@@ -558,7 +566,22 @@ SoTexture2::GLRender(SoGLRenderAction * action)
       PRIVATE(this)->glimage->setFlags(PRIVATE(this)->glimage->getFlags()|SoGLImage::SCALE_DOWN);
     }
 
-    if (bytes && size != SbVec2s(0,0)) {
+    if (tiled) {
+      SoGLBigImage * big = static_cast<SoGLBigImage *>(PRIVATE(this)->glimage);
+      if (big->setTilePyramid(PRIVATE(this)->pyramidfile.getString(),
+                              translateWrap((Wrap)this->wrapS.getValue()),
+                              translateWrap((Wrap)this->wrapT.getValue()),
+                              quality)) {
+        PRIVATE(this)->glimagevalid = TRUE;
+      }
+      else {
+        SoDebugError::postWarning("SoTexture2::GLRender",
+                                  "Could not open tile pyramid '%s'",
+                                  PRIVATE(this)->pyramidfile.getString());
+        PRIVATE(this)->pyramidfile.makeEmpty();
+      }
+    }
+    else if (bytes && size != SbVec2s(0,0)) {
       PRIVATE(this)->glimage->setData(bytes, size, nc,
                              translateWrap((Wrap)this->wrapS.getValue()),
                              translateWrap((Wrap)this->wrapT.getValue()),
@@ -791,6 +814,7 @@ SoTexture2::notify(SoNotList * l)
   SoField * f = l->getLastField();
   if (f == &this->image) {
     PRIVATE(this)->glimagevalid = FALSE;
+    PRIVATE(this)->pyramidfile.makeEmpty();
 
     // write image, not filename
     this->filename.setDefault(TRUE);
@@ -810,10 +834,24 @@ SbBool
 SoTexture2::loadFilename(void)
 {
   SbBool retval = FALSE;
+  PRIVATE(this)->pyramidfile.makeEmpty();
   if (this->filename.getValue().getLength()) {
     SbImage tmpimage;
     const SbStringList & sl = SoInput::getDirectories();
-    if (tmpimage.readFile(this->filename.getValue(),
+    // tile pyramids are read by SoGLBigImage while rendering
+    const SbString fullname =
+      SbImage::searchForFile(this->filename.getValue(),
+                             sl.getArrayPtr(), sl.getLength());
+    if (fullname.getLength() &&
+        SoGLBigImage::isTilePyramid(fullname.getString())) {
+      SbBool oldnotify = this->image.enableNotify(FALSE);
+      this->image.setValue(SbVec2s(0, 0), 0, NULL);
+      this->image.enableNotify(oldnotify);
+      PRIVATE(this)->pyramidfile = fullname;
+      PRIVATE(this)->glimagevalid = FALSE;
+      retval = TRUE;
+    }
+    else if (tmpimage.readFile(this->filename.getValue(),
                           sl.getArrayPtr(), sl.getLength())) {
       int nc;
       SbVec2s size;
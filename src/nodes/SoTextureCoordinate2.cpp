@@ -225,9 +225,8 @@ SoTextureCoordinate2::GLRender(SoGLRenderAction * action)
       dirty = TRUE;
     }
     if (dirty) {
-      PRIVATE(this)->vbo->setBufferData(this->point.getValues(0),
-                                        num*sizeof(SbVec2f),
-                                        this->getNodeId());
+      PRIVATE(this)->vbo->setTexCoordData(this->point.getValues(0)[0].getValue(),
+                                          num, 2, this->getNodeId());
     }
   }
   else if (PRIVATE(this)->vbo && PRIVATE(this)->vbo->getBufferDataId()) {
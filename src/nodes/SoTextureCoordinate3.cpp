@@ -181,9 +181,8 @@ SoTextureCoordinate3::GLRender(SoGLRenderAction * action)
       dirty = TRUE;
     }
     if (dirty) {
-      PRIVATE(this)->vbo->setBufferData(this->point.getValues(0),
-                                        num*sizeof(SbVec3f),
-                                        this->getNodeId());
+      PRIVATE(this)->vbo->setTexCoordData(this->point.getValues(0)[0].getValue(),
+                                          num, 3, this->getNodeId());
     }
   }
   else if (PRIVATE(this)->vbo && PRIVATE(this)->vbo->getBufferDataId()) {
@@ -191,7 +190,7 @@ SoTextureCoordinate3::GLRender(SoGLRenderAction * action)
     PRIVATE(this)->vbo->setBufferData(NULL, 0, 0);
   }
   SoBase::staticDataUnlock();
-  SoGLVBOElement::setVertexVBO(state, setvbo ? PRIVATE(this)->vbo : NULL);
+  SoGLVBOElement::setTexCoordVBO(state, 0, setvbo ? PRIVATE(this)->vbo : NULL);
 }
 
 // Documented in superclass.
@@ -436,9 +436,8 @@ SoVertexProperty::updateVertex(SoState * state, SbBool glrender, SbBool vbo)
           dirty = TRUE;
         }
         if (dirty) {
-          PRIVATE(this)->vertexvbo->setBufferData(this->vertex.getValues(0),
-                                                  num*sizeof(SbVec3f),
-                                                  this->getNodeId());
+          PRIVATE(this)->vertexvbo->setVertexData(this->vertex.getValues(0),
+                                                  num, this->getNodeId());
         }
       }
       else if (PRIVATE(this)->vertexvbo && PRIVATE(this)->vertexvbo->getBufferDataId()) {
@@ -511,14 +510,14 @@ SoVertexProperty::updateTexCoord(SoState * state, SbBool glrender, SbBool vbo)
             }
             if (dirty) {
               if (dim == 2) {
-                PRIVATE(this)->texcoordvbo[i]->setBufferData(tc2 + i * numperunit,
-                                                             numperunit*sizeof(SbVec2f),
-                                                             this->getNodeId());
+                PRIVATE(this)->texcoordvbo[i]->setTexCoordData(tc2[i * numperunit].getValue(),
+                                                               numperunit, 2,
+                                                               this->getNodeId());
               }
               else {
-                PRIVATE(this)->texcoordvbo[i]->setBufferData(tc3 + i * numperunit,
-                                                             numperunit*sizeof(SbVec3f),
-                                                             this->getNodeId());
+                PRIVATE(this)->texcoordvbo[i]->setTexCoordData(tc3[i * numperunit].getValue(),
+                                                               numperunit, 3,
+                                                               this->getNodeId());
               }
             }
           }
@@ -558,9 +557,8 @@ SoVertexProperty::updateNormal(SoState * state, uint32_t overrideflags, SbBool g
           dirty = TRUE;
         }
         if (dirty) {
-          PRIVATE(this)->normalvbo->setBufferData(this->normal.getValues(0),
-                                                  num*sizeof(SbVec3f),
-                                                  this->getNodeId());
+          PRIVATE(this)->normalvbo->setNormalData(this->normal.getValues(0),
+                                                  num, this->getNodeId());
         }
       }
       else if (PRIVATE(this)->normalvbo && PRIVATE(this)->normalvbo->getBufferDataId()) {
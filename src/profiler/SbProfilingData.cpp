@@ -50,6 +50,7 @@
 #include <algorithm> // std::reverse
 #include <cstring>
 #include <map>
+#include <unordered_map>
 #include <vector>
 
 #include <Inventor/SbName.h>
@@ -155,17 +156,102 @@ SbNameProfilingData::SbNameProfilingData(void)
 
 // *************************************************************************
 
+// Key for looking up a node entry from its parent entry, which
+// replaces matching the full path against the stored entries.
+struct SbProfilingEntryKey {
+  int parentidx;
+  int childidx;
+  SbProfilingNodeKey node;
+
+  int operator == (const SbProfilingEntryKey & rhs) const {
+    return (this->parentidx == rhs.parentidx) &&
+      (this->childidx == rhs.childidx) && (this->node == rhs.node);
+  }
+}; // SbProfilingEntryKey
+
+struct SbProfilingEntryKeyHash {
+  size_t operator () (const SbProfilingEntryKey & key) const {
+    size_t h = reinterpret_cast<uintptr_t>(key.node);
+    h ^= static_cast<size_t>(key.parentidx) * 0x9e3779b9u + (h << 6) + (h >> 2);
+    h ^= static_cast<size_t>(key.childidx) * 0x85ebca6bu + (h << 6) + (h >> 2);
+    return h;
+  }
+}; // SbProfilingEntryKeyHash
+
+// One recorded traversal of a node entry.
+struct SbProfilingEvent {
+  int entryidx;
+  SbTime starttime;
+  SbTime duration;
+}; // SbProfilingEvent
+
 class SbProfilingDataP {
 public:
 
   std::vector<SbNodeProfilingData> nodeData;
   int lastPathIndex;
 
+  std::unordered_map<SbProfilingEntryKey, int, SbProfilingEntryKeyHash> entryLookup;
+
+  // entry of the node currently being traversed, and its path length
+  int traversalIndex;
+  int traversalPathLength;
+
+  // ring buffer of traversal events, preallocated to its capacity
+  std::vector<SbProfilingEvent> events;
+  int eventHead;
+  int numEvents;
+
   std::map<SbProfilingNodeTypeKey, SbTypeProfilingData> nodeTypeData;
   std::map<SbProfilingNodeNameKey, SbNameProfilingData> nodeNameData;
 
+  int findEntry(int parentidx, int childidx, SbProfilingNodeKey node) const;
+  int addEntry(const SbNodeProfilingData & data);
+  void rebuildEntryLookup(void);
+
 }; // SbProfilingDataP
 
+int
+SbProfilingDataP::findEntry(int parentidx, int childidx, SbProfilingNodeKey node) const
+{
+  SbProfilingEntryKey key;
+  key.parentidx = parentidx;
+  key.childidx = childidx;
+  key.node = node;
+  std::unordered_map<SbProfilingEntryKey, int, SbProfilingEntryKeyHash>::const_iterator it =
+    this->entryLookup.find(key);
+  if (it == this->entryLookup.end()) return -1;
+  return it->second;
+}
+
+int
+SbProfilingDataP::addEntry(const SbNodeProfilingData & data)
+{
+  this->nodeData.push_back(data);
+  const int idx = (int)this->nodeData.size() - 1;
+  SbProfilingEntryKey key;
+  key.parentidx = data.parentidx;
+  key.childidx = data.childidx;
+  key.node = data.node;
+  // keep the first entry if there are duplicates
+  this->entryLookup.insert(std::make_pair(key, idx));
+  return idx;
+}
+
+void
+SbProfilingDataP::rebuildEntryLookup(void)
+{
+  this->entryLookup.clear();
+  const int numentries = (int)this->nodeData.size();
+  for (int idx = 0; idx < numentries; ++idx) {
+    SbProfilingEntryKey key;
+    key.parentidx = this->nodeData[idx].parentidx;
+    key.childidx = this->nodeData[idx].childidx;
+    key.node = this->nodeData[idx].node;
+    this->entryLookup.insert(std::make_pair(key, idx));
+  }
+}
+
 #define PRIVATE(obj) ((obj)->pimpl)
 
 /*!
@@ -204,6 +290,10 @@ SbProfilingData::constructorInit(void)
   this->actionStartTime = SbTime::zero();
   this->actionStopTime = SbTime::zero();
   PRIVATE(this)->lastPathIndex = -1;
+  PRIVATE(this)->traversalIndex = -1;
+  PRIVATE(this)->traversalPathLength = 0;
+  PRIVATE(this)->eventHead = 0;
+  PRIVATE(this)->numEvents = 0;
 }
 
 /*!
@@ -214,6 +304,7 @@ SbProfilingData::reset(void)
 {
   this->constructorInit();
   PRIVATE(this)->nodeData.clear();
+  PRIVATE(this)->entryLookup.clear();
   PRIVATE(this)->nodeTypeData.clear();
   PRIVATE(this)->nodeNameData.clear();
   assert(PRIVATE(this)->nodeData.size() == 0);
@@ -233,79 +324,16 @@ SbProfilingData::operator = (const SbProfilingData & rhs)
   this->actionStopTime = rhs.actionStopTime;
   PRIVATE(this)->lastPathIndex = -1;
   PRIVATE(this)->nodeData = PRIVATE(&rhs)->nodeData;
+  PRIVATE(this)->rebuildEntryLookup();
+  PRIVATE(this)->events = PRIVATE(&rhs)->events;
+  PRIVATE(this)->eventHead = PRIVATE(&rhs)->eventHead;
+  PRIVATE(this)->numEvents = PRIVATE(&rhs)->numEvents;
   PRIVATE(this)->nodeTypeData = PRIVATE(&rhs)->nodeTypeData;
   PRIVATE(this)->nodeNameData = PRIVATE(&rhs)->nodeNameData;
   assert(PRIVATE(this)->nodeData.size() == PRIVATE(&rhs)->nodeData.size());
   return *this;
 }
 
-// search dst for the given path in src, and if nonexistent create it
-static void
-findPath(const std::vector<SbNodeProfilingData> & src, std::vector<SbNodeProfilingData> & dst, int srcentryidx, int & matchidx, int & parentidx)
-{
-  matchidx = -1;
-  parentidx = -1;
-
-  // By going from 0 and outwards, the source-vector parent node
-  // will always already exist in the target-vector, which should
-  // help a lot.
-  const int numdestentries = (int)dst.size();
-
-  // FIXME: optimize this part
-
-  bool match = false;
-  for (int i = 0; i < numdestentries && !match; ++i) {
-    if (dst[i].node == src[srcentryidx].node &&
-        dst[i].childidx == src[srcentryidx].childidx) {
-      // we have a potential match
-      int dstidx = dst[i].parentidx, srcidx = src[srcentryidx].parentidx;
-      while ((srcidx != -1) &&
-             (dstidx != -1) &&
-             (src[srcidx].node == dst[dstidx].node) &&
-             (src[srcidx].childidx == dst[dstidx].childidx)) {
-        srcidx = src[srcidx].parentidx;
-        dstidx = dst[dstidx].parentidx;
-      }
-      if (srcidx == -1 && dstidx == -1) { // match!
-        match = true;
-        matchidx = i;
-      }
-    }
-  }
-
-  if (match) {
-    parentidx = dst[matchidx].parentidx;
-  } else {
-    matchidx = -1;
-
-    // search for parent instead
-    srcentryidx = src[srcentryidx].parentidx;
-    if (srcentryidx == -1) { // root doesn't have parent
-      parentidx = -1;
-      return;
-    }
-
-    for (int i = 0; i < numdestentries && !match; ++i) {
-      if (dst[i].node == src[srcentryidx].node &&
-          dst[i].childidx == src[srcentryidx].childidx) {
-        // we have a potential match
-        int dstidx = dst[i].parentidx, srcidx = src[srcentryidx].parentidx;
-        while ((srcidx != -1) &&
-               (dstidx != -1) &&
-               (src[srcidx].node == dst[dstidx].node) &&
-               (src[srcidx].childidx == dst[dstidx].childidx)) {
-          srcidx = src[srcidx].parentidx;
-          dstidx = dst[dstidx].parentidx;
-        }
-        if (srcidx == -1 && dstidx == -1) { // match!
-          match = true;
-          parentidx = i;
-        }
-      }
-    }
-  }
-}
-
 /*!
   Add profiling data from another data set.
 */
@@ -337,10 +365,17 @@ SbProfilingData::operator += (const SbProfilingData & rhs)
   std::vector<SbNodeProfilingData> & dst = PRIVATE(this)->nodeData;
 
   { // nodeData
+    // Parent entries always precede their children, so the parent of
+    // a source entry has already been mapped to its destination entry
+    // when the entry itself is reached.
     const int numsrcentries = (int)src.size();
+    std::vector<int> dstindices(numsrcentries, -1);
     for (int c = 0; c < numsrcentries; ++c) {
-      int matchidx = -1, parentidx = -1;
-      findPath(src, dst, c, matchidx, parentidx);
+      assert(src[c].parentidx < c);
+      const int parentidx =
+        (src[c].parentidx == -1) ? -1 : dstindices[src[c].parentidx];
+      int matchidx =
+        PRIVATE(this)->findEntry(parentidx, src[c].childidx, src[c].node);
       if (matchidx == -1) {
         SbNodeProfilingData data;
         data.node = src[c].node;
@@ -348,9 +383,9 @@ SbProfilingData::operator += (const SbProfilingData & rhs)
         data.parentidx = parentidx;
         data.nodetype = src[c].nodetype;
         data.nodename = src[c].nodename;
-        dst.push_back(data);
-        matchidx = (int)dst.size() - 1;
+        matchidx = PRIVATE(this)->addEntry(data);
       }
+      dstindices[c] = matchidx;
       // accumulate data (something about this really doesn't make sense)
       dst[matchidx].traversaltime += src[c].traversaltime;
       dst[matchidx].memorysize += src[c].memorysize;
@@ -540,6 +575,221 @@ SbProfilingData::getParentIndex(int idx) const
   return PRIVATE(this)->nodeData[idx].parentidx;
 }
 
+/*!
+  Return the index of the entry for \a node as child number \a childidx
+  under the entry at \a parentidx, or a root entry if \a parentidx is
+  -1. If the entry is not registered and \a create is TRUE, it is added.
+  Otherwise -1 is returned for unregistered entries.
+
+  This is a constant-time alternative to getIndex() with a path, for
+  use when the index of the parent entry is known from the traversal.
+*/
+
+int
+SbProfilingData::getIndex(int parentidx, int childidx, SoNode * node, SbBool create)
+{
+  assert(parentidx >= -1 &&
+         parentidx < static_cast<int>(PRIVATE(this)->nodeData.size()));
+  SbProfilingNodeKey key = static_cast<SbProfilingNodeKey>(node);
+  int idx = PRIVATE(this)->findEntry(parentidx, childidx, key);
+  if (idx != -1 || !create) return idx;
+
+  SbNodeProfilingData data;
+  data.node = key;
+  data.nodetype = static_cast<SbProfilingNodeTypeKey>(node->getTypeId().getKey());
+  data.nodename = static_cast<SbProfilingNodeNameKey>(node->getName().getString());
+  data.parentidx = parentidx;
+  data.childidx = childidx;
+  return PRIVATE(this)->addEntry(data);
+}
+
+/*!
+  Return the child index stored for the node entry at index \a idx.
+*/
+
+int
+SbProfilingData::getChildIndex(int idx) const
+{
+  assert(idx >= 0 && idx < static_cast<int>(PRIVATE(this)->nodeData.size()));
+  return PRIVATE(this)->nodeData[idx].childidx;
+}
+
+/*!
+  Set the entry of the node currently being traversed, together with
+  the length of its path. Used by the traversal hooks to find the
+  parent entry of the next node without a path lookup.
+*/
+
+void
+SbProfilingData::setTraversalEntry(int idx, int pathlen)
+{
+  PRIVATE(this)->traversalIndex = idx;
+  PRIVATE(this)->traversalPathLength = pathlen;
+}
+
+/*!
+  Return the entry set with setTraversalEntry(), or -1.
+*/
+
+int
+SbProfilingData::getTraversalEntry(void) const
+{
+  return PRIVATE(this)->traversalIndex;
+}
+
+/*!
+  Return the path length set with setTraversalEntry().
+*/
+
+int
+SbProfilingData::getTraversalEntryPathLength(void) const
+{
+  return PRIVATE(this)->traversalPathLength;
+}
+
+// *************************************************************************
+
+/*!
+  Set the number of traversal events to keep. The event buffer is
+  allocated up front and wraps around, overwriting the oldest events,
+  so recording does not allocate. A capacity of 0 disables recording.
+*/
+
+void
+SbProfilingData::setEventTraceCapacity(int numevents)
+{
+  assert(numevents >= 0);
+  PRIVATE(this)->events.resize(numevents);
+  PRIVATE(this)->events.shrink_to_fit();
+  PRIVATE(this)->eventHead = 0;
+  PRIVATE(this)->numEvents = 0;
+}
+
+/*!
+  Return the size of the traversal event buffer.
+*/
+
+int
+SbProfilingData::getEventTraceCapacity(void) const
+{
+  return (int)PRIVATE(this)->events.size();
+}
+
+/*!
+  Record one traversal of the node entry at index \a idx.
+*/
+
+void
+SbProfilingData::addTraversalEvent(int idx, SbTime starttime, SbTime duration)
+{
+  const int capacity = (int)PRIVATE(this)->events.size();
+  if (capacity == 0) return;
+  SbProfilingEvent & event = PRIVATE(this)->events[PRIVATE(this)->eventHead];
+  event.entryidx = idx;
+  event.starttime = starttime;
+  event.duration = duration;
+  if (++PRIVATE(this)->eventHead == capacity) PRIVATE(this)->eventHead = 0;
+  if (PRIVATE(this)->numEvents < capacity) ++PRIVATE(this)->numEvents;
+}
+
+/*!
+  Return the number of traversal events currently in the buffer.
+*/
+
+int
+SbProfilingData::getNumTraversalEvents(void) const
+{
+  return PRIVATE(this)->numEvents;
+}
+
+/*!
+  Return traversal event number \a eventidx, counted from the oldest
+  event in the buffer.
+*/
+
+void
+SbProfilingData::getTraversalEvent(int eventidx, int & idx, SbTime & starttime, SbTime & duration) const
+{
+  assert(eventidx >= 0 && eventidx < PRIVATE(this)->numEvents);
+  const int capacity = (int)PRIVATE(this)->events.size();
+  int pos = PRIVATE(this)->eventHead - PRIVATE(this)->numEvents + eventidx;
+  if (pos < 0) pos += capacity;
+  const SbProfilingEvent & event = PRIVATE(this)->events[pos];
+  idx = event.entryidx;
+  starttime = event.starttime;
+  duration = event.duration;
+}
+
+static void
+append_json_string(SbString & out, const char * str)
+{
+  out += '"';
+  for (const char * ptr = str; *ptr != '\0'; ++ptr) {
+    const unsigned char c = static_cast<unsigned char>(*ptr);
+    if (c == '"' || c == '\\') { out += '\\'; out += *ptr; }
+    else if (c < 0x20) {
+      SbString esc;
+      esc.sprintf("\\u%04x", c);
+      out += esc;
+    }
+    else { out += *ptr; }
+  }
+  out += '"';
+}
+
+/*!
+  Return the traversal events in the buffer as a JSON document in the
+  Chrome trace event format, which can be loaded into chrome://tracing
+  or Perfetto. Each event is a complete ("X") event named after the
+  node type, with the child index path of the node entry as argument.
+  Timestamps are in microseconds relative to the action start time.
+*/
+
+SbString
+SbProfilingData::getChromeTrace(void) const
+{
+  const SbTime origin = this->actionStartTime;
+  SbString trace("{\"traceEvents\":[");
+  SbList<int> indices;
+  SbString buf;
+  for (int c = 0; c < PRIVATE(this)->numEvents; ++c) {
+    int idx;
+    SbTime starttime, duration;
+    this->getTraversalEvent(c, idx, starttime, duration);
+    const SbNodeProfilingData & data = PRIVATE(this)->nodeData[idx];
+
+    if (c > 0) trace += ',';
+    trace += "{\"name\":";
+    append_json_string(trace, SoType::fromKey(data.nodetype).getName().getString());
+    buf.sprintf(",\"cat\":\"node\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+                "\"pid\":1,\"tid\":1,\"args\":{",
+                (starttime - origin).getValue() * 1000000.0,
+                duration.getValue() * 1000000.0);
+    trace += buf;
+    if (data.nodename != NULL && data.nodename[0] != '\0') {
+      trace += "\"node\":";
+      append_json_string(trace, data.nodename);
+      trace += ',';
+    }
+
+    indices.truncate(0);
+    for (int nodeidx = idx; nodeidx != -1;
+         nodeidx = PRIVATE(this)->nodeData[nodeidx].parentidx) {
+      indices.append(PRIVATE(this)->nodeData[nodeidx].childidx);
+    }
+    trace += "\"path\":\"";
+    for (int i = indices.getLength() - 1; i >= 0; --i) {
+      trace.addIntString(indices[i]);
+      if (i > 0) trace += '/';
+    }
+    trace += "\",\"entry\":";
+    trace.addIntString(idx);
+    trace += "}}";
+  }
+  trace += "],\"displayTimeUnit\":\"ms\"}";
+  return trace;
+}
+
 /*
  * Return the index of the tail node in the path ("tail" node at pathlen
  * position). If node is not registered, add it and return that index.
@@ -573,20 +823,15 @@ SbProfilingData::getIndexCreate(const SoFullPath * fullpath, int COIN_UNUSED_ARG
   }
 
   if (samelength == 0) {
-    // FIXME: need to check for the possibility of multiple roots
-    // this is rooted in a new root - add it
-
-    SbNodeProfilingData data;
+    // not on the path of the last entry - look up or add the root entry
     SoNode * rootnode = fullpath->getNode(0);
     assert(rootnode != NULL);
-    data.node = static_cast<SbProfilingNodeKey>(rootnode);
-    data.nodetype = static_cast<SbProfilingNodeTypeKey>(rootnode->getTypeId().getKey());
-    data.nodename = static_cast<SbProfilingNodeNameKey>(rootnode->getName().getString());
-    PRIVATE(this)->nodeData.push_back(data);
+    const int rootidx =
+      this->getIndex(-1, fullpath->getIndex(0), rootnode, TRUE);
 
     ++samelength;
     lastentrypathindexes.clear();
-    lastentrypathindexes.push_back((int)PRIVATE(this)->nodeData.size() - 1);
+    lastentrypathindexes.push_back(rootidx);
   }
 
   int pos = samelength;
@@ -637,14 +882,20 @@ SbProfilingData::getIndexNoCreate(const SoPath * path, int COIN_UNUSED_ARG(pathl
   }
 
   if (samelength == 0) {
-    // FIXME: get
-    return -1;
+    // not on the path of the last entry - look up the root entry
+    const int rootidx =
+      PRIVATE(this)->findEntry(-1, fullpath->getIndex(0),
+                               static_cast<SbProfilingNodeKey>(fullpath->getNode(0)));
+    if (rootidx == -1) return -1;
+    ++samelength;
+    lastentrypathindexes.clear();
+    lastentrypathindexes.push_back(rootidx);
   }
 
   int pos = samelength;
   idx = lastentrypathindexes[pos-1];
   ++pos;
-  while (pos < fullpath->getLength() && idx != -1) {
+  while (pos <= fullpath->getLength() && idx != -1) {
     idx = this->getIndexForwardNoCreate(fullpath, pos, idx);
     ++pos;
   }
@@ -674,30 +925,12 @@ SbProfilingData::getIndexForwardCreate(const SoFullPath * fullpath, int pathlen,
     static_cast<SbProfilingNodeKey>(fullpath->getNode(pathlen - 2));
   int pidx = fullpath->getIndex(pathlen - 2);
   SoNode * tailnode = fullpath->getNode(pathlen - 1);
-  SbProfilingNodeKey tail = static_cast<SbProfilingNodeKey>(tailnode);
   int tidx = fullpath->getIndex(pathlen - 1);
 
   assert(parent == PRIVATE(this)->nodeData[parentidx].node);
   assert(pidx == PRIVATE(this)->nodeData[parentidx].childidx);
 
-  const int nodedatacount = (int)PRIVATE(this)->nodeData.size();
-  for (int idx = parentidx + 1; idx < nodedatacount; ++idx) {
-    if ((PRIVATE(this)->nodeData[idx].node == tail) &&
-        (PRIVATE(this)->nodeData[idx].childidx == tidx)) { // found it!
-      return idx;
-    }
-  }
-
-  // entry not found - add entry and return new index
-  SbNodeProfilingData data;
-  data.node = tail;
-  data.nodetype = static_cast<SbProfilingNodeTypeKey>(tailnode->getTypeId().getKey());
-  data.nodename = static_cast<SbProfilingNodeNameKey>(tailnode->getName().getString());
-  data.parentidx = parentidx;
-  data.childidx = tidx;
-  PRIVATE(this)->nodeData.push_back(data);
-
-  return (int)PRIVATE(this)->nodeData.size() - 1;
+  return this->getIndex(parentidx, tidx, tailnode, TRUE);
 }
 
 /*
@@ -720,14 +953,7 @@ SbProfilingData::getIndexForwardNoCreate(const SoFullPath * fullpath, int pathle
   assert(parent == PRIVATE(this)->nodeData[parentidx].node);
   assert(pidx == PRIVATE(this)->nodeData[parentidx].childidx);
 
-  const int nodedatacount = (int)PRIVATE(this)->nodeData.size();
-  for (int idx = parentidx + 1; idx < nodedatacount; ++idx) {
-    if ((PRIVATE(this)->nodeData[idx].node == tail) &&
-        (PRIVATE(this)->nodeData[idx].childidx == tidx)) { // found it!
-      return idx;
-    }
-  }
-  return -1;
+  return PRIVATE(this)->findEntry(parentidx, tidx, tail);
 }
 
 // *************************************************************************
@@ -1158,7 +1384,12 @@ SbProfilingData::getProfilingDataSize(void) const
     PRIVATE(this)->nodeTypeData.size() * sizeof(SbTypeProfilingData);
   size_t namestatsize =
     PRIVATE(this)->nodeNameData.size() * sizeof(SbNameProfilingData);
-  return nodestatsize + typestatsize + namestatsize + sizeof(SbProfilingDataP);
+  size_t lookupsize =
+    PRIVATE(this)->entryLookup.size() * (sizeof(SbProfilingEntryKey) + sizeof(int));
+  size_t eventsize =
+    PRIVATE(this)->events.capacity() * sizeof(SbProfilingEvent);
+  return nodestatsize + typestatsize + namestatsize + lookupsize + eventsize +
+    sizeof(SbProfilingDataP);
 }
 
 /*!
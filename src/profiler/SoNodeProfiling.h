@@ -57,12 +57,18 @@
   If you combine doing both, then you get a lot of double-booking of
   timings and negative timing offsets, which causes mayhem in the
   statistics, and was a mess to figure out.
+
+  The entry index of the node being traversed is kept in the profiling
+  data, so a child finds its entry from the parent entry and its child
+  index instead of matching the full path. The path lookup is only
+  used when the traversal did not pass through the parent's hooks.
 */
 
 class SoNodeProfiling {
 public:
   SoNodeProfiling(void)
-    : pretime(SbTime::zero()), entryindex(-1)
+    : pretime(SbTime::zero()), entryindex(-1),
+      prevtraversalindex(-1), prevtraversalpathlen(0)
   {
   }
 
@@ -75,8 +81,25 @@ public:
     SbProfilingData & data = profilerelt->getProfilingData();
     const SoFullPath * fullpath =
       static_cast<const SoFullPath *>(action->getCurPath());
-    this->entryindex = data.getIndex(fullpath, TRUE);
+    const int pathlen = fullpath->getLength();
+    this->prevtraversalindex = data.getTraversalEntry();
+    this->prevtraversalpathlen = data.getTraversalEntryPathLength();
+    if (this->prevtraversalindex != -1 &&
+        this->prevtraversalpathlen == pathlen - 1) {
+      this->entryindex = data.getIndex(this->prevtraversalindex,
+                                       fullpath->getIndex(pathlen - 1),
+                                       fullpath->getTail(), TRUE);
+    } else {
+      this->entryindex = data.getIndex(fullpath, TRUE);
+    }
     assert(this->entryindex != -1);
+    data.setTraversalEntry(this->entryindex, pathlen);
+
+    const int tracecapacity = SoProfilerP::getEventTraceCapacity();
+    if (tracecapacity != data.getEventTraceCapacity()) {
+      data.setEventTraceCapacity(tracecapacity);
+    }
+
     size_t managedmem = 0, unmanagedmem = 0;
     fullpath->getTail()->getFieldsMemorySize(managedmem, unmanagedmem);
     data.setNodeFootprint(this->entryindex,
@@ -113,6 +136,9 @@ public:
     const SbTime adjusted(childrenoffset + duration);
     assert(adjusted.getValue() >= 0.0);
     data.setNodeTiming(this->entryindex, adjusted);
+
+    data.addTraversalEvent(this->entryindex, this->pretime, duration);
+    data.setTraversalEntry(this->prevtraversalindex, this->prevtraversalpathlen);
 #if 0 // DEBUG
     const SoFullPath * fullpath = (const SoFullPath *)action->getCurPath();
     SoDebugError::postInfo("Profiling",
@@ -134,6 +160,8 @@ public:
 private:
   SbTime pretime;
   int entryindex;
+  int prevtraversalindex;
+  int prevtraversalpathlen;
 
 };
 
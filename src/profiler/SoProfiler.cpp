@@ -121,6 +121,10 @@ namespace {
       static SbBool active = FALSE;
     };
 
+    namespace trace {
+      static int events = 0;
+    };
+
     namespace console {
       static SbBool active = FALSE;
       static SbBool clear = FALSE;
@@ -169,6 +173,8 @@ SoProfiler::init(void)
 
 #ifdef HAVE_NODEKITS
   SoNodeKit::init();
+  // the profiler kits derive from the nodekit classes
+  SoDBP::loadSubsystem("nodekits");
   SoProfilerOverlayKit::initClass();
   SoProfilerVisualizeKit::initClass();
   SoProfilerTopKit::initClass();
@@ -247,6 +253,12 @@ SoProfilerP::shouldSyncGL(void)
   return profiler::rendering::syncgl;
 }
 
+int
+SoProfilerP::getEventTraceCapacity(void)
+{
+  return profiler::trace::events;
+}
+
 SbBool
 SoProfilerP::shouldClearConsole(void)
 {
@@ -299,6 +311,7 @@ SoProfilerP::parseCoinProfilerVariable(void)
   // variable COIN_PROFILER
   // - on
   // - syncgl - implies on
+  // - trace=<numevents> - record a traversal event trace, implies on
   // - [nocaching - implies on] // todo
 
   const char * env = CoinInternal::getEnvironmentVariableRaw(SoDBP::EnvVars::COIN_PROFILER);
@@ -323,6 +336,10 @@ SoProfilerP::parseCoinProfilerVariable(void)
         profiler::enabled = TRUE;
         profiler::rendering::syncgl = TRUE;
       }
+      else if ((*it).compare(0, 6, "trace=") == 0) {
+        profiler::enabled = TRUE;
+        profiler::trace::events = SbMax(atoi((*it).data() + 6), 0);
+      }
       else {
         SoDebugError::postWarning("SoProfilerP::parseCoinProfilerVariable",
                                   "invalid token '%s'", (*it).data());
@@ -43,6 +43,7 @@ public:
   static float getContinuousRenderDelay(void);
 
   static SbBool shouldSyncGL(void);
+  static int getEventTraceCapacity(void);
 
   static SbBool shouldClearConsole(void);
   static SbBool shouldOutputHeaderOnConsole(void);
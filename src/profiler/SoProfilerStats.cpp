@@ -47,6 +47,7 @@
 #include <Inventor/actions/SoWriteAction.h>
 #include <Inventor/errors/SoDebugError.h>
 #include <Inventor/lists/SbList.h>
+#include <Inventor/misc/SoGLResourceManager.h>
 #include <Inventor/misc/SoState.h>
 #include <Inventor/nodes/SoSeparator.h>
 #include <Inventor/elements/SoCacheElement.h>
@@ -96,6 +97,27 @@
   \sa SoProfilerStats::renderedNodeType
 */
 
+/*!
+  \var SoMFName SoProfilerStats::glResourceType
+
+  Names of the OpenGL resource types tracked by SoGLResourceManager
+  for the context of the last SoGLRenderAction traversal.
+
+  \sa SoProfilerStats::glResourceCount, SoProfilerStats::glResourceKilobytes
+*/
+
+/*!
+  \var SoMFUInt32 SoProfilerStats::glResourceCount
+
+  Number of live OpenGL objects per type in \a glResourceType.
+*/
+
+/*!
+  \var SoMFUInt32 SoProfilerStats::glResourceKilobytes
+
+  Estimated OpenGL memory in kilobytes per type in \a glResourceType.
+*/
+
 // *************************************************************************
 
 #define PUBLIC(obj) ((obj)->master)
@@ -118,6 +140,7 @@ public:
   void updateActionTimingFields(SoProfilerElement * e);
   void updateNodeTypeTimingMap(SoProfilerElement * e);
   void updateNodeTypeTimingFields();
+  void updateGLResourceFields(const uint32_t contextid);
 
   std::map<int16_t, SbProfilingData *> action_map;
   std::map<int16_t, TypeTimings> type_timings;
@@ -148,6 +171,10 @@ SoProfilerStatsP::doAction(SoAction * action)
     SoCacheElement::invalidate(state);
   }
 
+  if (action->isOfType(SoGLRenderAction::getClassTypeId())) {
+    this->updateGLResourceFields(static_cast<SoGLRenderAction *>(action)->getCacheContext());
+  }
+
   SoProfilerElement * e = SoProfilerElement::get(state);
   if (!e) { return; }
 
@@ -174,6 +201,31 @@ SoProfilerStatsP::doAction(SoAction * action)
   }
 } // doAction
 
+void
+SoProfilerStatsP::updateGLResourceFields(const uint32_t contextid)
+{
+  static const char * const names[SoGLResourceManager::NUM_RESOURCE_TYPES] = {
+    "BUFFER_OBJECT", "TEXTURE_OBJECT", "DISPLAY_LIST"
+  };
+  const int num = SoGLResourceManager::NUM_RESOURCE_TYPES;
+  PUBLIC(this)->glResourceType.setNum(num);
+  PUBLIC(this)->glResourceCount.setNum(num);
+  PUBLIC(this)->glResourceKilobytes.setNum(num);
+  SbName * typeptr = PUBLIC(this)->glResourceType.startEditing();
+  uint32_t * countptr = PUBLIC(this)->glResourceCount.startEditing();
+  uint32_t * kbptr = PUBLIC(this)->glResourceKilobytes.startEditing();
+  for (int i = 0; i < num; i++) {
+    const SoGLResourceManager::ResourceType type =
+      static_cast<SoGLResourceManager::ResourceType>(i);
+    typeptr[i] = names[i];
+    countptr[i] = SoGLResourceManager::getNumResources(contextid, type);
+    kbptr[i] = static_cast<uint32_t>(SoGLResourceManager::getNumBytes(contextid, type) / 1024);
+  }
+  PUBLIC(this)->glResourceType.finishEditing();
+  PUBLIC(this)->glResourceCount.finishEditing();
+  PUBLIC(this)->glResourceKilobytes.finishEditing();
+}
+
 void
 SoProfilerStatsP::clearProfilingData(void)
 {
@@ -376,6 +428,9 @@ SoProfilerStats::SoProfilerStats(void)
   SO_NODE_ADD_FIELD(renderedNodeTypeCount, (0));
   SO_NODE_ADD_FIELD(profiledAction, (""));
   SO_NODE_ADD_FIELD(profiledActionTime, (0.0f));
+  SO_NODE_ADD_FIELD(glResourceType, (""));
+  SO_NODE_ADD_FIELD(glResourceCount, (0));
+  SO_NODE_ADD_FIELD(glResourceKilobytes, (0));
   SO_NODE_ADD_FIELD(profilingUpdate, ());
 
   this->renderedNodeType.setNum(0);
@@ -390,6 +445,12 @@ SoProfilerStats::SoProfilerStats(void)
   this->profiledAction.setDefault(TRUE);
   this->profiledActionTime.setNum(0);
   this->profiledActionTime.setDefault(TRUE);
+  this->glResourceType.setNum(0);
+  this->glResourceType.setDefault(TRUE);
+  this->glResourceCount.setNum(0);
+  this->glResourceCount.setDefault(TRUE);
+  this->glResourceKilobytes.setNum(0);
+  this->glResourceKilobytes.setDefault(TRUE);
 
 }
 
@@ -78,6 +78,8 @@
 
 #include "glue/glp.h"
 #include "misc/SoEnvironment.h"
+#include "rendering/SoRenderStatisticsP.h"
+#include "rendering/SoUnitShapeCache.h"
 
 // *************************************************************************
 
@@ -138,6 +140,21 @@ sogl_generate_2d_circle(SbVec2f *coords, const int num, const float radius)
   }
 }
 
+// auto caching hint for cones, cylinders and spheres
+static void
+sogl_shape_autocache(SoState * state)
+{
+  if (state && (SoComplexityTypeElement::get(state) ==
+                SoComplexityTypeElement::OBJECT_SPACE)) {
+    // encourage auto caching for object space
+    SoGLCacheContextElement::shouldAutoCache(state, SoGLCacheContextElement::DO_AUTO_CACHE);
+    SoGLCacheContextElement::incNumShapes(state);
+  }
+  else {
+    SoGLCacheContextElement::shouldAutoCache(state, SoGLCacheContextElement::DONT_AUTO_CACHE);
+  }
+}
+
 void
 sogl_render_cone(const float radius,
                  const float height,
@@ -169,6 +186,13 @@ sogl_render_cone(const float radius,
   if (slices > 128) slices = 128;
   if (slices < 4) slices = 4;
 
+  if (SoUnitShapeCache::render(state, SoUnitShapeCache::CONE, slices, 0,
+                               SbVec3f(radius, height, radius),
+                               material, flags)) {
+    sogl_shape_autocache(state);
+    return;
+  }
+
   float h2 = height * 0.5f;
 
   // put coordinates on the stack
@@ -268,6 +292,7 @@ sogl_render_cone(const float radius,
 
     matnr++;
     glEnd();
+    SoRenderStatisticsP::countDraw(GL_TRIANGLES, slices * 3);
   }
 
   if (flags & SOGL_RENDER_BOTTOM) {
@@ -296,16 +321,9 @@ sogl_render_cone(const float radius,
       glVertex3fv((const GLfloat*)&coords[i]);
     }
     glEnd();
+    SoRenderStatisticsP::countDraw(GL_TRIANGLE_FAN, slices);
   }
-  if (state && (SoComplexityTypeElement::get(state) ==
-                SoComplexityTypeElement::OBJECT_SPACE)) {
-    // encourage auto caching for object space
-    SoGLCacheContextElement::shouldAutoCache(state, SoGLCacheContextElement::DO_AUTO_CACHE);
-    SoGLCacheContextElement::incNumShapes(state);
-  }
-  else {
-    SoGLCacheContextElement::shouldAutoCache(state, SoGLCacheContextElement::DONT_AUTO_CACHE);
-  }
+  sogl_shape_autocache(state);
 }
 
 void
@@ -337,6 +355,13 @@ sogl_render_cylinder(const float radius,
   if (slices > 128) slices = 128;
   if (slices < 4) slices = 4;
 
+  if (SoUnitShapeCache::render(state, SoUnitShapeCache::CYLINDER, slices, 0,
+                               SbVec3f(radius, height, radius),
+                               material, flags)) {
+    sogl_shape_autocache(state);
+    return;
+  }
+
   float h2 = height * 0.5f;
 
   SbVec3f coords[129];
@@ -409,6 +434,7 @@ sogl_render_cylinder(const float radius,
 
     matnr++;
     glEnd();
+    SoRenderStatisticsP::countDraw(GL_QUAD_STRIP, (slices + 1) * 2);
   }
 
   if ((flags & (SOGL_NEED_TEXCOORDS|SOGL_NEED_3DTEXCOORDS|SOGL_NEED_MULTITEXCOORDS)) &&
@@ -443,6 +469,7 @@ sogl_render_cylinder(const float radius,
       glVertex3f(c[0], h2, c[2]);
     }
     glEnd();
+    SoRenderStatisticsP::countDraw(GL_TRIANGLE_FAN, slices);
     matnr++;
   }
   if (flags & SOGL_RENDER_BOTTOM) {
@@ -470,23 +497,16 @@ sogl_render_cylinder(const float radius,
       glVertex3fv((const GLfloat*)&coords[i]);
     }
     glEnd();
+    SoRenderStatisticsP::countDraw(GL_TRIANGLE_FAN, slices);
   }
-  if (state && (SoComplexityTypeElement::get(state) ==
-                SoComplexityTypeElement::OBJECT_SPACE)) {
-    // encourage auto caching for object space
-    SoGLCacheContextElement::shouldAutoCache(state, SoGLCacheContextElement::DO_AUTO_CACHE);
-    SoGLCacheContextElement::incNumShapes(state);
-  }
-  else {
-    SoGLCacheContextElement::shouldAutoCache(state, SoGLCacheContextElement::DONT_AUTO_CACHE);
-  }
+  sogl_shape_autocache(state);
 }
 
 void
 sogl_render_sphere(const float radius,
                    const int numstacks,
                    const int numslices,
-                   SoMaterialBundle * const /* material */,
+                   SoMaterialBundle * const material,
                    const unsigned int flagsin,
                    SoState * state)
 {
@@ -514,6 +534,13 @@ sogl_render_sphere(const float radius,
 
   if (slices > 128) slices = 128;
 
+  if (SoUnitShapeCache::render(state, SoUnitShapeCache::SPHERE, slices, stacks,
+                               SbVec3f(radius, radius, radius),
+                               material, flags)) {
+    sogl_shape_autocache(state);
+    return;
+  }
+
   // used to cache last stack's data
   SbVec3f coords[129];
   SbVec3f normals[129];
@@ -615,6 +642,7 @@ sogl_render_sphere(const float radius,
     glVertex3fv((const GLfloat*)&coords[j]);
   }
   glEnd(); // GL_TRIANGLES
+  SoRenderStatisticsP::countDraw(GL_TRIANGLES, slices * 3);
 
   rho += drho;
 
@@ -667,6 +695,7 @@ sogl_render_sphere(const float radius,
       theta += dtheta;
     }
     glEnd(); // GL_QUAD_STRIP
+    SoRenderStatisticsP::countDraw(GL_QUAD_STRIP, (slices + 1) * 2);
     rho += drho;
     T -= dT;
   }
@@ -725,16 +754,9 @@ sogl_render_sphere(const float radius,
     glVertex3fv((const GLfloat*)&coords[j+1]);
   }
   glEnd(); // GL_TRIANGLES
+  SoRenderStatisticsP::countDraw(GL_TRIANGLES, slices * 3);
 
-  if (state && (SoComplexityTypeElement::get(state) ==
-                SoComplexityTypeElement::OBJECT_SPACE)) {
-    // encourage auto caching for object space
-    SoGLCacheContextElement::shouldAutoCache(state, SoGLCacheContextElement::DO_AUTO_CACHE);
-    SoGLCacheContextElement::incNumShapes(state);
-  }
-  else {
-    SoGLCacheContextElement::shouldAutoCache(state, SoGLCacheContextElement::DONT_AUTO_CACHE);
-  }
+  sogl_shape_autocache(state);
 }
 
 //
@@ -818,6 +840,14 @@ sogl_render_cube(const float width,
     else maxunit = -1;
   }
 
+  if (SoUnitShapeCache::render(state, SoUnitShapeCache::CUBE, 0, 0,
+                               SbVec3f(width, height, depth),
+                               material, flags)) {
+    // always encourage auto caching for cubes
+    SoGLCacheContextElement::shouldAutoCache(state, SoGLCacheContextElement::DO_AUTO_CACHE);
+    SoGLCacheContextElement::incNumShapes(state);
+    return;
+  }
 
   SbVec3f varray[8];
   sogl_generate_cube_vertices(varray,
@@ -852,6 +882,7 @@ sogl_render_cube(const float width,
     }
   }
   glEnd();
+  SoRenderStatisticsP::countDraw(GL_QUADS, 6 * 4);
 
   if (state) {
     // always encourage auto caching for cubes
@@ -1381,8 +1412,15 @@ namespace { namespace SoGL { namespace FaceSet {
         if (mode != GL_POLYGON) glEnd();
         mode = newmode;
         glBegin((GLenum) mode);
+        SoRenderStatisticsP::count(SoRenderStatistics::DRAW_CALLS);
+      }
+      else if (mode == GL_POLYGON) {
+        glBegin(GL_POLYGON);
+        SoRenderStatisticsP::count(SoRenderStatistics::DRAW_CALLS);
       }
-      else if (mode == GL_POLYGON) glBegin(GL_POLYGON);
+      // polygons count one more triangle per vertex below
+      SoRenderStatisticsP::count(SoRenderStatistics::TRIANGLES,
+                                 mode == GL_TRIANGLES ? 1 : (mode == GL_QUADS ? 2 : 3));
 
       /* vertex 1 *********************************************************/
       if ((AttributeBinding)MaterialBinding == PER_VERTEX ||
@@ -1613,6 +1651,7 @@ namespace { namespace SoGL { namespace FaceSet {
               attribs->send(*vertexindices++);
             }
             SEND_VERTEX(v1);
+            SoRenderStatisticsP::count(SoRenderStatistics::TRIANGLES);
 
             v1 = viptr < viendptr ? *viptr++ : -1;
           }
@@ -1864,6 +1903,8 @@ namespace { namespace SoGL { namespace TriStripSet {
       }
 
       glBegin(GL_TRIANGLE_STRIP);
+      SoRenderStatisticsP::count(SoRenderStatistics::DRAW_CALLS);
+      SoRenderStatisticsP::count(SoRenderStatistics::TRIANGLES);
 
       /* vertex 1 *********************************************************/
       if ((AttributeBinding)MaterialBinding == PER_VERTEX ||
@@ -1989,6 +2030,7 @@ namespace { namespace SoGL { namespace TriStripSet {
         }
 
         SEND_VERTEX_TRISTRIP(v1);
+        SoRenderStatisticsP::count(SoRenderStatistics::TRIANGLES);
         v1 = viptr < viendptr ? *viptr++ : -1;
       }
       glEnd(); // end of tristrip
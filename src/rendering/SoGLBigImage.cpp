@@ -56,6 +56,17 @@
   is doubled, and creating the texture object is much slower, so we
   avoid this for SoGLBigImage.
 
+  Images that are too large to keep in memory can be rendered from a
+  tile pyramid file, written with writeTilePyramid() and opened with
+  setTilePyramid(). SoTexture2 does this when its filename is such a
+  file. Only the tiles needed for the current view are read, by a
+  separate thread, and the subtextures are refined as the tiles
+  arrive. Until then the finest level already in memory is used, and
+  exceededChangeLimit() returns TRUE so that a new frame is
+  rendered. Tiles are kept in a cache of bounded size, see
+  setTileCacheSize(), and the subtextures of a tile pyramid are kept
+  within the size set with setTextureCacheSize().
+
   \COIN_CLASS_EXTENSION
 
   \since Coin 2.0
@@ -66,6 +77,7 @@
 #include <Inventor/misc/SoGLBigImage.h>
 #include "coindefs.h"
 
+#include <algorithm>
 #include <cstdlib>
 #include <cstdio>
 #include <cstring>
@@ -80,6 +92,7 @@
 #include <Inventor/elements/SoGLCacheContextElement.h>
 #include <Inventor/elements/SoGLDisplayList.h>
 #include <Inventor/errors/SoDebugError.h>
+#include <Inventor/lists/SbList.h>
 #include <Inventor/system/gl.h>
 
 #ifdef COIN_THREADSAFE
@@ -88,6 +101,7 @@
 
 #include "C/CoinTidbits.h"
 #include "rendering/SoGL.h"
+#include "rendering/SoTilePyramid.h"
 
 // *************************************************************************
 
@@ -96,6 +110,9 @@
 // on an image, as only few textures are changed each frame.
 static int CHANGELIMIT = 4;
 
+// the maximum size of the subtextures for a tile pyramid, per thread
+static size_t TEXTURECACHESIZE = size_t(128) * 1024 * 1024;
+
 // the texturequality limit when linear filtering will be used
 #define LINEAR_LIMIT 0.1f
 
@@ -114,6 +131,7 @@ typedef struct {
   int * glimagediv;
   uint32_t * glimageage;
   int changecnt;
+  SbBool missingtiles;
   unsigned int * averagebuf;
 } SoGLBigImageTls;
 
@@ -131,6 +149,8 @@ public:
   unsigned char ** cache;
   SbVec2s * cachesize;
   int numcachelevels;
+  SoTilePyramid * pyramid;
+  SbImage overview; // last pyramid level, the image of the superclass
 
   // inline for speed
   inline SoGLBigImageTls * getTls(void) {
@@ -163,10 +183,17 @@ public:
                           const int nc,
                           unsigned char * dst,
                           const SbVec2s & targetsize);
+  SbBool readTileSubImage(SoGLBigImageTls * tls,
+                          const int idx,
+                          const int wantedlevel,
+                          const SbVec2s & projsize,
+                          int & div,
+                          SbVec2s & actualsize);
   void resetAllTls(SoState * state);
   void resetCache(void);
   static void reset(SoGLBigImageTls * tls, SoState * state = NULL);
-  static void unrefOldDL(SoGLBigImageTls * tls, SoState * state, const uint32_t maxage);
+  static void unrefOldDL(SoGLBigImageTls * tls, SoState * state, const uint32_t maxage,
+                         const SbBool tiled);
   void createCache(const unsigned char * bytes, const SbVec2s & size, const int nc);
 };
 
@@ -176,6 +203,7 @@ static void soglbigimagep_cleanup(void)
 {
   SoGLBigImageP::classTypeId STATIC_SOTYPE_INIT;
   CHANGELIMIT = 4;
+  TEXTURECACHESIZE = size_t(128) * 1024 * 1024;
 }
 
 static void
@@ -188,6 +216,8 @@ soglbigimagetls_construct(void * closure)
   storage->currentdim.setValue(0, 0);
   storage->tmpbuf = NULL;
   storage->tmpbufsize = 0;
+  storage->changecnt = 0;
+  storage->missingtiles = FALSE;
   storage->glimagearray = NULL;
   storage->imagearray = NULL;
   storage->glimagediv = NULL;
@@ -313,6 +343,7 @@ SoGLBigImage::initSubImages(const SbVec2s & subimagesize) const
   SoGLBigImageTls * tls = PRIVATE(this)->getTls();
 
   tls->changecnt = 0;
+  tls->missingtiles = FALSE;
   if (subimagesize == tls->imagesize &&
       tls->dim[0] > 0) return tls->dim[0] * tls->dim[1];
 
@@ -359,11 +390,16 @@ SoGLBigImage::initSubImages(const SbVec2s & subimagesize) const
     if (ratio < 0.3) tls->glimagesize[1] >>= 1;
   }
 
-  SbVec2s size(0,0);
-  int nc = 0;
-
-  if (this->getImage() != NULL)
-    (void)(this->getImage()->getValue(size, nc));
+  SbVec2i32 size(0, 0);
+  if (PRIVATE(this)->pyramid) {
+    size = PRIVATE(this)->pyramid->getSize();
+  }
+  else if (this->getImage() != NULL) {
+    SbVec2s imagesize;
+    int nc;
+    (void)(this->getImage()->getValue(imagesize, nc));
+    size.setValue(imagesize[0], imagesize[1]);
+  }
 
   tls->dim[0] = size[0] / subimagesize[0];
   tls->dim[1] = size[1] / subimagesize[1];
@@ -404,9 +440,10 @@ SoGLBigImage::applySubImage(SoState * state, const int idx,
                             const float quality,
                             const SbVec2s & projsize)
 {
-  SbVec2s size;
-  int numcomponents;
-  unsigned char * bytes = this->getImage() ?
+  SoTilePyramid * pyramid = PRIVATE(this)->pyramid;
+  SbVec2s size(0, 0);
+  int numcomponents = pyramid ? pyramid->getNumComponents() : 0;
+  unsigned char * bytes = (!pyramid && this->getImage()) ?
     this->getImage()->getValue(size, numcomponents) : NULL;
 
   SoGLBigImageTls * tls = PRIVATE(this)->getTls();
@@ -448,8 +485,16 @@ SoGLBigImage::applySubImage(SoState * state, const int idx,
   }
   div >>= 1;
 
-  if (tls->glimagearray[idx] == NULL ||
-      (tls->glimagediv[idx] != div && tls->changecnt < CHANGELIMIT)) {
+  SbBool tileupdate = FALSE;
+  SbVec2s tileimagesize;
+  if (pyramid) {
+    tileupdate = PRIVATE(this)->readTileSubImage(tls, idx, level, projsize,
+                                                 div, tileimagesize);
+  }
+
+  if (pyramid ? tileupdate :
+      (tls->glimagearray[idx] == NULL ||
+       (tls->glimagediv[idx] != div && tls->changecnt < CHANGELIMIT))) {
 
     if (tls->glimagearray[idx] == NULL) {
       tls->glimagearray[idx] = new SoGLImage();
@@ -475,7 +520,10 @@ SoGLBigImage::applySubImage(SoState * state, const int idx,
 
     SbVec2s actualsize(tls->glimagesize[0]/div,
                        tls->glimagesize[1]/div);
-    if (bytes) {
+    if (pyramid) {
+      tls->imagearray[idx]->setValue(tileimagesize, numcomponents, tls->tmpbuf);
+    }
+    else if (bytes) {
       int numbytes = actualsize[0]*actualsize[1]*numcomponents;
       if (numbytes > tls->tmpbufsize) {
         delete[] tls->tmpbuf;
@@ -531,7 +579,8 @@ SoGLBigImage::applySubImage(SoState * state, const int idx,
 SbBool
 SoGLBigImage::exceededChangeLimit(void)
 {
-  return PRIVATE(this)->getTls()->changecnt >= CHANGELIMIT;
+  SoGLBigImageTls * tls = PRIVATE(this)->getTls();
+  return tls->changecnt >= CHANGELIMIT || tls->missingtiles;
 }
 
 /*!
@@ -548,10 +597,150 @@ SoGLBigImage::setChangeLimit(const int limit)
   return old;
 }
 
+/*!
+  Renders the image from the tile pyramid file \a filename instead
+  of from an image in memory. Returns \c FALSE if the file could not
+  be opened.
+
+  \sa writeTilePyramid()
+*/
+SbBool
+SoGLBigImage::setTilePyramid(const char * filename,
+                             const Wrap wraps,
+                             const Wrap wrapt,
+                             const float quality)
+{
+  SoTilePyramid * pyramid = new SoTilePyramid;
+  if (!pyramid->open(filename)) {
+    delete pyramid;
+    return FALSE;
+  }
+  delete PRIVATE(this);
+  PRIVATE(this) = new SoGLBigImageP;
+  PRIVATE(this)->pyramid = pyramid;
+
+  // the superclass gets the last level, which is always in memory,
+  // to test for transparency
+  const int last = pyramid->getNumLevels() - 1;
+  const SbVec2i32 lastsize = pyramid->getLevelSize(last);
+  SbImage & overview = PRIVATE(this)->overview;
+  overview.setValue(SbVec2s(short(lastsize[0]), short(lastsize[1])),
+                    pyramid->getNumComponents(), NULL);
+  SbVec2s size;
+  int nc;
+  (void) pyramid->getRegion(last, SbVec2i32(0, 0), lastsize,
+                            overview.getValue(size, nc));
+  // the overload without wrapr would call our setData() and reset pimpl
+  inherited::setData(&overview, wraps, wrapt, this->getWrapR(), quality, 0, NULL);
+  return TRUE;
+}
+
+/*!
+  Writes \a image to the tile pyramid file \a filename, for use with
+  setTilePyramid(). \a tilesize must be a power of two. Returns \c
+  FALSE if the file could not be written.
+
+  SbImage is limited to 32767 x 32767 pixels. Use the overload which
+  reads the image one row at a time for larger images.
+
+  The file holds the image as tiles of \a tilesize x \a tilesize
+  pixels at every mipmap level, in host byte order:
+
+  \verbatim
+  char magic[8]          "COINTPY1"
+  int32 byteorder        1, to detect files from other platforms
+  int32 width, height    size of level 0 (full resolution)
+  int32 numcomponents    1-4
+  int32 tilesize         power of two
+  int32 numlevels
+  tiles                  level 0 first. Within a level, rows of tiles
+                         from the bottom of the image. Each tile is
+                         tilesize x tilesize x numcomponents bytes,
+                         and edge tiles repeat the last column/row.
+  \endverbatim
+
+  Level n+1 is level n halved with a 2x2 box filter, dropping the last
+  row or column of an odd size, and the last level fits in one tile.
+*/
+SbBool
+SoGLBigImage::writeTilePyramid(const char * filename,
+                               const SbImage * image,
+                               const int tilesize)
+{
+  SbVec3s size;
+  int nc;
+  const unsigned char * bytes = image ? image->getValue(size, nc) : NULL;
+  if (bytes == NULL || size[2] != 0) return FALSE;
+  return SoTilePyramid::writeFile(filename, bytes, SbVec2i32(size[0], size[1]),
+                                  nc, tilesize);
+}
+
+/*!
+  \typedef SbBool SoGLBigImage::SoGLBigImageReadRowCB(void * closure, const int row, unsigned char * dst)
+
+  Reads row \a row of an image, counted from the bottom, into \a dst.
+  Returns \c FALSE on errors.
+*/
+
+/*!
+  Writes an image of \a size pixels with \a numcomponents components
+  to the tile pyramid file \a filename, for images too large for an
+  SbImage or for memory. \a readrow is called once for each row,
+  bottom row first, with \a closure as its first argument. Only about
+  two rows of tiles are kept in memory while writing.
+
+  \sa writeTilePyramid(const char *, const SbImage *, const int)
+  \since Coin 4.1
+*/
+SbBool
+SoGLBigImage::writeTilePyramid(const char * filename,
+                               const SbVec2i32 & size,
+                               const int numcomponents,
+                               SoGLBigImageReadRowCB * readrow,
+                               void * closure,
+                               const int tilesize)
+{
+  return SoTilePyramid::writeFile(filename, size, numcomponents, tilesize,
+                                  readrow, closure);
+}
+
+/*!
+  Returns \c TRUE if \a filename is a tile pyramid file.
+*/
+SbBool
+SoGLBigImage::isTilePyramid(const char * filename)
+{
+  return SoTilePyramid::isPyramidFile(filename);
+}
+
+/*!
+  Sets the maximum number of bytes of tiles kept in memory for each
+  tile pyramid. The default is 64 MB, or the value of the
+  COIN_BIGIMAGE_TILE_CACHE environment variable (in MB).
+*/
+void
+SoGLBigImage::setTileCacheSize(const size_t numbytes)
+{
+  SoTilePyramid::setCacheSize(numbytes);
+}
+
+/*!
+  Sets the maximum number of bytes in the subtextures of a tile
+  pyramid, per rendering thread. Subtextures not used in the last
+  frame are deleted, least recently used first, when the limit is
+  exceeded. The default is 128 MB.
+*/
+void
+SoGLBigImage::setTextureCacheSize(const size_t numbytes)
+{
+  TEXTURECACHESIZE = numbytes;
+}
+
 // needed for cc_storage_apply_to_all() callback
 typedef struct {
   uint32_t maxage;
   SoState * state;
+  SbBool tiled;
 } soglbigimage_unrefolddl_data;
 
 // cc_storage_apply_to_all() callback
@@ -561,7 +750,8 @@ soglbigimage_unrefolddl_cb(void * tls, void * closure)
   soglbigimage_unrefolddl_data * data =
     (soglbigimage_unrefolddl_data *) closure;
 
-  SoGLBigImageP::unrefOldDL((SoGLBigImageTls*)tls, data->state, data->maxage);
+  SoGLBigImageP::unrefOldDL((SoGLBigImageTls*)tls, data->state, data->maxage,
+                            data->tiled);
 }
 
 // Documented in superclass. Overridden to handle age on subimages.
@@ -571,6 +761,8 @@ SoGLBigImage::unrefOldDL(SoState * state, const uint32_t maxage)
   soglbigimage_unrefolddl_data data;
   data.maxage = maxage;
   data.state = state;
+  data.tiled = PRIVATE(this)->pyramid != NULL;
+  if (PRIVATE(this)->pyramid) PRIVATE(this)->pyramid->newFrame();
   cc_storage_apply_to_all(PRIVATE(this)->storage, soglbigimage_unrefolddl_cb, &data);
 
   this->incAge();
@@ -583,7 +775,8 @@ SoGLBigImage::unrefOldDL(SoState * state, const uint32_t maxage)
 SoGLBigImageP::SoGLBigImageP(void) :
   cache(NULL),
   cachesize(NULL),
-  numcachelevels(0)
+  numcachelevels(0),
+  pyramid(NULL)
 {
   this->storage = cc_storage_construct_etc(sizeof(SoGLBigImageTls),
                                            soglbigimagetls_construct,
@@ -594,6 +787,62 @@ SoGLBigImageP::~SoGLBigImageP()
 {
   this->resetCache();
   cc_storage_destruct(this->storage);
+  delete this->pyramid;
+}
+
+// Reads the data for subimage idx from the tile pyramid into
+// tls->tmpbuf, at wantedlevel if those tiles are in memory, or else
+// at the finest coarser level that improves on the current
+// subtexture. Returns FALSE if the subtexture should be kept.
+SbBool
+SoGLBigImageP::readTileSubImage(SoGLBigImageTls * tls,
+                                const int idx,
+                                const int wantedlevel,
+                                const SbVec2s & projsize,
+                                int & div,
+                                SbVec2s & actualsize)
+{
+  const int last = this->pyramid->getNumLevels() - 1;
+  const int level = SbMin(wantedlevel, last);
+  const SbBool hastexture = tls->glimagearray[idx] != NULL;
+  if (hastexture && tls->glimagediv[idx] == (1 << level)) return FALSE;
+
+  const SbVec2s pos(idx % tls->dim[0], idx / tls->dim[0]);
+  const int nc = this->pyramid->getNumComponents();
+
+  SbVec2i32 regionsize(SbMax(tls->imagesize[0] >> level, 1),
+                       SbMax(tls->imagesize[1] >> level, 1));
+  this->pyramid->request(level,
+                         SbVec2i32(pos[0] * regionsize[0], pos[1] * regionsize[1]),
+                         regionsize,
+                         float(projsize[0]) * float(projsize[1]));
+  if (hastexture && tls->changecnt >= CHANGELIMIT) {
+    tls->missingtiles = TRUE;
+    return FALSE;
+  }
+
+  for (int l = level; l <= last; l++) {
+    if (l > level && hastexture && (1 << l) >= tls->glimagediv[idx]) break;
+    regionsize.setValue(SbMax(tls->imagesize[0] >> l, 1),
+                        SbMax(tls->imagesize[1] >> l, 1));
+    const int numbytes = regionsize[0] * regionsize[1] * nc;
+    if (numbytes > tls->tmpbufsize) {
+      delete[] tls->tmpbuf;
+      tls->tmpbuf = new unsigned char[numbytes];
+      tls->tmpbufsize = numbytes;
+    }
+    if (this->pyramid->getRegion(l, SbVec2i32(pos[0] * regionsize[0],
+                                              pos[1] * regionsize[1]),
+                                 regionsize, tls->tmpbuf)) {
+      // refine later when the wanted tiles have been read
+      if (l != level) tls->missingtiles = TRUE;
+      div = 1 << l;
+      actualsize.setValue(short(regionsize[0]), short(regionsize[1]));
+      return TRUE;
+    }
+  }
+  tls->missingtiles = TRUE;
+  return FALSE;
 }
 
 //  The method copySubImage() handles the downsampling. It averages
@@ -950,10 +1199,45 @@ SoGLBigImageP::reset(SoGLBigImageTls * tls, SoState * state)
   tls->currentdim.setValue(0,0);
 }
 
+// returns the number of bytes in subimage i
+static size_t
+soglbigimage_subimagebytes(SoGLBigImageTls * tls, const int i)
+{
+  SbVec2s size;
+  int nc;
+  if (tls->imagearray[i] == NULL ||
+      tls->imagearray[i]->getValue(size, nc) == NULL) return 0;
+  return size_t(size[0]) * size_t(size[1]) * size_t(nc);
+}
+
 void
-SoGLBigImageP::unrefOldDL(SoGLBigImageTls * tls, SoState * state, const uint32_t maxage)
+SoGLBigImageP::unrefOldDL(SoGLBigImageTls * tls, SoState * state, const uint32_t maxage,
+                          const SbBool tiled)
 {
   const int numimages = tls->currentdim[0] * tls->currentdim[1];
+
+  // subimages for tile pyramids are only in memory while they have a
+  // texture, and the textures are kept within TEXTURECACHESIZE
+  if (tiled) {
+    size_t numbytes = 0;
+    SbList <int> candidates;
+    for (int i = 0; i < numimages; i++) {
+      if (tls->glimagearray[i] == NULL) continue;
+      numbytes += soglbigimage_subimagebytes(tls, i);
+      if (tls->glimageage[i] > 0) candidates.append(i);
+    }
+    if (numbytes > TEXTURECACHESIZE) {
+      int * ptr = candidates.getLength() ? &candidates[0] : NULL;
+      std::sort(ptr, ptr + candidates.getLength(), [tls](const int a, const int b) {
+        return tls->glimageage[a] > tls->glimageage[b];
+      });
+      for (int i = 0; i < candidates.getLength() && numbytes > TEXTURECACHESIZE; i++) {
+        numbytes -= soglbigimage_subimagebytes(tls, candidates[i]);
+        tls->glimageage[candidates[i]] = maxage; // killed below
+      }
+    }
+  }
+
   for (int i = 0; i < numimages; i++) {
     if (tls->glimagearray[i]) {
       if (tls->glimageage[i] >= maxage) {
@@ -963,6 +1247,10 @@ SoGLBigImageP::unrefOldDL(SoGLBigImageTls * tls, SoState * state, const uint32_t
 #endif // debug
         tls->glimagearray[i]->unref(state);
         tls->glimagearray[i] = NULL;
+        if (tiled) {
+          delete tls->imagearray[i];
+          tls->imagearray[i] = NULL;
+        }
       }
       else tls->glimageage[i] += 1;
     }
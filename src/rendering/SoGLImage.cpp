@@ -219,6 +219,7 @@
 
 
 #include "rendering/SoGL.h"
+#include "rendering/SoGLResourceManagerP.h"
 #include "elements/SoTextureScaleQualityElement.h"
 #include "glue/glp.h"
 #include "base/SbImageFormatHandler.h"
@@ -1656,6 +1657,15 @@ SoGLImageP::createGLDisplayList(SoState *state)
                               this->border);
   }
   dl->close(state);
+
+  if (imageptr && dl->getType() == SoGLDisplayList::TEXTURE_OBJECT) {
+    size_t numbytes = size_t(xsize) * size_t(ysize) *
+      size_t(zsize ? zsize : 1) * size_t(numcomponents);
+    if (mipmap) numbytes += numbytes / 3;
+    SoGLResourceManagerP::add(dl->getContext(),
+                              SoGLResourceManager::TEXTURE_OBJECT,
+                              dl, numbytes, (GLuint) dl->getFirstIndex());
+  }
   return dl;
 }
 
@@ -1934,7 +1944,16 @@ SoGLImageP::findDL(SoState *state)
   SoGLDisplayList *dl;
   for (i = 0; i < n; i++) {
     dl = this->dlists[i].dlist;
-    if (dl->getContext() == currcontext) return dl;
+    if (dl->getContext() == currcontext) {
+      if (!SoGLResourceManagerP::touch(currcontext, dl)) {
+        // the texture object was evicted by SoGLResourceManager. Drop
+        // the stale display list so that the caller creates a new one.
+        this->dlists.removeFast(i);
+        dl->unref(state);
+        return NULL;
+      }
+      return dl;
+    }
   }
   return NULL;
 }
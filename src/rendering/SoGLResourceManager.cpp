@@ -0,0 +1,477 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+
+/*!
+  \class SoGLResourceManager SoGLResourceManager.h Inventor/misc/SoGLResourceManager.h
+  \brief The SoGLResourceManager class keeps track of the OpenGL memory used in each context.
+
+  Vertex buffer objects (created by SoVBO), texture objects (created
+  by SoGLImage) and display lists are registered per context when they
+  are created, together with an estimate of the memory they use on the
+  graphics card. Buffer and texture objects are moved to the back of a
+  least recently used list when they are used.
+
+  If a context has a memory budget, the least recently used buffer and
+  texture objects are deleted after each frame (after each
+  SoGLRenderAction traversal) until the context is within its budget.
+  Objects used in the frame just rendered are never deleted, so the
+  budget is a soft limit. An evicted object is recreated from the data
+  kept by its owner the next time it is used. Display lists are only
+  counted, since they can't be recreated without traversing the scene
+  graph again, and texture objects called from a render cache's
+  display list are not evicted until the cache is destroyed.
+
+  The default budget is 0 (no limit), or the value of the environment
+  variable COIN_GL_MEMORY_BUDGET, in megabytes.
+
+  The totals are also shown by the SoProfilerStats node.
+*/
+
+/*!
+  \enum SoGLResourceManager::ResourceType
+  The types of OpenGL objects tracked by SoGLResourceManager.
+*/
+
+#include <Inventor/misc/SoGLResourceManager.h>
+#include "rendering/SoGLResourceManagerP.h"
+
+#include <cassert>
+#include <cstdlib>
+#include <mutex>
+#include <unordered_map>
+
+#include <Inventor/misc/SoContextHandler.h>
+
+#include "glue/glp.h"
+#include "misc/SoEnvironment.h"
+
+namespace {
+
+struct sogl_resource {
+  const void * owner;
+  SoGLResourceManager::ResourceType type;
+  size_t numbytes;
+  GLuint name;
+  uint32_t frame;
+  int numpins;
+  SbBool evicted;
+  // least recently used list, oldest first
+  sogl_resource * prev;
+  sogl_resource * next;
+};
+
+struct sogl_resource_context {
+  sogl_resource_context(void)
+    : head(NULL), tail(NULL), budget(0), hasbudget(FALSE),
+      frame(0), numevictions(0)
+  {
+    for (int i = 0; i < SoGLResourceManager::NUM_RESOURCE_TYPES; i++) {
+      this->numbytes[i] = 0;
+      this->numresources[i] = 0;
+    }
+  }
+  ~sogl_resource_context() {
+    for (auto & it : this->resources) delete it.second;
+  }
+
+  void unlink(sogl_resource * r) {
+    if (r->prev) r->prev->next = r->next;
+    else this->head = r->next;
+    if (r->next) r->next->prev = r->prev;
+    else this->tail = r->prev;
+    r->prev = r->next = NULL;
+  }
+  void append(sogl_resource * r) {
+    r->prev = this->tail;
+    r->next = NULL;
+    if (this->tail) this->tail->next = r;
+    else this->head = r;
+    this->tail = r;
+  }
+  void account(const sogl_resource * r, const int sign) {
+    if (sign > 0) {
+      this->numbytes[r->type] += r->numbytes;
+      this->numresources[r->type]++;
+    }
+    else {
+      this->numbytes[r->type] -= r->numbytes;
+      this->numresources[r->type]--;
+    }
+  }
+  size_t total(void) const {
+    size_t sum = 0;
+    for (int i = 0; i < SoGLResourceManager::NUM_RESOURCE_TYPES; i++) sum += this->numbytes[i];
+    return sum;
+  }
+
+  std::unordered_map<const void *, sogl_resource *> resources;
+  sogl_resource * head;
+  sogl_resource * tail;
+  size_t numbytes[SoGLResourceManager::NUM_RESOURCE_TYPES];
+  int numresources[SoGLResourceManager::NUM_RESOURCE_TYPES];
+  size_t budget;
+  SbBool hasbudget;
+  uint32_t frame;
+  uint32_t numevictions;
+};
+
+struct sogl_resource_manager {
+  sogl_resource_manager(void) : defaultbudget(0) {
+    const char * env = CoinInternal::getEnvironmentVariableRaw("COIN_GL_MEMORY_BUDGET");
+    if (env) this->defaultbudget = size_t(atof(env) * 1024.0 * 1024.0);
+    SoContextHandler::addContextDestructionCallback(context_destruction_cb, this);
+  }
+
+  // returns the data for contextid, creating it if create is TRUE
+  sogl_resource_context * get(const uint32_t contextid, const SbBool create) {
+    auto it = this->contexts.find(contextid);
+    if (it != this->contexts.end()) return it->second;
+    if (!create) return NULL;
+    sogl_resource_context * ctx = new sogl_resource_context;
+    this->contexts[contextid] = ctx;
+    return ctx;
+  }
+
+  static void context_destruction_cb(uint32_t contextid, void * closure) {
+    // the objects are deleted by their owners, or with the context
+    sogl_resource_manager * thisp = static_cast<sogl_resource_manager *>(closure);
+    std::lock_guard<std::mutex> guard(thisp->mutex);
+    auto it = thisp->contexts.find(contextid);
+    if (it != thisp->contexts.end()) {
+      delete it->second;
+      thisp->contexts.erase(it);
+    }
+  }
+
+  std::mutex mutex;
+  std::unordered_map<uint32_t, sogl_resource_context *> contexts;
+  size_t defaultbudget;
+};
+
+// created on first use, and kept until exit since owners may
+// unregister their objects from static destructors
+sogl_resource_manager &
+sogl_resources(void)
+{
+  static sogl_resource_manager * manager = new sogl_resource_manager;
+  return *manager;
+}
+
+} // anonymous namespace
+
+/*!
+  Sets the memory budget for contexts without a budget of their own.
+  0 means no limit.
+*/
+void
+SoGLResourceManager::setDefaultBudget(const size_t numbytes)
+{
+  sogl_resource_manager & m = sogl_resources();
+  std::lock_guard<std::mutex> guard(m.mutex);
+  m.defaultbudget = numbytes;
+}
+
+/*!
+  Returns the default memory budget.
+*/
+size_t
+SoGLResourceManager::getDefaultBudget(void)
+{
+  sogl_resource_manager & m = sogl_resources();
+  std::lock_guard<std::mutex> guard(m.mutex);
+  return m.defaultbudget;
+}
+
+/*!
+  Sets the memory budget for the context \a contextid, in bytes. 0
+  means no limit.
+*/
+void
+SoGLResourceManager::setBudget(const uint32_t contextid, const size_t numbytes)
+{
+  sogl_resource_manager & m = sogl_resources();
+  std::lock_guard<std::mutex> guard(m.mutex);
+  sogl_resource_context * ctx = m.get(contextid, TRUE);
+  ctx->budget = numbytes;
+  ctx->hasbudget = TRUE;
+}
+
+/*!
+  Returns the memory budget used for the context \a contextid.
+*/
+size_t
+SoGLResourceManager::getBudget(const uint32_t contextid)
+{
+  sogl_resource_manager & m = sogl_resources();
+  std::lock_guard<std::mutex> guard(m.mutex);
+  sogl_resource_context * ctx = m.get(contextid, FALSE);
+  return (ctx && ctx->hasbudget) ? ctx->budget : m.defaultbudget;
+}
+
+/*!
+  Returns the estimated number of bytes used by objects of type \a
+  type in the context \a contextid. Display lists are counted as 0
+  bytes.
+*/
+size_t
+SoGLResourceManager::getNumBytes(const uint32_t contextid, const ResourceType type)
+{
+  sogl_resource_manager & m = sogl_resources();
+  std::lock_guard<std::mutex> guard(m.mutex);
+  sogl_resource_context * ctx = m.get(contextid, FALSE);
+  return ctx ? ctx->numbytes[type] : 0;
+}
+
+/*!
+  Returns the estimated number of bytes used by all objects in the
+  context \a contextid.
+*/
+size_t
+SoGLResourceManager::getTotalNumBytes(const uint32_t contextid)
+{
+  sogl_resource_manager & m = sogl_resources();
+  std::lock_guard<std::mutex> guard(m.mutex);
+  sogl_resource_context * ctx = m.get(contextid, FALSE);
+  return ctx ? ctx->total() : 0;
+}
+
+/*!
+  Returns the number of objects of type \a type in the context \a
+  contextid.
+*/
+int
+SoGLResourceManager::getNumResources(const uint32_t contextid, const ResourceType type)
+{
+  sogl_resource_manager & m = sogl_resources();
+  std::lock_guard<std::mutex> guard(m.mutex);
+  sogl_resource_context * ctx = m.get(contextid, FALSE);
+  return ctx ? ctx->numresources[type] : 0;
+}
+
+/*!
+  Returns the number of objects evicted from the context \a contextid
+  to keep it within its budget.
+*/
+uint32_t
+SoGLResourceManager::getNumEvictions(const uint32_t contextid)
+{
+  sogl_resource_manager & m = sogl_resources();
+  std::lock_guard<std::mutex> guard(m.mutex);
+  sogl_resource_context * ctx = m.get(contextid, FALSE);
+  return ctx ? ctx->numevictions : 0;
+}
+
+// *************************************************************************
+
+//
+// Registers the OpenGL object \a name of type \a type, created by \a
+// owner in the context \a contextid. Each owner can have one object
+// per context. \a name is only used for buffer and texture objects,
+// which the manager may delete.
+//
+void
+SoGLResourceManagerP::add(const uint32_t contextid,
+                          const SoGLResourceManager::ResourceType type,
+                          const void * owner, const size_t numbytes,
+                          const GLuint name)
+{
+  sogl_resource_manager & m = sogl_resources();
+  std::lock_guard<std::mutex> guard(m.mutex);
+  sogl_resource_context * ctx = m.get(contextid, TRUE);
+
+  sogl_resource *& r = ctx->resources[owner];
+  if (r == NULL) {
+    r = new sogl_resource;
+    r->numpins = 0;
+  }
+  else if (!r->evicted) {
+    ctx->unlink(r);
+    ctx->account(r, -1);
+  }
+  r->owner = owner;
+  r->type = type;
+  r->numbytes = numbytes;
+  r->name = name;
+  r->frame = ctx->frame;
+  r->evicted = FALSE;
+  ctx->account(r, 1);
+  ctx->append(r);
+}
+
+//
+// Marks the object of \a owner as used in the current frame. Returns
+// FALSE if the object has been evicted, in which case the owner must
+// forget it without deleting it, and either create a new object with
+// add() or call remove().
+//
+SbBool
+SoGLResourceManagerP::touch(const uint32_t contextid, const void * owner)
+{
+  sogl_resource_manager & m = sogl_resources();
+  std::lock_guard<std::mutex> guard(m.mutex);
+  sogl_resource_context * ctx = m.get(contextid, FALSE);
+  if (ctx == NULL) return TRUE;
+  auto it = ctx->resources.find(owner);
+  if (it == ctx->resources.end()) return TRUE;
+
+  sogl_resource * r = it->second;
+  if (r->evicted) return FALSE;
+  r->frame = ctx->frame;
+  if (r != ctx->tail) {
+    ctx->unlink(r);
+    ctx->append(r);
+  }
+  return TRUE;
+}
+
+//
+// Unregisters the object of \a owner. Returns FALSE if the object has
+// been evicted, and should not be deleted by the owner.
+//
+SbBool
+SoGLResourceManagerP::remove(const uint32_t contextid, const void * owner)
+{
+  sogl_resource_manager & m = sogl_resources();
+  std::lock_guard<std::mutex> guard(m.mutex);
+  sogl_resource_context * ctx = m.get(contextid, FALSE);
+  if (ctx == NULL) return TRUE;
+  auto it = ctx->resources.find(owner);
+  if (it == ctx->resources.end()) return TRUE;
+
+  sogl_resource * r = it->second;
+  const SbBool alive = !r->evicted;
+  if (alive) {
+    ctx->unlink(r);
+    ctx->account(r, -1);
+  }
+  ctx->resources.erase(it);
+  delete r;
+  return alive;
+}
+
+//
+// Prevents the object of \a owner from being evicted, for objects
+// referenced from display lists. Pins are counted, and each pin()
+// must be matched by an unpin() when the display list is released.
+//
+void
+SoGLResourceManagerP::pin(const uint32_t contextid, const void * owner)
+{
+  sogl_resource_manager & m = sogl_resources();
+  std::lock_guard<std::mutex> guard(m.mutex);
+  sogl_resource_context * ctx = m.get(contextid, FALSE);
+  if (ctx == NULL) return;
+  auto it = ctx->resources.find(owner);
+  if (it != ctx->resources.end()) it->second->numpins++;
+}
+
+//
+// Releases a pin() on the object of \a owner.
+//
+void
+SoGLResourceManagerP::unpin(const uint32_t contextid, const void * owner)
+{
+  sogl_resource_manager & m = sogl_resources();
+  std::lock_guard<std::mutex> guard(m.mutex);
+  sogl_resource_context * ctx = m.get(contextid, FALSE);
+  if (ctx == NULL) return;
+  auto it = ctx->resources.find(owner);
+  if (it != ctx->resources.end() && it->second->numpins > 0) it->second->numpins--;
+}
+
+//
+// Starts a new frame in \a contextid.
+//
+void
+SoGLResourceManagerP::beginFrame(const uint32_t contextid)
+{
+  sogl_resource_manager & m = sogl_resources();
+  std::lock_guard<std::mutex> guard(m.mutex);
+  m.get(contextid, TRUE)->frame++;
+}
+
+//
+// Evicts least recently used objects until \a contextid is within its
+// budget, and appends the names of the evicted buffer and texture
+// objects to \a buffers and \a textures, for the caller to delete.
+//
+void
+SoGLResourceManagerP::evict(const uint32_t contextid,
+                            SbList<GLuint> & buffers, SbList<GLuint> & textures)
+{
+  sogl_resource_manager & m = sogl_resources();
+  std::lock_guard<std::mutex> guard(m.mutex);
+  sogl_resource_context * ctx = m.get(contextid, FALSE);
+  if (ctx == NULL) return;
+  const size_t budget = ctx->hasbudget ? ctx->budget : m.defaultbudget;
+  if (budget == 0) return;
+
+  size_t total = ctx->total();
+  sogl_resource * r = ctx->head;
+  while (r && total > budget) {
+    sogl_resource * next = r->next;
+    // objects are moved to the back when used, so the rest of the
+    // list was used in this frame
+    if (r->frame == ctx->frame) break;
+    if (r->numpins == 0 && r->type != SoGLResourceManager::DISPLAY_LIST) {
+      if (r->type == SoGLResourceManager::BUFFER_OBJECT) buffers.append(r->name);
+      else textures.append(r->name);
+      total -= r->numbytes;
+      ctx->unlink(r);
+      ctx->account(r, -1);
+      r->evicted = TRUE;
+      ctx->numevictions++;
+    }
+    r = next;
+  }
+}
+
+//
+// Evicts least recently used objects until \a contextid is within its
+// budget. Must be called with the context current.
+//
+void
+SoGLResourceManagerP::endFrame(const uint32_t contextid)
+{
+  SbList<GLuint> buffers, textures;
+  SoGLResourceManagerP::evict(contextid, buffers, textures);
+  if (buffers.getLength() == 0 && textures.getLength() == 0) return;
+
+  const cc_glglue * glue = cc_glglue_instance(static_cast<int>(contextid));
+  if (buffers.getLength()) {
+    cc_glglue_glDeleteBuffers(glue, buffers.getLength(), buffers.getArrayPtr());
+  }
+  if (textures.getLength()) {
+    cc_glglue_glDeleteTextures(glue, textures.getLength(), textures.getArrayPtr());
+  }
+}
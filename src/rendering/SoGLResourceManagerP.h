@@ -0,0 +1,65 @@
+#ifndef COIN_SOGLRESOURCEMANAGERP_H
+#define COIN_SOGLRESOURCEMANAGERP_H
+
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+#ifndef COIN_INTERNAL
+#error this is a private header file
+#endif /* !COIN_INTERNAL */
+
+
+#include <Inventor/misc/SoGLResourceManager.h>
+#include <Inventor/lists/SbList.h>
+#include <Inventor/system/gl.h>
+
+// Used by SoVBO, SoGLImage and SoGLDisplayList to register the OpenGL
+// objects they create with SoGLResourceManager. See
+// SoGLResourceManager.cpp for how eviction works.
+class SoGLResourceManagerP {
+public:
+  static void add(const uint32_t contextid,
+                  const SoGLResourceManager::ResourceType type,
+                  const void * owner, const size_t numbytes,
+                  const GLuint name = 0);
+  static SbBool touch(const uint32_t contextid, const void * owner);
+  static SbBool remove(const uint32_t contextid, const void * owner);
+  static void pin(const uint32_t contextid, const void * owner);
+  static void unpin(const uint32_t contextid, const void * owner);
+
+  static void beginFrame(const uint32_t contextid);
+  static void evict(const uint32_t contextid,
+                    SbList<GLuint> & buffers, SbList<GLuint> & textures);
+  static void endFrame(const uint32_t contextid);
+};
+
+#endif // COIN_SOGLRESOURCEMANAGERP_H
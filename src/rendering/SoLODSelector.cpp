@@ -0,0 +1,239 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+/*!
+  \class SoLODSelector
+  \brief The SoLODSelector class chooses levels of detail within a budget.
+
+  \internal
+
+  Used by SoGLRenderAction in SCREEN_SPACE_ERROR_LOD mode. The action
+  keeps one Record for every level-of-detail node in view, holding the
+  primitive count and the projected error of each child, and calls
+  selectLevels() at the end of each frame to choose the levels for the
+  next one.
+
+  The levels are chosen with a single error limit for all nodes, found
+  by bisection: the smallest limit at which the total primitive count
+  fits the budget. The count is monotone in the limit, also with the
+  hysteresis applied by getLevel(), which is what makes the bisection
+  valid. The limit of the last frame is kept while its count stays
+  within the hysteresis band below the budget, so that an unchanged
+  scene doesn't make the limit drift from frame to frame.
+*/
+
+#include "rendering/SoLODSelector.h"
+
+#include <climits>
+#include <cmath>
+
+// *************************************************************************
+
+SoLODSelector::SoLODSelector(void)
+  : trianglebudget(0),
+    frametimebudget(SbTime::zero()),
+    hysteresis(0.15f),
+    adaptivebudget(0.0),
+    lastlimit(0.0f)
+{
+}
+
+/*!
+  Sets the maximum number of primitives in view. 0 means no limit.
+*/
+void
+SoLODSelector::setTriangleBudget(const int numtriangles)
+{
+  this->trianglebudget = SbMax(numtriangles, 0);
+}
+
+int
+SoLODSelector::getTriangleBudget(void) const
+{
+  return this->trianglebudget;
+}
+
+/*!
+  Sets the target frame time. A zero time disables the frame time
+  budget.
+*/
+void
+SoLODSelector::setFrameTimeBudget(const SbTime & frametime)
+{
+  this->frametimebudget = frametime;
+  this->adaptivebudget = 0.0;
+}
+
+SbTime
+SoLODSelector::getFrameTimeBudget(void) const
+{
+  return this->frametimebudget;
+}
+
+/*!
+  Sets the hysteresis as a fraction of the error limit, clamped to
+  [0, 0.9].
+*/
+void
+SoLODSelector::setHysteresis(const float fraction)
+{
+  this->hysteresis = SbClamp(fraction, 0.0f, 0.9f);
+}
+
+float
+SoLODSelector::getHysteresis(void) const
+{
+  return this->hysteresis;
+}
+
+/*!
+  Makes the frame time budget start over from the current primitive
+  count.
+*/
+void
+SoLODSelector::resetAdaptiveBudget(void)
+{
+  this->adaptivebudget = 0.0;
+}
+
+/*!
+  Estimates the projected error of each level of \a rec as the screen
+  size of an average primitive, given the projected diameter of the
+  node's bounding box in pixels. The errors are made nondecreasing
+  from the finest to the coarsest level.
+*/
+void
+SoLODSelector::setErrors(Record * rec, const float diameter)
+{
+  const int n = rec->counts.getLength();
+  rec->errors.truncate(0);
+  float prev = 0.0f;
+  for (int i = 0; i < n; i++) {
+    float error = diameter / float(sqrt(double(SbMax(rec->counts[i], 1))));
+    if (rec->counts[i] == 0) error = diameter;
+    prev = SbMax(prev, error);
+    rec->errors.append(prev);
+  }
+}
+
+/*!
+  Returns the level to use for \a rec when no level in view may have
+  an error above \a maxerror, i.e. the coarsest level within the
+  limit. The current level is kept while \a maxerror stays within the
+  hysteresis band around the range where it would be chosen.
+*/
+int
+SoLODSelector::getLevel(const Record * rec, const float maxerror) const
+{
+  const int n = rec->errors.getLength();
+  const int cur = rec->level;
+  if (cur < n &&
+      rec->errors[cur] <= maxerror * (1.0f + this->hysteresis) &&
+      (cur == n - 1 || rec->errors[cur+1] > maxerror * (1.0f - this->hysteresis))) {
+    return cur;
+  }
+  int level = 0;
+  while (level < n - 1 && rec->errors[level+1] <= maxerror) level++;
+  return level;
+}
+
+/*!
+  Returns the number of primitives in \a records for an error limit.
+*/
+int
+SoLODSelector::countTriangles(const SbList<Record *> & records, const float maxerror) const
+{
+  int total = 0;
+  for (int i = 0; i < records.getLength(); i++) {
+    const Record * rec = records[i];
+    total += rec->counts[this->getLevel(rec, maxerror)];
+  }
+  return total;
+}
+
+/*!
+  Chooses the levels of \a records for the next frame, and returns
+  their total primitive count. \a frametime is the time the last frame
+  took, used with the frame time budget.
+*/
+int
+SoLODSelector::selectLevels(const SbList<Record *> & records, const SbTime & frametime)
+{
+  const int num = records.getLength();
+  int finest = 0, current = 0;
+  float maxerror = 0.0f;
+  for (int i = 0; i < num; i++) {
+    const Record * rec = records[i];
+    finest += rec->counts[0];
+    current += rec->counts[rec->level];
+    maxerror = SbMax(maxerror, rec->errors[rec->errors.getLength() - 1]);
+  }
+
+  int budget = this->trianglebudget > 0 ? this->trianglebudget : INT_MAX;
+  if (this->frametimebudget > SbTime::zero()) {
+    if (this->adaptivebudget <= 0.0) this->adaptivebudget = double(current);
+    double ratio = this->frametimebudget.getValue() / SbMax(frametime.getValue(), 1.0e-6);
+    ratio = SbClamp(ratio, 0.5, 2.0);
+    this->adaptivebudget *= 1.0 + 0.5 * (ratio - 1.0);
+    this->adaptivebudget = SbClamp(this->adaptivebudget, 1.0, double(SbMax(finest, 1)));
+    budget = SbMin(budget, int(this->adaptivebudget));
+  }
+
+  float limit = 0.0f;
+  if (this->countTriangles(records, 0.0f) > budget) {
+    const int last = this->lastlimit > 0.0f ?
+      this->countTriangles(records, this->lastlimit) : INT_MAX;
+    if (last <= budget && last >= int(budget * (1.0f - this->hysteresis))) {
+      limit = this->lastlimit;
+    }
+    else {
+      // above this limit, every node is at its coarsest level
+      float lo = 0.0f;
+      float hi = maxerror / (1.0f - this->hysteresis) * 1.001f + 1.0e-3f;
+      for (int iter = 0; iter < 32; iter++) {
+        const float mid = 0.5f * (lo + hi);
+        if (this->countTriangles(records, mid) <= budget) hi = mid;
+        else lo = mid;
+      }
+      limit = hi;
+    }
+  }
+  this->lastlimit = limit;
+
+  int total = 0;
+  for (int i = 0; i < num; i++) {
+    Record * rec = records[i];
+    rec->level = this->getLevel(rec, limit);
+    total += rec->counts[rec->level];
+  }
+  return total;
+}
@@ -0,0 +1,82 @@
+#ifndef COIN_SOLODSELECTOR_H
+#define COIN_SOLODSELECTOR_H
+
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+#ifndef COIN_INTERNAL
+#error this is a private header file
+#endif /* !COIN_INTERNAL */
+
+#include <Inventor/SbBasic.h>
+#include <Inventor/SbTime.h>
+#include <Inventor/lists/SbList.h>
+
+// Chooses the levels of the level-of-detail nodes in view for
+// SoGLRenderAction's SCREEN_SPACE_ERROR_LOD mode. Doesn't depend on
+// OpenGL or the scene graph, see SoLODSelector.cpp.
+
+class SoLODSelector {
+public:
+  // One level-of-detail node (instance) in view.
+  class Record {
+  public:
+    Record(void) : level(0) { }
+    SbList<int> counts;   // primitives in each child
+    SbList<float> errors; // projected error of each child
+    int level;            // the child to render
+  };
+
+  SoLODSelector(void);
+
+  void setTriangleBudget(const int numtriangles);
+  int getTriangleBudget(void) const;
+  void setFrameTimeBudget(const SbTime & frametime);
+  SbTime getFrameTimeBudget(void) const;
+  void setHysteresis(const float fraction);
+  float getHysteresis(void) const;
+  void resetAdaptiveBudget(void);
+
+  static void setErrors(Record * rec, const float diameter);
+  int getLevel(const Record * rec, const float maxerror) const;
+  int countTriangles(const SbList<Record *> & records, const float maxerror) const;
+  int selectLevels(const SbList<Record *> & records, const SbTime & frametime);
+
+private:
+  int trianglebudget;
+  SbTime frametimebudget;
+  float hysteresis;
+  double adaptivebudget;
+  float lastlimit;
+};
+
+#endif // !COIN_SOLODSELECTOR_H
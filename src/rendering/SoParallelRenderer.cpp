@@ -0,0 +1,539 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+/*!
+  \class SoParallelRenderer SoParallelRenderer.h Inventor/SoParallelRenderer.h
+  \brief The SoParallelRenderer class renders one scene graph into several contexts at once.
+
+  Each job set up with addJob() renders the scene graph with its own
+  camera and viewport into its own OpenGL context. The contexts are
+  created and made current through the SoDB::ContextManager given to
+  SoDB::init(), so they would typically come from
+  SoDB::ContextManager::createOffscreenContext().
+
+  On render(), the jobs are spread over a pool of worker threads, and
+  the calling thread takes part. Every job has its own
+  SoGLRenderAction and cache context, so display lists, textures and
+  VBOs are created separately for each context, while the per node
+  bounding box and primitive vertex caches are shared between the
+  jobs. Each worker holds the SoDB read lock while it renders, so the
+  scene graph must only be changed under SoDB::writelock() while
+  render() is running in another thread.
+
+  Worker threads are only used when Coin is built with COIN_THREADSAFE
+  (see SoDB::isMultiThread()). Otherwise, the jobs are rendered one
+  after the other in the calling thread.
+
+  The camera of a job is placed in front of the scene graph, so the
+  scene graph itself should not contain a camera. Clipping planes are
+  not adjusted automatically like SoRenderManager does. A post render
+  callback can be used to read back the pixels of each job while its
+  context is current.
+
+  \code
+  SoDB::ContextManager * manager = SoDB::getContextManager();
+  SoParallelRenderer renderer;
+  renderer.setSceneGraph(root);
+  for (int i = 0; i < numviews; i++) {
+    renderer.addJob(cameras[i], SbViewportRegion(512, 512),
+                    manager->createOffscreenContext(512, 512));
+  }
+  renderer.setPostRenderCallback(readPixels, images);
+  renderer.render();
+  \endcode
+
+  \sa SoRenderManager, SoOffscreenRenderer
+*/
+
+#include <Inventor/SoParallelRenderer.h>
+
+#include <atomic>
+#include <cassert>
+#include <thread>
+#include <unordered_map>
+
+#include <Inventor/SoDB.h>
+#include <Inventor/actions/SoGLRenderAction.h>
+#include <Inventor/elements/SoGLCacheContextElement.h>
+#include <Inventor/errors/SoDebugError.h>
+#include <Inventor/lists/SbList.h>
+#include <Inventor/nodes/SoCamera.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/system/gl.h>
+#include <Inventor/threads/SbCondVar.h>
+#include <Inventor/threads/SbMutex.h>
+#include <Inventor/threads/SbThread.h>
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
+// *************************************************************************
+
+class SoParallelRendererP {
+public:
+  SoParallelRendererP(void)
+    : scene(NULL), numthreads(0), bgcolor(0.0f, 0.0f, 0.0f, 0.0f),
+      postrendercb(NULL), postrenderdata(NULL),
+      generation(0), numactive(0), quit(FALSE), next(0)
+  {
+  }
+
+  class Job {
+  public:
+    SoCamera * camera;
+    SbViewportRegion viewport;
+    void * context;
+    SoSeparator * root;
+    SoGLRenderAction * action;
+    SbBool ok;
+  };
+
+  SoNode * scene;
+  SbList<Job *> jobs;
+  int numthreads;
+  SbColor4f bgcolor;
+  SoParallelRenderer::JobCB * postrendercb;
+  void * postrenderdata;
+
+  // the same context always gets the same cache context, so that
+  // caches survive jobs being set up again
+  std::unordered_map<void *, uint32_t> cachecontexts;
+
+  // worker threads, started on demand
+  SbList<SbThread *> workers;
+  SbMutex workmutex;
+  SbCondVar workcond;
+  SbCondVar donecond;
+  unsigned int generation;
+  int numactive;
+  SbBool quit;
+  std::atomic<int> next;
+
+  void setupJob(Job * job, SoCamera * camera,
+                const SbViewportRegion & viewport, void * context);
+  void updateRoot(Job * job);
+  void deleteJob(Job * job);
+  int getNumThreadsToUse(void) const;
+  void startWorkers(const int num);
+  void stopWorkers(void);
+  void runJobs(void);
+  void renderJob(const int idx);
+
+  static void * workerLoop(void * closure);
+};
+
+#define PRIVATE(obj) ((obj)->pimpl)
+
+void
+SoParallelRendererP::setupJob(Job * job, SoCamera * camera,
+                              const SbViewportRegion & viewport, void * context)
+{
+  if (camera) camera->ref();
+  if (job->camera) job->camera->unref();
+  job->camera = camera;
+  job->viewport = viewport;
+  job->context = context;
+
+  uint32_t cachecontext;
+  auto it = this->cachecontexts.find(context);
+  if (it != this->cachecontexts.end()) {
+    cachecontext = it->second;
+  }
+  else {
+    cachecontext = SoGLCacheContextElement::getUniqueCacheContext();
+    this->cachecontexts[context] = cachecontext;
+  }
+  if (job->action == NULL) {
+    job->action = new SoGLRenderAction(viewport);
+  }
+  if (job->action->getCacheContext() != cachecontext) {
+    job->action->setCacheContext(cachecontext);
+  }
+  this->updateRoot(job);
+}
+
+void
+SoParallelRendererP::updateRoot(Job * job)
+{
+  if (job->root == NULL) {
+    job->root = new SoSeparator;
+    job->root->ref();
+    // the scene graph below is cached on its own, and there is
+    // nothing to gain from caching the camera
+    job->root->renderCaching = SoSeparator::OFF;
+    job->root->boundingBoxCaching = SoSeparator::OFF;
+  }
+  job->root->removeAllChildren();
+  if (job->camera) job->root->addChild(job->camera);
+  if (this->scene) job->root->addChild(this->scene);
+}
+
+void
+SoParallelRendererP::deleteJob(Job * job)
+{
+  if (job->root) job->root->unref();
+  if (job->camera) job->camera->unref();
+  delete job->action;
+  delete job;
+}
+
+int
+SoParallelRendererP::getNumThreadsToUse(void) const
+{
+  if (!SoDB::isMultiThread()) return 1;
+  int num = this->numthreads;
+  if (num <= 0) {
+    num = int(std::thread::hardware_concurrency());
+    if (num <= 0) num = 1;
+  }
+  if (num > this->jobs.getLength()) num = this->jobs.getLength();
+  return num > 0 ? num : 1;
+}
+
+void
+SoParallelRendererP::renderJob(const int idx)
+{
+  Job * job = this->jobs[idx];
+  SoDB::ContextManager * manager = SoDB::getContextManager();
+  if (manager == NULL || job->context == NULL ||
+      !manager->makeContextCurrent(job->context)) {
+    job->ok = FALSE;
+    return;
+  }
+
+  SoDB::readlock();
+
+  // clear only the viewport of the job
+  const SbVec2s origin = job->viewport.getViewportOriginPixels();
+  const SbVec2s size = job->viewport.getViewportSizePixels();
+  glEnable(GL_SCISSOR_TEST);
+  glScissor(origin[0], origin[1], size[0], size[1]);
+  glClearColor(this->bgcolor[0], this->bgcolor[1], this->bgcolor[2], this->bgcolor[3]);
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  glDisable(GL_SCISSOR_TEST);
+
+  // like SoRenderManager and SoOffscreenRenderer, depth testing is
+  // enabled before the scene graph is rendered
+  glEnable(GL_DEPTH_TEST);
+  glMatrixMode(GL_PROJECTION);
+  glLoadIdentity();
+  glMatrixMode(GL_MODELVIEW);
+  glLoadIdentity();
+
+  job->action->setViewportRegion(job->viewport);
+  job->action->apply(job->root);
+
+  if (this->postrendercb) {
+    this->postrendercb(this->postrenderdata, idx, job->action);
+  }
+
+  SoDB::readunlock();
+
+  manager->restorePreviousContext(job->context);
+  job->ok = TRUE;
+}
+
+void
+SoParallelRendererP::runJobs(void)
+{
+  int idx;
+  while ((idx = this->next.fetch_add(1)) < this->jobs.getLength()) {
+    this->renderJob(idx);
+  }
+}
+
+void *
+SoParallelRendererP::workerLoop(void * closure)
+{
+  SoParallelRendererP * thisp = static_cast<SoParallelRendererP *>(closure);
+  unsigned int seen = 0;
+  thisp->workmutex.lock();
+  for (;;) {
+    while (!thisp->quit && thisp->generation == seen) {
+      thisp->workcond.wait(thisp->workmutex);
+    }
+    if (thisp->quit) break;
+    seen = thisp->generation;
+    thisp->workmutex.unlock();
+
+    thisp->runJobs();
+
+    thisp->workmutex.lock();
+    if (--thisp->numactive == 0) thisp->donecond.wakeAll();
+  }
+  thisp->workmutex.unlock();
+  return NULL;
+}
+
+void
+SoParallelRendererP::startWorkers(const int num)
+{
+  for (int i = this->workers.getLength(); i < num; i++) {
+    this->workers.append(SbThread::create(SoParallelRendererP::workerLoop, this));
+  }
+}
+
+void
+SoParallelRendererP::stopWorkers(void)
+{
+  this->workmutex.lock();
+  this->quit = TRUE;
+  this->workcond.wakeAll();
+  this->workmutex.unlock();
+  for (int i = 0; i < this->workers.getLength(); i++) {
+    SbThread::join(this->workers[i]);
+    SbThread::destroy(this->workers[i]);
+  }
+  this->workers.truncate(0);
+  this->quit = FALSE;
+}
+
+// *************************************************************************
+
+/*!
+  Constructor. Jobs must be added with addJob() before anything is
+  rendered.
+*/
+SoParallelRenderer::SoParallelRenderer(void)
+{
+  PRIVATE(this) = new SoParallelRendererP;
+}
+
+/*!
+  Destructor. Stops the worker threads.
+*/
+SoParallelRenderer::~SoParallelRenderer()
+{
+  PRIVATE(this)->stopWorkers();
+  this->removeAllJobs();
+  this->setSceneGraph(NULL);
+  delete PRIVATE(this);
+}
+
+/*!
+  Sets the scene graph to render. It is referenced by the renderer.
+*/
+void
+SoParallelRenderer::setSceneGraph(SoNode * scene)
+{
+  if (scene) scene->ref();
+  if (PRIVATE(this)->scene) PRIVATE(this)->scene->unref();
+  PRIVATE(this)->scene = scene;
+  for (int i = 0; i < PRIVATE(this)->jobs.getLength(); i++) {
+    PRIVATE(this)->updateRoot(PRIVATE(this)->jobs[i]);
+  }
+}
+
+/*!
+  Returns the scene graph.
+*/
+SoNode *
+SoParallelRenderer::getSceneGraph(void) const
+{
+  return PRIVATE(this)->scene;
+}
+
+/*!
+  Adds a job which renders the scene graph with \a camera into \a
+  viewport of the OpenGL \a context, and returns its index. \a context
+  is passed to the SoDB::ContextManager to make it current, and can't
+  be used by other jobs. If \a camera is \c NULL, the scene graph
+  must contain its own camera.
+*/
+int
+SoParallelRenderer::addJob(SoCamera * camera,
+                           const SbViewportRegion & viewport,
+                           void * context)
+{
+  SoParallelRendererP::Job * job = new SoParallelRendererP::Job;
+  job->camera = NULL;
+  job->context = NULL;
+  job->root = NULL;
+  job->action = NULL;
+  job->ok = FALSE;
+  PRIVATE(this)->setupJob(job, camera, viewport, context);
+  PRIVATE(this)->jobs.append(job);
+  return PRIVATE(this)->jobs.getLength() - 1;
+}
+
+/*!
+  Changes the camera, viewport and context of \a job. The render
+  action of the job is kept, and so are its caches if \a context has
+  been used before.
+*/
+void
+SoParallelRenderer::setJob(const int job,
+                           SoCamera * camera,
+                           const SbViewportRegion & viewport,
+                           void * context)
+{
+  assert(job >= 0 && job < PRIVATE(this)->jobs.getLength());
+  PRIVATE(this)->setupJob(PRIVATE(this)->jobs[job], camera, viewport, context);
+}
+
+/*!
+  Removes all jobs.
+*/
+void
+SoParallelRenderer::removeAllJobs(void)
+{
+  for (int i = 0; i < PRIVATE(this)->jobs.getLength(); i++) {
+    PRIVATE(this)->deleteJob(PRIVATE(this)->jobs[i]);
+  }
+  PRIVATE(this)->jobs.truncate(0);
+}
+
+/*!
+  Returns the number of jobs.
+*/
+int
+SoParallelRenderer::getNumJobs(void) const
+{
+  return PRIVATE(this)->jobs.getLength();
+}
+
+/*!
+  Returns the render action used for \a job. It can be used to
+  configure transparency type, smoothing and such for the job.
+*/
+SoGLRenderAction *
+SoParallelRenderer::getGLRenderAction(const int job) const
+{
+  assert(job >= 0 && job < PRIVATE(this)->jobs.getLength());
+  return PRIVATE(this)->jobs[job]->action;
+}
+
+/*!
+  Sets the number of threads used to render, including the calling
+  thread. The default value, 0, uses one thread per processor. No more
+  threads than there are jobs are used.
+*/
+void
+SoParallelRenderer::setNumThreads(const int num)
+{
+  if (num == PRIVATE(this)->numthreads) return;
+  PRIVATE(this)->stopWorkers();
+  PRIVATE(this)->numthreads = num;
+}
+
+/*!
+  Returns the number of threads set with setNumThreads().
+*/
+int
+SoParallelRenderer::getNumThreads(void) const
+{
+  return PRIVATE(this)->numthreads;
+}
+
+/*!
+  Sets the color the viewport of each job is cleared to before
+  rendering. The default is transparent black.
+*/
+void
+SoParallelRenderer::setBackgroundColor(const SbColor4f & color)
+{
+  PRIVATE(this)->bgcolor = color;
+}
+
+/*!
+  Returns the background color.
+*/
+const SbColor4f &
+SoParallelRenderer::getBackgroundColor(void) const
+{
+  return PRIVATE(this)->bgcolor;
+}
+
+/*!
+  Sets a callback which is called after each job has been rendered,
+  in the thread which rendered it and with the context of the job
+  still current. Calls for different jobs may happen at the same time.
+*/
+void
+SoParallelRenderer::setPostRenderCallback(JobCB * func, void * userdata)
+{
+  PRIVATE(this)->postrendercb = func;
+  PRIVATE(this)->postrenderdata = userdata;
+}
+
+/*!
+  Renders all jobs, and returns when they are done. Returns \c FALSE
+  if the context of any job could not be made current, or if two jobs
+  use the same context.
+*/
+SbBool
+SoParallelRenderer::render(void)
+{
+  const int numjobs = PRIVATE(this)->jobs.getLength();
+  if (numjobs == 0) return TRUE;
+
+  for (int i = 0; i < numjobs; i++) {
+    for (int j = i + 1; j < numjobs; j++) {
+      if (PRIVATE(this)->jobs[i]->context == PRIVATE(this)->jobs[j]->context) {
+        SoDebugError::postWarning("SoParallelRenderer::render",
+                                  "jobs %d and %d use the same context", i, j);
+        return FALSE;
+      }
+    }
+  }
+
+  const int numworkers = PRIVATE(this)->getNumThreadsToUse() - 1;
+  PRIVATE(this)->next = 0;
+  if (numworkers == 0) {
+    PRIVATE(this)->runJobs();
+  }
+  else {
+    PRIVATE(this)->startWorkers(numworkers);
+    PRIVATE(this)->workmutex.lock();
+    PRIVATE(this)->numactive = PRIVATE(this)->workers.getLength();
+    PRIVATE(this)->generation++;
+    PRIVATE(this)->workcond.wakeAll();
+    PRIVATE(this)->workmutex.unlock();
+
+    PRIVATE(this)->runJobs();
+
+    PRIVATE(this)->workmutex.lock();
+    while (PRIVATE(this)->numactive > 0) {
+      PRIVATE(this)->donecond.wait(PRIVATE(this)->workmutex);
+    }
+    PRIVATE(this)->workmutex.unlock();
+  }
+
+  SbBool ok = TRUE;
+  for (int i = 0; i < numjobs; i++) {
+    if (!PRIVATE(this)->jobs[i]->ok) ok = FALSE;
+  }
+  return ok;
+}
+
+#undef PRIVATE
@@ -258,6 +258,7 @@ SoRenderManager::SoRenderManager(void)
   PRIVATE(this)->superimpositions = NULL;
 
   PRIVATE(this)->doublebuffer = TRUE;
+  PRIVATE(this)->backbufferpreserved = FALSE;
   PRIVATE(this)->deleteglaction = TRUE;
   PRIVATE(this)->isactive = TRUE;
   PRIVATE(this)->texturesenabled = TRUE;
@@ -706,6 +707,24 @@ SoRenderManager::actuallyRender(SoGLRenderAction * action,
   if (clearwindow) mask |= GL_COLOR_BUFFER_BIT;
   if (clearzbuffer) mask |= GL_DEPTH_BUFFER_BIT;
 
+  // a progressive frame continues on top of the previous one, which
+  // is only possible if the buffer still holds it
+  const SbBool progressive = action->isProgressiveRendering() &&
+    this->getStereoMode() == SoRenderManager::MONO;
+  const SbBool continueframe = progressive &&
+    (!this->isDoubleBuffer() || this->isBackBufferPreserved());
+  SbTime progressivebudget;
+  if (progressive && !continueframe) {
+    // the back buffer is undefined after a swap, so render the whole
+    // frame at once
+    if (action->isProgressiveRenderingPending()) {
+      action->restartProgressiveRendering();
+    }
+    progressivebudget = action->getProgressiveTimeBudget();
+    action->setProgressiveTimeBudget(SbTime::maxTime());
+  }
+  if (continueframe && action->isProgressiveRenderingPending()) mask = 0;
+
   if (initmatrices) {
     glMatrixMode(GL_PROJECTION);
     glLoadIdentity();
@@ -732,6 +751,12 @@ SoRenderManager::actuallyRender(SoGLRenderAction * action,
   if (PRIVATE(this)->scene) {
     this->renderScene(action, PRIVATE(this)->scene, (uint32_t) mask);
   }
+  if (progressive && !continueframe) {
+    action->setProgressiveTimeBudget(progressivebudget);
+  }
+  if (continueframe && action->isProgressiveRenderingPending()) {
+    this->scheduleRedraw();
+  }
 
   // Automatically re-triggers rendering if any animation stuff is
   // connected to the realTime field.
@@ -1395,6 +1420,39 @@ SoRenderManager::isDoubleBuffer(void) const
   return PRIVATE(this)->doublebuffer;
 }
 
+/*!
+  Tell the scene manager that the back buffer keeps its contents when
+  the buffers are swapped. This is the case when rendering to a frame
+  buffer object, or with an EGL surface created with
+  EGL_BUFFER_PRESERVED swap behavior, for instance. Default is \c FALSE.
+
+  Progressive rendering (see SoGLRenderAction::setProgressiveRendering())
+  continues an unfinished frame on top of the previous one, so it is
+  only done with single buffering or when the back buffer is
+  preserved. Otherwise, each frame is rendered completely.
+
+  \sa setDoubleBuffer()
+  \since Coin 4.1
+*/
+void
+SoRenderManager::setBackBufferPreserved(const SbBool onoff)
+{
+  PRIVATE(this)->backbufferpreserved = onoff;
+}
+
+/*!
+  Returns whether the back buffer keeps its contents when the buffers
+  are swapped.
+
+  \sa setBackBufferPreserved()
+  \since Coin 4.1
+*/
+SbBool
+SoRenderManager::isBackBufferPreserved(void) const
+{
+  return PRIVATE(this)->backbufferpreserved;
+}
+
 /*!
   Set the callback function \a f to invoke when rendering the
   scene. \a userdata will be passed as the first argument of the
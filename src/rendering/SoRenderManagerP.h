@@ -89,6 +89,7 @@ public:
   SoCamera * camera;
   float nearplanevalue;
   SbBool doublebuffer;
+  SbBool backbufferpreserved;
   SbBool isactive;
   float stereooffset;
   SoInfo * dummynode;
@@ -0,0 +1,274 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+
+/*!
+  \class SoRenderStatistics SoRenderStatistics.h Inventor/misc/SoRenderStatistics.h
+  \brief The SoRenderStatistics class counts the OpenGL work done while rendering.
+
+  The counters are always enabled, and cheap enough to be left on in
+  production builds: each counted event is a single increment of a
+  per thread counter. Unlike SoProfiler, nothing is timed and nothing
+  is recorded per node.
+
+  The statistics for the last frame rendered by an SoGLRenderAction
+  are available from SoGLRenderAction::getRenderStatistics():
+
+  \code
+  const SoRenderStatistics & stats = renderaction->getRenderStatistics();
+  printf("%llu draw calls, %llu triangles, %llu cache hits\n",
+         (unsigned long long) stats.getCount(SoRenderStatistics::DRAW_CALLS),
+         (unsigned long long) stats.getCount(SoRenderStatistics::TRIANGLES),
+         (unsigned long long) stats.getCount(SoRenderStatistics::RENDER_CACHE_HITS));
+  \endcode
+
+  The running totals for the calling thread are returned by
+  getThreadTotals(), for measuring other intervals than single frames.
+
+  Draw calls and triangles are counted for geometry rendered from
+  vertex arrays and buffer objects, and for the immediate mode
+  rendering of the built-in face sets, triangle strip sets, cones,
+  cubes, cylinders and spheres, where each glBegin()/glEnd() block
+  counts as a draw call. Lines and points rendered in immediate mode
+  are not counted. Calling a render cache counts the draw calls,
+  triangles and texture binds which were counted when its display
+  list was recorded.
+
+  \since Coin 4.1
+*/
+
+/*!
+  \enum SoRenderStatistics::Counter
+
+  The events counted.
+*/
+
+/*!
+  \var SoRenderStatistics::Counter SoRenderStatistics::DRAW_CALLS
+
+  glDrawArrays(), glDrawElements() and related calls, and
+  glBegin()/glEnd() blocks rendering triangles. A multi draw call is
+  counted once per primitive list.
+*/
+
+/*!
+  \var SoRenderStatistics::Counter SoRenderStatistics::TRIANGLES
+
+  Triangles rendered by the counted draw calls. Quads and polygons are
+  counted as the triangles they would be split into.
+*/
+
+/*!
+  \var SoRenderStatistics::Counter SoRenderStatistics::LAZY_ELEMENT_SENDS
+
+  Calls to SoGLLazyElement::send(), which updates the OpenGL material
+  and blending state before shapes are rendered.
+*/
+
+/*!
+  \var SoRenderStatistics::Counter SoRenderStatistics::TEXTURE_BINDS
+
+  Texture objects bound.
+*/
+
+/*!
+  \var SoRenderStatistics::Counter SoRenderStatistics::BUFFER_BINDS
+
+  Vertex and index buffer objects bound.
+*/
+
+/*!
+  \var SoRenderStatistics::Counter SoRenderStatistics::DISPLAY_LIST_CALLS
+
+  Display lists executed.
+*/
+
+/*!
+  \var SoRenderStatistics::Counter SoRenderStatistics::RENDER_CACHE_HITS
+
+  Render caches (see SoGLCacheList) executed instead of traversing the
+  scene graph below them.
+*/
+
+/*!
+  \var SoRenderStatistics::Counter SoRenderStatistics::RENDER_CACHE_MISSES
+
+  Traversals of nodes holding render caches where none of the caches
+  could be used.
+*/
+
+/*!
+  \var SoRenderStatistics::Counter SoRenderStatistics::RENDER_CACHES_CREATED
+
+  Render caches recorded.
+*/
+
+#include <Inventor/misc/SoRenderStatistics.h>
+#include "rendering/SoRenderStatisticsP.h"
+
+#include <cassert>
+
+thread_local uint64_t SoRenderStatisticsP::totals[SoRenderStatistics::NUM_COUNTERS];
+
+/*!
+  Constructor. All counters are set to 0.
+*/
+SoRenderStatistics::SoRenderStatistics(void)
+{
+  this->reset();
+}
+
+/*!
+  Returns the value of \a counter.
+*/
+uint64_t
+SoRenderStatistics::getCount(const Counter counter) const
+{
+  assert(counter >= 0 && counter < NUM_COUNTERS);
+  return this->counts[counter];
+}
+
+/*!
+  Sets all counters to 0.
+*/
+void
+SoRenderStatistics::reset(void)
+{
+  for (int i = 0; i < NUM_COUNTERS; i++) this->counts[i] = 0;
+}
+
+/*!
+  Adds the counters in \a stats to these.
+*/
+SoRenderStatistics &
+SoRenderStatistics::operator+=(const SoRenderStatistics & stats)
+{
+  for (int i = 0; i < NUM_COUNTERS; i++) this->counts[i] += stats.counts[i];
+  return *this;
+}
+
+/*!
+  Subtracts the counters in \a stats from these. Used to find what
+  was counted between two calls to getThreadTotals().
+*/
+SoRenderStatistics &
+SoRenderStatistics::operator-=(const SoRenderStatistics & stats)
+{
+  for (int i = 0; i < NUM_COUNTERS; i++) this->counts[i] -= stats.counts[i];
+  return *this;
+}
+
+/*!
+  Sets \a stats to the totals counted in the calling thread since it
+  was started.
+*/
+void
+SoRenderStatistics::getThreadTotals(SoRenderStatistics & stats)
+{
+  for (int i = 0; i < NUM_COUNTERS; i++) {
+    stats.counts[i] = SoRenderStatisticsP::totals[i];
+  }
+}
+
+/*!
+  Returns the name of \a counter, e.g. "DRAW_CALLS".
+*/
+const char *
+SoRenderStatistics::getCounterName(const Counter counter)
+{
+  static const char * const names[NUM_COUNTERS] = {
+    "DRAW_CALLS",
+    "TRIANGLES",
+    "LAZY_ELEMENT_SENDS",
+    "TEXTURE_BINDS",
+    "BUFFER_BINDS",
+    "DISPLAY_LIST_CALLS",
+    "RENDER_CACHE_HITS",
+    "RENDER_CACHE_MISSES",
+    "RENDER_CACHES_CREATED"
+  };
+  assert(counter >= 0 && counter < NUM_COUNTERS);
+  return names[counter];
+}
+
+// *************************************************************************
+
+void
+SoRenderStatisticsP::countDraw(const GLenum mode, const GLsizei numvertices)
+{
+  totals[SoRenderStatistics::DRAW_CALLS]++;
+  if (numvertices < 3) return;
+
+  uint64_t numtriangles = 0;
+  switch (mode) {
+  case GL_TRIANGLES:
+    numtriangles = numvertices / 3;
+    break;
+  case GL_TRIANGLE_STRIP:
+  case GL_TRIANGLE_FAN:
+  case GL_POLYGON:
+  case GL_QUAD_STRIP:
+    numtriangles = numvertices - 2;
+    break;
+  case GL_QUADS:
+    numtriangles = (numvertices / 4) * 2;
+    break;
+  default:
+    break;
+  }
+  totals[SoRenderStatistics::TRIANGLES] += numtriangles;
+}
+
+void
+SoRenderStatisticsP::beginRecording(SoRenderStatistics & recorded)
+{
+  SoRenderStatistics::getThreadTotals(recorded);
+}
+
+void
+SoRenderStatisticsP::endRecording(SoRenderStatistics & recorded)
+{
+  SoRenderStatistics start = recorded;
+  SoRenderStatistics::getThreadTotals(recorded);
+  recorded -= start;
+}
+
+// Only the OpenGL commands stored in the display list are replayed.
+// Buffer bindings are not stored, since vertex arrays are copied into
+// the list when it is compiled.
+void
+SoRenderStatisticsP::replay(const SoRenderStatistics & recorded)
+{
+  totals[SoRenderStatistics::DRAW_CALLS] += recorded.counts[SoRenderStatistics::DRAW_CALLS];
+  totals[SoRenderStatistics::TRIANGLES] += recorded.counts[SoRenderStatistics::TRIANGLES];
+  totals[SoRenderStatistics::TEXTURE_BINDS] += recorded.counts[SoRenderStatistics::TEXTURE_BINDS];
+}
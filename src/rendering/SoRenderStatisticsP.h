@@ -0,0 +1,69 @@
+#ifndef COIN_SORENDERSTATISTICSP_H
+#define COIN_SORENDERSTATISTICSP_H
+
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+#ifndef COIN_INTERNAL
+#error this is a private header file
+#endif /* !COIN_INTERNAL */
+
+
+#include <Inventor/misc/SoRenderStatistics.h>
+#include <Inventor/system/gl.h>
+
+// Counters for SoRenderStatistics, updated from the places in the
+// rendering code where the counted work is done. The totals are kept
+// per thread, so counting is just an increment, and each render
+// thread (see SoParallelRenderer) only sees its own work.
+class SoRenderStatisticsP {
+public:
+  static void count(const SoRenderStatistics::Counter counter,
+                    const uint64_t num = 1) {
+    totals[counter] += num;
+  }
+
+  // counts a draw call, and the triangles it renders
+  static void countDraw(const GLenum mode, const GLsizei numvertices);
+
+  // Display lists record what was counted while they were compiled,
+  // and add the counters describing OpenGL work when called.
+  // beginRecording() stores the current totals in \a recorded, and
+  // endRecording() replaces them with what was counted since.
+  static void beginRecording(SoRenderStatistics & recorded);
+  static void endRecording(SoRenderStatistics & recorded);
+  static void replay(const SoRenderStatistics & recorded);
+
+  static thread_local uint64_t totals[SoRenderStatistics::NUM_COUNTERS];
+};
+
+#endif // COIN_SORENDERSTATISTICSP_H
@@ -0,0 +1,728 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+
+/*!
+  \class SoTilePyramid
+  \brief The SoTilePyramid class reads tiles from a mipmap pyramid file on demand.
+
+  Used by SoGLBigImage for images that are too large to be kept in
+  memory. See SoGLBigImage::writeTilePyramid() for the file layout.
+
+  Tiles are read by a loader thread. Requests from the most recent
+  frame are served first, then coarser levels before finer ones, so
+  that the whole view is refined evenly, and finally tiles that cover
+  more of the screen. Requests that are not repeated in the next
+  frame are dropped.
+
+  The read tiles are kept in a least recently used cache of
+  getCacheSize() bytes per pyramid. The default is 64 MB, and can be
+  set with the COIN_BIGIMAGE_TILE_CACHE environment variable (in MB).
+*/
+
+#include "rendering/SoTilePyramid.h"
+
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+
+#include <Inventor/SbBasic.h>
+#include <Inventor/errors/SoDebugError.h>
+
+#include "misc/SoEnvironment.h"
+
+#define TILEPYRAMID_HEADERSIZE 32
+
+static const char sotilepyramid_magic[8] = { 'C', 'O', 'I', 'N', 'T', 'P', 'Y', '1' };
+
+static size_t &
+sotilepyramid_cachesize(void)
+{
+  static size_t cachesize = [] {
+    const char * env = CoinInternal::getEnvironmentVariableRaw("COIN_BIGIMAGE_TILE_CACHE");
+    return env ? size_t(atof(env) * 1024.0 * 1024.0) : size_t(64) * 1024 * 1024;
+  }();
+  return cachesize;
+}
+
+static int
+sotilepyramid_seek(FILE * fp, const uint64_t offset, const int whence)
+{
+#ifdef _WIN32
+  return _fseeki64(fp, (__int64) offset, whence);
+#else // !_WIN32
+  return fseeko(fp, (off_t) offset, whence);
+#endif // !_WIN32
+}
+
+static uint64_t
+sotilepyramid_tell(FILE * fp)
+{
+#ifdef _WIN32
+  return (uint64_t) _ftelli64(fp);
+#else // !_WIN32
+  return (uint64_t) ftello(fp);
+#endif // !_WIN32
+}
+
+static int
+sotilepyramid_numlevels(const SbVec2i32 & size, const int tilesize)
+{
+  int w = size[0];
+  int h = size[1];
+  int n = 1;
+  while (w > tilesize || h > tilesize) {
+    w = SbMax(w >> 1, 1);
+    h = SbMax(h >> 1, 1);
+    n++;
+  }
+  return n;
+}
+
+static inline uint64_t
+sotilepyramid_key(const int level, const SbVec2i32 & tile)
+{
+  return (uint64_t(level) << 48) | (uint64_t(tile[1]) << 24) | uint64_t(tile[0]);
+}
+
+static SbVec2i32
+sotilepyramid_levelsize(const SbVec2i32 & size, const int level)
+{
+  return SbVec2i32(SbMax(size[0] >> level, 1), SbMax(size[1] >> level, 1));
+}
+
+// computes the file offset of each level, and returns the file size
+static uint64_t
+sotilepyramid_leveloffsets(const SbVec2i32 & size, const int nc,
+                           const int tilesize, const int numlevels,
+                           std::vector<uint64_t> & offsets)
+{
+  const uint64_t tilebytes = uint64_t(tilesize) * tilesize * nc;
+  uint64_t offset = TILEPYRAMID_HEADERSIZE;
+  offsets.resize(numlevels);
+  for (int l = 0; l < numlevels; l++) {
+    const SbVec2i32 ls = sotilepyramid_levelsize(size, l);
+    offsets[l] = offset;
+    offset += uint64_t((ls[0] + tilesize - 1) / tilesize) *
+      uint64_t((ls[1] + tilesize - 1) / tilesize) * tilebytes;
+  }
+  return offset;
+}
+
+// halves two rows with a 2x2 box filter. An odd width repeats the
+// last column.
+static void
+sotilepyramid_downsample(const unsigned char * row0, const unsigned char * row1,
+                         const int srcwidth, const int nc,
+                         unsigned char * dst, const int dstwidth)
+{
+  for (int x = 0; x < dstwidth; x++) {
+    const int x0 = SbMin(2*x, srcwidth-1) * nc;
+    const int x1 = SbMin(2*x+1, srcwidth-1) * nc;
+    for (int c = 0; c < nc; c++) {
+      *dst++ = (unsigned char)
+        ((row0[x0+c] + row0[x1+c] + row1[x0+c] + row1[x1+c] + 2) >> 2);
+    }
+  }
+}
+
+// one level of a pyramid file being written. Only the current row of
+// tiles is kept, so writing needs about two rows of level 0 tiles in
+// memory, whatever the image height.
+struct sotilepyramid_level {
+  SbVec2i32 size;
+  uint64_t offset; // of the next row of tiles
+  int numrows; // rows received
+  std::vector<unsigned char> band; // the current row of tiles
+  std::vector<unsigned char> pending; // even row waiting for the next
+  std::vector<unsigned char> halved; // row passed to the next level
+};
+
+// writes the current row of tiles of a level, with numrows rows.
+// Edge tiles repeat the last column/row.
+static SbBool
+sotilepyramid_writeband(FILE * out, sotilepyramid_level & level,
+                        const int nc, const int tilesize, const int numrows,
+                        std::vector<unsigned char> & tile)
+{
+  if (sotilepyramid_seek(out, level.offset, SEEK_SET) != 0) return FALSE;
+  const size_t srcrow = size_t(level.size[0]) * nc;
+  const size_t tilerow = size_t(tilesize) * nc;
+  const int numtx = (level.size[0] + tilesize - 1) / tilesize;
+  for (int tx = 0; tx < numtx; tx++) {
+    const int x0 = tx * tilesize;
+    const int w = SbMin(tilesize, level.size[0] - x0);
+    unsigned char * dst = &tile[0];
+    for (int y = 0; y < tilesize; y++) {
+      const unsigned char * row = &level.band[srcrow * SbMin(y, numrows - 1)];
+      memcpy(dst, row + size_t(x0) * nc, size_t(w) * nc);
+      for (int x = w; x < tilesize; x++) {
+        memcpy(dst + x * nc, row + srcrow - nc, nc);
+      }
+      dst += tilerow;
+    }
+    if (fwrite(&tile[0], 1, tile.size(), out) != tile.size()) return FALSE;
+  }
+  level.offset += uint64_t(numtx) * tile.size();
+  return TRUE;
+}
+
+// adds the next row, from the bottom, to level l, and the halved rows
+// to the levels after it
+static SbBool
+sotilepyramid_addrow(FILE * out, std::vector<sotilepyramid_level> & levels,
+                     const int l, const unsigned char * row,
+                     const int nc, const int tilesize,
+                     std::vector<unsigned char> & tile)
+{
+  sotilepyramid_level & level = levels[l];
+  const size_t rowbytes = size_t(level.size[0]) * nc;
+  const int y = level.numrows++;
+  const int iy = y % tilesize;
+  memcpy(&level.band[rowbytes * iy], row, rowbytes);
+  if (iy == tilesize - 1 || level.numrows == level.size[1]) {
+    if (!sotilepyramid_writeband(out, level, nc, tilesize, iy + 1, tile)) return FALSE;
+  }
+  if (l + 1 == int(levels.size())) return TRUE;
+
+  // row y of the next level is made from rows 2y and 2y+1. A single
+  // row is repeated, and the last row of an odd height is dropped.
+  sotilepyramid_level & next = levels[l + 1];
+  const unsigned char * row0 = row;
+  if ((y & 1) == 0) {
+    if (y / 2 >= next.size[1]) return TRUE;
+    if (y + 1 < level.size[1]) {
+      level.pending.assign(row, row + rowbytes);
+      return TRUE;
+    }
+  }
+  else {
+    row0 = &level.pending[0];
+  }
+  sotilepyramid_downsample(row0, row, level.size[0], nc,
+                           &level.halved[0], next.size[0]);
+  return sotilepyramid_addrow(out, levels, l + 1, &level.halved[0], nc, tilesize, tile);
+}
+
+// reads rows from an image in memory
+struct sotilepyramid_image {
+  const unsigned char * bytes;
+  size_t rowbytes;
+};
+
+static SbBool
+sotilepyramid_readimagerow(void * closure, const int row, unsigned char * dst)
+{
+  const sotilepyramid_image * image = static_cast<sotilepyramid_image *>(closure);
+  memcpy(dst, image->bytes + image->rowbytes * row, image->rowbytes);
+  return TRUE;
+}
+
+// *************************************************************************
+
+SoTilePyramid::SoTilePyramid(void)
+  : fp(NULL),
+    size(0, 0),
+    numcomponents(0),
+    tilesize(0),
+    numlevels(0),
+    loader(NULL),
+    quit(FALSE),
+    loading(FALSE),
+    frame(0),
+    numcachedbytes(0)
+{
+}
+
+SoTilePyramid::~SoTilePyramid()
+{
+  if (this->loader) {
+    this->mutex.lock();
+    this->quit = TRUE;
+    this->requestcond.wakeAll();
+    this->mutex.unlock();
+    SbThread::join(this->loader);
+    SbThread::destroy(this->loader);
+  }
+  for (auto & it : this->tiles) delete it.second;
+  if (this->fp) fclose(this->fp);
+}
+
+/*!
+  Writes \a bytes, an image of \a size pixels with \a numcomponents
+  components, to a pyramid file with tiles of \a tilesize x \a
+  tilesize pixels. \a tilesize must be a power of two. Returns \c
+  FALSE if the file could not be written.
+*/
+SbBool
+SoTilePyramid::writeFile(const char * filename,
+                         const unsigned char * bytes,
+                         const SbVec2i32 & size,
+                         const int numcomponents,
+                         const int tilesize)
+{
+  if (bytes == NULL) return FALSE;
+  sotilepyramid_image image;
+  image.bytes = bytes;
+  image.rowbytes = size_t(SbMax(size[0], 0)) * numcomponents;
+  return SoTilePyramid::writeFile(filename, size, numcomponents, tilesize,
+                                  sotilepyramid_readimagerow, &image);
+}
+
+/*!
+  Writes an image of \a size pixels with \a numcomponents components
+  to a pyramid file, reading one row at a time from \a readrow,
+  bottom row first. Returns \c FALSE if the file could not be
+  written, or if \a readrow returned \c FALSE.
+*/
+SbBool
+SoTilePyramid::writeFile(const char * filename,
+                         const SbVec2i32 & size,
+                         const int numcomponents,
+                         const int tilesize,
+                         ReadRowCB * readrow,
+                         void * closure)
+{
+  const int nc = numcomponents;
+  if (readrow == NULL || size[0] < 1 || size[1] < 1 || nc < 1 || nc > 4 ||
+      tilesize < 1 || (tilesize & (tilesize - 1))) return FALSE;
+
+  FILE * out = fopen(filename, "wb");
+  if (out == NULL) return FALSE;
+
+  const int numlevels = sotilepyramid_numlevels(size, tilesize);
+  const int32_t header[6] = { 1, size[0], size[1], nc, tilesize, numlevels };
+  SbBool ok =
+    fwrite(sotilepyramid_magic, 1, 8, out) == 8 &&
+    fwrite(header, sizeof(int32_t), 6, out) == 6;
+
+  std::vector<uint64_t> offsets;
+  (void) sotilepyramid_leveloffsets(size, nc, tilesize, numlevels, offsets);
+  std::vector<sotilepyramid_level> levels(numlevels);
+  for (int l = 0; l < numlevels; l++) {
+    sotilepyramid_level & level = levels[l];
+    level.size = sotilepyramid_levelsize(size, l);
+    level.offset = offsets[l];
+    level.numrows = 0;
+    level.band.resize(size_t(level.size[0]) * nc * SbMin(tilesize, level.size[1]));
+    if (l + 1 < numlevels) {
+      level.halved.resize(size_t(sotilepyramid_levelsize(size, l + 1)[0]) * nc);
+    }
+  }
+
+  std::vector<unsigned char> tile(size_t(tilesize) * tilesize * nc);
+  std::vector<unsigned char> row(size_t(size[0]) * nc);
+  for (int y = 0; ok && y < size[1]; y++) {
+    ok = readrow(closure, y, &row[0]) &&
+      sotilepyramid_addrow(out, levels, 0, &row[0], nc, tilesize, tile);
+  }
+  if (fclose(out) != 0) ok = FALSE;
+  return ok;
+}
+
+/*!
+  Returns \c TRUE if \a filename starts with the pyramid file magic
+  number.
+*/
+SbBool
+SoTilePyramid::isPyramidFile(const char * filename)
+{
+  FILE * in = fopen(filename, "rb");
+  if (in == NULL) return FALSE;
+  char magic[8];
+  const SbBool ret = fread(magic, 1, 8, in) == 8 &&
+    memcmp(magic, sotilepyramid_magic, 8) == 0;
+  fclose(in);
+  return ret;
+}
+
+/*!
+  Opens \a filename, reads the last level, and starts the loader
+  thread. Returns \c FALSE if the file is not a valid pyramid file.
+*/
+SbBool
+SoTilePyramid::open(const char * filename)
+{
+  assert(this->fp == NULL && "pyramid already opened");
+
+  FILE * in = fopen(filename, "rb");
+  if (in == NULL) return FALSE;
+
+  char magic[8];
+  int32_t header[6];
+  if (fread(magic, 1, 8, in) != 8 ||
+      memcmp(magic, sotilepyramid_magic, 8) != 0 ||
+      fread(header, sizeof(int32_t), 6, in) != 6) {
+    fclose(in);
+    return FALSE;
+  }
+  if (header[0] != 1) {
+    SoDebugError::post("SoTilePyramid::open",
+                       "'%s' was written on a platform with another byte order",
+                       filename);
+    fclose(in);
+    return FALSE;
+  }
+
+  const SbVec2i32 filesize(header[1], header[2]);
+  const int nc = header[3];
+  const int tsize = header[4];
+  if (filesize[0] < 1 || filesize[1] < 1 || nc < 1 || nc > 4 ||
+      tsize < 1 || tsize > 8192 || (tsize & (tsize - 1)) ||
+      header[5] != sotilepyramid_numlevels(filesize, tsize)) {
+    SoDebugError::post("SoTilePyramid::open", "Invalid header in '%s'", filename);
+    fclose(in);
+    return FALSE;
+  }
+
+  this->size = filesize;
+  this->numcomponents = nc;
+  this->tilesize = tsize;
+  this->numlevels = header[5];
+
+  const uint64_t offset =
+    sotilepyramid_leveloffsets(filesize, nc, tsize, this->numlevels, this->leveloffset);
+  if (sotilepyramid_seek(in, 0, SEEK_END) != 0 ||
+      sotilepyramid_tell(in) < offset) {
+    SoDebugError::post("SoTilePyramid::open", "'%s' is truncated", filename);
+    fclose(in);
+    return FALSE;
+  }
+  this->fp = in;
+
+  // the last level is a single tile, kept so that there is always
+  // something to render
+  Tile * tile = new Tile;
+  tile->key = sotilepyramid_key(this->numlevels - 1, SbVec2i32(0, 0));
+  tile->pinned = TRUE;
+  if (!this->readTile(this->numlevels - 1, SbVec2i32(0, 0), tile->data)) {
+    delete tile;
+    fclose(this->fp);
+    this->fp = NULL;
+    return FALSE;
+  }
+  this->tiles[tile->key] = tile;
+  this->numcachedbytes += tile->data.size();
+
+  this->loader = SbThread::create(SoTilePyramid::loaderLoop, this);
+  return TRUE;
+}
+
+/*!
+  Returns the size of \a level. Level 0 is the full resolution image.
+*/
+SbVec2i32
+SoTilePyramid::getLevelSize(const int level) const
+{
+  return sotilepyramid_levelsize(this->size, level);
+}
+
+// returns the range of tiles covering a region of a level
+static void
+sotilepyramid_tilerange(const SbVec2i32 & levelsize, const int tilesize,
+                        const SbVec2i32 & origin, const SbVec2i32 & regionsize,
+                        SbVec2i32 & tile0, SbVec2i32 & tile1)
+{
+  for (int i = 0; i < 2; i++) {
+    tile0[i] = SbClamp(origin[i], 0, levelsize[i] - 1) / tilesize;
+    tile1[i] = SbClamp(origin[i] + regionsize[i] - 1, 0, levelsize[i] - 1) / tilesize;
+  }
+}
+
+/*!
+  Copies the region of \a level at \a origin with size \a regionsize
+  into \a dst. Pixels outside the level repeat the edge pixels.
+  Returns \c FALSE, without copying anything, if some of the tiles
+  haven't been read yet.
+*/
+SbBool
+SoTilePyramid::getRegion(const int level,
+                         const SbVec2i32 & origin,
+                         const SbVec2i32 & regionsize,
+                         unsigned char * dst)
+{
+  assert(level >= 0 && level < this->numlevels);
+  const SbVec2i32 levelsize = this->getLevelSize(level);
+  const int nc = this->numcomponents;
+  const int tsize = this->tilesize;
+  SbVec2i32 tile0, tile1;
+  sotilepyramid_tilerange(levelsize, tsize, origin, regionsize, tile0, tile1);
+
+  this->mutex.lock();
+  if (!this->isResident(level, tile0, tile1)) {
+    this->mutex.unlock();
+    return FALSE;
+  }
+
+  for (int y = 0; y < regionsize[1]; y++) {
+    const int sy = SbClamp(origin[1] + y, 0, levelsize[1] - 1);
+    const int ty = sy / tsize;
+    const int iy = sy % tsize;
+    int x = 0;
+    while (x < regionsize[0]) {
+      const int px = origin[0] + x;
+      const int sx = SbClamp(px, 0, levelsize[0] - 1);
+      const int ix = sx % tsize;
+      const Tile * tile =
+        this->tiles.find(sotilepyramid_key(level, SbVec2i32(sx / tsize, ty)))->second;
+      // copy up to the tile edge, or one pixel at a time when clamped
+      const int n = (px != sx) ? 1 :
+        SbMin(regionsize[0] - x, SbMin(tsize - ix, levelsize[0] - sx));
+      memcpy(dst, &tile->data[(size_t(iy) * tsize + ix) * nc], size_t(n) * nc);
+      dst += n * nc;
+      x += n;
+    }
+  }
+
+  for (int ty = tile0[1]; ty <= tile1[1]; ty++) {
+    for (int tx = tile0[0]; tx <= tile1[0]; tx++) {
+      Tile * tile = this->tiles.find(sotilepyramid_key(level, SbVec2i32(tx, ty)))->second;
+      if (!tile->pinned) {
+        this->lrulist.splice(this->lrulist.end(), this->lrulist, tile->lru);
+      }
+    }
+  }
+  this->mutex.unlock();
+  return TRUE;
+}
+
+/*!
+  Asks the loader thread to read the tiles covering a region of \a
+  level. Tiles covering a larger part of the screen should be given
+  a higher \a priority.
+*/
+void
+SoTilePyramid::request(const int level,
+                       const SbVec2i32 & origin,
+                       const SbVec2i32 & regionsize,
+                       const float priority)
+{
+  if (this->loader == NULL) return;
+  assert(level >= 0 && level < this->numlevels);
+  SbVec2i32 tile0, tile1;
+  sotilepyramid_tilerange(this->getLevelSize(level), this->tilesize,
+                          origin, regionsize, tile0, tile1);
+
+  SbBool added = FALSE;
+  this->mutex.lock();
+  for (int ty = tile0[1]; ty <= tile1[1]; ty++) {
+    for (int tx = tile0[0]; tx <= tile1[0]; tx++) {
+      const SbVec2i32 t(tx, ty);
+      const uint64_t key = sotilepyramid_key(level, t);
+      if (this->tiles.find(key) != this->tiles.end()) continue;
+      auto ins = this->requests.emplace(key, Request());
+      Request & r = ins.first->second;
+      if (ins.second || r.frame != this->frame) {
+        r.level = level;
+        r.tile = t;
+        r.frame = this->frame;
+        r.priority = priority;
+        added = TRUE;
+      }
+      else if (priority > r.priority) {
+        r.priority = priority;
+      }
+    }
+  }
+  if (added) this->requestcond.wakeOne();
+  this->mutex.unlock();
+}
+
+/*!
+  Should be called once per frame. Drops the requests that were not
+  repeated in the last frame.
+*/
+void
+SoTilePyramid::newFrame(void)
+{
+  this->mutex.lock();
+  this->frame++;
+  for (auto it = this->requests.begin(); it != this->requests.end(); ) {
+    if (it->second.frame + 1 < this->frame) it = this->requests.erase(it);
+    else ++it;
+  }
+  this->mutex.unlock();
+}
+
+/*!
+  Returns \c TRUE if the loader thread has tiles to read.
+*/
+SbBool
+SoTilePyramid::hasPendingRequests(void)
+{
+  this->mutex.lock();
+  const SbBool ret = !this->requests.empty() || this->loading;
+  this->mutex.unlock();
+  return ret;
+}
+
+/*!
+  Returns the number of bytes in the tile cache.
+*/
+size_t
+SoTilePyramid::getNumCachedBytes(void)
+{
+  this->mutex.lock();
+  const size_t ret = this->numcachedbytes;
+  this->mutex.unlock();
+  return ret;
+}
+
+/*!
+  Sets the tile cache size in bytes, for each pyramid.
+*/
+void
+SoTilePyramid::setCacheSize(const size_t numbytes)
+{
+  sotilepyramid_cachesize() = numbytes;
+}
+
+/*!
+  Returns the tile cache size in bytes.
+*/
+size_t
+SoTilePyramid::getCacheSize(void)
+{
+  return sotilepyramid_cachesize();
+}
+
+uint64_t
+SoTilePyramid::tileOffset(const int level, const SbVec2i32 & tile) const
+{
+  const int numtx = (this->getLevelSize(level)[0] + this->tilesize - 1) / this->tilesize;
+  const uint64_t tilebytes =
+    uint64_t(this->tilesize) * this->tilesize * this->numcomponents;
+  return this->leveloffset[level] +
+    (uint64_t(tile[1]) * numtx + tile[0]) * tilebytes;
+}
+
+// only called from open() and from the loader thread
+SbBool
+SoTilePyramid::readTile(const int level, const SbVec2i32 & tile,
+                        std::vector<unsigned char> & data)
+{
+  const size_t numbytes =
+    size_t(this->tilesize) * this->tilesize * this->numcomponents;
+  data.resize(numbytes);
+  if (sotilepyramid_seek(this->fp, this->tileOffset(level, tile), SEEK_SET) != 0 ||
+      fread(&data[0], 1, numbytes, this->fp) != numbytes) {
+    SoDebugError::post("SoTilePyramid::readTile",
+                       "Could not read tile (%d, %d) of level %d",
+                       tile[0], tile[1], level);
+    return FALSE;
+  }
+  return TRUE;
+}
+
+// mutex must be locked
+SbBool
+SoTilePyramid::isResident(const int level,
+                          const SbVec2i32 & tile0,
+                          const SbVec2i32 & tile1)
+{
+  for (int ty = tile0[1]; ty <= tile1[1]; ty++) {
+    for (int tx = tile0[0]; tx <= tile1[0]; tx++) {
+      if (this->tiles.find(sotilepyramid_key(level, SbVec2i32(tx, ty))) ==
+          this->tiles.end()) return FALSE;
+    }
+  }
+  return TRUE;
+}
+
+// mutex must be locked
+void
+SoTilePyramid::insertTile(Tile * tile)
+{
+  auto ins = this->tiles.emplace(tile->key, tile);
+  if (!ins.second) {
+    delete tile;
+    return;
+  }
+  this->lrulist.push_back(tile);
+  tile->lru = std::prev(this->lrulist.end());
+  this->numcachedbytes += tile->data.size();
+
+  const size_t maxbytes = SoTilePyramid::getCacheSize();
+  while (this->numcachedbytes > maxbytes && this->lrulist.front() != tile) {
+    Tile * victim = this->lrulist.front();
+    this->lrulist.pop_front();
+    this->tiles.erase(victim->key);
+    this->numcachedbytes -= victim->data.size();
+    delete victim;
+  }
+}
+
+void *
+SoTilePyramid::loaderLoop(void * closure)
+{
+  SoTilePyramid * thisp = static_cast<SoTilePyramid *>(closure);
+  const size_t tilebytes =
+    size_t(thisp->tilesize) * thisp->tilesize * thisp->numcomponents;
+
+  thisp->mutex.lock();
+  for (;;) {
+    while (!thisp->quit && thisp->requests.empty()) {
+      thisp->requestcond.wait(thisp->mutex);
+    }
+    if (thisp->quit) break;
+
+    // newest frame first, then coarse levels, then the larger on screen
+    auto best = thisp->requests.begin();
+    for (auto it = thisp->requests.begin(); it != thisp->requests.end(); ++it) {
+      const Request & a = it->second;
+      const Request & b = best->second;
+      if (a.frame != b.frame) { if (a.frame > b.frame) best = it; }
+      else if (a.level != b.level) { if (a.level > b.level) best = it; }
+      else if (a.priority > b.priority) best = it;
+    }
+    const Request r = best->second;
+    thisp->requests.erase(best);
+    thisp->loading = TRUE;
+    thisp->mutex.unlock();
+
+    Tile * tile = new Tile;
+    tile->key = sotilepyramid_key(r.level, r.tile);
+    tile->pinned = FALSE;
+    if (!thisp->readTile(r.level, r.tile, tile->data)) {
+      // use a black tile rather than asking for it again every frame
+      tile->data.assign(tilebytes, 0);
+    }
+
+    thisp->mutex.lock();
+    thisp->loading = FALSE;
+    thisp->insertTile(tile);
+  }
+  thisp->mutex.unlock();
+  return NULL;
+}
+
+#undef TILEPYRAMID_HEADERSIZE
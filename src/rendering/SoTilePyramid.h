@@ -0,0 +1,140 @@
+#ifndef COIN_SOTILEPYRAMID_H
+#define COIN_SOTILEPYRAMID_H
+
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+
+#ifndef COIN_INTERNAL
+#error this is a private header file
+#endif /* !COIN_INTERNAL */
+
+#include <Inventor/SbVec2i32.h>
+#include <Inventor/threads/SbCondVar.h>
+#include <Inventor/threads/SbMutex.h>
+#include <Inventor/threads/SbThread.h>
+
+#include <cstdio>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+// A tiled mipmap pyramid in a file, used by SoGLBigImage for images
+// too large to keep in memory. Tiles are read by a loader thread in
+// priority order, into a least recently used cache of bounded size.
+// The file layout is documented with SoGLBigImage::writeTilePyramid().
+
+class SoTilePyramid {
+public:
+  SoTilePyramid(void);
+  ~SoTilePyramid();
+
+  typedef SbBool ReadRowCB(void * closure, const int row, unsigned char * dst);
+
+  static SbBool writeFile(const char * filename,
+                          const unsigned char * bytes,
+                          const SbVec2i32 & size,
+                          const int numcomponents,
+                          const int tilesize);
+  static SbBool writeFile(const char * filename,
+                          const SbVec2i32 & size,
+                          const int numcomponents,
+                          const int tilesize,
+                          ReadRowCB * readrow,
+                          void * closure);
+  static SbBool isPyramidFile(const char * filename);
+
+  SbBool open(const char * filename);
+
+  const SbVec2i32 & getSize(void) const { return this->size; }
+  int getNumComponents(void) const { return this->numcomponents; }
+  int getTileSize(void) const { return this->tilesize; }
+  int getNumLevels(void) const { return this->numlevels; }
+  SbVec2i32 getLevelSize(const int level) const;
+
+  SbBool getRegion(const int level,
+                   const SbVec2i32 & origin,
+                   const SbVec2i32 & regionsize,
+                   unsigned char * dst);
+  void request(const int level,
+               const SbVec2i32 & origin,
+               const SbVec2i32 & regionsize,
+               const float priority);
+  void newFrame(void);
+  SbBool hasPendingRequests(void);
+  size_t getNumCachedBytes(void);
+
+  static void setCacheSize(const size_t numbytes);
+  static size_t getCacheSize(void);
+
+private:
+  struct Tile {
+    uint64_t key;
+    std::vector<unsigned char> data;
+    SbBool pinned;
+    std::list<Tile *>::iterator lru;
+  };
+  struct Request {
+    int level;
+    SbVec2i32 tile;
+    uint32_t frame;
+    float priority;
+  };
+
+  uint64_t tileOffset(const int level, const SbVec2i32 & tile) const;
+  SbBool readTile(const int level, const SbVec2i32 & tile,
+                  std::vector<unsigned char> & data);
+  SbBool isResident(const int level, const SbVec2i32 & tile0,
+                    const SbVec2i32 & tile1);
+  void insertTile(Tile * tile);
+  static void * loaderLoop(void * closure);
+
+  FILE * fp;
+  SbVec2i32 size;
+  int numcomponents;
+  int tilesize;
+  int numlevels;
+  std::vector<uint64_t> leveloffset;
+
+  SbMutex mutex;
+  SbCondVar requestcond;
+  SbThread * loader;
+  SbBool quit;
+  SbBool loading;
+  uint32_t frame;
+  size_t numcachedbytes;
+  std::unordered_map<uint64_t, Tile *> tiles;
+  std::list<Tile *> lrulist; // least recently used first
+  std::unordered_map<uint64_t, Request> requests;
+};
+
+#endif // COIN_SOTILEPYRAMID_H
@@ -0,0 +1,641 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+/*!
+  \class SoUnitShapeCache
+  \brief The SoUnitShapeCache class shares tessellations of the basic shapes.
+
+  \internal
+
+  Instead of generating the geometry of SoCone, SoCylinder, SoSphere
+  and SoCube each time a shape is rendered, sogl_render_cone() and
+  friends ask this class to render a unit size tessellation with a
+  scale transform for the actual size of the shape. One tessellation
+  is kept for each shape type and slice/stack count, and it's shared
+  between all nodes. The geometry is rendered from vertex buffer
+  objects when possible, and the buffers are shared between all
+  contexts with the same cache context id.
+
+  Shapes which can't be rendered this way (multiple texture units,
+  texture coordinate functions, negative sizes) are left to the
+  immediate mode code in SoGL.cpp. The cache can be disabled by
+  setting the environment variable COIN_UNIT_SHAPE_CACHE to 0.
+*/
+
+#include "rendering/SoUnitShapeCache.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <mutex>
+#include <unordered_map>
+
+#include <Inventor/SbVec2f.h>
+#include <Inventor/SbVec3f.h>
+#include <Inventor/bundles/SoMaterialBundle.h>
+#include <Inventor/elements/SoCacheElement.h>
+#include <Inventor/elements/SoGLVBOElement.h>
+#include <Inventor/elements/SoMultiTextureCoordinateElement.h>
+#include <Inventor/elements/SoMultiTextureEnabledElement.h>
+#include <Inventor/lists/SbList.h>
+#include <Inventor/misc/SoGLDriverDatabase.h>
+#include <Inventor/system/gl.h>
+
+#include "C/CoinTidbits.h"
+#include "coindefs.h"
+#include "glue/glp.h"
+#include "misc/SoEnvironment.h"
+#include "rendering/SoGL.h"
+#include "rendering/SoVBO.h"
+#include "rendering/SoVertexArrayIndexer.h"
+
+// *************************************************************************
+
+// Upper limit on the total number of vertices kept in the cache, to
+// avoid filling memory with tessellations when screen space
+// complexity makes the slice count change continuously. Shapes which
+// don't fit are rendered in immediate mode.
+static const int UNITSHAPE_MAX_VERTICES = 1 << 20;
+
+namespace {
+
+class UnitShape {
+public:
+  enum { MAXPARTS = 6 };
+
+  UnitShape(void);
+  ~UnitShape();
+
+  int addVertex(const SbVec3f & v, const SbVec3f & n,
+                const SbVec2f & tc2, const SbVec3f & tc3);
+  void beginPart(const unsigned int flag);
+  void addTriangle(const int v0, const int v1, const int v2);
+  void addFan(const SbList <int> & fan);
+  void close(void);
+
+  int getNumVertices(void) const { return this->vertexlist.getLength(); }
+
+  void render(const cc_glglue * glue, const uint32_t contextid,
+              const SbBool renderasvbo, const int texdim,
+              SoMaterialBundle * const material, const unsigned int flags);
+
+  std::mutex mutex;
+
+private:
+  SbList <SbVec3f> vertexlist;
+  SbList <SbVec3f> normallist;
+  SbList <SbVec2f> texcoord2list;
+  SbList <SbVec3f> texcoord3list;
+
+  int numparts;
+  unsigned int partflags[MAXPARTS];
+  SoVertexArrayIndexer * parts[MAXPARTS];
+  SoVertexArrayIndexer * all;
+
+  SoVBO * vertexvbo;
+  SoVBO * normalvbo;
+  SoVBO * texcoord2vbo;
+  SoVBO * texcoord3vbo;
+};
+
+UnitShape::UnitShape(void)
+  : numparts(0),
+    all(new SoVertexArrayIndexer),
+    vertexvbo(NULL),
+    normalvbo(NULL),
+    texcoord2vbo(NULL),
+    texcoord3vbo(NULL)
+{
+  for (int i = 0; i < MAXPARTS; i++) {
+    this->partflags[i] = 0;
+    this->parts[i] = NULL;
+  }
+}
+
+UnitShape::~UnitShape()
+{
+  for (int i = 0; i < this->numparts; i++) delete this->parts[i];
+  delete this->all;
+  delete this->vertexvbo;
+  delete this->normalvbo;
+  delete this->texcoord2vbo;
+  delete this->texcoord3vbo;
+}
+
+int
+UnitShape::addVertex(const SbVec3f & v, const SbVec3f & n,
+                     const SbVec2f & tc2, const SbVec3f & tc3)
+{
+  this->vertexlist.append(v);
+  this->normallist.append(n);
+  this->texcoord2list.append(tc2);
+  this->texcoord3list.append(tc3);
+  return this->vertexlist.getLength() - 1;
+}
+
+// Starts a new part. Parts with a zero flag are always rendered,
+// other parts only if the flag is set in the render flags.
+void
+UnitShape::beginPart(const unsigned int flag)
+{
+  assert(this->numparts < MAXPARTS);
+  this->partflags[this->numparts] = flag;
+  this->parts[this->numparts] = new SoVertexArrayIndexer;
+  this->numparts++;
+}
+
+void
+UnitShape::addTriangle(const int v0, const int v1, const int v2)
+{
+  this->parts[this->numparts-1]->addTriangle(v0, v1, v2);
+  this->all->addTriangle(v0, v1, v2);
+}
+
+void
+UnitShape::addFan(const SbList <int> & fan)
+{
+  for (int i = 1; i < fan.getLength() - 1; i++) {
+    this->addTriangle(fan[0], fan[i], fan[i+1]);
+  }
+}
+
+void
+UnitShape::close(void)
+{
+  for (int i = 0; i < this->numparts; i++) this->parts[i]->close();
+  this->all->close();
+}
+
+void
+UnitShape::render(const cc_glglue * glue, const uint32_t contextid,
+                  const SbBool renderasvbo, const int texdim,
+                  SoMaterialBundle * const material, const unsigned int flags)
+{
+  const SbBool normals = (flags & SOGL_NEED_NORMALS) != 0;
+
+  if (renderasvbo) {
+    // the lists are never modified after the shape is closed, so the
+    // VBOs can use them directly
+    if (this->vertexvbo == NULL) {
+      this->vertexvbo = new SoVBO;
+      this->vertexvbo->setBufferData(this->vertexlist.getArrayPtr(),
+                                     this->vertexlist.getLength()*3*sizeof(float));
+    }
+    this->vertexvbo->bindBuffer(contextid);
+    cc_glglue_glVertexPointer(glue, 3, GL_FLOAT, 0, NULL);
+    if (normals) {
+      if (this->normalvbo == NULL) {
+        this->normalvbo = new SoVBO;
+        this->normalvbo->setBufferData(this->normallist.getArrayPtr(),
+                                       this->normallist.getLength()*3*sizeof(float));
+      }
+      this->normalvbo->bindBuffer(contextid);
+      cc_glglue_glNormalPointer(glue, GL_FLOAT, 0, NULL);
+    }
+    if (texdim == 2) {
+      if (this->texcoord2vbo == NULL) {
+        this->texcoord2vbo = new SoVBO;
+        this->texcoord2vbo->setBufferData(this->texcoord2list.getArrayPtr(),
+                                          this->texcoord2list.getLength()*2*sizeof(float));
+      }
+      this->texcoord2vbo->bindBuffer(contextid);
+      cc_glglue_glTexCoordPointer(glue, 2, GL_FLOAT, 0, NULL);
+    }
+    else if (texdim == 3) {
+      if (this->texcoord3vbo == NULL) {
+        this->texcoord3vbo = new SoVBO;
+        this->texcoord3vbo->setBufferData(this->texcoord3list.getArrayPtr(),
+                                          this->texcoord3list.getLength()*3*sizeof(float));
+      }
+      this->texcoord3vbo->bindBuffer(contextid);
+      cc_glglue_glTexCoordPointer(glue, 3, GL_FLOAT, 0, NULL);
+    }
+  }
+  else {
+    cc_glglue_glVertexPointer(glue, 3, GL_FLOAT, 0,
+                              static_cast<const GLvoid *>(this->vertexlist.getArrayPtr()));
+    if (normals) {
+      cc_glglue_glNormalPointer(glue, GL_FLOAT, 0,
+                                static_cast<const GLvoid *>(this->normallist.getArrayPtr()));
+    }
+    if (texdim == 2) {
+      cc_glglue_glTexCoordPointer(glue, 2, GL_FLOAT, 0,
+                                  static_cast<const GLvoid *>(this->texcoord2list.getArrayPtr()));
+    }
+    else if (texdim == 3) {
+      cc_glglue_glTexCoordPointer(glue, 3, GL_FLOAT, 0,
+                                  static_cast<const GLvoid *>(this->texcoord3list.getArrayPtr()));
+    }
+  }
+  cc_glglue_glEnableClientState(glue, GL_VERTEX_ARRAY);
+  if (normals) cc_glglue_glEnableClientState(glue, GL_NORMAL_ARRAY);
+  if (texdim) cc_glglue_glEnableClientState(glue, GL_TEXTURE_COORD_ARRAY);
+
+  const SbBool perpart = (flags & SOGL_MATERIAL_PER_PART) != 0;
+  SbBool allparts = TRUE;
+  for (int i = 0; i < this->numparts; i++) {
+    if (this->partflags[i] && !(this->partflags[i] & flags)) allparts = FALSE;
+  }
+
+  if (allparts && !perpart) {
+    this->all->render(glue, renderasvbo, contextid);
+  }
+  else {
+    // the first material was sent by the node before rendering
+    int matnr = 0;
+    for (int i = 0; i < this->numparts; i++) {
+      if (this->partflags[i] && !(this->partflags[i] & flags)) continue;
+      if (perpart && matnr > 0) material->send(matnr, TRUE);
+      this->parts[i]->render(glue, renderasvbo, contextid);
+      matnr++;
+    }
+  }
+
+  if (texdim) cc_glglue_glDisableClientState(glue, GL_TEXTURE_COORD_ARRAY);
+  if (normals) cc_glglue_glDisableClientState(glue, GL_NORMAL_ARRAY);
+  cc_glglue_glDisableClientState(glue, GL_VERTEX_ARRAY);
+  if (renderasvbo) {
+    cc_glglue_glBindBuffer(glue, GL_ARRAY_BUFFER, 0);
+  }
+}
+
+// *************************************************************************
+
+// The unit shapes below have the same vertex order, normals and
+// texture coordinates as the immediate mode code in SoGL.cpp, with
+// strips and fans split into triangles.
+
+static SbVec2f
+unitshape_circle(const int i, const int num)
+{
+  const float angle = 2.0f*float(M_PI)*float(i)/float(num);
+  return SbVec2f(-float(sin(angle)), -float(cos(angle)));
+}
+
+// cone with radius 1 and height 1
+static UnitShape *
+unitshape_create_cone(const int slices)
+{
+  UnitShape * us = new UnitShape;
+  const float h2 = 0.5f;
+  const float delta = 1.0f / slices;
+  const double a = atan(1.0);
+  const float ns = float(sin(a));
+  const float ny = float(cos(a));
+
+  SbList <int> ring(slices + 1);
+  SbList <SbVec3f> normals(slices + 1);
+  us->beginPart(SOGL_RENDER_SIDE);
+  for (int i = 0; i <= slices; i++) {
+    const SbVec2f c = unitshape_circle(i % slices, slices);
+    const SbVec3f n(c[0]*ns, ny, c[1]*ns);
+    normals.append(n);
+    ring.append(us->addVertex(SbVec3f(c[0], -h2, c[1]), n,
+                              SbVec2f(1.0f - i*delta, 0.0f),
+                              SbVec3f(c[0]*0.5f+0.5f, 0.0f, c[1]*0.5f+0.5f)));
+  }
+  for (int i = 0; i < slices; i++) {
+    const int apex =
+      us->addVertex(SbVec3f(0.0f, h2, 0.0f),
+                    (normals[i] + normals[i+1])*0.5f,
+                    SbVec2f(1.0f - i*delta - delta*0.5f, 1.0f),
+                    SbVec3f(0.5f, 1.0f, 0.5f));
+    us->addTriangle(apex, ring[i], ring[i+1]);
+  }
+
+  SbList <int> fan(slices);
+  us->beginPart(SOGL_RENDER_BOTTOM);
+  for (int i = slices-1; i >= 0; i--) {
+    const SbVec2f c = unitshape_circle(i, slices);
+    fan.append(us->addVertex(SbVec3f(c[0], -h2, c[1]), SbVec3f(0.0f, -1.0f, 0.0f),
+                             SbVec2f(c[0]*0.5f+0.5f, c[1]*0.5f+0.5f),
+                             SbVec3f(c[0]*0.5f+0.5f, 0.0f, c[1]*0.5f+0.5f)));
+  }
+  us->addFan(fan);
+  return us;
+}
+
+// cylinder with radius 1 and height 1
+static UnitShape *
+unitshape_create_cylinder(const int slices)
+{
+  UnitShape * us = new UnitShape;
+  const float h2 = 0.5f;
+  const float inc = 1.0f / slices;
+
+  us->beginPart(SOGL_RENDER_SIDE);
+  int prevtop = -1, prevbottom = -1;
+  for (int i = 0; i <= slices; i++) {
+    const SbVec2f c = unitshape_circle(i % slices, slices);
+    const SbVec3f n(c[0], 0.0f, c[1]);
+    const int top =
+      us->addVertex(SbVec3f(c[0], h2, c[1]), n, SbVec2f(i*inc, 1.0f),
+                    SbVec3f(c[0]*0.5f+0.5f, 1.0f, 0.5f-c[1]*0.5f));
+    const int bottom =
+      us->addVertex(SbVec3f(c[0], -h2, c[1]), n, SbVec2f(i*inc, 0.0f),
+                    SbVec3f(c[0]*0.5f+0.5f, 0.0f, 0.5f-c[1]*0.5f));
+    if (i > 0) {
+      us->addTriangle(prevtop, prevbottom, top);
+      us->addTriangle(top, prevbottom, bottom);
+    }
+    prevtop = top;
+    prevbottom = bottom;
+  }
+
+  SbList <int> fan(slices);
+  us->beginPart(SOGL_RENDER_TOP);
+  for (int i = 0; i < slices; i++) {
+    const SbVec2f c = unitshape_circle(i, slices);
+    fan.append(us->addVertex(SbVec3f(c[0], h2, c[1]), SbVec3f(0.0f, 1.0f, 0.0f),
+                             SbVec2f(c[0]*0.5f+0.5f, 0.5f-c[1]*0.5f),
+                             SbVec3f(c[0]*0.5f+0.5f, 1.0f, 0.5f-c[1]*0.5f)));
+  }
+  us->addFan(fan);
+
+  fan.truncate(0);
+  us->beginPart(SOGL_RENDER_BOTTOM);
+  for (int i = slices-1; i >= 0; i--) {
+    const SbVec2f c = unitshape_circle(i, slices);
+    fan.append(us->addVertex(SbVec3f(c[0], -h2, c[1]), SbVec3f(0.0f, -1.0f, 0.0f),
+                             SbVec2f(c[0]*0.5f+0.5f, c[1]*0.5f+0.5f),
+                             SbVec3f(c[0]*0.5f+0.5f, 0.0f, 0.5f-c[1]*0.5f)));
+  }
+  us->addFan(fan);
+  return us;
+}
+
+// sphere with radius 1
+static UnitShape *
+unitshape_create_sphere(const int stacks, const int slices)
+{
+  UnitShape * us = new UnitShape;
+  const float drho = float(M_PI) / float(stacks-1);
+  const float dtheta = 2.0f * float(M_PI) / float(slices);
+  const float incs = 1.0f / float(slices);
+  const float dT = 1.0f / float(stacks-1);
+
+  us->beginPart(0);
+
+  // the rings between the poles, from top to bottom
+  SbList <int> rows((stacks-2) * (slices+1));
+  for (int k = 1; k <= stacks-2; k++) {
+    const float rho = k * drho;
+    const float tc = float(cos(rho));
+    const float ts = -float(sin(rho));
+    for (int j = 0; j <= slices; j++) {
+      const float theta = (j % slices) * dtheta;
+      const SbVec3f n(float(sin(theta))*ts, tc, float(cos(theta))*ts);
+      rows.append(us->addVertex(n, n, SbVec2f(j*incs, 1.0f - k*dT),
+                                n*0.5f + SbVec3f(0.5f, 0.5f, 0.5f)));
+    }
+  }
+  const int rowlen = slices + 1;
+
+  for (int j = 0; j < slices; j++) {
+    const int apex =
+      us->addVertex(SbVec3f(0.0f, 1.0f, 0.0f), SbVec3f(0.0f, 1.0f, 0.0f),
+                    SbVec2f(j*incs + 0.5f*incs, 1.0f),
+                    SbVec3f(0.5f, 1.0f, 0.5f));
+    us->addTriangle(apex, rows[j], rows[j+1]);
+  }
+
+  for (int k = 0; k < stacks-3; k++) {
+    const int * prev = rows.getArrayPtr() + k*rowlen;
+    const int * next = prev + rowlen;
+    for (int j = 0; j < slices; j++) {
+      us->addTriangle(prev[j], next[j], prev[j+1]);
+      us->addTriangle(prev[j+1], next[j], next[j+1]);
+    }
+  }
+
+  const int * last = rows.getArrayPtr() + (stacks-3)*rowlen;
+  for (int j = 0; j < slices; j++) {
+    const int apex =
+      us->addVertex(SbVec3f(0.0f, -1.0f, 0.0f), SbVec3f(0.0f, -1.0f, 0.0f),
+                    SbVec2f(j*incs + incs*0.5f, 0.0f),
+                    SbVec3f(0.5f, 0.0f, 0.5f));
+    us->addTriangle(last[j], apex, last[j+1]);
+  }
+  return us;
+}
+
+// cube with width, height and depth 1. Same face order, and thereby
+// material order, as sogl_render_cube().
+static UnitShape *
+unitshape_create_cube(void)
+{
+  static const int vindices[] = {
+    0, 1, 3, 2,
+    5, 4, 6, 7,
+    1, 5, 7, 3,
+    4, 0, 2, 6,
+    4, 5, 1, 0,
+    2, 3, 7, 6
+  };
+  static const float texcoords[][2] = {
+    { 1.0f, 1.0f }, { 0.0f, 1.0f }, { 0.0f, 0.0f }, { 1.0f, 0.0f }
+  };
+  static const float normals[][3] = {
+    { 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, -1.0f },
+    { -1.0f, 0.0f, 0.0f }, { 1.0f, 0.0f, 0.0f },
+    { 0.0f, 1.0f, 0.0f }, { 0.0f, -1.0f, 0.0f }
+  };
+
+  UnitShape * us = new UnitShape;
+  for (int i = 0; i < 6; i++) {
+    us->beginPart(0);
+    int quad[4];
+    for (int j = 0; j < 4; j++) {
+      const int v = vindices[i*4+j];
+      const SbVec3f tc3((v&4) ? 0.0f : 1.0f,
+                        (v&2) ? 0.0f : 1.0f,
+                        (v&1) ? 0.0f : 1.0f);
+      quad[j] = us->addVertex(SbVec3f((v&1) ? -0.5f : 0.5f,
+                                      (v&2) ? -0.5f : 0.5f,
+                                      (v&4) ? -0.5f : 0.5f),
+                              SbVec3f(normals[i]),
+                              SbVec2f(texcoords[j]),
+                              tc3);
+    }
+    us->addTriangle(quad[0], quad[1], quad[2]);
+    us->addTriangle(quad[0], quad[2], quad[3]);
+  }
+  return us;
+}
+
+} // anonymous namespace
+
+// *************************************************************************
+
+static int unitshape_enabled = -1;
+static std::mutex unitshape_mutex;
+static std::unordered_map<uint64_t, UnitShape *> * unitshape_dict = NULL;
+static int unitshape_numvertices = 0;
+
+/*!
+  Initializes the cache. Called from SoDB::init().
+*/
+void
+SoUnitShapeCache::init(void)
+{
+  auto env = CoinInternal::getEnvironmentVariable("COIN_UNIT_SHAPE_CACHE");
+  unitshape_enabled = env.has_value() ? std::atoi(env->c_str()) : 1;
+  coin_atexit(static_cast<coin_atexit_f *>(SoUnitShapeCache::cleanup), CC_ATEXIT_NORMAL);
+}
+
+/*!
+  Enables or disables rendering from the cache. Overrides the
+  COIN_UNIT_SHAPE_CACHE environment variable, and is used by the tests
+  to compare with immediate mode rendering.
+*/
+void
+SoUnitShapeCache::setEnabled(const SbBool enable)
+{
+  unitshape_enabled = enable ? 1 : 0;
+}
+
+/*!
+  Returns whether shapes are rendered from the cache when possible.
+*/
+SbBool
+SoUnitShapeCache::isEnabled(void)
+{
+  return unitshape_enabled > 0;
+}
+
+void
+SoUnitShapeCache::cleanup(void)
+{
+  if (unitshape_dict) {
+    for (auto & entry : *unitshape_dict) delete entry.second;
+    delete unitshape_dict;
+    unitshape_dict = NULL;
+  }
+  unitshape_numvertices = 0;
+  unitshape_enabled = -1;
+}
+
+/*!
+  Renders \a shape with \a numslices slices (and \a numstacks stacks
+  for spheres) scaled by \a scale, using the SOGL_* \a flags from
+  SoGL.h. The material for the first part must already have been
+  sent.
+
+  Returns \c FALSE without rendering anything if the shape can't be
+  rendered from the cache in the current state. The caller should
+  then render it in immediate mode.
+*/
+SbBool
+SoUnitShapeCache::render(SoState * state,
+                         const Shape shape,
+                         const int numslices,
+                         const int numstacks,
+                         const SbVec3f & scale,
+                         SoMaterialBundle * const material,
+                         const unsigned int flags)
+{
+  if (unitshape_enabled <= 0 || state == NULL) return FALSE;
+  if (scale[0] <= 0.0f || scale[1] <= 0.0f || scale[2] <= 0.0f) return FALSE;
+
+  // texture coordinates are only stored for unit 0, and texture
+  // coordinate functions would see the coordinates of the unit shape
+  int lastenabled;
+  (void) SoMultiTextureEnabledElement::getEnabledUnits(state, lastenabled);
+  if (lastenabled > 0) return FALSE;
+  if (SoMultiTextureCoordinateElement::getType(state, 0) ==
+      SoMultiTextureCoordinateElement::FUNCTION) return FALSE;
+
+  // don't use SoGLCacheContextElement to find the current cache
+  // context since we don't want to create a cache dependency on it
+  const cc_glglue * glue = sogl_glue_instance(state);
+  const uint32_t contextid = glue->contextid;
+  if (!SoGLDriverDatabase::isSupported(glue, SO_GL_VERTEX_ARRAY)) return FALSE;
+
+  const int slices = (shape == CUBE) ? 0 : numslices;
+  const int stacks = (shape == SPHERE) ? numstacks : 0;
+  const uint64_t key =
+    (uint64_t(shape) << 48) | (uint64_t(slices) << 24) | uint64_t(stacks);
+
+  UnitShape * us = NULL;
+  {
+    std::lock_guard<std::mutex> lock(unitshape_mutex);
+    if (unitshape_dict == NULL) {
+      unitshape_dict = new std::unordered_map<uint64_t, UnitShape *>;
+    }
+    auto it = unitshape_dict->find(key);
+    if (it != unitshape_dict->end()) {
+      us = it->second;
+    }
+    else if (unitshape_numvertices < UNITSHAPE_MAX_VERTICES) {
+      switch (shape) {
+      case CONE: us = unitshape_create_cone(slices); break;
+      case CYLINDER: us = unitshape_create_cylinder(slices); break;
+      case SPHERE: us = unitshape_create_sphere(stacks, slices); break;
+      case CUBE: us = unitshape_create_cube(); break;
+      }
+      us->close();
+      unitshape_numvertices += us->getNumVertices();
+      unitshape_dict->insert(std::make_pair(key, us));
+    }
+  }
+  if (us == NULL) return FALSE;
+
+  const int numvertices = us->getNumVertices();
+  if (!SoVBO::shouldRenderAsVertexArrays(state, contextid, numvertices)) return FALSE;
+
+  // fall back to client side vertex arrays while building a display
+  // list if the driver can't put VBO rendering in display lists
+  const SbBool renderasvbo =
+    SoGLVBOElement::shouldCreateVBO(state, numvertices) &&
+    (SoGLDriverDatabase::isSupported(glue, SO_GL_VBO_IN_DISPLAYLIST) ||
+     !SoCacheElement::anyOpen(state));
+
+  int texdim = 0;
+  if (shape == CUBE) {
+    if (flags & SOGL_NEED_3DTEXCOORDS) texdim = 3;
+    else if (flags & SOGL_NEED_TEXCOORDS) texdim = 2;
+  }
+  else {
+    if (flags & SOGL_NEED_TEXCOORDS) texdim = 2;
+    else if (flags & SOGL_NEED_3DTEXCOORDS) texdim = 3;
+  }
+
+  glPushMatrix();
+  glScalef(scale[0], scale[1], scale[2]);
+  {
+    // the index VBOs are created on first use, and the per context
+    // buffer ids in SoVBO are not thread safe
+    std::lock_guard<std::mutex> lock(us->mutex);
+    us->render(glue, contextid, renderasvbo, texdim, material, flags);
+  }
+  glPopMatrix();
+  return TRUE;
+}
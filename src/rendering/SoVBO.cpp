@@ -43,7 +43,11 @@
 
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <cassert>
+#include <cmath>
+#include <atomic>
+#include <mutex>
 
 #include <Inventor/misc/SoContextHandler.h>
 #include <Inventor/misc/SoGLDriverDatabase.h>
@@ -53,6 +57,8 @@
 #include <Inventor/SbVec3f.h>
 #include <Inventor/errors/SoDebugError.h>
 
+#include "rendering/SoGLResourceManagerP.h"
+#include "rendering/SoRenderStatisticsP.h"
 #include "rendering/SoVertexArrayIndexer.h"
 #include "threads/threadsutilp.h"
 #include "glue/glp.h"
@@ -64,6 +70,12 @@ static int vbo_vertex_count_max_limit = -1;
 static int vbo_render_as_vertex_arrays = -1;
 static int vbo_enabled = -1;
 static int vbo_debug = -1;
+static int vbo_compression = -1;
+
+// bytes of buffer data held by all VBOs, and what the attributes in
+// them would have needed without compression
+static std::atomic<int64_t> vbo_numbytes(0);
+static std::atomic<int64_t> vbo_numuncompressedbytes(0);
 
 // VBO rendering seems to be faster than other rendering, even for
 // large VBOs. Just set the default limit very high
@@ -71,6 +83,7 @@ static const int DEFAULT_MAX_LIMIT = 100000000;
 static const int DEFAULT_MIN_LIMIT = 20;
 
 static SbHash<uint32_t, SbBool> * vbo_isfast_hash;
+static std::mutex sovbo_hash_mutex;
 
 /*!
   Constructor
@@ -82,8 +95,13 @@ SoVBO::SoVBO(const GLenum target, const GLenum usage)
     datasize(0),
     dataid(0),
     didalloc(FALSE),
+    datatype(GL_FLOAT),
+    stride(0),
+    uncompressedsize(0),
+    decodescale(1.0f),
     vbohash(5)
 {
+  this->decodeoffset[0] = this->decodeoffset[1] = this->decodeoffset[2] = 0.0f;
   SoContextHandler::addContextDestructionCallback(context_destruction_cb, this);
 }
 
@@ -113,10 +131,13 @@ SoVBO::~SoVBO()
       ++iter
       )
     {
+      // evicted buffers have already been deleted
+      if (!SoGLResourceManagerP::remove(iter->key, this)) continue;
       void * ptr = (void*) ((uintptr_t) iter->obj);
       SoGLCacheContextElement::scheduleDeleteCallback(iter->key, SoVBO::vbo_delete, ptr);
   }
 
+  this->setDataSize(0, 0);
   if (this->didalloc) {
     char * ptr = (char*) this->data;
     delete[] ptr;
@@ -132,6 +153,7 @@ static void vbo_atexit_cleanup(void)
   vbo_vertex_count_max_limit = -1;
   vbo_render_as_vertex_arrays = -1;
   vbo_enabled = -1;
+  vbo_compression = -1;
 }
 
 void
@@ -194,6 +216,18 @@ SoVBO::init(void)
       vbo_debug = 0;
     }
   }
+  // use COIN_VBO_COMPRESSION to compress vertex attributes, either
+  // with a mask of AttributeCompression flags or 1 for all of them
+  if (vbo_compression < 0) {
+    auto env = CoinInternal::getEnvironmentVariable("COIN_VBO_COMPRESSION");
+    if (env.has_value()) {
+      vbo_compression = std::atoi(env->c_str());
+      if (vbo_compression == 1) vbo_compression = COMPRESS_ALL;
+    }
+    else {
+      vbo_compression = COMPRESS_NONE;
+    }
+  }
 }
 
 /*!
@@ -212,6 +246,7 @@ SoVBO::allocBufferData(intptr_t size, SbUniqueId dataid)
       iter!=this->vbohash.const_end();
       ++iter
       ) {
+    if (!SoGLResourceManagerP::remove(iter->key, this)) continue;
     void * ptr = (void*) ((uintptr_t) iter->obj);
     SoGLCacheContextElement::scheduleDeleteCallback(iter->key, SoVBO::vbo_delete, ptr);
   }
@@ -219,6 +254,10 @@ SoVBO::allocBufferData(intptr_t size, SbUniqueId dataid)
   // clear hash table
   this->vbohash.clear();
 
+  this->datatype = GL_FLOAT;
+  this->stride = 0;
+  this->decodescale = 1.0f;
+  this->setDataSize(size, size);
   if (this->didalloc && this->datasize == size) {
     return (void*)this->data;
   }
@@ -235,6 +274,15 @@ SoVBO::allocBufferData(intptr_t size, SbUniqueId dataid)
   return (void*) this->data;
 }
 
+// updates the global memory statistics for a new data size
+void
+SoVBO::setDataSize(intptr_t size, intptr_t uncompressed)
+{
+  vbo_numbytes += int64_t(size) - int64_t(this->datasize);
+  vbo_numuncompressedbytes += int64_t(uncompressed) - int64_t(this->uncompressedsize);
+  this->uncompressedsize = uncompressed;
+}
+
 /*!
   Sets the buffer data. \a dataid is a unique id used to identify
   the buffer data. In Coin it is possible to use the node id
@@ -250,6 +298,7 @@ SoVBO::setBufferData(const GLvoid * data, intptr_t size, SbUniqueId dataid)
       iter!=this->vbohash.const_end();
       ++iter
       ) {
+    if (!SoGLResourceManagerP::remove(iter->key, this)) continue;
     void * ptr = (void*) ((uintptr_t) iter->obj);
     SoGLCacheContextElement::scheduleDeleteCallback(iter->key, SoVBO::vbo_delete, ptr);
   }
@@ -264,6 +313,10 @@ SoVBO::setBufferData(const GLvoid * data, intptr_t size, SbUniqueId dataid)
     delete[] ptr;
   }
 
+  this->datatype = GL_FLOAT;
+  this->stride = 0;
+  this->decodescale = 1.0f;
+  this->setDataSize(size, size);
   this->data = data;
   this->datasize = size;
   this->dataid = dataid;
@@ -292,6 +345,249 @@ SoVBO::getBufferData(const GLvoid *& data, intptr_t & size)
 }
 
 
+// converts a float to a half float, rounding to nearest. Values too
+// small for a normalized half float are flushed to zero.
+static uint16_t
+vbo_float_to_half(const float value)
+{
+  uint32_t bits;
+  (void)memcpy(&bits, &value, sizeof(uint32_t));
+  const uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+  const int32_t exponent = int32_t((bits >> 23) & 0xff) - 127 + 15;
+  uint32_t mantissa = bits & 0x7fffff;
+
+  if (exponent <= 0) return sign;
+  // round the mantissa, which may carry into the exponent
+  mantissa += 0x1000;
+  uint32_t half = (uint32_t(exponent) << 10) + (mantissa >> 13);
+  if (half >= 0x7c00) half = 0x7c00;
+  return static_cast<uint16_t>(sign | half);
+}
+
+/*!
+  Sets the buffer data to \a num vertex positions. If position
+  compression is enabled, the positions are quantized to 16 bit
+  integers in a cube around their bounding box, padded to 8 bytes per
+  vertex instead of 12. The cube is used instead of the box so that
+  positions are decoded with a uniform scale, which the normal matrix
+  (with GL_NORMALIZE) handles. Use getDecodeTransform() to find the
+  transformation from the stored to the original positions. Since
+  object space positions then differ from the original ones, shapes
+  don't use the buffer while texture coordinates are generated or a
+  shader program is active.
+
+  Unlike setBufferData(), the buffer keeps a copy of compressed data,
+  so \a vertices doesn't have to be valid after this call.
+
+  \sa setAttributeCompression()
+*/
+void
+SoVBO::setVertexData(const SbVec3f * vertices, const int num, SbUniqueId dataid)
+{
+  const intptr_t size = num * sizeof(SbVec3f);
+  if (!(SoVBO::getAttributeCompression() & COMPRESS_POSITIONS) || num == 0) {
+    this->setBufferData(vertices, size, dataid);
+    return;
+  }
+
+  float bmin[3], bmax[3];
+  int i, j;
+  for (j = 0; j < 3; j++) bmin[j] = bmax[j] = vertices[0][j];
+  for (i = 0; i < num; i++) {
+    for (j = 0; j < 3; j++) {
+      const float v = vertices[i][j];
+      if (!std::isfinite(v)) {
+        this->setBufferData(vertices, size, dataid);
+        return;
+      }
+      if (v < bmin[j]) bmin[j] = v;
+      if (v > bmax[j]) bmax[j] = v;
+    }
+  }
+  float center[3];
+  float halfsize = 0.0f;
+  for (j = 0; j < 3; j++) {
+    center[j] = (bmin[j] + bmax[j]) * 0.5f;
+    halfsize = SbMax(halfsize, (bmax[j] - bmin[j]) * 0.5f);
+  }
+  const float scale = (halfsize > 0.0f) ? halfsize / 32767.0f : 1.0f;
+
+  int16_t * dst = static_cast<int16_t *>(this->allocBufferData(num * 4 * sizeof(int16_t), dataid));
+  for (i = 0; i < num; i++) {
+    for (j = 0; j < 3; j++) {
+      const float q = floorf((vertices[i][j] - center[j]) / scale + 0.5f);
+      dst[i*4+j] = static_cast<int16_t>(SbClamp(q, -32767.0f, 32767.0f));
+    }
+    dst[i*4+3] = 0;
+  }
+  this->datatype = GL_SHORT;
+  this->stride = 4 * sizeof(int16_t);
+  this->decodescale = scale;
+  for (j = 0; j < 3; j++) this->decodeoffset[j] = center[j];
+  this->setDataSize(this->datasize, size);
+}
+
+/*!
+  Sets the buffer data to \a num normals. If normal compression is
+  enabled, the normals are stored as signed normalized bytes, padded
+  to 4 bytes per normal instead of 12. OpenGL maps these back to
+  [-1, 1], so no decoding is needed.
+
+  \sa setAttributeCompression()
+*/
+void
+SoVBO::setNormalData(const SbVec3f * normals, const int num, SbUniqueId dataid)
+{
+  const intptr_t size = num * sizeof(SbVec3f);
+  if (!(SoVBO::getAttributeCompression() & COMPRESS_NORMALS) || num == 0) {
+    this->setBufferData(normals, size, dataid);
+    return;
+  }
+
+  int8_t * dst = static_cast<int8_t *>(this->allocBufferData(num * 4, dataid));
+  for (int i = 0; i < num; i++) {
+    // normalize first, since values outside [-1, 1] can't be stored
+    SbVec3f n = normals[i];
+    const float len = n.length();
+    if (len > 0.0f) n /= len;
+    for (int j = 0; j < 3; j++) {
+      dst[i*4+j] = static_cast<int8_t>(floorf(SbClamp(n[j], -1.0f, 1.0f) * 127.0f + 0.5f));
+    }
+    dst[i*4+3] = 0;
+  }
+  this->datatype = GL_BYTE;
+  this->stride = 4;
+  this->setDataSize(this->datasize, size);
+}
+
+/*!
+  Sets the buffer data to \a num texture coordinates with \a dim
+  components each. If texture coordinate compression is enabled, the
+  coordinates are stored as half floats, which halves the size of 2D
+  and 4D coordinates (3D coordinates are padded to 8 bytes). Half
+  floats have an 11 bit mantissa, which is enough for coordinates
+  close to [0, 1], but not for coordinates that repeat a texture
+  many times. Coordinates too large for half floats are not
+  compressed.
+
+  \sa setAttributeCompression(), canRenderHalfFloats()
+*/
+void
+SoVBO::setTexCoordData(const float * texcoords, const int num, const int dim,
+                       SbUniqueId dataid)
+{
+  const intptr_t size = num * dim * sizeof(float);
+  if (!(SoVBO::getAttributeCompression() & COMPRESS_TEXCOORDS) || num == 0) {
+    this->setBufferData(texcoords, size, dataid);
+    return;
+  }
+  int i;
+  for (i = 0; i < num * dim; i++) {
+    if (!(fabsf(texcoords[i]) <= 65504.0f)) {
+      this->setBufferData(texcoords, size, dataid);
+      return;
+    }
+  }
+
+  const int n = (dim == 3) ? 4 : dim;
+  uint16_t * dst = static_cast<uint16_t *>(this->allocBufferData(num * n * sizeof(uint16_t), dataid));
+  for (i = 0; i < num; i++) {
+    for (int j = 0; j < n; j++) {
+      dst[i*n+j] = (j < dim) ? vbo_float_to_half(texcoords[i*dim+j]) : 0;
+    }
+  }
+  this->datatype = GL_HALF_FLOAT;
+  this->stride = (dim == 3) ? 4 * sizeof(uint16_t) : 0;
+  this->setDataSize(this->datasize, size);
+}
+
+/*!
+  Returns the OpenGL type of the components in the buffer. This is
+  GL_FLOAT unless the data was compressed by setVertexData(),
+  setNormalData() or setTexCoordData().
+*/
+GLenum
+SoVBO::getDataType(void) const
+{
+  return this->datatype;
+}
+
+/*!
+  Returns the stride to use when setting up the array pointer for the
+  buffer. 0 means that the data is tightly packed.
+*/
+GLsizei
+SoVBO::getStride(void) const
+{
+  return this->stride;
+}
+
+/*!
+  Returns \c TRUE if the buffer holds quantized positions. The
+  original positions are then \a offset + \a scale times the stored
+  positions, which can be applied with glTranslatef() and glScalef()
+  before rendering.
+*/
+SbBool
+SoVBO::getDecodeTransform(float & scale, float offset[3]) const
+{
+  if (this->datatype != GL_SHORT) return FALSE;
+  scale = this->decodescale;
+  offset[0] = this->decodeoffset[0];
+  offset[1] = this->decodeoffset[1];
+  offset[2] = this->decodeoffset[2];
+  return TRUE;
+}
+
+/*!
+  Sets which vertex attributes are compressed by setVertexData(),
+  setNormalData() and setTexCoordData(). \a flags is a mask of
+  AttributeCompression values. The default is COMPRESS_NONE, or the
+  value of the COIN_VBO_COMPRESSION environment variable.
+
+  The setting only affects buffer data set after the call.
+*/
+void
+SoVBO::setAttributeCompression(const uint32_t flags)
+{
+  vbo_compression = static_cast<int>(flags & COMPRESS_ALL);
+}
+
+/*!
+  Returns the vertex attribute compression flags.
+
+  \sa setAttributeCompression()
+*/
+uint32_t
+SoVBO::getAttributeCompression(void)
+{
+  return (vbo_compression < 0) ? COMPRESS_NONE : static_cast<uint32_t>(vbo_compression);
+}
+
+/*!
+  Returns \c TRUE if half float texture coordinates can be used with
+  \a glue. Buffers with half floats should not be bound otherwise.
+*/
+SbBool
+SoVBO::canRenderHalfFloats(const cc_glglue * glue)
+{
+  return
+    cc_glglue_glversion_matches_at_least(glue, 3, 0, 0) ||
+    cc_glglue_glext_supported(glue, "GL_ARB_half_float_vertex");
+}
+
+/*!
+  Returns the number of bytes of buffer data held by all VBOs in \a
+  numbytes, and the number of bytes the same data would have needed
+  without attribute compression in \a numuncompressedbytes.
+*/
+void
+SoVBO::getMemoryStatistics(size_t & numbytes, size_t & numuncompressedbytes)
+{
+  numbytes = static_cast<size_t>(vbo_numbytes.load());
+  numuncompressedbytes = static_cast<size_t>(vbo_numuncompressedbytes.load());
+}
+
 /*!
   Binds the buffer for the context \a contextid.
 */
@@ -306,7 +602,16 @@ SoVBO::bindBuffer(uint32_t contextid)
 
   const cc_glglue * glue = cc_glglue_instance((int) contextid);
 
+  // the same VBO may be bound from several render threads at once
+  // (see SoParallelRenderer), each with its own context
+  std::lock_guard<std::mutex> guard(sovbo_hash_mutex);
+
   GLuint buffer;
+  if (this->vbohash.get(contextid, buffer) &&
+      !SoGLResourceManagerP::touch(contextid, this)) {
+    // evicted by SoGLResourceManager, recreate it from our copy
+    this->vbohash.erase(contextid);
+  }
   if (!this->vbohash.get(contextid, buffer)) {
     // need to create a new buffer for this context
     cc_glglue_glGenBuffers(glue, 1, &buffer);
@@ -316,11 +621,14 @@ SoVBO::bindBuffer(uint32_t contextid)
                            this->data,
                            this->usage);
     this->vbohash.put(contextid, buffer);
+    SoGLResourceManagerP::add(contextid, SoGLResourceManager::BUFFER_OBJECT,
+                              this, this->datasize, buffer);
   }
   else {
     // buffer already exists, bind it
     cc_glglue_glBindBuffer(glue, this->target, buffer);
   }
+  SoRenderStatisticsP::count(SoRenderStatistics::BUFFER_BINDS);
 
 #if COIN_DEBUG
   if (vbo_debug) {
@@ -349,9 +657,12 @@ SoVBO::context_destruction_cb(uint32_t context, void * userdata)
   GLuint buffer;
   SoVBO * thisp = (SoVBO*) userdata;
 
+  std::lock_guard<std::mutex> guard(sovbo_hash_mutex);
   if (thisp->vbohash.get(context, buffer)) {
-    const cc_glglue * glue = cc_glglue_instance((int) context);
-    cc_glglue_glDeleteBuffers(glue, 1, &buffer);
+    if (SoGLResourceManagerP::remove(context, thisp)) {
+      const cc_glglue * glue = cc_glglue_instance((int) context);
+      cc_glglue_glDeleteBuffers(glue, 1, &buffer);
+    }
     thisp->vbohash.erase(context);
   }
 }
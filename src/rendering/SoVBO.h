@@ -38,11 +38,17 @@
 #endif /* !COIN_INTERNAL */
 
 #include <Inventor/system/gl.h>
+#include <Inventor/elements/SoGLVBOElement.h>
 #include "glue/glp.h"
 
 #include "misc/SbHash.h"
 
+#ifndef GL_HALF_FLOAT
+#define GL_HALF_FLOAT 0x140B
+#endif // GL_HALF_FLOAT
+
 class SoState;
+class SbVec3f;
 
 class SoVBO {
  public:
@@ -52,12 +58,34 @@ class SoVBO {
 
   static void init(void);
 
+  // public through SoGLVBOElement
+  enum AttributeCompression {
+    COMPRESS_NONE = SoGLVBOElement::COMPRESS_NONE,
+    COMPRESS_POSITIONS = SoGLVBOElement::COMPRESS_POSITIONS,
+    COMPRESS_NORMALS = SoGLVBOElement::COMPRESS_NORMALS,
+    COMPRESS_TEXCOORDS = SoGLVBOElement::COMPRESS_TEXCOORDS,
+    COMPRESS_ALL = SoGLVBOElement::COMPRESS_ALL
+  };
+
   void setBufferData(const GLvoid * data, intptr_t size, SbUniqueId dataid = 0);
   void * allocBufferData(intptr_t size, SbUniqueId dataid = 0);
   SbUniqueId getBufferDataId(void) const;
   void getBufferData(const GLvoid *& data, intptr_t & size);
   void bindBuffer(uint32_t contextid);
 
+  void setVertexData(const SbVec3f * vertices, const int num, SbUniqueId dataid);
+  void setNormalData(const SbVec3f * normals, const int num, SbUniqueId dataid);
+  void setTexCoordData(const float * texcoords, const int num, const int dim,
+                       SbUniqueId dataid);
+  GLenum getDataType(void) const;
+  GLsizei getStride(void) const;
+  SbBool getDecodeTransform(float & scale, float offset[3]) const;
+
+  static void setAttributeCompression(const uint32_t flags);
+  static uint32_t getAttributeCompression(void);
+  static SbBool canRenderHalfFloats(const cc_glglue * glue);
+  static void getMemoryStatistics(size_t & numbytes, size_t & numuncompressedbytes);
+
   static void setVertexCountLimits(const int minlimit, const int maxlimit);
   static int getVertexCountMinLimit(void);
   static int getVertexCountMaxLimit(void);
@@ -74,6 +102,7 @@ class SoVBO {
   static void context_destruction_cb(uint32_t context, void * userdata);
   friend struct vbo_schedule;
   static void vbo_delete(void * closure, uint32_t contextid);
+  void setDataSize(intptr_t size, intptr_t uncompressedsize);
 
   GLenum target;
   GLenum usage;
@@ -82,6 +111,13 @@ class SoVBO {
   SbUniqueId dataid;
   SbBool didalloc;
 
+  // layout of compressed attributes, see setVertexData()
+  GLenum datatype;
+  GLsizei stride;
+  intptr_t uncompressedsize;
+  float decodescale;
+  float decodeoffset[3];
+
   SbHash<uint32_t, GLuint> vbohash;
 };
 
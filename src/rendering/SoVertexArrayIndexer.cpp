@@ -40,13 +40,17 @@
 #include "rendering/SoVertexArrayIndexer.h"
 
 #include <cassert>
+#include <cmath>
 #include <cstring>
 #include <cstdio>
 
+#include <Inventor/SbBasic.h>
 #include <Inventor/elements/SoGLCacheContextElement.h>
+#include <Inventor/errors/SoDebugError.h>
 #include <Inventor/misc/SoGLDriverDatabase.h>
 
 #include "C/CoinTidbits.h"
+#include "misc/SoEnvironment.h"
 #include "rendering/SoVBO.h"
 #include "coindefs.h"
 
@@ -210,8 +214,16 @@ SoVertexArrayIndexer::endTarget(GLenum targetin)
 
 /*!
   Closes the indexer. This will reallocate the growable arrays to use as little
-  memory as possible. The indexer will also sort triangles and lines to
-  optimize rendering.
+  memory as possible. The indexer will also reorder triangles and sort
+  lines to optimize rendering.
+
+  Triangles are reordered for the post-transform vertex cache when
+  optimizeVertexCache() returns \c TRUE, and just sorted on their
+  vertex indices otherwise.
+
+  If the environment variable COIN_DEBUG_VERTEX_CACHE is set, the
+  average cache miss ratio (ACMR) of the triangles before and after
+  they are reordered is reported with SoDebugError::postInfo().
 */
 void
 SoVertexArrayIndexer::close(void)
@@ -228,7 +240,25 @@ SoVertexArrayIndexer::close(void)
     }
   }
   if (this->target == GL_TRIANGLES) {
-    this->sort_triangles();
+    static int debugcache = -1;
+    if (debugcache < 0) {
+      debugcache = CoinInternal::getEnvironmentVariableRaw("COIN_DEBUG_VERTEX_CACHE") ? 1 : 0;
+    }
+    const float acmr = debugcache ? this->getACMR(16) : 0.0f;
+
+    if (SoVertexArrayIndexer::optimizeVertexCache()) {
+      this->optimize_triangles();
+    }
+    else {
+      this->sort_triangles();
+    }
+
+    if (debugcache) {
+      SoDebugError::postInfo("SoVertexArrayIndexer::close",
+                             "%d triangles, ACMR %.3f -> %.3f (FIFO cache, 16 entries)",
+                             this->indexarray.getLength() / 3,
+                             acmr, this->getACMR(16));
+    }
   }
   else if (this->target == GL_LINES) {
     this->sort_lines();
@@ -435,6 +465,189 @@ SoVertexArrayIndexer::sort_triangles(void)
   }
 }
 
+// Vertex scoring from Tom Forsyth's "Linear-Speed Vertex Cache
+// Optimisation". The cache is modelled as an LRU cache of
+// VACACHE_SIZE vertices. Vertices used by the last triangle get a
+// fixed score, so that the next triangle doesn't have to share an edge
+// with it, and vertices with few remaining triangles are boosted, so
+// that they're finished off instead of left behind as lone triangles.
+#define VACACHE_SIZE 32
+
+struct vacache_scores {
+  float position[VACACHE_SIZE];
+  float valence[64];
+
+  vacache_scores(void) {
+    for (int i = 0; i < VACACHE_SIZE; i++) {
+      if (i < 3) {
+        this->position[i] = 0.75f;
+      }
+      else {
+        const float scaler = 1.0f / float(VACACHE_SIZE - 3);
+        this->position[i] = powf(1.0f - float(i - 3) * scaler, 1.5f);
+      }
+    }
+    this->valence[0] = 0.0f;
+    for (int i = 1; i < 64; i++) {
+      this->valence[i] = 2.0f / sqrtf(float(i));
+    }
+  }
+};
+
+static inline float
+vacache_vertex_score(const int cachepos, const int remaining)
+{
+  // initialized once, also when caches are built from several threads
+  static const vacache_scores scores;
+  if (remaining == 0) return -1.0f;
+  float score = (cachepos < 0) ? 0.0f : scores.position[cachepos];
+  score += (remaining < 64) ? scores.valence[remaining] : 2.0f / sqrtf(float(remaining));
+  return score;
+}
+
+//
+// reorder triangles for the post-transform vertex cache
+//
+void
+SoVertexArrayIndexer::optimize_triangles(void)
+{
+  const int numtri = this->indexarray.getLength() / 3;
+  if (numtri < 2) return;
+
+  GLint * idx = (GLint*) this->indexarray.getArrayPtr();
+  int32_t numv = 0;
+  for (int i = 0; i < numtri * 3; i++) {
+    if (idx[i] >= numv) numv = idx[i] + 1;
+  }
+
+  // triangles using each vertex, as offsets into a shared list
+  int32_t * remaining = new int32_t[numv];
+  int32_t * offset = new int32_t[numv+1];
+  int32_t * vtris = new int32_t[numtri*3];
+  int32_t * cachepos = new int32_t[numv];
+  float * vscore = new float[numv];
+  float * tscore = new float[numtri];
+  SbBool * added = new SbBool[numtri];
+  GLint * result = new GLint[numtri*3];
+
+  int32_t i;
+  for (i = 0; i < numv; i++) remaining[i] = 0;
+  for (i = 0; i < numtri * 3; i++) remaining[idx[i]]++;
+  offset[0] = 0;
+  for (i = 0; i < numv; i++) offset[i+1] = offset[i] + remaining[i];
+  for (i = 0; i < numv; i++) remaining[i] = 0;
+  for (i = 0; i < numtri * 3; i++) {
+    const int32_t v = idx[i];
+    vtris[offset[v] + remaining[v]++] = i / 3;
+  }
+  for (i = 0; i < numv; i++) {
+    cachepos[i] = -1;
+    vscore[i] = vacache_vertex_score(-1, remaining[i]);
+  }
+  for (i = 0; i < numtri; i++) {
+    added[i] = FALSE;
+    tscore[i] = vscore[idx[i*3]] + vscore[idx[i*3+1]] + vscore[idx[i*3+2]];
+  }
+
+  // the cache has room for the three vertices of the triangle being
+  // added before the least recently used vertices are pushed out
+  int32_t cache[VACACHE_SIZE + 3];
+  int cachesize = 0;
+  int numadded = 0;
+  int scanpos = 0;
+  int32_t best = -1;
+
+  while (numadded < numtri) {
+    if (best < 0) {
+      // nothing left in the cache, continue with the best of the
+      // triangles that haven't been added yet
+      float bestscore = -1.0f;
+      for (i = scanpos; i < numtri; i++) {
+        if (!added[i]) {
+          if (bestscore < 0.0f) scanpos = i;
+          if (tscore[i] > bestscore) {
+            bestscore = tscore[i];
+            best = i;
+          }
+          // the score is only a guide, don't scan everything
+          if (i - scanpos > VACACHE_SIZE) break;
+        }
+      }
+    }
+    assert(best >= 0);
+
+    const GLint * tri = idx + best * 3;
+    result[numadded*3] = tri[0];
+    result[numadded*3+1] = tri[1];
+    result[numadded*3+2] = tri[2];
+    added[best] = TRUE;
+    numadded++;
+
+    // move the triangle's vertices to the front of the cache, and
+    // remove the triangle from their lists of remaining triangles
+    int32_t newcache[VACACHE_SIZE + 3];
+    int newsize = 0;
+    int j;
+    for (j = 0; j < 3; j++) {
+      const int32_t v = tri[j];
+      newcache[newsize++] = v;
+      int32_t * list = vtris + offset[v];
+      for (int k = 0; k < remaining[v]; k++) {
+        if (list[k] == best) {
+          list[k] = list[remaining[v]-1];
+          break;
+        }
+      }
+      remaining[v]--;
+    }
+    for (j = 0; j < cachesize; j++) {
+      const int32_t v = cache[j];
+      if (v != tri[0] && v != tri[1] && v != tri[2]) newcache[newsize++] = v;
+    }
+
+    // rescore the vertices in the cache and the vertices that just
+    // fell out of it, and the triangles using them
+    for (j = 0; j < newsize; j++) {
+      const int32_t v = newcache[j];
+      cachepos[v] = (j < VACACHE_SIZE) ? j : -1;
+      const float score = vacache_vertex_score(cachepos[v], remaining[v]);
+      const float diff = score - vscore[v];
+      vscore[v] = score;
+      const int32_t * list = vtris + offset[v];
+      for (int k = 0; k < remaining[v]; k++) tscore[list[k]] += diff;
+    }
+    cachesize = SbMin(newsize, VACACHE_SIZE);
+    for (j = 0; j < cachesize; j++) cache[j] = newcache[j];
+
+    // the next triangle is the best triangle using a cached vertex
+    best = -1;
+    float bestscore = -1.0f;
+    for (j = 0; j < cachesize; j++) {
+      const int32_t v = cache[j];
+      const int32_t * list = vtris + offset[v];
+      for (int k = 0; k < remaining[v]; k++) {
+        if (tscore[list[k]] > bestscore) {
+          bestscore = tscore[list[k]];
+          best = list[k];
+        }
+      }
+    }
+  }
+
+  for (i = 0; i < numtri * 3; i++) idx[i] = result[i];
+
+  delete[] result;
+  delete[] added;
+  delete[] tscore;
+  delete[] vscore;
+  delete[] cachepos;
+  delete[] vtris;
+  delete[] offset;
+  delete[] remaining;
+}
+
+#undef VACACHE_SIZE
+
 //
 // sort lines to optimize rendering
 //
@@ -452,6 +665,94 @@ SoVertexArrayIndexer::sort_lines(void)
 
 }
 
+/*!
+  Returns \c TRUE if close() should reorder triangles for the
+  post-transform vertex cache. This is disabled by default, and can be
+  enabled by setting the environment variable
+  COIN_VERTEX_CACHE_OPTIMIZE to 1. The variable is only read once.
+*/
+SbBool
+SoVertexArrayIndexer::optimizeVertexCache(void)
+{
+  static int optimize = -1;
+  if (optimize < 0) {
+    const char * env = CoinInternal::getEnvironmentVariableRaw("COIN_VERTEX_CACHE_OPTIMIZE");
+    optimize = (env && atoi(env) != 0) ? 1 : 0;
+  }
+  return optimize ? TRUE : FALSE;
+}
+
+/*!
+  Returns the average cache miss ratio, which is the number of vertices
+  transformed per triangle, when the triangles in this indexer are
+  rendered through a FIFO vertex cache with \a cachesize entries. The
+  best possible ratio is about 0.5 for a regular mesh, and the worst
+  is 3. Returns 0 if the indexer doesn't contain triangles.
+*/
+float
+SoVertexArrayIndexer::getACMR(const int cachesize) const
+{
+  const int numindices = this->indexarray.getLength();
+  if (this->target != GL_TRIANGLES || numindices < 3) return 0.0f;
+
+  const GLint * idx = this->indexarray.getArrayPtr();
+  int32_t maxidx = 0;
+  for (int i = 0; i < numindices; i++) {
+    if (idx[i] > maxidx) maxidx = idx[i];
+  }
+
+  // a vertex is in the cache if fewer than cachesize vertices have
+  // been added since it was added itself
+  int32_t * stamp = new int32_t[maxidx+1];
+  for (int32_t i = 0; i <= maxidx; i++) stamp[i] = -1;
+  int32_t misses = 0;
+  for (int i = 0; i < numindices; i++) {
+    const int32_t v = idx[i];
+    if (stamp[v] < 0 || misses - stamp[v] >= cachesize) {
+      stamp[v] = misses++;
+    }
+  }
+  delete[] stamp;
+  return float(misses) / float(numindices / 3);
+}
+
+/*!
+  Assigns new vertex indices in the order the vertices are first used
+  by this indexer and the indexers following it. \a remap maps old to
+  new vertex indices, and must be initialized to -1 for every vertex.
+  \a numassigned is the number of indices assigned so far, and is
+  updated.
+
+  Together with remapIndices(), this is used to reorder the vertex
+  arrays so that vertices are fetched sequentially from memory.
+*/
+void
+SoVertexArrayIndexer::getFetchOrder(int32_t * remap, int32_t & numassigned) const
+{
+  const int numindices = this->indexarray.getLength();
+  const GLint * idx = this->indexarray.getArrayPtr();
+  for (int i = 0; i < numindices; i++) {
+    if (remap[idx[i]] < 0) remap[idx[i]] = numassigned++;
+  }
+  if (this->next) this->next->getFetchOrder(remap, numassigned);
+}
+
+/*!
+  Replaces every vertex index i in this indexer, and the indexers
+  following it, with remap[i]. Must be called after close().
+*/
+void
+SoVertexArrayIndexer::remapIndices(const int32_t * remap)
+{
+  assert(this->vbo == NULL && "indices can't be remapped after rendering");
+  const int numindices = this->indexarray.getLength();
+  GLint * idx = (GLint*) this->indexarray.getArrayPtr();
+  for (int i = 0; i < numindices; i++) {
+    idx[i] = remap[idx[i]];
+  }
+  if (this->next) this->next->remapIndices(remap);
+}
+
 /*!
   Returns the number of indices in the indexer.
 */
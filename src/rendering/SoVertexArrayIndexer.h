@@ -74,10 +74,17 @@ public:
   const GLint * getIndices(void) const;
   GLint * getWriteableIndices(void);
 
+  float getACMR(const int cachesize) const;
+  void getFetchOrder(int32_t * remap, int32_t & numassigned) const;
+  void remapIndices(const int32_t * remap);
+
+  static SbBool optimizeVertexCache(void);
+
 private:
   void addIndex(int32_t i);
   void sort_triangles(void);
   void sort_lines(void);
+  void optimize_triangles(void);
   SoVertexArrayIndexer * getNext(void);
 
   GLenum target;
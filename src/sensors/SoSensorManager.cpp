@@ -108,6 +108,7 @@
 #endif // COIN_THREADSAFE
 
 #include "misc/SbHash.h"
+#include "engines/SoEngineScheduler.h"
 #include "coindefs.h" // COIN_STUB()
 
 // *************************************************************************
@@ -538,8 +539,13 @@ SoSensorManager::processTimerQueue(void)
 
   A delay queue sensor with priority 0 is called an immediate sensor.
 
+  If scheduled engine evaluation is enabled, dirty engines are
+  evaluated after the immediate queue and before the delay queue
+  sensors are triggered.
+
   \sa SoDB::setDelaySensorTimeout()
   \sa SoSensorManager::processImmediateQueue()
+  \sa SoEngine::setScheduledEvaluation()
 */
 void
 SoSensorManager::processDelayQueue(SbBool isidle)
@@ -548,6 +554,10 @@ SoSensorManager::processDelayQueue(SbBool isidle)
 
   this->processImmediateQueue();
 
+  // bring engines up to date before sensors read from them
+  if (!PRIVATE(this)->processingdelayqueue && SoEngineScheduler::isEnabled())
+    SoEngineScheduler::evaluate();
+
   if (PRIVATE(this)->processingdelayqueue || PRIVATE(this)->delayqueue.getLength() == 0)
     return;
 
@@ -212,6 +212,7 @@
 #include <Inventor/elements/SoNormalBindingElement.h>
 #include <Inventor/elements/SoNormalElement.h>
 #include <Inventor/elements/SoShapeHintsElement.h>
+#include <Inventor/elements/SoShapeStyleElement.h>
 #include <Inventor/elements/SoTextureCoordinateBindingElement.h>
 #include <Inventor/elements/SoMultiTextureCoordinateElement.h>
 #include <Inventor/elements/SoVertexAttributeBindingElement.h>
@@ -229,6 +230,7 @@
 #include "rendering/SoVertexArrayIndexer.h"
 #include "rendering/SoVBO.h"
 #include "rendering/SoGL.h"
+#include "shapenodes/soshape_pvcache.h"
 
 // *************************************************************************
 
@@ -546,6 +548,9 @@ SoIndexedFaceSet::GLRender(SoGLRenderAction * action)
   const SoGLVBOElement * vboelem = SoGLVBOElement::getInstance(state);
   SoVBO * colorvbo = NULL;
 
+  SoVertexAttributeBundle vab(action, TRUE);
+  const SbBool doattribs = vab.doAttributes();
+
   SbBool didrenderasvbo = FALSE;
   if (dova && (mbind != OVERALL)) {
     dova = FALSE;
@@ -618,10 +623,35 @@ SoIndexedFaceSet::GLRender(SoGLRenderAction * action)
                             doTextures,
                             mbind != OVERALL);
   }
+  else if (!doattribs && !tb.isFunction() &&
+           !SoGLLazyElement::isColorIndex(state) &&
+           SoShapeStyleElement::getTransparencyType(state) != SoGLRenderAction::SCREEN_DOOR &&
+           SoVBO::shouldRenderAsVertexArrays(state, contextid, numindices) &&
+           SoGLDriverDatabase::isSupported(sogl_glue_instance(state), SO_GL_VERTEX_ARRAY) &&
+           soshape_pvcache::shouldRender(this, action)) {
+    // Per-face bindings, generated normals or tessellated faces can't
+    // be rendered from the indices in coordIndex. Render from the
+    // primitive vertex cache instead, which splits vertices wherever
+    // the attributes differ. It is built by generatePrimitives(),
+    // which takes the normal and convex cache locks itself.
+    //
+    // Like sogl_render_faceset(), the cache only varies the diffuse
+    // color and transparency per face or vertex, so the result is the
+    // same as in immediate mode. Color index mode and screen door
+    // transparency are sent differently by SoMaterialBundle, and are
+    // left to the immediate mode path.
+    if (normalCacheUsed) {
+      this->readUnlockNormalCache();
+      normalCacheUsed = FALSE;
+    }
+    if (convexcacheused) {
+      PRIVATE(this)->readUnlockConvexCache();
+      convexcacheused = FALSE;
+    }
+    soshape_pvcache::render(this, action);
+    didrenderasvbo = TRUE;
+  }
   else {
-    SoVertexAttributeBundle vab(action, TRUE);
-    SbBool doattribs = vab.doAttributes();
-
     SoVertexAttributeBindingElement::Binding attribbind = 
       SoVertexAttributeBindingElement::get(state);
 
@@ -80,6 +80,7 @@
 #include <Inventor/elements/SoGLLazyElement.h>
 #include <Inventor/elements/SoGLMultiTextureEnabledElement.h>
 #include <Inventor/elements/SoGLMultiTextureImageElement.h>
+#include <Inventor/elements/SoGLShaderProgramElement.h>
 #include <Inventor/elements/SoGLShapeHintsElement.h>
 #include <Inventor/elements/SoGLVBOElement.h>
 #include <Inventor/elements/SoGLVertexAttributeElement.h>
@@ -110,10 +111,12 @@
 
 #include "nodes/SoSubNodeP.h"
 #include "rendering/SoGL.h"
+#include "rendering/SoRenderStatisticsP.h"
 #include "glue/glp.h"
 #include "threads/threadsutilp.h"
 
 #include "rendering/SoVBO.h"
+#include "shaders/SoGLShaderProgram.h"
 #include "coindefs.h" // COIN_OBSOLETED()
 
 // SoShape.cpp grew too big, so I had to move some code into new
@@ -122,6 +125,7 @@
 #include "soshape_trianglesort.h"
 #include "soshape_bigtexture.h"
 #include "soshape_bumprender.h"
+#include "soshape_pvcache.h"
 
 // *************************************************************************
 
@@ -186,6 +190,7 @@ public:
     SHOULD_BBOX_CACHE = 0x1,
     NEED_SETUP_SHAPE_HINTS = 0x2,
     DISABLE_VERTEX_ARRAY_CACHE = 0x4,
+    PVCACHE_NODE_CHANGED = 0x8
   };
 
   static void calibrateBBoxCache(void);
@@ -205,28 +210,42 @@ public:
     // VRML97 support removed - this function is now a no-op
   }
 
-  // we can use a per-instance mutex here instead of this class-wide
-  // one, but we go for the class-wide one since at least Microsoft Windows
-  // might have a rather strict limit on the total amount of mutex
-  // resources a process / user can hold at any one time.
-  //
-  // i haven't looked too hard at the locked code regions, however --
-  // it might be that a class-wide lock can cause significantly less
-  // efficient execution in a multi-threaded environment. if so, we
-  // will have to come up with something smarter than this (a mutex
-  // pool or something, i suppose).
-  //
-  // -mortene.
+  // A per-instance mutex could hit the limit some systems (at least
+  // Microsoft Windows) have on the number of mutexes a process can
+  // hold, while a class-wide mutex makes threads rendering different
+  // shapes wait for each other. Instances are spread over a small
+  // pool of mutexes instead.
+  enum { MUTEX_POOL_SIZE = 64 };
   static SbMutex * mutex;
 
 #ifdef COIN_THREADSAFE
-  void lock(void) { SoShapeP::mutex->lock(); }
-  void unlock(void) { SoShapeP::mutex->unlock(); }
+  SbMutex * getMutex(void) {
+    const uintptr_t key = reinterpret_cast<uintptr_t>(this) / sizeof(SoShapeP);
+    return &SoShapeP::mutex[key % MUTEX_POOL_SIZE];
+  }
+  void lock(void) { this->getMutex()->lock(); }
+  void unlock(void) { this->getMutex()->unlock(); }
 #else // ! COIN_THREADSAFE
   void lock(void) { }
   void unlock(void) { }
 #endif // ! COIN_THREADSAFE
 
+  // returns the bounding box cache with an extra reference, so that
+  // it stays alive if another thread replaces it
+  SoBoundingBoxCache * refBBoxCache(void) {
+    this->lock();
+    SoBoundingBoxCache * cache = this->bboxcache;
+    if (cache) cache->ref();
+    this->unlock();
+    return cache;
+  }
+  void setBBoxCache(SoBoundingBoxCache * cache) {
+    this->lock();
+    if (this->bboxcache) this->bboxcache->unref();
+    this->bboxcache = cache;
+    this->unlock();
+  }
+
   static void cleanup(void);
 };
 
@@ -314,7 +333,7 @@ SoShapeP::cleanup(void)
   delete soshape_staticstorage;
   soshape_staticstorage = NULL;
 
-  delete SoShapeP::mutex;
+  delete[] SoShapeP::mutex;
   SoShapeP::mutex = NULL;
 }
 
@@ -350,7 +369,7 @@ SoShape::initClass(void)
   SO_NODE_INTERNAL_INIT_ABSTRACT_CLASS(SoShape, SO_FROM_INVENTOR_1);
 
 #ifdef COIN_THREADSAFE
-  SoShapeP::mutex = new SbMutex;
+  SoShapeP::mutex = new SbMutex[SoShapeP::MUTEX_POOL_SIZE];
 #endif // COIN_THREADSAFE
 
   soshape_staticstorage =
@@ -435,11 +454,13 @@ SoShape::rayPick(SoRayPickAction * action)
   if (this->shouldRayPick(action)) {
     this->computeObjectSpaceRay(action);
 
-    if (!PRIVATE(this)->bboxcache ||
-        !PRIVATE(this)->bboxcache->isValid(action->getState()) ||
-        soshape_ray_intersect(action, PRIVATE(this)->bboxcache->getProjectedBox())) {
+    SoBoundingBoxCache * bboxcache = PRIVATE(this)->refBBoxCache();
+    if (!bboxcache ||
+        !bboxcache->isValid(action->getState()) ||
+        soshape_ray_intersect(action, bboxcache->getProjectedBox())) {
       this->generatePrimitives(action);
     }
+    if (bboxcache) bboxcache->unref();
   }
 }
 
@@ -542,12 +563,12 @@ SoShape::shouldGLRender(SoGLRenderAction * action)
   if (shapestyleflags & SoShapeStyleElement::INVISIBLE)
     return FALSE;
 
-  if (PRIVATE(this)->bboxcache && !state->isCacheOpen() && !SoCullElement::completelyInside(state)) {
-    if (PRIVATE(this)->bboxcache->isValid(state)) {
-      if (SoCullElement::cullTest(state, PRIVATE(this)->bboxcache->getProjectedBox())) {
-        return FALSE;
-      }
-    }
+  if (!state->isCacheOpen() && !SoCullElement::completelyInside(state)) {
+    SoBoundingBoxCache * bboxcache = PRIVATE(this)->refBBoxCache();
+    const SbBool culled = bboxcache && bboxcache->isValid(state) &&
+      SoCullElement::cullTest(state, bboxcache->getProjectedBox());
+    if (bboxcache) bboxcache->unref();
+    if (culled) return FALSE;
   }
 
   SbBool transparent = (shapestyleflags & (SoShapeStyleElement::TRANSP_TEXTURE|
@@ -591,7 +612,7 @@ SoShape::shouldGLRender(SoGLRenderAction * action)
       if (nelem->getNum() == 0) {
         glPushAttrib(GL_LIGHTING_BIT);
         glDisable(GL_LIGHTING);
-        arrays &= SoPrimitiveVertexCache::NORMAL;
+        arrays &= ~SoPrimitiveVertexCache::NORMAL;
       }
       PRIVATE(this)->pvcache->renderLines(state, arrays);
       PRIVATE(this)->pvcache->renderPoints(state, arrays);
@@ -750,37 +771,9 @@ SoShape::shouldGLRender(SoGLRenderAction * action)
 
 
   if (shapestyleflags & SoShapeStyleElement::VERTEXARRAY) {
-    // lock since pvcache is shared among all threads
-    PRIVATE(this)->lock();
-    this->validatePVCache(action);
-    PRIVATE(this)->unlock();
-
     SoGLCacheContextElement::shouldAutoCache(state,
                                              SoGLCacheContextElement::DONT_AUTO_CACHE);
-    int arrays = SoPrimitiveVertexCache::NORMAL|SoPrimitiveVertexCache::COLOR;
-    SoGLMultiTextureImageElement::Model model;
-    SbColor blendcolor;
-    SoGLImage * glimage = SoGLMultiTextureImageElement::get(state, 0, model, blendcolor);
-    if (glimage) arrays |= SoPrimitiveVertexCache::TEXCOORD;
-    SoMaterialBundle mb(action);
-    mb.sendFirst();
-    PRIVATE(this)->setupShapeHints(this, state);
-    PRIVATE(this)->pvcache->renderTriangles(state, arrays);
-    if (PRIVATE(this)->pvcache->getNumLineIndices() ||
-        PRIVATE(this)->pvcache->getNumPointIndices()) {
-      const SoNormalElement * nelem = SoNormalElement::getInstance(state);
-      if (nelem->getNum() == 0) {
-        glPushAttrib(GL_LIGHTING_BIT);
-        glDisable(GL_LIGHTING);
-        arrays &= SoPrimitiveVertexCache::NORMAL;
-      }
-      PRIVATE(this)->pvcache->renderLines(state, arrays);
-      PRIVATE(this)->pvcache->renderPoints(state, arrays);
-
-      if (nelem->getNum() == 0) {
-        glPopAttrib();
-      }
-    }
+    soshape_pvcache::render(this, action);
     // we have rendered, return FALSE
     return FALSE;
   }
@@ -1064,6 +1057,7 @@ SoShape::invokeTriangleCallbacks(SoAction * const action,
       shapedata->currentbundle->send(v3->getMaterialIndex(), TRUE);
       glVertex3fv(v3->getPoint().getValue());
       glEnd();
+      SoRenderStatisticsP::countDraw(GL_TRIANGLES, 3);
       break;
     }
   }
@@ -1408,7 +1402,9 @@ SoShape::notify(SoNotList * nl)
   if (PRIVATE(this)->pvcache) {
     PRIVATE(this)->pvcache->invalidate();
   }
-  PRIVATE(this)->flags &= ~SoShapeP::SHOULD_BBOX_CACHE;
+  PRIVATE(this)->flags &= ~(SoShapeP::SHOULD_BBOX_CACHE|
+                            SoShapeP::DISABLE_VERTEX_ARRAY_CACHE);
+  PRIVATE(this)->flags |= SoShapeP::PVCACHE_NODE_CHANGED;
   PRIVATE(this)->rendercnt = 0;
   PRIVATE(this)->unlock();
 }
@@ -1435,67 +1431,73 @@ void
 SoShape::getBBox(SoAction * action, SbBox3f & box, SbVec3f & center)
 {
   SoState * state = action->getState();
-  SbBool isvalid = PRIVATE(this)->bboxcache && PRIVATE(this)->bboxcache->isValid(state);
-  if (isvalid) {
-    box = PRIVATE(this)->bboxcache->getProjectedBox();
-    // we know center will be set, so just fetch it from the cache
-    center = PRIVATE(this)->bboxcache->getCenter();
-
-    return;
-  }
-
-  // destroy the old cache if we have one
-  if (PRIVATE(this)->bboxcache) {
+  SoBoundingBoxCache * bboxcache = PRIVATE(this)->refBBoxCache();
+  if (bboxcache) {
+    if (bboxcache->isValid(state)) {
+      box = bboxcache->getProjectedBox();
+      // we know center will be set, so just fetch it from the cache
+      center = bboxcache->getCenter();
+      bboxcache->unref();
+      return;
+    }
+    // destroy the old cache, unless another thread has replaced it
     PRIVATE(this)->lock();
-    PRIVATE(this)->bboxcache->unref();
-    PRIVATE(this)->bboxcache = NULL;
-    PRIVATE(this)->unlock();
+    if (PRIVATE(this)->bboxcache == bboxcache) {
+      PRIVATE(this)->bboxcache->unref();
+      PRIVATE(this)->bboxcache = NULL;
+    }
     // don't create bbox caches for shapes that change
     PRIVATE(this)->flags &= ~SoShapeP::SHOULD_BBOX_CACHE;
+    PRIVATE(this)->unlock();
+    bboxcache->unref();
   }
 
+  // the flags are also changed by notify(), so they're only accessed
+  // while locked
+  PRIVATE(this)->lock();
   SbBool shouldcache = (PRIVATE(this)->flags & SoShapeP::SHOULD_BBOX_CACHE) != 0;
+  PRIVATE(this)->unlock();
   SbBool storedinvalid = FALSE;
   if (shouldcache) {
     // must push state to make cache dependencies work
     state->push();
     storedinvalid = SoCacheElement::setInvalid(FALSE);
-    assert(PRIVATE(this)->bboxcache == NULL);
-    PRIVATE(this)->lock();
-    PRIVATE(this)->bboxcache = new SoBoundingBoxCache(state);
-    PRIVATE(this)->bboxcache->ref();
-    PRIVATE(this)->unlock();
-    SoCacheElement::set(state, PRIVATE(this)->bboxcache);
+    bboxcache = new SoBoundingBoxCache(state);
+    bboxcache->ref();
+    SoCacheElement::set(state, bboxcache);
   }
   SbTime begin = SbTime::getTimeOfDay();
   this->computeBBox(action, box, center);
   SbTime end = SbTime::getTimeOfDay();
   if (shouldcache) {
-    PRIVATE(this)->bboxcache->set(box, TRUE, center);
+    bboxcache->set(box, TRUE, center);
     // pop state since we pushed it
     state->pop();
     SoCacheElement::setInvalid(storedinvalid);
+    // the cache is only made visible to other threads once it's
+    // complete
+    PRIVATE(this)->setBBoxCache(bboxcache);
   }
   // only create cache if calculating it took longer than the limit
   else if ((end.getValue() - begin.getValue()) >= SoShapeP::bboxcachetimelimit) {
+    PRIVATE(this)->lock();
     PRIVATE(this)->flags |= SoShapeP::SHOULD_BBOX_CACHE;
+    PRIVATE(this)->unlock();
     if (action->isOfType(SoGetBoundingBoxAction::getClassTypeId())) {
       // just recalculate the bbox so that the cache is created at
       // once. SoGLRenderAction and SoRayPickAction might need it.
       state->push();
       storedinvalid = SoCacheElement::setInvalid(FALSE);
-      assert(PRIVATE(this)->bboxcache == NULL);
-      PRIVATE(this)->lock();
-      PRIVATE(this)->bboxcache = new SoBoundingBoxCache(state);
-      PRIVATE(this)->bboxcache->ref();
-      PRIVATE(this)->unlock();
-      SoCacheElement::set(state, PRIVATE(this)->bboxcache);
+      bboxcache = new SoBoundingBoxCache(state);
+      bboxcache->ref();
+      SoCacheElement::set(state, bboxcache);
       box.makeEmpty();
       this->computeBBox(action, box, center);
-      PRIVATE(this)->bboxcache->set(box, TRUE, center);
+      bboxcache->set(box, TRUE, center);
       // pop state since we pushed it
       state->pop();
       SoCacheElement::setInvalid(storedinvalid);
+      PRIVATE(this)->setBBoxCache(bboxcache);
     }
   }
 }
@@ -1527,6 +1529,28 @@ SoShapeP::calibrateBBoxCache(void)
   SoShapeP::bboxcachetimelimit = end.getValue() - begin.getValue();
 }
 
+// Quantized positions are decoded on the modelview matrix, so
+// anything that reads the object space vertex (texture coordinate
+// generation and shader programs) would see the stored coordinates.
+// Returns TRUE if the positions in vbo can be decoded that way.
+static SbBool
+soshape_use_quantized_positions(SoState * state, SoVBO * vbo)
+{
+  float scale, offset[3];
+  if (!vbo || !vbo->getDecodeTransform(scale, offset)) return FALSE;
+
+  SoGLShaderProgram * prog = SoGLShaderProgramElement::get(state);
+  if (prog && prog->isEnabled()) return FALSE;
+
+  int lastenabled = -1;
+  (void) SoMultiTextureEnabledElement::getEnabledUnits(state, lastenabled);
+  for (int i = 0; i <= SbMax(lastenabled, 0); i++) {
+    if (SoMultiTextureCoordinateElement::getType(state, i) ==
+        SoMultiTextureCoordinateElement::TEXGEN) return FALSE;
+  }
+  return TRUE;
+}
+
 /*!
   Convenience method that enables vertex arrays and/or VBOs
   Returns \e TRUE if VBO is used.
@@ -1617,7 +1641,16 @@ SoShape::startVertexArray(SoGLRenderAction * action,
 	  cc_glglue_glClientActiveTexture(glue, GL_TEXTURE0 + i);
 	}
         vbo = dovbo ? vboelem->getTexCoordVBO(i) : NULL;
+        if (vbo && (vbo->getDataType() == GL_HALF_FLOAT) &&
+            !SoVBO::canRenderHalfFloats(glue)) {
+          // use the uncompressed coordinates in the element instead
+          vbo = NULL;
+        }
+        GLenum type = GL_FLOAT;
+        GLsizei stride = 0;
         if (vbo) {
+          type = vbo->getDataType();
+          stride = vbo->getStride();
           vbo->bindBuffer(contextid);
           didbind = TRUE;
           tptr = NULL;
@@ -1628,7 +1661,7 @@ SoShape::startVertexArray(SoGLRenderAction * action,
             didbind = FALSE;
           }
         }
-        cc_glglue_glTexCoordPointer(glue, dim, GL_FLOAT, 0, tptr);
+        cc_glglue_glTexCoordPointer(glue, dim, type, stride, tptr);
         cc_glglue_glEnableClientState(glue, GL_TEXTURE_COORD_ARRAY);
       }
     }
@@ -1636,9 +1669,13 @@ SoShape::startVertexArray(SoGLRenderAction * action,
   if (pervertexnormals != NULL) {
     SoVBO * vbo = dovbo ? vboelem->getNormalVBO() : NULL;
     const GLvoid * dataptr = NULL;
+    GLenum type = GL_FLOAT;
+    GLsizei stride = 0;
     if (vbo) {
       vbo->bindBuffer(contextid);
       didbind = TRUE;
+      type = vbo->getDataType();
+      stride = vbo->getStride();
     }
     else {
       dataptr = (const GLvoid*) pervertexnormals;
@@ -1647,19 +1684,39 @@ SoShape::startVertexArray(SoGLRenderAction * action,
         didbind = FALSE;
       }
     }
-    cc_glglue_glNormalPointer(glue, GL_FLOAT, 0, dataptr);
+    cc_glglue_glNormalPointer(glue, type, stride, dataptr);
     cc_glglue_glEnableClientState(glue, GL_NORMAL_ARRAY);
   }
   const GLvoid * dataptr = NULL;
+  GLenum type = GL_FLOAT;
+  GLsizei stride = 0;
+  float scale, offset[3];
+  if (vertexvbo && vertexvbo->getDecodeTransform(scale, offset) &&
+      !soshape_use_quantized_positions(state, vertexvbo)) {
+    // send the uncompressed positions from the client side instead
+    vertexvbo = NULL;
+  }
   if (vertexvbo) {
     vertexvbo->bindBuffer(contextid);
+    type = vertexvbo->getDataType();
+    stride = vertexvbo->getStride();
+    if (vertexvbo->getDecodeTransform(scale, offset)) {
+      // quantized positions, undone in finishVertexArray()
+      glPushMatrix();
+      glTranslatef(offset[0], offset[1], offset[2]);
+      glScalef(scale, scale, scale);
+    }
   }
   else {
+    if (didbind) {
+      cc_glglue_glBindBuffer(glue, GL_ARRAY_BUFFER, 0);
+      didbind = FALSE;
+    }
     dataptr = coords->is3D() ?
       ((const GLvoid *)coords->getArrayPtr3()) :
       ((const GLvoid *)coords->getArrayPtr4());
   }
-  cc_glglue_glVertexPointer(glue, coords->is3D() ? 3 : 4, GL_FLOAT, 0,
+  cc_glglue_glVertexPointer(glue, coords->is3D() ? 3 : 4, type, stride,
                             dataptr);
   cc_glglue_glEnableClientState(glue, GL_VERTEX_ARRAY);
 
@@ -1694,6 +1751,11 @@ SoShape::finishVertexArray(SoGLRenderAction * action,
     }
     // unset VBO buffer
     cc_glglue_glBindBuffer(glue, GL_ARRAY_BUFFER, 0);
+
+    SoVBO * vertexvbo = SoGLVBOElement::getInstance(state)->getVertexVBO();
+    if (soshape_use_quantized_positions(state, vertexvbo)) {
+      glPopMatrix();
+    }
   }
   cc_glglue_glDisableClientState(glue, GL_VERTEX_ARRAY);
   if (normpervertex) {
@@ -1731,6 +1793,89 @@ SoShape::finishVertexArray(SoGLRenderAction * action,
   SoGLVertexAttributeElement::getInstance(state)->disableVBO(action);
 }
 
+// *************************************************************************
+
+/*
+  Returns TRUE if it will pay off to render the shape with render().
+  This is the case if the cache is already valid, or if the shape has
+  been rendered at least once since it was last changed, so that the
+  cache is likely to be reused.
+
+  If the cache is invalidated by a state change while the node itself
+  is unchanged (an animated material, for instance), the cache is not
+  used again until the node changes.
+*/
+SbBool
+soshape_pvcache::shouldRender(SoShape * shape, SoGLRenderAction * action)
+{
+  PRIVATE(shape)->lock();
+  SbBool ok = FALSE;
+  if (!(PRIVATE(shape)->flags & SoShapeP::DISABLE_VERTEX_ARRAY_CACHE)) {
+    if (PRIVATE(shape)->pvcache &&
+        !(PRIVATE(shape)->flags & SoShapeP::PVCACHE_NODE_CHANGED)) {
+      ok = PRIVATE(shape)->pvcache->isValid(action->getState());
+      if (!ok) PRIVATE(shape)->flags |= SoShapeP::DISABLE_VERTEX_ARRAY_CACHE;
+    }
+    else {
+      ok = PRIVATE(shape)->rendercnt >= 2;
+    }
+  }
+  PRIVATE(shape)->unlock();
+  return ok;
+}
+
+/*
+  Renders the shape from its primitive vertex cache, creating the cache
+  from generatePrimitives() first if needed. The cache stores one
+  vertex for every unique combination of coordinate, normal, color and
+  texture coordinate, so shapes with any normal and material binding
+  can be rendered from vertex arrays or VBOs this way.
+
+  The caller must not hold any locks which are taken by
+  generatePrimitives().
+*/
+void
+soshape_pvcache::render(SoShape * shape, SoGLRenderAction * action)
+{
+  SoState * state = action->getState();
+
+  // lock since pvcache is shared among all threads
+  PRIVATE(shape)->lock();
+  shape->validatePVCache(action);
+  // keep the cache alive if another thread replaces it while we render
+  SoPrimitiveVertexCache * pvcache = PRIVATE(shape)->pvcache;
+  pvcache->ref();
+  PRIVATE(shape)->unlock();
+
+  int arrays = SoPrimitiveVertexCache::NORMAL|SoPrimitiveVertexCache::COLOR;
+  SoGLMultiTextureImageElement::Model model;
+  SbColor blendcolor;
+  SoGLImage * glimage = SoGLMultiTextureImageElement::get(state, 0, model, blendcolor);
+  if (glimage) arrays |= SoPrimitiveVertexCache::TEXCOORD;
+  SoMaterialBundle mb(action);
+  mb.sendFirst();
+  PRIVATE(shape)->setupShapeHints(shape, state);
+  pvcache->renderTriangles(state, arrays);
+  if (pvcache->getNumLineIndices() ||
+      pvcache->getNumPointIndices()) {
+    const SoNormalElement * nelem = SoNormalElement::getInstance(state);
+    if (nelem->getNum() == 0) {
+      glPushAttrib(GL_LIGHTING_BIT);
+      glDisable(GL_LIGHTING);
+      arrays &= ~SoPrimitiveVertexCache::NORMAL;
+    }
+    pvcache->renderLines(state, arrays);
+    pvcache->renderPoints(state, arrays);
+
+    if (nelem->getNum() == 0) {
+      glPopAttrib();
+    }
+  }
+  pvcache->unref();
+}
+
+// *************************************************************************
+
 void
 SoShape::validatePVCache(SoGLRenderAction * action)
 {
@@ -1763,6 +1908,7 @@ SoShape::validatePVCache(SoGLRenderAction * action)
     state->pop();
     SoCacheElement::setInvalid(storedinvalid);
     PRIVATE(this)->pvcache->close(state);
+    PRIVATE(this)->flags &= ~SoShapeP::PVCACHE_NODE_CHANGED;
     PRIVATE(this)->testSetupShapeHints(this);
   }
 }
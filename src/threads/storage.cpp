@@ -93,6 +93,8 @@ cc_storage_init(unsigned int size, void (*constructor)(void *),
   storage->constructor = constructor;
   storage->destructor = destructor;
   storage->dict = cc_dict_construct(8, 0.75f);
+  storage->slot = 0;
+  storage->serial = 0;
 #ifdef HAVE_THREADS
   storage->mutex = cc_mutex_construct();
 #endif /* HAVE_THREADS */
@@ -159,7 +161,13 @@ cc_storage_destruct(cc_storage * storage)
 void *
 cc_storage_get(cc_storage * storage)
 {
-  void * val;
+  // fast path: the calling thread has looked up this storage before
+  void * val = CoinInternal::StorageSlotTable::get(storage);
+  if (val) return val;
+
+  // read before the dictionary lookup, so that a cleanup running
+  // concurrently invalidates the slot table entry stored below
+  const unsigned int epoch = CoinInternal::StorageSlotTable::getCleanupEpoch();
   unsigned long threadid = 0;
 
 #ifdef HAVE_THREADS
@@ -186,6 +194,7 @@ cc_storage_get(cc_storage * storage)
   cc_mutex_unlock(storage->mutex);
 #endif /* HAVE_THREADS */
 
+  CoinInternal::StorageSlotTable::set(storage, val, epoch);
   return val;
 }
 
@@ -45,6 +45,7 @@
 #include "coindefs.h"
 
 #include <cassert>
+#include <cstdlib>
 #include <exception>
 #include <iostream>
 #include <mutex>
@@ -73,17 +74,46 @@ void StorageRegistry::registerStorage(cc_storage* storage) {
     
     std::unique_lock<std::shared_mutex> lock(registry_mutex);
     registered_storages.insert(storage);
+
+    // Reuse slot indices to keep the per-thread tables small. The
+    // serial number tells the new storage apart from the old one.
+    if (!free_slots.empty()) {
+        storage->slot = free_slots.back();
+        free_slots.pop_back();
+    } else {
+        storage->slot = num_slots++;
+    }
+    storage->serial = next_serial++;
 }
 
 void StorageRegistry::unregisterStorage(cc_storage* storage) {
     if (!storage) return;
     
     std::unique_lock<std::shared_mutex> lock(registry_mutex);
-    registered_storages.erase(storage);
+    if (registered_storages.erase(storage)) {
+        free_slots.push_back(storage->slot);
+    }
+}
+
+void StorageRegistry::registerSlotTable(unsigned long threadid, std::atomic<unsigned int>* cleanups) {
+    std::unique_lock<std::shared_mutex> lock(registry_mutex);
+    slot_table_cleanups[threadid] = cleanups;
+}
+
+void StorageRegistry::unregisterSlotTable(unsigned long threadid) {
+    std::unique_lock<std::shared_mutex> lock(registry_mutex);
+    slot_table_cleanups.erase(threadid);
 }
 
 void StorageRegistry::cleanupThread(unsigned long threadid) {
     std::shared_lock<std::shared_mutex> lock(registry_mutex);
+
+    // The data about to be freed may be referenced from the slot
+    // table of the thread, but not from those of other threads
+    auto table = slot_table_cleanups.find(threadid);
+    if (table != slot_table_cleanups.end()) {
+        table->second->fetch_add(1, std::memory_order_acq_rel);
+    }
     
     // Iterate through all registered storage objects and clean up
     // the specified thread's data from each one
@@ -141,6 +171,64 @@ unsigned long StorageRegistry::getCurrentThreadId() {
     return cc_thread_id();
 }
 
+// Slot table implementation
+void StorageSlotTable::set(const cc_storage* storage, void* data, unsigned int cleanupepoch) {
+    Table& table = local;
+    // Storage used by thread_local destructors running after the
+    // table was released is looked up in the dictionaries only
+    if (table.released) return;
+    if (cleanupepoch != table.cleanups.load(std::memory_order_acquire)) {
+        // The thread was cleaned up while the data was looked up
+        return;
+    }
+    if (table.epoch != cleanupepoch) {
+        // Filled before a cleanup, forget all entries
+        for (unsigned int i = 0; i < table.numslots; i++) {
+            table.slots[i].serial = 0;
+            table.slots[i].data = NULL;
+        }
+        table.epoch = cleanupepoch;
+    }
+    if (storage->slot >= table.numslots) {
+        unsigned int newsize = table.numslots ? table.numslots : 16;
+        while (newsize <= storage->slot) newsize *= 2;
+        Slot* newslots = static_cast<Slot*>(realloc(table.slots, newsize * sizeof(Slot)));
+        if (!newslots) return;
+        for (unsigned int i = table.numslots; i < newsize; i++) {
+            newslots[i].serial = 0;
+            newslots[i].data = NULL;
+        }
+        table.slots = newslots;
+        table.numslots = newsize;
+    }
+    table.slots[storage->slot].serial = storage->serial;
+    table.slots[storage->slot].data = data;
+}
+
+unsigned int StorageSlotTable::getCleanupEpoch() {
+    Table& table = local;
+    // Registered before the caller looks up the data, so that a
+    // cleanup of the thread from now on is seen by set()
+    if (!table.registered && !table.released) {
+        StorageRegistry::getInstance().registerSlotTable(StorageRegistry::getCurrentThreadId(),
+                                                         &table.cleanups);
+        table.registered = true;
+    }
+    return table.cleanups.load(std::memory_order_acquire);
+}
+
+void StorageSlotTable::release() {
+    Table& table = local;
+    if (table.registered) {
+        StorageRegistry::getInstance().unregisterSlotTable(StorageRegistry::getCurrentThreadId());
+        table.registered = false;
+    }
+    free(table.slots);
+    table.slots = NULL;
+    table.numslots = 0;
+    table.released = true;
+}
+
 // Thread cleanup trigger implementation
 ThreadCleanupTrigger::ThreadCleanupTrigger() 
     : thread_id(StorageRegistry::getCurrentThreadId()) {
@@ -152,6 +240,7 @@ ThreadCleanupTrigger::~ThreadCleanupTrigger() {
         // When this destructor runs, the thread is exiting
         // Trigger cleanup for all storage objects
         StorageRegistry::getInstance().cleanupThread(thread_id);
+        StorageSlotTable::release();
     } catch (...) {
         // Swallow all exceptions in destructor to prevent terminate()
         // This is critical for thread exit scenarios
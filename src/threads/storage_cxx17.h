@@ -45,6 +45,9 @@
  * - Enhanced thread safety using C++17 threading primitives
  * - Better exception safety in constructor/destructor callbacks
  * - Global storage registry for comprehensive thread cleanup
+ * - Lock-free lookup of the calling thread's data through a thread_local
+ *   slot table, with the registry and dictionary only used on first
+ *   access and for cleanup
  */
 
 #ifndef COIN_INTERNAL
@@ -60,6 +63,8 @@
 #include <shared_mutex>
 #include <thread>
 #include <functional>
+#include <atomic>
+#include <vector>
 
 #ifdef __cplusplus
 extern "C" {
@@ -129,12 +134,18 @@ public:
 
     /*!
      * \brief Register a storage object for thread cleanup
+     *
+     * Also assigns the storage its slot index and serial number.
+     *
      * \param storage Pointer to the storage object to register
      */
     void registerStorage(cc_storage* storage);
 
     /*!
      * \brief Unregister a storage object from thread cleanup
+     *
+     * The slot index is made available for reuse.
+     *
      * \param storage Pointer to the storage object to unregister
      */
     void unregisterStorage(cc_storage* storage);
@@ -151,6 +162,23 @@ public:
      */
     static unsigned long getCurrentThreadId();
 
+    /*!
+     * \brief Register the cleanup counter of a thread's slot table
+     *
+     * cleanupThread() increments the counter of the thread it cleans
+     * up, so that only that thread's table is invalidated.
+     *
+     * \param threadid The ID of the thread owning the table
+     * \param cleanups The cleanup counter of the table
+     */
+    void registerSlotTable(unsigned long threadid, std::atomic<unsigned int>* cleanups);
+
+    /*!
+     * \brief Unregister a thread's slot table before it is freed
+     * \param threadid The ID of the thread owning the table
+     */
+    void unregisterSlotTable(unsigned long threadid);
+
 private:
     StorageRegistry() = default;
     ~StorageRegistry() = default;
@@ -159,6 +187,80 @@ private:
 
     mutable std::shared_mutex registry_mutex;
     std::unordered_set<cc_storage*> registered_storages;
+    std::vector<unsigned int> free_slots;
+    unsigned int num_slots = 0;
+    uint64_t next_serial = 1;
+    std::unordered_map<unsigned long, std::atomic<unsigned int>*> slot_table_cleanups;
+};
+
+/*!
+ * \brief Per-thread table of storage data, indexed by storage slot
+ *
+ * The table does not own the data blocks, they are owned by the
+ * storage dictionaries. An entry is only used if its serial number
+ * matches the storage, so entries left behind by destructed storage
+ * objects are never returned. The table is cleared when the thread
+ * owning it has been cleaned up since it was filled.
+ */
+class StorageSlotTable {
+public:
+    /*!
+     * \brief Look up the calling thread's data for a storage
+     * \return The data block, or NULL if it is not in the table
+     */
+    static void* get(const cc_storage* storage) {
+        const Table& table = local;
+        if (storage->slot < table.numslots &&
+            table.epoch == table.cleanups.load(std::memory_order_acquire)) {
+            const Slot& entry = table.slots[storage->slot];
+            if (entry.serial == storage->serial) return entry.data;
+        }
+        return NULL;
+    }
+
+    /*!
+     * \brief Store the calling thread's data for a storage
+     * \param storage The storage the data belongs to
+     * \param data The data block
+     * \param cleanupepoch The cleanup epoch read before the data was looked up
+     */
+    static void set(const cc_storage* storage, void* data, unsigned int cleanupepoch);
+
+    /*!
+     * \brief Get the number of cleanups of the calling thread done so far
+     *
+     * Entries filled before a cleanup are not trusted after it. Read
+     * this before looking up the data passed to set().
+     */
+    static unsigned int getCleanupEpoch();
+
+    /*!
+     * \brief Free the calling thread's table
+     *
+     * Called at thread exit. Later set() calls from the thread are
+     * ignored, so that the table isn't allocated again.
+     */
+    static void release();
+
+private:
+    struct Slot {
+        uint64_t serial;
+        void* data;
+    };
+    // Kept trivially destructible so that the table is still usable
+    // from other thread_local destructors running at thread exit. One
+    // object, so that a lookup only resolves one thread_local address.
+    struct Table {
+        Slot* slots;
+        unsigned int numslots;
+        unsigned int epoch;
+        // incremented by StorageRegistry::cleanupThread(), possibly
+        // from another thread
+        std::atomic<unsigned int> cleanups;
+        bool registered;
+        bool released;
+    };
+    static inline thread_local Table local = { NULL, 0, 0, {0}, false, false };
 };
 
 /*!
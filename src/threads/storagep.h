@@ -40,6 +40,7 @@
 #include "threads/threads.h"
 
 #include "base/dict.h"
+#include <stdint.h>
 #ifdef HAVE_CONFIG_H
 #include <config.h>
 #endif /* HAVE_CONFIG_H */
@@ -56,6 +57,10 @@ extern "C" {
     void (*destructor)(void *);
     cc_dict * dict;
     cc_mutex * mutex;
+    /* index into the per-thread slot tables, and a serial number
+       telling this storage apart from earlier users of the index */
+    unsigned int slot;
+    uint64_t serial;
   };
   
   void cc_storage_thread_cleanup(unsigned long threadid);
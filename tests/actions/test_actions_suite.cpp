@@ -50,13 +50,30 @@
 #include <Inventor/actions/SoCallbackAction.h>
 #include <Inventor/actions/SoSearchAction.h>
 #include <Inventor/actions/SoGetBoundingBoxAction.h>
+#include <Inventor/actions/SoIdBufferPickAction.h>
 #include <Inventor/actions/SoWriteAction.h>
+#include <Inventor/actions/SoRayPickAction.h>
+#include <Inventor/SoPickedPoint.h>
+#include <Inventor/SoPath.h>
 #include <Inventor/nodes/SoSeparator.h>
 #include <Inventor/nodes/SoSwitch.h>
 #include <Inventor/nodes/SoCube.h>
+#include <Inventor/nodes/SoPerspectiveCamera.h>
+#include <Inventor/nodes/SoCallback.h>
+#include <Inventor/nodes/SoGroup.h>
+#include <Inventor/nodes/SoTranslation.h>
+#include <Inventor/nodes/SoTexture2.h>
+#include <Inventor/nodes/SoSphere.h>
+#include <Inventor/nodes/SoCone.h>
+#include <Inventor/nodes/SoRotation.h>
+#include <Inventor/nodes/SoOrthographicCamera.h>
+#include <Inventor/elements/SoModelMatrixElement.h>
+#include <Inventor/elements/SoMultiTextureImageElement.h>
+#include <Inventor/misc/SoState.h>
 
 #include <cstring>
 #include <cstdlib>
+#include <vector>
 
 using namespace SimpleTest;
 
@@ -71,6 +88,25 @@ collectNames(void* userdata, SoCallbackAction*, const SoNode* node)
     return SoCallbackAction::CONTINUE;
 }
 
+// ---------------------------------------------------------------------------
+// Helper for the state reuse test: records texture and matrix state
+// ---------------------------------------------------------------------------
+struct StateProbe {
+    const unsigned char* image;
+    SbVec2s size;
+    SbMatrix matrix;
+};
+
+static void
+probeState(void* userdata, SoAction* action)
+{
+    StateProbe* probe = static_cast<StateProbe*>(userdata);
+    SoState* state = action->getState();
+    int nc = 0;
+    probe->image = SoMultiTextureImageElement::getImage(state, 0, probe->size, nc);
+    probe->matrix = SoModelMatrixElement::get(state);
+}
+
 // ---------------------------------------------------------------------------
 // Helper for write-action tests: growable buffer
 // ---------------------------------------------------------------------------
@@ -84,6 +120,63 @@ static void* bufferRealloc(void* ptr, size_t size)
     return s_buffer;
 }
 
+// ---------------------------------------------------------------------------
+// Helper: SoCallback callback counting bounding box traversals
+// ---------------------------------------------------------------------------
+static void
+countBBoxTraversals(void* userdata, SoAction* action)
+{
+    if (action->isOfType(SoGetBoundingBoxAction::getClassTypeId())) {
+        ++(*static_cast<int*>(userdata));
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Helpers for the batched ray pick tests: a scene with shapes at
+// different transforms, and comparison of picked point lists
+// ---------------------------------------------------------------------------
+static SoSeparator*
+createPickScene(void)
+{
+    SoSeparator* root = new SoSeparator;
+    root->ref();
+    SoOrthographicCamera* camera = new SoOrthographicCamera;
+    camera->position.setValue(0.0f, 0.0f, 20.0f);
+    camera->height = 16.0f;
+    camera->nearDistance = 1.0f;
+    camera->farDistance = 40.0f;
+    root->addChild(camera);
+    for (int i = 0; i < 12; i++) {
+        SoSeparator* sep = new SoSeparator;
+        SoTranslation* move = new SoTranslation;
+        move->translation.setValue(float(i % 4) * 3.5f - 5.25f, float(i / 4) * 3.5f - 3.5f,
+                                   float(i % 3) - 1.0f);
+        sep->addChild(move);
+        SoRotation* rotation = new SoRotation;
+        rotation->rotation.setValue(SbVec3f(1.0f, 1.0f, 0.0f), float(i) * 0.3f);
+        sep->addChild(rotation);
+        switch (i % 3) {
+        case 0: sep->addChild(new SoCube); break;
+        case 1: sep->addChild(new SoSphere); break;
+        default: sep->addChild(new SoCone); break;
+        }
+        root->addChild(sep);
+    }
+    return root;
+}
+
+static bool
+samePickedPoints(const SoPickedPointList& a, const SoPickedPointList& b)
+{
+    if (a.getLength() != b.getLength()) return false;
+    for (int i = 0; i < a.getLength(); i++) {
+        if ((a[i]->getPoint() - b[i]->getPoint()).length() > 1e-4f) return false;
+        if ((a[i]->getNormal() - b[i]->getNormal()).length() > 1e-4f) return false;
+        if (!(*a[i]->getPath() == *b[i]->getPath())) return false;
+    }
+    return true;
+}
+
 int main()
 {
     TestFixture fixture;
@@ -242,5 +335,247 @@ int main()
             "SoGetBoundingBoxAction unit cube returned wrong bounds");
     }
 
+    // -----------------------------------------------------------------------
+    // SoGetBoundingBoxAction: subgraph caching only re-traverses the
+    // separators below a modified node, and never caches OFF separators
+    // -----------------------------------------------------------------------
+    runner.startTest("SoGetBoundingBoxAction subgraph caching");
+    {
+        SoGroup* root = new SoGroup;
+        root->ref();
+        int counts[2] = { 0, 0 };
+        SoSeparator* seps[2];
+        SoTranslation* trans[2];
+        for (int i = 0; i < 2; i++) {
+            seps[i] = new SoSeparator;
+            SoCallback* cb = new SoCallback;
+            cb->setCallback(countBBoxTraversals, &counts[i]);
+            trans[i] = new SoTranslation;
+            trans[i]->translation = SbVec3f(i * 4.0f, 0.0f, 0.0f);
+            seps[i]->addChild(cb);
+            seps[i]->addChild(trans[i]);
+            seps[i]->addChild(new SoCube);
+            root->addChild(seps[i]);
+        }
+
+        SoGetBoundingBoxAction bba(SbViewportRegion(100, 100));
+        bba.setSubgraphCaching(TRUE);
+
+        bba.apply(root);
+        bool pass = bba.isSubgraphCaching() && counts[0] == 1 && counts[1] == 1;
+
+        // unchanged scene: nothing below the root is traversed
+        bba.apply(root);
+        pass = pass && counts[0] == 1 && counts[1] == 1 &&
+               bba.getBoundingBox().getMax() == SbVec3f(5.0f, 1.0f, 1.0f);
+
+        // a change in the second separator leaves the first one cached
+        trans[1]->translation = SbVec3f(10.0f, 0.0f, 0.0f);
+        bba.apply(root);
+        pass = pass && counts[0] == 1 && counts[1] == 2 &&
+               bba.getBoundingBox().getMax() == SbVec3f(11.0f, 1.0f, 1.0f);
+
+        // an explicit OFF wins over the action's subgraph caching
+        seps[0]->boundingBoxCaching = SoSeparator::OFF;
+        bba.apply(root);
+        pass = pass && counts[0] == 2 && counts[1] == 2;
+        trans[1]->translation = SbVec3f(12.0f, 0.0f, 0.0f);
+        bba.apply(root);
+        pass = pass && counts[0] == 3 && counts[1] == 3 &&
+               bba.getBoundingBox().getMax() == SbVec3f(13.0f, 1.0f, 1.0f);
+
+        root->unref();
+        runner.endTest(pass, pass ? "" :
+            "SoGetBoundingBoxAction subgraph caching traversed unchanged "
+            "subgraphs, cached an OFF separator or returned wrong bounds");
+    }
+
+    // -----------------------------------------------------------------------
+    // SoIdBufferPickAction: identifiers map back to shapes and primitives.
+    // Without an offscreen context the buffer is invalid and queries miss.
+    // -----------------------------------------------------------------------
+    runner.startTest("SoIdBufferPickAction point and area queries");
+    {
+        SoSeparator* root = new SoSeparator;
+        root->ref();
+        SoPerspectiveCamera* camera = new SoPerspectiveCamera;
+        root->addChild(camera);
+        SoCube* cube = new SoCube;
+        root->addChild(cube);
+
+        const SbViewportRegion vp(64, 64);
+        camera->viewAll(root, vp);
+
+        SoIdBufferPickAction ida(vp);
+        ida.apply(root);
+
+        const SbVec2s center(32, 32);
+        const SbVec2s lasso[3] = { SbVec2s(0, 0), SbVec2s(63, 0), SbVec2s(32, 63) };
+        SbList<int32_t> rectids, lassoids;
+        ida.pickRectangle(SbVec2s(0, 0), SbVec2s(63, 63), rectids);
+        ida.pickLasso(lasso, 3, lassoids);
+        const int32_t id = ida.pickPoint(center);
+
+        bool pass = ida.getPath(0) == NULL && ida.getPrimitiveIndex(-1) == -1;
+        if (ida.isBufferValid()) {
+            // a cube has 12 triangles, seen from the front 2 of them
+            // cover the center pixel
+            const SoPath* path = id ? ida.getPath(id) : NULL;
+            pass = pass && ida.getNumIds() == 13 && path &&
+                   path->getTail() == cube &&
+                   ida.getFirstId(path) == 1 &&
+                   ida.getPrimitiveIndex(id) == id - 1 &&
+                   rectids.find(id) != -1 && lassoids.find(id) != -1;
+            for (int i = 1; i < rectids.getLength(); i++) {
+                pass = pass && rectids[i - 1] < rectids[i];
+            }
+        }
+        else {
+            pass = pass && id == 0 &&
+                   rectids.getLength() == 0 && lassoids.getLength() == 0;
+        }
+
+        root->unref();
+        runner.endTest(pass, pass ? "" :
+            "SoIdBufferPickAction returned inconsistent identifiers");
+    }
+
+    // -----------------------------------------------------------------------
+    // Actions applied to a root which isn't a separator leave their
+    // changes in the bottom elements of the state. A later action of
+    // the same type, which may take over the state, must still start
+    // out like one with a new state.
+    // -----------------------------------------------------------------------
+    runner.startTest("Reused action state matches a new state");
+    {
+        StateProbe fresh;
+        {
+            SoGroup* root = new SoGroup;
+            root->ref();
+            SoCallback* cb = new SoCallback;
+            cb->setCallback(probeState, &fresh);
+            root->addChild(cb);
+            SoCallbackAction cba;
+            cba.apply(root);
+            root->unref();
+        }
+
+        unsigned char pixels[2 * 2 * 3];
+        memset(pixels, 255, sizeof(pixels));
+        for (int i = 0; i < 4; i++) {
+            SoGroup* root = new SoGroup;
+            root->ref();
+            SoTexture2* tex = new SoTexture2;
+            tex->image.setValue(SbVec2s(2, 2), 3, pixels);
+            root->addChild(tex);
+            SoTranslation* trans = new SoTranslation;
+            trans->translation.setValue(5.0f, 0.0f, 0.0f);
+            root->addChild(trans);
+            SoCallbackAction cba;
+            cba.apply(root);
+            root->unref();
+        }
+
+        StateProbe reused;
+        {
+            SoGroup* root = new SoGroup;
+            root->ref();
+            SoCallback* cb = new SoCallback;
+            cb->setCallback(probeState, &reused);
+            root->addChild(cb);
+            SoCallbackAction cba;
+            cba.apply(root);
+            root->unref();
+        }
+
+        bool pass = reused.image == fresh.image &&
+                    reused.size == fresh.size &&
+                    reused.matrix == fresh.matrix &&
+                    reused.matrix == SbMatrix::identity();
+        runner.endTest(pass, pass ? "" :
+            "texture or matrix state leaked from an earlier action");
+    }
+
+    // -----------------------------------------------------------------------
+    // SoRayPickAction: batched rays pick the same as single rays
+    // -----------------------------------------------------------------------
+    runner.startTest("SoRayPickAction setRays matches single ray picks");
+    {
+        SoSeparator* root = createPickScene();
+        SbViewportRegion vp(200, 200);
+
+        std::vector<SbVec3f> starts, directions;
+        for (int y = -10; y <= 10; y++) {
+            for (int x = -10; x <= 10; x++) {
+                starts.push_back(SbVec3f(float(x) * 0.75f, float(y) * 0.5f, 15.0f));
+                SbVec3f dir(float(y) * 0.02f, float(x) * -0.03f, -1.0f);
+                dir.normalize();
+                directions.push_back(dir);
+            }
+        }
+        const int numrays = int(starts.size());
+
+        bool pass = true;
+        int numhits = 0;
+        for (int pickall = 0; pickall < 2 && pass; pickall++) {
+            SoRayPickAction batched(vp);
+            batched.setPickAll(pickall ? TRUE : FALSE);
+            batched.setRays(numrays, starts.data(), directions.data(), 1.0f, 30.0f);
+            batched.apply(root);
+            pass = pass && batched.getNumRays() == numrays;
+
+            for (int i = 0; i < numrays && pass; i++) {
+                SoRayPickAction single(vp);
+                single.setPickAll(pickall ? TRUE : FALSE);
+                single.setRay(starts[i], directions[i], 1.0f, 30.0f);
+                single.apply(root);
+                pass = samePickedPoints(batched.getRayPickedPointList(i),
+                                        single.getPickedPointList());
+                numhits += single.getPickedPointList().getLength();
+            }
+        }
+        pass = pass && numhits > 0;
+
+        root->unref();
+        runner.endTest(pass, pass ? "" :
+            "batched ray pick results differ from single ray picks");
+    }
+
+    runner.startTest("SoRayPickAction setNormalizedPoints matches single point picks");
+    {
+        SoSeparator* root = createPickScene();
+        SbViewportRegion vp(200, 200);
+
+        std::vector<SbVec2f> points;
+        for (int y = 0; y <= 20; y++) {
+            for (int x = 0; x <= 20; x++) {
+                points.push_back(SbVec2f(float(x) / 20.0f, float(y) / 20.0f));
+            }
+        }
+        const int numpoints = int(points.size());
+
+        SoRayPickAction batched(vp);
+        batched.setPickAll(TRUE);
+        batched.setNormalizedPoints(numpoints, points.data());
+        batched.apply(root);
+
+        bool pass = batched.getNumRays() == numpoints;
+        int numhits = 0;
+        for (int i = 0; i < numpoints && pass; i++) {
+            SoRayPickAction single(vp);
+            single.setPickAll(TRUE);
+            single.setNormalizedPoint(points[i]);
+            single.apply(root);
+            pass = samePickedPoints(batched.getRayPickedPointList(i),
+                                    single.getPickedPointList());
+            numhits += single.getPickedPointList().getLength();
+        }
+        pass = pass && numhits > 0;
+
+        root->unref();
+        runner.endTest(pass, pass ? "" :
+            "batched normalized point picks differ from single point picks");
+    }
+
     return runner.getSummary();
 }
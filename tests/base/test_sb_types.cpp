@@ -68,6 +68,10 @@
 #include <Inventor/SbPlane.h>
 #include <Inventor/SbLine.h>
 #include <Inventor/SbViewVolume.h>
+#include <Inventor/annex/Profiler/SbProfilingData.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoCube.h>
+#include <Inventor/SoFullPath.h>
 
 #include <cmath>
 #include <cstring>
@@ -455,5 +459,84 @@ int main()
         runner.endTest(pass, pass ? "" : "SbViewVolume perspective intersection wrong");
     }
 
+    // -----------------------------------------------------------------------
+    // SbProfilingData: keyed entry lookup and traversal event trace
+    // -----------------------------------------------------------------------
+    runner.startTest("SbProfilingData keyed index matches path index");
+    {
+        SoSeparator* root = new SoSeparator;
+        root->ref();
+        SoSeparator* group = new SoSeparator;
+        SoCube* cube = new SoCube;
+        root->addChild(new SoCube);
+        root->addChild(group);
+        group->addChild(cube);
+
+        SoFullPath* path = static_cast<SoFullPath*>(new SoPath(root));
+        path->ref();
+        path->append(1);
+        path->append(0);
+
+        SbProfilingData data;
+        int pathidx = data.getIndex(path, TRUE);
+        int rootidx = data.getIndex(-1, 0, root, FALSE);
+        int groupidx = data.getIndex(rootidx, 1, group, FALSE);
+        int cubeidx = data.getIndex(groupidx, 0, cube, FALSE);
+        int numbefore = data.getNumNodeEntries();
+        int missing = data.getIndex(groupidx, 1, cube, FALSE);
+        int created = data.getIndex(groupidx, 1, cube, TRUE);
+
+        bool pass = (rootidx != -1) && (groupidx != -1) &&
+                    (cubeidx == pathidx) && (missing == -1) &&
+                    (created == numbefore) &&
+                    (data.getParentIndex(created) == groupidx) &&
+                    (data.getChildIndex(created) == 1) &&
+                    (data.getIndex(groupidx, 1, cube, FALSE) == created);
+        path->unref();
+        root->unref();
+        runner.endTest(pass, pass ? "" :
+            "SbProfilingData keyed lookup disagrees with path lookup");
+    }
+
+    runner.startTest("SbProfilingData event trace ring buffer and export");
+    {
+        SoSeparator* root = new SoSeparator;
+        root->ref();
+        SoCube* cube = new SoCube;
+        root->addChild(cube);
+
+        SbProfilingData data;
+        data.setActionStartTime(SbTime(10.0));
+        data.setEventTraceCapacity(3);
+        int rootidx = data.getIndex(-1, 0, root, TRUE);
+        int cubeidx = data.getIndex(rootidx, 0, cube, TRUE);
+        for (int i = 0; i < 5; i++) {
+            data.addTraversalEvent(cubeidx, SbTime(10.0 + i), SbTime(0.5));
+        }
+
+        int idx = -1;
+        SbTime start, duration;
+        data.getTraversalEvent(0, idx, start, duration);
+        bool pass = (data.getNumTraversalEvents() == 3) &&
+                    (idx == cubeidx) && (start == SbTime(12.0)) &&
+                    (duration == SbTime(0.5));
+
+        SbString trace = data.getChromeTrace();
+        pass = pass &&
+               (trace.find("\"traceEvents\":[") != -1) &&
+               (trace.find("\"name\":\"Cube\"") != -1) &&
+               (trace.find("\"ts\":2000000.000") != -1) &&
+               (trace.find("\"dur\":500000.000") != -1) &&
+               (trace.find("\"path\":\"0/0\"") != -1) &&
+               (trace.find("\"ts\":1000000.000") == -1);
+
+        data.reset();
+        pass = pass && (data.getNumTraversalEvents() == 0) &&
+               (data.getEventTraceCapacity() == 3);
+        root->unref();
+        runner.endTest(pass, pass ? "" :
+            "SbProfilingData event trace wrong");
+    }
+
     return runner.getSummary();
 }
@@ -0,0 +1,186 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+/**
+ * @file bench_apply.cpp
+ * @brief Benchmark for many small apply() calls on short-lived actions.
+ *
+ * Draggers and manipulators construct an SoGetMatrixAction,
+ * SoGetBoundingBoxAction or SoRayPickAction on the stack for every
+ * event and apply it to a small subgraph. This times that pattern,
+ * next to the same applies done with one long-lived action of each
+ * type. The scene root is a plain group, so each apply leaves
+ * modified elements at the bottom of the state stacks; every new
+ * action must still compute the same result as the first one. Run
+ * with "reuse" to let actions take over the state of destructed
+ * actions, or with "noreuse" (COIN_NO_STATE_REUSE=1) to construct a
+ * new state for each action.
+ *
+ * Usage: bench_apply [reuse|noreuse] [applies]
+ */
+
+#include "../test_utils.h"
+
+#include <Inventor/actions/SoGetBoundingBoxAction.h>
+#include <Inventor/actions/SoGetMatrixAction.h>
+#include <Inventor/actions/SoRayPickAction.h>
+#include <Inventor/nodes/SoCube.h>
+#include <Inventor/nodes/SoGroup.h>
+#include <Inventor/nodes/SoMaterial.h>
+#include <Inventor/nodes/SoPerspectiveCamera.h>
+#include <Inventor/nodes/SoTransform.h>
+#include <Inventor/SoPath.h>
+#include <Inventor/SoPickedPoint.h>
+#include <Inventor/SbViewportRegion.h>
+#include <Inventor/SbTime.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace SimpleTest;
+
+static double
+elapsed(const SbTime & start)
+{
+    return (SbTime::getTimeOfDay() - start).getValue();
+}
+
+static SbBool
+sameBox(const SbBox3f & a, const SbBox3f & b)
+{
+    return a.getMin() == b.getMin() && a.getMax() == b.getMax();
+}
+
+int main(int argc, char ** argv)
+{
+    const bool reuse = (argc < 2) || strcmp(argv[1], "noreuse") != 0;
+    const int applies = (argc > 2) ? atoi(argv[2]) : 20000;
+    setenv("COIN_NO_STATE_REUSE", reuse ? "0" : "1", 1);
+
+    TestFixture fixture;
+
+    SoGroup * root = new SoGroup;
+    root->ref();
+    SoPerspectiveCamera * camera = new SoPerspectiveCamera;
+    camera->position.setValue(0.0f, 0.0f, 10.0f);
+    root->addChild(camera);
+    SoTransform * transform = new SoTransform;
+    transform->translation.setValue(0.5f, 0.25f, 0.0f);
+    transform->rotation.setValue(SbVec3f(0.0f, 0.0f, 1.0f), 0.3f);
+    root->addChild(transform);
+    root->addChild(new SoMaterial);
+    SoCube * cube = new SoCube;
+    root->addChild(cube);
+
+    SoPath * path = new SoPath(root);
+    path->ref();
+    path->append(cube);
+
+    const SbViewportRegion vp(640, 480);
+    const SbVec2s pickpos(320, 240);
+
+    // one action of each type constructed per apply, all of which
+    // should give the same result
+    int mismatches = 0;
+    SbMatrix matrix;
+    SbTime start = SbTime::getTimeOfDay();
+    for (int i = 0; i < applies; i++) {
+        SoGetMatrixAction ma(vp);
+        ma.apply(path);
+        if (i == 0) matrix = ma.getMatrix();
+        else if (ma.getMatrix() != matrix) mismatches++;
+    }
+    const double newmatrix = elapsed(start);
+
+    SbBox3f box;
+    start = SbTime::getTimeOfDay();
+    for (int i = 0; i < applies; i++) {
+        SoGetBoundingBoxAction ba(vp);
+        ba.apply(root);
+        if (i == 0) box = ba.getBoundingBox();
+        else if (!sameBox(ba.getBoundingBox(), box)) mismatches++;
+    }
+    const double newbbox = elapsed(start);
+
+    SbVec3f point(0.0f, 0.0f, 0.0f);
+    start = SbTime::getTimeOfDay();
+    for (int i = 0; i < applies; i++) {
+        SoRayPickAction ra(vp);
+        ra.setPoint(pickpos);
+        ra.apply(root);
+        const SoPickedPoint * pp = ra.getPickedPoint();
+        if (pp == NULL) mismatches++;
+        else if (i == 0) point = pp->getPoint();
+        else if (pp->getPoint() != point) mismatches++;
+    }
+    const double newpick = elapsed(start);
+
+    // one long-lived action of each type. This keeps its state between
+    // applies, so only the first result is compared.
+    SoGetMatrixAction ma(vp);
+    SoGetBoundingBoxAction ba(vp);
+    SoRayPickAction ra(vp);
+    ra.setPoint(pickpos);
+
+    start = SbTime::getTimeOfDay();
+    for (int i = 0; i < applies; i++) {
+        ma.apply(path);
+        if (i == 0 && ma.getMatrix() != matrix) mismatches++;
+    }
+    const double keptmatrix = elapsed(start);
+    start = SbTime::getTimeOfDay();
+    for (int i = 0; i < applies; i++) {
+        ba.apply(root);
+        if (i == 0 && !sameBox(ba.getBoundingBox(), box)) mismatches++;
+    }
+    const double keptbbox = elapsed(start);
+    start = SbTime::getTimeOfDay();
+    for (int i = 0; i < applies; i++) {
+        ra.apply(root);
+        const SoPickedPoint * pp = ra.getPickedPoint();
+        if (i == 0 && (pp == NULL || pp->getPoint() != point)) mismatches++;
+    }
+    const double keptpick = elapsed(start);
+
+    const double us = 1.0e6 / applies;
+    printf("bench_apply (%s): %d applies\n", reuse ? "reuse" : "noreuse", applies);
+    printf("                          new action   kept action\n");
+    printf("  SoGetMatrixAction:      %8.3f us   %8.3f us\n", newmatrix * us, keptmatrix * us);
+    printf("  SoGetBoundingBoxAction: %8.3f us   %8.3f us\n", newbbox * us, keptbbox * us);
+    printf("  SoRayPickAction:        %8.3f us   %8.3f us\n", newpick * us, keptpick * us);
+    printf("  mismatching results: %d\n", mismatches);
+
+    path->unref();
+    root->unref();
+    return (mismatches == 0) ? 0 : 1;
+}
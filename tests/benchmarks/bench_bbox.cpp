@@ -0,0 +1,153 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+/**
+ * @file bench_bbox.cpp
+ * @brief Benchmark for repeated bounding box calculation of a changing scene.
+ *
+ * Builds a scene of nested groups with separators at the leaves, with
+ * the default AUTO bounding box caching, moves one leaf per frame and
+ * applies an SoGetBoundingBoxAction to the root, the way
+ * SoRenderManager does for auto clipping. This is done once with a
+ * plain action and once with subgraph caching enabled, and then again
+ * for a scene which does not change between frames.
+ *
+ * Usage: bench_bbox [depth] [width] [frames]
+ */
+
+#include "../test_utils.h"
+
+#include <Inventor/actions/SoGetBoundingBoxAction.h>
+#include <Inventor/nodes/SoGroup.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoTransform.h>
+#include <Inventor/nodes/SoCube.h>
+#include <Inventor/SbViewportRegion.h>
+#include <Inventor/SbTime.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace SimpleTest;
+
+static SoGroup *
+buildScene(int depth, int width, std::vector<SoTransform *> & transforms)
+{
+    SoGroup * group = new SoGroup;
+    for (int i = 0; i < width; i++) {
+        if (depth > 1) {
+            group->addChild(buildScene(depth - 1, width, transforms));
+        }
+        else {
+            SoSeparator * leaf = new SoSeparator;
+            SoTransform * transform = new SoTransform;
+            transform->translation.setValue(float(transforms.size()), 0.0f, 0.0f);
+            leaf->addChild(transform);
+            leaf->addChild(new SoCube);
+            group->addChild(leaf);
+            transforms.push_back(transform);
+        }
+    }
+    return group;
+}
+
+static double
+runFrames(SoGroup * root, std::vector<SoTransform *> & transforms,
+          int frames, bool subgraphcaching, bool move,
+          std::vector<SbBox3f> & boxes)
+{
+    SoGetBoundingBoxAction action(SbViewportRegion(640, 480));
+    action.setSubgraphCaching(subgraphcaching ? TRUE : FALSE);
+    SbTime start = SbTime::getTimeOfDay();
+    for (int f = 0; f < frames; f++) {
+        if (move) {
+            SoTransform * moved = transforms[(f * 7) % transforms.size()];
+            moved->translation.setValue(moved->translation.getValue() +
+                                        SbVec3f(0.0f, 1.0f, 0.0f));
+        }
+        action.apply(root);
+        boxes.push_back(action.getBoundingBox());
+    }
+    return (SbTime::getTimeOfDay() - start).getValue();
+}
+
+int main(int argc, char ** argv)
+{
+    TestFixture fixture;
+
+    const int depth = (argc > 1) ? atoi(argv[1]) : 4;
+    const int width = (argc > 2) ? atoi(argv[2]) : 10;
+    const int frames = (argc > 3) ? atoi(argv[3]) : 100;
+
+    std::vector<SoTransform *> transforms;
+    SoGroup * root = buildScene(depth, width, transforms);
+    root->ref();
+
+    // both runs move the leaves the same way, so restore them in between
+    std::vector<SbVec3f> initial;
+    for (size_t i = 0; i < transforms.size(); i++) {
+        initial.push_back(transforms[i]->translation.getValue());
+    }
+
+    std::vector<SbBox3f> plainboxes, cachedboxes;
+    const double plaintime = runFrames(root, transforms, frames, false, true, plainboxes);
+    for (size_t i = 0; i < transforms.size(); i++) {
+        transforms[i]->translation = initial[i];
+    }
+    const double cachedtime = runFrames(root, transforms, frames, true, true, cachedboxes);
+
+    std::vector<SbBox3f> staticboxes;
+    const double plainstatic = runFrames(root, transforms, frames, false, false, staticboxes);
+    const double cachedstatic = runFrames(root, transforms, frames, true, false, staticboxes);
+
+    int mismatches = 0;
+    for (int f = 0; f < frames; f++) {
+        if (plainboxes[f].getMin() != cachedboxes[f].getMin() ||
+            plainboxes[f].getMax() != cachedboxes[f].getMax()) {
+            ++mismatches;
+        }
+    }
+
+    printf("bench_bbox: %d leaf separators, %d frames\n",
+           (int)transforms.size(), frames);
+    printf("  one leaf moved per frame:\n");
+    printf("    plain action:      %10.3f ms/frame\n", plaintime * 1000.0 / frames);
+    printf("    subgraph caching:  %10.3f ms/frame\n", cachedtime * 1000.0 / frames);
+    printf("  unchanged scene:\n");
+    printf("    plain action:      %10.3f ms/frame\n", plainstatic * 1000.0 / frames);
+    printf("    subgraph caching:  %10.3f ms/frame\n", cachedstatic * 1000.0 / frames);
+    printf("  mismatching boxes: %d\n", mismatches);
+
+    root->unref();
+    return (mismatches == 0) ? 0 : 1;
+}
@@ -0,0 +1,233 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+/**
+ * @file bench_bvh.cpp
+ * @brief Benchmark for SoBVHSeparator with a large number of children.
+ *
+ * Builds a flat group of child separators scattered in a volume, and
+ * puts the same children under both an SoSeparator and an
+ * SoBVHSeparator. Both are ray picked with single rays and with a
+ * batch of rays, checking that the picked points are the same. Some
+ * children are then moved, and the bounding box and picks compared
+ * again after the hierarchy has been refitted.
+ *
+ * Usage: bench_bvh [numchildren] [numrays] [nummoved]
+ */
+
+#include "../test_utils.h"
+
+#include <Inventor/actions/SoGetBoundingBoxAction.h>
+#include <Inventor/actions/SoRayPickAction.h>
+#include <Inventor/lists/SoPickedPointList.h>
+#include <Inventor/nodes/SoBVHSeparator.h>
+#include <Inventor/nodes/SoCube.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoSphere.h>
+#include <Inventor/nodes/SoTranslation.h>
+#include <Inventor/SoPickedPoint.h>
+#include <Inventor/SoPath.h>
+#include <Inventor/SbTime.h>
+#include <Inventor/SbViewportRegion.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace SimpleTest;
+
+// simple deterministic random numbers in [0, 1)
+static unsigned int seed = 1;
+static float
+random01(void)
+{
+    seed = seed * 1103515245u + 12345u;
+    return float((seed >> 8) & 0xffff) / 65536.0f;
+}
+
+static double
+computeBBox(SoNode * root, const SbViewportRegion & vp, SbBox3f & box)
+{
+    SoGetBoundingBoxAction action(vp);
+    SbTime start = SbTime::getTimeOfDay();
+    action.apply(root);
+    box = action.getBoundingBox();
+    return (SbTime::getTimeOfDay() - start).getValue();
+}
+
+// picks every ray on its own, recording the picked shape and point
+static double
+pickSingle(SoNode * root, const SbViewportRegion & vp,
+           const std::vector<SbVec3f> & starts, const std::vector<SbVec3f> & dirs,
+           std::vector<SoNode *> & tails, std::vector<SbVec3f> & points)
+{
+    SoRayPickAction action(vp);
+    const int n = int(starts.size());
+    tails.assign(n, NULL);
+    points.assign(n, SbVec3f(0.0f, 0.0f, 0.0f));
+    SbTime start = SbTime::getTimeOfDay();
+    for (int i = 0; i < n; i++) {
+        action.setRay(starts[i], dirs[i]);
+        action.apply(root);
+        SoPickedPoint * pp = action.getPickedPoint();
+        if (pp) {
+            tails[i] = pp->getPath()->getTail();
+            points[i] = pp->getPoint();
+        }
+    }
+    return (SbTime::getTimeOfDay() - start).getValue();
+}
+
+static double
+pickBatched(SoNode * root, const SbViewportRegion & vp,
+            const std::vector<SbVec3f> & starts, const std::vector<SbVec3f> & dirs,
+            std::vector<SoNode *> & tails, std::vector<SbVec3f> & points)
+{
+    SoRayPickAction action(vp);
+    const int n = int(starts.size());
+    tails.assign(n, NULL);
+    points.assign(n, SbVec3f(0.0f, 0.0f, 0.0f));
+    SbTime start = SbTime::getTimeOfDay();
+    action.setRays(n, &starts[0], &dirs[0]);
+    action.apply(root);
+    for (int i = 0; i < n; i++) {
+        SoPickedPoint * pp = action.getRayPickedPoint(i);
+        if (pp) {
+            tails[i] = pp->getPath()->getTail();
+            points[i] = pp->getPoint();
+        }
+    }
+    return (SbTime::getTimeOfDay() - start).getValue();
+}
+
+static int
+countMismatches(const std::vector<SoNode *> & tails0, const std::vector<SbVec3f> & points0,
+                const std::vector<SoNode *> & tails1, const std::vector<SbVec3f> & points1,
+                int & hits)
+{
+    int mismatches = 0;
+    hits = 0;
+    for (size_t i = 0; i < tails0.size(); i++) {
+        if (tails0[i]) hits++;
+        if (tails0[i] != tails1[i] || (points0[i] - points1[i]).length() > 1.0e-4f) {
+            mismatches++;
+        }
+    }
+    return mismatches;
+}
+
+// the boxes are accumulated in different order, so allow for
+// rounding differences
+static bool
+sameBox(const SbBox3f & a, const SbBox3f & b)
+{
+    const float tolerance = 2.0e-4f * (a.getMax() - a.getMin()).length() + 1.0e-4f;
+    return (a.getMin() - b.getMin()).length() < tolerance &&
+        (a.getMax() - b.getMax()).length() < tolerance;
+}
+
+int main(int argc, char ** argv)
+{
+    TestFixture fixture;
+
+    const int numchildren = (argc > 1) ? atoi(argv[1]) : 20000;
+    const int numrays = (argc > 2) ? atoi(argv[2]) : 200;
+    const int nummoved = (argc > 3) ? atoi(argv[3]) : 10;
+
+    const float extent = 10.0f * powf(float(numchildren), 1.0f / 3.0f);
+    SoSeparator * flat = new SoSeparator;
+    SoBVHSeparator * indexed = new SoBVHSeparator;
+    flat->ref();
+    indexed->ref();
+    std::vector<SoTranslation *> translations;
+    for (int i = 0; i < numchildren; i++) {
+        SoSeparator * child = new SoSeparator;
+        SoTranslation * translation = new SoTranslation;
+        translation->translation.setValue(random01() * extent, random01() * extent,
+                                          random01() * extent);
+        translations.push_back(translation);
+        child->addChild(translation);
+        if (i % 2) child->addChild(new SoCube);
+        else child->addChild(new SoSphere);
+        flat->addChild(child);
+        indexed->addChild(child);
+    }
+
+    std::vector<SbVec3f> starts(numrays), dirs(numrays);
+    for (int i = 0; i < numrays; i++) {
+        starts[i].setValue(random01() * extent, random01() * extent, -10.0f);
+        dirs[i].setValue(random01() - 0.5f, random01() - 0.5f, 1.0f);
+    }
+
+    SbViewportRegion vp(640, 480);
+    SbBox3f flatbox, indexedbox;
+    computeBBox(flat, vp, flatbox);
+    const double buildtime = computeBBox(indexed, vp, indexedbox);
+    bool ok = sameBox(flatbox, indexedbox);
+
+    std::vector<SoNode *> tails0, tails1, tails2;
+    std::vector<SbVec3f> points0, points1, points2;
+    const double flattime = pickSingle(flat, vp, starts, dirs, tails0, points0);
+    const double indexedtime = pickSingle(indexed, vp, starts, dirs, tails1, points1);
+    const double batchedtime = pickBatched(indexed, vp, starts, dirs, tails2, points2);
+    int hits;
+    const int mismatches = countMismatches(tails0, points0, tails1, points1, hits) +
+        countMismatches(tails0, points0, tails2, points2, hits);
+
+    // move some children, and compare after refitting
+    for (int i = 0; i < nummoved; i++) {
+        SoTranslation * translation = translations[(i * 7919) % numchildren];
+        translation->translation.setValue(translation->translation.getValue() +
+                                          SbVec3f(0.0f, 0.0f, extent * 0.5f));
+    }
+    computeBBox(flat, vp, flatbox);
+    const double refittime = computeBBox(indexed, vp, indexedbox);
+    ok = ok && sameBox(flatbox, indexedbox);
+    pickSingle(flat, vp, starts, dirs, tails0, points0);
+    pickSingle(indexed, vp, starts, dirs, tails1, points1);
+    int movedhits;
+    const int movedmismatches = countMismatches(tails0, points0, tails1, points1, movedhits);
+
+    printf("bench_bvh: %d children, %d rays, %d moved\n", numchildren, numrays, nummoved);
+    printf("  bounding box, building hierarchy:  %10.3f ms\n", buildtime * 1000.0);
+    printf("  bounding box, refitting hierarchy: %10.3f ms\n", refittime * 1000.0);
+    printf("  single rays, SoSeparator:          %10.3f ms\n", flattime * 1000.0);
+    printf("  single rays, SoBVHSeparator:       %10.3f ms\n", indexedtime * 1000.0);
+    printf("  batched rays, SoBVHSeparator:      %10.3f ms\n", batchedtime * 1000.0);
+    printf("  hits: %d / %d, mismatches: %d / %d, boxes %s\n",
+           hits, movedhits, mismatches, movedmismatches, ok ? "equal" : "differ");
+
+    flat->unref();
+    indexed->unref();
+    return (ok && mismatches == 0 && movedmismatches == 0 && hits > 0) ? 0 : 1;
+}
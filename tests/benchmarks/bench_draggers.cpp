@@ -0,0 +1,210 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+/**
+ * @file bench_draggers.cpp
+ * @brief Benchmark for startup and first construction of the draggers.
+ *
+ * Times SoDB::init() and SoInteraction::init(), and the construction
+ * of the first instance of each built-in dragger, which is when its
+ * default geometry is set up. This is done either from the tables
+ * compiled from the default .iv files at configure time, or, with
+ * "parsed", by reading the .iv text as before
+ * (COIN_DRAGGER_DEFAULTS_PARSE=1). Also times constructing further
+ * instances, and checks that every named part of the default geometry
+ * matches the same part read from the .iv files in defaultsdir.
+ *
+ * Usage: bench_draggers [defaultsdir] [repeats] [compiled|parsed]
+ */
+
+#include "../test_utils.h"
+
+#include <Inventor/SoDB.h>
+#include <Inventor/SoInput.h>
+#include <Inventor/SoInteraction.h>
+#include <Inventor/SoOutput.h>
+#include <Inventor/SbTime.h>
+#include <Inventor/actions/SoWriteAction.h>
+#include <Inventor/lists/SoNodeList.h>
+#include <Inventor/nodes/SoGroup.h>
+#include <Inventor/nodes/SoSeparator.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace SimpleTest;
+
+static const char * const draggers[] = {
+    "SoCenterballDragger", "centerballDragger.iv",
+    "SoDirectionalLightDragger", "directionalLightDragger.iv",
+    "SoDragPointDragger", "dragPointDragger.iv",
+    "SoHandleBoxDragger", "handleBoxDragger.iv",
+    "SoJackDragger", "jackDragger.iv",
+    "SoPointLightDragger", "pointLightDragger.iv",
+    "SoRotateCylindricalDragger", "rotateCylindricalDragger.iv",
+    "SoRotateDiscDragger", "rotateDiscDragger.iv",
+    "SoRotateSphericalDragger", "rotateSphericalDragger.iv",
+    "SoScale1Dragger", "scale1Dragger.iv",
+    "SoScale2Dragger", "scale2Dragger.iv",
+    "SoScale2UniformDragger", "scale2UniformDragger.iv",
+    "SoScaleUniformDragger", "scaleUniformDragger.iv",
+    "SoSpotLightDragger", "spotLightDragger.iv",
+    "SoTabBoxDragger", "tabBoxDragger.iv",
+    "SoTabPlaneDragger", "tabPlaneDragger.iv",
+    "SoTrackballDragger", "trackballDragger.iv",
+    "SoTransformBoxDragger", "transformBoxDragger.iv",
+    "SoTransformerDragger", "transformerDragger.iv",
+    "SoTranslate1Dragger", "translate1Dragger.iv",
+    "SoTranslate2Dragger", "translate2Dragger.iv",
+};
+static const int numdraggers = sizeof(draggers) / sizeof(draggers[0]) / 2;
+
+static void * growBuffer(void * ptr, size_t size) { return realloc(ptr, size); }
+
+static std::string
+writeNode(SoNode * node)
+{
+    SoOutput out;
+    out.setBuffer(malloc(1024), 1024, growBuffer);
+    SoWriteAction wa(&out);
+    wa.apply(node);
+    void * buf;
+    size_t size;
+    out.getBuffer(buf, size);
+    std::string text(static_cast<char *>(buf), size);
+    free(buf);
+    return text;
+}
+
+static void
+collectNamed(SoNode * node, std::vector<SoNode *> & named)
+{
+    if (node->getName().getLength() > 0) named.push_back(node);
+    if (node->isOfType(SoGroup::getClassTypeId())) {
+        SoGroup * group = static_cast<SoGroup *>(node);
+        for (int i = 0; i < group->getNumChildren(); i++) {
+            collectNamed(group->getChild(i), named);
+        }
+    }
+}
+
+// Returns the number of named nodes in the file which do not have an
+// identical counterpart among the other nodes of the same name, ie
+// the default geometry set up by the draggers.
+static int
+verifyFile(const std::string & path, int & numnamed)
+{
+    SoInput in;
+    if (!in.openFile(path.c_str())) return 1;
+    SoNode * root = SoDB::readAll(&in);
+    if (!root) return 1;
+    root->ref();
+
+    std::vector<SoNode *> named;
+    collectNamed(root, named);
+    int mismatches = 0;
+    for (size_t i = 0; i < named.size(); i++) {
+        const std::string expected = writeNode(named[i]);
+        SoNodeList others;
+        SoNode::getByName(named[i]->getName(), others);
+        SbBool found = FALSE;
+        for (int j = 0; !found && j < others.getLength(); j++) {
+            if (others[j] != named[i]) found = (writeNode(others[j]) == expected);
+        }
+        if (!found) {
+            printf("  mismatch: %s in %s\n", named[i]->getName().getString(), path.c_str());
+            ++mismatches;
+        }
+    }
+    numnamed += int(named.size());
+    root->unref();
+    return mismatches;
+}
+
+int main(int argc, char ** argv)
+{
+    const std::string dir = (argc > 1) ? argv[1] : ".";
+    const int repeats = (argc > 2) ? atoi(argv[2]) : 20;
+    const bool parsed = (argc > 3) && strcmp(argv[3], "parsed") == 0;
+
+    setenv("COIN_DRAGGER_DEFAULTS_PARSE", parsed ? "1" : "0", 1);
+
+    SbTime start = SbTime::getTimeOfDay();
+    TestFixture fixture;
+    const double inittime = (SbTime::getTimeOfDay() - start).getValue();
+
+    // the first instance of each type sets up the default geometry
+    std::vector<SoNode *> instances;
+    std::vector<double> firsttimes;
+    for (int i = 0; i < numdraggers; i++) {
+        start = SbTime::getTimeOfDay();
+        SoNode * dragger = static_cast<SoNode *>(SoType::fromName(draggers[i * 2]).createInstance());
+        firsttimes.push_back((SbTime::getTimeOfDay() - start).getValue());
+        dragger->ref();
+        instances.push_back(dragger);
+    }
+
+    start = SbTime::getTimeOfDay();
+    for (int r = 0; r < repeats; r++) {
+        for (int i = 0; i < numdraggers; i++) {
+            SoNode * dragger = static_cast<SoNode *>(SoType::fromName(draggers[i * 2]).createInstance());
+            dragger->ref();
+            dragger->unref();
+        }
+    }
+    const double repeattime = (SbTime::getTimeOfDay() - start).getValue();
+
+    int numnamed = 0;
+    int mismatches = 0;
+    for (int i = 0; i < numdraggers; i++) {
+        mismatches += verifyFile(dir + "/" + draggers[i * 2 + 1], numnamed);
+    }
+
+    double firsttotal = 0.0;
+    printf("bench_draggers: %s default geometry, %d repeats\n",
+           parsed ? "parsed" : "compiled", repeats);
+    printf("  SoDB::init() + SoInteraction::init(): %8.3f ms\n", inittime * 1e3);
+    for (int i = 0; i < numdraggers; i++) {
+        printf("  first %-26s %8.3f ms\n", draggers[i * 2], firsttimes[i] * 1e3);
+        firsttotal += firsttimes[i];
+    }
+    printf("  first instances, total:            %8.3f ms\n", firsttotal * 1e3);
+    printf("  later instances:                   %8.3f ms/dragger\n",
+           repeats > 0 ? repeattime * 1e3 / (repeats * numdraggers) : 0.0);
+    printf("  named parts checked: %d, mismatching: %d\n", numnamed, mismatches);
+
+    for (size_t i = 0; i < instances.size(); i++) instances[i]->unref();
+    return (mismatches == 0 && numnamed > 0) ? 0 : 1;
+}
@@ -0,0 +1,160 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+/**
+ * @file bench_engines.cpp
+ * @brief Benchmark for lazy versus scheduled engine network evaluation.
+ *
+ * Builds a layered network of SoCalculator engines where every engine
+ * reads two engines from the layer above, and reads the outputs of the
+ * last layer after each change of the input. Compares lazy evaluation
+ * with scheduled evaluation, serially and on worker threads.
+ *
+ * Usage: bench_engines [layers] [width] [values] [iterations] [threads]
+ */
+
+#include "../test_utils.h"
+
+#include <Inventor/engines/SoCalculator.h>
+#include <Inventor/fields/SoMFFloat.h>
+#include <Inventor/sensors/SoSensorManager.h>
+#include <Inventor/SoDB.h>
+#include <Inventor/SbTime.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace SimpleTest;
+
+struct Network {
+    std::vector<SoCalculator *> engines;
+    std::vector<SoMFFloat *> results;
+    SoCalculator * input;
+};
+
+static void
+buildNetwork(Network & net, int layers, int width, int values)
+{
+    net.input = new SoCalculator;
+    net.input->ref();
+    net.input->a.setNum(values);
+    float * a = net.input->a.startEditing();
+    for (int i = 0; i < values; i++) a[i] = float(i);
+    net.input->a.finishEditing();
+    net.input->expression.setValue("oa = a + 1");
+
+    std::vector<SoCalculator *> above(1, net.input);
+    for (int l = 0; l < layers; l++) {
+        std::vector<SoCalculator *> layer;
+        for (int w = 0; w < width; w++) {
+            SoCalculator * calc = new SoCalculator;
+            calc->ref();
+            calc->expression.setValue("oa = sqrt(a * a + b * b) * 0.5 + sin(a)");
+            calc->a.connectFrom(&above[w % above.size()]->oa);
+            calc->b.connectFrom(&above[(w + 1) % above.size()]->oa);
+            layer.push_back(calc);
+            net.engines.push_back(calc);
+        }
+        above = layer;
+    }
+    for (size_t i = 0; i < above.size(); i++) {
+        SoMFFloat * result = new SoMFFloat;
+        result->connectFrom(&above[i]->oa);
+        net.results.push_back(result);
+    }
+}
+
+static void
+destroyNetwork(Network & net)
+{
+    for (size_t i = 0; i < net.results.size(); i++) delete net.results[i];
+    for (size_t i = 0; i < net.engines.size(); i++) net.engines[i]->unref();
+    net.input->unref();
+}
+
+// Change the input, process the delay queue as a frame would, and
+// read all results. Returns the sum of the results.
+static double
+runFrames(Network & net, int iterations, double & seconds)
+{
+    double sum = 0.0;
+    SbTime start = SbTime::getTimeOfDay();
+    for (int i = 0; i < iterations; i++) {
+        net.input->b.setValue(float(i));
+        SoDB::getSensorManager()->processDelayQueue(FALSE);
+        for (size_t r = 0; r < net.results.size(); r++) {
+            const SoMFFloat & result = *net.results[r];
+            for (int v = 0; v < result.getNum(); v++) sum += result[v];
+        }
+    }
+    seconds = (SbTime::getTimeOfDay() - start).getValue();
+    return sum;
+}
+
+int main(int argc, char ** argv)
+{
+    TestFixture fixture;
+
+    const int layers = (argc > 1) ? atoi(argv[1]) : 8;
+    const int width = (argc > 2) ? atoi(argv[2]) : 8;
+    const int values = (argc > 3) ? atoi(argv[3]) : 1000;
+    const int iterations = (argc > 4) ? atoi(argv[4]) : 20;
+    const int threads = (argc > 5) ? atoi(argv[5]) : 4;
+
+    Network net;
+    buildNetwork(net, layers, width, values);
+
+    double lazytime, serialtime, threadtime;
+    SoEngine::setScheduledEvaluation(FALSE);
+    const double lazysum = runFrames(net, iterations, lazytime);
+    SoEngine::setScheduledEvaluation(TRUE);
+    const double serialsum = runFrames(net, iterations, serialtime);
+    SoEngine::setScheduledEvaluation(TRUE, threads);
+    const double threadsum = runFrames(net, iterations, threadtime);
+    SoEngine::setScheduledEvaluation(FALSE);
+
+    const bool match = (lazysum == serialsum) && (lazysum == threadsum);
+
+    printf("bench_engines: %d layers of %d engines, %d values, %d iterations\n",
+           layers, width, values, iterations);
+    printf("  lazy:                %10.3f ms/frame\n",
+           lazytime * 1000.0 / iterations);
+    printf("  scheduled:           %10.3f ms/frame\n",
+           serialtime * 1000.0 / iterations);
+    printf("  scheduled, %2d threads: %9.3f ms/frame\n",
+           threads, threadtime * 1000.0 / iterations);
+    printf("  results %s\n", match ? "match" : "DIFFER");
+
+    destroyNetwork(net);
+    return match ? 0 : 1;
+}
@@ -0,0 +1,131 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+/**
+ * @file bench_notify.cpp
+ * @brief Benchmark for bulk field updates with and without batching.
+ *
+ * Builds a scene of nested separators with transforms at the leaves,
+ * and sets the translation of every transform, first with ordinary
+ * notification and then inside an SoDB::NotifyBatch scope.
+ *
+ * Usage: bench_notify [depth] [width] [iterations]
+ */
+
+#include "../test_utils.h"
+
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoTransform.h>
+#include <Inventor/nodes/SoCube.h>
+#include <Inventor/sensors/SoNodeSensor.h>
+#include <Inventor/SoDB.h>
+#include <Inventor/SbTime.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace SimpleTest;
+
+static int notifications = 0;
+static void countNotify(void *, SoSensor *) { ++notifications; }
+
+static SoSeparator *
+buildScene(int depth, int width, std::vector<SoTransform *> & transforms)
+{
+    SoSeparator * sep = new SoSeparator;
+    for (int i = 0; i < width; i++) {
+        if (depth > 1) {
+            sep->addChild(buildScene(depth - 1, width, transforms));
+        }
+        else {
+            SoSeparator * leaf = new SoSeparator;
+            SoTransform * transform = new SoTransform;
+            leaf->addChild(transform);
+            leaf->addChild(new SoCube);
+            sep->addChild(leaf);
+            transforms.push_back(transform);
+        }
+    }
+    return sep;
+}
+
+static double
+updateAll(std::vector<SoTransform *> & transforms, int iterations, bool batch)
+{
+    SbTime start = SbTime::getTimeOfDay();
+    for (int it = 0; it < iterations; it++) {
+        if (batch) SoDB::startNotifyBatch();
+        for (size_t i = 0; i < transforms.size(); i++) {
+            transforms[i]->translation.setValue(float(i), float(it), 0.0f);
+        }
+        if (batch) SoDB::endNotifyBatch();
+    }
+    return (SbTime::getTimeOfDay() - start).getValue();
+}
+
+int main(int argc, char ** argv)
+{
+    TestFixture fixture;
+
+    const int depth = (argc > 1) ? atoi(argv[1]) : 4;
+    const int width = (argc > 2) ? atoi(argv[2]) : 10;
+    const int iterations = (argc > 3) ? atoi(argv[3]) : 10;
+
+    std::vector<SoTransform *> transforms;
+    SoSeparator * root = buildScene(depth, width, transforms);
+    root->ref();
+
+    // an immediate sensor on the root counts the notifications
+    // reaching it
+    SoNodeSensor sensor(countNotify, NULL);
+    sensor.setPriority(0);
+    sensor.attach(root);
+
+    notifications = 0;
+    const double plaintime = updateAll(transforms, iterations, false);
+    const int plaincount = notifications;
+    notifications = 0;
+    const double batchtime = updateAll(transforms, iterations, true);
+    const int batchcount = notifications;
+
+    printf("bench_notify: %d transforms, %d iterations\n",
+           (int)transforms.size(), iterations);
+    printf("  unbatched: %10.3f ms/update, %d root notifications\n",
+           plaintime * 1000.0 / iterations, plaincount);
+    printf("  batched:   %10.3f ms/update, %d root notifications\n",
+           batchtime * 1000.0 / iterations, batchcount);
+
+    sensor.detach();
+    root->unref();
+    return (batchcount == iterations) ? 0 : 1;
+}
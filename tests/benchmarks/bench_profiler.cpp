@@ -0,0 +1,142 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+/**
+ * @file bench_profiler.cpp
+ * @brief Benchmark for SbProfilingData entry lookup during traversal.
+ *
+ * Compares looking up node entries by full path, as the profiler did
+ * for every traversed node, with the keyed lookup from the parent
+ * entry and child index. The scene is a synthetic tree of groups.
+ *
+ * Usage: bench_profiler [depth] [width] [iterations]
+ */
+
+#include "../test_utils.h"
+
+#include <Inventor/annex/Profiler/SbProfilingData.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoCube.h>
+#include <Inventor/SoFullPath.h>
+#include <Inventor/SbTime.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace SimpleTest;
+
+static SoNode *
+buildTree(int depth, int width)
+{
+    if (depth == 0) return new SoCube;
+    SoSeparator * group = new SoSeparator;
+    for (int i = 0; i < width; i++) {
+        group->addChild(buildTree(depth - 1, width));
+    }
+    return group;
+}
+
+// Visit all nodes in depth-first order, the same way the profiler
+// hooks see them, collecting the entry index of each node.
+static void
+traversePath(SbProfilingData & data, SoFullPath * path, std::vector<int> & out)
+{
+    out.push_back(data.getIndex(path, TRUE));
+    SoNode * tail = path->getTail();
+    if (!tail->isOfType(SoGroup::getClassTypeId())) return;
+    SoGroup * group = static_cast<SoGroup *>(tail);
+    for (int i = 0; i < group->getNumChildren(); i++) {
+        path->append(i);
+        traversePath(data, path, out);
+        path->pop();
+    }
+}
+
+static void
+traverseKeyed(SbProfilingData & data, int parentidx, int childidx,
+              SoNode * node, std::vector<int> & out)
+{
+    const int idx = data.getIndex(parentidx, childidx, node, TRUE);
+    out.push_back(idx);
+    if (!node->isOfType(SoGroup::getClassTypeId())) return;
+    SoGroup * group = static_cast<SoGroup *>(node);
+    for (int i = 0; i < group->getNumChildren(); i++) {
+        traverseKeyed(data, idx, i, group->getChild(i), out);
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    TestFixture fixture;
+
+    const int depth = (argc > 1) ? atoi(argv[1]) : 6;
+    const int width = (argc > 2) ? atoi(argv[2]) : 6;
+    const int iterations = (argc > 3) ? atoi(argv[3]) : 20;
+
+    SoNode * root = buildTree(depth, width);
+    root->ref();
+    SoFullPath * path = static_cast<SoFullPath *>(new SoPath(root));
+    path->ref();
+
+    SbProfilingData pathdata, keyeddata;
+    std::vector<int> pathidx, keyedidx;
+
+    SbTime start = SbTime::getTimeOfDay();
+    for (int i = 0; i < iterations; i++) {
+        pathidx.clear();
+        traversePath(pathdata, path, pathidx);
+    }
+    const double pathtime = (SbTime::getTimeOfDay() - start).getValue();
+
+    start = SbTime::getTimeOfDay();
+    for (int i = 0; i < iterations; i++) {
+        keyedidx.clear();
+        traverseKeyed(keyeddata, -1, 0, root, keyedidx);
+    }
+    const double keyedtime = (SbTime::getTimeOfDay() - start).getValue();
+
+    const bool match = (pathidx == keyedidx) &&
+        (pathdata.getNumNodeEntries() == keyeddata.getNumNodeEntries());
+
+    printf("bench_profiler: depth %d, width %d, %d nodes, %d iterations\n",
+           depth, width, (int)pathidx.size(), iterations);
+    printf("  path lookup:  %10.3f ms/traversal\n",
+           pathtime * 1000.0 / iterations);
+    printf("  keyed lookup: %10.3f ms/traversal\n",
+           keyedtime * 1000.0 / iterations);
+    printf("  entries %s\n", match ? "match" : "DIFFER");
+
+    path->unref();
+    root->unref();
+    return match ? 0 : 1;
+}
@@ -0,0 +1,272 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+/**
+ * @file bench_pvcache.cpp
+ * @brief Benchmark for building SoPrimitiveVertexCache from generated shapes.
+ *
+ * Generates the triangles of a quad mesh and a set of primitive shapes
+ * with an SoCallbackAction, and welds them into an
+ * SoPrimitiveVertexCache per shape, the way SoShape does when it
+ * renders through the cache. For comparison, the same triangles are
+ * welded with interleaved vertex structs in a hash map keyed by the
+ * whole vertex, which is how the cache used to store them. The
+ * number of welded vertices and indices must agree.
+ *
+ * Usage: bench_pvcache [meshsize] [complexity] [repeats]
+ */
+
+#include "../test_utils.h"
+
+#include <Inventor/actions/SoCallbackAction.h>
+#include <Inventor/caches/SoPrimitiveVertexCache.h>
+#include <Inventor/nodes/SoComplexity.h>
+#include <Inventor/nodes/SoCone.h>
+#include <Inventor/nodes/SoCoordinate3.h>
+#include <Inventor/nodes/SoCylinder.h>
+#include <Inventor/nodes/SoQuadMesh.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoShape.h>
+#include <Inventor/nodes/SoSphere.h>
+#include <Inventor/SoPrimitiveVertex.h>
+#include <Inventor/SbTime.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+using namespace SimpleTest;
+
+// the interleaved vertex layout and byte xor hash the cache used before
+struct FatVertex {
+    SbVec3f vertex;
+    SbVec3f normal;
+    SbVec4f texcoord0;
+    SbVec2f bumpcoord;
+    uint8_t rgba[4];
+    int texcoordidx;
+
+    bool operator==(const FatVertex & v) const {
+        return vertex == v.vertex && normal == v.normal &&
+            texcoord0 == v.texcoord0 && bumpcoord == v.bumpcoord &&
+            texcoordidx == v.texcoordidx && memcmp(rgba, v.rgba, 4) == 0;
+    }
+};
+
+struct FatVertexHash {
+    size_t operator()(const FatVertex & v) const {
+        unsigned long key = 0;
+        const unsigned char * ptr = reinterpret_cast<const unsigned char *>(&v);
+        const size_t size = offsetof(FatVertex, bumpcoord);
+        for (size_t i = 0; i < size; i++) {
+            key ^= (ptr[i] << ((i % 4) * 8));
+        }
+        return key;
+    }
+};
+
+struct FatCache {
+    std::vector<FatVertex> vertices;
+    std::unordered_map<FatVertex, int32_t, FatVertexHash> hash;
+    std::vector<int32_t> indices;
+
+    void add(const SoPrimitiveVertex * pv) {
+        FatVertex v;
+        memset(static_cast<void *>(&v), 0, sizeof(v));
+        v.vertex = pv->getPoint();
+        v.normal = pv->getNormal();
+        v.texcoord0 = pv->getTextureCoords();
+        v.bumpcoord = SbVec2f(v.texcoord0[0], v.texcoord0[1]);
+        v.texcoordidx = -1;
+        auto it = hash.find(v);
+        if (it != hash.end()) {
+            indices.push_back(it->second);
+        }
+        else {
+            const int32_t idx = int32_t(vertices.size());
+            hash[v] = idx;
+            vertices.push_back(v);
+            indices.push_back(idx);
+        }
+    }
+};
+
+struct BuildData {
+    bool fat;
+    SoPrimitiveVertexCache * cache;
+    FatCache * fatcache;
+    std::vector<SoPrimitiveVertexCache *> caches;
+    std::vector<FatCache *> fatcaches;
+};
+
+static SoCallbackAction::Response
+preShape(void * closure, SoCallbackAction * action, const SoNode *)
+{
+    BuildData * data = static_cast<BuildData *>(closure);
+    if (data->fat) {
+        data->fatcache = new FatCache;
+        data->fatcaches.push_back(data->fatcache);
+    }
+    else {
+        data->cache = new SoPrimitiveVertexCache(action->getState());
+        data->cache->ref();
+        data->caches.push_back(data->cache);
+    }
+    return SoCallbackAction::CONTINUE;
+}
+
+static SoCallbackAction::Response
+postShape(void * closure, SoCallbackAction * action, const SoNode *)
+{
+    BuildData * data = static_cast<BuildData *>(closure);
+    if (!data->fat) data->cache->close(action->getState());
+    return SoCallbackAction::CONTINUE;
+}
+
+static void
+addTriangle(void * closure, SoCallbackAction *,
+            const SoPrimitiveVertex * v0,
+            const SoPrimitiveVertex * v1,
+            const SoPrimitiveVertex * v2)
+{
+    BuildData * data = static_cast<BuildData *>(closure);
+    if (data->fat) {
+        data->fatcache->add(v0);
+        data->fatcache->add(v1);
+        data->fatcache->add(v2);
+    }
+    else {
+        data->cache->addTriangle(v0, v1, v2);
+    }
+}
+
+static SoSeparator *
+buildScene(int meshsize, float complexity)
+{
+    SoSeparator * root = new SoSeparator;
+    SoComplexity * c = new SoComplexity;
+    c->value = complexity;
+    root->addChild(c);
+
+    SoCoordinate3 * coords = new SoCoordinate3;
+    for (int y = 0; y < meshsize; y++) {
+        for (int x = 0; x < meshsize; x++) {
+            coords->point.set1Value(y * meshsize + x,
+                                    SbVec3f(float(x), float(y), float((x * y) % 7)));
+        }
+    }
+    root->addChild(coords);
+    SoQuadMesh * mesh = new SoQuadMesh;
+    mesh->verticesPerRow = meshsize;
+    mesh->verticesPerColumn = meshsize;
+    root->addChild(mesh);
+
+    root->addChild(new SoSphere);
+    root->addChild(new SoCone);
+    root->addChild(new SoCylinder);
+    return root;
+}
+
+static double
+build(SoNode * root, BuildData & data)
+{
+    SoCallbackAction action;
+    action.addPreCallback(SoShape::getClassTypeId(), preShape, &data);
+    action.addPostCallback(SoShape::getClassTypeId(), postShape, &data);
+    action.addTriangleCallback(SoShape::getClassTypeId(), addTriangle, &data);
+    SbTime start = SbTime::getTimeOfDay();
+    action.apply(root);
+    return (SbTime::getTimeOfDay() - start).getValue();
+}
+
+int main(int argc, char ** argv)
+{
+    TestFixture fixture;
+
+    const int meshsize = (argc > 1) ? atoi(argv[1]) : 200;
+    const float complexity = (argc > 2) ? float(atof(argv[2])) : 1.0f;
+    const int repeats = (argc > 3) ? atoi(argv[3]) : 10;
+
+    SoSeparator * root = buildScene(meshsize, complexity);
+    root->ref();
+
+    double cachetime = 0.0, fattime = 0.0;
+    size_t cachebytes = 0, indexbytes = 0, fatbytes = 0;
+    int mismatches = 0, numvertices = 0, numindices = 0;
+    for (int r = 0; r < repeats; r++) {
+        BuildData cachedata;
+        cachedata.fat = false;
+        cachetime += build(root, cachedata);
+
+        BuildData fatdata;
+        fatdata.fat = true;
+        fattime += build(root, fatdata);
+
+        if (cachedata.caches.size() != fatdata.fatcaches.size()) mismatches++;
+        for (size_t i = 0; i < cachedata.caches.size() && i < fatdata.fatcaches.size(); i++) {
+            SoPrimitiveVertexCache * cache = cachedata.caches[i];
+            FatCache * fat = fatdata.fatcaches[i];
+            const int nv = cache->getNumVertices();
+            const int ni = cache->getNumTriangleIndices();
+            if (nv != int(fat->vertices.size()) || ni != int(fat->indices.size())) {
+                mismatches++;
+            }
+            if (r == 0) {
+                numvertices += nv;
+                numindices += ni;
+                cachebytes += size_t(nv) * (2 * sizeof(SbVec3f) + sizeof(SbVec4f) +
+                                            sizeof(SbVec2f) + 4);
+                // indices are kept as int32_t, and only uploaded to an
+                // index VBO as 16 bit values when they fit
+                indexbytes += size_t(ni) * sizeof(int32_t);
+                fatbytes += fat->vertices.size() * sizeof(FatVertex) +
+                    fat->hash.size() * (sizeof(FatVertex) + sizeof(int32_t) + sizeof(void *)) +
+                    fat->indices.size() * sizeof(int32_t);
+            }
+            cache->unref();
+            delete fat;
+        }
+    }
+
+    printf("bench_pvcache: %d shapes, %d vertices, %d indices, %d repeats\n",
+           4, numvertices, numindices, repeats);
+    printf("  structure of arrays: %10.3f ms/build, %8.1f KB vertices, %8.1f KB indices\n",
+           cachetime * 1000.0 / repeats, cachebytes / 1024.0, indexbytes / 1024.0);
+    printf("  interleaved + hash:  %10.3f ms/build, %8.1f KB\n",
+           fattime * 1000.0 / repeats, fatbytes / 1024.0);
+    printf("  mismatching caches: %d\n", mismatches);
+
+    root->unref();
+    return (mismatches == 0) ? 0 : 1;
+}
@@ -0,0 +1,222 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+/**
+ * @file bench_raypick.cpp
+ * @brief Benchmark for batched ray picking.
+ *
+ * Builds a grid of shapes under separators and picks it with a fan of
+ * world space rays from a point above the grid, like a range sensor
+ * would, and with a grid of normalized viewport points through a
+ * camera. Each set of rays is picked once per ray with setRay() /
+ * setNormalizedPoint(), and once in a single traversal with setRays()
+ * / setNormalizedPoints(), checking that the picked points are the
+ * same. The world space rays are also compared with pick all enabled.
+ *
+ * Usage: bench_raypick [gridsize] [raysperside]
+ */
+
+#include "../test_utils.h"
+
+#include <Inventor/actions/SoGetBoundingBoxAction.h>
+#include <Inventor/actions/SoRayPickAction.h>
+#include <Inventor/lists/SoPickedPointList.h>
+#include <Inventor/nodes/SoCone.h>
+#include <Inventor/nodes/SoCube.h>
+#include <Inventor/nodes/SoPerspectiveCamera.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoSphere.h>
+#include <Inventor/nodes/SoTranslation.h>
+#include <Inventor/SoPickedPoint.h>
+#include <Inventor/SoPath.h>
+#include <Inventor/SbTime.h>
+#include <Inventor/SbViewportRegion.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace SimpleTest;
+
+static SoSeparator *
+buildScene(int gridsize)
+{
+    SoSeparator * root = new SoSeparator;
+    SoPerspectiveCamera * camera = new SoPerspectiveCamera;
+    root->addChild(camera);
+    for (int i = 0; i < gridsize; i++) {
+        SoSeparator * row = new SoSeparator;
+        for (int j = 0; j < gridsize; j++) {
+            SoSeparator * cell = new SoSeparator;
+            SoTranslation * translation = new SoTranslation;
+            translation->translation.setValue(3.0f * i, 0.0f, 3.0f * j);
+            cell->addChild(translation);
+            switch ((i + j) % 3) {
+            case 0: cell->addChild(new SoSphere); break;
+            case 1: cell->addChild(new SoCube); break;
+            default: cell->addChild(new SoCone); break;
+            }
+            row->addChild(cell);
+        }
+        root->addChild(row);
+    }
+    const float center = 1.5f * (gridsize - 1);
+    camera->position.setValue(center, 2.0f * gridsize, 3.0f * gridsize + 5.0f);
+    camera->pointAt(SbVec3f(center, 0.0f, center));
+    camera->nearDistance = 0.5f;
+    camera->farDistance = 10.0f * gridsize + 20.0f;
+    return root;
+}
+
+// checks that two picked point lists hold the same points on the
+// same shapes
+static bool
+sameList(const SoPickedPointList & a, const SoPickedPointList & b)
+{
+    if (a.getLength() != b.getLength()) return false;
+    for (int i = 0; i < a.getLength(); i++) {
+        if (a[i]->getPath()->getTail() != b[i]->getPath()->getTail()) return false;
+        if ((a[i]->getPoint() - b[i]->getPoint()).length() > 1.0e-4f) return false;
+    }
+    return true;
+}
+
+static double
+pickSingle(SoRayPickAction & action, SoNode * root, int numrays,
+           const SbVec3f * starts, const SbVec3f * directions,
+           const SbVec2f * points, std::vector<SoPickedPointList> & results)
+{
+    results.assign(numrays, SoPickedPointList());
+    SbTime start = SbTime::getTimeOfDay();
+    for (int i = 0; i < numrays; i++) {
+        if (points) action.setNormalizedPoint(points[i]);
+        else action.setRay(starts[i], directions[i]);
+        action.apply(root);
+        const SoPickedPointList & list = action.getPickedPointList();
+        for (int j = 0; j < list.getLength(); j++) {
+            results[i].append(list[j]->copy());
+        }
+    }
+    return (SbTime::getTimeOfDay() - start).getValue();
+}
+
+static double
+pickBatched(SoRayPickAction & action, SoNode * root, int numrays,
+            const SbVec3f * starts, const SbVec3f * directions,
+            const SbVec2f * points)
+{
+    SbTime start = SbTime::getTimeOfDay();
+    if (points) action.setNormalizedPoints(numrays, points);
+    else action.setRays(numrays, starts, directions);
+    action.apply(root);
+    return (SbTime::getTimeOfDay() - start).getValue();
+}
+
+static int
+compare(SoRayPickAction & action, int numrays,
+        const std::vector<SoPickedPointList> & results, int & numhits)
+{
+    int mismatches = 0;
+    numhits = 0;
+    for (int i = 0; i < numrays; i++) {
+        if (results[i].getLength()) numhits++;
+        if (!sameList(results[i], action.getRayPickedPointList(i))) mismatches++;
+    }
+    return mismatches;
+}
+
+int main(int argc, char ** argv)
+{
+    TestFixture fixture;
+
+    const int gridsize = (argc > 1) ? atoi(argv[1]) : 16;
+    const int raysperside = (argc > 2) ? atoi(argv[2]) : 64;
+    const int numrays = raysperside * raysperside;
+
+    SoSeparator * root = buildScene(gridsize);
+    root->ref();
+
+    SbViewportRegion vp(640, 480);
+    // set up the bounding box caches used for culling
+    SoGetBoundingBoxAction bboxaction(vp);
+    bboxaction.apply(root);
+
+    // a fan of rays from above the middle of the grid
+    const float center = 1.5f * (gridsize - 1);
+    std::vector<SbVec3f> starts(numrays), directions(numrays);
+    std::vector<SbVec2f> points(numrays);
+    for (int i = 0; i < raysperside; i++) {
+        for (int j = 0; j < raysperside; j++) {
+            const int k = i * raysperside + j;
+            const float azimuth = 2.0f * float(M_PI) * i / raysperside;
+            const float elevation = -0.1f - 1.3f * j / raysperside;
+            starts[k].setValue(center, 3.0f, center);
+            directions[k].setValue(cosf(elevation) * cosf(azimuth), sinf(elevation),
+                                   cosf(elevation) * sinf(azimuth));
+            points[k].setValue((i + 0.5f) / raysperside, (j + 0.5f) / raysperside);
+        }
+    }
+
+    SoRayPickAction single(vp), batched(vp);
+    std::vector<SoPickedPointList> results;
+    int worldhits, pointhits, pickallhits;
+
+    const double worldsingle = pickSingle(single, root, numrays, &starts[0], &directions[0], NULL, results);
+    const double worldbatched = pickBatched(batched, root, numrays, &starts[0], &directions[0], NULL);
+    const int worldmismatches = compare(batched, numrays, results, worldhits);
+
+    const double pointsingle = pickSingle(single, root, numrays, NULL, NULL, &points[0], results);
+    const double pointbatched = pickBatched(batched, root, numrays, NULL, NULL, &points[0]);
+    const int pointmismatches = compare(batched, numrays, results, pointhits);
+
+    single.setPickAll(TRUE);
+    batched.setPickAll(TRUE);
+    pickSingle(single, root, numrays, &starts[0], &directions[0], NULL, results);
+    pickBatched(batched, root, numrays, &starts[0], &directions[0], NULL);
+    const int pickallmismatches = compare(batched, numrays, results, pickallhits);
+    results.clear();
+
+    printf("bench_raypick: %d shapes, %d rays\n", gridsize * gridsize, numrays);
+    printf("  world rays, one apply per ray:     %10.3f ms\n", worldsingle * 1000.0);
+    printf("  world rays, batched:               %10.3f ms\n", worldbatched * 1000.0);
+    printf("  viewport points, one apply per ray:%10.3f ms\n", pointsingle * 1000.0);
+    printf("  viewport points, batched:          %10.3f ms\n", pointbatched * 1000.0);
+    printf("  hits: %d / %d / %d, mismatches: %d / %d / %d\n",
+           worldhits, pointhits, pickallhits,
+           worldmismatches, pointmismatches, pickallmismatches);
+
+    root->unref();
+    const bool ok = worldmismatches == 0 && pointmismatches == 0 &&
+        pickallmismatches == 0 && worldhits > 0 && pointhits > 0;
+    return ok ? 0 : 1;
+}
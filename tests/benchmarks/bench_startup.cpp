@@ -0,0 +1,162 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+/**
+ * @file bench_startup.cpp
+ * @brief Benchmark for library initialization with and without lazy registration.
+ *
+ * Times SoDB::init(), SoNodeKit::init() and SoInteraction::init(),
+ * with all classes registered up front ("eager") or with the optional
+ * subsystems registered on first use ("lazy", COIN_LAZY_INIT=1). Then
+ * times the first use of each optional subsystem, by constructing a
+ * shadow group, a dragger and a vectorize action and by reading a
+ * file with geo and nodekit nodes, and checks that all their classes
+ * are available afterwards. Run with COIN_DEBUG_INIT_TIMING=1 for the
+ * time spent on each group of classes.
+ *
+ * Usage: bench_startup [eager|lazy]
+ */
+
+#include "../test_utils.h"
+
+#include <Inventor/SoDB.h>
+#include <Inventor/SoInput.h>
+#include <Inventor/SoInteraction.h>
+#include <Inventor/SbTime.h>
+#include <Inventor/annex/FXViz/nodes/SoShadowGroup.h>
+#include <Inventor/annex/HardCopy/SoVectorizePSAction.h>
+#include <Inventor/draggers/SoTranslate1Dragger.h>
+#include <Inventor/lists/SoTypeList.h>
+#include <Inventor/nodekits/SoNodeKit.h>
+#include <Inventor/nodes/SoSeparator.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace SimpleTest;
+
+// classes of the subsystems which may be registered on first use
+static const char * const lazyclasses[] = {
+    "SoVectorizePSAction", "ShadowGroup", "ShadowStyle", "GeoOrigin",
+    "GeoSeparator", "BaseKit", "ShapeKit", "SeparatorKit",
+    "InteractionKit", "TransformerDragger", "TransformerManip",
+    "TabBoxManip", NULL
+};
+
+static double
+elapsed(const SbTime & start)
+{
+    return (SbTime::getTimeOfDay() - start).getValue() * 1000.0;
+}
+
+int main(int argc, char ** argv)
+{
+    const bool lazy = (argc > 1) && strcmp(argv[1], "lazy") == 0;
+    setenv("COIN_LAZY_INIT", lazy ? "1" : "0", 1);
+
+    SbTime start = SbTime::getTimeOfDay();
+    SoDB::init(nullptr);
+    const double dbtime = elapsed(start);
+    start = SbTime::getTimeOfDay();
+    SoNodeKit::init();
+    SoInteraction::init();
+    const double interactiontime = elapsed(start);
+
+    const int numtypes = [] {
+        SoTypeList types;
+        return SoType::getAllDerivedFrom(SoNode::getClassTypeId(), types);
+    }();
+
+    start = SbTime::getTimeOfDay();
+    SoShadowGroup * shadowgroup = new SoShadowGroup;
+    shadowgroup->ref();
+    shadowgroup->unref();
+    const double shadowtime = elapsed(start);
+
+    start = SbTime::getTimeOfDay();
+    SoNode * dragger = new SoTranslate1Dragger;
+    dragger->ref();
+    dragger->unref();
+    const double draggertime = elapsed(start);
+
+    start = SbTime::getTimeOfDay();
+    {
+        SoVectorizePSAction action;
+    }
+    const double hardcopytime = elapsed(start);
+
+    start = SbTime::getTimeOfDay();
+    static const char scene[] =
+        "#Inventor V2.1 ascii\n"
+        "Separator { GeoOrigin { } ShapeKit { } }\n";
+    SoInput in;
+    in.setBuffer(scene, strlen(scene));
+    SoSeparator * root = SoDB::readAll(&in);
+    const double readtime = elapsed(start);
+    int failures = 0;
+    if (root == NULL || root->getNumChildren() != 2) {
+        printf("  reading geo and nodekit nodes failed\n");
+        ++failures;
+    }
+    if (root) {
+        root->ref();
+        root->unref();
+    }
+
+    for (int i = 0; lazyclasses[i]; i++) {
+        const SoType type = SoType::fromName(lazyclasses[i]);
+        if (type == SoType::badType()) {
+            printf("  type %s not registered\n", lazyclasses[i]);
+            ++failures;
+        }
+    }
+    if (!SoTranslate1Dragger::getClassTypeId().isDerivedFrom(SoBaseKit::getClassTypeId())) {
+        printf("  dragger type hierarchy broken\n");
+        ++failures;
+    }
+
+    SoTypeList types;
+    const int numtypesafter = SoType::getAllDerivedFrom(SoNode::getClassTypeId(), types);
+
+    printf("bench_startup: %s registration\n", lazy ? "lazy" : "eager");
+    printf("  SoDB::init():                        %8.3f ms\n", dbtime);
+    printf("  SoNodeKit + SoInteraction::init():   %8.3f ms\n", interactiontime);
+    printf("  node types after init:               %8d\n", numtypes);
+    printf("  first SoShadowGroup:                 %8.3f ms\n", shadowtime);
+    printf("  first SoTranslate1Dragger:           %8.3f ms\n", draggertime);
+    printf("  first SoVectorizePSAction:           %8.3f ms\n", hardcopytime);
+    printf("  first read of geo and nodekit nodes: %8.3f ms\n", readtime);
+    printf("  node types after first use:          %8d\n", numtypesafter);
+    printf("  failures: %d\n", failures);
+    return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,162 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+/**
+ * @file bench_storage.cpp
+ * @brief Benchmark for thread-local storage lookups under contention.
+ *
+ * Starts a number of threads which all look up their block in a set
+ * of SbStorage objects in a tight loop and increment a counter in it.
+ * For comparison the same work is done against a mutex protected map
+ * keyed by thread id, which is how SbStorage used to resolve blocks.
+ *
+ * Usage: bench_storage [threads] [storages] [iterations]
+ */
+
+#include "../test_utils.h"
+
+#include <Inventor/threads/SbStorage.h>
+#include <Inventor/threads/SbThread.h>
+#include <Inventor/threads/SbMutex.h>
+#include <Inventor/SbTime.h>
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <thread>
+#include <vector>
+
+using namespace SimpleTest;
+
+struct BenchData {
+    std::vector<SbStorage *> * storages;
+    std::vector<std::map<std::thread::id, int> > * lockedmaps;
+    SbMutex * mutex;
+    std::atomic<long> * totals;
+    int iterations;
+};
+
+static void * storageThread(void * closure)
+{
+    BenchData * data = static_cast<BenchData *>(closure);
+    std::vector<SbStorage *> & storages = *data->storages;
+    for (int i = 0; i < data->iterations; i++) {
+        for (size_t s = 0; s < storages.size(); s++) {
+            ++(*static_cast<int *>(storages[s]->get()));
+        }
+    }
+    // the blocks are freed when the thread exits, so collect them here
+    for (size_t s = 0; s < storages.size(); s++) {
+        data->totals[s] += *static_cast<int *>(storages[s]->get());
+    }
+    return NULL;
+}
+
+static void * lockedThread(void * closure)
+{
+    BenchData * data = static_cast<BenchData *>(closure);
+    std::vector<std::map<std::thread::id, int> > & maps = *data->lockedmaps;
+    const std::thread::id self = std::this_thread::get_id();
+    for (int i = 0; i < data->iterations; i++) {
+        for (size_t s = 0; s < maps.size(); s++) {
+            data->mutex->lock();
+            int * counter = &maps[s][self];
+            data->mutex->unlock();
+            ++(*counter);
+        }
+    }
+    return NULL;
+}
+
+static double
+runThreads(int numthreads, void * (*func)(void *), BenchData * data)
+{
+    SbTime start = SbTime::getTimeOfDay();
+    std::vector<SbThread *> threads;
+    for (int t = 0; t < numthreads; t++) {
+        threads.push_back(SbThread::create(func, data));
+    }
+    for (size_t t = 0; t < threads.size(); t++) {
+        threads[t]->join();
+        SbThread::destroy(threads[t]);
+    }
+    return (SbTime::getTimeOfDay() - start).getValue();
+}
+
+static void zeroInt(void * tls) { *static_cast<int *>(tls) = 0; }
+
+int main(int argc, char ** argv)
+{
+    TestFixture fixture;
+
+    const int numthreads = (argc > 1) ? atoi(argv[1]) : 4;
+    const int numstorages = (argc > 2) ? atoi(argv[2]) : 16;
+    const int iterations = (argc > 3) ? atoi(argv[3]) : 100000;
+
+    std::vector<SbStorage *> storages;
+    for (int s = 0; s < numstorages; s++) {
+        storages.push_back(new SbStorage(sizeof(int), zeroInt, NULL));
+    }
+    std::vector<std::map<std::thread::id, int> > lockedmaps(numstorages);
+    SbMutex mutex;
+    std::vector<std::atomic<long> > totals(numstorages);
+    for (int s = 0; s < numstorages; s++) totals[s] = 0;
+
+    BenchData data;
+    data.storages = &storages;
+    data.lockedmaps = &lockedmaps;
+    data.mutex = &mutex;
+    data.totals = totals.data();
+    data.iterations = iterations;
+
+    const double lockedtime = runThreads(numthreads, lockedThread, &data);
+    const double storagetime = runThreads(numthreads, storageThread, &data);
+
+    // every thread has its own block in every storage, so no
+    // increment is lost or counted twice
+    const long expected = long(numthreads) * iterations;
+    int mismatches = 0;
+    for (int s = 0; s < numstorages; s++) {
+        if (totals[s] != expected) ++mismatches;
+    }
+
+    const double lookups = double(numthreads) * numstorages * iterations;
+    printf("bench_storage: %d threads, %d storages, %d iterations\n",
+           numthreads, numstorages, iterations);
+    printf("  mutex + map: %10.2f ns/lookup\n", lockedtime * 1e9 / lookups);
+    printf("  SbStorage:   %10.2f ns/lookup\n", storagetime * 1e9 / lookups);
+    printf("  mismatching storages: %d\n", mismatches);
+
+    for (size_t s = 0; s < storages.size(); s++) delete storages[s];
+    return (mismatches == 0) ? 0 : 1;
+}
@@ -0,0 +1,177 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+/**
+ * @file bench_traverse.cpp
+ * @brief Benchmark for action method dispatch during plain traversal.
+ *
+ * Builds a scene of nested groups with separators at the leaves and
+ * applies an SoCallbackAction with a node counting pre-callback to
+ * the root, once with the current path maintained and once with
+ * SoAction::setNeedsCurPath() turned off. The same is done for
+ * SoWriteAction, checking that the written files are identical.
+ *
+ * Usage: bench_traverse [depth] [width] [repeats]
+ */
+
+#include "../test_utils.h"
+
+#include <Inventor/actions/SoCallbackAction.h>
+#include <Inventor/actions/SoWriteAction.h>
+#include <Inventor/nodes/SoGroup.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoTransform.h>
+#include <Inventor/nodes/SoMaterial.h>
+#include <Inventor/nodes/SoCube.h>
+#include <Inventor/SoOutput.h>
+#include <Inventor/SbTime.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+using namespace SimpleTest;
+
+static SoGroup *
+buildScene(int depth, int width, int & numnodes)
+{
+    SoGroup * group = new SoGroup;
+    numnodes++;
+    for (int i = 0; i < width; i++) {
+        if (depth > 1) {
+            group->addChild(buildScene(depth - 1, width, numnodes));
+        }
+        else {
+            SoSeparator * leaf = new SoSeparator;
+            SoTransform * transform = new SoTransform;
+            transform->translation.setValue(float(i), 0.0f, 0.0f);
+            leaf->addChild(transform);
+            leaf->addChild(new SoMaterial);
+            leaf->addChild(new SoCube);
+            group->addChild(leaf);
+            numnodes += 4;
+        }
+    }
+    return group;
+}
+
+static SoCallbackAction::Response
+countNode(void * closure, SoCallbackAction *, const SoNode *)
+{
+    (*static_cast<int *>(closure))++;
+    return SoCallbackAction::CONTINUE;
+}
+
+static double
+runCallback(SoGroup * root, int repeats, bool needscurpath, int & visited)
+{
+    SoCallbackAction action;
+    action.addPreCallback(SoNode::getClassTypeId(), countNode, &visited);
+    action.setNeedsCurPath(needscurpath ? TRUE : FALSE);
+    SbTime start = SbTime::getTimeOfDay();
+    for (int r = 0; r < repeats; r++) {
+        action.apply(root);
+    }
+    return (SbTime::getTimeOfDay() - start).getValue();
+}
+
+static char * writebuffer = NULL;
+
+static void *
+growBuffer(void * ptr, size_t size)
+{
+    writebuffer = static_cast<char *>(realloc(ptr, size));
+    return writebuffer;
+}
+
+static double
+runWrite(SoGroup * root, int repeats, bool needscurpath, std::string & result)
+{
+    double total = 0.0;
+    for (int r = 0; r < repeats; r++) {
+        writebuffer = static_cast<char *>(malloc(1024));
+        SoOutput out;
+        out.setBuffer(writebuffer, 1024, growBuffer);
+        SoWriteAction action(&out);
+        action.setNeedsCurPath(needscurpath ? TRUE : FALSE);
+        SbTime start = SbTime::getTimeOfDay();
+        action.apply(root);
+        total += (SbTime::getTimeOfDay() - start).getValue();
+
+        void * buf;
+        size_t size;
+        out.getBuffer(buf, size);
+        result.assign(static_cast<const char *>(buf), size);
+        free(writebuffer);
+        writebuffer = NULL;
+    }
+    return total;
+}
+
+int main(int argc, char ** argv)
+{
+    TestFixture fixture;
+
+    const int depth = (argc > 1) ? atoi(argv[1]) : 5;
+    const int width = (argc > 2) ? atoi(argv[2]) : 8;
+    const int repeats = (argc > 3) ? atoi(argv[3]) : 20;
+
+    int numnodes = 0;
+    SoGroup * root = buildScene(depth, width, numnodes);
+    root->ref();
+
+    int pathvisits = 0, nopathvisits = 0;
+    const double pathtime = runCallback(root, repeats, true, pathvisits);
+    const double nopathtime = runCallback(root, repeats, false, nopathvisits);
+
+    std::string pathfile, nopathfile;
+    const double pathwrite = runWrite(root, repeats, true, pathfile);
+    const double nopathwrite = runWrite(root, repeats, false, nopathfile);
+
+    const int expected = numnodes * repeats;
+    const bool ok =
+        pathvisits == expected && nopathvisits == expected &&
+        !pathfile.empty() && pathfile == nopathfile;
+
+    printf("bench_traverse: %d nodes, %d repeats\n", numnodes, repeats);
+    printf("  callback, current path:     %10.3f ms/traversal\n", pathtime * 1000.0 / repeats);
+    printf("  callback, no current path:  %10.3f ms/traversal\n", nopathtime * 1000.0 / repeats);
+    printf("  write, current path:        %10.3f ms/traversal\n", pathwrite * 1000.0 / repeats);
+    printf("  write, no current path:     %10.3f ms/traversal\n", nopathwrite * 1000.0 / repeats);
+    printf("  visited nodes: %d / %d (expected %d), files %s\n",
+           pathvisits, nopathvisits, expected,
+           pathfile == nopathfile ? "identical" : "differ");
+
+    root->unref();
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,318 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+/**
+ * @file bench_vcache.cpp
+ * @brief Benchmark for post-transform vertex cache optimization of triangle caches.
+ *
+ * Builds an SoPrimitiveVertexCache for a few primitive shapes and for
+ * a grid mesh with its triangles in random order, once with vertex
+ * cache optimization disabled (the default), which just sorts the
+ * triangles on their vertex indices, and once with it enabled
+ * (COIN_VERTEX_CACHE_OPTIMIZE=1). Reports build times and the average
+ * cache miss ratio (ACMR, vertices transformed per triangle) for FIFO
+ * caches of 16 and 32 entries, and checks that both caches hold the
+ * same triangles.
+ *
+ * Coin reads the environment variable once, so each setting is built
+ * in a child process of its own.
+ *
+ * Usage: bench_vcache [gridsize] [complexity] [repeats]
+ */
+
+#include "../test_utils.h"
+
+#include <Inventor/actions/SoCallbackAction.h>
+#include <Inventor/caches/SoPrimitiveVertexCache.h>
+#include <Inventor/nodes/SoComplexity.h>
+#include <Inventor/nodes/SoCone.h>
+#include <Inventor/nodes/SoCoordinate3.h>
+#include <Inventor/nodes/SoIndexedFaceSet.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoShape.h>
+#include <Inventor/nodes/SoSphere.h>
+#include <Inventor/SoPrimitiveVertex.h>
+#include <Inventor/SbTime.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace SimpleTest;
+
+struct BuildData {
+    SoPrimitiveVertexCache * cache;
+    std::vector<SoPrimitiveVertexCache *> caches;
+};
+
+static SoCallbackAction::Response
+preShape(void * closure, SoCallbackAction * action, const SoNode *)
+{
+    BuildData * data = static_cast<BuildData *>(closure);
+    data->cache = new SoPrimitiveVertexCache(action->getState());
+    data->cache->ref();
+    data->caches.push_back(data->cache);
+    return SoCallbackAction::CONTINUE;
+}
+
+static SoCallbackAction::Response
+postShape(void * closure, SoCallbackAction * action, const SoNode *)
+{
+    BuildData * data = static_cast<BuildData *>(closure);
+    data->cache->close(action->getState());
+    return SoCallbackAction::CONTINUE;
+}
+
+static void
+addTriangle(void * closure, SoCallbackAction *,
+            const SoPrimitiveVertex * v0,
+            const SoPrimitiveVertex * v1,
+            const SoPrimitiveVertex * v2)
+{
+    BuildData * data = static_cast<BuildData *>(closure);
+    data->cache->addTriangle(v0, v1, v2);
+}
+
+static SoSeparator *
+buildScene(int gridsize, float complexity)
+{
+    SoSeparator * root = new SoSeparator;
+    SoComplexity * c = new SoComplexity;
+    c->value = complexity;
+    root->addChild(c);
+    root->addChild(new SoSphere);
+    root->addChild(new SoCone);
+
+    SoCoordinate3 * coords = new SoCoordinate3;
+    for (int y = 0; y <= gridsize; y++) {
+        for (int x = 0; x <= gridsize; x++) {
+            coords->point.set1Value(y * (gridsize + 1) + x,
+                                    SbVec3f(float(x), float(y), 0.0f));
+        }
+    }
+    root->addChild(coords);
+
+    // triangles of the grid in random order, like a mesh read from a
+    // file that was never optimized
+    std::vector<std::array<int32_t, 3>> tris;
+    for (int y = 0; y < gridsize; y++) {
+        for (int x = 0; x < gridsize; x++) {
+            const int32_t i = y * (gridsize + 1) + x;
+            tris.push_back({{i, i + 1, i + gridsize + 2}});
+            tris.push_back({{i, i + gridsize + 2, i + gridsize + 1}});
+        }
+    }
+    std::mt19937 rng(4711);
+    std::shuffle(tris.begin(), tris.end(), rng);
+
+    SoIndexedFaceSet * ifs = new SoIndexedFaceSet;
+    int n = 0;
+    for (const auto & t : tris) {
+        ifs->coordIndex.set1Value(n++, t[0]);
+        ifs->coordIndex.set1Value(n++, t[1]);
+        ifs->coordIndex.set1Value(n++, t[2]);
+        ifs->coordIndex.set1Value(n++, -1);
+    }
+    root->addChild(ifs);
+    return root;
+}
+
+static double
+build(SoNode * root, BuildData & data)
+{
+    SoCallbackAction action;
+    action.addPreCallback(SoShape::getClassTypeId(), preShape, &data);
+    action.addPostCallback(SoShape::getClassTypeId(), postShape, &data);
+    action.addTriangleCallback(SoShape::getClassTypeId(), addTriangle, &data);
+    SbTime start = SbTime::getTimeOfDay();
+    action.apply(root);
+    return (SbTime::getTimeOfDay() - start).getValue();
+}
+
+// vertices transformed when the indices are rendered through a FIFO
+// vertex cache with cachesize entries
+static int
+countMisses(const int32_t * idx, int num, int numvertices, int cachesize)
+{
+    std::vector<int> stamp(numvertices, -1);
+    int misses = 0;
+    for (int i = 0; i < num; i++) {
+        const int32_t v = idx[i];
+        if (stamp[v] < 0 || misses - stamp[v] >= cachesize) stamp[v] = misses++;
+    }
+    return misses;
+}
+
+// the triangles of a cache by vertex position, each rotated to start
+// at its smallest vertex so the winding is kept, and sorted
+static std::vector<std::array<float, 9>>
+triangleSet(SoPrimitiveVertexCache * cache)
+{
+    std::vector<std::array<float, 9>> set;
+    const int32_t * idx = cache->getTriangleIndices();
+    const SbVec3f * v = cache->getVertexArray();
+    for (int i = 0; i < cache->getNumTriangleIndices(); i += 3) {
+        std::array<float, 9> t;
+        for (int j = 0; j < 3; j++) {
+            for (int k = 0; k < 3; k++) t[j * 3 + k] = v[idx[i + j]][k];
+        }
+        std::array<float, 9> best = t;
+        for (int r = 1; r < 3; r++) {
+            std::array<float, 9> rot;
+            for (int j = 0; j < 9; j++) rot[j] = t[(j + r * 3) % 9];
+            if (rot < best) best = rot;
+        }
+        set.push_back(best);
+    }
+    std::sort(set.begin(), set.end());
+    return set;
+}
+
+// FNV-1a hash of a triangle set, so the sets can be compared across
+// processes
+static uint64_t
+hashSet(const std::vector<std::array<float, 9>> & set)
+{
+    uint64_t h = 14695981039346656037ull;
+    for (const auto & t : set) {
+        const unsigned char * bytes = reinterpret_cast<const unsigned char *>(t.data());
+        for (size_t i = 0; i < sizeof(float) * 9; i++) {
+            h = (h ^ bytes[i]) * 1099511628211ull;
+        }
+    }
+    return h;
+}
+
+enum { MAX_CACHES = 16 };
+
+struct Stats {
+    double time = 0.0;
+    int triangles = 0;
+    int misses16 = 0;
+    int misses32 = 0;
+    int numcaches = 0;
+    uint64_t hashes[MAX_CACHES] = {};
+};
+
+static void
+collect(const BuildData & data, Stats & stats)
+{
+    for (SoPrimitiveVertexCache * cache : data.caches) {
+        const int num = cache->getNumTriangleIndices();
+        const int32_t * idx = cache->getTriangleIndices();
+        stats.triangles += num / 3;
+        stats.misses16 += countMisses(idx, num, cache->getNumVertices(), 16);
+        stats.misses32 += countMisses(idx, num, cache->getNumVertices(), 32);
+        if (stats.numcaches < MAX_CACHES) {
+            stats.hashes[stats.numcaches++] = hashSet(triangleSet(cache));
+        }
+    }
+}
+
+// builds the caches repeats times in a child process with the given
+// COIN_VERTEX_CACHE_OPTIMIZE value, and returns the stats through a pipe
+static bool
+runChild(SoNode * root, const char * optimize, int repeats, Stats & stats)
+{
+    int fds[2];
+    if (pipe(fds) != 0) return false;
+    fflush(stdout);
+    const pid_t pid = fork();
+    if (pid < 0) return false;
+    if (pid == 0) {
+        close(fds[0]);
+        setenv("COIN_VERTEX_CACHE_OPTIMIZE", optimize, 1);
+        Stats result;
+        for (int r = 0; r < repeats; r++) {
+            BuildData data;
+            result.time += build(root, data);
+            if (r == 0) collect(data, result);
+            for (SoPrimitiveVertexCache * cache : data.caches) cache->unref();
+        }
+        const bool ok = write(fds[1], &result, sizeof(result)) == (ssize_t) sizeof(result);
+        _exit(ok ? 0 : 1);
+    }
+    close(fds[1]);
+    const bool ok = read(fds[0], &stats, sizeof(stats)) == (ssize_t) sizeof(stats);
+    close(fds[0]);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return ok && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+int main(int argc, char ** argv)
+{
+    TestFixture fixture;
+
+    const int gridsize = (argc > 1) ? atoi(argv[1]) : 200;
+    const float complexity = (argc > 2) ? float(atof(argv[2])) : 1.0f;
+    const int repeats = (argc > 3) ? atoi(argv[3]) : 5;
+
+    SoSeparator * root = buildScene(gridsize, complexity);
+    root->ref();
+
+    Stats sorted, optimized;
+    if (!runChild(root, "0", repeats, sorted) ||
+        !runChild(root, "1", repeats, optimized)) {
+        fprintf(stderr, "bench_vcache: failed to run the builds\n");
+        root->unref();
+        return 1;
+    }
+
+    int mismatches = 0;
+    if (sorted.numcaches != optimized.numcaches) mismatches++;
+    for (int i = 0; i < sorted.numcaches && i < optimized.numcaches; i++) {
+        if (sorted.hashes[i] != optimized.hashes[i]) mismatches++;
+    }
+
+    const float tris = float(SbMax(sorted.triangles, 1));
+    printf("bench_vcache: %d triangles, %d repeats\n", sorted.triangles, repeats);
+    printf("  sorted:    %10.3f ms/build, ACMR %.3f (16), %.3f (32)\n",
+           sorted.time * 1000.0 / repeats,
+           sorted.misses16 / tris, sorted.misses32 / tris);
+    printf("  optimized: %10.3f ms/build, ACMR %.3f (16), %.3f (32)\n",
+           optimized.time * 1000.0 / repeats,
+           optimized.misses16 / tris, optimized.misses32 / tris);
+    printf("  mismatching caches: %d\n", mismatches);
+
+    root->unref();
+    const bool better = optimized.misses16 <= sorted.misses16;
+    return (mismatches == 0 && better) ? 0 : 1;
+}
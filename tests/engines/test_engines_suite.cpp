@@ -44,6 +44,7 @@
  *   SoBoolOperation   - boolean logic
  *   SoElapsedTime     - time output field type
  *   SoConcatenate     - concatenate multi-value fields
+ *   SoEngine          - scheduled evaluation
  */
 
 #include "../test_utils.h"
@@ -54,15 +55,87 @@
 #include <Inventor/engines/SoBoolOperation.h>
 #include <Inventor/engines/SoElapsedTime.h>
 #include <Inventor/engines/SoConcatenate.h>
+#include <Inventor/engines/SoSubEngine.h>
+#include <Inventor/nodes/SoComplexity.h>
 #include <Inventor/fields/SoSFFloat.h>
 #include <Inventor/fields/SoSFVec3f.h>
 #include <Inventor/fields/SoMFFloat.h>
 #include <Inventor/fields/SoMFVec3f.h>
 #include <Inventor/SoType.h>
 #include <Inventor/SoDB.h>
+#include <Inventor/sensors/SoSensorManager.h>
+
+#include <atomic>
 
 using namespace SimpleTest;
 
+// computes out = (a + b) * scale + offset, and counts its evaluations.
+// Evaluating another CountingEngine from within evaluate(), which
+// happens when an input is read before its engine was evaluated, is
+// recorded in nested.
+class CountingEngine : public SoEngine {
+    SO_ENGINE_HEADER(CountingEngine);
+public:
+    static void initClass(void);
+    CountingEngine(void);
+
+    SoSFFloat a;
+    SoSFFloat b;
+    SoEngineOutput out; // SoSFFloat
+
+    float scale;
+    float offset;
+    std::atomic<int> numevaluations;
+    static std::atomic<bool> nested;
+
+protected:
+    virtual ~CountingEngine() {}
+
+private:
+    virtual void evaluate(void);
+};
+
+SO_ENGINE_SOURCE(CountingEngine);
+
+std::atomic<bool> CountingEngine::nested(false);
+static thread_local int counting_engine_depth = 0;
+
+void
+CountingEngine::initClass(void)
+{
+    SO_ENGINE_INIT_CLASS(CountingEngine, SoEngine, "Engine");
+}
+
+CountingEngine::CountingEngine(void)
+    : scale(1.0f), offset(0.0f), numevaluations(0)
+{
+    SO_ENGINE_CONSTRUCTOR(CountingEngine);
+    SO_ENGINE_ADD_INPUT(a, (0.0f));
+    SO_ENGINE_ADD_INPUT(b, (0.0f));
+    SO_ENGINE_ADD_OUTPUT(out, SoSFFloat);
+}
+
+void
+CountingEngine::evaluate(void)
+{
+    if (counting_engine_depth > 0) nested = true;
+    counting_engine_depth++;
+    this->numevaluations++;
+    const float value = (this->a.getValue() + this->b.getValue()) * this->scale + this->offset;
+    counting_engine_depth--;
+    SO_ENGINE_OUTPUT(out, SoSFFloat, setValue(value));
+}
+
+static CountingEngine *
+new_counting_engine(const float scale, const float offset)
+{
+    CountingEngine * engine = new CountingEngine;
+    engine->ref();
+    engine->scale = scale;
+    engine->offset = offset;
+    return engine;
+}
+
 int main()
 {
     TestFixture fixture;
@@ -114,6 +187,205 @@ int main()
             "SoCalculator a*3 should equal 30");
     }
 
+    runner.startTest("SoCalculator multi-value vector expression");
+    {
+        // More values than one evaluation block, with a shorter input
+        // field that must be padded with its last value.
+        const int num = 1000;
+        SoCalculator* calc = new SoCalculator;
+        calc->ref();
+        calc->a.setNum(num);
+        calc->A.setNum(num);
+        float* av = calc->a.startEditing();
+        SbVec3f* Av = calc->A.startEditing();
+        for (int i = 0; i < num; i++) {
+            av[i] = float(i);
+            Av[i].setValue(float(i), 1.0f, -1.0f);
+        }
+        calc->a.finishEditing();
+        calc->A.finishEditing();
+        const float bv[] = { 1.0f, 2.0f };
+        calc->b.setValues(0, 2, bv);
+        calc->expression.set1Value(0, "tA = A * b; ta = a > 500 ? a : -a");
+        calc->expression.set1Value(1, "oA = tA + vec3f(0, 0, ta); oa = dot(A, A)");
+
+        SoMFVec3f resultA;
+        SoMFFloat resulta;
+        resultA.connectFrom(&calc->oA);
+        resulta.connectFrom(&calc->oa);
+        resultA.evaluate();
+        resulta.evaluate();
+
+        bool pass = (resultA.getNum() == num) && (resulta.getNum() == num);
+        for (int i = 0; pass && i < num; i++) {
+            float b = (i == 0) ? 1.0f : 2.0f;
+            float ta = (i > 500) ? float(i) : -float(i);
+            SbVec3f expect(float(i) * b, b, -b + ta);
+            pass = (resultA[i] == expect) &&
+                   (resulta[i] == float(i) * float(i) + 2.0f);
+        }
+        calc->unref();
+        runner.endTest(pass, pass ? "" :
+            "SoCalculator multi-value evaluation gave wrong results");
+    }
+
+    runner.startTest("SoCalculator temporary carried between values");
+    {
+        // tb is read before it is written, so it holds the value from
+        // the previous field index (a running sum).
+        SoCalculator* calc = new SoCalculator;
+        calc->ref();
+        const float vals[] = { 1.0f, 2.0f, 3.0f, 4.0f };
+        calc->a.setValues(0, 4, vals);
+        calc->expression.setValue("ta = tb + a; tb = ta; oa = ta");
+
+        SoMFFloat result;
+        result.connectFrom(&calc->oa);
+        result.evaluate();
+
+        bool pass = (result.getNum() == 4) &&
+                    (result[0] == 1.0f) && (result[1] == 3.0f) &&
+                    (result[2] == 6.0f) && (result[3] == 10.0f);
+        calc->unref();
+        runner.endTest(pass, pass ? "" :
+            "SoCalculator running sum through temporaries is wrong");
+    }
+
+    runner.startTest("SoCalculator recompiles on expression change");
+    {
+        SoCalculator* calc = new SoCalculator;
+        calc->ref();
+        calc->a.setValue(3.0f);
+        calc->expression.setValue("oa = a + 1");
+
+        SoMFFloat result;
+        result.connectFrom(&calc->oa);
+        result.evaluate();
+        bool pass = (result.getNum() == 1) && (result[0] == 4.0f);
+
+        calc->expression.setValue("oa = a * a");
+        result.evaluate();
+        pass = pass && (result.getNum() == 1) && (result[0] == 9.0f);
+        calc->unref();
+        runner.endTest(pass, pass ? "" :
+            "SoCalculator did not pick up the new expression");
+    }
+
+    // -----------------------------------------------------------------------
+    // Scheduled engine evaluation
+    // -----------------------------------------------------------------------
+    CountingEngine::initClass();
+    for (int numthreads = 0; numthreads <= 3; numthreads += 3) {
+        runner.startTest(numthreads ? "Scheduled evaluation of engine diamond (threads)"
+                                    : "Scheduled evaluation of engine diamond");
+        // top feeds left and right, which both feed bottom
+        CountingEngine* top = new_counting_engine(1.0f, 1.0f);
+        CountingEngine* left = new_counting_engine(2.0f, 0.0f);
+        CountingEngine* right = new_counting_engine(3.0f, 0.0f);
+        CountingEngine* bottom = new_counting_engine(1.0f, 0.0f);
+        CountingEngine* engines[4] = { top, left, right, bottom };
+        left->a.connectFrom(&top->out);
+        right->a.connectFrom(&top->out);
+        bottom->a.connectFrom(&left->out);
+        bottom->b.connectFrom(&right->out);
+        SoSFFloat result;
+        result.connectFrom(&bottom->out);
+        result.getValue();
+        CountingEngine::nested = false;
+
+        SoEngine::setScheduledEvaluation(TRUE, numthreads);
+        bool pass = SoEngine::isScheduledEvaluation() &&
+                    (SoEngine::getScheduledEvaluationThreads() == numthreads);
+
+        // each engine is evaluated once, after the engines it reads from
+        for (int i = 0; i < 4; i++) engines[i]->numevaluations = 0;
+        top->a.setValue(1.0f);
+        SoDB::getSensorManager()->processDelayQueue(FALSE);
+        for (int i = 0; i < 4; i++) pass = pass && (engines[i]->numevaluations == 1);
+        pass = pass && !CountingEngine::nested;
+        pass = pass && (result.getValue() == 10.0f);
+
+        // reading before the flush still evaluates on demand
+        top->a.setValue(2.0f);
+        pass = pass && (result.getValue() == 15.0f);
+        SoEngine::evaluateScheduled();
+        pass = pass && (result.getValue() == 15.0f);
+        for (int i = 0; i < 4; i++) pass = pass && (engines[i]->numevaluations == 2);
+
+        // an engine destroyed while scheduled is dropped
+        CountingEngine* extra = new_counting_engine(1.0f, 0.0f);
+        extra->a.connectFrom(&top->out);
+        top->a.setValue(3.0f);
+        extra->unref();
+        SoEngine::evaluateScheduled();
+        pass = pass && (result.getValue() == 20.0f);
+
+        SoEngine::setScheduledEvaluation(FALSE);
+        pass = pass && !SoEngine::isScheduledEvaluation();
+        top->a.setValue(4.0f);
+        pass = pass && (result.getValue() == 25.0f);
+
+        result.disconnect();
+        for (int i = 0; i < 4; i++) engines[i]->unref();
+        runner.endTest(pass, pass ? "" :
+            "Scheduled engine evaluation gave wrong results or evaluation counts");
+    }
+
+    for (int numthreads = 0; numthreads <= 3; numthreads += 3) {
+        runner.startTest(numthreads ? "Scheduled evaluation through node fields (threads)"
+                                    : "Scheduled evaluation through node fields");
+        // chains of engine -> node field -> engine, which must not be
+        // evaluated in the same batch. The second engines also read a
+        // plain field, changed first so they are scheduled first.
+        const int numchains = 16;
+        CountingEngine* first[numchains];
+        CountingEngine* second[numchains];
+        SoComplexity* nodes[numchains];
+        SoSFFloat results[numchains];
+        SoSFFloat triggers[numchains];
+        for (int i = 0; i < numchains; i++) {
+            first[i] = new_counting_engine(1.0f, float(i));
+            second[i] = new_counting_engine(2.0f, 0.0f);
+            nodes[i] = new SoComplexity;
+            nodes[i]->ref();
+            nodes[i]->value.connectFrom(&first[i]->out);
+            second[i]->a.connectFrom(&nodes[i]->value);
+            second[i]->b.connectFrom(&triggers[i]);
+            results[i].connectFrom(&second[i]->out);
+            results[i].getValue();
+        }
+        CountingEngine::nested = false;
+
+        SoEngine::setScheduledEvaluation(TRUE, numthreads);
+        bool pass = true;
+        for (int round = 1; round <= 20 && pass; round++) {
+            for (int i = 0; i < numchains; i++) {
+                first[i]->numevaluations = 0;
+                second[i]->numevaluations = 0;
+                triggers[i].setValue(float(round));
+            }
+            for (int i = 0; i < numchains; i++) first[i]->a.setValue(float(round));
+            SoEngine::evaluateScheduled();
+            for (int i = 0; i < numchains; i++) {
+                pass = pass &&
+                    (first[i]->numevaluations == 1) &&
+                    (second[i]->numevaluations == 1) &&
+                    (results[i].getValue() == 2.0f * (2 * round + i));
+            }
+            pass = pass && !CountingEngine::nested;
+        }
+        SoEngine::setScheduledEvaluation(FALSE);
+
+        for (int i = 0; i < numchains; i++) {
+            results[i].disconnect();
+            second[i]->unref();
+            nodes[i]->unref();
+            first[i]->unref();
+        }
+        runner.endTest(pass, pass ? "" :
+            "Engines connected through node fields were evaluated out of order");
+    }
+
     // -----------------------------------------------------------------------
     // SoComposeVec3f: combine three floats into a Vec3f
     // -----------------------------------------------------------------------
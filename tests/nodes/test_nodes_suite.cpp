@@ -39,6 +39,9 @@
  * Vanilla sources:
  *   src/nodes/SoAnnotation.cpp - initialized (getTypeId, ref/unref)
  *
+ * Also covers SoBVHSeparator, comparing its bounding boxes and ray
+ * picks with those of a plain SoSeparator over the same children.
+ *
  * Also covers SoType system (SoType::createType / removeType) as used
  * throughout the node hierarchy:
  *   src/misc/SoType.cpp - testRemoveType
@@ -60,12 +63,128 @@
 #include <Inventor/nodes/SoRotation.h>
 #include <Inventor/nodes/SoMaterial.h>
 #include <Inventor/nodes/SoDirectionalLight.h>
+#include <Inventor/nodes/SoBVHSeparator.h>
+#include <Inventor/nodes/SoSubNode.h>
+#include <Inventor/actions/SoGetBoundingBoxAction.h>
+#include <Inventor/actions/SoRayPickAction.h>
+#include <Inventor/SoPickedPoint.h>
+#include <Inventor/SoPath.h>
+#include <Inventor/SbViewportRegion.h>
+
+#include <cmath>
+#include <vector>
 
 using namespace SimpleTest;
 
 // Factory function needed by SoType::createType
 static void* createDummyInstance(void) { return reinterpret_cast<void*>(0x1); }
 
+// A cube which reports its bounding box far away from where it is.
+// Picking it only works when its parent doesn't cull children by
+// their bounding boxes, which shows whether SoBVHSeparator uses its
+// hierarchy.
+class MisplacedBBoxCube : public SoCube {
+    SO_NODE_HEADER(MisplacedBBoxCube);
+public:
+    static void initClass(void);
+    MisplacedBBoxCube(void);
+
+protected:
+    virtual ~MisplacedBBoxCube() {}
+    virtual void computeBBox(SoAction * action, SbBox3f & box, SbVec3f & center);
+};
+
+SO_NODE_SOURCE(MisplacedBBoxCube);
+
+void
+MisplacedBBoxCube::initClass(void)
+{
+    SO_NODE_INIT_CLASS(MisplacedBBoxCube, SoCube, "Cube");
+}
+
+MisplacedBBoxCube::MisplacedBBoxCube(void)
+{
+    SO_NODE_CONSTRUCTOR(MisplacedBBoxCube);
+}
+
+void
+MisplacedBBoxCube::computeBBox(SoAction *, SbBox3f & box, SbVec3f & center)
+{
+    box.setBounds(SbVec3f(100.0f, 100.0f, 100.0f), SbVec3f(101.0f, 101.0f, 101.0f));
+    center = box.getCenter();
+}
+
+// Adds an 8x8 grid of separated cubes to both groups, sharing the
+// children. The translations are returned so tests can move cubes.
+static void bvh_add_grid(SoGroup* a, SoGroup* b, std::vector<SoTranslation*>& moves)
+{
+    for (int i = 0; i < 64; i++) {
+        SoSeparator* child = new SoSeparator;
+        SoTranslation* move = new SoTranslation;
+        move->translation.setValue(float(i % 8) * 3.0f, float(i / 8) * 3.0f, 0.0f);
+        child->addChild(move);
+        child->addChild(new SoCube);
+        a->addChild(child);
+        b->addChild(child);
+        moves.push_back(move);
+    }
+}
+
+static SbBox3f bvh_bbox(SoNode* root, SbBool subgraphcaching = FALSE)
+{
+    SoGetBoundingBoxAction action(SbViewportRegion(100, 100));
+    action.setSubgraphCaching(subgraphcaching);
+    action.apply(root);
+    return action.getBoundingBox();
+}
+
+static bool bvh_same_box(const SbBox3f& a, const SbBox3f& b)
+{
+    if (a.isEmpty() || b.isEmpty()) return a.isEmpty() == b.isEmpty();
+    return (a.getMin() - b.getMin()).length() < 1e-4f &&
+           (a.getMax() - b.getMax()).length() < 1e-4f;
+}
+
+// Picks all along a ray parallel to the z axis, and returns the
+// picked points and the shapes they are on.
+static void bvh_pick(SoNode* root, float x, float y,
+                     std::vector<SbVec3f>& points, std::vector<SoNode*>& tails)
+{
+    SoRayPickAction action(SbViewportRegion(100, 100));
+    action.setRay(SbVec3f(x, y, 10.0f), SbVec3f(0.0f, 0.0f, -1.0f));
+    action.setPickAll(TRUE);
+    action.apply(root);
+    const SoPickedPointList& list = action.getPickedPointList();
+    points.clear();
+    tails.clear();
+    for (int i = 0; i < list.getLength(); i++) {
+        points.push_back(list[i]->getPoint());
+        tails.push_back(list[i]->getPath()->getTail());
+    }
+}
+
+// Compares picks through a grid of rays covering the given area.
+static bool bvh_same_picks(SoNode* a, SoNode* b, float minx, float maxx,
+                           float miny, float maxy, int& numhits)
+{
+    numhits = 0;
+    for (float y = miny; y <= maxy; y += 0.75f) {
+        for (float x = minx; x <= maxx; x += 0.75f) {
+            std::vector<SbVec3f> pa, pb;
+            std::vector<SoNode*> ta, tb;
+            bvh_pick(a, x, y, pa, ta);
+            bvh_pick(b, x, y, pb, tb);
+            if (pa.size() != pb.size() || ta != tb) return false;
+            for (size_t i = 0; i < pa.size(); i++) {
+                if ((pa[i] - pb[i]).length() > 1e-4f) return false;
+            }
+            numhits += int(pa.size());
+        }
+    }
+    return true;
+}
+
+
 int main()
 {
     TestFixture fixture;
@@ -243,5 +362,73 @@ int main()
             "SoMaterial default diffuseColor should have 1 value");
     }
 
+    // -----------------------------------------------------------------------
+    // SoBVHSeparator: same bounding boxes and picks as SoSeparator
+    // -----------------------------------------------------------------------
+    runner.startTest("SoBVHSeparator bounding box and picks match SoSeparator");
+    {
+        SoBVHSeparator* bvh = new SoBVHSeparator;
+        SoSeparator* plain = new SoSeparator;
+        bvh->ref();
+        plain->ref();
+        std::vector<SoTranslation*> moves;
+        bvh_add_grid(bvh, plain, moves);
+
+        // the first traversal builds the hierarchy, the second uses it
+        bool pass = bvh_same_box(bvh_bbox(bvh), bvh_bbox(plain));
+        pass = pass && bvh_same_box(bvh_bbox(bvh), bvh_bbox(plain));
+        int numhits = 0;
+        pass = pass && bvh_same_picks(bvh, plain, -2.0f, 23.0f, -2.0f, 23.0f, numhits);
+        pass = pass && numhits > 0;
+
+        // moving children makes the hierarchy be refitted
+        moves[9]->translation.setValue(40.0f, -6.0f, 2.0f);
+        moves[50]->translation.setValue(-9.0f, 30.0f, -3.0f);
+        pass = pass && bvh_same_box(bvh_bbox(bvh), bvh_bbox(plain));
+        pass = pass && bvh_same_picks(bvh, plain, -11.0f, 42.0f, -8.0f, 32.0f, numhits);
+
+        // and picking without a bounding box traversal after a move
+        // still finds the moved child
+        moves[9]->translation.setValue(3.0f, 30.0f, 0.0f);
+        pass = pass && bvh_same_picks(bvh, plain, -2.0f, 23.0f, -2.0f, 32.0f, numhits);
+        pass = pass && bvh_same_box(bvh_bbox(bvh), bvh_bbox(plain));
+
+        bvh->unref();
+        plain->unref();
+        runner.endTest(pass, pass ? "" :
+            "SoBVHSeparator bounding box or picks differ from SoSeparator");
+    }
+
+    runner.startTest("SoBVHSeparator boundingBoxCaching OFF disables the hierarchy");
+    {
+        MisplacedBBoxCube::initClass();
+        SoBVHSeparator* bvh = new SoBVHSeparator;
+        bvh->ref();
+        std::vector<SoTranslation*> moves;
+        SoSeparator* unused = new SoSeparator;
+        unused->ref();
+        bvh_add_grid(bvh, unused, moves);
+        bvh->addChild(new MisplacedBBoxCube);
+
+        // the hierarchy is used by default, so the cube is culled by
+        // the bounding box it reports
+        std::vector<SbVec3f> points;
+        std::vector<SoNode*> tails;
+        bvh_bbox(bvh);
+        bvh_pick(bvh, 0.5f, 0.5f, points, tails);
+        bool pass = points.size() == 2;
+
+        // OFF wins over subgraph caching on the action
+        bvh->boundingBoxCaching = SoSeparator::OFF;
+        bvh_bbox(bvh, TRUE);
+        bvh_pick(bvh, 0.5f, 0.5f, points, tails);
+        pass = pass && points.size() == 4;
+
+        unused->unref();
+        bvh->unref();
+        runner.endTest(pass, pass ? "" :
+            "SoBVHSeparator with boundingBoxCaching OFF should not use its hierarchy");
+    }
+
     return runner.getSummary();
 }
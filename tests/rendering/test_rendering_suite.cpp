@@ -0,0 +1,993 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+
+/**
+ * @file test_rendering_suite.cpp
+ * @brief Tests for internal rendering classes which don't need an
+ *        OpenGL context.
+ *
+ * These tests include private headers from src/ and are built with
+ * COIN_INTERNAL defined.
+ *
+ * Classes covered:
+ *   SoVBO             - vertex attribute compression and memory statistics
+ *   SoGLVBOElement    - public attribute compression settings
+ *   SoLODSelector     - budgeted level-of-detail selection
+ *   SoGLResourceManager - per-context memory accounting and eviction
+ *   SoTilePyramid     - tile pyramid files for SoGLBigImage
+ *   SoRenderStatistics - counting, display list recording and replay
+ */
+
+#include "../test_utils.h"
+
+#include <Inventor/SbVec3f.h>
+#include <Inventor/elements/SoGLVBOElement.h>
+#include <Inventor/misc/SoGLResourceManager.h>
+#include <Inventor/misc/SoRenderStatistics.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "rendering/SoGLResourceManagerP.h"
+#include "rendering/SoLODSelector.h"
+#include "rendering/SoRenderStatisticsP.h"
+#include "rendering/SoTilePyramid.h"
+#include "rendering/SoVBO.h"
+
+using namespace SimpleTest;
+
+// decodes a half float, including denormals
+static float
+half_to_float(const uint16_t half)
+{
+    const int sign = (half & 0x8000) ? -1 : 1;
+    const int exponent = (half >> 10) & 0x1f;
+    const int mantissa = half & 0x3ff;
+    if (exponent == 0) return sign * std::ldexp(float(mantissa), -24);
+    if (exponent == 31) return sign * INFINITY;
+    return sign * std::ldexp(float(mantissa + 0x400), exponent - 25);
+}
+
+static uint16_t
+compress_texcoord(const float value)
+{
+    SoVBO vbo;
+    const float coord[2] = { value, 0.0f };
+    vbo.setTexCoordData(coord, 1, 2, 1);
+    const GLvoid * data;
+    intptr_t size;
+    vbo.getBufferData(data, size);
+    uint16_t half = 0;
+    if (vbo.getDataType() == GL_HALF_FLOAT) {
+        std::memcpy(&half, data, sizeof(uint16_t));
+    }
+    return half;
+}
+
+// creates a record with the given primitive counts, finest first
+static SoLODSelector::Record *
+make_lod_record(const int * counts, const int num, const float diameter)
+{
+    SoLODSelector::Record * rec = new SoLODSelector::Record;
+    for (int i = 0; i < num; i++) rec->counts.append(counts[i]);
+    SoLODSelector::setErrors(rec, diameter);
+    return rec;
+}
+
+// a scene of LOD nodes with four levels of decreasing detail, and
+// decreasing projected size
+static void
+make_lod_scene(SbList<SoLODSelector::Record *> & records, const int num)
+{
+    for (int i = 0; i < num; i++) {
+        const int base = 1000 + (i * 7919) % 5000;
+        const int counts[4] = { base, base / 4, base / 16, base / 64 };
+        records.append(make_lod_record(counts, 4, 400.0f / (1 + i % 10)));
+    }
+}
+
+static void
+delete_lod_scene(SbList<SoLODSelector::Record *> & records)
+{
+    for (int i = 0; i < records.getLength(); i++) delete records[i];
+    records.truncate(0);
+}
+
+static int
+sum_lod_level(const SbList<SoLODSelector::Record *> & records, const int level)
+{
+    int sum = 0;
+    for (int i = 0; i < records.getLength(); i++) sum += records[i]->counts[level];
+    return sum;
+}
+
+// a test image with a different value in every component
+static std::vector<unsigned char>
+make_pyramid_image(const SbVec2i32 & size, const int nc)
+{
+    std::vector<unsigned char> bytes(size_t(size[0]) * size[1] * nc);
+    for (int y = 0; y < size[1]; y++) {
+        for (int x = 0; x < size[0]; x++) {
+            for (int c = 0; c < nc; c++) {
+                bytes[(size_t(y) * size[0] + x) * nc + c] =
+                    (unsigned char) ((x * 7 + y * 13 + c * 50) & 0xff);
+            }
+        }
+    }
+    return bytes;
+}
+
+// reference 2x2 box filter, dropping the last row/column of odd sizes
+static std::vector<unsigned char>
+halve_pyramid_image(const std::vector<unsigned char> & src,
+                    const SbVec2i32 & size, const int nc, SbVec2i32 & halfsize)
+{
+    halfsize = SbVec2i32(SbMax(size[0] / 2, 1), SbMax(size[1] / 2, 1));
+    std::vector<unsigned char> dst(size_t(halfsize[0]) * halfsize[1] * nc);
+    for (int y = 0; y < halfsize[1]; y++) {
+        const int y0 = SbMin(2 * y, size[1] - 1), y1 = SbMin(2 * y + 1, size[1] - 1);
+        for (int x = 0; x < halfsize[0]; x++) {
+            const int x0 = SbMin(2 * x, size[0] - 1), x1 = SbMin(2 * x + 1, size[0] - 1);
+            for (int c = 0; c < nc; c++) {
+                const int sum =
+                    src[(size_t(y0) * size[0] + x0) * nc + c] +
+                    src[(size_t(y0) * size[0] + x1) * nc + c] +
+                    src[(size_t(y1) * size[0] + x0) * nc + c] +
+                    src[(size_t(y1) * size[0] + x1) * nc + c];
+                dst[(size_t(y) * halfsize[0] + x) * nc + c] = (unsigned char) ((sum + 2) >> 2);
+            }
+        }
+    }
+    return dst;
+}
+
+// reads a whole level of an opened pyramid, waiting for the loader thread
+static bool
+read_pyramid_level(SoTilePyramid & pyramid, const int level,
+                   std::vector<unsigned char> & bytes)
+{
+    const SbVec2i32 size = pyramid.getLevelSize(level);
+    bytes.resize(size_t(size[0]) * size[1] * pyramid.getNumComponents());
+    pyramid.request(level, SbVec2i32(0, 0), size, 1.0f);
+    for (int i = 0; i < 5000; i++) {
+        if (pyramid.getRegion(level, SbVec2i32(0, 0), size, &bytes[0])) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return false;
+}
+
+static std::vector<unsigned char>
+read_file_bytes(const char * filename)
+{
+    std::vector<unsigned char> bytes;
+    FILE * fp = fopen(filename, "rb");
+    if (fp == NULL) return bytes;
+    unsigned char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0) bytes.insert(bytes.end(), buf, buf + n);
+    fclose(fp);
+    return bytes;
+}
+
+struct pyramid_row_reader {
+    const unsigned char * bytes;
+    size_t rowbytes;
+    int nextrow;
+    int failrow;
+    bool inorder;
+};
+
+static SbBool
+pyramid_read_row(void * closure, const int row, unsigned char * dst)
+{
+    pyramid_row_reader * reader = static_cast<pyramid_row_reader *>(closure);
+    if (row != reader->nextrow++) reader->inorder = false;
+    if (row == reader->failrow) return FALSE;
+    memcpy(dst, reader->bytes + reader->rowbytes * row, reader->rowbytes);
+    return TRUE;
+}
+
+// returns what the calling thread counted since start
+static SoRenderStatistics
+stats_since(const SoRenderStatistics & start)
+{
+    SoRenderStatistics now;
+    SoRenderStatistics::getThreadTotals(now);
+    now -= start;
+    return now;
+}
+
+// counts one draw call, and returns the triangles counted for it
+static uint64_t
+count_draw_triangles(const GLenum mode, const GLsizei numvertices)
+{
+    SoRenderStatistics start;
+    SoRenderStatistics::getThreadTotals(start);
+    SoRenderStatisticsP::countDraw(mode, numvertices);
+    const SoRenderStatistics diff = stats_since(start);
+    if (diff.getCount(SoRenderStatistics::DRAW_CALLS) != 1) return uint64_t(-1);
+    return diff.getCount(SoRenderStatistics::TRIANGLES);
+}
+
+int main()
+{
+    TestFixture fixture;
+    TestRunner runner;
+
+    const uint32_t oldcompression = SoVBO::getAttributeCompression();
+
+    // -----------------------------------------------------------------------
+    // SoGLVBOElement: public compression settings
+    // -----------------------------------------------------------------------
+    runner.startTest("SoGLVBOElement attribute compression setting");
+    {
+        SoGLVBOElement::setAttributeCompression(SoGLVBOElement::COMPRESS_NORMALS);
+        bool pass =
+            SoGLVBOElement::getAttributeCompression() == SoGLVBOElement::COMPRESS_NORMALS &&
+            SoVBO::getAttributeCompression() == SoVBO::COMPRESS_NORMALS;
+        // bits outside COMPRESS_ALL are ignored
+        SoGLVBOElement::setAttributeCompression(0xff);
+        pass = pass && SoGLVBOElement::getAttributeCompression() == SoGLVBOElement::COMPRESS_ALL;
+        runner.endTest(pass, pass ? "" :
+            "SoGLVBOElement compression flags should be forwarded to SoVBO");
+    }
+
+    // -----------------------------------------------------------------------
+    // Half float texture coordinates
+    // -----------------------------------------------------------------------
+    SoVBO::setAttributeCompression(SoVBO::COMPRESS_ALL);
+
+    runner.startTest("Half float conversion of exact values");
+    {
+        struct { float value; uint16_t half; } values[] = {
+            { 0.0f, 0x0000 },
+            { -0.0f, 0x8000 },
+            { 1.0f, 0x3c00 },
+            { 0.5f, 0x3800 },
+            { -2.0f, 0xc000 },
+            { 0.25f, 0x3400 },
+            { 65504.0f, 0x7bff },
+            { 6.103515625e-05f, 0x0400 }, // smallest normalized half
+        };
+        std::string message;
+        for (const auto & v : values) {
+            const uint16_t half = compress_texcoord(v.value);
+            if (half != v.half) {
+                char buf[128];
+                snprintf(buf, sizeof(buf), "%g gave 0x%04x, expected 0x%04x",
+                         v.value, half, v.half);
+                message = buf;
+                break;
+            }
+        }
+        runner.endTest(message.empty(), message);
+    }
+
+    runner.startTest("Half float conversion rounds to nearest");
+    {
+        // 1 + 2^-11 is halfway between two halves and rounds up, just
+        // below it rounds down
+        bool pass =
+            compress_texcoord(1.0f + std::ldexp(1.0f, -11)) == 0x3c01 &&
+            compress_texcoord(1.0f + std::ldexp(1.0f, -12)) == 0x3c00 &&
+            // rounding carries into the exponent
+            compress_texcoord(2.0f - std::ldexp(1.0f, -12)) == 0x4000;
+
+        // every value in [-4, 4] decodes to within half a unit in the last place
+        for (int i = -4000; i <= 4000 && pass; i++) {
+            const float value = i * 0.001f;
+            const float decoded = half_to_float(compress_texcoord(value));
+            const float ulp = std::ldexp(1.0f, std::ilogb(std::fabs(value)) - 10);
+            if (value != 0.0f && std::fabs(decoded - value) > ulp * 0.5f) pass = false;
+        }
+        runner.endTest(pass, pass ? "" :
+            "half float conversion should round to the nearest half");
+    }
+
+    runner.startTest("Half float conversion of tiny values");
+    {
+        // values too small for a normalized half are flushed to zero
+        bool pass =
+            compress_texcoord(1.0e-8f) == 0x0000 &&
+            compress_texcoord(-1.0e-8f) == 0x8000;
+        runner.endTest(pass, pass ? "" : "tiny values should be flushed to zero");
+    }
+
+    runner.startTest("Texture coordinates too large for half floats are not compressed");
+    {
+        SoVBO vbo;
+        const float coords[4] = { 0.0f, 0.0f, 70000.0f, 1.0f };
+        vbo.setTexCoordData(coords, 2, 2, 1);
+        const GLvoid * data;
+        intptr_t size;
+        vbo.getBufferData(data, size);
+        bool pass = vbo.getDataType() == GL_FLOAT && size == 4 * sizeof(float);
+        runner.endTest(pass, pass ? "" : "expected uncompressed float data");
+    }
+
+    runner.startTest("3D texture coordinates are padded to 8 bytes");
+    {
+        SoVBO vbo;
+        const float coords[6] = { 0.0f, 0.5f, 1.0f, 0.25f, 0.75f, -1.0f };
+        vbo.setTexCoordData(coords, 2, 3, 1);
+        const GLvoid * data;
+        intptr_t size;
+        vbo.getBufferData(data, size);
+        const uint16_t * halves = static_cast<const uint16_t *>(data);
+        bool pass = vbo.getDataType() == GL_HALF_FLOAT &&
+            vbo.getStride() == 8 && size == 16;
+        for (int i = 0; i < 2 && pass; i++) {
+            for (int j = 0; j < 3; j++) {
+                if (half_to_float(halves[i*4+j]) != coords[i*3+j]) pass = false;
+            }
+        }
+        runner.endTest(pass, pass ? "" : "3D coordinates should be stored as 4 halves");
+    }
+
+    // -----------------------------------------------------------------------
+    // Normal quantization
+    // -----------------------------------------------------------------------
+    runner.startTest("Normal quantization round trip");
+    {
+        const int num = 1000;
+        SbVec3f * normals = new SbVec3f[num];
+        for (int i = 0; i < num; i++) {
+            // spiral over the sphere
+            const float z = 1.0f - 2.0f * (i + 0.5f) / num;
+            const float r = std::sqrt(1.0f - z * z);
+            const float a = i * 2.39996323f;
+            normals[i].setValue(r * std::cos(a), r * std::sin(a), z);
+        }
+        // lengths other than one are normalized first
+        normals[0] *= 3.0f;
+        normals[1] *= 0.1f;
+
+        SoVBO vbo;
+        vbo.setNormalData(normals, num, 1);
+        const GLvoid * data;
+        intptr_t size;
+        vbo.getBufferData(data, size);
+        const int8_t * bytes = static_cast<const int8_t *>(data);
+
+        bool pass = vbo.getDataType() == GL_BYTE && vbo.getStride() == 4 &&
+            size == num * 4;
+        float maxerr = 0.0f;
+        for (int i = 0; i < num && pass; i++) {
+            SbVec3f n = normals[i];
+            n.normalize();
+            for (int j = 0; j < 3; j++) {
+                const float decoded = bytes[i*4+j] / 127.0f;
+                maxerr = std::max(maxerr, std::fabs(decoded - n[j]));
+            }
+            if (bytes[i*4+3] != 0) pass = false;
+        }
+        // the quantization step is 1/127
+        pass = pass && maxerr <= 0.5f / 127.0f + 1.0e-6f;
+        delete[] normals;
+        runner.endTest(pass, pass ? "" :
+            "decoded normals should be within half a quantization step");
+    }
+
+    // -----------------------------------------------------------------------
+    // Position quantization
+    // -----------------------------------------------------------------------
+    runner.startTest("Position quantization round trip");
+    {
+        const int num = 500;
+        SbVec3f * vertices = new SbVec3f[num];
+        for (int i = 0; i < num; i++) {
+            vertices[i].setValue(100.0f + std::sin(i * 0.1f) * 20.0f,
+                                 -50.0f + (i % 17) * 0.5f,
+                                 std::cos(i * 0.37f) * 2.0f);
+        }
+        SoVBO vbo;
+        vbo.setVertexData(vertices, num, 1);
+        const GLvoid * data;
+        intptr_t size;
+        vbo.getBufferData(data, size);
+        const int16_t * shorts = static_cast<const int16_t *>(data);
+
+        float scale, offset[3];
+        bool pass = vbo.getDecodeTransform(scale, offset) &&
+            vbo.getDataType() == GL_SHORT && vbo.getStride() == 8 &&
+            size == num * 8;
+        float maxerr = 0.0f;
+        for (int i = 0; i < num && pass; i++) {
+            for (int j = 0; j < 3; j++) {
+                const float decoded = offset[j] + scale * shorts[i*4+j];
+                maxerr = std::max(maxerr, std::fabs(decoded - vertices[i][j]));
+            }
+        }
+        // half a quantization step of the 40 unit wide bounding cube,
+        // with some room for float rounding
+        pass = pass && maxerr <= scale * 0.5f + 1.0e-4f;
+        delete[] vertices;
+        runner.endTest(pass, pass ? "" :
+            "decoded positions should be within half a quantization step");
+    }
+
+    runner.startTest("Positions are not compressed when disabled");
+    {
+        SoVBO::setAttributeCompression(SoVBO::COMPRESS_NORMALS);
+        const SbVec3f vertices[2] = { SbVec3f(0, 0, 0), SbVec3f(1, 2, 3) };
+        SoVBO vbo;
+        vbo.setVertexData(vertices, 2, 1);
+        float scale, offset[3];
+        bool pass = !vbo.getDecodeTransform(scale, offset) &&
+            vbo.getDataType() == GL_FLOAT && vbo.getStride() == 0;
+        SoVBO::setAttributeCompression(SoVBO::COMPRESS_ALL);
+        runner.endTest(pass, pass ? "" : "positions should be stored as floats");
+    }
+
+    // -----------------------------------------------------------------------
+    // Memory statistics
+    // -----------------------------------------------------------------------
+    runner.startTest("Memory statistics count compressed and uncompressed bytes");
+    {
+        size_t bytes0, uncompressed0;
+        SoGLVBOElement::getMemoryStatistics(bytes0, uncompressed0);
+
+        const int num = 64;
+        SbVec3f normals[num];
+        for (int i = 0; i < num; i++) normals[i].setValue(0.0f, 0.0f, 1.0f);
+
+        SoVBO * vbo = new SoVBO;
+        vbo->setNormalData(normals, num, 1);
+        size_t bytes1, uncompressed1;
+        SoGLVBOElement::getMemoryStatistics(bytes1, uncompressed1);
+        bool pass =
+            bytes1 - bytes0 == size_t(num * 4) &&
+            uncompressed1 - uncompressed0 == size_t(num * sizeof(SbVec3f));
+
+        // replacing the data replaces its statistics
+        SoVBO::setAttributeCompression(SoVBO::COMPRESS_NONE);
+        vbo->setNormalData(normals, num, 2);
+        SoGLVBOElement::getMemoryStatistics(bytes1, uncompressed1);
+        pass = pass &&
+            bytes1 - bytes0 == size_t(num * sizeof(SbVec3f)) &&
+            uncompressed1 - uncompressed0 == size_t(num * sizeof(SbVec3f));
+
+        delete vbo;
+        SoGLVBOElement::getMemoryStatistics(bytes1, uncompressed1);
+        pass = pass && bytes1 == bytes0 && uncompressed1 == uncompressed0;
+        runner.endTest(pass, pass ? "" :
+            "VBO memory statistics don't match the buffer data");
+    }
+
+    // -----------------------------------------------------------------------
+    // SoLODSelector: level-of-detail selection
+    // -----------------------------------------------------------------------
+    runner.startTest("SoLODSelector projected errors");
+    {
+        const int counts[4] = { 10000, 100, 0, 400 };
+        SoLODSelector::Record * rec = make_lod_record(counts, 4, 100.0f);
+        // the size of an average primitive, made nondecreasing; an
+        // empty level has the error of the whole box
+        bool pass = rec->errors.getLength() == 4 &&
+            std::fabs(rec->errors[0] - 1.0f) < 1.0e-5f &&
+            std::fabs(rec->errors[1] - 10.0f) < 1.0e-5f &&
+            rec->errors[2] == 100.0f &&
+            rec->errors[3] == 100.0f;
+        delete rec;
+        runner.endTest(pass, pass ? "" : "unexpected errors for the levels");
+    }
+
+    runner.startTest("SoLODSelector level for an error limit");
+    {
+        const int counts[3] = { 10000, 100, 1 };
+        SoLODSelector::Record * rec = make_lod_record(counts, 3, 100.0f);
+        SoLODSelector selector;
+        selector.setHysteresis(0.0f);
+        // the coarsest level with an error within the limit
+        bool pass =
+            selector.getLevel(rec, 0.0f) == 0 &&
+            selector.getLevel(rec, 9.9f) == 0 &&
+            selector.getLevel(rec, 10.0f) == 1 &&
+            selector.getLevel(rec, 99.0f) == 1 &&
+            selector.getLevel(rec, 1000.0f) == 2;
+        delete rec;
+        runner.endTest(pass, pass ? "" : "wrong level chosen for error limit");
+    }
+
+    runner.startTest("SoLODSelector hysteresis keeps the current level");
+    {
+        const int counts[3] = { 10000, 100, 1 };
+        SoLODSelector::Record * rec = make_lod_record(counts, 3, 100.0f);
+        SoLODSelector selector;
+        selector.setHysteresis(0.15f);
+        rec->level = 1;
+        bool pass =
+            // just below the switch to level 0 and to level 2
+            selector.getLevel(rec, 9.0f) == 1 &&
+            selector.getLevel(rec, 110.0f) == 1 &&
+            // outside the band
+            selector.getLevel(rec, 8.0f) == 0 &&
+            selector.getLevel(rec, 120.0f) == 2;
+        // clamped to [0, 0.9]
+        selector.setHysteresis(2.0f);
+        pass = pass && selector.getHysteresis() == 0.9f;
+        delete rec;
+        runner.endTest(pass, pass ? "" : "hysteresis band not applied");
+    }
+
+    runner.startTest("SoLODSelector primitive count is monotone in the limit");
+    {
+        SbList<SoLODSelector::Record *> records;
+        make_lod_scene(records, 50);
+        SoLODSelector selector;
+        bool pass = true;
+        for (int pass2 = 0; pass2 < 2 && pass; pass2++) {
+            int prev = selector.countTriangles(records, 0.0f);
+            for (float limit = 0.5f; limit < 500.0f && pass; limit *= 1.1f) {
+                const int count = selector.countTriangles(records, limit);
+                if (count > prev) pass = false;
+                prev = count;
+            }
+            // again with the levels of a previous selection, which the
+            // hysteresis depends on
+            selector.setTriangleBudget(sum_lod_level(records, 2));
+            selector.selectLevels(records, SbTime::zero());
+        }
+        delete_lod_scene(records);
+        runner.endTest(pass, pass ? "" : "primitive count increased with the error limit");
+    }
+
+    runner.startTest("SoLODSelector triangle budget");
+    {
+        SbList<SoLODSelector::Record *> records;
+        make_lod_scene(records, 50);
+        const int finest = sum_lod_level(records, 0);
+        const int coarsest = sum_lod_level(records, 3);
+        SoLODSelector selector;
+
+        // no budget: finest levels
+        int total = selector.selectLevels(records, SbTime::zero());
+        bool pass = total == finest;
+
+        // within the budget, and using most of it
+        const int budgets[3] = { finest / 2, finest / 5, finest / 20 };
+        for (int i = 0; i < 3 && pass; i++) {
+            selector.setTriangleBudget(budgets[i]);
+            total = selector.selectLevels(records, SbTime::zero());
+            if (total > budgets[i] || total < budgets[i] / 4) pass = false;
+            // the total matches the chosen levels
+            int sum = 0;
+            for (int j = 0; j < records.getLength(); j++) {
+                sum += records[j]->counts[records[j]->level];
+            }
+            if (sum != total) pass = false;
+        }
+
+        // too small for the coarsest levels: coarsest levels
+        selector.setTriangleBudget(coarsest / 2);
+        total = selector.selectLevels(records, SbTime::zero());
+        pass = pass && total == coarsest;
+        delete_lod_scene(records);
+        runner.endTest(pass, pass ? "" : "selection doesn't fit the triangle budget");
+    }
+
+    runner.startTest("SoLODSelector selection is stable");
+    {
+        SbList<SoLODSelector::Record *> records;
+        make_lod_scene(records, 50);
+        SoLODSelector selector;
+        selector.setTriangleBudget(sum_lod_level(records, 0) / 3);
+        selector.selectLevels(records, SbTime::zero());
+        SbList<int> levels;
+        for (int i = 0; i < records.getLength(); i++) levels.append(records[i]->level);
+        bool pass = true;
+        for (int frame = 0; frame < 10 && pass; frame++) {
+            selector.selectLevels(records, SbTime::zero());
+            for (int i = 0; i < records.getLength(); i++) {
+                if (records[i]->level != levels[i]) pass = false;
+            }
+        }
+        delete_lod_scene(records);
+        runner.endTest(pass, pass ? "" : "levels changed with an unchanged scene and budget");
+    }
+
+    runner.startTest("SoLODSelector frame time budget");
+    {
+        SbList<SoLODSelector::Record *> records;
+        make_lod_scene(records, 50);
+        const int finest = sum_lod_level(records, 0);
+        SoLODSelector selector;
+        selector.setFrameTimeBudget(SbTime(0.010));
+
+        // frames taking twice the target remove detail, down to the
+        // coarsest levels
+        int prev = selector.selectLevels(records, SbTime(0.020));
+        bool pass = prev < finest;
+        for (int frame = 0; frame < 30 && pass; frame++) {
+            const int total = selector.selectLevels(records, SbTime(0.020));
+            if (total > prev) pass = false;
+            prev = total;
+        }
+        pass = pass && prev == sum_lod_level(records, 3);
+
+        // frames faster than the target add it back, up to the finest
+        for (int frame = 0; frame < 30 && pass; frame++) {
+            const int total = selector.selectLevels(records, SbTime(0.002));
+            if (total < prev) pass = false;
+            prev = total;
+        }
+        pass = pass && prev == finest;
+
+        // the triangle budget still applies
+        selector.setTriangleBudget(finest / 4);
+        pass = pass && selector.selectLevels(records, SbTime(0.002)) <= finest / 4;
+        delete_lod_scene(records);
+        runner.endTest(pass, pass ? "" : "frame time budget not followed");
+    }
+
+    // -----------------------------------------------------------------------
+    // SoGLResourceManager: accounting and eviction. No objects are
+    // created, so these use context ids which are never used for a
+    // real context.
+    // -----------------------------------------------------------------------
+    typedef SoGLResourceManager RM;
+    typedef SoGLResourceManagerP RMP;
+    static const int owners[4] = { 0, 1, 2, 3 };
+
+    runner.startTest("SoGLResourceManager add and remove accounting");
+    {
+        const uint32_t ctx = 0xfff00001;
+        RMP::add(ctx, RM::BUFFER_OBJECT, &owners[0], 1000, 1);
+        RMP::add(ctx, RM::TEXTURE_OBJECT, &owners[1], 300, 2);
+        RMP::add(ctx, RM::DISPLAY_LIST, &owners[2], 0);
+        bool pass =
+            RM::getNumBytes(ctx, RM::BUFFER_OBJECT) == 1000 &&
+            RM::getNumBytes(ctx, RM::TEXTURE_OBJECT) == 300 &&
+            RM::getTotalNumBytes(ctx) == 1300 &&
+            RM::getNumResources(ctx, RM::BUFFER_OBJECT) == 1 &&
+            RM::getNumResources(ctx, RM::DISPLAY_LIST) == 1;
+
+        // adding again replaces the object of the owner
+        RMP::add(ctx, RM::BUFFER_OBJECT, &owners[0], 400, 3);
+        pass = pass &&
+            RM::getNumBytes(ctx, RM::BUFFER_OBJECT) == 400 &&
+            RM::getNumResources(ctx, RM::BUFFER_OBJECT) == 1;
+
+        pass = pass && RMP::remove(ctx, &owners[0]) && RMP::remove(ctx, &owners[1]) &&
+            RMP::remove(ctx, &owners[2]);
+        pass = pass &&
+            RM::getTotalNumBytes(ctx) == 0 &&
+            RM::getNumResources(ctx, RM::BUFFER_OBJECT) == 0 &&
+            RM::getNumResources(ctx, RM::TEXTURE_OBJECT) == 0 &&
+            RM::getNumResources(ctx, RM::DISPLAY_LIST) == 0;
+
+        // unknown owners and contexts
+        pass = pass && RMP::touch(ctx, &owners[3]) && RMP::remove(ctx, &owners[3]) &&
+            RMP::touch(0xfff000ff, &owners[3]) && RM::getTotalNumBytes(0xfff000ff) == 0;
+        runner.endTest(pass, pass ? "" : "wrong byte or object counts");
+    }
+
+    runner.startTest("SoGLResourceManager evicts least recently used objects");
+    {
+        const uint32_t ctx = 0xfff00002;
+        RM::setBudget(ctx, 250);
+        RMP::beginFrame(ctx);
+        RMP::add(ctx, RM::TEXTURE_OBJECT, &owners[0], 100, 10);
+        RMP::add(ctx, RM::BUFFER_OBJECT, &owners[1], 100, 11);
+        RMP::add(ctx, RM::TEXTURE_OBJECT, &owners[2], 100, 12);
+        RMP::add(ctx, RM::DISPLAY_LIST, &owners[3], 0);
+
+        // objects used in the current frame are kept
+        SbList<GLuint> buffers, textures;
+        RMP::evict(ctx, buffers, textures);
+        bool pass = buffers.getLength() == 0 && textures.getLength() == 0 &&
+            RM::getTotalNumBytes(ctx) == 300;
+
+        // owners[0] is used again, so owners[1] is the oldest
+        RMP::beginFrame(ctx);
+        pass = pass && RMP::touch(ctx, &owners[0]);
+        RMP::beginFrame(ctx);
+        RMP::evict(ctx, buffers, textures);
+        pass = pass &&
+            buffers.getLength() == 1 && buffers[0] == 11 &&
+            textures.getLength() == 0 &&
+            RM::getTotalNumBytes(ctx) == 200 &&
+            RM::getNumResources(ctx, RM::BUFFER_OBJECT) == 0 &&
+            RM::getNumEvictions(ctx) == 1;
+
+        // the owner of an evicted object must not delete it
+        pass = pass && !RMP::touch(ctx, &owners[1]) && !RMP::remove(ctx, &owners[1]);
+
+        // down to a budget below a single object, display lists stay
+        RM::setBudget(ctx, 50);
+        buffers.truncate(0);
+        RMP::evict(ctx, buffers, textures);
+        pass = pass &&
+            textures.getLength() == 2 && textures[0] == 12 && textures[1] == 10 &&
+            RM::getTotalNumBytes(ctx) == 0 &&
+            RM::getNumResources(ctx, RM::DISPLAY_LIST) == 1 &&
+            RM::getNumEvictions(ctx) == 3;
+
+        // an evicted object can be created again
+        RMP::add(ctx, RM::TEXTURE_OBJECT, &owners[0], 100, 13);
+        pass = pass && RMP::touch(ctx, &owners[0]) &&
+            RM::getNumBytes(ctx, RM::TEXTURE_OBJECT) == 100;
+
+        RMP::remove(ctx, &owners[0]);
+        RMP::remove(ctx, &owners[2]);
+        RMP::remove(ctx, &owners[3]);
+        runner.endTest(pass, pass ? "" : "wrong objects evicted");
+    }
+
+    runner.startTest("SoGLResourceManager pinned objects");
+    {
+        const uint32_t ctx = 0xfff00003;
+        RM::setBudget(ctx, 1);
+        RMP::beginFrame(ctx);
+        RMP::add(ctx, RM::TEXTURE_OBJECT, &owners[0], 100, 20);
+        // pinned by two render caches
+        RMP::pin(ctx, &owners[0]);
+        RMP::pin(ctx, &owners[0]);
+        RMP::beginFrame(ctx);
+
+        SbList<GLuint> buffers, textures;
+        RMP::evict(ctx, buffers, textures);
+        bool pass = textures.getLength() == 0;
+        RMP::unpin(ctx, &owners[0]);
+        RMP::evict(ctx, buffers, textures);
+        pass = pass && textures.getLength() == 0;
+        // released by both caches
+        RMP::unpin(ctx, &owners[0]);
+        RMP::evict(ctx, buffers, textures);
+        pass = pass && textures.getLength() == 1 && textures[0] == 20 &&
+            RM::getTotalNumBytes(ctx) == 0;
+        // unpinning more than pinned is harmless
+        RMP::unpin(ctx, &owners[0]);
+        RMP::remove(ctx, &owners[0]);
+        runner.endTest(pass, pass ? "" : "pins not counted");
+    }
+
+    // -----------------------------------------------------------------------
+    // SoTilePyramid: writing and reading pyramid files
+    // -----------------------------------------------------------------------
+    const char * pyramidfile = "test_rendering_suite_pyramid.tmp";
+    const char * streamedfile = "test_rendering_suite_streamed.tmp";
+
+    runner.startTest("SoTilePyramid write and read back");
+    {
+        const SbVec2i32 size(300, 200);
+        const std::vector<unsigned char> image = make_pyramid_image(size, 3);
+        bool pass = SoTilePyramid::writeFile(pyramidfile, &image[0], size, 3, 64) &&
+            SoTilePyramid::isPyramidFile(pyramidfile);
+        SoTilePyramid pyramid;
+        pass = pass && pyramid.open(pyramidfile);
+        // 300x200, 150x100, 75x50, 37x25
+        pass = pass && pyramid.getSize() == size && pyramid.getNumComponents() == 3 &&
+            pyramid.getTileSize() == 64 && pyramid.getNumLevels() == 4 &&
+            pyramid.getLevelSize(3) == SbVec2i32(37, 25);
+
+        std::vector<unsigned char> level0;
+        pass = pass && read_pyramid_level(pyramid, 0, level0) && level0 == image;
+
+        // pixels outside the image repeat the edge
+        unsigned char corner[2 * 2 * 3];
+        pass = pass && pyramid.getRegion(0, SbVec2i32(299, 199), SbVec2i32(2, 2), corner);
+        const unsigned char * last = &image[image.size() - 3];
+        for (int i = 0; pass && i < 4; i++) pass = memcmp(corner + i * 3, last, 3) == 0;
+        runner.endTest(pass, pass ? "" : "pyramid file doesn't match the image");
+    }
+
+    runner.startTest("SoTilePyramid downsampled levels");
+    {
+        // odd sizes, and a single row at the coarsest levels: 129x7,
+        // 64x3, 32x1, 16x1
+        const SbVec2i32 size(129, 7);
+        std::vector<unsigned char> expected = make_pyramid_image(size, 2);
+        bool pass = SoTilePyramid::writeFile(pyramidfile, &expected[0], size, 2, 16);
+        SoTilePyramid pyramid;
+        pass = pass && pyramid.open(pyramidfile) && pyramid.getNumLevels() == 4;
+
+        // the last level is read with the file
+        SbVec2i32 levelsize = size;
+        for (int l = 1; pass && l < pyramid.getNumLevels(); l++) {
+            const SbVec2i32 prevsize = levelsize;
+            expected = halve_pyramid_image(expected, prevsize, 2, levelsize);
+            std::vector<unsigned char> level;
+            pass = pyramid.getLevelSize(l) == levelsize &&
+                read_pyramid_level(pyramid, l, level) && level == expected;
+        }
+        pass = pass && levelsize == SbVec2i32(16, 1);
+        runner.endTest(pass, pass ? "" : "wrong downsampled level");
+    }
+
+    runner.startTest("SoTilePyramid row by row writer");
+    {
+        const SbVec2i32 size(300, 200);
+        const std::vector<unsigned char> image = make_pyramid_image(size, 4);
+        pyramid_row_reader reader = { &image[0], size_t(size[0]) * 4, 0, -1, true };
+        bool pass =
+            SoTilePyramid::writeFile(pyramidfile, &image[0], size, 4, 32) &&
+            SoTilePyramid::writeFile(streamedfile, size, 4, 32, pyramid_read_row, &reader);
+        // rows are read once, bottom first
+        pass = pass && reader.inorder && reader.nextrow == size[1];
+        const std::vector<unsigned char> a = read_file_bytes(pyramidfile);
+        const std::vector<unsigned char> b = read_file_bytes(streamedfile);
+        pass = pass && !a.empty() && a == b;
+
+        // a failing reader fails the write
+        reader.nextrow = 0;
+        reader.failrow = 100;
+        pass = pass &&
+            !SoTilePyramid::writeFile(streamedfile, size, 4, 32, pyramid_read_row, &reader);
+        runner.endTest(pass, pass ? "" : "row by row writer differs from the image writer");
+    }
+
+    runner.startTest("SoTilePyramid rejects other files");
+    {
+        FILE * fp = fopen(pyramidfile, "wb");
+        const char text[] = "not a pyramid file";
+        bool pass = fp != NULL && fwrite(text, 1, sizeof(text), fp) == sizeof(text);
+        if (fp) fclose(fp);
+        SoTilePyramid pyramid;
+        pass = pass && !SoTilePyramid::isPyramidFile(pyramidfile) &&
+            !pyramid.open(pyramidfile) &&
+            !SoTilePyramid::isPyramidFile("no_such_file.tmp");
+        // tile sizes must be powers of two
+        const std::vector<unsigned char> image = make_pyramid_image(SbVec2i32(4, 4), 1);
+        pass = pass && !SoTilePyramid::writeFile(streamedfile, &image[0], SbVec2i32(4, 4), 1, 3);
+        runner.endTest(pass, pass ? "" : "invalid pyramid accepted");
+    }
+    remove(pyramidfile);
+    remove(streamedfile);
+
+    // -----------------------------------------------------------------------
+    // SoRenderStatistics: counters
+    // -----------------------------------------------------------------------
+    typedef SoRenderStatistics RS;
+
+    runner.startTest("SoRenderStatistics triangles per primitive mode");
+    {
+        bool pass =
+            count_draw_triangles(GL_TRIANGLES, 9) == 3 &&
+            count_draw_triangles(GL_TRIANGLES, 10) == 3 &&
+            count_draw_triangles(GL_TRIANGLE_STRIP, 6) == 4 &&
+            count_draw_triangles(GL_TRIANGLE_FAN, 5) == 3 &&
+            count_draw_triangles(GL_QUADS, 8) == 4 &&
+            count_draw_triangles(GL_QUADS, 7) == 2 &&
+            count_draw_triangles(GL_QUAD_STRIP, 6) == 4 &&
+            count_draw_triangles(GL_POLYGON, 5) == 3 &&
+            // too few vertices, and primitives without triangles,
+            // still count as draw calls
+            count_draw_triangles(GL_TRIANGLE_STRIP, 2) == 0 &&
+            count_draw_triangles(GL_LINES, 10) == 0 &&
+            count_draw_triangles(GL_POINTS, 10) == 0;
+        runner.endTest(pass, pass ? "" : "wrong triangle count for a primitive mode");
+    }
+
+    runner.startTest("SoRenderStatistics recording and replay");
+    {
+        SoRenderStatistics start;
+        RS::getThreadTotals(start);
+
+        // what is counted while a display list is compiled
+        SoRenderStatistics recorded;
+        SoRenderStatisticsP::beginRecording(recorded);
+        SoRenderStatisticsP::countDraw(GL_TRIANGLES, 30);
+        SoRenderStatisticsP::countDraw(GL_TRIANGLE_STRIP, 12);
+        SoRenderStatisticsP::count(RS::TEXTURE_BINDS, 2);
+        SoRenderStatisticsP::count(RS::BUFFER_BINDS, 3);
+        SoRenderStatisticsP::count(RS::LAZY_ELEMENT_SENDS);
+        SoRenderStatisticsP::count(RS::RENDER_CACHES_CREATED);
+        SoRenderStatisticsP::endRecording(recorded);
+        bool pass =
+            recorded.getCount(RS::DRAW_CALLS) == 2 &&
+            recorded.getCount(RS::TRIANGLES) == 20 &&
+            recorded.getCount(RS::TEXTURE_BINDS) == 2 &&
+            recorded.getCount(RS::BUFFER_BINDS) == 3 &&
+            recorded.getCount(RS::LAZY_ELEMENT_SENDS) == 1 &&
+            recorded.getCount(RS::RENDER_CACHES_CREATED) == 1;
+
+        // calling the list only repeats the OpenGL work stored in it
+        SoRenderStatistics before;
+        RS::getThreadTotals(before);
+        SoRenderStatisticsP::replay(recorded);
+        SoRenderStatisticsP::replay(recorded);
+        const SoRenderStatistics replayed = stats_since(before);
+        pass = pass &&
+            replayed.getCount(RS::DRAW_CALLS) == 4 &&
+            replayed.getCount(RS::TRIANGLES) == 40 &&
+            replayed.getCount(RS::TEXTURE_BINDS) == 4;
+        for (int i = 0; i < RS::NUM_COUNTERS; i++) {
+            const RS::Counter c = RS::Counter(i);
+            if (c == RS::DRAW_CALLS || c == RS::TRIANGLES || c == RS::TEXTURE_BINDS) continue;
+            pass = pass && replayed.getCount(c) == 0;
+        }
+
+        // the thread totals include everything
+        const SoRenderStatistics total = stats_since(start);
+        pass = pass &&
+            total.getCount(RS::DRAW_CALLS) == 6 &&
+            total.getCount(RS::BUFFER_BINDS) == 3;
+        runner.endTest(pass, pass ? "" : "recorded or replayed counts are wrong");
+    }
+
+    runner.startTest("SoRenderStatistics arithmetic and names");
+    {
+        SoRenderStatistics start;
+        RS::getThreadTotals(start);
+        SoRenderStatisticsP::count(RS::DRAW_CALLS, 5);
+        SoRenderStatisticsP::count(RS::RENDER_CACHE_HITS, 7);
+        const SoRenderStatistics a = stats_since(start);
+
+        SoRenderStatistics sum;
+        bool pass = sum.getCount(RS::DRAW_CALLS) == 0;
+        sum += a;
+        sum += a;
+        pass = pass &&
+            sum.getCount(RS::DRAW_CALLS) == 10 &&
+            sum.getCount(RS::RENDER_CACHE_HITS) == 14 &&
+            sum.getCount(RS::TRIANGLES) == 0;
+        sum -= a;
+        pass = pass &&
+            sum.getCount(RS::DRAW_CALLS) == 5 &&
+            sum.getCount(RS::RENDER_CACHE_HITS) == 7;
+        sum.reset();
+        pass = pass && sum.getCount(RS::RENDER_CACHE_HITS) == 0;
+
+        static const char * const names[RS::NUM_COUNTERS] = {
+            "DRAW_CALLS", "TRIANGLES", "LAZY_ELEMENT_SENDS", "TEXTURE_BINDS",
+            "BUFFER_BINDS", "DISPLAY_LIST_CALLS", "RENDER_CACHE_HITS",
+            "RENDER_CACHE_MISSES", "RENDER_CACHES_CREATED"
+        };
+        for (int i = 0; i < RS::NUM_COUNTERS; i++) {
+            const char * name = RS::getCounterName(RS::Counter(i));
+            pass = pass && name && strcmp(name, names[i]) == 0;
+        }
+        runner.endTest(pass, pass ? "" : "wrong sums, differences or counter names");
+    }
+
+    runner.startTest("SoRenderStatistics totals are per thread");
+    {
+        SoRenderStatistics start;
+        RS::getThreadTotals(start);
+        std::thread other([] {
+            SoRenderStatisticsP::countDraw(GL_TRIANGLES, 300);
+        });
+        other.join();
+        const bool pass = stats_since(start).getCount(RS::TRIANGLES) == 0;
+        runner.endTest(pass, pass ? "" : "another thread's work was counted");
+    }
+
+    SoVBO::setAttributeCompression(oldcompression);
+
+    return runner.getSummary();
+}
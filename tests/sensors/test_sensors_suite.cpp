@@ -43,6 +43,8 @@
  *   SoTimerSensor  - class type, schedule/unschedule
  *   SoAlarmSensor  - class type, schedule/unschedule
  *   SoOneShotSensor - class type
+ *
+ * Also covers notification batching through SoDB::NotifyBatch.
  */
 
 #include "../test_utils.h"
@@ -53,6 +55,10 @@
 #include <Inventor/sensors/SoAlarmSensor.h>
 #include <Inventor/sensors/SoOneShotSensor.h>
 #include <Inventor/nodes/SoCube.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoTranslation.h>
+#include <Inventor/actions/SoGetBoundingBoxAction.h>
+#include <Inventor/SbViewportRegion.h>
 #include <Inventor/SoDB.h>
 using namespace SimpleTest;
 
@@ -62,6 +68,9 @@ static void onFieldChange(void*, SoSensor*) { ++s_fieldFired; }
 static int s_nodeFired = 0;
 static void onNodeChange(void*, SoSensor*) { ++s_nodeFired; }
 
+static int s_immediateFired = 0;
+static void onImmediate(void*, SoSensor*) { ++s_immediateFired; }
+
 static int s_timerFired = 0;
 static void onTimer(void*, SoSensor*) { ++s_timerFired; }
 
@@ -177,5 +186,82 @@ int main()
             "SoOneShotSensor schedule/unschedule failed");
     }
 
+    // -----------------------------------------------------------------------
+    // Notification batching
+    // -----------------------------------------------------------------------
+    runner.startTest("SoDB::NotifyBatch notifies each ancestor once");
+    {
+        // root -> group -> 10 translations, watched by an immediate
+        // (priority 0) sensor that fires for every notification
+        SoSeparator* root = new SoSeparator;
+        root->ref();
+        SoSeparator* group = new SoSeparator;
+        root->addChild(group);
+        SoTranslation* translations[10];
+        for (int i = 0; i < 10; i++) {
+            translations[i] = new SoTranslation;
+            group->addChild(translations[i]);
+        }
+        SoNodeSensor sensor(onImmediate, nullptr);
+        sensor.setPriority(0);
+        sensor.attach(root);
+
+        s_immediateFired = 0;
+        for (int i = 0; i < 10; i++) {
+            translations[i]->translation.setValue(float(i), 0.0f, 0.0f);
+        }
+        bool pass = (s_immediateFired == 10);
+
+        s_immediateFired = 0;
+        {
+            SoDB::NotifyBatch batch;
+            pass = pass && SoDB::isNotifyBatching();
+            for (int i = 0; i < 10; i++) {
+                translations[i]->translation.setValue(float(i), 1.0f, 0.0f);
+                translations[i]->translation.setValue(float(i), 2.0f, 0.0f);
+            }
+            pass = pass && (s_immediateFired == 0);
+        }
+        pass = pass && !SoDB::isNotifyBatching() && (s_immediateFired == 1);
+
+        sensor.detach();
+        root->unref();
+        runner.endTest(pass, pass ? "" :
+            "batched notification did not reach the root exactly once");
+    }
+
+    runner.startTest("SoDB::NotifyBatch invalidates caches and handles deletes");
+    {
+        SoSeparator* root = new SoSeparator;
+        root->ref();
+        SoSeparator* group = new SoSeparator;
+        root->addChild(group);
+        SoTranslation* translation = new SoTranslation;
+        group->addChild(translation);
+        group->addChild(new SoCube);
+        SoTranslation* removed = new SoTranslation;
+        root->addChild(removed);
+
+        SbViewportRegion vp(100, 100);
+        SoGetBoundingBoxAction bba(vp);
+        bba.apply(root);
+        bool pass = (bba.getBoundingBox().getCenter() == SbVec3f(0, 0, 0));
+
+        SoDB::startNotifyBatch();
+        SoDB::startNotifyBatch(); // nested
+        translation->translation.setValue(5.0f, 0.0f, 0.0f);
+        removed->translation.setValue(1.0f, 0.0f, 0.0f);
+        SoDB::endNotifyBatch();
+        pass = pass && SoDB::isNotifyBatching();
+        root->removeChild(removed); // destroys a node with pending notification
+        SoDB::endNotifyBatch();
+
+        bba.apply(root);
+        pass = pass && (bba.getBoundingBox().getCenter() == SbVec3f(5, 0, 0));
+        root->unref();
+        runner.endTest(pass, pass ? "" :
+            "bounding box cache was not invalidated by batched notification");
+    }
+
     return runner.getSummary();
 }
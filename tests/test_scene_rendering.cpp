@@ -40,9 +40,11 @@
  */
 
 #include "test_utils.h"
+#include <algorithm>
 #include <memory>
 #include <fstream>
 #include <iomanip>
+#include <cstdlib>
 #include <iostream>
 #include <set>
 #include <tuple>
@@ -60,6 +62,9 @@
 #include <Inventor/SoDB.h>
 #include <Inventor/SoInteraction.h>
 #include <Inventor/SoOffscreenRenderer.h>
+#include <Inventor/SoRenderManager.h>
+#include <Inventor/SoParallelRenderer.h>
+#include <Inventor/actions/SoGLRenderAction.h>
 #include <Inventor/nodes/SoSeparator.h>
 #include <Inventor/nodes/SoCube.h>
 #include <Inventor/nodes/SoSphere.h>
@@ -73,7 +78,26 @@
 #include <Inventor/nodes/SoTransform.h>
 #include <Inventor/nodes/SoTranslation.h>
 #include <Inventor/nodes/SoRotation.h>
+#include <Inventor/nodes/SoCoordinate3.h>
+#include <Inventor/nodes/SoIndexedFaceSet.h>
+#include <Inventor/nodes/SoLightModel.h>
+#include <Inventor/nodes/SoMaterialBinding.h>
+#include <Inventor/nodes/SoComplexity.h>
+#include <Inventor/nodes/SoNormal.h>
+#include <Inventor/nodes/SoNormalBinding.h>
+#include <Inventor/nodes/SoShaderProgram.h>
+#include <Inventor/nodes/SoVertexShader.h>
+#include <Inventor/nodes/SoFragmentShader.h>
+#include <Inventor/nodes/SoTexture2.h>
+#include <Inventor/nodes/SoTextureCoordinatePlane.h>
+#include <Inventor/elements/SoGLVBOElement.h>
+#include <Inventor/nodes/SoBVHSeparator.h>
+#include <Inventor/nodes/SoSubNode.h>
+#include <Inventor/actions/SoGetBoundingBoxAction.h>
+#include <Inventor/misc/SoRenderStatistics.h>
 #include <Inventor/SbViewportRegion.h>
+
+#include "rendering/SoUnitShapeCache.h"
 #include "test_utils.h"
 
 namespace SimpleTest {
@@ -143,19 +167,36 @@ public:
     }
     
     virtual SbBool makeContextCurrent(void* context) override {
-        return context && static_cast<OSMesaContextData*>(context)->makeCurrent() ? TRUE : FALSE;
+        if (!context || !static_cast<OSMesaContextData*>(context)->makeCurrent()) return FALSE;
+        current_contexts.push_back(static_cast<OSMesaContextData*>(context));
+        return TRUE;
     }
     
     virtual void restorePreviousContext(void* context) override {
-        // OSMesa doesn't need context stacking for single-threaded use
+        // Release the context when done with it, so that SoParallelRenderer
+        // can make it current in another thread the next time
         (void)context;
+        if (!current_contexts.empty()) current_contexts.pop_back();
+        if (!current_contexts.empty()) current_contexts.back()->makeCurrent();
+        else OSMesaMakeCurrent(NULL, NULL, 0, 0, 0);
     }
     
     virtual void destroyContext(void* context) override {
+        // contexts are not always made current in pairs with
+        // restorePreviousContext(), so forget the context here
+        current_contexts.erase(std::remove(current_contexts.begin(), current_contexts.end(),
+                                           static_cast<OSMesaContextData*>(context)),
+                               current_contexts.end());
         delete static_cast<OSMesaContextData*>(context);
     }
+
+private:
+    // the contexts made current in each thread, most recent last
+    static thread_local std::vector<OSMesaContextData*> current_contexts;
 };
 
+thread_local std::vector<OSMesaContextData*> OSMesaContextManager::current_contexts;
+
 // Helper function to create a comprehensive 3D scene
 SoSeparator* createComplexScene() {
     SoSeparator* root = new SoSeparator;
@@ -257,6 +298,502 @@ SoSeparator* createComplexScene() {
     return root;
 }
 
+// Helper function to create a strip of quads with alternating red and
+// green per-face colors. Per-face bindings can't be rendered from the
+// coordIndex indices, so after a couple of frames the face set is
+// rendered from the primitive vertex cache instead of immediate mode.
+SoSeparator* createPerFaceFaceSet(int numquads) {
+    SoSeparator* root = new SoSeparator;
+    root->ref();
+
+    SoOrthographicCamera* camera = new SoOrthographicCamera;
+    camera->position = SbVec3f(0, 0, 5);
+    camera->height = 2.0f;
+    root->addChild(camera);
+
+    SoLightModel* lightmodel = new SoLightModel;
+    lightmodel->model = SoLightModel::BASE_COLOR;
+    root->addChild(lightmodel);
+
+    SoMaterial* material = new SoMaterial;
+    material->diffuseColor.set1Value(0, SbColor(1.0f, 0.0f, 0.0f));
+    material->diffuseColor.set1Value(1, SbColor(0.0f, 1.0f, 0.0f));
+    root->addChild(material);
+
+    SoMaterialBinding* binding = new SoMaterialBinding;
+    binding->value = SoMaterialBinding::PER_FACE_INDEXED;
+    root->addChild(binding);
+
+    SoCoordinate3* coords = new SoCoordinate3;
+    SoIndexedFaceSet* faceset = new SoIndexedFaceSet;
+    const float width = 2.0f / numquads;
+    for (int i = 0; i <= numquads; i++) {
+        const float x = -1.0f + i * width;
+        coords->point.set1Value(2 * i, SbVec3f(x, -1.0f, 0.0f));
+        coords->point.set1Value(2 * i + 1, SbVec3f(x, 1.0f, 0.0f));
+    }
+    for (int i = 0; i < numquads; i++) {
+        const int32_t quad[] = { 2 * i, 2 * i + 2, 2 * i + 3, 2 * i + 1, -1 };
+        faceset->coordIndex.setValues(5 * i, 5, quad);
+        faceset->materialIndex.set1Value(i, i % 2);
+    }
+    root->addChild(coords);
+    root->addChild(faceset);
+
+    return root;
+}
+
+// Helper function to create an n x n grid of quads with a checkerboard
+// computed from the object space positions, either through texture
+// coordinate generation or in a shader program
+SoSeparator* createObjectSpaceGrid(int n, bool useshader) {
+    SoSeparator* root = new SoSeparator;
+    root->ref();
+    root->renderCaching = SoSeparator::OFF;
+
+    SoOrthographicCamera* camera = new SoOrthographicCamera;
+    camera->position = SbVec3f(0, 0, 5);
+    camera->height = 2.0f;
+    root->addChild(camera);
+
+    SoLightModel* lightmodel = new SoLightModel;
+    lightmodel->model = SoLightModel::BASE_COLOR;
+    root->addChild(lightmodel);
+
+    if (useshader) {
+        SoVertexShader* vertexshader = new SoVertexShader;
+        vertexshader->sourceType = SoShaderObject::GLSL_PROGRAM;
+        vertexshader->sourceProgram =
+            "varying vec2 st;\n"
+            "void main() {\n"
+            "  st = gl_Vertex.xy * 2.0;\n"
+            "  gl_Position = ftransform();\n"
+            "}\n";
+        SoFragmentShader* fragmentshader = new SoFragmentShader;
+        fragmentshader->sourceType = SoShaderObject::GLSL_PROGRAM;
+        fragmentshader->sourceProgram =
+            "varying vec2 st;\n"
+            "void main() {\n"
+            "  float c = mod(floor(st.x * 2.0) + floor(st.y * 2.0), 2.0);\n"
+            "  gl_FragColor = vec4(c, c, c, 1.0);\n"
+            "}\n";
+        SoShaderProgram* program = new SoShaderProgram;
+        program->shaderObject.set1Value(0, vertexshader);
+        program->shaderObject.set1Value(1, fragmentshader);
+        root->addChild(program);
+    }
+    else {
+        SoComplexity* complexity = new SoComplexity;
+        complexity->textureQuality = 0.1f;
+        root->addChild(complexity);
+
+        SoTexture2* texture = new SoTexture2;
+        const unsigned char checker[] = { 255, 0, 0, 255 };
+        texture->image.setValue(SbVec2s(2, 2), 1, checker);
+        root->addChild(texture);
+
+        SoTextureCoordinatePlane* texgen = new SoTextureCoordinatePlane;
+        texgen->directionS = SbVec3f(2.0f, 0.0f, 0.0f);
+        texgen->directionT = SbVec3f(0.0f, 2.0f, 0.0f);
+        root->addChild(texgen);
+    }
+
+    // texture coordinate generation needs normals, which must not come
+    // from the normal cache for the grid to render with vertex arrays
+    SoNormal* normal = new SoNormal;
+    normal->vector.setValue(SbVec3f(0.0f, 0.0f, 1.0f));
+    root->addChild(normal);
+    SoNormalBinding* normalbinding = new SoNormalBinding;
+    normalbinding->value = SoNormalBinding::OVERALL;
+    root->addChild(normalbinding);
+
+    SoCoordinate3* coords = new SoCoordinate3;
+    SoIndexedFaceSet* faceset = new SoIndexedFaceSet;
+    const float width = 2.0f / n;
+    for (int j = 0; j <= n; j++) {
+        for (int i = 0; i <= n; i++) {
+            coords->point.set1Value(j * (n + 1) + i,
+                                    SbVec3f(-1.0f + i * width, -1.0f + j * width, 0.0f));
+        }
+    }
+    for (int j = 0; j < n; j++) {
+        for (int i = 0; i < n; i++) {
+            const int32_t v = j * (n + 1) + i;
+            const int32_t quad[] = { v, v + 1, v + n + 2, v + n + 1, -1 };
+            faceset->coordIndex.setValues(5 * (j * n + i), 5, quad);
+        }
+    }
+    root->addChild(coords);
+    root->addChild(faceset);
+
+    return root;
+}
+
+// Renders the object space grid with the given VBO attribute
+// compression. Returns false if rendering failed, or if compression
+// was asked for and no compressed VBO was created.
+bool renderObjectSpaceGrid(bool useshader, uint32_t compression, int size,
+                           std::vector<unsigned char>& image) {
+    SoGLVBOElement::setAttributeCompression(compression);
+    SoSeparator* grid = createObjectSpaceGrid(8, useshader);
+    SbViewportRegion viewport(size, size);
+    SoOffscreenRenderer renderer(viewport);
+    renderer.setBackgroundColor(SbColor(0.0f, 0.0f, 0.0f));
+    bool ok = renderer.render(grid);
+    if (ok) {
+        const unsigned char* buffer = renderer.getBuffer();
+        image.assign(buffer, buffer + size * size * 3);
+    }
+    // the grid's VBOs are alive until it is unref'ed
+    size_t numbytes, numuncompressedbytes;
+    SoGLVBOElement::getMemoryStatistics(numbytes, numuncompressedbytes);
+    if (compression != SoGLVBOElement::COMPRESS_NONE && numbytes >= numuncompressedbytes) {
+        ok = false;
+    }
+    grid->unref();
+    return ok;
+}
+
+// Helper function to create a grid of separate cubes, which progressive
+// rendering splits into one unit per cube
+SoSeparator* createCubeGrid(int n) {
+    SoSeparator* root = new SoSeparator;
+    root->ref();
+
+    SoOrthographicCamera* camera = new SoOrthographicCamera;
+    camera->position = SbVec3f(0, 0, 10);
+    camera->height = 2.0f * n;
+    root->addChild(camera);
+
+    SoLightModel* lightmodel = new SoLightModel;
+    lightmodel->model = SoLightModel::BASE_COLOR;
+    root->addChild(lightmodel);
+
+    for (int i = 0; i < n * n; i++) {
+        SoSeparator* sep = new SoSeparator;
+        SoTranslation* translation = new SoTranslation;
+        translation->translation = SbVec3f(2.0f * (i % n) - n + 1, 2.0f * (i / n) - n + 1, 0.0f);
+        sep->addChild(translation);
+        SoMaterial* material = new SoMaterial;
+        material->diffuseColor = SbColor((i % 3) * 0.5f, ((i / 3) % 3) * 0.5f, 1.0f);
+        sep->addChild(material);
+        sep->addChild(new SoCube);
+        root->addChild(sep);
+    }
+    return root;
+}
+
+// Creates a scene with two instances of a basic shape, tilted in
+// opposite directions so that both caps are visible. Each case uses a
+// different shape, parts, material binding and non-uniform size.
+const int NUM_UNIT_SHAPE_CASES = 8;
+
+SoSeparator* createUnitShapeScene(int shapecase) {
+    SoSeparator* root = new SoSeparator;
+    root->ref();
+
+    SoOrthographicCamera* camera = new SoOrthographicCamera;
+    camera->position = SbVec3f(0, 0, 10);
+    camera->height = 5.0f;
+    root->addChild(camera);
+    root->addChild(new SoDirectionalLight);
+
+    SoComplexity* complexity = new SoComplexity;
+    complexity->value = 0.3f;
+    root->addChild(complexity);
+
+    SoMaterial* material = new SoMaterial;
+    const SbColor colors[6] = {
+        SbColor(1, 0, 0), SbColor(0, 1, 0), SbColor(0, 0, 1),
+        SbColor(1, 1, 0), SbColor(0, 1, 1), SbColor(1, 0, 1)
+    };
+    material->diffuseColor.setValues(0, 6, colors);
+    root->addChild(material);
+    SoMaterialBinding* binding = new SoMaterialBinding;
+    root->addChild(binding);
+
+    SoNode* shape = nullptr;
+    switch (shapecase) {
+    case 0: {
+        SoCone* cone = new SoCone;
+        cone->parts = SoCone::SIDES;
+        cone->bottomRadius = 0.5f;
+        cone->height = 1.5f;
+        shape = cone;
+        break;
+    }
+    case 1: {
+        SoCone* cone = new SoCone;
+        cone->bottomRadius = 0.9f;
+        cone->height = 0.7f;
+        binding->value = SoMaterialBinding::PER_PART;
+        shape = cone;
+        break;
+    }
+    case 2: {
+        SoCylinder* cylinder = new SoCylinder;
+        cylinder->parts.setValue(SoCylinder::TOP | SoCylinder::BOTTOM);
+        cylinder->radius = 0.8f;
+        cylinder->height = 0.4f;
+        binding->value = SoMaterialBinding::PER_PART;
+        shape = cylinder;
+        break;
+    }
+    case 3: {
+        SoCylinder* cylinder = new SoCylinder;
+        cylinder->radius = 0.4f;
+        cylinder->height = 1.6f;
+        binding->value = SoMaterialBinding::PER_PART_INDEXED;
+        shape = cylinder;
+        break;
+    }
+    case 4: {
+        SoCylinder* cylinder = new SoCylinder;
+        cylinder->parts.setValue(SoCylinder::SIDES | SoCylinder::BOTTOM);
+        cylinder->radius = 0.6f;
+        cylinder->height = 1.0f;
+        binding->value = SoMaterialBinding::PER_PART;
+        shape = cylinder;
+        break;
+    }
+    case 5: {
+        SoCube* cube = new SoCube;
+        cube->width = 1.4f;
+        cube->height = 0.6f;
+        cube->depth = 0.9f;
+        binding->value = SoMaterialBinding::PER_PART;
+        shape = cube;
+        break;
+    }
+    case 6: {
+        SoCube* cube = new SoCube;
+        cube->width = 0.5f;
+        cube->height = 1.5f;
+        cube->depth = 1.0f;
+        binding->value = SoMaterialBinding::PER_PART_INDEXED;
+        shape = cube;
+        break;
+    }
+    default: { // the last case
+        SoSphere* sphere = new SoSphere;
+        sphere->radius = 0.9f;
+        shape = sphere;
+        break;
+    }
+    }
+
+    for (int i = 0; i < 2; i++) {
+        SoSeparator* sep = new SoSeparator;
+        SoTransform* transform = new SoTransform;
+        transform->translation = SbVec3f(i ? 1.25f : -1.25f, 0.0f, 0.0f);
+        transform->rotation = SbRotation(SbVec3f(1.0f, 0.3f, 0.0f), i ? -0.6f : 0.6f);
+        sep->addChild(transform);
+        sep->addChild(shape);
+        root->addChild(sep);
+    }
+    return root;
+}
+
+// Renders a new instance of a unit shape case, so that no render
+// caches are reused, and returns the pixels and the draw call count
+std::vector<unsigned char> renderUnitShapeCase(int shapecase, int size, uint64_t& drawcalls) {
+    SoSeparator* root = createUnitShapeScene(shapecase);
+    SbViewportRegion viewport(size, size);
+    SoOffscreenRenderer renderer(viewport);
+    renderer.setBackgroundColor(SbColor(0.0f, 0.0f, 0.0f));
+    std::vector<unsigned char> pixels;
+    if (renderer.render(root)) {
+        const unsigned char* buffer = renderer.getBuffer();
+        pixels.assign(buffer, buffer + size * size * 3);
+        drawcalls = renderer.getGLRenderAction()->getRenderStatistics().getCount(
+            SoRenderStatistics::DRAW_CALLS);
+    }
+    root->unref();
+    return pixels;
+}
+
+// The children rendered by the last cull test render
+static std::set<int> cull_rendered_children;
+
+// A cube which records when it is rendered
+class RecordingCube : public SoCube {
+    SO_NODE_HEADER(RecordingCube);
+public:
+    static void initClass(void) {
+        SO_NODE_INIT_CLASS(RecordingCube, SoCube, "Cube");
+    }
+    RecordingCube(void) : index(-1) {
+        SO_NODE_CONSTRUCTOR(RecordingCube);
+    }
+    virtual void GLRender(SoGLRenderAction* action) {
+        cull_rendered_children.insert(this->index);
+        SoCube::GLRender(action);
+    }
+    int index;
+
+protected:
+    virtual ~RecordingCube() {}
+};
+
+SO_NODE_SOURCE(RecordingCube);
+
+// Creates a scene with a grid of cubes under the given group, of
+// which the camera only sees some. The translations are returned so the cubes can be
+// moved.
+SoSeparator* createCullScene(SoGroup* group, SoSeparator::CacheEnabled childculling,
+                             std::vector<SoTranslation*>& moves) {
+    SoSeparator* root = new SoSeparator;
+    root->ref();
+
+    SoOrthographicCamera* camera = new SoOrthographicCamera;
+    camera->position = SbVec3f(5.0f, 5.0f, 20.0f);
+    camera->height = 9.0f;
+    camera->nearDistance = 1.0f;
+    camera->farDistance = 40.0f;
+    root->addChild(camera);
+    root->addChild(new SoDirectionalLight);
+    root->addChild(group);
+
+    for (int i = 0; i < 64; i++) {
+        SoSeparator* child = new SoSeparator;
+        child->renderCulling = childculling;
+        child->renderCaching = SoSeparator::OFF;
+        SoTranslation* move = new SoTranslation;
+        move->translation.setValue(float(i % 8) * 3.0f, float(i / 8) * 3.0f, 0.0f);
+        moves.push_back(move);
+        child->addChild(move);
+        SoMaterial* material = new SoMaterial;
+        material->diffuseColor.setValue(float(i % 4) / 3.0f, float(i / 16) / 3.0f, 0.5f);
+        child->addChild(material);
+        RecordingCube* cube = new RecordingCube;
+        cube->index = i;
+        child->addChild(cube);
+        group->addChild(child);
+    }
+    return root;
+}
+
+// Renders a cull test scene, returning the pixels and the rendered
+// children
+std::vector<unsigned char> renderCullScene(SoSeparator* root, int size, std::set<int>& rendered) {
+    SbViewportRegion viewport(size, size);
+    SoOffscreenRenderer renderer(viewport);
+    renderer.setBackgroundColor(SbColor(0.0f, 0.0f, 0.0f));
+    cull_rendered_children.clear();
+    std::vector<unsigned char> pixels;
+    if (renderer.render(root)) {
+        const unsigned char* buffer = renderer.getBuffer();
+        pixels.assign(buffer, buffer + size * size * 3);
+    }
+    rendered = cull_rendered_children;
+    return pixels;
+}
+
+// Renders a cull test scene with an SoBVHSeparator and with an
+// SoSeparator, and compares the images and the rendered children
+bool compareCullScenes(SoSeparator* bvhroot, SoSeparator* plainroot, int size,
+                       std::string& message) {
+    std::set<int> bvhrendered, plainrendered;
+    const std::vector<unsigned char> bvhpixels = renderCullScene(bvhroot, size, bvhrendered);
+    const std::vector<unsigned char> plainpixels = renderCullScene(plainroot, size, plainrendered);
+    if (bvhpixels.empty() || plainpixels.empty()) {
+        message = "Failed to render the cull test scenes";
+        return false;
+    }
+    std::cout << bvhrendered.size() << " of 64 children rendered with SoBVHSeparator, "
+              << plainrendered.size() << " with SoSeparator" << std::endl;
+    if (bvhrendered != plainrendered) {
+        message = "SoBVHSeparator rendered other children than SoSeparator";
+        return false;
+    }
+    if (plainrendered.empty() || plainrendered.size() == 64) {
+        message = "The cull test scene should have children both in and out of view";
+        return false;
+    }
+    if (bvhpixels != plainpixels) {
+        message = "SoBVHSeparator rendered a different image than SoSeparator";
+        return false;
+    }
+    return true;
+}
+
+// Creates a scene without a camera for SoParallelRenderer, with
+// enough shapes for the jobs to share bounding box and primitive
+// vertex caches
+SoSeparator* createParallelScene() {
+    SoSeparator* root = new SoSeparator;
+    root->ref();
+    SoDirectionalLight* light = new SoDirectionalLight;
+    light->direction = SbVec3f(-1, -1, -1);
+    root->addChild(light);
+    for (int i = 0; i < 16; i++) {
+        SoSeparator* sep = new SoSeparator;
+        SoTranslation* move = new SoTranslation;
+        move->translation.setValue(float(i % 4) * 2.5f - 3.75f, float(i / 4) * 2.5f - 3.75f, 0.0f);
+        sep->addChild(move);
+        SoMaterial* material = new SoMaterial;
+        material->diffuseColor.setValue(float(i % 4) / 3.0f, float(i / 4) / 3.0f, 1.0f - float(i) / 15.0f);
+        sep->addChild(material);
+        switch (i % 4) {
+        case 0: sep->addChild(new SoSphere); break;
+        case 1: sep->addChild(new SoCube); break;
+        case 2: sep->addChild(new SoCone); break;
+        default: {
+            // an indexed face set, rendered from its primitive vertex
+            // cache after a couple of frames
+            SoCoordinate3* coords = new SoCoordinate3;
+            const SbVec3f points[4] = {
+                SbVec3f(-1, -1, 0), SbVec3f(1, -1, 0), SbVec3f(1, 1, 0.5f), SbVec3f(-1, 1, 0.5f)
+            };
+            coords->point.setValues(0, 4, points);
+            sep->addChild(coords);
+            SoIndexedFaceSet* faceset = new SoIndexedFaceSet;
+            const int32_t indices[5] = { 0, 1, 2, 3, -1 };
+            faceset->coordIndex.setValues(0, 5, indices);
+            sep->addChild(faceset);
+            break;
+        }
+        }
+        root->addChild(sep);
+    }
+    return root;
+}
+
+// The camera of each parallel rendering job
+SoOrthographicCamera* createParallelCamera(int job) {
+    SoOrthographicCamera* camera = new SoOrthographicCamera;
+    camera->ref();
+    camera->position = SbVec3f(float(job % 3) - 1.0f, float(job / 3) - 1.0f, 15.0f);
+    camera->orientation = SbRotation(SbVec3f(1, 1, 0), float(job) * 0.1f);
+    camera->height = 8.0f + float(job);
+    camera->nearDistance = 1.0f;
+    camera->farDistance = 30.0f;
+    return camera;
+}
+
+struct ParallelImages {
+    int size;
+    std::vector<std::vector<unsigned char>> pixels;
+};
+
+// Reads back the image of a job while its context is current
+void readParallelJob(void* userdata, const int job, SoGLRenderAction*) {
+    ParallelImages* images = static_cast<ParallelImages*>(userdata);
+    std::vector<unsigned char>& pixels = images->pixels[job];
+    pixels.resize(images->size * images->size * 3);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, images->size, images->size, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+}
+
+// Renders the scene with the render manager and returns the pixels
+std::vector<unsigned char> renderWithManager(SoRenderManager& manager, int size) {
+    manager.render();
+    glFinish();
+    std::vector<unsigned char> pixels(size * size * 4);
+    glReadPixels(0, 0, size, size, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    return pixels;
+}
+
 // Helper function to save image as RGB using SGI RGB format
 bool saveRGB(const std::string& filename, const unsigned char* buffer, int width, int height) {
     // Use the RGB utility function instead of PNG
@@ -691,6 +1228,372 @@ int main() {
         return runner.getSummary();
     }
     
+    // Per-face materials rendered from the primitive vertex cache must
+    // give the same image as the first, immediate mode frame
+    runner.startTest("Per-face IndexedFaceSet primitive vertex cache rendering");
+    try {
+        const int size = 128;
+        const int numquads = 8;
+        SoSeparator* faceset = createPerFaceFaceSet(numquads);
+
+        SbViewportRegion viewport(size, size);
+        SoOffscreenRenderer renderer(viewport);
+        renderer.setBackgroundColor(SbColor(0.0f, 0.0f, 0.0f));
+
+        std::vector<unsigned char> first;
+        bool ok = true;
+        std::string message;
+        for (int frame = 0; frame < 4 && ok; frame++) {
+            if (!renderer.render(faceset)) {
+                ok = false;
+                message = "Failed to render frame " + std::to_string(frame);
+                break;
+            }
+            const unsigned char* buffer = renderer.getBuffer();
+            std::vector<unsigned char> pixels(buffer, buffer + size * size * 3);
+            if (frame == 0) {
+                for (int i = 0; i < numquads; i++) {
+                    const int x = (2 * i + 1) * size / (2 * numquads);
+                    const unsigned char* p = &pixels[((size / 2) * size + x) * 3];
+                    const RGBColor expected = (i % 2) ? RGBColor(0, 255, 0) : RGBColor(255, 0, 0);
+                    if (!colorsMatch(RGBColor(p[0], p[1], p[2]), expected)) {
+                        ok = false;
+                        message = "Wrong color for face " + std::to_string(i);
+                    }
+                }
+                first = pixels;
+            }
+            else if (pixels != first) {
+                ok = false;
+                message = "Frame " + std::to_string(frame) + " differs from the first frame";
+            }
+        }
+        faceset->unref();
+        runner.endTest(ok, message);
+    } catch (const std::exception& e) {
+        runner.endTest(false, std::string("Exception: ") + e.what());
+    }
+
+    // Quantized positions are decoded on the modelview matrix, which
+    // texture coordinate generation and shader programs don't see, so
+    // such shapes must render as without compression
+    runner.startTest("Position compression with object space texturing");
+    try {
+        // not a power of two, so that the checkerboard computed from
+        // the quantized positions doesn't alias to the original one
+        const int size = 100;
+        const uint32_t oldcompression = SoGLVBOElement::getAttributeCompression();
+        bool ok = true;
+        std::string message;
+        for (int useshader = 0; useshader < 2 && ok; useshader++) {
+            const std::string name = useshader ? "shader program" : "texture coordinate generation";
+            std::vector<unsigned char> uncompressed, compressed;
+            if (!renderObjectSpaceGrid(useshader != 0, SoGLVBOElement::COMPRESS_NONE,
+                                       size, uncompressed) ||
+                !renderObjectSpaceGrid(useshader != 0, SoGLVBOElement::COMPRESS_POSITIONS,
+                                       size, compressed)) {
+                ok = false;
+                message = "Failed to render the grid with " + name +
+                    ", or no compressed VBO was created";
+                break;
+            }
+            int numwhite = 0, numdiffering = 0;
+            for (int i = 0; i < size * size; i++) {
+                const unsigned char* a = &uncompressed[i * 3];
+                const unsigned char* b = &compressed[i * 3];
+                if (a[0] > 128) numwhite++;
+                for (int c = 0; c < 3; c++) {
+                    if (std::abs(int(a[c]) - int(b[c])) > 16) {
+                        numdiffering++;
+                        break;
+                    }
+                }
+            }
+            std::cout << name << ": " << numwhite << " white pixels, "
+                      << numdiffering << " differing" << std::endl;
+            if (numwhite < size * size / 4 || numwhite > size * size * 3 / 4) {
+                ok = false;
+                message = "The checkerboard was not rendered with " + name;
+            }
+            else if (numdiffering > size * size / 200) {
+                ok = false;
+                message = "Compressed positions changed the checkerboard with " + name;
+            }
+        }
+        SoGLVBOElement::setAttributeCompression(oldcompression);
+        runner.endTest(ok, message);
+    } catch (const std::exception& e) {
+        runner.endTest(false, std::string("Exception: ") + e.what());
+    }
+
+    // The shared unit shape tessellations must render like the
+    // immediate mode code they replace
+    runner.startTest("Unit shape cache rendering matches immediate mode");
+    try {
+        const int size = 128;
+        bool ok = true;
+        std::string message;
+        for (int shapecase = 0; shapecase < NUM_UNIT_SHAPE_CASES && ok; shapecase++) {
+            uint64_t cachedcalls = 0, immediatecalls = 0;
+            SoUnitShapeCache::setEnabled(TRUE);
+            const std::vector<unsigned char> cached =
+                renderUnitShapeCase(shapecase, size, cachedcalls);
+            SoUnitShapeCache::setEnabled(FALSE);
+            const std::vector<unsigned char> immediate =
+                renderUnitShapeCase(shapecase, size, immediatecalls);
+            SoUnitShapeCache::setEnabled(TRUE);
+
+            const std::string name = "case " + std::to_string(shapecase);
+            if (cached.empty() || immediate.empty()) {
+                ok = false;
+                message = "Failed to render " + name;
+                break;
+            }
+            // the cache renders a sphere with one draw call, immediate
+            // mode with one per stack
+            if (shapecase == NUM_UNIT_SHAPE_CASES - 1 && cachedcalls >= immediatecalls) {
+                ok = false;
+                message = "Unit shape cache was not used for " + name;
+            }
+            int numgeometry = 0, numdiffering = 0;
+            for (int i = 0; i < size * size; i++) {
+                const unsigned char* a = &cached[i * 3];
+                const unsigned char* b = &immediate[i * 3];
+                if (b[0] || b[1] || b[2]) numgeometry++;
+                for (int c = 0; c < 3; c++) {
+                    if (std::abs(int(a[c]) - int(b[c])) > 16) {
+                        numdiffering++;
+                        break;
+                    }
+                }
+            }
+            std::cout << name << ": " << numgeometry << " geometry pixels, "
+                      << numdiffering << " differing, " << cachedcalls << "/"
+                      << immediatecalls << " draw calls" << std::endl;
+            if (numgeometry < size * size / 50) {
+                ok = false;
+                message = "Nothing rendered for " + name;
+            }
+            // allow for rasterization differences along the edges
+            else if (numdiffering > size * size / 200) {
+                ok = false;
+                message = "Unit shape cache differs from immediate mode for " + name;
+            }
+        }
+        runner.endTest(ok, message);
+    } catch (const std::exception& e) {
+        SoUnitShapeCache::setEnabled(TRUE);
+        runner.endTest(false, std::string("Exception: ") + e.what());
+    }
+
+    // SoBVHSeparator must cull the same children as an SoSeparator
+    // whose children cull themselves, also after children have moved.
+    // The children of the SoBVHSeparator don't cull, so that only the
+    // hierarchy decides what is rendered.
+    runner.startTest("SoBVHSeparator culling matches SoSeparator");
+    try {
+        const int size = 128;
+        std::vector<SoTranslation*> bvhmoves, plainmoves;
+        RecordingCube::initClass();
+        SoSeparator* bvhroot = createCullScene(new SoBVHSeparator, SoSeparator::OFF, bvhmoves);
+        SoSeparator* plainroot = createCullScene(new SoSeparator, SoSeparator::ON, plainmoves);
+        SoGetBoundingBoxAction bboxaction(SbViewportRegion(size, size));
+
+        // the hierarchy, and the bounding box caches the children cull
+        // with, are made by the bounding box traversal
+        bboxaction.apply(bvhroot);
+        bboxaction.apply(plainroot);
+        std::string message;
+        bool ok = compareCullScenes(bvhroot, plainroot, size, message);
+
+        // move a child out of view and another into view, and refit
+        for (int pass = 0; pass < 2 && ok; pass++) {
+            const SbVec3f out(20.0f, -15.0f, 0.0f), in(4.0f, 7.0f, 2.0f);
+            bvhmoves[pass ? 10 : 0]->translation = out;
+            plainmoves[pass ? 10 : 0]->translation = out;
+            bvhmoves[pass ? 62 : 63]->translation = in;
+            plainmoves[pass ? 62 : 63]->translation = in;
+            // the second time, render before the bounding boxes are
+            // recalculated, so the changed children can't be culled
+            if (pass == 0) {
+                bboxaction.apply(bvhroot);
+                bboxaction.apply(plainroot);
+            }
+            ok = compareCullScenes(bvhroot, plainroot, size, message);
+        }
+        bvhroot->unref();
+        plainroot->unref();
+        runner.endTest(ok, message);
+    } catch (const std::exception& e) {
+        runner.endTest(false, std::string("Exception: ") + e.what());
+    }
+
+    // Every job of a multithreaded SoParallelRenderer must render the
+    // same image as a single threaded render with its camera, also
+    // when the caches shared by the jobs are reused
+    runner.startTest("SoParallelRenderer jobs match single threaded rendering");
+    try {
+        const int size = 96;
+        const int numjobs = 6;
+        SoSeparator* scene = createParallelScene();
+        SoDB::ContextManager* manager = SoDB::getContextManager();
+
+        SoParallelRenderer renderer;
+        renderer.setSceneGraph(scene);
+        renderer.setNumThreads(3);
+        renderer.setBackgroundColor(SbColor4f(0.0f, 0.0f, 0.0f, 1.0f));
+        std::vector<SoOrthographicCamera*> cameras;
+        std::vector<void*> contexts;
+        for (int job = 0; job < numjobs; job++) {
+            cameras.push_back(createParallelCamera(job));
+            contexts.push_back(manager->createOffscreenContext(size, size));
+            renderer.addJob(cameras[job], SbViewportRegion(size, size), contexts[job]);
+        }
+        ParallelImages images;
+        images.size = size;
+        images.pixels.resize(numjobs);
+        renderer.setPostRenderCallback(readParallelJob, &images);
+
+        // the single threaded renders
+        std::vector<std::vector<unsigned char>> expected;
+        for (int job = 0; job < numjobs; job++) {
+            SoSeparator* root = new SoSeparator;
+            root->ref();
+            root->addChild(cameras[job]);
+            root->addChild(scene);
+            SoOffscreenRenderer single(SbViewportRegion(size, size));
+            single.setBackgroundColor(SbColor(0.0f, 0.0f, 0.0f));
+            std::vector<unsigned char> pixels;
+            if (single.render(root)) {
+                pixels.assign(single.getBuffer(), single.getBuffer() + size * size * 3);
+            }
+            expected.push_back(pixels);
+            root->unref();
+        }
+
+        bool ok = true;
+        std::string message;
+        for (int frame = 0; frame < 4 && ok; frame++) {
+            for (int job = 0; job < numjobs; job++) images.pixels[job].clear();
+            if (!renderer.render()) {
+                ok = false;
+                message = "SoParallelRenderer::render() failed in frame " + std::to_string(frame);
+                break;
+            }
+            for (int job = 0; job < numjobs && ok; job++) {
+                const std::vector<unsigned char>& a = images.pixels[job];
+                const std::vector<unsigned char>& b = expected[job];
+                if (b.empty() || a.size() != b.size()) {
+                    ok = false;
+                    message = "No image for job " + std::to_string(job);
+                    break;
+                }
+                int numgeometry = 0, numdiffering = 0;
+                for (int i = 0; i < size * size; i++) {
+                    if (b[i * 3] || b[i * 3 + 1] || b[i * 3 + 2]) numgeometry++;
+                    for (int c = 0; c < 3; c++) {
+                        if (std::abs(int(a[i * 3 + c]) - int(b[i * 3 + c])) > 8) {
+                            numdiffering++;
+                            break;
+                        }
+                    }
+                }
+                if (numgeometry < size * size / 20) {
+                    ok = false;
+                    message = "Nothing rendered for job " + std::to_string(job);
+                }
+                else if (numdiffering > 0) {
+                    ok = false;
+                    message = "Job " + std::to_string(job) + " differs from single threaded rendering in " +
+                              std::to_string(numdiffering) + " pixels in frame " + std::to_string(frame);
+                }
+            }
+        }
+
+        renderer.removeAllJobs();
+        for (int job = 0; job < numjobs; job++) {
+            manager->destroyContext(contexts[job]);
+            cameras[job]->unref();
+        }
+        scene->unref();
+        runner.endTest(ok, message);
+    } catch (const std::exception& e) {
+        runner.endTest(false, std::string("Exception: ") + e.what());
+    }
+
+    // An unfinished progressive frame is only continued when the buffer
+    // holds the previous frame, i.e. when single buffered
+    runner.startTest("Progressive rendering with SoRenderManager");
+    try {
+        const int size = 128;
+        OSMesaContextData ctx(size, size);
+        SoSeparator* grid = createCubeGrid(6);
+        bool ok = ctx.makeCurrent();
+        std::string message = ok ? "" : "Failed to activate OSMesa context";
+
+        SoRenderManager manager;
+        manager.setSceneGraph(grid);
+        manager.setWindowSize(SbVec2s(size, size));
+        manager.setViewportRegion(SbViewportRegion(size, size));
+        manager.setBackgroundColor(SbColor4f(0.0f, 0.0f, 0.0f, 1.0f));
+        SoGLRenderAction* action = manager.getGLRenderAction();
+        std::vector<unsigned char> reference;
+        if (ok) reference = renderWithManager(manager, size);
+
+        // at least one unit is rendered per frame
+        action->setProgressiveRendering(TRUE);
+        action->setProgressiveTimeBudget(SbTime::zero());
+
+        // double buffered: the frame is rendered completely, since the
+        // back buffer is undefined after a swap
+        if (ok) {
+            const std::vector<unsigned char> pixels = renderWithManager(manager, size);
+            if (action->isProgressiveRenderingPending() || pixels != reference) {
+                ok = false;
+                message = "Double buffered progressive frame was not rendered completely";
+            }
+        }
+
+        // single buffered: the frame is built over several renders on
+        // top of the previous ones
+        if (ok) {
+            manager.setDoubleBuffer(FALSE);
+            action->restartProgressiveRendering();
+            std::vector<unsigned char> pixels = renderWithManager(manager, size);
+            if (!action->isProgressiveRenderingPending()) {
+                ok = false;
+                message = "Single buffered progressive frame was not split";
+            }
+            int frames = 1;
+            while (ok && action->isProgressiveRenderingPending() && frames < 100) {
+                pixels = renderWithManager(manager, size);
+                frames++;
+            }
+            if (ok && pixels != reference) {
+                ok = false;
+                message = "Continued progressive frames differ from a normal render";
+            }
+        }
+
+        // a preserved back buffer is continued as well
+        if (ok) {
+            manager.setDoubleBuffer(TRUE);
+            manager.setBackBufferPreserved(TRUE);
+            action->restartProgressiveRendering();
+            renderWithManager(manager, size);
+            if (!action->isProgressiveRenderingPending()) {
+                ok = false;
+                message = "Progressive frame with a preserved back buffer was not split";
+            }
+        }
+        action->setProgressiveRendering(FALSE);
+        manager.setSceneGraph(NULL);
+        grid->unref();
+        runner.endTest(ok, message);
+    } catch (const std::exception& e) {
+        runner.endTest(false, std::string("Exception: ") + e.what());
+    }
+
     // Clean up scene
     if (scene) {
         scene->unref();
@@ -56,6 +56,12 @@
 #include <Inventor/threads/SbStorage.h>
 #include <Inventor/threads/SbTypedStorage.h>
 #include <Inventor/SbTime.h>
+#include <Inventor/actions/SoGetBoundingBoxAction.h>
+#include <Inventor/misc/SoSceneSnapshot.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoTranslation.h>
+#include <Inventor/nodes/SoCube.h>
+#include <Inventor/nodes/SoSphere.h>
 
 #include <vector>
 #include <atomic>
@@ -343,6 +349,122 @@ static bool test_typed_thread_local_storage() {
     return (**ptr2 == 123);
 }
 
+static void storage_init_func(void *tls) {
+    *static_cast<int *>(tls) = 7;
+}
+
+static void *storage_thread_func(void *data) {
+    SbStorage *storage = static_cast<SbStorage *>(data);
+    int *value = static_cast<int *>(storage->get());
+    // a fresh block for this thread, not the main thread's
+    if (*value == 7) {
+        *value = 2;
+        if (*static_cast<int *>(storage->get()) == 2) g_counter++;
+    }
+    return nullptr;
+}
+
+static bool test_thread_local_storage_per_thread() {
+    g_counter = 0;
+    SbStorage storage(sizeof(int), storage_init_func, nullptr);
+    *static_cast<int *>(storage.get()) = 1;
+
+    const int num_threads = 4;
+    std::vector<SbThread *> threads;
+    for (int i = 0; i < num_threads; ++i) {
+        threads.push_back(SbThread::create(storage_thread_func, &storage));
+    }
+    for (SbThread *t : threads) {
+        t->join();
+        SbThread::destroy(t);
+    }
+    return (g_counter.load() == num_threads) &&
+           (*static_cast<int *>(storage.get()) == 1);
+}
+
+static bool test_thread_local_storage_reuse() {
+    // a storage created after another one was destructed must not see
+    // the old storage's block, even if it gets the same slot
+    SbStorage *first = new SbStorage(sizeof(int), storage_init_func, nullptr);
+    *static_cast<int *>(first->get()) = 99;
+    delete first;
+
+    bool ok = true;
+    for (int i = 0; i < 4 && ok; ++i) {
+        SbStorage *next = new SbStorage(sizeof(int), storage_init_func, nullptr);
+        ok = (*static_cast<int *>(next->get()) == 7);
+        *static_cast<int *>(next->get()) = 99;
+        delete next;
+    }
+    return ok;
+}
+
+static void *storage_churn_func(void *data) {
+    SbStorage *storage = static_cast<SbStorage *>(data);
+    for (int i = 0; i < 100; ++i) {
+        *static_cast<int *>(storage->get()) += 1;
+    }
+    if (*static_cast<int *>(storage->get()) == 107) g_counter++;
+    return nullptr;
+}
+
+static bool test_thread_local_storage_thread_exit() {
+    // threads exiting, and having their blocks freed, must not disturb
+    // the blocks of a thread still using the storage
+    g_counter = 0;
+    SbStorage storage(sizeof(int), storage_init_func, nullptr);
+    int *mine = static_cast<int *>(storage.get());
+    *mine = 1;
+
+    const int num_threads = 16;
+    bool ok = true;
+    std::vector<SbThread *> threads;
+    for (int i = 0; i < num_threads; ++i) {
+        threads.push_back(SbThread::create(storage_churn_func, &storage));
+        for (int j = 0; j < 100 && ok; ++j) {
+            ok = (storage.get() == mine) && (*mine == 1);
+        }
+    }
+    for (SbThread *t : threads) {
+        t->join();
+        SbThread::destroy(t);
+    }
+    return ok && (g_counter.load() == num_threads) &&
+           (storage.get() == mine) && (*mine == 1);
+}
+
+// Uses a storage from a thread_local destructor, which runs after the
+// thread's storage blocks have been cleaned up if the object was
+// constructed before the storage was first used by the thread
+struct StorageAtExit {
+    SbStorage *storage = nullptr;
+    ~StorageAtExit() {
+        if (storage && *static_cast<int *>(storage->get()) == 7 &&
+            *static_cast<int *>(storage->get()) == 7) {
+            g_counter++;
+        }
+    }
+};
+
+static void *storage_at_exit_func(void *data) {
+    static thread_local StorageAtExit user;
+    user.storage = static_cast<SbStorage *>(data);
+    *static_cast<int *>(user.storage->get()) = 3;
+    return nullptr;
+}
+
+static bool test_thread_local_storage_at_thread_exit() {
+    g_counter = 0;
+    SbStorage storage(sizeof(int), storage_init_func, nullptr);
+    const int num_threads = 4;
+    for (int i = 0; i < num_threads; ++i) {
+        SbThread *t = SbThread::create(storage_at_exit_func, &storage);
+        t->join();
+        SbThread::destroy(t);
+    }
+    return g_counter.load() == num_threads;
+}
+
 static bool test_auto_lock() {
     SbMutex mutex;
     {
@@ -359,6 +481,183 @@ static bool test_auto_lock() {
     return true;
 }
 
+struct BBoxThreadData {
+    SoNode *root;
+    SbBox3f expected;
+};
+
+static void *bbox_thread_func(void *data) {
+    BBoxThreadData *d = static_cast<BBoxThreadData *>(data);
+    SoGetBoundingBoxAction action(SbViewportRegion(100, 100));
+    bool ok = true;
+    for (int i = 0; i < 200; ++i) {
+        SoDB::readlock();
+        action.apply(d->root);
+        SoDB::readunlock();
+        const SbBox3f box = action.getBoundingBox();
+        if (box.getMin() != d->expected.getMin() ||
+            box.getMax() != d->expected.getMax()) ok = false;
+    }
+    if (ok) g_counter++;
+    return nullptr;
+}
+
+static bool test_shared_bbox_caches() {
+    // several threads traversing the same shapes must share the
+    // shapes' bounding box caches without corrupting them
+    SoSeparator *root = new SoSeparator;
+    root->ref();
+    for (int i = 0; i < 16; ++i) {
+        SoSeparator *sep = new SoSeparator;
+        SoTranslation *t = new SoTranslation;
+        t->translation.setValue(float(i) * 3.0f, 0.0f, 0.0f);
+        sep->addChild(t);
+        if (i & 1) sep->addChild(new SoCube);
+        else sep->addChild(new SoSphere);
+        root->addChild(sep);
+    }
+
+    BBoxThreadData data;
+    data.root = root;
+    data.expected = SbBox3f(-1.0f, -1.0f, -1.0f, 46.0f, 1.0f, 1.0f);
+
+    g_counter = 0;
+    const int num_threads = 4;
+    std::vector<SbThread *> threads;
+    for (int i = 0; i < num_threads; ++i) {
+        threads.push_back(SbThread::create(bbox_thread_func, &data));
+    }
+    for (SbThread *t : threads) {
+        t->join();
+        SbThread::destroy(t);
+    }
+    root->unref();
+    return g_counter.load() == num_threads;
+}
+
+static SoSeparator *make_snapshot_scene(SoTranslation *&t0, SoTranslation *&t1) {
+    SoSeparator *root = new SoSeparator;
+    SoSeparator *sep0 = new SoSeparator;
+    t0 = new SoTranslation;
+    sep0->addChild(t0);
+    sep0->addChild(new SoCube);
+    root->addChild(sep0);
+    SoSeparator *sep1 = new SoSeparator;
+    t1 = new SoTranslation;
+    t1->translation.setValue(10.0f, 0.0f, 0.0f);
+    sep1->addChild(t1);
+    sep1->addChild(new SoSphere);
+    root->addChild(sep1);
+    return root;
+}
+
+static float snapshot_width(SoNode *root) {
+    SoGetBoundingBoxAction action(SbViewportRegion(100, 100));
+    action.apply(root);
+    float dx, dy, dz;
+    action.getBoundingBox().getSize(dx, dy, dz);
+    return dx;
+}
+
+static bool test_snapshot_versions() {
+    SoTranslation *t0, *t1;
+    SoSeparator *root = make_snapshot_scene(t0, t1);
+    SoSceneSnapshot snapshot(root);
+
+    // v1 stays valid until the last endRead()
+    SoNode *v1 = snapshot.beginRead();
+    bool ok = (v1 != NULL) && (v1 != root) && (snapshot_width(v1) == 12.0f);
+
+    // changes are not seen until they're published
+    t0->translation.setValue(-5.0f, 0.0f, 0.0f);
+    ok = ok && (snapshot.beginRead() == v1);
+    snapshot.endRead();
+    ok = ok && (snapshot_width(v1) == 12.0f);
+
+    ok = ok && snapshot.publish();
+    SoNode *v2 = snapshot.beginRead();
+    ok = ok && (v2 != v1) && (snapshot_width(v2) == 17.0f);
+    // the unchanged subgraph is shared between the versions
+    ok = ok && (static_cast<SoGroup *>(v2)->getChild(1) ==
+                static_cast<SoGroup *>(v1)->getChild(1));
+    ok = ok && (static_cast<SoGroup *>(v2)->getChild(0) !=
+                static_cast<SoGroup *>(v1)->getChild(0));
+    snapshot.endRead();
+    snapshot.endRead();
+
+    // nothing changed since the last version
+    ok = ok && !snapshot.publish() && snapshot.getVersion() == 2;
+    return ok;
+}
+
+static bool test_snapshot_reclaim() {
+    SoTranslation *t0, *t1;
+    SoSeparator *root = make_snapshot_scene(t0, t1);
+    SoSceneSnapshot snapshot(root);
+
+    SoNode *v1 = snapshot.beginRead();
+    t0->translation.setValue(1.0f, 0.0f, 0.0f);
+    snapshot.publish();
+    // still in use by this thread
+    bool ok = snapshot.getNumRetiredVersions() == 1;
+    ok = ok && snapshot_width(v1) == 12.0f;
+    snapshot.endRead();
+    snapshot.reclaim();
+    return ok && snapshot.getNumRetiredVersions() == 0;
+}
+
+struct SnapshotThreadData {
+    SoSceneSnapshot *snapshot;
+    std::atomic<bool> done;
+};
+
+static void *snapshot_reader_func(void *data) {
+    SnapshotThreadData *d = static_cast<SnapshotThreadData *>(data);
+    bool ok = true;
+    int reads = 0;
+    while (!d->done.load() || reads < 10) {
+        SoNode *root = d->snapshot->beginRead();
+        // both translations are changed between versions, so the
+        // width only changes if a version is seen half way
+        if (snapshot_width(root) != 12.0f) ok = false;
+        d->snapshot->endRead();
+        reads++;
+    }
+    if (ok) g_counter++;
+    return nullptr;
+}
+
+static bool test_snapshot_concurrent_readers() {
+    SoTranslation *t0, *t1;
+    SoSeparator *root = make_snapshot_scene(t0, t1);
+    SnapshotThreadData data;
+    data.snapshot = new SoSceneSnapshot(root);
+    data.done = false;
+
+    g_counter = 0;
+    const int num_threads = 4;
+    std::vector<SbThread *> threads;
+    for (int i = 0; i < num_threads; ++i) {
+        threads.push_back(SbThread::create(snapshot_reader_func, &data));
+    }
+    for (int i = 1; i <= 200; ++i) {
+        t0->translation.setValue(float(i), 0.0f, 0.0f);
+        t1->translation.setValue(float(i) + 10.0f, 0.0f, 0.0f);
+        data.snapshot->publish();
+    }
+    data.done = true;
+    for (SbThread *t : threads) {
+        t->join();
+        SbThread::destroy(t);
+    }
+    data.snapshot->reclaim();
+    const bool ok = (g_counter.load() == num_threads) &&
+        (data.snapshot->getNumRetiredVersions() == 0) &&
+        (data.snapshot->getVersion() == 201);
+    delete data.snapshot;
+    return ok;
+}
+
 // ---------------------------------------------------------------------------
 // main
 // ---------------------------------------------------------------------------
@@ -387,7 +686,15 @@ int main(int /*argc*/, char ** /*argv*/) {
         { "threadSafeFifo",        test_thread_safe_fifo      },
         { "threadLocalStorage",    test_thread_local_storage  },
         { "typedThreadLocalStorage", test_typed_thread_local_storage },
+        { "threadLocalStoragePerThread", test_thread_local_storage_per_thread },
+        { "threadLocalStorageReuse", test_thread_local_storage_reuse },
+        { "threadLocalStorageThreadExit", test_thread_local_storage_thread_exit },
+        { "threadLocalStorageAtThreadExit", test_thread_local_storage_at_thread_exit },
         { "automaticLocking",      test_auto_lock             },
+        { "sharedBoundingBoxCaches", test_shared_bbox_caches  },
+        { "snapshotVersions",      test_snapshot_versions     },
+        { "snapshotReclaim",       test_snapshot_reclaim      },
+        { "snapshotConcurrentReaders", test_snapshot_concurrent_readers },
     };
 
     for (auto &tc : tests) {